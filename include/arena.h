@@ -0,0 +1,259 @@
+/**
+ * @file arena.h
+ * @brief Bump arena and fixed-size pool allocators (header-only)
+ *
+ * Arena — carve allocations out of large blocks by bumping a pointer.
+ *   There is no per-object free: release everything at once with
+ *   arena_reset()/arena_free(), or roll back to an earlier point with
+ *   arena_mark()/arena_reset_to().  Teardown costs O(blocks), not
+ *   O(objects).
+ *
+ * Pool — fixed-size objects on top of an arena, with an intrusive free
+ *   list so single objects can be returned and reused (pool_free), and
+ *   the whole pool still torn down in O(blocks).
+ *
+ *   Arena block:  [ prev | size | used | obj obj obj ....... free ]
+ *                                         ^bump pointer ─────^
+ *
+ * Under AddressSanitizer, unallocated and released memory is poisoned,
+ * so use-after-reset and use-after-pool_free are reported like a real
+ * use-after-free.  Define ARENA_NO_POISON to turn that off.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* ── ASan poisoning hooks ─────────────────────────────────────── */
+#if !defined(ARENA_NO_POISON)
+#  if defined(__SANITIZE_ADDRESS__)
+#    define ARENA_ASAN 1
+#  elif defined(__has_feature)
+#    if __has_feature(address_sanitizer)
+#      define ARENA_ASAN 1
+#    endif
+#  endif
+#endif
+
+#ifdef ARENA_ASAN
+#include <sanitizer/asan_interface.h>
+#define ARENA_POISON(p, n)   ASAN_POISON_MEMORY_REGION((p), (n))
+#define ARENA_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION((p), (n))
+#else
+#define ARENA_POISON(p, n)   ((void)(p), (void)(n))
+#define ARENA_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
+/* Alignment of type T without C11 _Alignof */
+#define ARENA_ALIGNOF(T)      offsetof(struct { char c_; T t_; }, t_)
+#define ARENA_DEFAULT_ALIGN   16
+#define ARENA_DEFAULT_BLOCK   (64 * 1024)
+
+/* Allocate one / n objects of type T with the right alignment */
+#define ARENA_NEW(a, T)       ((T *)arena_alloc_aligned((a), sizeof(T), ARENA_ALIGNOF(T)))
+#define ARENA_NEW_N(a, T, n)  ((T *)arena_alloc_aligned((a), sizeof(T) * (n), ARENA_ALIGNOF(T)))
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *prev;    /* older block (blocks form a stack) */
+    size_t             size;    /* usable bytes in data[]            */
+    size_t             used;    /* bump offset into data[]           */
+    unsigned char      data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;           /* newest block, allocations go here */
+    size_t      block_size;     /* default size of new blocks        */
+    size_t      allocated;      /* bytes handed out since last reset */
+    size_t      blocks;         /* blocks currently owned            */
+} Arena;
+
+/* A saved position to roll back to */
+typedef struct {
+    ArenaBlock *block;
+    size_t      used;
+    size_t      allocated;
+} ArenaMark;
+
+static inline void arena_init(Arena *a, size_t block_size)
+{
+    a->head       = NULL;
+    a->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    a->allocated  = 0;
+    a->blocks     = 0;
+}
+
+static inline ArenaBlock *arena_new_block_(Arena *a, size_t min_size)
+{
+    size_t size = a->block_size > min_size ? a->block_size : min_size;
+    ArenaBlock *b = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (!b) return NULL;
+    b->prev = a->head;
+    b->size = size;
+    b->used = 0;
+    ARENA_POISON(b->data, size);
+    a->head = b;
+    a->blocks++;
+    return b;
+}
+
+/* Allocate size bytes aligned to align (a power of two).  NULL on OOM. */
+static inline void *arena_alloc_aligned(Arena *a, size_t size, size_t align)
+{
+    ArenaBlock *b = a->head;
+    if (size == 0) size = 1;
+
+    if (b) {
+        uintptr_t base = (uintptr_t)b->data;
+        uintptr_t p    = (base + b->used + (align - 1)) & ~(uintptr_t)(align - 1);
+        if (p + size <= base + b->size) {
+            b->used = (size_t)(p - base) + size;
+            a->allocated += size;
+            ARENA_UNPOISON((void *)p, size);
+            return (void *)p;
+        }
+    }
+
+    /* Doesn't fit: start a new block big enough for size + alignment slack */
+    b = arena_new_block_(a, size + align);
+    if (!b) return NULL;
+    return arena_alloc_aligned(a, size, align);
+}
+
+static inline void *arena_alloc(Arena *a, size_t size)
+{
+    return arena_alloc_aligned(a, size, ARENA_DEFAULT_ALIGN);
+}
+
+static inline ArenaMark arena_mark(const Arena *a)
+{
+    ArenaMark m;
+    m.block     = a->head;
+    m.used      = a->head ? a->head->used : 0;
+    m.allocated = a->allocated;
+    return m;
+}
+
+/* Release everything allocated after m was taken */
+static inline void arena_reset_to(Arena *a, ArenaMark m)
+{
+    while (a->head && a->head != m.block) {
+        ArenaBlock *prev = a->head->prev;
+        ARENA_UNPOISON(a->head->data, a->head->size);
+        free(a->head);
+        a->head = prev;
+        a->blocks--;
+    }
+    if (a->head) {
+        ARENA_POISON(a->head->data + m.used, a->head->size - m.used);
+        a->head->used = m.used;
+    }
+    a->allocated = m.allocated;
+}
+
+/* Release everything but keep the oldest block for reuse */
+static inline void arena_reset(Arena *a)
+{
+    while (a->head && a->head->prev) {
+        ArenaBlock *prev = a->head->prev;
+        ARENA_UNPOISON(a->head->data, a->head->size);
+        free(a->head);
+        a->head = prev;
+        a->blocks--;
+    }
+    if (a->head) {
+        ARENA_POISON(a->head->data, a->head->size);
+        a->head->used = 0;
+    }
+    a->allocated = 0;
+}
+
+/* Release everything, including all blocks */
+static inline void arena_free(Arena *a)
+{
+    while (a->head) {
+        ArenaBlock *prev = a->head->prev;
+        ARENA_UNPOISON(a->head->data, a->head->size);
+        free(a->head);
+        a->head = prev;
+    }
+    a->blocks    = 0;
+    a->allocated = 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Pool: fixed-size objects with a free list
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct PoolFreeNode {
+    struct PoolFreeNode *next;
+} PoolFreeNode;
+
+typedef struct {
+    Arena         arena;
+    size_t        obj_size;     /* rounded up to hold a free-list link */
+    size_t        align;
+    PoolFreeNode *free_list;
+    size_t        live;         /* objects currently allocated         */
+} Pool;
+
+static inline void pool_init(Pool *p, size_t obj_size, size_t align, size_t objs_per_block)
+{
+    if (align < ARENA_ALIGNOF(PoolFreeNode)) align = ARENA_ALIGNOF(PoolFreeNode);
+    if (obj_size < sizeof(PoolFreeNode)) obj_size = sizeof(PoolFreeNode);
+    obj_size = (obj_size + align - 1) & ~(align - 1);
+
+    arena_init(&p->arena, obj_size * (objs_per_block ? objs_per_block : 256));
+    p->obj_size  = obj_size;
+    p->align     = align;
+    p->free_list = NULL;
+    p->live      = 0;
+}
+
+#define POOL_INIT_FOR(p, T, per_block) \
+    pool_init((p), sizeof(T), ARENA_ALIGNOF(T), (per_block))
+
+static inline void *pool_alloc(Pool *p)
+{
+    void *obj;
+    if (p->free_list) {
+        obj = p->free_list;
+        ARENA_UNPOISON(obj, p->obj_size);
+        p->free_list = p->free_list->next;
+    } else {
+        obj = arena_alloc_aligned(&p->arena, p->obj_size, p->align);
+        if (!obj) return NULL;
+    }
+    p->live++;
+    return obj;
+}
+
+static inline void pool_free(Pool *p, void *obj)
+{
+    if (!obj) return;
+    PoolFreeNode *n = (PoolFreeNode *)obj;
+    n->next      = p->free_list;
+    p->free_list = n;
+    ARENA_POISON((unsigned char *)obj + sizeof(PoolFreeNode),
+                 p->obj_size - sizeof(PoolFreeNode));
+    p->live--;
+}
+
+/* Return every object to the pool at once, keeping the first block */
+static inline void pool_reset(Pool *p)
+{
+    arena_reset(&p->arena);
+    p->free_list = NULL;
+    p->live      = 0;
+}
+
+static inline void pool_destroy(Pool *p)
+{
+    arena_free(&p->arena);
+    p->free_list = NULL;
+    p->live      = 0;
+}
+
+#endif /* ARENA_H */
@@ -0,0 +1,306 @@
+/**
+ * @file bench.h
+ * @brief Shared timing helpers for the benchmark binaries
+ *
+ * Header-only.  The including file must enable POSIX (for example
+ * `#define _POSIX_C_SOURCE 200809L`) before any system header so that
+ * clock_gettime() is declared.
+ *
+ * Besides the clocks and output formats every benchmark shares, this
+ * is the harness behind DEMO_BENCH (common.h): a serialised cycle
+ * counter calibrated against CLOCK_MONOTONIC_RAW, optimisation
+ * barriers, and median/MAD statistics over auto-sized samples, so
+ * that a demo's "this costs N ns" is measured, not quoted.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Output formats shared by every benchmark's --format flag */
+typedef enum {
+    BENCH_FMT_TEXT,
+    BENCH_FMT_CSV,
+    BENCH_FMT_JSON
+} bench_format_t;
+
+/* Monotonic wall clock in nanoseconds */
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* The same, but never slewed by NTP: for intervals measured in one process */
+static inline uint64_t bench_now_raw_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline int bench_cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* pct-th percentile (0..100, nearest rank) of n samples; sorts v in place */
+static inline uint64_t bench_percentile(uint64_t *v, size_t n, double pct)
+{
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(*v), bench_cmp_u64);
+    size_t rank = (size_t)(pct / 100.0 * (double)n + 0.5);
+    if (rank > 0) rank--;
+    if (rank >= n) rank = n - 1;
+    return v[rank];
+}
+
+/* Parse "text" / "csv" / "json"; returns 0 on success, -1 otherwise */
+static inline int bench_parse_format(const char *s, bench_format_t *out)
+{
+    if (strcmp(s, "text") == 0) { *out = BENCH_FMT_TEXT; return 0; }
+    if (strcmp(s, "csv")  == 0) { *out = BENCH_FMT_CSV;  return 0; }
+    if (strcmp(s, "json") == 0) { *out = BENCH_FMT_JSON; return 0; }
+    return -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Cycle counter
+ * ════════════════════════════════════════════════════════════════ */
+
+/*
+ * bench_ticks() reads the CPU's constant-rate counter — the TSC on
+ * x86-64, CNTVCT_EL0 on AArch64 — fenced so that it neither runs ahead
+ * of the code before it nor lets the code after it start early.  Other
+ * targets fall back to CLOCK_MONOTONIC_RAW, one tick per nanosecond.
+ * The TSC counts at a fixed reference rate, not the core's current
+ * clock: it is a timer, not a cycle count.
+ */
+static inline uint64_t bench_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("lfence\n\trdtsc\n\tlfence" : "=a"(lo), "=d"(hi) : : "memory");
+    return (uint64_t)hi << 32 | lo;
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("isb\n\tmrs %0, cntvct_el0\n\tisb" : "=r"(t) : : "memory");
+    return t;
+#else
+    return bench_now_raw_ns();
+#endif
+}
+
+/* Nanoseconds per tick, measured once per program over ~10 ms */
+static inline double bench_ns_per_tick(void)
+{
+    static double ns_per_tick;
+    if (ns_per_tick > 0) return ns_per_tick;
+#if defined(__aarch64__)
+    uint64_t freq;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    ns_per_tick = 1e9 / (double)freq;
+#elif defined(__x86_64__) || defined(__i386__)
+    uint64_t n0 = bench_now_raw_ns(), t0 = bench_ticks(), n1, t1;
+    do {
+        n1 = bench_now_raw_ns();
+        t1 = bench_ticks();
+    } while (n1 - n0 < 10000000);
+    ns_per_tick = t1 > t0 ? (double)(n1 - n0) / (double)(t1 - t0) : 1.0;
+#else
+    ns_per_tick = 1.0;
+#endif
+    return ns_per_tick;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Optimisation barriers
+ * ════════════════════════════════════════════════════════════════ */
+
+/* The compiler must assume x (an lvalue that fits a register) has
+ * changed: the work that produced it stays, and so might its uses */
+#define BENCH_OPAQUE(x) __asm__ volatile("" : "+r"(x))
+
+/* The compiler must assume p's memory was read */
+static inline void bench_escape(const void *p)
+{
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+/* ... and that all memory was read and written */
+static inline void bench_clobber(void)
+{
+    __asm__ volatile("" : : : "memory");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Statistics
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    size_t n;               /* samples */
+    size_t outliers;        /* more than 3 scaled MADs from the median */
+    double min, median, p99, max;
+    double mad;             /* median absolute deviation, scaled to a sigma */
+    double mean;            /* of the samples that are not outliers */
+} bench_stats_t;
+
+static inline int bench_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static inline double bench_median_sorted(const double *v, size_t n)
+{
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/* Summarise n > 0 samples; sorts v in place.  A preempted or
+ * interrupted sample inflates the mean, not the median or the MAD */
+static inline void bench_stats(double *v, size_t n, bench_stats_t *s)
+{
+    double dev[64];
+    size_t m = n < 64 ? n : 64;
+
+    qsort(v, n, sizeof(*v), bench_cmp_double);
+    s->n      = n;
+    s->min    = v[0];
+    s->max    = v[n - 1];
+    s->median = bench_median_sorted(v, n);
+    s->p99    = v[(size_t)(0.99 * (double)(n - 1) + 0.5)];
+
+    /* The MAD of the central 64 samples is plenty for a demo */
+    const double *c = v + (n - m) / 2;
+    for (size_t i = 0; i < m; i++)
+        dev[i] = c[i] > s->median ? c[i] - s->median : s->median - c[i];
+    qsort(dev, m, sizeof(*dev), bench_cmp_double);
+    s->mad = 1.4826 * bench_median_sorted(dev, m);
+
+    double sum  = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        double d = v[i] > s->median ? v[i] - s->median : s->median - v[i];
+        if (d <= 3 * s->mad) {
+            sum += v[i];
+            kept++;
+        }
+    }
+    s->outliers = n - kept;
+    s->mean     = kept ? sum / (double)kept : s->median;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Runner — the loop behind DEMO_BENCH
+ * ════════════════════════════════════════════════════════════════ */
+
+/*
+ *   bench_run_t r;
+ *   bench_run_init(&r, "name", iters);
+ *   while (bench_run_next(&r)) {
+ *       for (uint64_t i = 0; i < r.batch; i++) body;
+ *       bench_run_stop(&r);
+ *   }
+ *   bench_run_report(&r);
+ *
+ * The first batches warm caches, branch predictors and the CPU clock
+ * for BENCH_WARMUP_NS, doubling r.batch (starting from iters) until
+ * one batch takes BENCH_SAMPLE_NS; then BENCH_SAMPLES batches of that
+ * size are timed, or as many as fit in BENCH_BUDGET_NS (five at
+ * least).  Each sample is a batch's ns per iteration, which amortises
+ * the cost of reading the fenced counter itself.
+ */
+#define BENCH_SAMPLES    31
+#define BENCH_SAMPLE_NS  1000000.0      /* 1 ms */
+#define BENCH_WARMUP_NS  10000000.0     /* 10 ms */
+#define BENCH_BUDGET_NS  200000000.0    /* 200 ms */
+
+enum { BENCH_PHASE_WARMUP, BENCH_PHASE_MEASURE, BENCH_PHASE_DONE };
+
+typedef struct {
+    const char   *name;
+    uint64_t      batch;            /* iterations in the next batch */
+    int           phase;
+    size_t        n;
+    uint64_t      start;
+    double        elapsed_ns;       /* in this phase */
+    double        samples[BENCH_SAMPLES];
+    bench_stats_t stats;
+} bench_run_t;
+
+static inline void bench_run_init(bench_run_t *r, const char *name, uint64_t iters)
+{
+    memset(r, 0, sizeof(*r));
+    r->name  = name;
+    r->batch = iters ? iters : 1;
+    bench_ns_per_tick();            /* calibrate before the first batch */
+}
+
+/* 1 while another batch of r->batch iterations is wanted */
+static inline int bench_run_next(bench_run_t *r)
+{
+    if (r->phase == BENCH_PHASE_DONE) return 0;
+    r->start = bench_ticks();
+    return 1;
+}
+
+static inline void bench_run_stop(bench_run_t *r)
+{
+    double ns = (double)(bench_ticks() - r->start) * bench_ns_per_tick();
+    r->elapsed_ns += ns;
+
+    if (r->phase == BENCH_PHASE_WARMUP) {
+        if (ns < BENCH_SAMPLE_NS && r->batch < (1ull << 40)) {
+            r->batch *= 2;
+        } else if (r->elapsed_ns >= BENCH_WARMUP_NS) {
+            r->phase      = BENCH_PHASE_MEASURE;
+            r->elapsed_ns = 0;
+        }
+        return;
+    }
+    r->samples[r->n++] = ns / (double)r->batch;
+    if (r->n == BENCH_SAMPLES || (r->n >= 5 && r->elapsed_ns >= BENCH_BUDGET_NS)) {
+        bench_stats(r->samples, r->n, &r->stats);
+        r->phase = BENCH_PHASE_DONE;
+    }
+}
+
+/*
+ * One line per benchmark: text by default, or — with BENCH_FORMAT=csv
+ * or BENCH_FORMAT=json in the environment — a CSV row or a JSON object
+ * per line, so that runs of different demos can be compared.
+ */
+static inline void bench_run_report(const bench_run_t *r)
+{
+    const bench_stats_t *s   = &r->stats;
+    const char          *env = getenv("BENCH_FORMAT");
+    bench_format_t       fmt = BENCH_FMT_TEXT;
+    if (env) bench_parse_format(env, &fmt);
+
+    switch (fmt) {
+    case BENCH_FMT_TEXT:
+        printf("  [bench] %-32s %10.2f ns/op  ±%.2f  (min %.2f, p99 %.2f; %zu × %llu iters)\n", r->name,
+               s->median, s->mad, s->min, s->p99, s->n, (unsigned long long)r->batch);
+        break;
+    case BENCH_FMT_CSV:
+        printf("bench,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%zu,%llu,%zu\n", r->name, s->median, s->mean, s->mad, s->min,
+               s->p99, s->n, (unsigned long long)r->batch, s->outliers);
+        break;
+    case BENCH_FMT_JSON:
+        printf("{ \"bench\": \"%s\", \"median_ns\": %.3f, \"mean_ns\": %.3f, \"mad_ns\": %.3f, "
+               "\"min_ns\": %.3f, \"p99_ns\": %.3f, \"samples\": %zu, \"iters_per_sample\": %llu, "
+               "\"outliers\": %zu }\n",
+               r->name, s->median, s->mean, s->mad, s->min, s->p99, s->n, (unsigned long long)r->batch,
+               s->outliers);
+        break;
+    }
+}
+
+#endif /* BENCH_H */
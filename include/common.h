@@ -20,6 +20,8 @@
 #include <assert.h>
 #include <time.h>
 
+#include "bench.h"
+
 /* Version Info */
 #define VERSION_MAJOR 2
 #define VERSION_MINOR 0
@@ -77,4 +79,22 @@ typedef uint64_t u64;
 #define DEMO_END() \
     printf("\n----------------------------------------\n")
 
+/* Time a statement and print one line of statistics (bench.h).  The
+ * body runs in warmed-up batches of iters (0 = 1) or more, doubled
+ * until a batch takes a millisecond.  Keep its result alive, or the
+ * compiler may delete it:
+ *     DEMO_BENCH("strlen", 0, n = strlen(s); BENCH_OPAQUE(n));        */
+#define DEMO_BENCH(name, iters, ...) \
+    do { \
+        bench_run_t bench_run_; \
+        bench_run_init(&bench_run_, name, iters); \
+        while (bench_run_next(&bench_run_)) { \
+            for (uint64_t bench_i_ = 0; bench_i_ < bench_run_.batch; bench_i_++) { \
+                __VA_ARGS__; \
+            } \
+            bench_run_stop(&bench_run_); \
+        } \
+        bench_run_report(&bench_run_); \
+    } while (0)
+
 #endif /* COMMON_H */
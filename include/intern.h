@@ -0,0 +1,167 @@
+/**
+ * @file intern.h
+ * @brief String interner: byte spans → stable 32-bit atoms (header-only)
+ *
+ * Every distinct byte string is stored once, in an arena, and named by a
+ * small integer.  Two names are equal iff their atoms are equal, so the
+ * lexer can hand out atoms and everything downstream (symbol tables,
+ * IR, ...) compares and hashes integers instead of strings.
+ *
+ *   intern("count", 5) ─► hash ─► slots[] ─► atom 7 ─► atoms[7]
+ *                                                      { "count", 5, hash }
+ *
+ * Atoms are dense (1, 2, 3, ... in order of first appearance) and the
+ * (FNV-1a based) hash of each string is kept next to it, so tables keyed on
+ * atoms never rehash the text.  Atom 0 (ATOM_NONE) is never handed out.
+ * Strings are NUL-terminated and stay put until interner_free().
+ *
+ * One Interner is meant to be shared by every phase of a program: pass
+ * the same instance to the lexer and the symbol table.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+typedef uint32_t Atom;
+#define ATOM_NONE 0u
+
+typedef struct {
+    const char *str;
+    uint32_t    len;
+    uint32_t    hash;
+} AtomEntry;
+
+typedef struct {
+    AtomEntry *atoms;       /* atoms[id]; atoms[0] is a placeholder  */
+    uint32_t   count;       /* ids handed out + 1                    */
+    uint32_t   cap;
+    Atom      *slots;       /* open addressing, ATOM_NONE = empty    */
+    uint32_t   n_slots;     /* power of two                          */
+    Arena      strings;
+} Interner;
+
+/* 32-bit FNV-1a, finished with a multiply-xorshift so the low bits
+ * (which pick the slot) depend on every byte */
+static inline uint32_t intern_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline void interner_init(Interner *in)
+{
+    in->count   = 1;
+    in->cap     = 256;
+    in->atoms   = (AtomEntry *)calloc(in->cap, sizeof(AtomEntry));
+    in->n_slots = 512;
+    in->slots   = (Atom *)calloc(in->n_slots, sizeof(Atom));
+    arena_init(&in->strings, 16 * 1024);
+    if (in->atoms) in->atoms[0].str = "";
+}
+
+static inline void interner_free(Interner *in)
+{
+    free(in->atoms);
+    free(in->slots);
+    arena_free(&in->strings);
+    in->atoms   = NULL;
+    in->slots   = NULL;
+    in->count   = in->cap = in->n_slots = 0;
+}
+
+/* Slot holding s (or the empty slot where it would go) */
+static inline uint32_t intern_probe_(const Interner *in, const char *s, uint32_t len, uint32_t h)
+{
+    uint32_t mask = in->n_slots - 1;
+    uint32_t i    = h & mask;
+    for (Atom a; (a = in->slots[i]) != ATOM_NONE; i = (i + 1) & mask) {
+        const AtomEntry *e = &in->atoms[a];
+        if (e->hash == h && e->len == len && memcmp(e->str, s, len) == 0) break;
+    }
+    return i;
+}
+
+static inline int intern_grow_slots_(Interner *in)
+{
+    uint32_t n     = in->n_slots * 2;
+    Atom    *slots = (Atom *)calloc(n, sizeof(Atom));
+    if (!slots) return -1;
+    for (Atom a = 1; a < in->count; a++) {
+        uint32_t i = in->atoms[a].hash & (n - 1);
+        while (slots[i]) i = (i + 1) & (n - 1);
+        slots[i] = a;
+    }
+    free(in->slots);
+    in->slots   = slots;
+    in->n_slots = n;
+    return 0;
+}
+
+/* The atom for s[0..len), or ATOM_NONE if it has never been interned */
+static inline Atom intern_find(const Interner *in, const char *s, size_t len)
+{
+    uint32_t h = intern_hash(s, len);
+    return in->slots[intern_probe_(in, s, (uint32_t)len, h)];
+}
+
+/* The atom for s[0..len), adding it if new.  ATOM_NONE on OOM. */
+static inline Atom intern(Interner *in, const char *s, size_t len)
+{
+    uint32_t h = intern_hash(s, len);
+    uint32_t i = intern_probe_(in, s, (uint32_t)len, h);
+    if (in->slots[i]) return in->slots[i];
+
+    if (in->count == in->cap) {
+        AtomEntry *atoms = (AtomEntry *)realloc(in->atoms, in->cap * 2 * sizeof(AtomEntry));
+        if (!atoms) return ATOM_NONE;
+        in->atoms = atoms;
+        in->cap  *= 2;
+    }
+    if ((in->count + 1) * 4 > in->n_slots * 3) {     /* keep load ≤ 3/4 */
+        if (intern_grow_slots_(in) != 0) return ATOM_NONE;
+        i = intern_probe_(in, s, (uint32_t)len, h);
+    }
+
+    char *copy = (char *)arena_alloc_aligned(&in->strings, len + 1, 1);
+    if (!copy) return ATOM_NONE;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    Atom a = in->count++;
+    in->atoms[a].str  = copy;
+    in->atoms[a].len  = (uint32_t)len;
+    in->atoms[a].hash = h;
+    in->slots[i]      = a;
+    return a;
+}
+
+static inline Atom intern_cstr(Interner *in, const char *s)
+{
+    return intern(in, s, strlen(s));
+}
+
+static inline const char *atom_str(const Interner *in, Atom a)  { return in->atoms[a].str; }
+static inline uint32_t    atom_len(const Interner *in, Atom a)  { return in->atoms[a].len; }
+static inline uint32_t    atom_hash(const Interner *in, Atom a) { return in->atoms[a].hash; }
+
+/* Number of distinct strings interned */
+static inline uint32_t interner_size(const Interner *in)
+{
+    return in->count - 1;
+}
+
+#endif /* INTERN_H */
@@ -0,0 +1,510 @@
+/*
+ * bench_strings — glibc's string calls vs strsearch.h and strbuf.h on logs
+ *
+ * A synthetic log of --lines lines (timestamp, level, component, a
+ * message with ids in it; 60 to 200 bytes each) is searched the ways a
+ * log tool would, first with what glibc offers and then with this
+ * chapter's code:
+ *
+ *   newlines   count the lines: a memchr() loop, ss_count()
+ *   split      find every line end: memchr() or ss_chr() per line
+ *   strlen     the length of each line, as its own string
+ *   find       every occurrence of each --needles entry: strstr() per
+ *              line (the log cut into strings), memmem() over the whole
+ *              buffer, ss_find_twoway(), ss_find()
+ *   worst      the same for a needle of 32 'a's but one 'b' in the
+ *              middle, in 4 MB of 'a's: every byte passes ss_find's
+ *              first/last-byte filter, so it soon hands over to two-way
+ *   any        lines with any of the needles: strstr() per needle per
+ *              line, and one ss_multi_find() pass
+ *   build      the first --build-lines lines concatenated: strcat()
+ *              into a large enough buffer, sb_puts() and sb_append()
+ *              into a StrBuf that starts empty
+ *
+ * Times are ns per line of input (per 64 bytes for worst) from bench.h's
+ * runner; GB/s is of the bytes searched.  Every variant of a test must
+ * find the same matches at the same offsets (build: the same bytes) as
+ * the first, or the benchmark exits 1.
+ *
+ * Build: make bench_strings
+ * Run:   ./bin/bench_strings [--lines 200000] [--build-lines 2000]
+ *                            [--needles "ERROR,user=4242,connection reset by peer"]
+ *                            [--backend AVX2|SSE2|NEON|scalar] [--format text|csv|json]
+ *
+ * --backend picks the ss_*() vector code (see ss_set_backend()); by
+ * default it is the widest this CPU runs.
+ */
+
+#define _GNU_SOURCE         /* memmem() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "strsearch.h"
+#include "strbuf.h"
+
+#define MAX_NEEDLES 16
+#define MAX_IMPLS   4
+#define WORST_BYTES (4u << 20)
+#define WORST_LINE  64              /* what worst reports its time per */
+
+typedef struct {
+    size_t         lines, build_lines;
+    char           needle_list[256];
+    const char    *needles[MAX_NEEDLES];
+    size_t         lens[MAX_NEEDLES];
+    size_t         n_needles;
+    bench_format_t format;
+} Config;
+
+/* A text, as one buffer and as one C string per line */
+typedef struct {
+    char   *text, *ztext;           /* ztext: each '\n' a '\0' */
+    size_t  len;
+    size_t *start;                  /* of each line */
+    size_t  n_lines;
+} Corpus;
+
+typedef struct {
+    const Config  *cfg;
+    const Corpus  *c;
+    const char    *needle;          /* find, worst */
+    size_t         m;
+    const SsMulti *multi;           /* any */
+    char          *out;             /* build: strcat's buffer */
+    StrBuf         sb;
+} Data;
+
+typedef struct {
+    uint64_t    n, sum;             /* matches, and the sum of their offsets */
+    const char *bytes;              /* build: n of them */
+} Result;
+
+typedef void (*ImplFn)(Data *d, Result *r);
+
+typedef struct {
+    const char *name;
+    ImplFn      run;
+} Impl;
+
+static uint64_t xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The workload
+ * ════════════════════════════════════════════════════════════════ */
+
+static const char *const levels[]     = { "INFO", "INFO", "INFO", "INFO", "INFO", "INFO", "INFO",
+                                          "DEBUG", "DEBUG", "WARN", "ERROR" };
+static const char *const components[] = { "http", "db", "auth", "cache", "scheduler", "mailer" };
+static const char *const messages[]   = {
+    "GET /api/v1/orders/%u 200 %ums user=%u",
+    "POST /api/v1/login 401 %ums user=%u attempt=%u",
+    "query took %ums rows=%u user=%u",
+    "cache miss key=session:%u ttl=%u user=%u",
+    "connection reset by peer fd=%u after %ums retry=%u",
+    "job %u finished in %ums, next run in %us",
+    "queued message id=%u to user=%u size=%u",
+};
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static int corpus_from(Corpus *c, char *text, size_t len)
+{
+    c->text    = text;
+    c->len     = len;
+    c->ztext   = malloc(len + 1);
+    c->n_lines = 0;
+    for (size_t i = 0; i < len; i++) c->n_lines += text[i] == '\n';
+    c->start = malloc((c->n_lines + 1) * sizeof(size_t));
+    if (!c->ztext || !c->start) return -1;
+    size_t l = 0;
+    c->start[0] = 0;
+    for (size_t i = 0; i < len; i++) {
+        c->ztext[i] = text[i] == '\n' ? '\0' : text[i];
+        if (text[i] == '\n') c->start[++l] = i + 1;
+    }
+    c->ztext[len] = '\0';
+    return 0;
+}
+
+static int make_log(Corpus *c, size_t lines, uint64_t *seed)
+{
+    StrBuf sb;
+    sb_init(&sb);
+    for (size_t i = 0; i < lines; i++) {
+        uint64_t r = xorshift64(seed);
+        unsigned a = (unsigned)(r % 10000), b = (unsigned)(r >> 16) % 5000, u = (unsigned)(r >> 32) % 10000;
+        char     msg[128];
+        snprintf(msg, sizeof(msg), messages[(r >> 48) % COUNT(messages)], a, b, u);
+        if (sb_printf(&sb, "2024-05-%02u %02u:%02u:%02u.%03u %-5s [%s] %s", (unsigned)(i / 86400 % 28 + 1),
+                      (unsigned)(i / 3600 % 24), (unsigned)(i / 60 % 60), (unsigned)(i % 60),
+                      (unsigned)(r >> 20) % 1000, levels[(r >> 40) % COUNT(levels)],
+                      components[(r >> 8) % COUNT(components)], msg) != 0)
+            return -1;
+        /* a tail of up to 80 bytes of detail, so lengths vary */
+        size_t pad = (size_t)(r >> 56) % 81;
+        if (pad > 8) {
+            if (sb_puts(&sb, " trace=") != 0) return -1;
+            for (size_t k = 0; k < pad - 7; k++)
+                if (sb_putc(&sb, "0123456789abcdef"[(xorshift64(seed) >> 60)]) != 0) return -1;
+        }
+        if (sb_putc(&sb, '\n') != 0) return -1;
+    }
+    size_t len = sb_len(&sb);
+    return corpus_from(c, sb_detach(&sb), len);
+}
+
+static int make_worst(Corpus *c)
+{
+    char *text = malloc(WORST_BYTES);
+    if (!text) return -1;
+    memset(text, 'a', WORST_BYTES - 1);
+    text[WORST_BYTES - 1] = '\n';
+    return corpus_from(c, text, WORST_BYTES);
+}
+
+static void corpus_free(Corpus *c)
+{
+    free(c->text);
+    free(c->ztext);
+    free(c->start);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The variants
+ * ════════════════════════════════════════════════════════════════ */
+
+static void newlines_memchr(Data *d, Result *r)
+{
+    const char *p = d->c->text, *end = p + d->c->len;
+    uint64_t    n = 0;
+    while ((p = memchr(p, '\n', (size_t)(end - p)))) n++, p++;
+    r->n = n;
+}
+
+static void newlines_count(Data *d, Result *r)
+{
+    r->n = ss_count(d->c->text, d->c->len, '\n');
+}
+
+#define SPLIT(chr)                                                          \
+    const char *t = d->c->text, *p = t, *end = t + d->c->len, *q;          \
+    uint64_t    n = 0, sum = 0;                                             \
+    for (; (q = chr(p, '\n', (size_t)(end - p))); p = q + 1)                \
+        n++, sum += (uint64_t)(q - t);                                      \
+    r->n = n, r->sum = sum;
+
+static const char *ss_chr_args(const char *p, int c, size_t n) { return ss_chr(p, n, c); }
+
+static void split_memchr(Data *d, Result *r) { SPLIT(memchr) }
+static void split_sschr(Data *d, Result *r)  { SPLIT(ss_chr_args) }
+
+static void strlen_glibc(Data *d, Result *r)
+{
+    uint64_t sum = 0;
+    for (size_t l = 0; l < d->c->n_lines; l++) sum += strlen(d->c->ztext + d->c->start[l]);
+    r->n = d->c->n_lines, r->sum = sum;
+}
+
+static void strlen_ss(Data *d, Result *r)
+{
+    uint64_t sum = 0;
+    for (size_t l = 0; l < d->c->n_lines; l++) sum += ss_len(d->c->ztext + d->c->start[l]);
+    r->n = d->c->n_lines, r->sum = sum;
+}
+
+static void find_strstr(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    uint64_t      n = 0, sum = 0;
+    for (size_t l = 0; l < c->n_lines; l++)
+        for (const char *p = c->ztext + c->start[l]; (p = strstr(p, d->needle)); p++)
+            n++, sum += (uint64_t)(p - c->ztext);
+    r->n = n, r->sum = sum;
+}
+
+#define FIND_ALL(find)                                                      \
+    const char *t = d->c->text, *p = t, *end = t + d->c->len;              \
+    uint64_t    n = 0, sum = 0;                                             \
+    for (; (p = find(p, (size_t)(end - p), d->needle, d->m)); p++)          \
+        n++, sum += (uint64_t)(p - t);                                      \
+    r->n = n, r->sum = sum;
+
+static const char *memmem_chars(const char *h, size_t n, const char *x, size_t m) { return memmem(h, n, x, m); }
+
+static void find_memmem(Data *d, Result *r) { FIND_ALL(memmem_chars) }
+static void find_twoway(Data *d, Result *r) { FIND_ALL(ss_find_twoway) }
+static void find_ss(Data *d, Result *r)     { FIND_ALL(ss_find) }
+
+/* Lines with any needle: count them, and sum their starts */
+static void any_strstr(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    uint64_t      n = 0, sum = 0;
+    for (size_t l = 0; l < c->n_lines; l++)
+        for (size_t k = 0; k < d->cfg->n_needles; k++)
+            if (strstr(c->ztext + c->start[l], d->cfg->needles[k])) {
+                n++, sum += c->start[l];
+                break;
+            }
+    r->n = n, r->sum = sum;
+}
+
+/* One pass over the whole buffer, each match then skipping its line */
+static void any_multi(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    const char   *t = c->text;
+    uint64_t      n = 0, sum = 0;
+    size_t        l = 0, at = 0;
+    const char   *q;
+    while ((q = ss_multi_find(d->multi, t + at, c->len - at, NULL))) {
+        while (c->start[l + 1] <= (size_t)(q - t)) l++;    /* the line it is on */
+        n++, sum += c->start[l];
+        at = c->start[++l];
+    }
+    r->n = n, r->sum = sum;
+}
+
+static void build_strcat(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    d->out[0] = '\0';
+    for (size_t l = 0; l < d->cfg->build_lines; l++) strcat(d->out, c->ztext + c->start[l]);
+    r->n = strlen(d->out), r->bytes = d->out;
+}
+
+static void build_puts(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    sb_free(&d->sb);                /* from empty, growth included */
+    for (size_t l = 0; l < d->cfg->build_lines; l++) sb_puts(&d->sb, c->ztext + c->start[l]);
+    r->n = sb_len(&d->sb), r->bytes = sb_str(&d->sb);
+}
+
+static void build_append(Data *d, Result *r)
+{
+    const Corpus *c = d->c;
+    sb_free(&d->sb);
+    for (size_t l = 0; l < d->cfg->build_lines; l++)
+        sb_append(&d->sb, c->text + c->start[l], c->start[l + 1] - c->start[l] - 1);
+    r->n = sb_len(&d->sb), r->bytes = sb_str(&d->sb);
+}
+
+typedef struct {
+    const char *test;
+    Impl        impl[MAX_IMPLS];
+} Group;
+
+static const Group g_newlines = { "newlines", { { "memchr loop", newlines_memchr }, { "ss_count", newlines_count } } };
+static const Group g_split    = { "split", { { "memchr", split_memchr }, { "ss_chr", split_sschr } } };
+static const Group g_strlen   = { "strlen", { { "strlen", strlen_glibc }, { "ss_len", strlen_ss } } };
+static const Group g_find     = { "find", { { "strstr per line", find_strstr }, { "memmem", find_memmem },
+                                            { "ss_find_twoway", find_twoway }, { "ss_find", find_ss } } };
+static const Group g_worst    = { "worst", { { "strstr per line", find_strstr }, { "memmem", find_memmem },
+                                             { "ss_find_twoway", find_twoway }, { "ss_find", find_ss } } };
+static const Group g_any      = { "any", { { "strstr x needles", any_strstr }, { "ss_multi_find", any_multi } } };
+static const Group g_build    = { "build", { { "strcat", build_strcat }, { "sb_puts", build_puts },
+                                             { "sb_append", build_append } } };
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--lines 200000] [--build-lines 2000]\n"
+            "       %*s [--needles \"ERROR,user=4242,connection reset by peer\"]\n"
+            "       %*s [--backend AVX2|SSE2|NEON|scalar] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "", (int)strlen(argv0), "");
+}
+
+static int set_needles(Config *cfg, const char *list)
+{
+    snprintf(cfg->needle_list, sizeof(cfg->needle_list), "%s", list);
+    cfg->n_needles = 0;
+    for (char *save = NULL, *tok = strtok_r(cfg->needle_list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (cfg->n_needles == MAX_NEEDLES) return -1;
+        cfg->needles[cfg->n_needles] = tok;
+        cfg->lens[cfg->n_needles++]  = strlen(tok);
+    }
+    return cfg->n_needles ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--lines") == 0) {
+            cfg->lines = strtoul(val, NULL, 10);
+            if (cfg->lines < 100) return -1;
+        } else if (strcmp(opt, "--build-lines") == 0) {
+            cfg->build_lines = strtoul(val, NULL, 10);
+            if (cfg->build_lines < 1) return -1;
+        } else if (strcmp(opt, "--needles") == 0) {
+            if (set_needles(cfg, val) != 0) return -1;
+        } else if (strcmp(opt, "--backend") == 0) {
+            if (ss_set_backend(val) != 0) return -1;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    if (cfg->build_lines > cfg->lines) cfg->build_lines = cfg->lines;
+    return 0;
+}
+
+static double time_impl(const Impl *im, Data *d, Result *r)
+{
+    bench_run_t run;
+    bench_run_init(&run, im->name, 1);
+    while (bench_run_next(&run)) {
+        for (uint64_t i = 0; i < run.batch; i++) im->run(d, r);
+        bench_run_stop(&run);
+    }
+    bench_escape(r);
+    return run.stats.median;
+}
+
+static int same_result(const Result *a, const Result *b)
+{
+    if (a->n != b->n) return 0;
+    if (a->bytes || b->bytes) return a->bytes && b->bytes && memcmp(a->bytes, b->bytes, a->n) == 0;
+    return a->sum == b->sum;
+}
+
+static void report(const Config *cfg, const char *test, const char *input, const char *impl, double ns_per,
+                   double gbps, double speedup, uint64_t matches, int same, int *first)
+{
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-9s %-26.26s %-17s %10.2f %8.2f %8.2fx %9llu  %s\n", test, input, impl, ns_per, gbps, speedup,
+               (unsigned long long)matches, same ? "✓" : "RESULTS DIFFER");
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,\"%s\",%s,%.3f,%.3f,%.2f,%llu,%d\n", test, input, impl, ns_per, gbps, speedup,
+               (unsigned long long)matches, same);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"test\": \"%s\", \"input\": \"%s\", \"impl\": \"%s\", \"ns_per_line\": %.3f, "
+               "\"gb_per_s\": %.3f, \"vs_glibc\": %.2f, \"matches\": %llu, \"same_result\": %s }",
+               *first ? "" : ",", test, input, impl, ns_per, gbps, speedup, (unsigned long long)matches,
+               same ? "true" : "false");
+        *first = 0;
+        break;
+    }
+}
+
+/* Every impl of g on d; returns whether all agreed with the first */
+static int run_group(const Group *g, Data *d, const char *input, double per, size_t bytes, int *first)
+{
+    Result ref = { 0, 0, NULL }, r;
+    char  *keep = NULL;
+    double base = 0;
+    int    all  = 1;
+    for (int i = 0; i < MAX_IMPLS && g->impl[i].name; i++) {
+        memset(&r, 0, sizeof(r));
+        double ns   = time_impl(&g->impl[i], d, &r);
+        int    same = 1;
+        if (i == 0) {
+            base = ns;
+            ref  = r;
+            if (r.bytes) {          /* the next impl may reuse the buffer */
+                keep = malloc(r.n);
+                if (keep) memcpy(keep, r.bytes, r.n);
+                ref.bytes = keep;
+            }
+        } else {
+            same = same_result(&ref, &r);
+        }
+        all &= same;
+        report(d->cfg, g->test, input, g->impl[i].name, ns / per, (double)bytes / ns, base / ns, r.n, same, first);
+    }
+    free(keep);
+    return all;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 200000, 2000, "", { NULL }, { 0 }, 0, BENCH_FMT_TEXT };
+    if (set_needles(&cfg, "ERROR,user=4242,connection reset by peer") != 0 || parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Corpus   log, worst;
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    if (make_log(&log, cfg.lines, &seed) != 0 || make_worst(&worst) != 0) {
+        perror("bench_strings");
+        return 1;
+    }
+    SsMulti *multi = ss_multi_new(cfg.needles, cfg.lens, cfg.n_needles);
+    Data     d     = { &cfg, &log, NULL, 0, multi, malloc(log.len + 1), { 0 } };
+    sb_init(&d.sb);
+    if (!multi || !d.out) {
+        perror("bench_strings");
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_strings: %zu log lines, %.1f MB (%.0f bytes a line); ns per line, ss_*() use %s\n\n",
+               log.n_lines, (double)log.len / 1e6, (double)log.len / (double)log.n_lines, ss_backend());
+        printf("  %-9s %-26s %-17s %10s %8s %9s %9s\n", "test", "input", "impl", "ns/line", "GB/s", "vs glibc",
+               "matches");
+        break;
+    case BENCH_FMT_CSV:
+        printf("test,input,impl,ns_per_line,gb_per_s,vs_glibc,matches,same_result\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"strings\",\n  \"lines\": %zu,\n  \"bytes\": %zu,\n  \"backend\": \"%s\",\n"
+               "  \"results\": [",
+               log.n_lines, log.len, ss_backend());
+        break;
+    }
+
+    int    all   = 1, first = 1;
+    double lines = (double)log.n_lines;
+    all &= run_group(&g_newlines, &d, "", lines, log.len, &first);
+    all &= run_group(&g_split, &d, "", lines, log.len, &first);
+    all &= run_group(&g_strlen, &d, "", lines, log.len, &first);
+    for (size_t k = 0; k < cfg.n_needles; k++) {
+        d.needle = cfg.needles[k];
+        d.m      = cfg.lens[k];
+        all &= run_group(&g_find, &d, d.needle, lines, log.len, &first);
+    }
+    char any[256] = "";
+    for (size_t k = 0; k < cfg.n_needles; k++)
+        snprintf(any + strlen(any), sizeof(any) - strlen(any), "%s%s", k ? "|" : "", cfg.needles[k]);
+    all &= run_group(&g_any, &d, any, lines, log.len, &first);
+
+    size_t built = log.start[cfg.build_lines] - cfg.build_lines;    /* without the newlines */
+    all &= run_group(&g_build, &d, "", (double)cfg.build_lines, built, &first);
+
+    static const char worst_needle[] = "aaaaaaaaaaaaaaabaaaaaaaaaaaaaaaa";
+    d.c      = &worst;
+    d.needle = worst_needle;
+    d.m      = sizeof(worst_needle) - 1;
+    all &= run_group(&g_worst, &d, "a{15}ba{16} in 4 MB of a", (double)worst.len / WORST_LINE, worst.len, &first);
+
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    ss_multi_free(multi);
+    sb_free(&d.sb);
+    free(d.out);
+    corpus_free(&log);
+    corpus_free(&worst);
+    return all ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+ * Chapter 7 — StrBuf (see strbuf.h)
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "strbuf.h"
+
+void sb_init(StrBuf *b)
+{
+    b->heap     = NULL;
+    b->len      = 0;
+    b->cap      = STRBUF_INLINE - 1;
+    b->small[0] = '\0';
+}
+
+void sb_free(StrBuf *b)
+{
+    free(b->heap);
+    sb_init(b);
+}
+
+int sb_reserve(StrBuf *b, size_t extra)
+{
+    if (extra <= b->cap - b->len) return 0;
+    if (extra > SIZE_MAX - 1 - b->len) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    size_t need = b->len + extra;
+    size_t cap  = b->cap > (SIZE_MAX - 1) / 2 ? SIZE_MAX - 1 : 2 * b->cap + 1;
+    if (cap < need) cap = need;
+
+    char *p;
+    if (b->heap) {
+        p = realloc(b->heap, cap + 1);
+    } else {
+        p = malloc(cap + 1);
+        if (p) memcpy(p, b->small, b->len + 1);
+    }
+    if (!p) {
+        errno = ENOMEM;
+        return -1;
+    }
+    b->heap = p;
+    b->cap  = cap;
+    return 0;
+}
+
+int sb_append(StrBuf *b, const char *s, size_t n)
+{
+    if (sb_reserve(b, n) != 0) return -1;
+    char *d = b->heap ? b->heap : b->small;
+    memcpy(d + b->len, s, n);
+    b->len += n;
+    d[b->len] = '\0';
+    return 0;
+}
+
+int sb_puts(StrBuf *b, const char *s)
+{
+    return sb_append(b, s, strlen(s));
+}
+
+/* Format into the free space; only if it does not fit, grow and again */
+int sb_printf(StrBuf *b, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf((b->heap ? b->heap : b->small) + b->len, b->cap - b->len + 1, fmt, ap);
+    va_end(ap);
+    if (n < 0) return -1;
+    if ((size_t)n > b->cap - b->len) {
+        char *d = b->heap ? b->heap : b->small;
+        d[b->len] = '\0';           /* undo the truncated attempt */
+        if (sb_reserve(b, (size_t)n) != 0) return -1;
+        va_start(ap, fmt);
+        vsnprintf(b->heap + b->len, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    b->len += (size_t)n;
+    return 0;
+}
+
+char *sb_detach(StrBuf *b)
+{
+    char *s = b->heap;
+    if (!s) {
+        s = malloc(b->len + 1);
+        if (!s) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        memcpy(s, b->small, b->len + 1);
+    }
+    sb_init(b);
+    return s;
+}
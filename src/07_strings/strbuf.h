@@ -0,0 +1,72 @@
+/*
+ * Chapter 7 — A growable string that knows its own length
+ *
+ * strcat(dst, s) has to find the end of dst before it can append, so
+ * building a string with n appends rescans it n times: O(n²).  A
+ * StrBuf keeps len, so an append is one copy of the new bytes:
+ *
+ *   small    the first STRBUF_INLINE - 1 bytes live inside the struct,
+ *            so short strings — most of them — never touch malloc
+ *   growth   past that, capacity at least doubles on each reallocation,
+ *            so n appended bytes cost O(n) copies in total
+ *
+ * The contents are always '\0'-terminated, for passing to printf or
+ * fopen, but that byte is written, never searched for.  The struct may
+ * be copied or moved while inline, as sb_str() finds the bytes afresh.
+ *
+ * Every function that can allocate returns 0, or -1 with errno
+ * (ENOMEM, or EOVERFLOW past SIZE_MAX); the buffer is left as it was.
+ */
+
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <stddef.h>
+#include <string.h>
+
+#define STRBUF_INLINE 64
+
+typedef struct {
+    char  *heap;                    /* NULL while the bytes fit in small */
+    size_t len;
+    size_t cap;                     /* bytes storable, not counting the '\0' */
+    char   small[STRBUF_INLINE];
+} StrBuf;
+
+void  sb_init(StrBuf *b);
+void  sb_free(StrBuf *b);           /* and ready for reuse, as after sb_init */
+
+/* Room for extra more bytes without reallocating */
+int   sb_reserve(StrBuf *b, size_t extra);
+
+int   sb_append(StrBuf *b, const char *s, size_t n);
+int   sb_puts(StrBuf *b, const char *s);
+int   sb_printf(StrBuf *b, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/* The contents as an malloc()ed string for the caller to free; b is
+ * left empty.  NULL with errno (ENOMEM) */
+char *sb_detach(StrBuf *b);
+
+static inline const char *sb_str(const StrBuf *b) { return b->heap ? b->heap : b->small; }
+static inline size_t      sb_len(const StrBuf *b) { return b->len; }
+
+static inline void sb_clear(StrBuf *b)
+{
+    b->len = 0;
+    (b->heap ? b->heap : b->small)[0] = '\0';
+}
+
+static inline int sb_putc(StrBuf *b, char c)
+{
+    if (b->len == b->cap && sb_reserve(b, 1) != 0) return -1;
+    char *d = b->heap ? b->heap : b->small;
+    d[b->len++] = c;
+    d[b->len]   = '\0';
+    return 0;
+}
+
+#endif /* STRBUF_H */
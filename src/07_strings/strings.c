@@ -10,9 +10,12 @@
  *   5. Conversion — atoi, strtol (and why strtol wins)
  *   6. Formatted output — sprintf, snprintf
  *   7. Common pitfalls — buffer overflows, missing '\0', UB
+ *   8. At speed — SIMD search over spans, multi-needle search, and
+ *      a string builder that never rescans (strsearch.h, strbuf.h)
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/07_strings \
- *            src/07_strings/strings.c
+ *            src/07_strings/strings.c src/07_strings/strsearch.c \
+ *            src/07_strings/strbuf.c
  * Run:   ./bin/07_strings
  *
  * Try these:
@@ -26,6 +29,9 @@
 #include <ctype.h>     /* tolower, toupper */
 #include <strings.h>   /* strcasecmp (POSIX) */
 
+#include "strsearch.h"
+#include "strbuf.h"
+
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: String Basics
  *  Literals, char arrays, null terminator, sizeof vs strlen.
@@ -280,6 +286,117 @@ static void demo_common_pitfalls(void)
     printf("  4) Using == to compare strings:\n");
     printf("     if (name == \"Alice\")  // compares addresses, not content!\n");
     printf("     Fix: if (strcmp(name, \"Alice\") == 0)\n\n");
+
+    /* 5. strcat in a loop                                           */
+    printf("  5) strcat in a loop:\n");
+    printf("     for (i = 0; i < n; i++) strcat(out, line[i]);\n");
+    printf("     Each call rescans out for its '\\0': O(n^2) in total.\n");
+    printf("     Fix: keep the length and append at out + len (Section 8).\n\n");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: Searching and Building at Speed
+ *  The same jobs as Sections 2 and 3, on a few hundred KB of text.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define DEMO_LINES 2000
+
+static const char *const demo_levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+
+static void demo_at_speed(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: Searching and Building at Speed        ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    /* Each strcat() walks everything already in big to find its end:
+     * the n-th of them reads n lines first.  A StrBuf knows its
+     * length, so each append copies only the new line. */
+    static char lines[DEMO_LINES][96];
+    static char big[DEMO_LINES * 96];
+    for (int i = 0; i < DEMO_LINES; i++)
+        snprintf(lines[i], sizeof(lines[i]), "2024-05-%02d 12:%02d:%02d %-5s req=%d user=%d took %dms\n",
+                 1 + i % 28, i / 60 % 60, i % 60, demo_levels[i % 6], i, i * 7919 % 1000, i % 250);
+
+    StrBuf   sb;
+    unsigned grows = 0;
+    size_t   cap   = 0;
+    sb_init(&sb);
+    for (int i = 0; i < DEMO_LINES; i++) {
+        if (sb_puts(&sb, lines[i]) != 0) {
+            perror("  sb_puts");
+            sb_free(&sb);
+            return;
+        }
+        if (sb.cap != cap) cap = sb.cap, grows++;
+    }
+    big[0] = '\0';
+    for (int i = 0; i < DEMO_LINES; i++) strcat(big, lines[i]);
+    printf("  %d lines, %zu bytes; StrBuf grew %u times (first %d bytes inline)  %s\n\n", DEMO_LINES,
+           sb_len(&sb), grows, STRBUF_INLINE - 1, strcmp(sb_str(&sb), big) == 0 ? "✓" : "MISMATCH");
+
+    DEMO_BENCH("strcat x2000", 0,
+               big[0] = '\0'; for (int i = 0; i < DEMO_LINES; i++) strcat(big, lines[i]);
+               bench_escape(big));
+    DEMO_BENCH("sb_puts x2000", 0,
+               sb_clear(&sb); for (int i = 0; i < DEMO_LINES; i++) sb_puts(&sb, lines[i]);
+               bench_escape(sb.heap));
+    printf("\n");
+
+    /* strstr() needs a '\0' after what it searches, so a per-line
+     * search has to cut the text up first; ss_find() takes a length
+     * and runs over the whole buffer, a vector of starts at a time. */
+    const char *text = sb_str(&sb);
+    size_t      len  = sb_len(&sb);
+    size_t      by_line = 0, by_span = 0;
+    for (int i = 0; i < DEMO_LINES; i++) by_line += strstr(lines[i], "ERROR") != NULL;
+    for (const char *p = text, *end = text + len; (p = ss_find(p, (size_t)(end - p), "ERROR", 5)); p += 5)
+        by_span++;
+    printf("  Lines with \"ERROR\": %zu by strstr per line, %zu by ss_find  %s\n", by_line, by_span,
+           by_line == by_span ? "✓" : "MISMATCH");
+    printf("  Newlines counted by ss_count: %zu  (backend: %s)\n\n", ss_count(text, len, '\n'), ss_backend());
+
+    size_t n = 0;
+    DEMO_BENCH("strstr, per line", 0,
+               n = 0; for (int i = 0; i < DEMO_LINES; i++) n += strstr(lines[i], "ERROR") != NULL;
+               BENCH_OPAQUE(n));
+    DEMO_BENCH("ss_find, whole buffer", 0,
+               n = 0;
+               for (const char *p = text, *end = text + len; (p = ss_find(p, (size_t)(end - p), "ERROR", 5)); p += 5)
+                   n++;
+               BENCH_OPAQUE(n));
+    printf("\n");
+
+    /* Several needles: one strstr() pass each, or one pass that
+     * filters for every needle's first two bytes at once. */
+    const char *const needles[] = { "ERROR", "WARN" };
+    const size_t      lens[]    = { 5, 4 };
+    SsMulti          *m         = ss_multi_new(needles, lens, 2);
+    if (!m) {
+        perror("  ss_multi_new");
+        sb_free(&sb);
+        return;
+    }
+    size_t hits = 0, which;
+    for (const char *p = text, *end = text + len; (p = ss_multi_find(m, p, (size_t)(end - p), &which));
+         p += lens[which])
+        hits++;
+    printf("  \"ERROR\" or \"WARN\": %zu matches in one pass\n\n", hits);
+    DEMO_BENCH("strstr x2, per line", 0,
+               n = 0;
+               for (int i = 0; i < DEMO_LINES; i++)
+                   n += (strstr(lines[i], "ERROR") != NULL) + (strstr(lines[i], "WARN") != NULL);
+               BENCH_OPAQUE(n));
+    DEMO_BENCH("ss_multi_find, whole buffer", 0,
+               n = 0;
+               for (const char *p = text, *end = text + len; (p = ss_multi_find(m, p, (size_t)(end - p), &which));
+                    p += lens[which])
+                   n++;
+               BENCH_OPAQUE(n));
+    printf("\n");
+
+    ss_multi_free(m);
+    sb_free(&sb);
 }
 
 /* ════════════════════════════════════════════════════════════════
@@ -299,6 +416,7 @@ int main(void)
     demo_conversion();
     demo_formatting();
     demo_common_pitfalls();
+    demo_at_speed();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: C strings are just char arrays with '\\0'.\n");
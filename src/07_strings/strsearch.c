@@ -0,0 +1,550 @@
+/*
+ * Chapter 7 — Span scans and substring search (see strsearch.h)
+ *
+ * The vector code compares W bytes at once and turns the result into
+ * one bit per byte (ssv_mask), so finding the first hit is a ctz and
+ * counting them a popcount.  Short spans are the common case in text —
+ * a log line is a few dozen bytes — so ss_chr() and ss_count() do not
+ * finish byte by byte: the last partial block is read whole when that
+ * load stays inside the page it starts in, which cannot fault, and its
+ * bits past the span are masked off.  That reads bytes outside the
+ * span, so those functions (and ss_len, which reads from the aligned
+ * block below s) are not instrumented by AddressSanitizer.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strsearch.h"
+
+#if defined(__GNUC__)
+#define SS_NO_ASAN __attribute__((no_sanitize_address))
+#define ss_ctz(x)  ((size_t)__builtin_ctz(x))
+#else
+#define SS_NO_ASAN
+static size_t ss_ctz(uint32_t x)
+{
+    size_t n = 0;
+    while (!(x & 1)) x >>= 1, n++;
+    return n;
+}
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define SS_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SS_NEON
+#include <arm_neon.h>
+#endif
+
+#define SS_PAGE 4096
+#define SS_LOW(n) ((uint32_t)((1ull << (n)) - 1))   /* bits for bytes [0, n), n ≤ SS_W */
+
+/* A W-byte load at p touches only p's page */
+#define ss_in_page(p) (((uintptr_t)(p) & (SS_PAGE - 1)) <= SS_PAGE - SS_W)
+
+/* ════════════════════════════════════════════════════════════════
+ *  Two-way
+ *
+ *  The needle is cut at a critical factorization u·v — found as the
+ *  later of its maximal suffixes under < and under > — so that
+ *  comparing v left to right, then u right to left, a mismatch
+ *  always allows a shift that skips no match.  A periodic needle
+ *  remembers how much of its prefix the last shift kept matched,
+ *  which is what makes the whole search linear.
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Start of the maximal suffix of x (minus one, wrapping), and its period */
+static size_t max_suffix(const unsigned char *x, size_t m, int reverse, size_t *period)
+{
+    size_t ms = SIZE_MAX, j = 0, k = 1, p = 1;
+    while (j + k < m) {
+        unsigned char a = x[j + k], b = x[ms + k];
+        if (reverse ? a > b : a < b) {
+            j += k;
+            k  = 1;
+            p  = j - ms;
+        } else if (a == b) {
+            if (k != p) k++;
+            else {
+                j += p;
+                k  = 1;
+            }
+        } else {
+            ms = j++;
+            k  = p = 1;
+        }
+    }
+    *period = p;
+    return ms;
+}
+
+const char *ss_find_twoway(const char *h, size_t n, const char *needle, size_t m)
+{
+    const unsigned char *hay = (const unsigned char *)h;
+    const unsigned char *x   = (const unsigned char *)needle;
+    if (m == 0) return h;
+    if (m > n) return NULL;
+
+    size_t p1, p2;
+    size_t s1 = max_suffix(x, m, 0, &p1);
+    size_t s2 = max_suffix(x, m, 1, &p2);
+    size_t crit, period;
+    if (s1 + 1 > s2 + 1) crit = s1 + 1, period = p1;
+    else                 crit = s2 + 1, period = p2;
+
+    if (memcmp(x, x + period, crit) == 0) {
+        size_t memory = 0, j = 0;
+        while (j <= n - m) {
+            size_t i = crit > memory ? crit : memory;
+            while (i < m && x[i] == hay[i + j]) i++;
+            if (i >= m) {
+                i = crit - 1;
+                while (memory < i + 1 && x[i] == hay[i + j]) i--;
+                if (i + 1 < memory + 1) return h + j;
+                j     += period;
+                memory = m - period;
+            } else {
+                j     += i - crit + 1;
+                memory = 0;
+            }
+        }
+    } else {
+        period = (crit > m - crit ? crit : m - crit) + 1;
+        size_t j = 0;
+        while (j <= n - m) {
+            size_t i = crit;
+            while (i < m && x[i] == hay[i + j]) i++;
+            if (i >= m) {
+                i = crit - 1;
+                while (i != SIZE_MAX && x[i] == hay[i + j]) i--;
+                if (i == SIZE_MAX) return h + j;
+                j += period;
+            } else {
+                j += i - crit + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Several needles
+ *
+ *  With few needles, the filter of ss_find generalizes: a vector pass
+ *  marks where any needle's first two bytes are — one compare pair per
+ *  distinct prefix, up to SS_MULTI_PREFIXES of them — and each mark is
+ *  checked against the needles with that prefix, shortest first.
+ *  That is the idea of Teddy, Hyperscan's filter, which classifies
+ *  nibbles with byte shuffles to handle more prefixes at once; baseline
+ *  x86-64 has no byte shuffle, so plain compares do the job here.
+ *
+ *  Beyond that, an Aho–Corasick automaton.  The needles' bytes are
+ *  renumbered into classes — one per distinct byte, class 0 for every
+ *  byte in no needle — so it is a states × classes table, small enough
+ *  to stay in cache for dozens of needles.  Failure links are folded
+ *  into the table while it is built, breadth first, so scanning is one
+ *  lookup per byte with no backtracking.  Each entry holds its
+ *  target's row offset rather than its number, with SS_HIT set if a
+ *  needle ends there, so a step needs no multiply and the match test
+ *  no second load.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define SS_HIT 0x80000000u
+
+struct SsMulti {
+    size_t    count, shortest;
+    size_t   *lens;
+    /* the filter, if n_pre > 0 */
+    uint8_t   pre[SS_MULTI_PREFIXES][2];
+    int       n_pre;
+    size_t    pre_at[SS_MULTI_PREFIXES + 1];   /* by_pre[pre_at[p] .. pre_at[p + 1]) */
+    size_t   *by_pre;               /* needle numbers by prefix, shortest first */
+    char    **needle;               /* copies */
+    /* the automaton, otherwise */
+    uint16_t  cls[256];             /* up to 256 byte classes, and "other" */
+    uint32_t  n_cls;
+    uint32_t *next;                 /* row offset of the target | SS_HIT */
+    int32_t  *out;                  /* longest needle ending at each state, or -1 */
+};
+
+void ss_multi_free(SsMulti *m)
+{
+    if (!m) return;
+    if (m->needle)
+        for (size_t k = 0; k < m->count; k++) free(m->needle[k]);
+    free(m->needle);
+    free(m->by_pre);
+    free(m->next);
+    free(m->out);
+    free(m->lens);
+    free(m);
+}
+
+/* Group the needles by two-byte prefix; 0, or -1 if there are too many */
+static int multi_prefixes(SsMulti *m)
+{
+    int of[SS_MULTI_PREFIXES + 1] = { 0 };
+    for (size_t k = 0; k < m->count; k++) {
+        const uint8_t *s = (const uint8_t *)m->needle[k];
+        int            p = 0;
+        while (p < m->n_pre && !(m->pre[p][0] == s[0] && m->pre[p][1] == s[1])) p++;
+        if (p == m->n_pre) {
+            if (p == SS_MULTI_PREFIXES) return -1;
+            m->pre[p][0] = s[0];
+            m->pre[p][1] = s[1];
+            m->n_pre++;
+        }
+        of[p]++;
+    }
+    m->pre_at[0] = 0;
+    for (int p = 0; p < m->n_pre; p++) m->pre_at[p + 1] = m->pre_at[p] + (size_t)of[p];
+    size_t fill[SS_MULTI_PREFIXES];
+    memcpy(fill, m->pre_at, sizeof(fill));
+    for (size_t k = 0; k < m->count; k++) {
+        const uint8_t *s = (const uint8_t *)m->needle[k];
+        int            p = 0;
+        while (!(m->pre[p][0] == s[0] && m->pre[p][1] == s[1])) p++;
+        /* insertion by length, stable, so equal needles keep the first */
+        size_t g = fill[p]++;
+        while (g > m->pre_at[p] && m->lens[m->by_pre[g - 1]] > m->lens[k]) {
+            m->by_pre[g] = m->by_pre[g - 1];
+            g--;
+        }
+        m->by_pre[g] = k;
+    }
+    return 0;
+}
+
+static int multi_automaton(SsMulti *m)
+{
+    size_t total = 1;               /* states: the root and one per needle byte */
+    for (size_t k = 0; k < m->count; k++) total += m->lens[k];
+    m->n_cls = 1;
+    for (size_t k = 0; k < m->count; k++)
+        for (size_t i = 0; i < m->lens[k]; i++) {
+            uint8_t b = (uint8_t)m->needle[k][i];
+            if (!m->cls[b]) m->cls[b] = (uint16_t)m->n_cls++;
+        }
+    if (total * m->n_cls >= SS_HIT) {
+        errno = EINVAL;
+        return -1;
+    }
+    m->next = calloc(total * m->n_cls, sizeof(uint32_t));
+    m->out  = malloc(total * sizeof(int32_t));
+    if (!m->next || !m->out) return -1;
+    for (size_t q = 0; q < total; q++) m->out[q] = -1;
+
+    /* The trie, by state number: 0 is "no edge" for now, as nothing
+     * points back at the root */
+    uint32_t n_states = 1;
+    for (size_t k = 0; k < m->count; k++) {
+        uint32_t q = 0;
+        for (size_t i = 0; i < m->lens[k]; i++) {
+            uint32_t *e = &m->next[(size_t)q * m->n_cls + m->cls[(uint8_t)m->needle[k][i]]];
+            if (!*e) *e = n_states++;
+            q = *e;
+        }
+        if (m->out[q] < 0) m->out[q] = (int32_t)k;
+    }
+
+    /* Breadth first, every missing edge becomes its failure state's:
+     * a failure state is shallower, so its row is complete by then */
+    uint32_t *queue = malloc(n_states * sizeof(uint32_t));
+    uint32_t *fail  = malloc(n_states * sizeof(uint32_t));
+    if (!queue || !fail) {
+        free(queue);
+        free(fail);
+        return -1;
+    }
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < m->n_cls; c++) {
+        uint32_t t = m->next[c];
+        if (t) fail[t] = 0, queue[tail++] = t;
+    }
+    while (head < tail) {
+        uint32_t        q   = queue[head++];
+        uint32_t       *row = &m->next[(size_t)q * m->n_cls];
+        const uint32_t *fr  = &m->next[(size_t)fail[q] * m->n_cls];
+        if (m->out[q] < 0) m->out[q] = m->out[fail[q]];
+        for (uint32_t c = 0; c < m->n_cls; c++) {
+            if (row[c]) fail[row[c]] = fr[c], queue[tail++] = row[c];
+            else        row[c] = fr[c];
+        }
+    }
+    free(queue);
+    free(fail);
+
+    for (size_t e = 0; e < (size_t)n_states * m->n_cls; e++) {
+        uint32_t t = m->next[e];
+        m->next[e] = t * m->n_cls | (m->out[t] >= 0 ? SS_HIT : 0);
+    }
+    return 0;
+}
+
+SsMulti *ss_multi_new(const char *const *needles, const size_t *lens, size_t count)
+{
+    if (count == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (lens[k] == 0 || lens[k] > INT32_MAX - total) {
+            errno = EINVAL;
+            return NULL;
+        }
+        total += lens[k];
+    }
+
+    SsMulti *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    m->count    = count;
+    m->shortest = SIZE_MAX;
+    m->lens     = malloc(count * sizeof(size_t));
+    m->needle   = calloc(count, sizeof(char *));
+    m->by_pre   = malloc(count * sizeof(size_t));
+    if (!m->lens || !m->needle || !m->by_pre) goto nomem;
+    for (size_t k = 0; k < count; k++) {
+        if (!(m->needle[k] = malloc(lens[k]))) goto nomem;
+        memcpy(m->needle[k], needles[k], lens[k]);
+        m->lens[k] = lens[k];
+        if (lens[k] < m->shortest) m->shortest = lens[k];
+    }
+
+    if (m->shortest >= 2 && multi_prefixes(m) == 0) return m;
+    m->n_pre = 0;
+    if (multi_automaton(m) == 0) return m;
+    if (errno == EINVAL) {
+        ss_multi_free(m);
+        return NULL;
+    }
+nomem:
+    ss_multi_free(m);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/* Whether the candidate at j ends the search: a needle starting there
+ * or later cannot end before the best so far.  Else the shortest
+ * needle at j, if it does end earlier, becomes the best. */
+static int multi_candidate(const SsMulti *m, const char *h, size_t n, size_t j, size_t *best_end, size_t *best)
+{
+    if (j + m->shortest >= *best_end) return 1;
+    for (int p = 0; p < m->n_pre; p++) {
+        if ((uint8_t)h[j] != m->pre[p][0] || (uint8_t)h[j + 1] != m->pre[p][1]) continue;
+        for (size_t g = m->pre_at[p]; g < m->pre_at[p + 1]; g++) {
+            size_t k = m->by_pre[g], len = m->lens[k];
+            if (len > n - j || j + len >= *best_end) break;
+            if (memcmp(h + j + 2, m->needle[k] + 2, len - 2) == 0) {
+                *best_end = j + len;
+                *best     = k;
+                break;
+            }
+        }
+        break;
+    }
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Vector kernels
+ *
+ *  strsearch_simd.h has ss_len, ss_chr, ss_count, ss_find and the
+ *  multi-needle filter written once over W-byte operations.  Each
+ *  build of it below is one instruction set; on x86 that is SSE2,
+ *  which every x86-64 has, and AVX2 for CPUs that have it, chosen at
+ *  run time as in reduce.c.
+ * ════════════════════════════════════════════════════════════════ */
+
+#ifdef SS_X86
+/* SSE2: 16 bytes */
+#define SS_W 16
+#define SS_KERNEL
+#define SS_NAME(f) sse2_##f
+#define ss_vec         __m128i
+#define ssv_load(p)    _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define ssv_splat(c)   _mm_set1_epi8((char)(c))
+#define ssv_zero()     _mm_setzero_si128()
+#define ssv_eq(a, b)   _mm_cmpeq_epi8((a), (b))
+#define ssv_and(a, b)  _mm_and_si128((a), (b))
+#define ssv_or(a, b)   _mm_or_si128((a), (b))
+#define ssv_sub(a, b)  _mm_sub_epi8((a), (b))
+#define ssv_mask(v)    ((uint32_t)_mm_movemask_epi8(v))
+#define ssv_sum_bytes  sse2_sum_bytes
+static inline size_t sse2_sum_bytes(__m128i v)
+{
+    __m128i s = _mm_sad_epu8(v, _mm_setzero_si128());
+    return (size_t)_mm_cvtsi128_si32(s) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+}
+#include "strsearch_simd.h"
+
+/* AVX2: 32 bytes */
+#define AVX2 __attribute__((target("avx2")))
+#define SS_W 32
+#define SS_KERNEL AVX2
+#define SS_NAME(f) avx2_##f
+#define ss_vec         __m256i
+#define ssv_load(p)    _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define ssv_splat(c)   _mm256_set1_epi8((char)(c))
+#define ssv_zero()     _mm256_setzero_si256()
+#define ssv_eq(a, b)   _mm256_cmpeq_epi8((a), (b))
+#define ssv_and(a, b)  _mm256_and_si256((a), (b))
+#define ssv_or(a, b)   _mm256_or_si256((a), (b))
+#define ssv_sub(a, b)  _mm256_sub_epi8((a), (b))
+#define ssv_mask(v)    ((uint32_t)_mm256_movemask_epi8(v))
+#define ssv_sum_bytes  avx2_sum_bytes
+AVX2 static inline size_t avx2_sum_bytes(__m256i v)
+{
+    __m256i s = _mm256_sad_epu8(v, _mm256_setzero_si256());
+    return (size_t)_mm256_extract_epi64(s, 0) + (size_t)_mm256_extract_epi64(s, 1) +
+           (size_t)_mm256_extract_epi64(s, 2) + (size_t)_mm256_extract_epi64(s, 3);
+}
+#include "strsearch_simd.h"
+#endif /* SS_X86 */
+
+#ifdef SS_NEON
+/* NEON: 16 bytes */
+#define SS_W 16
+#define SS_KERNEL
+#define SS_NAME(f) neon_##f
+#define ss_vec         uint8x16_t
+#define ssv_load(p)    vld1q_u8((const uint8_t *)(const void *)(p))
+#define ssv_splat(c)   vdupq_n_u8((uint8_t)(c))
+#define ssv_zero()     vdupq_n_u8(0)
+#define ssv_eq(a, b)   vceqq_u8((a), (b))
+#define ssv_and(a, b)  vandq_u8((a), (b))
+#define ssv_or(a, b)   vorrq_u8((a), (b))
+#define ssv_sub(a, b)  vsubq_u8((a), (b))
+#define ssv_mask       neon_mask
+#define ssv_sum_bytes(v) ((size_t)vaddlvq_u8(v))
+static inline uint32_t neon_mask(uint8x16_t v)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t m = vandq_u8(v, vld1q_u8(weights));
+    return (uint32_t)vaddv_u8(vget_low_u8(m)) |
+           ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+}
+#include "strsearch_simd.h"
+#endif /* SS_NEON */
+
+#if !defined(SS_X86) && !defined(SS_NEON)
+/* No vectors: the byte loops alone */
+#define SS_KERNEL
+#define SS_NAME(f) scalar_##f
+#include "strsearch_simd.h"
+#endif
+
+/* ════════════════════════════════════════════════════════════════
+ *  Dispatch
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *name;
+    int         avx2;           /* needs a CPU with AVX2 */
+    size_t      (*len)(const char *s);
+    const char *(*chr)(const char *p, size_t n, int c);
+    size_t      (*count)(const char *p, size_t n, int c);
+    const char *(*find)(const char *h, size_t n, const char *needle, size_t m);
+    const char *(*multi_filter)(const SsMulti *m, const char *h, size_t n, size_t *which);
+} SsKernels;
+
+static const SsKernels ss_sets[] = {
+#ifdef SS_X86
+    { "AVX2", 1, avx2_len, avx2_chr, avx2_count, avx2_find, avx2_multi_filter },
+    { "SSE2", 0, sse2_len, sse2_chr, sse2_count, sse2_find, sse2_multi_filter },
+#elif defined(SS_NEON)
+    { "NEON", 0, neon_len, neon_chr, neon_count, neon_find, neon_multi_filter },
+#else
+    { "scalar", 0, scalar_len, scalar_chr, scalar_count, scalar_find, scalar_multi_filter },
+#endif
+};
+
+#define SS_SETS (sizeof ss_sets / sizeof ss_sets[0])
+
+static const SsKernels *ss_current;
+
+static int ss_supported(const SsKernels *k)
+{
+#ifdef SS_X86
+    __builtin_cpu_init();
+    if (k->avx2) return __builtin_cpu_supports("avx2");
+#endif
+    return 1;
+}
+
+/* The first set, best first, that this CPU runs */
+static const SsKernels *ss_kernels(void)
+{
+    const SsKernels *k = __atomic_load_n(&ss_current, __ATOMIC_ACQUIRE);
+    if (!k) {
+        k = &ss_sets[0];        /* racing threads choose the same one */
+        while (!ss_supported(k)) k++;
+        __atomic_store_n(&ss_current, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *ss_backend(void)
+{
+    return ss_kernels()->name;
+}
+
+int ss_set_backend(const char *name)
+{
+    for (size_t i = 0; i < SS_SETS; i++) {
+        if (strcmp(ss_sets[i].name, name) != 0) continue;
+        if (!ss_supported(&ss_sets[i])) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        __atomic_store_n(&ss_current, &ss_sets[i], __ATOMIC_RELEASE);
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+size_t ss_len(const char *s)
+{
+    return ss_kernels()->len(s);
+}
+
+const char *ss_chr(const char *p, size_t n, int c)
+{
+    return ss_kernels()->chr(p, n, c);
+}
+
+size_t ss_count(const char *p, size_t n, int c)
+{
+    return ss_kernels()->count(p, n, c);
+}
+
+const char *ss_find(const char *h, size_t n, const char *needle, size_t m)
+{
+    return ss_kernels()->find(h, n, needle, m);
+}
+
+const char *ss_multi_find(const SsMulti *m, const char *h, size_t n, size_t *which)
+{
+    if (m->n_pre) return ss_kernels()->multi_filter(m, h, n, which);
+
+    const unsigned char *s    = (const unsigned char *)h;
+    const uint32_t      *next = m->next;
+    const uint16_t      *cls  = m->cls;
+    uint32_t             row  = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t t = next[row + cls[s[i]]];
+        row = t & ~SS_HIT;
+        if (t & SS_HIT) {
+            size_t k = (size_t)m->out[row / m->n_cls];
+            if (which) *which = k;
+            return h + i + 1 - m->lens[k];
+        }
+    }
+    return NULL;
+}
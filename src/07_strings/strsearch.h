@@ -0,0 +1,62 @@
+/*
+ * Chapter 7 — Searching spans of bytes, a block of bytes at a time
+ *
+ * Everything here takes (pointer, length) but ss_len(): nothing needs
+ * a '\0', so the same calls search a line in the middle of a buffer
+ * read() or mmap()ed, where strchr() and strstr() cannot stop in time.
+ *
+ *   ss_len        strlen(): the first zero byte, one vector at a time
+ *   ss_chr        memchr(): the first byte equal to c
+ *   ss_count      how many bytes equal c (newlines, say)
+ *   ss_find       memmem(): a vector compares needle[0] and needle[m-1]
+ *                 at W starting positions at once, and only positions
+ *                 where both match are compared in full.  If that
+ *                 verification starts to cost more than the scan —
+ *                 "aa…ba…a" in "aaaa…" — the rest goes to ss_find_twoway
+ *   ss_find_twoway  Crochemore–Perrin two-way: O(n + m) time, O(1)
+ *                 space, for any needle and haystack
+ *   SsMulti       several needles in one pass.  If they start with at
+ *                 most SS_MULTI_PREFIXES distinct two-byte prefixes, a
+ *                 vector filter finds where any of them is and only
+ *                 those places are compared (Teddy's approach); other
+ *                 sets run through an Aho–Corasick automaton
+ *
+ * W is 32 bytes with AVX2, 16 with SSE2 or NEON.  An x86 build has
+ * both AVX2 and SSE2 code and takes AVX2 if the CPU has it, on the
+ * first call; ss_backend() names the one in use, and ss_set_backend()
+ * switches to another available one, to compare them.
+ */
+
+#ifndef STRSEARCH_H
+#define STRSEARCH_H
+
+#include <stddef.h>
+
+const char *ss_backend(void);           /* "AVX2", "SSE2", "NEON" or "scalar" */
+
+/* 0, or -1 with errno: EINVAL for a name not built, ENOTSUP if this
+ * CPU cannot run it.  Not to be called while other threads search */
+int         ss_set_backend(const char *name);
+
+size_t      ss_len(const char *s);
+const char *ss_chr(const char *p, size_t n, int c);
+size_t      ss_count(const char *p, size_t n, int c);
+
+/* The first m-byte needle in h[0..n), or NULL; m == 0 matches at h */
+const char *ss_find(const char *h, size_t n, const char *needle, size_t m);
+const char *ss_find_twoway(const char *h, size_t n, const char *needle, size_t m);
+
+#define SS_MULTI_PREFIXES 8
+
+typedef struct SsMulti SsMulti;
+
+/* An automaton for count non-empty needles; NULL with errno (EINVAL
+ * for an empty needle, ENOMEM) */
+SsMulti    *ss_multi_new(const char *const *needles, const size_t *lens, size_t count);
+void        ss_multi_free(SsMulti *m);
+
+/* The match in h[0..n) that ends first — the longest of those ending
+ * at the same byte — or NULL; *which is its needle's index */
+const char *ss_multi_find(const SsMulti *m, const char *h, size_t n, size_t *which);
+
+#endif /* STRSEARCH_H */
@@ -0,0 +1,178 @@
+/*
+ * Chapter 7 — The vector half of strsearch.c
+ *
+ * Not a header for other files: strsearch.c includes it once for each
+ * instruction set it builds, having defined
+ *
+ *   SS_W          bytes per vector, or nothing for the scalar copy
+ *   ss_vec, ssv_* the vector type and operations on it
+ *   SS_KERNEL     the attribute that lets a copy use its instructions
+ *   SS_NAME(f)    what function f is called in this copy
+ *
+ * and it undefines them again at the end, ready for the next set.
+ */
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scans
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Aligned loads never cross a page, so reading up to (not past) the
+ * block holding the terminator is safe wherever the string ends */
+SS_KERNEL SS_NO_ASAN static size_t SS_NAME(len)(const char *s)
+{
+#ifdef SS_W
+    const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)(SS_W - 1));
+    uint32_t    z = ssv_mask(ssv_eq(ssv_load(p), ssv_zero())) >> (s - p);
+    if (z) return ss_ctz(z);
+    for (;;) {
+        p += SS_W;
+        z = ssv_mask(ssv_eq(ssv_load(p), ssv_zero()));
+        if (z) return (size_t)(p - s) + ss_ctz(z);
+    }
+#else
+    const char *p = s;
+    while (*p) p++;
+    return (size_t)(p - s);
+#endif
+}
+
+SS_KERNEL SS_NO_ASAN static const char *SS_NAME(chr)(const char *p, size_t n, int c)
+{
+    size_t i = 0;
+#ifdef SS_W
+    ss_vec v = ssv_splat(c);
+    for (; i + SS_W <= n; i += SS_W) {
+        uint32_t m = ssv_mask(ssv_eq(ssv_load(p + i), v));
+        if (m) return p + i + ss_ctz(m);
+    }
+    if (i == n) return NULL;
+    if (n >= SS_W) {                    /* the last W bytes, overlapping */
+        uint32_t m = ssv_mask(ssv_eq(ssv_load(p + n - SS_W), v)) >> (i - (n - SS_W));
+        return m ? p + i + ss_ctz(m) : NULL;
+    }
+    if (ss_in_page(p)) {
+        uint32_t m = ssv_mask(ssv_eq(ssv_load(p), v)) & SS_LOW(n);
+        return m ? p + ss_ctz(m) : NULL;
+    }
+#endif
+    for (; i < n; i++)
+        if ((unsigned char)p[i] == (unsigned char)c) return p + i;
+    return NULL;
+}
+
+SS_KERNEL SS_NO_ASAN static size_t SS_NAME(count)(const char *p, size_t n, int c)
+{
+    size_t i = 0, total = 0;
+#ifdef SS_W
+    ss_vec v = ssv_splat(c);
+    /* Each match subtracts -1 from its byte lane; a lane can take 255 */
+    while (i + SS_W <= n) {
+        ss_vec acc    = ssv_zero();
+        size_t blocks = (n - i) / SS_W;
+        if (blocks > 255) blocks = 255;
+        for (size_t b = 0; b < blocks; b++, i += SS_W)
+            acc = ssv_sub(acc, ssv_eq(ssv_load(p + i), v));
+        total += ssv_sum_bytes(acc);
+    }
+    if (i == n) return total;
+    if (n >= SS_W || ss_in_page(p)) {
+        size_t   base = n >= SS_W ? n - SS_W : 0;
+        uint32_t m    = ssv_mask(ssv_eq(ssv_load(p + base), v)) >> (i - base);
+        m &= SS_LOW(n - i);
+        total += (size_t)__builtin_popcount(m);
+        return total;
+    }
+#endif
+    for (; i < n; i++) total += (unsigned char)p[i] == (unsigned char)c;
+    return total;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  First/last-byte filter
+ * ════════════════════════════════════════════════════════════════ */
+
+SS_KERNEL static const char *SS_NAME(find)(const char *h, size_t n, const char *needle, size_t m)
+{
+    if (m == 0) return h;
+    if (m > n) return NULL;
+    if (m == 1) return SS_NAME(chr)(h, n, needle[0]);
+
+    size_t i = 0, end = n - m + 1;      /* candidate starts are [0, end) */
+#ifdef SS_W
+    ss_vec first = ssv_splat(needle[0]), last = ssv_splat(needle[m - 1]);
+    size_t spent = 0;                   /* bytes charged to verification */
+    for (; i + SS_W <= end; i += SS_W) {
+        uint32_t c = ssv_mask(ssv_and(ssv_eq(ssv_load(h + i), first),
+                                      ssv_eq(ssv_load(h + i + m - 1), last)));
+        for (; c; c &= c - 1) {
+            size_t j = i + ss_ctz(c);
+            if (memcmp(h + j + 1, needle + 1, m - 2) == 0) return h + j;
+            spent += m;
+        }
+        /* Linear either way: hand over once verifying outweighs scanning */
+        if (spent > 2 * i + 16 * m)
+            return ss_find_twoway(h + i + SS_W, n - i - SS_W, needle, m);
+    }
+    if (i < end && end >= SS_W) {       /* the last W starts, overlapping */
+        size_t   b = end - SS_W;
+        uint32_t c = ssv_mask(ssv_and(ssv_eq(ssv_load(h + b), first),
+                                      ssv_eq(ssv_load(h + b + m - 1), last))) >> (i - b);
+        for (; c; c &= c - 1) {
+            size_t j = i + ss_ctz(c);
+            if (memcmp(h + j + 1, needle + 1, m - 2) == 0) return h + j;
+        }
+        return NULL;
+    }
+#endif
+    for (; i < end; i++)
+        if (h[i] == needle[0] && h[i + m - 1] == needle[m - 1] &&
+            memcmp(h + i + 1, needle + 1, m - 2) == 0)
+            return h + i;
+    return NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Several needles: the prefix filter
+ * ════════════════════════════════════════════════════════════════ */
+
+SS_KERNEL static const char *SS_NAME(multi_filter)(const SsMulti *m, const char *h, size_t n,
+                                                  size_t *which)
+{
+    size_t best_end = SIZE_MAX, best = 0, i = 0;
+    if (n < m->shortest) return NULL;
+    size_t end = n - 1;             /* candidate starts are [0, end) */
+#ifdef SS_W
+    ss_vec a[SS_MULTI_PREFIXES], b[SS_MULTI_PREFIXES];
+    for (int p = 0; p < m->n_pre; p++) a[p] = ssv_splat(m->pre[p][0]), b[p] = ssv_splat(m->pre[p][1]);
+    for (; i < end && i + m->shortest < best_end; i += SS_W) {
+        size_t at = i + SS_W <= end ? i : end - SS_W;      /* the last W overlap */
+        if (at > i) break;                                  /* end < W */
+        ss_vec v0 = ssv_load(h + at), v1 = ssv_load(h + at + 1);
+        ss_vec hit = ssv_and(ssv_eq(v0, a[0]), ssv_eq(v1, b[0]));
+        for (int p = 1; p < m->n_pre; p++)
+            hit = ssv_or(hit, ssv_and(ssv_eq(v0, a[p]), ssv_eq(v1, b[p])));
+        for (uint32_t bits = ssv_mask(hit) >> (i - at); bits; bits &= bits - 1)
+            if (multi_candidate(m, h, n, i + ss_ctz(bits), &best_end, &best)) goto done;
+    }
+#endif
+    for (; i < end; i++)
+        if (multi_candidate(m, h, n, i, &best_end, &best)) break;
+done:
+    if (best_end == SIZE_MAX) return NULL;
+    if (which) *which = best;
+    return h + best_end - m->lens[best];
+}
+
+#undef SS_W
+#undef SS_KERNEL
+#undef SS_NAME
+#undef ss_vec
+#undef ssv_load
+#undef ssv_splat
+#undef ssv_zero
+#undef ssv_eq
+#undef ssv_and
+#undef ssv_or
+#undef ssv_sub
+#undef ssv_mask
+#undef ssv_sum_bytes
@@ -9,7 +9,8 @@
  *   5. Enums — named constants, explicit values, flags pattern
  *   6. Bit-fields — packing bits, hardware register simulation
  *   7. Alignment & padding — sizeof surprises, packed attribute
- *   8. Linked list — practical application of struct + pointers
+ *   8. Linked list — practical application of struct + pointers,
+ *      with nodes from malloc and from a pool allocator (arena.h)
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/08_structures \
  *            src/08_structures/structures.c
@@ -23,6 +24,7 @@
  */
 
 #include "../../include/common.h"
+#include "../../include/arena.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: Basic Structs
@@ -354,6 +356,25 @@ static void list_free(Node *head)
     }
 }
 
+/* Same list, nodes from a Pool: O(1) push/pop, no per-node malloc   */
+static Node *list_push_pool(Pool *pool, Node *head, int value)
+{
+    Node *new_node = pool_alloc(pool);
+    if (!new_node) { perror("pool_alloc"); return head; }
+    new_node->data = value;
+    new_node->next = head;
+    return new_node;
+}
+
+/* Unlink the head and hand its memory back to the pool's free list  */
+static Node *list_pop_pool(Pool *pool, Node *head)
+{
+    if (!head) return NULL;
+    Node *next = head->next;
+    pool_free(pool, head);
+    return next;
+}
+
 static void demo_linked_list(void)
 {
     printf("╔══════════════════════════════════════════════════════╗\n");
@@ -373,6 +394,25 @@ static void demo_linked_list(void)
     printf("  Must free every node or you leak memory.\n\n");
 
     list_free(list);           /* clean up all nodes                 */
+
+    /* ── Pool-backed list ── */
+    Pool pool;
+    POOL_INIT_FOR(&pool, Node, 1024);          /* 1024 nodes per block  */
+
+    Node *big = NULL;
+    for (int i = 0; i < 10000; i++) big = list_push_pool(&pool, big, i);
+    for (int i = 0; i < 5000; i++)  big = list_pop_pool(&pool, big);
+    for (int i = 0; i < 5000; i++)  big = list_push_pool(&pool, big, -i);
+
+    printf("  Pool-backed list: 10000 pushes, 5000 pops, 5000 pushes\n");
+    printf("    live nodes: %zu, arena blocks: %zu (popped nodes were reused)\n",
+           pool.live, pool.arena.blocks);
+    printf("    teardown: pool_destroy() frees %zu blocks — no walk over\n",
+           pool.arena.blocks);
+    printf("    the %zu nodes, so it costs O(1) per block, not per node.\n\n",
+           pool.live);
+
+    pool_destroy(&pool);
 }
 
 /* ════════════════════════════════════════════════════════════════
@@ -0,0 +1,464 @@
+/*
+ * Slab allocator benchmark — slab.c vs glibc malloc, small objects
+ *
+ * Two workloads, each run under both allocators on --threads threads:
+ *
+ *   prodcons   half the threads allocate objects of 16-256 bytes and
+ *              pass them, 64 at a time, through a bounded queue (the
+ *              mutex and two condition variables of chapter 14's
+ *              producer/consumer) to the other half, which free them:
+ *              every free is a cross-thread free
+ *   random     each thread keeps --live objects and replaces a random
+ *              one per step with a new object of a random size (three
+ *              in four ≤128 bytes, the rest up to 1 KB): frees are
+ *              local, sizes mixed, the heap stays full
+ *
+ * Every object carries a tag written at allocation and checked before
+ * the free.  Each run happens in a forked child, so both allocators
+ * start from a fresh process; it reports throughput (allocations plus
+ * frees per second), peak RSS above the child's starting RSS, the peak
+ * bytes the workload held live, and the overhead between the two —
+ * headers, size-class rounding, caches and fragmentation together.
+ * The run with the median throughput of --reps is the one reported.
+ *
+ * Build: make bench_slab
+ * Run:   ./bin/bench_slab [--threads N] [--ops N] [--live N] [--reps R]
+ *                         [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../../include/bench.h"
+#include "slab.h"
+
+typedef struct {
+    const char *name;
+    void     *(*alloc)(size_t);
+    void      (*free)(void *);
+} Allocator;
+
+static void *glibc_alloc(size_t n) { return malloc(n); }
+static void  glibc_free(void *p)   { free(p); }
+
+static const Allocator allocators[] = {
+    { "glibc", glibc_alloc, glibc_free },
+    { "slab",  slab_alloc,  slab_free },
+};
+#define ALLOCATOR_COUNT ((int)(sizeof(allocators) / sizeof(allocators[0])))
+
+static const char *workloads[] = { "prodcons", "random" };
+#define WORKLOAD_COUNT 2
+
+typedef struct {
+    int      threads;
+    uint64_t ops;           /* per thread */
+    size_t   live;          /* random: objects per thread */
+} Params;
+
+typedef struct {
+    uint64_t ops, ns;
+    uint64_t rss_bytes, live_bytes;
+    uint64_t errors;
+} Result;
+
+static uint32_t xorshift32(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+/* The first and last byte of an object hold its size's low byte */
+static void tag(void *p, size_t size)
+{
+    ((unsigned char *)p)[0]        = (unsigned char)size;
+    ((unsigned char *)p)[size - 1] = (unsigned char)size;
+}
+
+static int tag_ok(const void *p, size_t size)
+{
+    return ((const unsigned char *)p)[0] == (unsigned char)size &&
+           ((const unsigned char *)p)[size - 1] == (unsigned char)size;
+}
+
+static void max_u64(uint64_t *slot, uint64_t v)
+{
+    uint64_t cur = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (v > cur && !__atomic_compare_exchange_n(slot, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  prodcons: a bounded queue of batches, as in chapter 14
+ * ════════════════════════════════════════════════════════════════ */
+
+#define BATCH     64
+#define QUEUE_CAP 16
+
+typedef struct {
+    void    *p[BATCH];
+    uint32_t size[BATCH];
+} Batch;
+
+typedef struct {
+    const Allocator *a;
+    uint64_t         per_producer;
+    Batch            queue[QUEUE_CAP];
+    int              head, count, producers_left;
+    pthread_mutex_t  lock;
+    pthread_cond_t   not_empty, not_full;
+    uint64_t         live, peak, errors;
+} Queue;
+
+static void *producer(void *arg)
+{
+    Queue   *q   = arg;
+    uint32_t rng = (uint32_t)(uintptr_t)&rng | 1;
+    Batch    b;
+    for (uint64_t done = 0; done < q->per_producer; done += BATCH) {
+        uint64_t bytes = 0;
+        for (int i = 0; i < BATCH; i++) {
+            size_t size = 16 + xorshift32(&rng) % 241;
+            b.p[i]      = q->a->alloc(size);
+            b.size[i]   = (uint32_t)size;
+            if (b.p[i]) tag(b.p[i], size);
+            bytes += size;
+        }
+        max_u64(&q->peak, __atomic_add_fetch(&q->live, bytes, __ATOMIC_RELAXED));
+
+        pthread_mutex_lock(&q->lock);
+        while (q->count == QUEUE_CAP) pthread_cond_wait(&q->not_full, &q->lock);
+        q->queue[(q->head + q->count) % QUEUE_CAP] = b;
+        q->count++;
+        pthread_cond_signal(&q->not_empty);
+        pthread_mutex_unlock(&q->lock);
+    }
+    pthread_mutex_lock(&q->lock);
+    q->producers_left--;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    Queue   *q = arg;
+    Batch    b;
+    uint64_t errors = 0;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && q->producers_left > 0) pthread_cond_wait(&q->not_empty, &q->lock);
+        if (q->count == 0) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        b       = q->queue[q->head];
+        q->head = (q->head + 1) % QUEUE_CAP;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->lock);
+
+        uint64_t bytes = 0;
+        for (int i = 0; i < BATCH; i++) {
+            if (!b.p[i] || !tag_ok(b.p[i], b.size[i])) errors++;
+            q->a->free(b.p[i]);
+            bytes += b.size[i];
+        }
+        __atomic_sub_fetch(&q->live, bytes, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&q->errors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void run_prodcons(const Allocator *a, const Params *p, Result *r)
+{
+    int producers = p->threads / 2 > 0 ? p->threads / 2 : 1;
+    int consumers = p->threads - producers > 0 ? p->threads - producers : 1;
+
+    static Queue q;
+    memset(&q, 0, sizeof(q));
+    q.a              = a;
+    q.per_producer   = (p->ops + BATCH - 1) / BATCH * BATCH;
+    q.producers_left = producers;
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.not_empty, NULL);
+    pthread_cond_init(&q.not_full, NULL);
+
+    pthread_t tids[2 * 256];
+    uint64_t  t0 = bench_now_ns();
+    for (int i = 0; i < producers; i++) pthread_create(&tids[i], NULL, producer, &q);
+    for (int i = 0; i < consumers; i++) pthread_create(&tids[producers + i], NULL, consumer, &q);
+    for (int i = 0; i < producers + consumers; i++) pthread_join(tids[i], NULL);
+    r->ns = bench_now_ns() - t0;
+
+    r->ops        = 2 * q.per_producer * (uint64_t)producers;
+    r->live_bytes = q.peak;
+    r->errors     = q.errors;
+    pthread_mutex_destroy(&q.lock);
+    pthread_cond_destroy(&q.not_empty);
+    pthread_cond_destroy(&q.not_full);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  random: a full working set, random sizes, local frees
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const Allocator *a;
+    const Params    *p;
+    uint32_t         seed;
+    uint64_t         peak, errors;
+} RandomJob;
+
+static size_t random_size(uint32_t *rng)
+{
+    uint32_t r = xorshift32(rng);
+    if (r % 4 != 0) return 16 + (r >> 8) % 113;        /* 16-128 */
+    return 129 + (r >> 8) % 896;                        /* 129-1024 */
+}
+
+static void *random_worker(void *arg)
+{
+    RandomJob *j = arg;
+    size_t     n = j->p->live;
+    void     **slot = malloc(n * sizeof(*slot));
+    uint32_t  *size = malloc(n * sizeof(*size));
+    if (!slot || !size) {
+        free(slot);
+        free(size);
+        j->errors++;
+        return NULL;
+    }
+
+    uint32_t rng  = j->seed;
+    uint64_t live = 0;
+    for (size_t i = 0; i < n; i++) {
+        size[i] = (uint32_t)random_size(&rng);
+        slot[i] = j->a->alloc(size[i]);
+        if (slot[i]) tag(slot[i], size[i]);
+        live += size[i];
+    }
+    j->peak = live;
+    for (uint64_t k = 0; k < j->p->ops; k++) {
+        size_t i = xorshift32(&rng) % n;
+        if (!slot[i] || !tag_ok(slot[i], size[i])) j->errors++;
+        j->a->free(slot[i]);
+        live -= size[i];
+        size[i] = (uint32_t)random_size(&rng);
+        slot[i] = j->a->alloc(size[i]);
+        if (slot[i]) tag(slot[i], size[i]);
+        live += size[i];
+        if (live > j->peak) j->peak = live;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!slot[i] || !tag_ok(slot[i], size[i])) j->errors++;
+        j->a->free(slot[i]);
+    }
+    free(slot);
+    free(size);
+    return NULL;
+}
+
+static void run_random(const Allocator *a, const Params *p, Result *r)
+{
+    pthread_t tids[256];
+    RandomJob jobs[256];
+    uint64_t  t0 = bench_now_ns();
+    for (int i = 0; i < p->threads; i++) {
+        jobs[i] = (RandomJob){ a, p, 0x9e3779b9u * (uint32_t)(i + 1), 0, 0 };
+        pthread_create(&tids[i], NULL, random_worker, &jobs[i]);
+    }
+    r->live_bytes = 0;
+    r->errors     = 0;
+    for (int i = 0; i < p->threads; i++) {
+        pthread_join(tids[i], NULL);
+        r->live_bytes += jobs[i].peak;
+        r->errors += jobs[i].errors;
+    }
+    r->ns = bench_now_ns() - t0;
+    /* The initial fill, then a free and an alloc per step, then the teardown */
+    r->ops = (uint64_t)p->threads * (2 * p->ops + 2 * p->live);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  One run, in a child process
+ * ════════════════════════════════════════════════════════════════ */
+
+/* A field of /proc/self/status, in bytes ("VmRSS:", "VmHWM:") */
+static uint64_t proc_status_kb(const char *field)
+{
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char     line[256];
+    uint64_t kb = 0;
+    size_t   n  = strlen(field);
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, field, n) == 0) {
+            kb = strtoull(line + n, NULL, 10);
+            break;
+        }
+    fclose(f);
+    return kb * 1024;
+}
+
+static int run_child(int alloc, int workload, const Params *p, Result *out)
+{
+    int fd[2];
+    if (pipe(fd) != 0) return -1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fd[0]);
+        Result   r;
+        uint64_t base = proc_status_kb("VmRSS:");
+        memset(&r, 0, sizeof(r));
+        if (workload == 0) run_prodcons(&allocators[alloc], p, &r);
+        else run_random(&allocators[alloc], p, &r);
+        uint64_t hwm = proc_status_kb("VmHWM:");
+        r.rss_bytes  = hwm > base ? hwm - base : 0;
+        ssize_t w    = write(fd[1], &r, sizeof(r));
+        _exit(w == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t got = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return got == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    Params         p;
+    int            reps;
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--threads N] [--ops N] [--live N] [--reps R] [--format text|csv|json]\n",
+            argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            cfg->p.threads = atoi(val);
+        } else if (strcmp(opt, "--ops") == 0) {
+            cfg->p.ops = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--live") == 0) {
+            cfg->p.live = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->p.threads >= 1 && cfg->p.threads <= 256 && cfg->p.ops >= 1 && cfg->p.live >= 1 &&
+                   cfg->reps >= 1
+               ? 0
+               : -1;
+}
+
+static double mops(const Result *r)
+{
+    return r->ns ? (double)r->ops * 1e3 / (double)r->ns : 0.0;
+}
+
+static int by_mops(const void *a, const void *b)
+{
+    double x = mops(a), y = mops(b);
+    return (x > y) - (x < y);
+}
+
+static void report(const Config *cfg, int w, int a, const Result *r, int *first)
+{
+    double rss      = (double)r->rss_bytes / (1 << 20);
+    double live     = (double)r->live_bytes / (1 << 20);
+    double overhead = r->rss_bytes ? 100.0 * (1.0 - (double)r->live_bytes / (double)r->rss_bytes) : 0.0;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-9s %-6s %9.2f %12.1f %12.1f %9.1f%%%s\n", workloads[w], allocators[a].name, mops(r), rss,
+               live, overhead, r->errors ? "  TAG ERRORS" : "");
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%d,%.3f,%.2f,%.2f,%.1f,%llu\n", workloads[w], allocators[a].name, cfg->p.threads,
+               mops(r), rss, live, overhead, (unsigned long long)r->errors);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"workload\": \"%s\", \"allocator\": \"%s\", \"threads\": %d, \"mops\": %.3f, "
+               "\"peak_rss_mb\": %.2f, \"peak_live_mb\": %.2f, \"overhead_pct\": %.1f, \"errors\": %llu }",
+               *first ? "" : ",", workloads[w], allocators[a].name, cfg->p.threads, mops(r), rss, live,
+               overhead, (unsigned long long)r->errors);
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { 4, 2000000, 16384 }, 3, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_slab: %d threads, %llu ops per thread, %zu live objects per thread (random), "
+               "median of %d\n\n",
+               cfg.p.threads, (unsigned long long)cfg.p.ops, cfg.p.live, cfg.reps);
+        printf("  %-9s %-6s %9s %12s %12s %10s\n", "workload", "alloc", "Mops/s", "peak RSS MB",
+               "peak live MB", "overhead");
+        break;
+    case BENCH_FMT_CSV:
+        printf("workload,allocator,threads,mops,peak_rss_mb,peak_live_mb,overhead_pct,errors\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"slab\",\n  \"results\": [");
+        break;
+    }
+
+    Result *runs  = malloc((size_t)cfg.reps * sizeof(*runs));
+    int     first = 1, failed = 0;
+    if (!runs) return 1;
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        for (int a = 0; a < ALLOCATOR_COUNT; a++) {
+            int n = 0;
+            for (int k = 0; k < cfg.reps; k++)
+                if (run_child(a, w, &cfg.p, &runs[n]) == 0) n++;
+            if (n == 0) {
+                fprintf(stderr, "%s/%s: every run failed\n", workloads[w], allocators[a].name);
+                failed = 1;
+                continue;
+            }
+            qsort(runs, (size_t)n, sizeof(*runs), by_mops);
+            report(&cfg, w, a, &runs[n / 2], &first);
+            for (int k = 0; k < n; k++) failed |= runs[k].errors != 0;
+        }
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    free(runs);
+    return failed ? 1 : 0;
+}
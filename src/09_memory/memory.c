@@ -10,9 +10,10 @@
  *   5. Memory layout — stack vs heap addresses
  *   6. Common bugs — use-after-free, leaks, off-by-one
  *   7. Valgrind patterns — writing valgrind-clean code
+ *   8. A slab allocator — size classes, per-thread caches (slab.c)
  *
- * Build: gcc -Wall -Wextra -std=c99 -o bin/09_memory \
- *            src/09_memory/memory.c
+ * Build: gcc -Wall -Wextra -std=c99 -pthread -o bin/09_memory \
+ *            src/09_memory/memory.c src/09_memory/slab.c
  * Run:   ./bin/09_memory
  *        valgrind --leak-check=full ./bin/09_memory
  *
@@ -24,6 +25,9 @@
  */
 
 #include "../../include/common.h"
+#include "slab.h"
+
+#include <pthread.h>
 
 /* Forward-declare main so we can print its address in demo_memory_layout */
 int main(void);
@@ -303,6 +307,78 @@ static void demo_valgrind_patterns(void)
     printf("  Goal: \"All heap blocks were freed -- no leaks are possible\"\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: A Slab Allocator
+ *  Size classes, one page per slab, per-thread caches (slab.c).
+ * ════════════════════════════════════════════════════════════════ */
+
+#define SLAB_DEMO_OBJECTS 100
+
+static void *slab_demo_free_all(void *arg)
+{
+    void **objs = arg;
+    for (int i = 0; i < SLAB_DEMO_OBJECTS; i++) slab_free(objs[i]);
+    return NULL;
+}
+
+static void demo_slab(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: A Slab Allocator                       ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    /* Every small request is rounded up to a size class            */
+    static const size_t sizes[] = { 1, 16, 17, 100, 129, 200, 700, 1024, 1025 };
+    printf("  request  class  object size\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        int cls = slab_class(sizes[i]);
+        if (cls < 0)
+            printf("  %7zu  large  own mapping\n", sizes[i]);
+        else
+            printf("  %7zu  %5d  %11zu\n", sizes[i], cls, slab_class_size(cls));
+    }
+    printf("\n");
+
+    /* Objects of one class come from the same 4 KB page, back to back */
+    void *a = slab_alloc(48), *b = slab_alloc(48), *c = slab_alloc(48);
+    uintptr_t page = (uintptr_t)a & ~(uintptr_t)(SLAB_PAGE - 1);
+    printf("  three 48-byte objects: %p %p %p\n", a, b, c);
+    printf("  same page (%#lx)?  %s\n", (unsigned long)page,
+           ((uintptr_t)b & ~(uintptr_t)(SLAB_PAGE - 1)) == page &&
+                   ((uintptr_t)c & ~(uintptr_t)(SLAB_PAGE - 1)) == page
+               ? "yes"
+               : "no");
+    printf("  slab_usable_size(a) = %zu\n\n", slab_usable_size(a));
+
+    /* Free and allocate again: the magazine hands back the same object */
+    slab_free(c);
+    void *d = slab_alloc(48);
+    printf("  free c, alloc 48 again: %p (%s)\n\n", d, d == c ? "c, from the magazine" : "a new object");
+    slab_free(a);
+    slab_free(b);
+    slab_free(d);
+
+    /* Cross-thread free: another thread frees what this one allocated;
+     * the objects go onto this heap's remote stack                  */
+    void *objs[SLAB_DEMO_OBJECTS];
+    for (int i = 0; i < SLAB_DEMO_OBJECTS; i++) objs[i] = slab_alloc(64);
+    pthread_t t;
+    if (pthread_create(&t, NULL, slab_demo_free_all, objs) == 0) {
+        pthread_join(t, NULL);
+        printf("  %d objects allocated here, freed by another thread\n", SLAB_DEMO_OBJECTS);
+    }
+
+    void *big = slab_alloc(100000);
+    SlabStats st;
+    slab_stats(&st);
+    printf("  slab_stats: %zu KB mapped for slabs, %zu slabs in heaps,\n", st.mapped / 1024, st.slabs);
+    printf("              %zu pooled, %zu KB large, %zu heaps\n\n", st.pooled, st.large / 1024, st.heaps);
+    slab_free(big);
+    slab_thread_flush();
+
+    printf("  Benchmark against glibc malloc: ./bin/bench_slab\n\n");
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main — run all demos in order
  * ════════════════════════════════════════════════════════════════ */
@@ -320,6 +396,7 @@ int main(void)
     demo_memory_layout();
     demo_common_bugs();
     demo_valgrind_patterns();
+    demo_slab();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: Every malloc needs a free.  Every pointer\n");
@@ -0,0 +1,430 @@
+/*
+ * Chapter 9 — A size-class slab allocator with per-thread caches
+ *
+ * See slab.h.  Every 4 KB page the allocator hands out starts with a
+ * SlabPage header: a slab's, or a large object's, whose header is the
+ * start of its own mapping.  Only the owning thread touches a slab's
+ * free list and counters; other threads reach it only through the
+ * owner heap's remote stack.
+ */
+
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS, madvise() with -std=c99 */
+
+#include "slab.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SLAB_MAGIC   0x51ab51abu
+#define LARGE_MAGIC  0x1a26e0b0u
+#define CHUNK_SIZE   ((size_t)2 << 20)
+#define EMPTY_CACHE  4              /* empty slabs a heap keeps before pooling */
+
+typedef struct FreeObj {
+    struct FreeObj *next;
+} FreeObj;
+
+struct SlabHeap;
+
+typedef struct SlabPage {
+    uint32_t         magic;
+    uint16_t         cls;
+    uint16_t         capacity;      /* objects in the slab */
+    uint16_t         used;          /* out of the slab: handed out or in a magazine */
+    uint16_t         bump;          /* objects from here on were never handed out */
+    uint16_t         listed;        /* on the owner's list: has room */
+    struct SlabHeap *owner;
+    FreeObj         *free;
+    struct SlabPage *next, *prev;
+    size_t           map_size;      /* LARGE_MAGIC: the whole mapping */
+} SlabPage;
+
+#define HEADER_SIZE  ((sizeof(SlabPage) + 15) & ~(size_t)15)
+
+typedef struct {
+    uint32_t n;
+    void    *slot[SLAB_MAGAZINE];
+} Magazine;
+
+typedef struct SlabHeap {
+    /* Other threads CAS here: keep it off the owner's cache lines */
+    FreeObj         *remote __attribute__((aligned(64)));
+    char             pad_[64 - sizeof(FreeObj *)];
+
+    Magazine         mag[SLAB_CLASSES];
+    SlabPage        *slabs[SLAB_CLASSES];   /* slabs with room, newest first */
+    SlabPage        *empty;                 /* up to EMPTY_CACHE, linked by next */
+    unsigned         n_empty;
+
+    /* This thread's frees for another heap, pushed as one chain */
+    struct SlabHeap *batch_owner;
+    FreeObj         *batch_head, *batch_tail;
+    unsigned         batch_n;
+
+    struct SlabHeap *next_idle;             /* on idle_heaps after its thread exits */
+} SlabHeap;
+
+static const uint16_t class_size[SLAB_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024,
+};
+
+/* Shared state: pages not owned by any heap, and heaps without a thread */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static SlabPage       *pool;
+static char           *chunk_next;
+static size_t          chunk_left;
+static SlabHeap       *idle_heaps;
+
+static pthread_once_t  key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   heap_key;
+static __thread SlabHeap *my_heap;
+
+static size_t stat_mapped, stat_slabs, stat_pooled, stat_large, stat_heaps;
+
+#define STAT_ADD(v, n) __atomic_fetch_add(&(v), (n), __ATOMIC_RELAXED)
+#define STAT_SUB(v, n) __atomic_fetch_sub(&(v), (n), __ATOMIC_RELAXED)
+
+/* ════════════════════════════════════════════════════════════════
+ *  Size classes
+ * ════════════════════════════════════════════════════════════════ */
+
+int slab_class(size_t size)
+{
+    if (size <= 128) return size ? (int)((size - 1) / 16) : 0;
+    if (size > SLAB_MAX_SIZE) return -1;
+    /* Four classes per doubling: (2^k, 2^(k+1)] in steps of 2^(k-2) */
+    unsigned k    = 63 - (unsigned)__builtin_clzll((unsigned long long)(size - 1));
+    size_t   step = (size_t)1 << (k - 2);
+    return 8 + (int)(k - 7) * 4 + (int)((size - 1 - ((size_t)1 << k)) / step);
+}
+
+size_t slab_class_size(int cls)
+{
+    return cls >= 0 && cls < SLAB_CLASSES ? class_size[cls] : 0;
+}
+
+static SlabPage *page_of(const void *p)
+{
+    return (SlabPage *)((uintptr_t)p & ~(uintptr_t)(SLAB_PAGE - 1));
+}
+
+static void *obj_at(SlabPage *s, unsigned i)
+{
+    return (char *)s + HEADER_SIZE + (size_t)i * class_size[s->cls];
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Pages
+ * ════════════════════════════════════════════════════════════════ */
+
+static void *map_pages(size_t size)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static SlabPage *get_page(void)
+{
+    SlabPage *p = NULL;
+    pthread_mutex_lock(&pool_lock);
+    if (pool) {
+        p    = pool;
+        pool = p->next;
+        STAT_SUB(stat_pooled, 1);
+    } else {
+        if (chunk_left == 0 && (chunk_next = map_pages(CHUNK_SIZE)) != NULL) {
+            chunk_left = CHUNK_SIZE;
+            STAT_ADD(stat_mapped, CHUNK_SIZE);
+        }
+        if (chunk_left) {
+            p = (SlabPage *)(void *)chunk_next;
+            chunk_next += SLAB_PAGE;
+            chunk_left -= SLAB_PAGE;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return p;
+}
+
+/* Give an empty slab back, its memory to the kernel */
+static void put_page(SlabPage *p)
+{
+    madvise(p, SLAB_PAGE, MADV_DONTNEED);   /* the header reads as zeros afterwards */
+    pthread_mutex_lock(&pool_lock);
+    p->next = pool;
+    pool    = p;
+    STAT_ADD(stat_pooled, 1);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Slabs (owner thread only)
+ * ════════════════════════════════════════════════════════════════ */
+
+static void link_slab(SlabHeap *h, SlabPage *s)
+{
+    s->prev = NULL;
+    s->next = h->slabs[s->cls];
+    if (s->next) s->next->prev = s;
+    h->slabs[s->cls] = s;
+    s->listed        = 1;
+}
+
+static void unlink_slab(SlabHeap *h, SlabPage *s)
+{
+    if (s->prev) s->prev->next = s->next;
+    else h->slabs[s->cls] = s->next;
+    if (s->next) s->next->prev = s->prev;
+    s->listed = 0;
+}
+
+static SlabPage *new_slab(SlabHeap *h, int cls)
+{
+    SlabPage *s = h->empty;
+    if (s) {
+        h->empty = s->next;
+        h->n_empty--;
+    } else if ((s = get_page()) != NULL) {
+        STAT_ADD(stat_slabs, 1);
+    } else {
+        return NULL;
+    }
+    memset(s, 0, sizeof(*s));
+    s->magic    = SLAB_MAGIC;
+    s->cls      = (uint16_t)cls;
+    s->capacity = (uint16_t)((SLAB_PAGE - HEADER_SIZE) / class_size[cls]);
+    s->owner    = h;
+    return s;
+}
+
+/* s has just become empty: keep it if it is its class's only slab */
+static void release_slab(SlabHeap *h, SlabPage *s)
+{
+    if (h->slabs[s->cls] == s && !s->next) return;
+    unlink_slab(h, s);
+    if (h->n_empty < EMPTY_CACHE) {
+        s->next  = h->empty;
+        h->empty = s;
+        h->n_empty++;
+    } else {
+        STAT_SUB(stat_slabs, 1);
+        put_page(s);
+    }
+}
+
+/* An object back into its slab's free list */
+static void return_obj(SlabHeap *h, void *p)
+{
+    SlabPage *s = page_of(p);
+    FreeObj  *o = p;
+    o->next     = s->free;
+    s->free     = o;
+    s->used--;
+    if (!s->listed) link_slab(h, s);
+    if (s->used == 0) release_slab(h, s);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Heaps
+ * ════════════════════════════════════════════════════════════════ */
+
+static void thread_exit(void *arg);
+
+static void make_key(void)
+{
+    pthread_key_create(&heap_key, thread_exit);
+}
+
+static SlabHeap *heap(void)
+{
+    SlabHeap *h = my_heap;
+    if (h) return h;
+
+    pthread_once(&key_once, make_key);
+    pthread_mutex_lock(&pool_lock);
+    if ((h = idle_heaps) != NULL) idle_heaps = h->next_idle;
+    pthread_mutex_unlock(&pool_lock);
+    if (!h) {
+        if ((h = map_pages(sizeof(SlabHeap))) == NULL) return NULL;
+        STAT_ADD(stat_heaps, 1);
+    }
+    my_heap = h;
+    pthread_setspecific(heap_key, h);
+    return h;
+}
+
+/* Push this thread's batch onto its owner's remote stack in one CAS */
+static void flush_batch(SlabHeap *h)
+{
+    if (!h->batch_n) return;
+    SlabHeap *owner = h->batch_owner;
+    FreeObj  *old   = __atomic_load_n(&owner->remote, __ATOMIC_RELAXED);
+    do h->batch_tail->next = old;
+    while (!__atomic_compare_exchange_n(&owner->remote, &old, h->batch_head, 1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED));
+    h->batch_head = h->batch_tail = NULL;
+    h->batch_n    = 0;
+}
+
+static void local_free(SlabHeap *h, SlabPage *s, void *p)
+{
+    Magazine *m = &h->mag[s->cls];
+    if (m->n == SLAB_MAGAZINE) {
+        /* Full: the older half goes back to the slabs */
+        for (unsigned i = 0; i < SLAB_MAGAZINE / 2; i++) return_obj(h, m->slot[i]);
+        memmove(m->slot, m->slot + SLAB_MAGAZINE / 2, sizeof(m->slot) / 2);
+        m->n = SLAB_MAGAZINE / 2;
+    }
+    m->slot[m->n++] = p;
+}
+
+/* Take everything other threads have freed into our slabs */
+static void drain_remote(SlabHeap *h)
+{
+    FreeObj *o = __atomic_exchange_n(&h->remote, NULL, __ATOMIC_ACQUIRE);
+    while (o) {
+        FreeObj *next = o->next;
+        local_free(h, page_of(o), o);
+        o = next;
+    }
+}
+
+static void *refill(SlabHeap *h, int cls)
+{
+    Magazine *m = &h->mag[cls];
+    flush_batch(h);
+    if (__atomic_load_n(&h->remote, __ATOMIC_RELAXED)) {
+        drain_remote(h);
+        if (m->n) return m->slot[--m->n];
+    }
+    while (m->n < SLAB_MAGAZINE / 2) {
+        SlabPage *s = h->slabs[cls];
+        if (!s) {
+            if ((s = new_slab(h, cls)) == NULL) break;
+            link_slab(h, s);
+        }
+        for (; m->n < SLAB_MAGAZINE / 2 && s->free; s->used++) {
+            m->slot[m->n++] = s->free;
+            s->free         = s->free->next;
+        }
+        for (; m->n < SLAB_MAGAZINE / 2 && s->bump < s->capacity; s->used++)
+            m->slot[m->n++] = obj_at(s, s->bump++);
+        if (!s->free && s->bump == s->capacity) unlink_slab(h, s);
+    }
+    return m->n ? m->slot[--m->n] : NULL;
+}
+
+void slab_thread_flush(void)
+{
+    SlabHeap *h = my_heap;
+    if (!h) return;
+    flush_batch(h);
+    drain_remote(h);
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        Magazine *m = &h->mag[c];
+        while (m->n) return_obj(h, m->slot[--m->n]);
+    }
+}
+
+static void thread_exit(void *arg)
+{
+    SlabHeap *h = arg;
+    slab_thread_flush();
+    my_heap = NULL;
+    pthread_mutex_lock(&pool_lock);
+    h->next_idle = idle_heaps;
+    idle_heaps   = h;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Allocation
+ * ════════════════════════════════════════════════════════════════ */
+
+static void *large_alloc(size_t size)
+{
+    if (size > SIZE_MAX - HEADER_SIZE - SLAB_PAGE) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t    map = (HEADER_SIZE + size + SLAB_PAGE - 1) & ~(size_t)(SLAB_PAGE - 1);
+    SlabPage *s   = map_pages(map);
+    if (!s) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    s->magic    = LARGE_MAGIC;
+    s->map_size = map;
+    STAT_ADD(stat_large, map);
+    return (char *)s + HEADER_SIZE;
+}
+
+void *slab_alloc(size_t size)
+{
+    int cls = slab_class(size);
+    if (cls < 0) return large_alloc(size);
+
+    SlabHeap *h = heap();
+    if (!h) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    Magazine *m = &h->mag[cls];
+    if (m->n) return m->slot[--m->n];
+    void *p = refill(h, cls);
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+void slab_free(void *p)
+{
+    if (!p) return;
+    SlabPage *s = page_of(p);
+    if (s->magic == LARGE_MAGIC) {
+        STAT_SUB(stat_large, s->map_size);
+        munmap(s, s->map_size);
+        return;
+    }
+
+    SlabHeap *h = heap();
+    if (h == s->owner) {
+        local_free(h, s, p);
+        return;
+    }
+    if (!h) {
+        /* No heap to batch in: push this one object alone */
+        FreeObj *o = p, *old = __atomic_load_n(&s->owner->remote, __ATOMIC_RELAXED);
+        do o->next = old;
+        while (!__atomic_compare_exchange_n(&s->owner->remote, &old, o, 1, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED));
+        return;
+    }
+    if (h->batch_owner != s->owner) {
+        flush_batch(h);
+        h->batch_owner = s->owner;
+    }
+    FreeObj *o = p;
+    o->next    = h->batch_head;
+    if (!h->batch_head) h->batch_tail = o;
+    h->batch_head = o;
+    if (++h->batch_n == SLAB_REMOTE_BATCH) flush_batch(h);
+}
+
+size_t slab_usable_size(const void *p)
+{
+    const SlabPage *s = page_of(p);
+    return s->magic == LARGE_MAGIC ? s->map_size - HEADER_SIZE : class_size[s->cls];
+}
+
+void slab_stats(SlabStats *st)
+{
+    st->mapped = __atomic_load_n(&stat_mapped, __ATOMIC_RELAXED);
+    st->slabs  = __atomic_load_n(&stat_slabs, __ATOMIC_RELAXED);
+    st->pooled = __atomic_load_n(&stat_pooled, __ATOMIC_RELAXED);
+    st->large  = __atomic_load_n(&stat_large, __ATOMIC_RELAXED);
+    st->heaps  = __atomic_load_n(&stat_heaps, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,65 @@
+/*
+ * Chapter 9 — A size-class slab allocator with per-thread caches
+ *
+ * Small requests (up to SLAB_MAX_SIZE bytes) are rounded up to one of
+ * SLAB_CLASSES size classes — 16-byte steps to 128, then four per
+ * doubling — and served from slabs: 4 KB pages, each holding objects
+ * of one class behind a small header, carved out of 2 MB mmap()ed
+ * chunks.  slab_free() finds an object's slab by rounding its address
+ * down to the page.
+ *
+ * Each thread owns a heap:
+ *
+ *   magazines   per class, a stack of up to SLAB_MAGAZINE free objects;
+ *               alloc and free by the owner are a push or a pop
+ *   slabs       per class, the owner's slabs with room; magazines
+ *               refill from them and flush back to them in batches
+ *   remote      objects other threads freed, a lock-free (CAS) stack
+ *               the owner takes whole when a magazine runs dry
+ *
+ * A free by any thread other than the slab's owner goes on the owner
+ * heap's remote stack — batched per freeing thread, one CAS per
+ * SLAB_REMOTE_BATCH objects.  Empty slabs beyond a small per-heap
+ * cache go back to a shared pool, their memory returned to the kernel
+ * with madvise().  When a thread exits its heap is flushed and kept
+ * for the next new thread, so frees into it still find an owner.
+ *
+ * Larger requests get their own mapping.  Thread-safe; no lock on the
+ * alloc and free paths (the shared page pool takes a mutex, once per
+ * slab).
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+#define SLAB_PAGE          4096
+#define SLAB_MAX_SIZE      1024
+#define SLAB_CLASSES       20
+#define SLAB_MAGAZINE      64
+#define SLAB_REMOTE_BATCH  32
+
+typedef struct {
+    size_t mapped;          /* bytes mapped for slabs (chunks) */
+    size_t slabs;           /* slabs owned by heaps, empty ones they cache included */
+    size_t pooled;          /* empty slabs in the shared pool */
+    size_t large;           /* bytes mapped for large objects */
+    size_t heaps;
+} SlabStats;
+
+void  *slab_alloc(size_t size);        /* NULL with errno = ENOMEM */
+void   slab_free(void *p);             /* NULL is ignored */
+size_t slab_usable_size(const void *p);
+
+/* The size class serving size bytes and its object size; -1 if large */
+int    slab_class(size_t size);
+size_t slab_class_size(int cls);
+
+/* Return this thread's cached objects (magazines, pending remote frees)
+ * to their slabs; done for you when the thread exits */
+void   slab_thread_flush(void);
+
+void   slab_stats(SlabStats *s);
+
+#endif /* SLAB_H */
@@ -0,0 +1,418 @@
+/*
+ * bench_fileio — scanning and copying log files, backend by backend
+ *
+ * Writes a log-like text file of each size (timestamped lines of about
+ * 120 bytes), then for every ioengine backend:
+ *
+ *   scan   io_scan() the file, counting lines with memchr() — the work
+ *          a log reader does at the least
+ *   copy   io_copy() it to a new file next to it (unlinked first, so
+ *          no run overwrites cached pages of another)
+ *
+ * with the file hot (read once first: every byte in the page cache) or
+ * cold (fdatasync + POSIX_FADV_DONTNEED before every run: from the
+ * device).  O_DIRECT never uses the cache, so it is cold either way.
+ *
+ * Reported, the median of --reps runs: wall time, GB/s, CPU time
+ * (user + system from getrusage(), io_uring's kernel threads included;
+ * writeback by kernel flusher threads is not), and CPU ns per byte —
+ * how much of a core each path costs at that rate.  --fsync 1 adds an
+ * fdatasync() of the copy to its time, so copies are measured to the
+ * device rather than to the page cache.  Backends that cannot do an
+ * operation (sendfile and copy_file_range do not scan) or refuse it
+ * here (O_DIRECT on tmpfs, io_uring under seccomp) are n/a.  A hot size
+ * that would not fit in 3/4 of MemAvailable (twice the size for copy)
+ * is n/a: it would measure eviction, not the path.
+ *
+ * Every scan must count the same lines and bytes, and every copy must
+ * checksum the same as its source; exit 1 if one does not.
+ *
+ * Build: make bench_fileio
+ * Run:   ./bin/bench_fileio [--sizes-mb 16,256] [--op scan|copy|all]
+ *                           [--strategy NAME|all] [--cache hot|cold|all]
+ *                           [--buf-kb N] [--stdio-kb N] [--qd N] [--reps N]
+ *                           [--fsync 0|1] [--dir DIR] [--format text|csv|json]
+ *        --buf-kb is the read/write, O_DIRECT, mmap and io_uring unit
+ *        (default: 1 MB, 128 KB per io_uring entry); --stdio-kb is the
+ *        setvbuf() size (default: stdio's own).  Use a --dir on the
+ *        device you care about: the default is /var/tmp, not a tmpfs.
+ */
+
+#define _GNU_SOURCE         /* posix_fadvise() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "../../include/bench.h"
+#include "ioengine.h"
+
+enum { OP_SCAN, OP_COPY, OP_COUNT };
+static const char *ops[OP_COUNT] = { "scan", "copy" };
+
+enum { CACHE_HOT, CACHE_COLD, CACHE_COUNT };
+static const char *caches[CACHE_COUNT] = { "hot", "cold" };
+
+#define MAX_SIZES 16
+#define MAX_REPS  64
+
+typedef struct {
+    size_t         sizes[MAX_SIZES];
+    int            n_sizes;
+    int            op;              /* -1 = all */
+    int            strategy;        /* -1 = all */
+    int            cache;           /* -1 = all */
+    size_t         buf_kb, stdio_kb;
+    unsigned       qd;
+    int            reps;
+    int            fsync;
+    const char    *dir;
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    int      ok;                    /* 0: see err */
+    int      err;
+    int      bad;                   /* wrong line count, size or checksum */
+    uint64_t wall_ns, cpu_ns;
+} Result;
+
+/* What the generated file holds, to check every run against */
+typedef struct {
+    int64_t  bytes;
+    uint64_t lines;
+    uint64_t sum;
+} Expect;
+
+/* ════════════════════════════════════════════════════════════════
+ *  The file
+ * ════════════════════════════════════════════════════════════════ */
+
+static const char *levels[] = { "info", "info", "info", "debug", "warn", "error" };
+static const char *paths[]  = { "/api/orders", "/api/users", "/healthz", "/static/app.js", "/api/search" };
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* Order-sensitive, so a copy with blocks swapped does not match */
+static int checksum_fn(const void *data, size_t len, void *ctx)
+{
+    uint64_t            *h = ctx;
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) *h = (*h ^ p[i]) * 0x100000001b3ull;
+    return 0;
+}
+
+static int write_log(const char *path, size_t size, Expect *e)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    char line[256];
+    memset(e, 0, sizeof(*e));
+    e->sum = 0xcbf29ce484222325ull;
+    for (uint64_t n = 0; (size_t)e->bytes < size; n++) {
+        uint64_t r = next_rand();
+        int      len = snprintf(line, sizeof(line),
+                                "2026-10-14T%02u:%02u:%02u.%06uZ web-%02u app[%u]: level=%s method=GET "
+                                "path=%s status=%u latency_us=%u req=%016llx\n",
+                                (unsigned)(n / 3600000 % 24), (unsigned)(n / 60000 % 60),
+                                (unsigned)(n / 1000 % 60), (unsigned)(n % 1000 * 1000),
+                                (unsigned)(r % 16), 1000 + (unsigned)(r >> 8 & 1023),
+                                levels[(r >> 20) % 6], paths[(r >> 28) % 5],
+                                r >> 32 & 15 ? 200 : 500, (unsigned)(r >> 36 & 65535),
+                                (unsigned long long)(r * 0x2545f4914f6cdd1dull));
+        if (fwrite(line, 1, (size_t)len, f) != (size_t)len) break;
+        checksum_fn(line, (size_t)len, &e->sum);
+        e->bytes += len;
+        e->lines++;
+    }
+    if (fclose(f) != 0 || (size_t)e->bytes < size) return -1;
+    return 0;
+}
+
+/* Write back anything dirty, then drop the file from the page cache */
+static void evict(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static size_t mem_available(void)
+{
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return SIZE_MAX;
+    char   line[128];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "MemAvailable: %zu kB", &kb) == 1) break;
+    fclose(f);
+    return kb ? kb << 10 : SIZE_MAX;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Runs
+ * ════════════════════════════════════════════════════════════════ */
+
+static int count_lines(const void *data, size_t len, void *ctx)
+{
+    uint64_t   *lines = ctx;
+    const char *p = data, *end = p + len;
+    while ((p = memchr(p, '\n', (size_t)(end - p)))) {
+        (*lines)++;
+        p++;
+    }
+    return 0;
+}
+
+static uint64_t cpu_now_ns(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ((uint64_t)ru.ru_utime.tv_sec + (uint64_t)ru.ru_stime.tv_sec) * 1000000000ull +
+           ((uint64_t)ru.ru_utime.tv_usec + (uint64_t)ru.ru_stime.tv_usec) * 1000ull;
+}
+
+static int sync_file(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    int rc = fdatasync(fd);
+    close(fd);
+    return rc;
+}
+
+static void run(const Config *cfg, int op, const IoStrategy *s, int cache, const char *src,
+                const char *dst, const Expect *e, Result *r)
+{
+    uint64_t wall[MAX_REPS], cpu[MAX_REPS];
+    memset(r, 0, sizeof(*r));
+
+    /* Hot: one untimed pass through the cache */
+    if (cache == CACHE_HOT) {
+        uint64_t lines = 0;
+        io_scan(src, count_lines, &lines, NULL);
+    }
+
+    for (int rep = 0; rep < cfg->reps; rep++) {
+        uint64_t lines = 0;
+        if (op == OP_COPY) unlink(dst);
+        if (cache == CACHE_COLD) evict(src);
+
+        uint64_t c0 = cpu_now_ns(), t0 = bench_now_ns();
+        int64_t  n  = op == OP_SCAN ? io_scan(src, count_lines, &lines, s) : io_copy(src, dst, s);
+        if (n >= 0 && op == OP_COPY && cfg->fsync && sync_file(dst) != 0) n = -1;
+        uint64_t t1 = bench_now_ns(), c1 = cpu_now_ns();
+
+        if (n < 0) {
+            r->err = errno;
+            return;
+        }
+        wall[rep] = t1 - t0;
+        cpu[rep]  = c1 - c0;
+
+        if (n != e->bytes || (op == OP_SCAN && lines != e->lines)) r->bad = 1;
+        if (op == OP_COPY && rep == cfg->reps - 1) {
+            uint64_t sum = 0xcbf29ce484222325ull;
+            if (io_scan(dst, checksum_fn, &sum, NULL) != e->bytes || sum != e->sum) r->bad = 1;
+        }
+    }
+    if (op == OP_COPY) unlink(dst);
+    r->ok      = 1;
+    r->wall_ns = bench_percentile(wall, (size_t)cfg->reps, 50);
+    r->cpu_ns  = bench_percentile(cpu, (size_t)cfg->reps, 50);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--sizes-mb 16,256] [--op scan|copy|all] [--strategy NAME|all]\n"
+            "       %*s [--cache hot|cold|all] [--buf-kb N] [--stdio-kb N] [--qd N] [--reps N]\n"
+            "       %*s [--fsync 0|1] [--dir DIR] [--format text|csv|json]\n"
+            "strategies:",
+            argv0, (int)strlen(argv0), "", (int)strlen(argv0), "");
+    for (int b = 0; b < IO_BACKENDS; b++) fprintf(stderr, " %s", io_backend_name((IoBackend)b));
+    fprintf(stderr, "\n");
+}
+
+static int parse_sizes(const char *val, Config *cfg)
+{
+    char list[256];
+    snprintf(list, sizeof(list), "%s", val);
+    cfg->n_sizes = 0;
+    for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        size_t mb = (size_t)strtoull(tok, NULL, 10);
+        if (mb == 0 || cfg->n_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->n_sizes++] = mb << 20;
+    }
+    return cfg->n_sizes ? 0 : -1;
+}
+
+static int parse_name(const char *val, const char *const *names, int n, int *out)
+{
+    if (strcmp(val, "all") == 0) {
+        *out = -1;
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+        if (strcmp(val, names[i]) == 0) {
+            *out = i;
+            return 0;
+        }
+    return -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--sizes-mb") == 0) {
+            if (parse_sizes(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--op") == 0) {
+            if (parse_name(val, ops, OP_COUNT, &cfg->op) != 0) return -1;
+        } else if (strcmp(opt, "--strategy") == 0) {
+            IoBackend b;
+            if (strcmp(val, "all") == 0)                cfg->strategy = -1;
+            else if (io_parse_backend(val, &b) == 0)    cfg->strategy = (int)b;
+            else                                        return -1;
+        } else if (strcmp(opt, "--cache") == 0) {
+            if (parse_name(val, caches, CACHE_COUNT, &cfg->cache) != 0) return -1;
+        } else if (strcmp(opt, "--buf-kb") == 0) {
+            cfg->buf_kb = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--stdio-kb") == 0) {
+            cfg->stdio_kb = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--qd") == 0) {
+            cfg->qd = (unsigned)atoi(val);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--fsync") == 0) {
+            cfg->fsync = atoi(val);
+        } else if (strcmp(opt, "--dir") == 0) {
+            cfg->dir = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && cfg->reps <= MAX_REPS && cfg->qd >= 1 && cfg->qd <= 4096 ? 0 : -1;
+}
+
+static void report(const Config *cfg, int op, IoBackend b, int cache, size_t size, const Result *r,
+                   int *first)
+{
+    double secs = (double)r->wall_ns / 1e9;
+    double gbs  = secs > 0 ? (double)size / secs / 1e9 : 0;
+    double nspb = (double)r->cpu_ns / (double)size;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-4s %-4s %7zu  %-15s", ops[op], caches[cache], size >> 20, io_backend_name(b));
+        if (!r->ok) {
+            printf("  n/a (%s)\n", strerror(r->err));
+            break;
+        }
+        printf(" %9.2f %7.2f %9.2f %8.3f%s\n", (double)r->wall_ns / 1e6, gbs, (double)r->cpu_ns / 1e6, nspb,
+               r->bad ? "  CONTENTS DIFFER" : "");
+        break;
+    case BENCH_FMT_CSV:
+        if (!r->ok) break;
+        printf("%s,%s,%zu,%s,%.3f,%.3f,%.3f,%.4f\n", ops[op], caches[cache], size, io_backend_name(b),
+               (double)r->wall_ns / 1e6, gbs, (double)r->cpu_ns / 1e6, nspb);
+        break;
+    case BENCH_FMT_JSON:
+        if (!r->ok) break;
+        printf("%s\n    { \"op\": \"%s\", \"cache\": \"%s\", \"bytes\": %zu, \"strategy\": \"%s\", "
+               "\"ms\": %.3f, \"gb_s\": %.3f, \"cpu_ms\": %.3f, \"cpu_ns_per_byte\": %.4f }",
+               *first ? "" : ",", ops[op], caches[cache], size, io_backend_name(b), (double)r->wall_ns / 1e6,
+               gbs, (double)r->cpu_ns / 1e6, nspb);
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { (size_t)16 << 20, (size_t)256 << 20 }, 2, -1, -1, -1, 0, 0, 8, 3, 0, "/var/tmp",
+                   BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char src[4096], dst[4200];
+    snprintf(src, sizeof(src), "%s/bench_fileio_%ld.log", cfg.dir, (long)getpid());
+    snprintf(dst, sizeof(dst), "%s.copy", src);
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT: {
+        char buf[32] = "default", stdio[32] = "default";
+        if (cfg.buf_kb)   snprintf(buf, sizeof(buf), "%zu KB", cfg.buf_kb);
+        if (cfg.stdio_kb) snprintf(stdio, sizeof(stdio), "%zu KB", cfg.stdio_kb);
+        printf("bench_fileio: median of %d runs; buffers %s, stdio %s, io_uring depth %u; files in %s%s\n\n",
+               cfg.reps, buf, stdio, cfg.qd, cfg.dir, cfg.fsync ? "; copies fdatasync()ed" : "");
+        printf("  %-4s %-4s %7s  %-15s %9s %7s %9s %8s\n", "op", "", "MB", "strategy", "ms", "GB/s",
+               "cpu ms", "cpu ns/B");
+        break;
+    }
+    case BENCH_FMT_CSV:
+        printf("op,cache,bytes,strategy,ms,gb_s,cpu_ms,cpu_ns_per_byte\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"fileio\",\n  \"results\": [");
+        break;
+    }
+
+    int failed = 0, first = 1;
+    for (int i = 0; i < cfg.n_sizes; i++) {
+        Expect e;
+        if (write_log(src, cfg.sizes[i], &e) != 0) {
+            fprintf(stderr, "%s: %s\n", src, strerror(errno));
+            unlink(src);
+            return 1;
+        }
+        size_t size = (size_t)e.bytes;
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (cfg.op >= 0 && cfg.op != op) continue;
+            for (int c = 0; c < CACHE_COUNT; c++) {
+                if (cfg.cache >= 0 && cfg.cache != c) continue;
+                for (int b = 0; b < IO_BACKENDS; b++) {
+                    if (cfg.strategy >= 0 && cfg.strategy != b) continue;
+                    IoStrategy s = { (IoBackend)b, (b == IO_STDIO ? cfg.stdio_kb : cfg.buf_kb) << 10, cfg.qd };
+                    Result     r;
+                    if (c == CACHE_HOT && size * (op == OP_COPY ? 2 : 1) > mem_available() / 4 * 3) {
+                        memset(&r, 0, sizeof(r));
+                        r.err = ENOMEM;
+                    } else {
+                        run(&cfg, op, &s, c, src, dst, &e, &r);
+                    }
+                    report(&cfg, op, (IoBackend)b, c, size, &r, &first);
+                    failed |= r.bad;
+                }
+                if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+            }
+        }
+        unlink(src);
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,403 @@
+/*
+ * bench_recstore — per-record stdio vs a memory-mapped record file
+ *
+ * 32-byte records (a random 64-bit key, the row number, a payload),
+ * --records of them, stored two ways: a flat file of raw structs as
+ * demo_binary_io writes it, and a recstore file (recstore.h).  Then:
+ *
+ *   append   --appends more records, made durable every --batch:
+ *              stdio     fwrite() each, fflush() + fdatasync() per batch
+ *              recstore  rs_append() each, rs_commit() per batch (WAL)
+ *   get      --lookups random rows:
+ *              stdio     fseek() + fread() each
+ *              pread     one pread() each
+ *              recstore  rs_get(): a pointer into the mapping
+ *   find     --lookups random keys that exist:
+ *              recstore  rs_find() on the sorted index, after
+ *                        rs_build_index() (timed separately)
+ *
+ * Reported: ns per operation and millions of operations per second.
+ * Every record read back must carry its own row and key; exit 1 if
+ * one does not.  Files are hot: written just before they are read.
+ *
+ * Build: make bench_recstore
+ * Run:   ./bin/bench_recstore [--records N] [--lookups N] [--appends N]
+ *                             [--batch 16,256,4096] [--dir DIR]
+ *                             [--format text|csv|json]
+ */
+
+#define _GNU_SOURCE         /* fdatasync(), pread() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../include/bench.h"
+#include "recstore.h"
+
+#define MAX_BATCHES 8
+
+typedef struct {
+    uint64_t key;
+    uint32_t row;
+    uint32_t score;
+    double   value;
+    char     tag[8];
+} Rec;
+
+/* Changes whenever Rec's size or field offsets do */
+#define REC_LAYOUT ((uint32_t)(sizeof(Rec) << 24 | offsetof(Rec, row) << 16 | offsetof(Rec, value) << 8 | \
+                               offsetof(Rec, tag)))
+
+typedef struct {
+    uint64_t       records, lookups, appends;
+    unsigned       batches[MAX_BATCHES];
+    int            n_batches;
+    const char    *dir;
+    bench_format_t format;
+} Config;
+
+static uint64_t key_of(uint64_t row)
+{
+    uint64_t x = row + 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void make_rec(Rec *r, uint64_t row)
+{
+    memset(r, 0, sizeof(*r));
+    r->key   = key_of(row);
+    r->row   = (uint32_t)row;
+    r->score = (uint32_t)(row % 101);
+    r->value = (double)row * 0.5;
+    snprintf(r->tag, sizeof(r->tag), "r%06u", (unsigned)(row % 1000000));
+}
+
+static int rec_ok(const Rec *r, uint64_t row)
+{
+    return r->row == (uint32_t)row && r->key == key_of(row);
+}
+
+static uint64_t rng = 88172645463325252ull;
+
+static uint64_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Output
+ * ════════════════════════════════════════════════════════════════ */
+
+static int first = 1;
+
+static void report(const Config *cfg, const char *op, const char *method, unsigned batch, uint64_t ops,
+                   uint64_t ns)
+{
+    double per = ops ? (double)ns / (double)ops : 0;
+    double mops = ns ? (double)ops / ((double)ns / 1e3) : 0;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        if (batch) printf("  %-7s %-9s %6u %10llu %10.1f %9.3f\n", op, method, batch, (unsigned long long)ops,
+                          per, mops);
+        else       printf("  %-7s %-9s %6s %10llu %10.1f %9.3f\n", op, method, "-", (unsigned long long)ops,
+                          per, mops);
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%u,%llu,%.2f,%.4f\n", op, method, batch, (unsigned long long)ops, per, mops);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"op\": \"%s\", \"method\": \"%s\", \"batch\": %u, \"ops\": %llu, \"ns_per_op\": %.2f, "
+               "\"mops\": %.4f }",
+               first ? "" : ",", op, method, batch, (unsigned long long)ops, per, mops);
+        first = 0;
+        break;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Runs
+ * ════════════════════════════════════════════════════════════════ */
+
+static int stdio_append(const char *path, uint64_t base, uint64_t n, unsigned batch, uint64_t *ns)
+{
+    FILE *f = fopen(path, "ab");
+    if (!f) return -1;
+    Rec r;
+    uint64_t t0 = bench_now_ns();
+    for (uint64_t i = 0; i < n; i++) {
+        make_rec(&r, base + i);
+        if (fwrite(&r, sizeof(r), 1, f) != 1) break;
+        if ((i + 1) % batch == 0 || i + 1 == n) {
+            fflush(f);
+            fdatasync(fileno(f));
+        }
+    }
+    *ns = bench_now_ns() - t0;
+    return fclose(f);
+}
+
+static int rs_append_run(const char *path, uint64_t base, uint64_t n, unsigned batch, uint64_t *ns)
+{
+    RecStore *rs = rs_open(path, NULL, 0);
+    if (!rs) return -1;
+    Rec      r;
+    int      rc = 0;
+    uint64_t t0 = bench_now_ns();
+    for (uint64_t i = 0; rc == 0 && i < n; i++) {
+        make_rec(&r, base + i);
+        if (rs_append(rs, &r) < 0) rc = -1;
+        else if ((i + 1) % batch == 0) rc = rs_commit(rs);
+    }
+    if (rc == 0) rc = rs_commit(rs);
+    *ns = bench_now_ns() - t0;
+    return rs_close(rs) == 0 ? rc : -1;
+}
+
+/* Both files hold the same cfg->records rows; returns 0 or -1 */
+static int load(const Config *cfg, const char *flat, const char *store)
+{
+    unlink(flat);
+    unlink(store);
+    FILE *f = fopen(flat, "wb");
+    if (!f) return -1;
+    /* A WAL as large as the largest batch, so no batch commits early */
+    unsigned wal = 0;
+    for (int b = 0; b < cfg->n_batches; b++)
+        if (cfg->batches[b] > wal) wal = cfg->batches[b];
+    RecStoreOpts o  = { sizeof(Rec), offsetof(Rec, key), REC_LAYOUT, wal };
+    RecStore    *rs = rs_open(store, &o, RS_CREATE);
+    if (!rs) {
+        fclose(f);
+        return -1;
+    }
+    Rec r;
+    for (uint64_t i = 0; i < cfg->records; i++) {
+        make_rec(&r, i);
+        if (fwrite(&r, sizeof(r), 1, f) != 1 || rs_append(rs, &r) < 0) break;
+    }
+    int rc = fclose(f);
+    if (rs_close(rs) != 0) rc = -1;
+    return rc;
+}
+
+static int run_get(const Config *cfg, const char *flat, const char *store, int *bad)
+{
+    uint64_t *rows = malloc(cfg->lookups * sizeof(*rows));
+    if (!rows) return -1;
+    for (uint64_t i = 0; i < cfg->lookups; i++) rows[i] = next_rand() % cfg->records;
+
+    Rec      r;
+    uint64_t t0, ns;
+
+    FILE *f = fopen(flat, "rb");
+    if (!f) goto fail;
+    t0 = bench_now_ns();
+    for (uint64_t i = 0; i < cfg->lookups; i++) {
+        fseek(f, (long)(rows[i] * sizeof(Rec)), SEEK_SET);
+        if (fread(&r, sizeof(r), 1, f) != 1 || !rec_ok(&r, rows[i])) *bad = 1;
+    }
+    ns = bench_now_ns() - t0;
+    fclose(f);
+    report(cfg, "get", "stdio", 0, cfg->lookups, ns);
+
+    int fd = open(flat, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) goto fail;
+    t0 = bench_now_ns();
+    for (uint64_t i = 0; i < cfg->lookups; i++)
+        if (pread(fd, &r, sizeof(r), (off_t)(rows[i] * sizeof(Rec))) != (ssize_t)sizeof(r) || !rec_ok(&r, rows[i]))
+            *bad = 1;
+    ns = bench_now_ns() - t0;
+    close(fd);
+    report(cfg, "get", "pread", 0, cfg->lookups, ns);
+
+    RecStore *rs = rs_open(store, NULL, RS_RDONLY);
+    if (!rs) goto fail;
+    t0 = bench_now_ns();
+    for (uint64_t i = 0; i < cfg->lookups; i++) {
+        const Rec *p = rs_get(rs, rows[i]);
+        if (!p || !rec_ok(p, rows[i])) *bad = 1;
+    }
+    ns = bench_now_ns() - t0;
+    rs_close(rs);
+    report(cfg, "get", "recstore", 0, cfg->lookups, ns);
+
+    free(rows);
+    return 0;
+fail:
+    free(rows);
+    return -1;
+}
+
+static int run_find(const Config *cfg, const char *store, int *bad)
+{
+    RecStore *rs = rs_open(store, NULL, 0);
+    if (!rs) return -1;
+    uint64_t t0 = bench_now_ns();
+    if (rs_build_index(rs) != 0) {
+        rs_close(rs);
+        return -1;
+    }
+    report(cfg, "index", "recstore", 0, rs_count(rs), bench_now_ns() - t0);
+
+    uint64_t *rows = malloc(cfg->lookups * sizeof(*rows));
+    if (!rows) {
+        rs_close(rs);
+        return -1;
+    }
+    for (uint64_t i = 0; i < cfg->lookups; i++) rows[i] = next_rand() % cfg->records;
+    t0 = bench_now_ns();
+    for (uint64_t i = 0; i < cfg->lookups; i++) {
+        int64_t row = rs_find(rs, key_of(rows[i]));
+        if (row < 0 || !rec_ok(rs_get(rs, (uint64_t)row), rows[i])) *bad = 1;
+    }
+    report(cfg, "find", "recstore", 0, cfg->lookups, bench_now_ns() - t0);
+    free(rows);
+    return rs_close(rs);
+}
+
+/* The appended rows must all be there, in order, after reopening */
+static int check_appends(const Config *cfg, const char *flat, const char *store, int *bad)
+{
+    uint64_t  total = cfg->records + cfg->appends;
+    RecStore *rs    = rs_open(store, NULL, RS_RDONLY);
+    if (!rs) return -1;
+    if (rs_count(rs) != total) *bad = 1;
+    for (uint64_t row = cfg->records; row < rs_count(rs); row++)
+        if (!rec_ok(rs_get(rs, row), row)) *bad = 1;
+    rs_close(rs);
+
+    FILE *f = fopen(flat, "rb");
+    if (!f) return -1;
+    Rec      r;
+    uint64_t n = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (!rec_ok(&r, n)) *bad = 1;
+        n++;
+    }
+    fclose(f);
+    if (n != total) *bad = 1;
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--records N] [--lookups N] [--appends N] [--batch 16,256,4096]\n"
+            "       %*s [--dir DIR] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_batches(const char *val, Config *cfg)
+{
+    char list[256];
+    snprintf(list, sizeof(list), "%s", val);
+    cfg->n_batches = 0;
+    for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        long b = strtol(tok, NULL, 10);
+        if (b < 1 || b > (1 << 20) || cfg->n_batches == MAX_BATCHES) return -1;
+        cfg->batches[cfg->n_batches++] = (unsigned)b;
+    }
+    return cfg->n_batches ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--records") == 0) {
+            cfg->records = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--lookups") == 0) {
+            cfg->lookups = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--appends") == 0) {
+            cfg->appends = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--batch") == 0) {
+            if (parse_batches(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--dir") == 0) {
+            cfg->dir = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->records >= 1 && cfg->records < UINT32_MAX && cfg->lookups >= 1 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 1000000, 1000000, 20000, { 16, 256, 4096 }, 3, "/var/tmp", BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char flat[4096], store[4096];
+    snprintf(flat, sizeof(flat), "%s/bench_recstore_%ld.bin", cfg.dir, (long)getpid());
+    snprintf(store, sizeof(store), "%s/bench_recstore_%ld.rs", cfg.dir, (long)getpid());
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_recstore: %llu records of %zu bytes; files in %s\n\n", (unsigned long long)cfg.records,
+               sizeof(Rec), cfg.dir);
+        printf("  %-7s %-9s %6s %10s %10s %9s\n", "op", "method", "batch", "ops", "ns/op", "Mops/s");
+        break;
+    case BENCH_FMT_CSV:
+        printf("op,method,batch,ops,ns_per_op,mops\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"recstore\",\n  \"results\": [");
+        break;
+    }
+
+    int bad = 0, err = 0;
+    if (load(&cfg, flat, store) != 0 || run_get(&cfg, flat, store, &bad) != 0 ||
+        run_find(&cfg, store, &bad) != 0)
+        err = errno;
+
+    /* Each batch size appends to fresh copies of the loaded files */
+    for (int b = 0; !err && b < cfg.n_batches; b++) {
+        uint64_t ns;
+        if (load(&cfg, flat, store) != 0) {
+            err = errno;
+            break;
+        }
+        if (stdio_append(flat, cfg.records, cfg.appends, cfg.batches[b], &ns) != 0) {
+            err = errno;
+            break;
+        }
+        report(&cfg, "append", "stdio", cfg.batches[b], cfg.appends, ns);
+        if (rs_append_run(store, cfg.records, cfg.appends, cfg.batches[b], &ns) != 0) {
+            err = errno;
+            break;
+        }
+        report(&cfg, "append", "recstore", cfg.batches[b], cfg.appends, ns);
+        if (check_appends(&cfg, flat, store, &bad) != 0) err = errno;
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    unlink(flat);
+    unlink(store);
+    if (err) {
+        fprintf(stderr, "bench_recstore: %s\n", strerror(err));
+        return 1;
+    }
+    if (bad) fprintf(stderr, "bench_recstore: records read back wrong\n");
+    return bad ? 1 : 0;
+}
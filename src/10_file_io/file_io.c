@@ -9,9 +9,12 @@
  *   4. Buffering — setvbuf, fflush, line vs full vs none
  *   5. Error handling — ferror, feof, perror, errno
  *   6. Formatted input — fscanf patterns and format string safety
+ *   7. Bulk I/O engines — read/write, O_DIRECT, mmap, io_uring (ioengine.h)
+ *   8. A memory-mapped record file — tagged header, WAL, key index (recstore.h)
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/10_file_io \
- *            src/10_file_io/file_io.c
+ *            src/10_file_io/file_io.c src/10_file_io/ioengine.c \
+ *            src/10_file_io/recstore.c
  * Run:   ./bin/10_file_io
  *
  * Try these:
@@ -21,7 +24,12 @@
  *   - Open a file with "a" mode and run twice — what happens?
  */
 
+#define _POSIX_C_SOURCE 200809L    /* clock_gettime() for bench.h */
+
 #include "../../include/common.h"
+#include "../../include/bench.h"
+#include "ioengine.h"
+#include "recstore.h"
 
 /* Temp file paths — using /tmp so demos are safe to run anywhere    */
 #define TEXT_FILE   "/tmp/demo_text.txt"
@@ -116,7 +124,8 @@ static void demo_binary_io(void)
 
     printf("  Warning: binary files are NOT portable across different\n");
     printf("  architectures (endianness) or compilers (struct padding).\n");
-    printf("  Use text/JSON/protobuf for portable data exchange.\n\n");
+    printf("  Use text/JSON/protobuf for portable data exchange — or\n");
+    printf("  a header that records the layout (Section 8).\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════
@@ -160,6 +169,8 @@ static void demo_fseek(void)
     fclose(f);
 }
 
+#define BUFFER_LINES 20000
+
 /* ════════════════════════════════════════════════════════════════
  *  Section 4: Buffering Modes
  *  setvbuf, fflush — controlling when data actually gets written.
@@ -201,6 +212,25 @@ static void demo_buffering(void)
     printf("  fclose() calls fflush() automatically.\n");
     printf("  But crash before fclose → buffered data may be lost!\n");
     printf("  For critical data: fflush() after each write.\n\n");
+
+    /* The buffer size is how many write() calls the lines cost      */
+    printf("  %d short fprintf lines, by buffer size:\n", BUFFER_LINES);
+    static const size_t sizes[] = { 0, 256, 4096, 65536 };
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++) {
+        f = fopen("/tmp/demo_buffer.txt", "w");
+        if (!f) { perror("fopen"); return; }
+        if (sizes[i]) setvbuf(f, NULL, _IOFBF, sizes[i]);
+        else          setvbuf(f, NULL, _IONBF, 0);
+        uint64_t t0 = bench_now_ns();
+        for (int n = 0; n < BUFFER_LINES; n++)
+            fprintf(f, "%06d level=info msg=ok\n", n);
+        fclose(f);
+        uint64_t ns = bench_now_ns() - t0;
+        if (sizes[i]) printf("    _IOFBF %6zu bytes: %7.2f ms\n", sizes[i], (double)ns / 1e6);
+        else          printf("    _IONBF            : %7.2f ms   (a write() per fprintf)\n", (double)ns / 1e6);
+    }
+    printf("  Any buffer turns thousands of write()s into a few; after\n");
+    printf("  that the cost is formatting.  Bulk data: Section 7.\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════
@@ -295,6 +325,136 @@ static void demo_formatted_io(void)
     printf("    printf(\"%%s\", user_input);  // Safe: format is fixed.\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 7: Bulk I/O Engines
+ *  One io_scan() interface, several ways to get the bytes in.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define ENGINE_FILE  "/tmp/demo_engine.log"
+#define ENGINE_LINES 200000
+
+static int count_newlines(const void *data, size_t len, void *ctx)
+{
+    const char *p = data, *end = p + len;
+    while ((p = memchr(p, '\n', (size_t)(end - p)))) {
+        (*(long *)ctx)++;
+        p++;
+    }
+    return 0;               /* nonzero would stop the scan here     */
+}
+
+static void demo_io_engine(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 7: Bulk I/O Engines                       ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    FILE *f = fopen(ENGINE_FILE, "w");
+    if (!f) { perror("fopen"); return; }
+    for (int n = 0; n < ENGINE_LINES; n++)
+        fprintf(f, "2026-10-14T12:00:%02d.%06dZ web-01 level=info status=200\n", n / 1000 % 60, n % 1000000);
+    fclose(f);
+
+    /* Same callback, same file; only the strategy changes          */
+    printf("  Counting the lines of a %d-line log with io_scan():\n", ENGINE_LINES);
+    for (int b = 0; b < IO_BACKENDS; b++) {
+        IoStrategy s = { (IoBackend)b, 0, 0 };
+        long       lines = 0;
+        uint64_t   t0 = bench_now_ns();
+        int64_t    n  = io_scan(ENGINE_FILE, count_newlines, &lines, &s);
+        uint64_t   ns = bench_now_ns() - t0;
+        if (n < 0)
+            printf("    %-16s n/a (%s)\n", io_backend_name((IoBackend)b), strerror(errno));
+        else
+            printf("    %-16s %6ld lines, %8lld bytes, %6.2f ms\n", io_backend_name((IoBackend)b), lines,
+                   (long long)n, (double)ns / 1e6);
+    }
+    printf("\n");
+
+    printf("  stdio copies every byte into its buffer and out again;\n");
+    printf("  read() fills ours directly; mmap() skips the copy; O_DIRECT\n");
+    printf("  skips the page cache; io_uring keeps several reads in flight.\n");
+    printf("  sendfile/copy_file_range only copy — the bytes stay in the\n");
+    printf("  kernel.  Compare them hot and cold with bench_fileio.\n\n");
+    remove(ENGINE_FILE);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: Memory-Mapped Record File
+ *  Fixed-stride rows behind a tagged header: lookups are pointers.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define STORE_FILE    "/tmp/demo_records.rs"
+#define STORE_RECORDS 1000
+
+typedef struct {
+    uint64_t id;            /* the key                              */
+    char     name[16];
+    int32_t  score;
+    int32_t  spare;         /* explicit, so there is no hidden padding */
+} StoredRecord;
+
+/* Any change to the struct changes the tag                         */
+#define STORED_LAYOUT ((uint32_t)(sizeof(StoredRecord) << 16 | offsetof(StoredRecord, name) << 8 | \
+                                  offsetof(StoredRecord, score)))
+
+static void demo_record_store(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: Memory-Mapped Record File              ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    remove(STORE_FILE);
+    RecStoreOpts o  = { sizeof(StoredRecord), offsetof(StoredRecord, id), STORED_LAYOUT, 64 };
+    RecStore    *rs = rs_open(STORE_FILE, &o, RS_CREATE);
+    if (!rs) { perror("rs_open"); return; }
+
+    /* Appends go to the WAL; every 64 they are msync()ed as a batch */
+    for (int i = 0; i < STORE_RECORDS; i++) {
+        StoredRecord r = { 1000003u * (uint64_t)i % 999983u, "", i % 101, 0 };
+        snprintf(r.name, sizeof(r.name), "user-%04d", i);
+        rs_append(rs, &r);
+    }
+    printf("  Appended %d records: %d WAL commits, not %d fflush()es.\n", STORE_RECORDS,
+           (STORE_RECORDS + 63) / 64, STORE_RECORDS);
+    rs_build_index(rs);
+    rs_close(rs);
+
+    /* Reopen read-only: the file is mapped, nothing is read yet    */
+    rs = rs_open(STORE_FILE, &o, RS_RDONLY);
+    if (!rs) { perror("rs_open"); return; }
+    const StoredRecord *r = rs_get(rs, 500);
+    printf("  rs_get(500):      %s, score %d, id %llu  (a pointer, no copy)\n", r->name, r->score,
+           (unsigned long long)r->id);
+    int64_t row = rs_find(rs, r->id);
+    printf("  rs_find(%llu):  row %lld  (binary search of the sorted index)\n", (unsigned long long)r->id,
+           (long long)row);
+    rs_close(rs);
+
+    /* The header says which byte order and layout wrote the rows   */
+    FILE *f = fopen(STORE_FILE, "rb");
+    unsigned char h[16];
+    if (f && fread(h, 1, sizeof(h), f) == sizeof(h)) {
+        printf("  Header: ");
+        for (size_t i = 0; i < sizeof(h); i++) printf("%02x ", h[i]);
+        printf("\n          magic \"%.8s\", version %d, endian tag %02x %02x %02x %02x\n", (char *)h, h[8], h[12],
+               h[13], h[14], h[15]);
+    }
+    if (f) fclose(f);
+
+    /* A reader with a different struct is refused, not misled      */
+    RecStoreOpts other = o;
+    other.layout ^= 1;
+    errno = 0;
+    rs = rs_open(STORE_FILE, &other, RS_RDONLY);
+    printf("  Opening with another layout tag: %s\n\n", rs ? "accepted?!" : strerror(errno));
+    if (rs) rs_close(rs);
+
+    printf("  fseek+fread per record is two calls and a copy; here row n\n");
+    printf("  is base + n * stride.  bench_recstore times both ways.\n\n");
+    remove(STORE_FILE);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main — run all demos in order
  * ════════════════════════════════════════════════════════════════ */
@@ -311,6 +471,8 @@ int main(void)
     demo_buffering();
     demo_error_handling();
     demo_formatted_io();
+    demo_io_engine();
+    demo_record_store();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: stdio.h gives you text (fprintf/fgets) and\n");
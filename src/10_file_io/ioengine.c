@@ -0,0 +1,687 @@
+/*
+ * Chapter 10 — Moving file data in bulk, several ways
+ *
+ * See ioengine.h.  Every backend is a loop over the file; they differ
+ * in who copies the bytes and how many system calls it takes:
+ *
+ *   stdio      read() into the FILE buffer, memcpy() out per record
+ *   read       one read() per buffer, straight into ours
+ *   direct     the same, but the device DMAs into our buffer
+ *   mmap       page faults, no copy until write() (for copy)
+ *   sendfile / copy_file_range   one call; user space never sees it
+ *   io_uring   queue_depth requests in flight, one io_uring_enter()
+ *              to submit a batch and reap completions
+ *
+ * io_uring is driven through its two shared rings by hand: the kernel
+ * consumes submission entries (SQEs) at the SQ head while we produce at
+ * the tail, and the other way round for completions (CQEs) — a pair of
+ * SPSC rings, with release stores publishing the tails and heads.
+ */
+
+#define _GNU_SOURCE         /* O_DIRECT, copy_file_range(), syscall() */
+
+#include "ioengine.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+
+#define ALIGN        4096                   /* O_DIRECT buffer, offset and length unit */
+#define STDIO_RECORD 4096                   /* fread()/fwrite() size for IO_STDIO */
+#define DEFAULT_BUF  ((size_t)1 << 20)
+#define URING_BUF    ((size_t)128 << 10)
+#define URING_QD     8
+#define CHUNK_MAX    ((size_t)1 << 30)      /* per sendfile()/copy_file_range() call */
+
+static const char *names[IO_BACKENDS] = {
+    "stdio", "read", "direct", "mmap", "sendfile", "copy_file_range", "io_uring"
+};
+
+const char *io_backend_name(IoBackend b)
+{
+    return b >= 0 && b < IO_BACKENDS ? names[b] : "?";
+}
+
+int io_parse_backend(const char *s, IoBackend *out)
+{
+    for (int b = 0; b < IO_BACKENDS; b++)
+        if (strcmp(s, names[b]) == 0) {
+            *out = (IoBackend)b;
+            return 0;
+        }
+    return -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Helpers
+ * ════════════════════════════════════════════════════════════════ */
+
+static size_t buf_size(const IoStrategy *s)
+{
+    size_t n = s->buf_size ? s->buf_size : s->backend == IO_URING ? URING_BUF : DEFAULT_BUF;
+    if (s->backend == IO_DIRECT) n = (n + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+    return n;
+}
+
+static void *alloc_aligned(size_t n)
+{
+    void *p = NULL;
+    int   e = posix_memalign(&p, ALIGN, n);
+    if (e) {
+        errno = e;
+        return NULL;
+    }
+    return p;
+}
+
+/* Fill buf unless the file ends first.  An O_DIRECT read past an
+ * unaligned end would be at an unaligned offset (EINVAL): stop there */
+static ssize_t read_full(int fd, void *buf, size_t n, int direct)
+{
+    size_t got = 0;
+    while (got < n && !(direct && got % ALIGN)) {
+        ssize_t r = read(fd, (char *)buf + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return -1;
+        if (r == 0) break;
+        got += (size_t)r;
+    }
+    return (ssize_t)got;
+}
+
+static int write_all(int fd, const void *buf, size_t n)
+{
+    while (n) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) return -1;
+        buf = (const char *)buf + w;
+        n  -= (size_t)w;
+    }
+    return 0;
+}
+
+static int open_src(const char *path, int flags)
+{
+    return open(path, O_RDONLY | O_CLOEXEC | flags);
+}
+
+static int open_dst(const char *path, int flags)
+{
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | flags, 0644);
+}
+
+/* Close both, keeping the first errno; -1 if there was an error */
+static int64_t finish(int64_t ret, int in, int out)
+{
+    int e = errno;
+    if (in >= 0) close(in);
+    if (out >= 0 && close(out) != 0 && ret >= 0) {
+        e   = errno;
+        ret = -1;
+    }
+    errno = e;
+    return ret;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  stdio
+ * ════════════════════════════════════════════════════════════════ */
+
+static FILE *open_stream(const char *path, const char *mode, size_t size)
+{
+    FILE *f = fopen(path, mode);
+    if (f && size) setvbuf(f, NULL, _IOFBF, size);
+    return f;
+}
+
+static int64_t stdio_scan(const char *path, IoScanFn fn, void *ctx, size_t size)
+{
+    FILE *f = open_stream(path, "rb", size);
+    if (!f) return -1;
+    char    rec[STDIO_RECORD];
+    int64_t total = 0;
+    size_t  n;
+    errno = 0;
+    while ((n = fread(rec, 1, sizeof(rec), f)) > 0) {
+        total += (int64_t)n;
+        if (fn(rec, n, ctx)) break;
+    }
+    if (ferror(f)) {
+        int e = errno ? errno : EIO;
+        fclose(f);
+        errno = e;
+        return -1;
+    }
+    fclose(f);
+    return total;
+}
+
+static int64_t stdio_copy(const char *src, const char *dst, size_t size)
+{
+    FILE *in = open_stream(src, "rb", size);
+    if (!in) return -1;
+    FILE *out = open_stream(dst, "wb", size);
+    if (!out) {
+        int e = errno;
+        fclose(in);
+        errno = e;
+        return -1;
+    }
+    char    rec[STDIO_RECORD];
+    int64_t total = 0;
+    size_t  n;
+    errno = 0;
+    while ((n = fread(rec, 1, sizeof(rec), in)) > 0) {
+        if (fwrite(rec, 1, n, out) != n) break;
+        total += (int64_t)n;
+    }
+    int bad = ferror(in) || ferror(out);
+    int e   = errno ? errno : EIO;
+    fclose(in);
+    if (fclose(out) != 0 && !bad) {
+        bad = 1;
+        e   = errno;
+    }
+    if (bad) {
+        errno = e;
+        return -1;
+    }
+    return total;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  read()/write(), with or without O_DIRECT
+ * ════════════════════════════════════════════════════════════════ */
+
+static int64_t rw_scan(const char *path, IoScanFn fn, void *ctx, size_t size, int direct)
+{
+    int in = open_src(path, direct ? O_DIRECT : 0);
+    if (in < 0) return -1;
+    if (!direct) posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    void *buf = alloc_aligned(size);
+    if (!buf) return finish(-1, in, -1);
+    int64_t total = 0;
+    ssize_t n;
+    while ((n = read_full(in, buf, size, direct)) > 0) {
+        total += n;
+        if (fn(buf, (size_t)n, ctx)) break;
+    }
+    free(buf);
+    return finish(n < 0 ? -1 : total, in, -1);
+}
+
+static int64_t rw_copy(const char *src, const char *dst, size_t size, int direct)
+{
+    int in = open_src(src, direct ? O_DIRECT : 0);
+    if (in < 0) return -1;
+    int out = open_dst(dst, direct ? O_DIRECT : 0);
+    if (out < 0) return finish(-1, in, -1);
+    if (!direct) posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    void *buf = alloc_aligned(size);
+    if (!buf) return finish(-1, in, out);
+    int64_t total = 0;
+    ssize_t n;
+    while ((n = read_full(in, buf, size, direct)) > 0) {
+        /* The unaligned tail cannot go through O_DIRECT: finish buffered */
+        if (direct && n % ALIGN) fcntl(out, F_SETFL, fcntl(out, F_GETFL) & ~O_DIRECT);
+        if (write_all(out, buf, (size_t)n) != 0) {
+            n = -1;
+            break;
+        }
+        total += n;
+    }
+    free(buf);
+    return finish(n < 0 ? -1 : total, in, out);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  mmap
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Map all of fd; *len 0 (and NULL) for an empty file */
+static void *map_file(int fd, size_t *len)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) return MAP_FAILED;
+    *len = (size_t)st.st_size;
+    if (*len == 0) return NULL;
+    void *m = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m != MAP_FAILED) madvise(m, *len, MADV_SEQUENTIAL);
+    return m;
+}
+
+static int64_t mmap_scan(const char *path, IoScanFn fn, void *ctx, size_t size)
+{
+    int in = open_src(path, 0);
+    if (in < 0) return -1;
+    size_t len;
+    char  *m = map_file(in, &len);
+    if (m == MAP_FAILED) return finish(-1, in, -1);
+    int64_t total = 0;
+    for (size_t off = 0; off < len; off += size) {
+        size_t n = len - off < size ? len - off : size;
+        total += (int64_t)n;
+        if (fn(m + off, n, ctx)) break;
+    }
+    if (m) munmap(m, len);
+    return finish(total, in, -1);
+}
+
+static int64_t mmap_copy(const char *src, const char *dst)
+{
+    int in = open_src(src, 0);
+    if (in < 0) return -1;
+    int out = open_dst(dst, 0);
+    if (out < 0) return finish(-1, in, -1);
+    size_t len;
+    char  *m = map_file(in, &len);
+    if (m == MAP_FAILED) return finish(-1, in, out);
+    int ok = write_all(out, m, len) == 0;
+    int e  = errno;
+    if (m) munmap(m, len);
+    errno = e;
+    return finish(ok ? (int64_t)len : -1, in, out);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  sendfile() and copy_file_range()
+ * ════════════════════════════════════════════════════════════════ */
+
+static int64_t kernel_copy(const char *src, const char *dst, int cfr)
+{
+    int in = open_src(src, 0);
+    if (in < 0) return -1;
+    int out = open_dst(dst, 0);
+    if (out < 0) return finish(-1, in, -1);
+    int64_t total = 0;
+    for (;;) {
+        ssize_t n = cfr ? copy_file_range(in, NULL, out, NULL, CHUNK_MAX, 0)
+                        : sendfile(out, in, NULL, CHUNK_MAX);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return finish(-1, in, out);
+        if (n == 0) break;
+        total += n;
+    }
+    return finish(total, in, out);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  io_uring
+ * ════════════════════════════════════════════════════════════════ */
+
+#ifdef __NR_io_uring_setup
+
+typedef struct {
+    int                  fd;
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *sq_ring, *cq_ring;
+    size_t               sq_len, cq_len, sqes_len;
+    unsigned             to_submit;     /* queued SQEs the kernel has not seen */
+    unsigned             inflight;      /* submitted or queued, not yet reaped */
+} Uring;
+
+static int uring_init(Uring *u, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    u->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (u->fd < 0) return -1;
+
+    u->sq_len   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_len   = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    /* Since 5.4 one mapping holds both rings */
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_len > u->sq_len) u->sq_len = u->cq_len;
+        u->cq_len = u->sq_len;
+    }
+    u->sq_ring = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                      IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) goto fail;
+    u->cq_ring = u->sq_ring;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        u->cq_ring = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                          IORING_OFF_CQ_RING);
+        if (u->cq_ring == MAP_FAILED) goto fail_sq;
+    }
+    u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                   IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) goto fail_cq;
+
+    char *sq = u->sq_ring, *cq = u->cq_ring;
+    u->sq_head  = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+
+fail_cq:
+    if (u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_len);
+fail_sq:
+    munmap(u->sq_ring, u->sq_len);
+fail: {
+        int e = errno;
+        close(u->fd);
+        errno = e;
+        return -1;
+    }
+}
+
+static void uring_free(Uring *u)
+{
+    munmap(u->sqes, u->sqes_len);
+    if (u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_len);
+    munmap(u->sq_ring, u->sq_len);
+    close(u->fd);
+}
+
+/* Queue one read or write; the caller keeps at most `entries` in flight,
+ * so the SQ cannot be full */
+static void uring_prep(Uring *u, int op, int fd, void *buf, size_t len, uint64_t off, uint64_t tag)
+{
+    unsigned             tail = *u->sq_tail;
+    unsigned             idx  = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe  = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = (uint8_t)op;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = (uint32_t)len;
+    sqe->off       = off;
+    sqe->user_data = tag;
+    u->sq_array[idx] = idx;
+    /* The SQE must be visible before the kernel sees the new tail */
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    u->to_submit++;
+    u->inflight++;
+}
+
+/* Submit what is queued and reap one completion, sleeping if none is
+ * ready; 0, or -1 with errno if io_uring_enter() fails */
+static int uring_wait(Uring *u, struct io_uring_cqe *out)
+{
+    for (;;) {
+        unsigned head = *u->cq_head;
+        if (!u->to_submit && head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+            *out = u->cqes[head & *u->cq_mask];
+            __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+            u->inflight--;
+            return 0;
+        }
+        long n = syscall(__NR_io_uring_enter, u->fd, u->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        u->to_submit -= (unsigned)n;
+    }
+}
+
+/* Reap everything still in flight, so no buffer is freed under the
+ * kernel's feet */
+static void uring_drain(Uring *u)
+{
+    struct io_uring_cqe cqe;
+    while (u->inflight && uring_wait(u, &cqe) == 0) {}
+}
+
+/* One buffer per queue slot; each slot has at most one request in flight */
+typedef struct {
+    char    *buf;
+    uint64_t block;
+    size_t   want, fill;        /* the block's length, and how much has moved */
+    int      writing;
+} Slot;
+
+typedef struct {
+    Uring    u;
+    Slot    *slot;
+    char    *bufs;
+    unsigned qd;
+    size_t   size;
+    uint64_t next, limit;       /* the next block to start; blocks to move */
+} UringJob;
+
+static int uring_job_init(UringJob *j, int in, const IoStrategy *s)
+{
+    struct stat st;
+    if (fstat(in, &st) != 0) return -1;
+    memset(j, 0, sizeof(*j));
+    j->qd    = s->queue_depth ? s->queue_depth : URING_QD;
+    j->size  = buf_size(s);
+    j->limit = ((uint64_t)st.st_size + j->size - 1) / j->size;
+    if (j->size > UINT32_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    j->slot = calloc(j->qd, sizeof(Slot));
+    j->bufs = alloc_aligned(j->size * j->qd);
+    if (!j->slot || !j->bufs || uring_init(&j->u, j->qd) != 0) {
+        int e = errno;
+        free(j->slot);
+        free(j->bufs);
+        errno = e;
+        return -1;
+    }
+    for (unsigned i = 0; i < j->qd; i++) j->slot[i].buf = j->bufs + (size_t)i * j->size;
+    return 0;
+}
+
+static void uring_job_free(UringJob *j)
+{
+    uring_drain(&j->u);
+    uring_free(&j->u);
+    free(j->slot);
+    free(j->bufs);
+}
+
+/* Read the rest of the slot's block */
+static void slot_read(UringJob *j, unsigned i, int in)
+{
+    Slot *sl = &j->slot[i];
+    uring_prep(&j->u, IORING_OP_READ, in, sl->buf + sl->fill, sl->want - sl->fill,
+               sl->block * j->size + sl->fill, i);
+}
+
+static void slot_start(UringJob *j, unsigned i, int in)
+{
+    Slot *sl    = &j->slot[i];
+    sl->block   = j->next++;
+    sl->want    = j->size;
+    sl->fill    = 0;
+    sl->writing = 0;
+    slot_read(j, i, in);
+}
+
+/* A read completed with res: 1 if the block is complete, 0 if more was
+ * asked for, -1 on error.  End of file early (a shorter file than at
+ * the start, or the last block) ends the job at this block */
+static int slot_read_done(UringJob *j, unsigned i, int in, int res)
+{
+    Slot *sl = &j->slot[i];
+    if (res < 0) {
+        errno = -res;
+        return -1;
+    }
+    if (res == 0) {
+        sl->want = sl->fill;
+        if (j->limit > sl->block + 1) j->limit = sl->block + 1;
+        return 1;
+    }
+    sl->fill += (size_t)res;
+    if (sl->fill < sl->want) {
+        slot_read(j, i, in);
+        return 0;
+    }
+    return 1;
+}
+
+/* Blocks complete out of order; slot block % qd holds block, and is
+ * handed to fn — and refilled — only when every earlier block has been */
+static int64_t uring_scan(const char *path, IoScanFn fn, void *ctx, const IoStrategy *s)
+{
+    int in = open_src(path, 0);
+    if (in < 0) return -1;
+    UringJob j;
+    if (uring_job_init(&j, in, s) != 0) return finish(-1, in, -1);
+
+    int    *ready = calloc(j.qd, sizeof(int));
+    int64_t total = 0;
+    int     err   = ready ? 0 : errno;
+    for (unsigned i = 0; !err && i < j.qd && j.next < j.limit; i++) slot_start(&j, i, in);
+
+    for (uint64_t deliver = 0; !err && deliver < j.limit;) {
+        unsigned i = (unsigned)(deliver % j.qd);
+        if (!ready[i]) {
+            struct io_uring_cqe cqe;
+            if (uring_wait(&j.u, &cqe) != 0) {
+                err = errno;
+                break;
+            }
+            unsigned c = (unsigned)cqe.user_data;
+            int      r = slot_read_done(&j, c, in, cqe.res);
+            if (r < 0) err = errno;
+            if (r > 0) ready[c] = 1;
+            continue;
+        }
+        Slot *sl = &j.slot[i];
+        total += (int64_t)sl->want;
+        ready[i] = 0;
+        deliver++;
+        if (fn(sl->buf, sl->want, ctx)) break;
+        if (j.next < j.limit) slot_start(&j, i, in);
+    }
+    free(ready);
+    uring_job_free(&j);
+    errno = err;
+    return finish(err ? -1 : total, in, -1);
+}
+
+/* Each slot reads its block, writes it at the same offset, then starts
+ * the next block: up to qd reads and writes in flight, in any order */
+static int64_t uring_copy(const char *src, const char *dst, const IoStrategy *s)
+{
+    int in = open_src(src, 0);
+    if (in < 0) return -1;
+    int out = open_dst(dst, 0);
+    if (out < 0) return finish(-1, in, -1);
+    UringJob j;
+    if (uring_job_init(&j, in, s) != 0) return finish(-1, in, out);
+
+    int64_t total = 0;
+    int     err   = 0;
+    for (unsigned i = 0; i < j.qd && j.next < j.limit; i++) slot_start(&j, i, in);
+
+    while (!err && j.u.inflight) {
+        struct io_uring_cqe cqe;
+        if (uring_wait(&j.u, &cqe) != 0) {
+            err = errno;
+            break;
+        }
+        unsigned i  = (unsigned)cqe.user_data;
+        Slot    *sl = &j.slot[i];
+        if (!sl->writing) {
+            int r = slot_read_done(&j, i, in, cqe.res);
+            if (r < 0) err = errno;
+            if (r <= 0) continue;
+            if (sl->block < j.limit && sl->want) {
+                sl->writing = 1;
+                sl->fill    = 0;
+                uring_prep(&j.u, IORING_OP_WRITE, out, sl->buf, sl->want, sl->block * j.size, i);
+                continue;
+            }
+        } else {
+            if (cqe.res <= 0) {
+                err = cqe.res < 0 ? -cqe.res : EIO;
+                break;
+            }
+            sl->fill += (size_t)cqe.res;
+            total    += cqe.res;
+            if (sl->fill < sl->want) {
+                uring_prep(&j.u, IORING_OP_WRITE, out, sl->buf + sl->fill, sl->want - sl->fill,
+                           sl->block * j.size + sl->fill, i);
+                continue;
+            }
+        }
+        if (j.next < j.limit) slot_start(&j, i, in);
+    }
+    uring_job_free(&j);
+    errno = err;
+    return finish(err ? -1 : total, in, out);
+}
+
+#else  /* no io_uring in these headers */
+
+static int64_t uring_scan(const char *path, IoScanFn fn, void *ctx, const IoStrategy *s)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+static int64_t uring_copy(const char *src, const char *dst, const IoStrategy *s)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+/* ════════════════════════════════════════════════════════════════
+ *  Entry points
+ * ════════════════════════════════════════════════════════════════ */
+
+static const IoStrategy default_strategy = { IO_READ, 0, 0 };
+
+int64_t io_scan(const char *path, IoScanFn fn, void *ctx, const IoStrategy *s)
+{
+    if (!s) s = &default_strategy;
+    switch (s->backend) {
+    case IO_STDIO:  return stdio_scan(path, fn, ctx, s->buf_size);
+    case IO_READ:   return rw_scan(path, fn, ctx, buf_size(s), 0);
+    case IO_DIRECT: return rw_scan(path, fn, ctx, buf_size(s), 1);
+    case IO_MMAP:   return mmap_scan(path, fn, ctx, buf_size(s));
+    case IO_URING:  return uring_scan(path, fn, ctx, s);
+    case IO_SENDFILE:
+    case IO_COPY_FILE_RANGE:
+        errno = EOPNOTSUPP;
+        return -1;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+int64_t io_copy(const char *src, const char *dst, const IoStrategy *s)
+{
+    if (!s) s = &default_strategy;
+    switch (s->backend) {
+    case IO_STDIO:           return stdio_copy(src, dst, s->buf_size);
+    case IO_READ:            return rw_copy(src, dst, buf_size(s), 0);
+    case IO_DIRECT:          return rw_copy(src, dst, buf_size(s), 1);
+    case IO_MMAP:            return mmap_copy(src, dst);
+    case IO_SENDFILE:        return kernel_copy(src, dst, 0);
+    case IO_COPY_FILE_RANGE: return kernel_copy(src, dst, 1);
+    case IO_URING:           return uring_copy(src, dst, s);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
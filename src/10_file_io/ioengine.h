@@ -0,0 +1,70 @@
+/*
+ * Chapter 10 — Moving file data in bulk, several ways
+ *
+ * One interface — copy a file, or scan one through a callback — over
+ * the ways Linux offers to move the bytes:
+ *
+ *   IO_STDIO            fread()/fwrite() of 4 KB records through a
+ *                       stdio buffer of buf_size (0: stdio's own size)
+ *   IO_READ             read()/write() of buf_size into one page-aligned
+ *                       buffer, with POSIX_FADV_SEQUENTIAL
+ *   IO_DIRECT           the same with O_DIRECT: no page cache, DMA
+ *                       straight into the buffer; buf_size is rounded
+ *                       to 4 KB, and the file system must support it
+ *   IO_MMAP             map the source with MADV_SEQUENTIAL; scan hands
+ *                       the mapping out buf_size at a time, copy
+ *                       write()s from it: no copy into a user buffer
+ *   IO_SENDFILE         sendfile(): the kernel copies page cache to the
+ *                       destination, and nothing reaches user space
+ *   IO_COPY_FILE_RANGE  copy_file_range(): the same, and on file
+ *                       systems that can (XFS, Btrfs, NFS) shares or
+ *                       offloads the blocks rather than copying them
+ *   IO_URING            io_uring (raw system calls, no liburing) with
+ *                       queue_depth reads — and for copy writes — of
+ *                       buf_size in flight
+ *
+ * buf_size 0 means 1 MB (128 KB per entry for IO_URING); queue_depth 0
+ * means 8; a NULL strategy is IO_READ with both defaults.  sendfile and copy_file_range cannot scan: the data never
+ * reaches user space (EOPNOTSUPP).
+ *
+ * io_scan() hands the file to fn in order, in pieces of at most
+ * buf_size (4 KB for IO_STDIO); fn returns 0 to go on, anything else
+ * to stop.  Both return the bytes moved or scanned, or -1 with errno:
+ * from the failing system call, EINVAL when O_DIRECT is refused,
+ * ENOSYS or EPERM when io_uring is unavailable.  io_copy() creates or
+ * truncates dst (mode 0644) and does not fsync it.
+ */
+
+#ifndef IOENGINE_H
+#define IOENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    IO_STDIO,
+    IO_READ,
+    IO_DIRECT,
+    IO_MMAP,
+    IO_SENDFILE,
+    IO_COPY_FILE_RANGE,
+    IO_URING,
+    IO_BACKENDS
+} IoBackend;
+
+typedef struct {
+    IoBackend backend;
+    size_t    buf_size;
+    unsigned  queue_depth;      /* IO_URING only */
+} IoStrategy;
+
+typedef int (*IoScanFn)(const void *data, size_t len, void *ctx);
+
+int64_t     io_copy(const char *src, const char *dst, const IoStrategy *s);
+int64_t     io_scan(const char *path, IoScanFn fn, void *ctx, const IoStrategy *s);
+
+/* "stdio", "read", "direct", "mmap", "sendfile", "copy_file_range", "io_uring" */
+const char *io_backend_name(IoBackend b);
+int         io_parse_backend(const char *s, IoBackend *out);
+
+#endif /* IOENGINE_H */
@@ -0,0 +1,408 @@
+/*
+ * Chapter 10 — A memory-mapped record file
+ *
+ * See recstore.h.  The header (the first 72 bytes of page 0):
+ *
+ *    0  magic "RECSTORE"          48  wal_base     row of WAL slot 0
+ *    8  version                   56  wal_count    committed, not applied
+ *   12  endian tag 0x01020304     64  index_count
+ *       in the writer's order
+ *   16  record_size
+ *   20  key_offset
+ *   24  layout
+ *   28  wal_records
+ *   32  count
+ *   40  capacity
+ *
+ * Every state change ends in one write of the header, well inside one
+ * disk sector, so a crash leaves either the old header or the new: the
+ * data a header points at is always msync()ed before it.  Growing the
+ * file moves the index (it sits after the records), so the header first
+ * drops it, then takes it back at its new offset; the WAL sits before
+ * the records and stays put, so a committed batch survives the move.
+ */
+
+#define _GNU_SOURCE         /* mremap() */
+
+#include "recstore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAGIC       "RECSTORE"
+#define VERSION     1
+#define ENDIAN_TAG  0x01020304u
+#define PAGE        4096
+#define HEADER      PAGE
+#define WAL_DEFAULT 1024
+#define CAP_MIN     1024
+
+typedef struct {
+    uint64_t key, row;
+} IndexEntry;
+
+struct RecStore {
+    int            fd;
+    int            rdonly;
+    unsigned char *map;
+    size_t         map_len;
+    uint32_t       stride, key_off, layout, wal_cap;
+    uint64_t       count, cap, index_count;
+    uint64_t       wal_n;       /* rows count .. count + wal_n - 1 are in the WAL */
+};
+
+/* ════════════════════════════════════════════════════════════════
+ *  Layout and header
+ * ════════════════════════════════════════════════════════════════ */
+
+static size_t round_page(uint64_t n)
+{
+    return (size_t)((n + PAGE - 1) & ~(uint64_t)(PAGE - 1));
+}
+
+static size_t wal_off(const RecStore *rs)
+{
+    return HEADER;
+}
+
+static size_t rec_off(const RecStore *rs)
+{
+    return HEADER + round_page((uint64_t)rs->wal_cap * rs->stride);
+}
+
+/* Where the index starts, at a capacity of cap rows */
+static size_t idx_off_for(const RecStore *rs, uint64_t cap)
+{
+    return rec_off(rs) + round_page(cap * rs->stride);
+}
+
+static size_t file_size(const RecStore *rs, uint64_t cap)
+{
+    return idx_off_for(rs, cap) + round_page(cap * sizeof(IndexEntry));
+}
+
+static IndexEntry *index_of(const RecStore *rs)
+{
+    return (IndexEntry *)(rs->map + idx_off_for(rs, rs->cap));
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+static uint64_t get64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+/* msync() whole pages around [off, off + len) */
+static int sync_range(RecStore *rs, size_t off, size_t len)
+{
+    if (len == 0) return 0;
+    size_t start = off & ~(size_t)(PAGE - 1);
+    return msync(rs->map + start, off + len - start, MS_SYNC);
+}
+
+static int write_header(RecStore *rs, uint64_t wal_base, uint64_t wal_count)
+{
+    unsigned char *h = rs->map;
+    uint32_t       tag = ENDIAN_TAG;
+    memcpy(h, MAGIC, 8);
+    put32(h + 8, VERSION);
+    memcpy(h + 12, &tag, 4);
+    put32(h + 16, rs->stride);
+    put32(h + 20, rs->key_off);
+    put32(h + 24, rs->layout);
+    put32(h + 28, rs->wal_cap);
+    put64(h + 32, rs->count);
+    put64(h + 40, rs->cap);
+    put64(h + 48, wal_base);
+    put64(h + 56, wal_count);
+    put64(h + 64, rs->index_count);
+    return sync_range(rs, 0, HEADER);
+}
+
+/* Check the header of a file of `size` bytes; fills rs; *wal_base and
+ * *wal_count are a committed batch still to apply */
+static int read_header(RecStore *rs, const unsigned char *h, size_t size, const RecStoreOpts *o,
+                       uint64_t *wal_base, uint64_t *wal_count)
+{
+    uint32_t tag;
+    memcpy(&tag, h + 12, 4);
+    if (memcmp(h, MAGIC, 8) != 0 || get32(h + 8) != VERSION || tag != ENDIAN_TAG) goto bad;
+    rs->stride      = get32(h + 16);
+    rs->key_off     = get32(h + 20);
+    rs->layout      = get32(h + 24);
+    rs->wal_cap     = get32(h + 28);
+    rs->count       = get64(h + 32);
+    rs->cap         = get64(h + 40);
+    *wal_base       = get64(h + 48);
+    *wal_count      = get64(h + 56);
+    rs->index_count = get64(h + 64);
+    if (o && (o->record_size != rs->stride || o->key_offset != rs->key_off || o->layout != rs->layout))
+        goto bad;
+    if (rs->stride == 0 || rs->wal_cap == 0 || rs->count > rs->cap || rs->index_count > rs->count ||
+        *wal_count > rs->wal_cap || (*wal_count && *wal_base != rs->count) || file_size(rs, rs->cap) > size)
+        goto bad;
+    return 0;
+bad:
+    errno = EPROTO;
+    return -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Growth
+ * ════════════════════════════════════════════════════════════════ */
+
+static int remap(RecStore *rs, size_t len)
+{
+    void *m = mremap(rs->map, rs->map_len, len, MREMAP_MAYMOVE);
+    if (m == MAP_FAILED) return -1;
+    rs->map     = m;
+    rs->map_len = len;
+    return 0;
+}
+
+static int grow(RecStore *rs, uint64_t need)
+{
+    uint64_t cap = rs->cap * 2 > need ? rs->cap * 2 : need;
+    uint64_t ic  = rs->index_count;
+    size_t   old = idx_off_for(rs, rs->cap);
+    size_t   len = file_size(rs, cap);
+
+    /* Only apply_wal() grows, with the batch committed but not yet
+     * applied: every header written here still carries it. */
+    if (ic) {                           /* no index while it moves */
+        rs->index_count = 0;
+        if (write_header(rs, rs->count, rs->wal_n) != 0) return -1;
+    }
+    if (ftruncate(rs->fd, (off_t)len) != 0 || remap(rs, len) != 0) return -1;
+    size_t now = idx_off_for(rs, cap);
+    memmove(rs->map + now, rs->map + old, ic * sizeof(IndexEntry));
+    rs->cap = cap;
+    if (sync_range(rs, now, ic * sizeof(IndexEntry)) != 0) return -1;
+    rs->index_count = ic;
+    return write_header(rs, rs->count, rs->wal_n);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Open and close
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Copy the WAL's n rows to their places and make them part of count */
+static int apply_wal(RecStore *rs, uint64_t n)
+{
+    if (rs->count + n > rs->cap && grow(rs, rs->count + n) != 0) return -1;
+    size_t at = rec_off(rs) + rs->count * rs->stride, len = n * rs->stride;
+    memcpy(rs->map + at, rs->map + wal_off(rs), len);
+    if (sync_range(rs, at, len) != 0) return -1;
+    rs->count += n;
+    rs->wal_n  = 0;
+    return write_header(rs, 0, 0);
+}
+
+static int create(RecStore *rs, const RecStoreOpts *o)
+{
+    if (!o || o->record_size == 0 ||
+        (o->key_offset != RS_NO_KEY && (uint64_t)o->key_offset + sizeof(uint64_t) > o->record_size)) {
+        errno = EINVAL;
+        return -1;
+    }
+    rs->stride  = o->record_size;
+    rs->key_off = o->key_offset;
+    rs->layout  = o->layout;
+    rs->wal_cap = o->wal_records ? o->wal_records : WAL_DEFAULT;
+    rs->cap     = CAP_MIN;
+    rs->map_len = file_size(rs, rs->cap);
+    if (ftruncate(rs->fd, (off_t)rs->map_len) != 0) return -1;
+    rs->map = mmap(NULL, rs->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, rs->fd, 0);
+    if (rs->map == MAP_FAILED) return -1;
+    return write_header(rs, 0, 0);
+}
+
+RecStore *rs_open(const char *path, const RecStoreOpts *o, int flags)
+{
+    RecStore *rs = calloc(1, sizeof(*rs));
+    if (!rs) return NULL;
+    rs->rdonly = (flags & RS_RDONLY) != 0;
+    rs->map    = MAP_FAILED;
+    rs->fd     = open(path, (rs->rdonly ? O_RDONLY : O_RDWR) | (flags & RS_CREATE ? O_CREAT : 0) | O_CLOEXEC,
+                      0644);
+    struct stat st;
+    if (rs->fd < 0 || fstat(rs->fd, &st) != 0) goto fail;
+
+    if (st.st_size == 0 && (flags & RS_CREATE) && !rs->rdonly) {
+        if (create(rs, o) != 0) goto fail;
+        return rs;
+    }
+    if ((size_t)st.st_size < HEADER) {
+        errno = EPROTO;
+        goto fail;
+    }
+    rs->map_len = (size_t)st.st_size;
+    rs->map     = mmap(NULL, rs->map_len, rs->rdonly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, rs->fd, 0);
+    if (rs->map == MAP_FAILED) goto fail;
+
+    uint64_t wal_base, wal_count;
+    if (read_header(rs, rs->map, rs->map_len, o, &wal_base, &wal_count) != 0) goto fail;
+    rs->wal_n = wal_count;
+    /* A batch committed before a crash: finish applying it, or — read
+     * only — serve it from the WAL */
+    if (wal_count && !rs->rdonly && apply_wal(rs, wal_count) != 0) goto fail;
+    return rs;
+
+fail: {
+        int e = errno;
+        if (rs->map != MAP_FAILED) munmap(rs->map, rs->map_len);
+        if (rs->fd >= 0) close(rs->fd);
+        free(rs);
+        errno = e;
+        return NULL;
+    }
+}
+
+int rs_close(RecStore *rs)
+{
+    int rc = rs->rdonly ? 0 : rs_commit(rs);
+    int e  = errno;
+    munmap(rs->map, rs->map_len);
+    if (close(rs->fd) != 0 && rc == 0) {
+        rc = -1;
+        e  = errno;
+    }
+    free(rs);
+    errno = e;
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Rows
+ * ════════════════════════════════════════════════════════════════ */
+
+uint64_t rs_count(const RecStore *rs)
+{
+    return rs->count + rs->wal_n;
+}
+
+const void *rs_get(const RecStore *rs, uint64_t row)
+{
+    if (row < rs->count) return rs->map + rec_off(rs) + row * rs->stride;
+    if (row - rs->count < rs->wal_n) return rs->map + wal_off(rs) + (row - rs->count) * rs->stride;
+    return NULL;
+}
+
+int64_t rs_append(RecStore *rs, const void *rec)
+{
+    if (rs->rdonly) {
+        errno = EBADF;
+        return -1;
+    }
+    if (rs->wal_n == rs->wal_cap && rs_commit(rs) != 0) return -1;
+    memcpy(rs->map + wal_off(rs) + rs->wal_n * rs->stride, rec, rs->stride);
+    return (int64_t)(rs->count + rs->wal_n++);
+}
+
+int rs_commit(RecStore *rs)
+{
+    if (rs->rdonly) {
+        errno = EBADF;
+        return -1;
+    }
+    uint64_t n = rs->wal_n;
+    if (n == 0) return 0;
+    if (sync_range(rs, wal_off(rs), n * rs->stride) != 0) return -1;
+    if (write_header(rs, rs->count, n) != 0) return -1;   /* the commit point */
+    return apply_wal(rs, n);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Key index
+ * ════════════════════════════════════════════════════════════════ */
+
+static uint64_t key_at(const RecStore *rs, const void *rec)
+{
+    uint64_t k;
+    memcpy(&k, (const unsigned char *)rec + rs->key_off, sizeof(k));
+    return k;
+}
+
+static int cmp_entry(const void *a, const void *b)
+{
+    const IndexEntry *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+/* Sort the rows added since the last build, then merge them in */
+int rs_build_index(RecStore *rs)
+{
+    if (rs->rdonly || rs->key_off == RS_NO_KEY) {
+        errno = rs->rdonly ? EBADF : EINVAL;
+        return -1;
+    }
+    IndexEntry *e  = index_of(rs);
+    uint64_t    ic = rs->index_count, n = rs->count;
+    if (ic == n) return 0;
+    for (uint64_t r = ic; r < n; r++) {
+        e[r].key = key_at(rs, rs_get(rs, r));
+        e[r].row = r;
+    }
+    qsort(e + ic, n - ic, sizeof(*e), cmp_entry);
+    if (ic && cmp_entry(&e[ic - 1], &e[ic]) > 0) {
+        IndexEntry *old = malloc(ic * sizeof(*e));
+        if (!old) return -1;
+        rs->index_count = 0;            /* no index while it is rewritten */
+        if (write_header(rs, 0, 0) != 0) {
+            free(old);
+            return -1;
+        }
+        memcpy(old, e, ic * sizeof(*e));
+        uint64_t i = 0, j = ic, k = 0;
+        while (i < ic && j < n) e[k++] = cmp_entry(&old[i], &e[j]) <= 0 ? old[i++] : e[j++];
+        while (i < ic) e[k++] = old[i++];
+        free(old);
+    }
+    if (sync_range(rs, idx_off_for(rs, rs->cap), n * sizeof(*e)) != 0) return -1;
+    rs->index_count = n;
+    return write_header(rs, 0, 0);
+}
+
+int64_t rs_find(const RecStore *rs, uint64_t key)
+{
+    if (rs->key_off == RS_NO_KEY) {
+        errno = EINVAL;
+        return -1;
+    }
+    const IndexEntry *e  = index_of(rs);
+    uint64_t          lo = 0, hi = rs->index_count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (e[mid].key < key) lo = mid + 1;
+        else                  hi = mid;
+    }
+    if (lo < rs->index_count && e[lo].key == key) return (int64_t)e[lo].row;
+    for (uint64_t r = rs->index_count; r < rs_count(rs); r++)
+        if (key_at(rs, rs_get(rs, r)) == key) return (int64_t)r;
+    errno = ENOENT;
+    return -1;
+}
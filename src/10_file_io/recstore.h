@@ -0,0 +1,76 @@
+/*
+ * Chapter 10 — A memory-mapped record file
+ *
+ * Fixed-size records in one file, opened with mmap(): row n is at a
+ * fixed offset, so reading it is pointer arithmetic — no fseek(), no
+ * fread(), no copy.  The layout, in pages:
+ *
+ *   header   magic, version, tags, counts (below)
+ *   WAL      wal_records slots: appends land here first
+ *   records  capacity slots of record_size bytes, rows 0 .. count-1
+ *   index    (key, row) pairs sorted by key, for rows 0 .. index_count-1
+ *
+ * Portability.  The header's fields are little-endian on every host,
+ * so any machine can read it; the records and the index are the
+ * writer's native layout, and the header says what that was: an
+ * endianness tag, the record size, and a layout tag the caller derives
+ * from its struct (sizeof, offsetof — whatever changes when the struct
+ * does).  A file written by a different byte order or layout, or a
+ * newer version, is refused (EPROTO) rather than misread.
+ *
+ * Appends.  rs_append() copies the record into the next WAL slot; it
+ * is readable at once, and durable after the next rs_commit() —
+ * called by rs_append() itself when the WAL is full, and by rs_close().
+ * A commit is four msync()s however many records it carries: the WAL
+ * slots, the header naming them, the rows they are copied to, and the
+ * header again.  A crash before the first header write loses that
+ * batch; after it, the next rs_open() replays the WAL.
+ *
+ * Keys.  With key_offset set, each record holds a native uint64_t key
+ * at that offset.  rs_find() binary-searches the index, then checks
+ * the rows appended since rs_build_index() last ran one by one — so
+ * rebuild after bulk loads.  Duplicate keys find the lowest indexed row.
+ *
+ * Pointers from rs_get() stay valid until the next rs_append() or
+ * rs_commit(): the file grows by doubling, and the mapping may move.
+ * One thread at a time; functions returning int return 0, or -1 with
+ * errno.
+ */
+
+#ifndef RECSTORE_H
+#define RECSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RS_NO_KEY   UINT32_MAX
+
+/* rs_open() flags */
+#define RS_CREATE   1           /* create the file if it is missing or empty */
+#define RS_RDONLY   2
+
+typedef struct RecStore RecStore;
+
+typedef struct {
+    uint32_t record_size;
+    uint32_t key_offset;        /* of the uint64_t key, or RS_NO_KEY */
+    uint32_t layout;            /* the caller's tag for the record layout */
+    uint32_t wal_records;       /* appends per commit, at most; 0: 1024 */
+} RecStoreOpts;
+
+/* o: what a new file gets, and what an existing one must match
+ * (wal_records excepted); NULL opens an existing file as it is.
+ * Returns NULL with errno; EPROTO for a file in another format */
+RecStore   *rs_open(const char *path, const RecStoreOpts *o, int flags);
+int         rs_close(RecStore *rs);
+
+uint64_t    rs_count(const RecStore *rs);                   /* including pending appends */
+const void *rs_get(const RecStore *rs, uint64_t row);       /* NULL past the end */
+
+int64_t     rs_append(RecStore *rs, const void *rec);       /* the new row, or -1 */
+int         rs_commit(RecStore *rs);
+
+int         rs_build_index(RecStore *rs);
+int64_t     rs_find(const RecStore *rs, uint64_t key);      /* a row, or -1 (ENOENT) */
+
+#endif /* RECSTORE_H */
@@ -0,0 +1,486 @@
+/*
+ * bench_bitset — bitset kernels vs a bit-by-bit loop, and Roaring vs dense
+ *
+ * Part 1: every bitset.h kernel in every variant this CPU runs, against
+ * the loop anyone would write first — one bitset_test() per bit — over
+ * two random half-full sets of --bits bits:
+ *
+ *   and or xor andnot         d = a op b                ns per 64-bit word
+ *   count and_count           popcount of a, of a & b   ns per word
+ *   extract                   every set bit of a        ns per word
+ *   rank select               random queries on a       ns per query
+ *
+ * Each variant's output (the whole of d, every extracted index, every
+ * query's answer) must equal the loop's.
+ *
+ * Part 2: at each --densities fraction of bits set, two random sets
+ * as Bitsets and as Roaring sets: their size, and the time to and/or
+ * them (Bitset and/or followed by a count, since Roaring's result
+ * knows its size).  Roaring's results must hold the same members.
+ *
+ * Timing is bench.h's runner: batches warmed up and doubled until one
+ * takes 1 ms, then the median of up to 31.
+ *
+ * Build: make bench_bitset
+ * Run:   ./bin/bench_bitset [--bits 4M] [--densities 0.5,0.01,0.0001]
+ *                           [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "bitset.h"
+#include "roaring.h"
+
+#define QUERIES       1024
+#define NAIVE_QUERIES 16            /* a bit-by-bit rank is O(n) */
+#define MAX_VARIANTS  8
+#define MAX_DENSITIES 8
+
+typedef struct {
+    uint32_t       n_bits;
+    double         densities[MAX_DENSITIES];
+    int            n_densities;
+    bench_format_t format;
+} Config;
+
+static uint64_t xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/* Each bit set with probability p */
+static void fill(Bitset *b, double p, uint64_t *seed)
+{
+    memset(b->words, 0, (size_t)b->n_words * sizeof(uint64_t));
+    if (p == 0.5) {             /* one random word is exactly that */
+        for (uint32_t w = 0; w < b->n_words; w++) b->words[w] = xorshift64(seed);
+    } else {
+        uint64_t cut = (uint64_t)(p * 18446744073709551615.0);
+        for (uint32_t i = 0; i < b->n_bits; i++)
+            if (xorshift64(seed) < cut) bitset_set(b, i);
+    }
+    if (b->n_bits & 63) b->words[b->n_words - 1] &= ((uint64_t)1 << (b->n_bits & 63)) - 1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Part 1 — one call of an operation; k NULL is the bit-by-bit loop
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    Bitset    a, b, d;
+    uint32_t *pos;                  /* extract output */
+    uint32_t  rank_q[QUERIES];
+    uint64_t  select_q[QUERIES];
+    uint64_t  ans[QUERIES];
+} Data;
+
+typedef void (*OpFn)(const BitsetKernels *k, Data *d);
+
+#define NAIVE_BULK(expr)                                                    \
+    for (uint32_t i = 0; i < d->d.n_bits; i++) {                            \
+        int x = bitset_test(&d->a, i), y = bitset_test(&d->b, i);           \
+        if (expr) bitset_set(&d->d, i);                                     \
+        else      bitset_clear(&d->d, i);                                   \
+    }
+
+static void op_and(const BitsetKernels *k, Data *d)
+{
+    if (k) k->and_words(d->d.words, d->a.words, d->b.words, d->d.n_words);
+    else   NAIVE_BULK(x && y)
+}
+
+static void op_or(const BitsetKernels *k, Data *d)
+{
+    if (k) k->or_words(d->d.words, d->a.words, d->b.words, d->d.n_words);
+    else   NAIVE_BULK(x || y)
+}
+
+static void op_xor(const BitsetKernels *k, Data *d)
+{
+    if (k) k->xor_words(d->d.words, d->a.words, d->b.words, d->d.n_words);
+    else   NAIVE_BULK(x != y)
+}
+
+static void op_andnot(const BitsetKernels *k, Data *d)
+{
+    if (k) k->andnot_words(d->d.words, d->a.words, d->b.words, d->d.n_words);
+    else   NAIVE_BULK(x && !y)
+}
+
+static void op_count(const BitsetKernels *k, Data *d)
+{
+    uint64_t n = 0;
+    if (k) n = k->count(d->a.words, d->a.n_words);
+    else
+        for (uint32_t i = 0; i < d->a.n_bits; i++) n += (uint64_t)bitset_test(&d->a, i);
+    d->ans[0] = n;
+}
+
+static void op_and_count(const BitsetKernels *k, Data *d)
+{
+    uint64_t n = 0;
+    if (k) n = k->and_count(d->a.words, d->b.words, d->a.n_words);
+    else
+        for (uint32_t i = 0; i < d->a.n_bits; i++) n += (uint64_t)(bitset_test(&d->a, i) & bitset_test(&d->b, i));
+    d->ans[0] = n;
+}
+
+static void op_extract(const BitsetKernels *k, Data *d)
+{
+    size_t n = 0;
+    if (k) n = k->extract(d->a.words, d->a.n_words, 0, d->pos);
+    else
+        for (uint32_t i = 0; i < d->a.n_bits; i++)
+            if (bitset_test(&d->a, i)) d->pos[n++] = i;
+    d->ans[0] = n;
+    bench_escape(d->pos);
+}
+
+static void op_rank(const BitsetKernels *k, Data *d)
+{
+    if (k) {
+        for (int q = 0; q < QUERIES; q++) d->ans[q] = k->rank(d->a.words, d->a.index, d->rank_q[q]);
+        return;
+    }
+    for (int q = 0; q < NAIVE_QUERIES; q++) {
+        uint64_t r = 0;
+        for (uint32_t i = 0; i < d->rank_q[q]; i++) r += (uint64_t)bitset_test(&d->a, i);
+        d->ans[q] = r;
+    }
+}
+
+static void op_select(const BitsetKernels *k, Data *d)
+{
+    if (k) {
+        for (int q = 0; q < QUERIES; q++)
+            d->ans[q] = k->select(d->a.words, d->a.index, d->a.n_blocks, d->select_q[q]);
+        return;
+    }
+    for (int q = 0; q < NAIVE_QUERIES; q++) {
+        uint64_t left = d->select_q[q];
+        uint32_t i    = 0;
+        for (; i < d->a.n_bits; i++)
+            if (bitset_test(&d->a, i) && left-- == 0) break;
+        d->ans[q] = i;
+    }
+}
+
+typedef enum { OUT_WORDS, OUT_POS, OUT_ANSWERS } OutKind;
+
+typedef struct {
+    const char *name;
+    OpFn        run;
+    OutKind     out;
+    int         per_query;          /* else per word */
+} Op;
+
+static const Op ops[] = {
+    { "and",       op_and,       OUT_WORDS,   0 },
+    { "or",        op_or,        OUT_WORDS,   0 },
+    { "xor",       op_xor,       OUT_WORDS,   0 },
+    { "andnot",    op_andnot,    OUT_WORDS,   0 },
+    { "count",     op_count,     OUT_ANSWERS, 0 },
+    { "and_count", op_and_count, OUT_ANSWERS, 0 },
+    { "extract",   op_extract,   OUT_POS,     0 },
+    { "rank",      op_rank,      OUT_ANSWERS, 1 },
+    { "select",    op_select,    OUT_ANSWERS, 1 },
+};
+#define OP_COUNT ((int)(sizeof(ops) / sizeof(ops[0])))
+
+/* Median ns per call */
+static double time_op(const Op *op, const BitsetKernels *k, Data *d)
+{
+    bench_run_t r;
+    bench_run_init(&r, op->name, 1);
+    while (bench_run_next(&r)) {
+        for (uint64_t i = 0; i < r.batch; i++) op->run(k, d);
+        bench_run_stop(&r);
+    }
+    return r.stats.median;
+}
+
+/* The output op left in d, as bytes to compare */
+static size_t output(const Op *op, const Data *d, const void **p)
+{
+    switch (op->out) {
+    case OUT_WORDS:
+        *p = d->d.words;
+        return (size_t)d->d.n_words * sizeof(uint64_t);
+    case OUT_POS:
+        *p = d->pos;
+        return (size_t)d->ans[0] * sizeof(uint32_t);
+    case OUT_ANSWERS:
+        break;
+    }
+    *p = d->ans;
+    return (op->per_query ? NAIVE_QUERIES : 1) * sizeof(uint64_t);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Part 2 — Roaring vs dense
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    double   density;
+    size_t   dense_bytes, roar_bytes;
+    double   and_dense_ns, and_roar_ns, or_dense_ns, or_roar_ns;
+    int      same;
+} RoarResult;
+
+static int to_roaring(const Bitset *b, uint32_t *scratch, Roaring *r)
+{
+    size_t n = bitset_extract(b, scratch);
+    roar_init(r);
+    for (size_t i = 0; i < n; i++)
+        if (roar_add(r, scratch[i]) != 0) return -1;
+    return 0;
+}
+
+/* r's members are exactly b's */
+static int same_members(const Roaring *r, const Bitset *b, uint32_t *x, uint32_t *y)
+{
+    size_t n = roar_count(r);
+    return n == bitset_count(b) && roar_extract(r, x) == n && bitset_extract(b, y) == n &&
+           memcmp(x, y, n * sizeof(uint32_t)) == 0;
+}
+
+#define TIME_NS(result, stmt)                                               \
+    do {                                                                    \
+        bench_run_t r_;                                                     \
+        bench_run_init(&r_, "", 1);                                         \
+        while (bench_run_next(&r_)) {                                       \
+            for (uint64_t i_ = 0; i_ < r_.batch; i_++) { stmt; }            \
+            bench_run_stop(&r_);                                            \
+        }                                                                   \
+        (result) = r_.stats.median;                                         \
+    } while (0)
+
+static int roar_case(Data *d, double p, uint64_t *seed, uint32_t *x, uint32_t *y, RoarResult *out)
+{
+    Roaring ra, rb, rd;
+    fill(&d->a, p, seed);
+    fill(&d->b, p, seed);
+    roar_init(&rd);
+    if (to_roaring(&d->a, x, &ra) != 0 || to_roaring(&d->b, x, &rb) != 0) return -1;
+
+    out->density     = p;
+    out->dense_bytes = (size_t)d->a.n_words * sizeof(uint64_t);
+    out->roar_bytes  = (roar_bytes(&ra) + roar_bytes(&rb)) / 2;
+
+    uint64_t n   = 0;
+    int      err = 0;
+    TIME_NS(out->and_dense_ns, bitset_and(&d->d, &d->a, &d->b); n += bitset_count(&d->d));
+    TIME_NS(out->and_roar_ns, err |= roar_and(&rd, &ra, &rb));
+    out->same = !err && same_members(&rd, &d->d, x, y);
+    TIME_NS(out->or_dense_ns, bitset_or(&d->d, &d->a, &d->b); n += bitset_count(&d->d));
+    TIME_NS(out->or_roar_ns, err |= roar_or(&rd, &ra, &rb));
+    out->same &= !err && same_members(&rd, &d->d, x, y);
+    bench_escape(&n);
+
+    roar_free(&ra);
+    roar_free(&rb);
+    roar_free(&rd);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--bits 4M] [--densities 0.5,0.01,0.0001]\n"
+            "       %*s [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--bits") == 0) {
+            char              *end;
+            unsigned long long n = strtoull(val, &end, 10);
+            if (*end == 'K' || *end == 'k') n <<= 10, end++;
+            else if (*end == 'M' || *end == 'm') n <<= 20, end++;
+            if (*end || n < 4096 || n > UINT32_MAX) return -1;
+            cfg->n_bits = (uint32_t)n;
+        } else if (strcmp(opt, "--densities") == 0) {
+            char list[256];
+            snprintf(list, sizeof(list), "%s", val);
+            cfg->n_densities = 0;
+            for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+                double p = atof(tok);
+                if (p <= 0 || p > 1 || cfg->n_densities == MAX_DENSITIES) return -1;
+                cfg->densities[cfg->n_densities++] = p;
+            }
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void report_op(const Config *cfg, const Op *op, const BitsetKernels *const *var, size_t n_var,
+                      const double *ns, const int *same, int *first)
+{
+    int all_same = 1;
+    for (size_t v = 1; v <= n_var; v++) all_same &= same[v];
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-10s %10.2f", op->name, ns[0]);
+        for (size_t v = 1; v <= n_var; v++) printf(" %9.3f", ns[v]);
+        printf("  %8.0fx  %s\n", ns[0] / ns[n_var], all_same ? "✓" : "RESULTS DIFFER");
+        break;
+    case BENCH_FMT_CSV:
+        for (size_t v = 0; v <= n_var; v++)
+            printf("kernel,%s,%s,%s,%.4f,%.1f,%d\n", op->name, v ? var[v - 1]->name : "naive",
+                   op->per_query ? "query" : "word", ns[v], ns[0] / ns[v], v ? same[v] : 1);
+        break;
+    case BENCH_FMT_JSON:
+        for (size_t v = 0; v <= n_var; v++) {
+            printf("%s\n    { \"test\": \"kernel\", \"op\": \"%s\", \"variant\": \"%s\", \"per\": \"%s\", "
+                   "\"ns\": %.4f, \"vs_naive\": %.1f, \"same_result\": %s }",
+                   *first ? "" : ",", op->name, v ? var[v - 1]->name : "naive", op->per_query ? "query" : "word",
+                   ns[v], ns[0] / ns[v], !v || same[v] ? "true" : "false");
+            *first = 0;
+        }
+        break;
+    }
+}
+
+static void report_roar(const Config *cfg, const RoarResult *r, int *first)
+{
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %8.4f%% %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f  %s\n", r->density * 100,
+               (double)r->dense_bytes / 1024, (double)r->roar_bytes / 1024, r->and_dense_ns / 1e3,
+               r->and_roar_ns / 1e3, r->or_dense_ns / 1e3, r->or_roar_ns / 1e3, r->same ? "✓" : "RESULTS DIFFER");
+        break;
+    case BENCH_FMT_CSV:
+        printf("roaring,%g,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%d\n", r->density, r->dense_bytes, r->roar_bytes,
+               r->and_dense_ns / 1e3, r->and_roar_ns / 1e3, r->or_dense_ns / 1e3, r->or_roar_ns / 1e3, r->same);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"test\": \"roaring\", \"density\": %g, \"dense_bytes\": %zu, \"roaring_bytes\": %zu, "
+               "\"and_dense_us\": %.3f, \"and_roaring_us\": %.3f, \"or_dense_us\": %.3f, \"or_roaring_us\": %.3f, "
+               "\"same_result\": %s }",
+               *first ? "" : ",", r->density, r->dense_bytes, r->roar_bytes, r->and_dense_ns / 1e3,
+               r->and_roar_ns / 1e3, r->or_dense_ns / 1e3, r->or_roar_ns / 1e3, r->same ? "true" : "false");
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 4u << 20, { 0.5, 0.01, 0.0001 }, 3, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const BitsetKernels *var[MAX_VARIANTS];
+    size_t               n_var = bitset_variants(var, MAX_VARIANTS);
+
+    Data      d;
+    uint64_t  seed = 0x9e3779b97f4a7c15ull;
+    uint32_t *x    = malloc((size_t)cfg.n_bits * sizeof(uint32_t));
+    uint32_t *y    = malloc((size_t)cfg.n_bits * sizeof(uint32_t));
+    void     *ref  = malloc((size_t)cfg.n_bits * sizeof(uint32_t));
+    memset(&d, 0, sizeof(d));
+    d.pos = x;
+    if (!x || !y || !ref || bitset_init(&d.a, cfg.n_bits) != 0 || bitset_init(&d.b, cfg.n_bits) != 0 ||
+        bitset_init(&d.d, cfg.n_bits) != 0) {
+        perror("bench_bitset");
+        return 1;
+    }
+    fill(&d.a, 0.5, &seed);
+    fill(&d.b, 0.5, &seed);
+    if (bitset_build_rank(&d.a) != 0) {
+        perror("bench_bitset");
+        return 1;
+    }
+    uint64_t total = bitset_count(&d.a);
+    for (int q = 0; q < QUERIES; q++) {
+        d.rank_q[q]   = (uint32_t)(xorshift64(&seed) % ((uint64_t)cfg.n_bits + 1));
+        d.select_q[q] = xorshift64(&seed) % total;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_bitset: %u bits (%u KiB per set), half full; median ns, bitset_*() use %s\n\n", cfg.n_bits,
+               d.a.n_words / 128, bitset_best()->name);
+        printf("  %-10s %10s", "", "bit-by-bit");
+        for (size_t v = 0; v < n_var; v++) printf(" %9s", var[v]->name);
+        printf("  %9s\n", "speedup");
+        break;
+    case BENCH_FMT_CSV:
+        printf("test,op,variant,per,ns,vs_naive,same_result\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"bitset\",\n  \"bits\": %u,\n  \"dispatch\": \"%s\",\n  \"results\": [",
+               cfg.n_bits, bitset_best()->name);
+        break;
+    }
+
+    int all_same = 1, first = 1;
+    for (int o = 0; o < OP_COUNT; o++) {
+        const Op   *op = &ops[o];
+        double      ns[MAX_VARIANTS + 1];
+        int         same[MAX_VARIANTS + 1];
+        const void *p;
+        double      per = op->per_query ? 1 : d.a.n_words;
+
+        ns[0] = time_op(op, NULL, &d) / (op->per_query ? NAIVE_QUERIES : per);
+        size_t len = output(op, &d, &p);
+        memcpy(ref, p, len);
+        for (size_t v = 0; v < n_var; v++) {
+            ns[v + 1]   = time_op(op, var[v], &d) / (op->per_query ? QUERIES : per);
+            same[v + 1] = output(op, &d, &p) == len && memcmp(ref, p, len) == 0;
+            all_same   &= same[v + 1];
+        }
+        report_op(&cfg, op, var, n_var, ns, same, &first);
+    }
+
+    if (cfg.format == BENCH_FMT_CSV)
+        printf("test,density,dense_bytes,roaring_bytes,and_dense_us,and_roaring_us,or_dense_us,or_roaring_us,"
+               "same_result\n");
+    if (cfg.format == BENCH_FMT_TEXT) {
+        printf("\n  Roaring vs dense, two random sets (and/or in µs; dense and/or include a count):\n\n");
+        printf("  %9s %10s %10s %10s %10s %10s %10s\n", "density", "dense KiB", "roar KiB", "and dense",
+               "and roar", "or dense", "or roar");
+    }
+    for (int i = 0; i < cfg.n_densities; i++) {
+        RoarResult r;
+        if (roar_case(&d, cfg.densities[i], &seed, x, y, &r) != 0) {
+            perror("bench_bitset: roaring");
+            return 1;
+        }
+        report_roar(&cfg, &r, &first);
+        all_same &= r.same;
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    bitset_free(&d.a);
+    bitset_free(&d.b);
+    bitset_free(&d.d);
+    free(x);
+    free(y);
+    free(ref);
+    return all_same ? 0 : 1;
+}
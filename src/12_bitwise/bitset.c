@@ -0,0 +1,585 @@
+/*
+ * Chapter 12 — Bitset kernels and their runtime dispatch
+ *
+ * The bulk operations are one load per operand and one store per
+ * vector, so they run at memory speed in any variant wider than a
+ * word.  The work is in counting:
+ *
+ *   Harley-Seal  (AVX2) sixteen vectors are folded through a tree of
+ *                carry-save adders — h:l = a + b + c bitwise, as
+ *                h = (a & b) | ((a ^ b) & c), l = a ^ b ^ c — into
+ *                "ones", "twos", "fours", "eights" and one "sixteens",
+ *                so only one vector in sixteen is actually counted.
+ *                Counting a vector looks up each nibble's popcount
+ *                with a byte shuffle and sums the bytes with SAD.
+ *   VPOPCNTQ     (AVX-512 VPOPCNTDQ) counts eight words per instruction;
+ *                nothing is left to fold.
+ *   VCNT         (NEON) counts bytes; pairwise widening adds sum them.
+ *
+ * rank() and select() start from the sampled index: the bits set
+ * before each 512-bit block.  rank adds up at most eight words of its
+ * block; select binary-searches the index, walks the words of one
+ * block, then finds the bit within a word — with PDEP where BMI2 has
+ * it (deposit 1 << k into the word's set bits; the result's ctz is
+ * the answer), clearing the k lowest set bits otherwise.
+ *
+ * The same rank, select and extract bodies are compiled into each
+ * variant, so each gets that variant's POPCNT, TZCNT and BLSR.
+ */
+
+#define _POSIX_C_SOURCE 200809L    /* posix_memalign() */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BITSET_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define BITSET_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#define BLOCK_WORDS   (BITSET_BLOCK_BITS / 64)
+
+/* ════════════════════════════════════════════════════════════════
+ *  Shared bodies — inlined into each variant
+ * ════════════════════════════════════════════════════════════════ */
+
+static ALWAYS_INLINE size_t extract_body(const uint64_t *a, size_t n, uint32_t base, uint32_t *out)
+{
+    uint32_t *o = out;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t at = base + (uint32_t)i * 64;
+        for (uint64_t w = a[i]; w; w &= w - 1)                  /* blsr */
+            *o++ = at + (uint32_t)__builtin_ctzll(w);           /* tzcnt */
+    }
+    return (size_t)(o - out);
+}
+
+static ALWAYS_INLINE uint64_t rank_body(const uint64_t *words, const uint64_t *index, uint32_t i)
+{
+    uint32_t wi = i >> 6;
+    uint64_t r  = index[i / BITSET_BLOCK_BITS];
+    for (uint32_t j = i / BITSET_BLOCK_BITS * BLOCK_WORDS; j < wi; j++)
+        r += (uint64_t)__builtin_popcountll(words[j]);
+    if (i & 63) r += (uint64_t)__builtin_popcountll(words[wi] & (((uint64_t)1 << (i & 63)) - 1));
+    return r;
+}
+
+/* The k-th set bit of w, k < popcount(w): a byte at a time, then bits */
+static ALWAYS_INLINE unsigned select64_clear(uint64_t w, unsigned k)
+{
+    for (unsigned s = 0;; s += 8) {
+        uint64_t byte = w >> s & 0xff;
+        unsigned c    = (unsigned)__builtin_popcountll(byte);
+        if (k < c) {
+            while (k--) byte &= byte - 1;
+            return s + (unsigned)__builtin_ctzll(byte);
+        }
+        k -= c;
+    }
+}
+
+static ALWAYS_INLINE uint32_t select_body(const uint64_t *words, const uint64_t *index, uint32_t n_blocks,
+                                          uint64_t k, unsigned (*select64)(uint64_t, unsigned))
+{
+    /* index[lo] <= k < index[hi]; index[n_blocks] is the total */
+    uint32_t lo = 0, hi = n_blocks;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index[mid] <= k) lo = mid;
+        else                 hi = mid;
+    }
+    k -= index[lo];
+    for (const uint64_t *w = words + (size_t)lo * BLOCK_WORDS;; w++) {
+        unsigned c = (unsigned)__builtin_popcountll(*w);
+        if (k < c) return (uint32_t)(w - words) * 64 + select64(*w, (unsigned)k);
+        k -= c;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scalar — a word at a time
+ * ════════════════════════════════════════════════════════════════ */
+
+static void scalar_and(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) d[i] = a[i] & b[i];
+}
+
+static void scalar_or(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) d[i] = a[i] | b[i];
+}
+
+static void scalar_xor(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) d[i] = a[i] ^ b[i];
+}
+
+static void scalar_andnot(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) d[i] = a[i] & ~b[i];
+}
+
+static uint64_t scalar_count(const uint64_t *a, size_t n)
+{
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i]);
+    return s;
+}
+
+static uint64_t scalar_and_count(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i] & b[i]);
+    return s;
+}
+
+static size_t scalar_extract(const uint64_t *a, size_t n, uint32_t base, uint32_t *out)
+{
+    return extract_body(a, n, base, out);
+}
+
+static uint64_t scalar_rank(const uint64_t *words, const uint64_t *index, uint32_t i)
+{
+    return rank_body(words, index, i);
+}
+
+static unsigned scalar_select64(uint64_t w, unsigned k) { return select64_clear(w, k); }
+
+static uint32_t scalar_select(const uint64_t *words, const uint64_t *index, uint32_t n_blocks, uint64_t k)
+{
+    return select_body(words, index, n_blocks, k, scalar_select64);
+}
+
+static const BitsetKernels scalar_kernels = {
+    "scalar", scalar_and, scalar_or, scalar_xor, scalar_andnot, scalar_count, scalar_and_count,
+    scalar_extract, scalar_rank, scalar_select,
+};
+
+#ifdef BITSET_X86
+/* ════════════════════════════════════════════════════════════════
+ *  AVX2 — 4 words per vector, with POPCNT, BMI1 and BMI2
+ * ════════════════════════════════════════════════════════════════ */
+
+#define AVX2 __attribute__((target("avx2,popcnt,bmi,bmi2")))
+#define LOAD256(p)     _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define STORE256(p, v) _mm256_storeu_si256((__m256i *)(void *)(p), (v))
+
+#define AVX2_BULK(name, vop, sop)                                                   \
+    AVX2 static void name(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n) \
+    {                                                                               \
+        size_t i = 0;                                                               \
+        for (; i + 8 <= n; i += 8) {                                                \
+            __m256i x0 = vop(LOAD256(a + i), LOAD256(b + i));                       \
+            __m256i x1 = vop(LOAD256(a + i + 4), LOAD256(b + i + 4));               \
+            STORE256(d + i, x0);                                                    \
+            STORE256(d + i + 4, x1);                                                \
+        }                                                                           \
+        for (; i < n; i++) d[i] = sop;                                              \
+    }
+
+/* a & ~b: _mm256_andnot_si256 complements its first operand */
+#define avx2_andnot_op(x, y) _mm256_andnot_si256((y), (x))
+
+AVX2_BULK(avx2_and,    _mm256_and_si256, a[i] & b[i])
+AVX2_BULK(avx2_or,     _mm256_or_si256,  a[i] | b[i])
+AVX2_BULK(avx2_xor,    _mm256_xor_si256, a[i] ^ b[i])
+AVX2_BULK(avx2_andnot, avx2_andnot_op,   a[i] & ~b[i])
+
+/* Four 64-bit lane counts: nibble lookups, bytes summed by SAD */
+AVX2 static inline __m256i avx2_popcnt(__m256i v)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+AVX2 static inline uint64_t avx2_sum64(__m256i v)
+{
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return (uint64_t)_mm_cvtsi128_si64(s) + (uint64_t)_mm_extract_epi64(s, 1);
+}
+
+/* h:l = a + b + c, bit by bit */
+#define CSA(h, l, a, b, c)                                                          \
+    do {                                                                            \
+        __m256i u_ = _mm256_xor_si256((a), (b));                                    \
+        (h) = _mm256_or_si256(_mm256_and_si256((a), (b)), _mm256_and_si256(u_, (c))); \
+        (l) = _mm256_xor_si256(u_, (c));                                            \
+    } while (0)
+
+AVX2 static uint64_t avx2_count(const uint64_t *a, size_t n)
+{
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = total, twos = total, fours = total, eights = total, sixteens;
+    __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    size_t  i = 0;
+
+    for (; i + 64 <= n; i += 64) {              /* sixteen vectors */
+        const uint64_t *p = a + i;
+        CSA(twos_a, ones, ones, LOAD256(p), LOAD256(p + 4));
+        CSA(twos_b, ones, ones, LOAD256(p + 8), LOAD256(p + 12));
+        CSA(fours_a, twos, twos, twos_a, twos_b);
+        CSA(twos_a, ones, ones, LOAD256(p + 16), LOAD256(p + 20));
+        CSA(twos_b, ones, ones, LOAD256(p + 24), LOAD256(p + 28));
+        CSA(fours_b, twos, twos, twos_a, twos_b);
+        CSA(eights_a, fours, fours, fours_a, fours_b);
+        CSA(twos_a, ones, ones, LOAD256(p + 32), LOAD256(p + 36));
+        CSA(twos_b, ones, ones, LOAD256(p + 40), LOAD256(p + 44));
+        CSA(fours_a, twos, twos, twos_a, twos_b);
+        CSA(twos_a, ones, ones, LOAD256(p + 48), LOAD256(p + 52));
+        CSA(twos_b, ones, ones, LOAD256(p + 56), LOAD256(p + 60));
+        CSA(fours_b, twos, twos, twos_a, twos_b);
+        CSA(eights_b, fours, fours, fours_a, fours_b);
+        CSA(sixteens, eights, eights, eights_a, eights_b);
+        total = _mm256_add_epi64(total, avx2_popcnt(sixteens));
+    }
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(avx2_popcnt(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(avx2_popcnt(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(avx2_popcnt(twos), 1));
+    total = _mm256_add_epi64(total, avx2_popcnt(ones));
+    for (; i + 4 <= n; i += 4) total = _mm256_add_epi64(total, avx2_popcnt(LOAD256(a + i)));
+
+    uint64_t s = avx2_sum64(total);
+    for (; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i]);
+    return s;
+}
+
+AVX2 static uint64_t avx2_and_count(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    __m256i total = _mm256_setzero_si256();
+    size_t  i     = 0;
+    for (; i + 4 <= n; i += 4)
+        total = _mm256_add_epi64(total, avx2_popcnt(_mm256_and_si256(LOAD256(a + i), LOAD256(b + i))));
+    uint64_t s = avx2_sum64(total);
+    for (; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i] & b[i]);
+    return s;
+}
+
+AVX2 static size_t avx2_extract(const uint64_t *a, size_t n, uint32_t base, uint32_t *out)
+{
+    return extract_body(a, n, base, out);
+}
+
+AVX2 static uint64_t avx2_rank(const uint64_t *words, const uint64_t *index, uint32_t i)
+{
+    return rank_body(words, index, i);
+}
+
+/* PDEP puts 1 << k at the position of w's k-th set bit */
+AVX2 static inline unsigned pdep_select64(uint64_t w, unsigned k)
+{
+    return (unsigned)_tzcnt_u64(_pdep_u64((uint64_t)1 << k, w));
+}
+
+AVX2 static uint32_t avx2_select(const uint64_t *words, const uint64_t *index, uint32_t n_blocks, uint64_t k)
+{
+    return select_body(words, index, n_blocks, k, pdep_select64);
+}
+
+static const BitsetKernels avx2_kernels = {
+    "avx2", avx2_and, avx2_or, avx2_xor, avx2_andnot, avx2_count, avx2_and_count,
+    avx2_extract, avx2_rank, avx2_select,
+};
+
+/* ════════════════════════════════════════════════════════════════
+ *  AVX-512 — 8 words per vector, VPOPCNTQ, masked tails
+ * ════════════════════════════════════════════════════════════════ */
+
+#define AVX512 __attribute__((target("avx512f,avx512vpopcntdq,popcnt,bmi,bmi2")))
+
+/* The first m of 8 lanes */
+#define TAIL8(m) ((__mmask8)((1u << (m)) - 1))
+
+#define AVX512_BULK(name, vop)                                                        \
+    AVX512 static void name(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n) \
+    {                                                                                 \
+        size_t i = 0;                                                                 \
+        for (; i + 8 <= n; i += 8)                                                    \
+            _mm512_storeu_si512(d + i, vop(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i))); \
+        if (i < n) {                                                                  \
+            __mmask8 m = TAIL8(n - i);                                                \
+            _mm512_mask_storeu_epi64(d + i, m, vop(_mm512_maskz_loadu_epi64(m, a + i), \
+                                                   _mm512_maskz_loadu_epi64(m, b + i))); \
+        }                                                                             \
+    }
+
+#define avx512_andnot_op(x, y) _mm512_andnot_si512((y), (x))
+
+AVX512_BULK(avx512_and,    _mm512_and_si512)
+AVX512_BULK(avx512_or,     _mm512_or_si512)
+AVX512_BULK(avx512_xor,    _mm512_xor_si512)
+AVX512_BULK(avx512_andnot, avx512_andnot_op)
+
+AVX512 static uint64_t avx512_count(const uint64_t *a, size_t n)
+{
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_add_epi64(s0, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+        s1 = _mm512_add_epi64(s1, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i + 8)));
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : TAIL8(n - i);
+        s0 = _mm512_add_epi64(s0, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(m, a + i)));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(_mm512_add_epi64(s0, s1));
+}
+
+AVX512 static uint64_t avx512_and_count(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    __m512i s = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : TAIL8(n - i);
+        __m512i  x = _mm512_and_si512(_mm512_maskz_loadu_epi64(m, a + i), _mm512_maskz_loadu_epi64(m, b + i));
+        s          = _mm512_add_epi64(s, _mm512_popcnt_epi64(x));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(s);
+}
+
+AVX512 static size_t avx512_extract(const uint64_t *a, size_t n, uint32_t base, uint32_t *out)
+{
+    return extract_body(a, n, base, out);
+}
+
+AVX512 static uint64_t avx512_rank(const uint64_t *words, const uint64_t *index, uint32_t i)
+{
+    return rank_body(words, index, i);
+}
+
+AVX512 static uint32_t avx512_select(const uint64_t *words, const uint64_t *index, uint32_t n_blocks, uint64_t k)
+{
+    return select_body(words, index, n_blocks, k, pdep_select64);
+}
+
+static const BitsetKernels avx512_kernels = {
+    "avx512", avx512_and, avx512_or, avx512_xor, avx512_andnot, avx512_count, avx512_and_count,
+    avx512_extract, avx512_rank, avx512_select,
+};
+#endif /* BITSET_X86 */
+
+#ifdef BITSET_NEON
+/* ════════════════════════════════════════════════════════════════
+ *  NEON — 2 words per vector
+ * ════════════════════════════════════════════════════════════════ */
+
+#define NEON_BULK(name, vop, sop)                                                   \
+    static void name(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n)  \
+    {                                                                               \
+        size_t i = 0;                                                               \
+        for (; i + 2 <= n; i += 2) vst1q_u64(d + i, vop(vld1q_u64(a + i), vld1q_u64(b + i))); \
+        for (; i < n; i++) d[i] = sop;                                              \
+    }
+
+NEON_BULK(neon_and,    vandq_u64, a[i] & b[i])
+NEON_BULK(neon_or,     vorrq_u64, a[i] | b[i])
+NEON_BULK(neon_xor,    veorq_u64, a[i] ^ b[i])
+NEON_BULK(neon_andnot, vbicq_u64, a[i] & ~b[i])         /* BIC is a & ~b */
+
+/* Byte counts, widened to 16 bits as they are added: a lane gains at
+ * most 16 per vector, so 4096 vectors cannot overflow it */
+static uint64_t neon_count_pairs(const uint64_t *a, const uint64_t *b, size_t n, uint64_t *tail_from)
+{
+    uint64x2_t total = vdupq_n_u64(0);
+    size_t     i     = 0;
+    while (i + 2 <= n) {
+        uint16x8_t acc = vdupq_n_u16(0);
+        for (size_t j = 0; j < 4096 && i + 2 <= n; j++, i += 2) {
+            uint64x2_t x = vld1q_u64(a + i);
+            if (b) x = vandq_u64(x, vld1q_u64(b + i));
+            acc = vpadalq_u8(acc, vcntq_u8(vreinterpretq_u8_u64(x)));
+        }
+        total = vpadalq_u32(total, vpaddlq_u16(acc));
+    }
+    *tail_from = i;
+    return vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1);
+}
+
+static uint64_t neon_count(const uint64_t *a, size_t n)
+{
+    uint64_t i, s = neon_count_pairs(a, NULL, n, &i);
+    for (; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i]);
+    return s;
+}
+
+static uint64_t neon_and_count(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t i, s = neon_count_pairs(a, b, n, &i);
+    for (; i < n; i++) s += (uint64_t)__builtin_popcountll(a[i] & b[i]);
+    return s;
+}
+
+static const BitsetKernels neon_kernels = {
+    "neon", neon_and, neon_or, neon_xor, neon_andnot, neon_count, neon_and_count,
+    scalar_extract, scalar_rank, scalar_select,
+};
+#endif /* BITSET_NEON */
+
+/* ════════════════════════════════════════════════════════════════
+ *  Dispatch
+ * ════════════════════════════════════════════════════════════════ */
+
+size_t bitset_variants(const BitsetKernels **out, size_t max)
+{
+    size_t n = 0;
+    if (n < max) out[n++] = &scalar_kernels;
+#ifdef BITSET_X86
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+        __builtin_cpu_supports("popcnt"))
+        out[n++] = &avx2_kernels;
+    if (n < max && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq") &&
+        __builtin_cpu_supports("bmi2"))
+        out[n++] = &avx512_kernels;
+#endif
+#ifdef BITSET_NEON
+    if (n < max) out[n++] = &neon_kernels;
+#endif
+    return n;
+}
+
+const BitsetKernels *bitset_best(void)
+{
+    static const BitsetKernels *best;
+    const BitsetKernels *k = __atomic_load_n(&best, __ATOMIC_ACQUIRE);
+    if (!k) {
+        const BitsetKernels *v[4];
+        k = v[bitset_variants(v, 4) - 1];       /* racing threads choose the same one */
+        __atomic_store_n(&best, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Bitset
+ * ════════════════════════════════════════════════════════════════ */
+
+int bitset_init(Bitset *b, uint32_t n_bits)
+{
+    memset(b, 0, sizeof(*b));
+    b->n_bits   = n_bits;
+    b->n_words  = (uint32_t)(((uint64_t)n_bits + 63) / 64);
+    b->n_blocks = (b->n_words + BLOCK_WORDS - 1) / BLOCK_WORDS;
+
+    /* Cache-line aligned, so no vector load straddles two lines */
+    void *p;
+    int   err = posix_memalign(&p, 64, (b->n_words ? b->n_words : 1) * sizeof(uint64_t));
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    b->words = p;
+    memset(b->words, 0, (size_t)b->n_words * sizeof(uint64_t));
+    return 0;
+}
+
+void bitset_free(Bitset *b)
+{
+    free(b->words);
+    free(b->index);
+    memset(b, 0, sizeof(*b));
+}
+
+static int same_size(const Bitset *d, const Bitset *a, const Bitset *b)
+{
+    if (d->n_bits == a->n_bits && a->n_bits == b->n_bits) return 1;
+    errno = EINVAL;
+    return 0;
+}
+
+int bitset_and(Bitset *d, const Bitset *a, const Bitset *b)
+{
+    if (!same_size(d, a, b)) return -1;
+    bitset_best()->and_words(d->words, a->words, b->words, d->n_words);
+    return 0;
+}
+
+int bitset_or(Bitset *d, const Bitset *a, const Bitset *b)
+{
+    if (!same_size(d, a, b)) return -1;
+    bitset_best()->or_words(d->words, a->words, b->words, d->n_words);
+    return 0;
+}
+
+int bitset_xor(Bitset *d, const Bitset *a, const Bitset *b)
+{
+    if (!same_size(d, a, b)) return -1;
+    bitset_best()->xor_words(d->words, a->words, b->words, d->n_words);
+    return 0;
+}
+
+int bitset_andnot(Bitset *d, const Bitset *a, const Bitset *b)
+{
+    if (!same_size(d, a, b)) return -1;
+    bitset_best()->andnot_words(d->words, a->words, b->words, d->n_words);
+    return 0;
+}
+
+uint64_t bitset_count(const Bitset *b)
+{
+    return bitset_best()->count(b->words, b->n_words);
+}
+
+uint64_t bitset_and_count(const Bitset *a, const Bitset *b)
+{
+    return bitset_best()->and_count(a->words, b->words, a->n_words);
+}
+
+uint32_t bitset_next(const Bitset *b, uint32_t from)
+{
+    if (from >= b->n_bits) return b->n_bits;
+    uint32_t wi = from >> 6;
+    uint64_t w  = b->words[wi] & (~(uint64_t)0 << (from & 63));
+    while (!w) {
+        if (++wi == b->n_words) return b->n_bits;
+        w = b->words[wi];
+    }
+    return wi * 64 + (uint32_t)__builtin_ctzll(w);
+}
+
+size_t bitset_extract(const Bitset *b, uint32_t *out)
+{
+    return bitset_best()->extract(b->words, b->n_words, 0, out);
+}
+
+int bitset_build_rank(Bitset *b)
+{
+    uint64_t *index = realloc(b->index, ((size_t)b->n_blocks + 1) * sizeof(uint64_t));
+    if (!index) return -1;
+    b->index = index;
+
+    const BitsetKernels *k = bitset_best();
+    uint64_t             r = 0;
+    for (uint32_t blk = 0; blk < b->n_blocks; blk++) {
+        uint32_t first = blk * BLOCK_WORDS;
+        uint32_t n     = b->n_words - first < BLOCK_WORDS ? b->n_words - first : BLOCK_WORDS;
+        index[blk]     = r;
+        r             += k->count(b->words + first, n);
+    }
+    index[b->n_blocks] = r;
+    return 0;
+}
+
+uint64_t bitset_rank(const Bitset *b, uint32_t i)
+{
+    return bitset_best()->rank(b->words, b->index, i);
+}
+
+uint32_t bitset_select(const Bitset *b, uint64_t k)
+{
+    if (k >= b->index[b->n_blocks]) return b->n_bits;
+    return bitset_best()->select(b->words, b->index, b->n_blocks, k);
+}
@@ -0,0 +1,102 @@
+/*
+ * Chapter 12 — Dense bitsets, with runtime-dispatched SIMD kernels
+ *
+ * A Bitset is n_bits bits in 64-bit words, bit i at words[i / 64],
+ * position i % 64.  Bits past n_bits are always 0, so whole-word
+ * kernels never see garbage.  Set, clear and test are inline; the rest
+ * works on whole words, through the kernels below:
+ *
+ *   and / or / xor / andnot   d = a op b, word by word (d may be a or b)
+ *   count                     popcount of the whole set: Harley-Seal
+ *                             carry-save adders over AVX2 nibble
+ *                             lookups, VPOPCNTQ on AVX-512, VCNT on
+ *                             NEON, POPCNT or a bit trick otherwise
+ *   and_count                 popcount of a & b, without storing it
+ *   extract                   every set bit's index, one ctz and one
+ *                             blsr (w &= w - 1) per bit
+ *   rank / select             through a sampled index: the number of
+ *                             bits set before each 512-bit block
+ *
+ * Variants come as in reduce.h: bitset_variants() lists the ones this
+ * CPU runs, scalar first; bitset_best() is the one the bitset_*()
+ * functions use, chosen on the first call.
+ *
+ * rank and select need bitset_build_rank() first, and again after
+ * any change: the index is a snapshot.  n_bits is at most 2^32 - 1.
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    void     (*and_words)(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n);
+    void     (*or_words)(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n);
+    void     (*xor_words)(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n);
+    void     (*andnot_words)(uint64_t *d, const uint64_t *a, const uint64_t *b, size_t n);  /* a & ~b */
+    uint64_t (*count)(const uint64_t *a, size_t n);
+    uint64_t (*and_count)(const uint64_t *a, const uint64_t *b, size_t n);
+    /* The index of every set bit in a[0..n), plus base; returns how many */
+    size_t   (*extract)(const uint64_t *a, size_t n, uint32_t base, uint32_t *out);
+    /* Bits set in words[0..i / 64) and below bit i % 64 of the next */
+    uint64_t (*rank)(const uint64_t *words, const uint64_t *index, uint32_t i);
+    /* The k-th set bit (from 0); k must be below the total */
+    uint32_t (*select)(const uint64_t *words, const uint64_t *index, uint32_t n_blocks, uint64_t k);
+} BitsetKernels;
+
+/* The variants this CPU can run, scalar first and best last; returns
+ * how many (≤ max) were stored in out */
+size_t bitset_variants(const BitsetKernels **out, size_t max);
+
+/* The best of them, chosen on the first call */
+const BitsetKernels *bitset_best(void);
+
+#define BITSET_BLOCK_BITS 512           /* rank index granularity */
+
+typedef struct {
+    uint64_t *words;
+    uint64_t *index;            /* bits set before each block, and the total */
+    uint32_t  n_bits;
+    uint32_t  n_words;
+    uint32_t  n_blocks;
+} Bitset;
+
+/* All bits clear; 0, or -1 with errno (ENOMEM) */
+int  bitset_init(Bitset *b, uint32_t n_bits);
+void bitset_free(Bitset *b);
+
+/* i < n_bits */
+static inline void bitset_set(Bitset *b, uint32_t i)   { b->words[i >> 6] |=  (uint64_t)1 << (i & 63); }
+static inline void bitset_clear(Bitset *b, uint32_t i) { b->words[i >> 6] &= ~((uint64_t)1 << (i & 63)); }
+static inline int  bitset_test(const Bitset *b, uint32_t i)
+{
+    return (int)(b->words[i >> 6] >> (i & 63) & 1);
+}
+
+/* d = a op b; all three the same size, or -1 with EINVAL */
+int      bitset_and(Bitset *d, const Bitset *a, const Bitset *b);
+int      bitset_or(Bitset *d, const Bitset *a, const Bitset *b);
+int      bitset_xor(Bitset *d, const Bitset *a, const Bitset *b);
+int      bitset_andnot(Bitset *d, const Bitset *a, const Bitset *b);
+
+uint64_t bitset_count(const Bitset *b);
+uint64_t bitset_and_count(const Bitset *a, const Bitset *b);     /* sizes must match */
+
+/* The first set bit at or after from, or n_bits if there is none:
+ *   for (uint32_t i = bitset_next(b, 0); i < b->n_bits; i = bitset_next(b, i + 1)) */
+uint32_t bitset_next(const Bitset *b, uint32_t from);
+
+/* Every set bit in increasing order; out holds bitset_count() of them */
+size_t   bitset_extract(const Bitset *b, uint32_t *out);
+
+/* 0, or -1 with errno (ENOMEM) */
+int      bitset_build_rank(Bitset *b);
+/* Bits set in [0, i), i ≤ n_bits */
+uint64_t bitset_rank(const Bitset *b, uint32_t i);
+/* The k-th set bit from 0, or n_bits if k ≥ bitset_count() */
+uint32_t bitset_select(const Bitset *b, uint64_t k);
+
+#endif /* BITSET_H */
@@ -14,6 +14,7 @@
  *   6. Bit masks: extracting and inserting fields
  *   7. Endianness: how byte order affects bit interpretation
  *   8. Hardware register simulation (embedded pattern)
+ *   9. Bitsets at scale: SIMD bulk ops, rank/select, Roaring (bitset.h)
  *
  * Build: make 12_bitwise
  * Run:   ./bin/12_bitwise
@@ -25,6 +26,8 @@
  */
 
 #include "../../include/common.h"
+#include "bitset.h"
+#include "roaring.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Helper: Print a value in binary
@@ -311,6 +314,106 @@ static void demo_register_sim(void)
     printf("  are exactly what embedded drivers use.\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: Bitsets at Scale
+ * ════════════════════════════════════════════════════════════════ */
+
+#define DEMO_BITS (1u << 20)
+
+static uint64_t xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void demo_bitset(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: Bitsets at Scale                        ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    /* Section 4's popcount counts one word.  A set of a million
+     * members is 16384 words, and whole-set operations are loops
+     * over them — which SIMD runs four or eight words at a time. */
+    Bitset   a, b, both;
+    uint64_t seed = 42;
+    if (bitset_init(&a, DEMO_BITS) != 0 || bitset_init(&b, DEMO_BITS) != 0 ||
+        bitset_init(&both, DEMO_BITS) != 0) {
+        perror("  bitset_init");
+        return;
+    }
+    for (uint32_t i = 0; i < a.n_words; i++) {
+        a.words[i] = xorshift64(&seed) & xorshift64(&seed);        /* ~1/4 of the bits */
+        b.words[i] = xorshift64(&seed) | xorshift64(&seed);        /* ~3/4 */
+    }
+    bitset_and(&both, &a, &b);
+
+    uint64_t naive = 0;
+    for (uint32_t i = 0; i < DEMO_BITS; i++) naive += (uint64_t)bitset_test(&both, i);
+    printf("  %u bits; a & b has %llu set, %llu by testing each bit  %s\n", DEMO_BITS,
+           (unsigned long long)bitset_count(&both), (unsigned long long)naive,
+           bitset_count(&both) == naive ? "✓" : "MISMATCH");
+    printf("  Kernels: %s\n\n", bitset_best()->name);
+
+    uint64_t n = 0;
+    DEMO_BENCH("count, bit by bit", 0,
+               n = 0; for (uint32_t i = 0; i < DEMO_BITS; i++) n += (uint64_t)bitset_test(&both, i);
+               BENCH_OPAQUE(n));
+    DEMO_BENCH("bitset_count()", 0, n = bitset_count(&both); BENCH_OPAQUE(n));
+    DEMO_BENCH("bitset_and()", 0, bitset_and(&both, &a, &b); bench_escape(both.words));
+
+    /* rank(i) counts the set bits below i; select(k) finds the k-th.
+     * Each is a lookup in a per-512-bit index plus a few words. */
+    if (bitset_build_rank(&both) == 0) {
+        uint64_t r = bitset_rank(&both, DEMO_BITS / 2);
+        uint32_t s = bitset_select(&both, r);
+        printf("\n  rank(%u) = %llu; select(%llu) = %u, the first set bit at or after it\n", DEMO_BITS / 2,
+               (unsigned long long)r, (unsigned long long)r, s);
+        printf("  bitset_next(%u) = %u  %s\n", DEMO_BITS / 2, bitset_next(&both, DEMO_BITS / 2),
+               bitset_next(&both, DEMO_BITS / 2) == s ? "✓" : "MISMATCH");
+    }
+
+    printf("\n  First set bits, via ctz and clearing the lowest (w &= w - 1):\n   ");
+    uint32_t i = bitset_next(&both, 0);
+    for (int k = 0; k < 8 && i < both.n_bits; k++, i = bitset_next(&both, i + 1)) printf(" %u", i);
+    printf("\n\n");
+
+    /* A dense bitset over all 32-bit values would be 512 MB.  A
+     * Roaring set keeps an array or a bitmap per 65536-value chunk,
+     * only for the chunks it uses: 2 bytes per member of a sparse
+     * chunk, 8 KB for a dense one. */
+    Roaring sparse, dense, common;
+    roar_init(&sparse);
+    roar_init(&dense);
+    roar_init(&common);
+    int ok = 1;
+    for (uint32_t v = 0; v < 20000 && ok; v++)
+        ok = roar_add(&sparse, (uint32_t)xorshift64(&seed) & 0xffffff) == 0;
+    for (uint32_t v = 0; v < 300000 && ok; v += 3)
+        ok = roar_add(&dense, v) == 0;
+    ok = ok && roar_add(&dense, 0xdeadbeef) == 0 && roar_add(&sparse, 0xdeadbeef) == 0 &&
+         roar_and(&common, &sparse, &dense) == 0;
+    if (ok) {
+        printf("  20000 random values below 2^24: %7zu bytes in %3u containers (dense: %u)\n",
+               roar_bytes(&sparse), sparse.n, 1u << 21);
+        printf("  every 3rd value below 300000:   %7zu bytes in %3u containers (dense: %u)\n",
+               roar_bytes(&dense), dense.n, 300000u / 8);
+        printf("  Their intersection: %llu values; contains 0xdeadbeef: %s\n",
+               (unsigned long long)roar_count(&common), roar_contains(&common, 0xdeadbeef) ? "yes" : "no");
+    }
+    printf("\n  bench_bitset compares every kernel with a bit-by-bit loop,\n");
+    printf("  and Roaring with dense sets from 50%% down to 0.01%% full.\n\n");
+
+    roar_free(&sparse);
+    roar_free(&dense);
+    roar_free(&common);
+    bitset_free(&a);
+    bitset_free(&b);
+    bitset_free(&both);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════ */
@@ -326,6 +429,7 @@ int main(void)
     demo_masks();
     demo_endianness();
     demo_register_sim();
+    demo_bitset();
 
     DEMO_END();
     return 0;
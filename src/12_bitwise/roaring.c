@@ -0,0 +1,387 @@
+/*
+ * Chapter 12 — Roaring-style compressed bitset
+ *
+ * Every container holds 1 .. 65536 members: an empty one is removed
+ * (and/or never emit one), and a container is an array exactly when
+ * it has at most ROAR_ARRAY_MAX members — so the same set always has
+ * the same shape, whichever way it was built.
+ *
+ * Pairwise and/or walk the two sorted container lists like a merge;
+ * only containers with the same key meet:
+ *
+ *   array  ∩ array    merge of two sorted arrays, without branches
+ *   array  ∩ bitmap   test each array member in the bitmap
+ *   bitmap ∩ bitmap   and_count first: an array if the result is small
+ *                     (decoded with ctz), else and_words
+ *   ∪ with a bitmap   copy the bitmap, or it with the other, recount
+ *   array  ∪ array    merge; a bitmap if the result is too long
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roaring.h"
+#include "bitset.h"
+
+#define BITMAP_WORDS (65536 / 64)
+
+/* ════════════════════════════════════════════════════════════════
+ *  Containers
+ * ════════════════════════════════════════════════════════════════ */
+
+static void container_free(RoarContainer *c)
+{
+    free(c->array);
+    free(c->bits);
+    memset(c, 0, sizeof(*c));
+}
+
+/* The first array slot whose value is >= v */
+static uint32_t lower_bound(const uint16_t *a, uint32_t n, uint16_t v)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < v) lo = mid + 1;
+        else            hi = mid;
+    }
+    return lo;
+}
+
+/* c takes the n sorted values in a (which it now owns), in the right
+ * kind for n; a is freed if they go into a bitmap */
+static int container_take(RoarContainer *c, uint16_t key, uint16_t *a, uint32_t n)
+{
+    memset(c, 0, sizeof(*c));
+    c->key  = key;
+    c->card = n;
+    if (n <= ROAR_ARRAY_MAX) {
+        c->array = a;
+        c->cap   = n;
+        return 0;
+    }
+    c->bits = calloc(BITMAP_WORDS, sizeof(uint64_t));
+    if (!c->bits) return -1;
+    for (uint32_t i = 0; i < n; i++) c->bits[a[i] >> 6] |= (uint64_t)1 << (a[i] & 63);
+    free(a);
+    return 0;
+}
+
+/* A bitmap's n set bits, as a sorted array */
+static uint16_t *bits_to_array(const uint64_t *bits, uint32_t n)
+{
+    uint16_t *a = malloc((n ? n : 1) * sizeof(uint16_t)), *o = a;
+    if (!a) return NULL;
+    for (uint32_t w = 0; w < BITMAP_WORDS; w++)
+        for (uint64_t x = bits[w]; x; x &= x - 1) *o++ = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(x));
+    return a;
+}
+
+static int container_add(RoarContainer *c, uint16_t low)
+{
+    if (c->bits) {
+        uint64_t m = (uint64_t)1 << (low & 63);
+        if (!(c->bits[low >> 6] & m)) {
+            c->bits[low >> 6] |= m;
+            c->card++;
+        }
+        return 0;
+    }
+    uint32_t pos = c->card && c->array[c->card - 1] < low ? c->card : lower_bound(c->array, c->card, low);
+    if (pos < c->card && c->array[pos] == low) return 0;
+
+    if (c->card == ROAR_ARRAY_MAX) {
+        uint64_t *bits = calloc(BITMAP_WORDS, sizeof(uint64_t));
+        if (!bits) return -1;
+        for (uint32_t i = 0; i < c->card; i++) bits[c->array[i] >> 6] |= (uint64_t)1 << (c->array[i] & 63);
+        free(c->array);
+        c->array = NULL;
+        c->cap   = 0;
+        c->bits  = bits;
+        return container_add(c, low);
+    }
+    if (c->card == c->cap) {
+        uint32_t  cap = c->cap * 2 < ROAR_ARRAY_MAX ? c->cap * 2 : ROAR_ARRAY_MAX;
+        uint16_t *a   = realloc(c->array, cap * sizeof(uint16_t));
+        if (!a) return -1;
+        c->array = a;
+        c->cap   = cap;
+    }
+    memmove(c->array + pos + 1, c->array + pos, (c->card - pos) * sizeof(uint16_t));
+    c->array[pos] = low;
+    c->card++;
+    return 0;
+}
+
+static int container_contains(const RoarContainer *c, uint16_t low)
+{
+    if (c->bits) return (int)(c->bits[low >> 6] >> (low & 63) & 1);
+    uint32_t pos = lower_bound(c->array, c->card, low);
+    return pos < c->card && c->array[pos] == low;
+}
+
+static int container_clone(RoarContainer *out, const RoarContainer *c)
+{
+    *out = *c;
+    if (c->bits) {
+        out->bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+        if (!out->bits) return -1;
+        memcpy(out->bits, c->bits, BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        out->cap   = c->card;
+        out->array = malloc(c->card * sizeof(uint16_t));
+        if (!out->array) return -1;
+        memcpy(out->array, c->array, c->card * sizeof(uint16_t));
+    }
+    return 0;
+}
+
+/* out = x ∩ y, possibly empty (card 0, nothing allocated) */
+static int container_and(RoarContainer *out, const RoarContainer *x, const RoarContainer *y)
+{
+    const BitsetKernels *k = bitset_best();
+    memset(out, 0, sizeof(*out));
+    out->key = x->key;
+
+    if (x->bits && y->bits) {
+        uint64_t n = k->and_count(x->bits, y->bits, BITMAP_WORDS);
+        if (n > ROAR_ARRAY_MAX) {
+            out->bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+            if (!out->bits) return -1;
+            k->and_words(out->bits, x->bits, y->bits, BITMAP_WORDS);
+            out->card = (uint32_t)n;
+            return 0;
+        }
+        if (n == 0) return 0;
+        uint64_t tmp[BITMAP_WORDS];
+        k->and_words(tmp, x->bits, y->bits, BITMAP_WORDS);
+        out->array = bits_to_array(tmp, (uint32_t)n);
+        if (!out->array) return -1;
+        out->card = out->cap = (uint32_t)n;
+        return 0;
+    }
+
+    if (x->bits) {                      /* the array one first */
+        const RoarContainer *t = x;
+        x = y;
+        y = t;
+    }
+    uint16_t *a = malloc(x->card * sizeof(uint16_t));
+    uint32_t  n = 0;
+    if (!a) return -1;
+    if (y->bits) {
+        for (uint32_t i = 0; i < x->card; i++)
+            if (y->bits[x->array[i] >> 6] >> (x->array[i] & 63) & 1) a[n++] = x->array[i];
+    } else {
+        /* Branch-free: which side advances is data, not control flow */
+        for (uint32_t i = 0, j = 0; i < x->card && j < y->card;) {
+            uint16_t u = x->array[i], v = y->array[j];
+            a[n] = u;
+            n += u == v;
+            i += u <= v;
+            j += v <= u;
+        }
+    }
+    if (n == 0) {
+        free(a);
+        return 0;
+    }
+    out->array = a;
+    out->card  = out->cap = n;
+    return 0;
+}
+
+/* out = x ∪ y */
+static int container_or(RoarContainer *out, const RoarContainer *x, const RoarContainer *y)
+{
+    const BitsetKernels *k = bitset_best();
+    memset(out, 0, sizeof(*out));
+    out->key = x->key;
+
+    if (x->bits || y->bits) {
+        if (!x->bits) {
+            const RoarContainer *t = x;
+            x = y;
+            y = t;
+        }
+        out->bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+        if (!out->bits) return -1;
+        if (y->bits) {
+            k->or_words(out->bits, x->bits, y->bits, BITMAP_WORDS);
+        } else {
+            memcpy(out->bits, x->bits, BITMAP_WORDS * sizeof(uint64_t));
+            for (uint32_t i = 0; i < y->card; i++)
+                out->bits[y->array[i] >> 6] |= (uint64_t)1 << (y->array[i] & 63);
+        }
+        out->card = (uint32_t)k->count(out->bits, BITMAP_WORDS);
+        return 0;
+    }
+
+    uint16_t *a = malloc((x->card + y->card) * sizeof(uint16_t));
+    uint32_t  n = 0, i = 0, j = 0;
+    if (!a) return -1;
+    while (i < x->card && j < y->card) {
+        uint16_t u = x->array[i], v = y->array[j];
+        a[n++] = u < v ? u : v;
+        i += u <= v;
+        j += v <= u;
+    }
+    while (i < x->card) a[n++] = x->array[i++];
+    while (j < y->card) a[n++] = y->array[j++];
+    if (container_take(out, x->key, a, n) != 0) {
+        free(a);
+        return -1;
+    }
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The sorted container list
+ * ════════════════════════════════════════════════════════════════ */
+
+/* key's container, or -(where it would go) - 1 */
+static long find(const Roaring *r, uint16_t key)
+{
+    uint32_t lo = 0, hi = r->n;
+    if (r->n && r->c[r->n - 1].key < key) lo = r->n;   /* appending */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (r->c[mid].key < key) lo = mid + 1;
+        else                     hi = mid;
+    }
+    return lo < r->n && r->c[lo].key == key ? (long)lo : -(long)lo - 1;
+}
+
+static int insert_at(Roaring *r, uint32_t pos, const RoarContainer *c)
+{
+    if (r->n == r->cap) {
+        uint32_t       cap = r->cap ? r->cap * 2 : 8;
+        RoarContainer *p   = realloc(r->c, cap * sizeof(*p));
+        if (!p) return -1;
+        r->c   = p;
+        r->cap = cap;
+    }
+    memmove(r->c + pos + 1, r->c + pos, (r->n - pos) * sizeof(*r->c));
+    r->c[pos] = *c;
+    r->n++;
+    return 0;
+}
+
+/* Append c, which d then owns; frees it on failure */
+static int append(Roaring *d, RoarContainer *c)
+{
+    if (insert_at(d, d->n, c) == 0) return 0;
+    container_free(c);
+    return -1;
+}
+
+void roar_init(Roaring *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+void roar_free(Roaring *r)
+{
+    for (uint32_t i = 0; i < r->n; i++) container_free(&r->c[i]);
+    free(r->c);
+    roar_init(r);
+}
+
+int roar_add(Roaring *r, uint32_t x)
+{
+    uint16_t key = (uint16_t)(x >> 16);
+    long     i   = find(r, key);
+    if (i < 0) {
+        RoarContainer c = { key, 0, 4, malloc(4 * sizeof(uint16_t)), NULL };
+        if (!c.array || insert_at(r, (uint32_t)(-i - 1), &c) != 0) {
+            free(c.array);
+            return -1;
+        }
+        i = -i - 1;
+    }
+    /* A new container must not stay empty: only its first add can fail
+     * here, and then it had nothing yet */
+    if (container_add(&r->c[i], (uint16_t)x) == 0) return 0;
+    if (r->c[i].card == 0) {
+        container_free(&r->c[i]);
+        memmove(r->c + i, r->c + i + 1, (r->n - (uint32_t)i - 1) * sizeof(*r->c));
+        r->n--;
+    }
+    return -1;
+}
+
+int roar_contains(const Roaring *r, uint32_t x)
+{
+    long i = find(r, (uint16_t)(x >> 16));
+    return i >= 0 && container_contains(&r->c[i], (uint16_t)x);
+}
+
+uint64_t roar_count(const Roaring *r)
+{
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < r->n; i++) n += r->c[i].card;
+    return n;
+}
+
+int roar_and(Roaring *d, const Roaring *a, const Roaring *b)
+{
+    roar_free(d);
+    for (uint32_t i = 0, j = 0; i < a->n && j < b->n;) {
+        if      (a->c[i].key < b->c[j].key) i++;
+        else if (a->c[i].key > b->c[j].key) j++;
+        else {
+            RoarContainer c;
+            if (container_and(&c, &a->c[i++], &b->c[j++]) != 0) goto fail;
+            if (c.card && append(d, &c) != 0) goto fail;
+        }
+    }
+    return 0;
+fail:
+    roar_free(d);
+    errno = ENOMEM;
+    return -1;
+}
+
+int roar_or(Roaring *d, const Roaring *a, const Roaring *b)
+{
+    roar_free(d);
+    uint32_t i = 0, j = 0;
+    while (i < a->n || j < b->n) {
+        RoarContainer c;
+        int           err;
+        if (j == b->n || (i < a->n && a->c[i].key < b->c[j].key))      err = container_clone(&c, &a->c[i++]);
+        else if (i == a->n || a->c[i].key > b->c[j].key)               err = container_clone(&c, &b->c[j++]);
+        else                                                           err = container_or(&c, &a->c[i++], &b->c[j++]);
+        if (err != 0 || append(d, &c) != 0) goto fail;
+    }
+    return 0;
+fail:
+    roar_free(d);
+    errno = ENOMEM;
+    return -1;
+}
+
+size_t roar_extract(const Roaring *r, uint32_t *out)
+{
+    const BitsetKernels *k = bitset_best();
+    size_t               n = 0;
+    for (uint32_t i = 0; i < r->n; i++) {
+        const RoarContainer *c    = &r->c[i];
+        uint32_t             base = (uint32_t)c->key << 16;
+        if (c->bits) {
+            n += k->extract(c->bits, BITMAP_WORDS, base, out + n);
+        } else {
+            for (uint32_t j = 0; j < c->card; j++) out[n++] = base | c->array[j];
+        }
+    }
+    return n;
+}
+
+size_t roar_bytes(const Roaring *r)
+{
+    size_t n = r->cap * sizeof(*r->c);
+    for (uint32_t i = 0; i < r->n; i++)
+        n += r->c[i].bits ? BITMAP_WORDS * sizeof(uint64_t) : r->c[i].cap * sizeof(uint16_t);
+    return n;
+}
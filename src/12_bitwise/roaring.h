@@ -0,0 +1,61 @@
+/*
+ * Chapter 12 — A compressed bitset for sparse sets of 32-bit integers
+ *
+ * A dense Bitset over 2^32 values is 512 MB however few are set.  A
+ * Roaring set splits each value into a 16-bit key (the high half) and
+ * a 16-bit low half, and keeps one container per key that has any
+ * members — sorted by key, found by binary search:
+ *
+ *   array    up to ROAR_ARRAY_MAX sorted uint16_t lows: 2 bytes each
+ *   bitmap   beyond that, 2^16 bits (8 KB) — which is smaller than
+ *            the array would be, and tested in O(1)
+ *
+ * Containers switch kind as they grow (and, in the results of and/or,
+ * as they come out).  Bitmap containers use bitset.h's kernels, so an
+ * intersection of two dense ranges runs at SIMD speed, and of two
+ * sparse ones costs a merge of short arrays.  Unlike the Roaring
+ * format this is modelled on, there are no run-length containers.
+ *
+ * roar_add(), roar_and() and roar_or() return 0, or -1 with errno
+ * (ENOMEM); a failed add leaves the set as it was.
+ */
+
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ROAR_ARRAY_MAX 4096
+
+typedef struct {
+    uint16_t  key;
+    uint32_t  card;             /* members, 1 .. 65536 */
+    uint32_t  cap;              /* array: values allocated; 0 for a bitmap */
+    uint16_t *array;            /* one of the two is NULL */
+    uint64_t *bits;
+} RoarContainer;
+
+typedef struct {
+    RoarContainer *c;
+    uint32_t       n, cap;
+} Roaring;
+
+void     roar_init(Roaring *r);
+void     roar_free(Roaring *r);
+
+int      roar_add(Roaring *r, uint32_t x);      /* in increasing order is fastest */
+int      roar_contains(const Roaring *r, uint32_t x);
+uint64_t roar_count(const Roaring *r);
+
+/* d = a op b; d is emptied first and must be neither a nor b */
+int      roar_and(Roaring *d, const Roaring *a, const Roaring *b);
+int      roar_or(Roaring *d, const Roaring *a, const Roaring *b);
+
+/* Every member in increasing order; out holds roar_count() of them */
+size_t   roar_extract(const Roaring *r, uint32_t *out);
+
+/* Heap bytes in use, containers included */
+size_t   roar_bytes(const Roaring *r);
+
+#endif /* ROARING_H */
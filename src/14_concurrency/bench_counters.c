@@ -0,0 +1,254 @@
+/*
+ * Counter benchmark — mutex vs one atomic vs unpadded vs sharded counters
+ *
+ * Every thread adds 1 to a shared count --ops times, in one of five
+ * ways:
+ *
+ *   mutex      pthread_mutex_lock / ++ / unlock, as in chapter 14
+ *   atomic     one atomic_fetch_add (relaxed) on a single counter
+ *   unpadded   one atomic per thread, the slots adjacent in an array:
+ *              no logical sharing, but up to 8 per cache line
+ *   sharded    counter.c: one slot per thread, each on its own line
+ *   batched    counter.c's CounterBatch, flushing every --batch adds
+ *
+ * for 1, 2, 4, ... up to --threads threads.  Reported: total Mops/s,
+ * ns per add per thread, and the speed-up over the mutex.  The final
+ * count must equal threads × ops, or the benchmark exits 1.  On a
+ * machine with fewer cores than threads the threads take turns rather
+ * than contend, and the gaps close.
+ *
+ * Build: make bench_counters
+ * Run:   ./bin/bench_counters [--threads N] [--ops N] [--batch N] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../include/bench.h"
+#include "counter.h"
+
+#define MAX_THREADS 256
+
+typedef enum { V_MUTEX, V_ATOMIC, V_UNPADDED, V_SHARDED, V_BATCHED, VARIANTS } Variant;
+
+static const char *variant_names[VARIANTS] = { "mutex", "atomic", "unpadded", "sharded", "batched" };
+
+typedef struct {
+    int            threads;
+    uint64_t       ops;
+    uint64_t       batch;
+    bench_format_t format;
+} Config;
+
+/* The counted-at state, each on its own lines so the variants do not
+ * disturb one another */
+static struct {
+    _Alignas(COUNTER_LINE) pthread_mutex_t lock;
+    uint64_t                               locked;
+    _Alignas(COUNTER_LINE) atomic_uint_fast64_t single;
+    _Alignas(COUNTER_LINE) atomic_uint_fast64_t slots[MAX_THREADS];
+    _Alignas(COUNTER_LINE) Counter counter;
+} shared = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+typedef struct {
+    Variant            v;
+    int                id;
+    uint64_t           ops, batch;
+    pthread_barrier_t *start;
+    uint64_t           t0, t1;          /* this thread's first and last add */
+} Job;
+
+static void *worker(void *arg)
+{
+    Job     *j = arg;
+    uint64_t n = j->ops;
+    pthread_barrier_wait(j->start);
+    j->t0 = bench_now_ns();
+    switch (j->v) {
+    case V_MUTEX:
+        for (uint64_t i = 0; i < n; i++) {
+            pthread_mutex_lock(&shared.lock);
+            shared.locked++;
+            pthread_mutex_unlock(&shared.lock);
+        }
+        break;
+    case V_ATOMIC:
+        for (uint64_t i = 0; i < n; i++) atomic_fetch_add_explicit(&shared.single, 1, memory_order_relaxed);
+        break;
+    case V_UNPADDED:
+        for (uint64_t i = 0; i < n; i++)
+            atomic_fetch_add_explicit(&shared.slots[j->id], 1, memory_order_relaxed);
+        break;
+    case V_SHARDED:
+        for (uint64_t i = 0; i < n; i++) counter_inc(&shared.counter);
+        break;
+    case V_BATCHED: {
+        CounterBatch b;
+        counter_batch_init(&b, &shared.counter, j->batch);
+        for (uint64_t i = 0; i < n; i++) counter_batch_add(&b, 1);
+        counter_batch_flush(&b);
+        break;
+    }
+    default:
+        break;
+    }
+    j->t1 = bench_now_ns();
+    return NULL;
+}
+
+static void reset(void)
+{
+    shared.locked = 0;
+    atomic_store(&shared.single, 0);
+    for (int i = 0; i < MAX_THREADS; i++) atomic_store(&shared.slots[i], 0);
+    counter_reset(&shared.counter);
+}
+
+static uint64_t total(Variant v, int threads)
+{
+    uint64_t sum = 0;
+    switch (v) {
+    case V_MUTEX:    return shared.locked;
+    case V_ATOMIC:   return atomic_load(&shared.single);
+    case V_UNPADDED:
+        for (int i = 0; i < threads; i++) sum += atomic_load(&shared.slots[i]);
+        return sum;
+    default:         return counter_read(&shared.counter);
+    }
+}
+
+/* Wall time of threads × ops adds: from the first thread's start to
+ * the last one's finish, which on a busy or small machine need not be
+ * when the main thread gets to look */
+static uint64_t run(Variant v, int threads, const Config *cfg)
+{
+    static pthread_t tids[MAX_THREADS];
+    static Job       jobs[MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    reset();
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (Job){ v, t, cfg->ops, cfg->batch, &start, 0, 0 };
+        if (pthread_create(&tids[t], NULL, worker, &jobs[t]) != 0) break;
+        started++;
+    }
+    if (started < threads) {
+        /* The barrier cannot be passed now; nobody has counted yet */
+        fprintf(stderr, "could not start %d threads\n", threads);
+        exit(1);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t t0 = UINT64_MAX, t1 = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        if (jobs[t].t0 < t0) t0 = jobs[t].t0;
+        if (jobs[t].t1 > t1) t1 = jobs[t].t1;
+    }
+    pthread_barrier_destroy(&start);
+    return t1 - t0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--threads N] [--ops N] [--batch N] [--format text|csv|json]\n", prog);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            cfg->threads = atoi(val);
+        } else if (strcmp(opt, "--ops") == 0) {
+            cfg->ops = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--batch") == 0) {
+            cfg->batch = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->threads >= 1 && cfg->threads <= MAX_THREADS && cfg->ops > 0 && cfg->batch > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    long   cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    Config cfg  = { cpus > 1 ? (int)(cpus > MAX_THREADS ? MAX_THREADS : cpus) : 4, 2000000, 64, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (counter_init(&shared.counter, (unsigned)cfg.threads) != 0) {
+        perror("counter_init");
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_counters: %llu adds per thread, batch %llu, %ld CPUs online\n\n",
+               (unsigned long long)cfg.ops, (unsigned long long)cfg.batch, cpus);
+        printf("  %7s  %-9s %10s %10s %9s\n", "threads", "variant", "Mops/s", "ns/add", "vs mutex");
+        break;
+    case BENCH_FMT_CSV:
+        printf("threads,variant,ops,ns,mops_per_s,ns_per_add\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"counters\",\n  \"results\": [");
+        break;
+    }
+
+    int failed = 0, first = 1;
+    /* 1, 2, 4, ... and --threads itself */
+    for (int threads = 1;; threads = threads * 2 < cfg.threads ? threads * 2 : cfg.threads) {
+        double mutex_mops = 0;
+        for (int v = 0; v < VARIANTS; v++) {
+            uint64_t ns   = run((Variant)v, threads, &cfg);
+            uint64_t want = (uint64_t)threads * cfg.ops;
+            uint64_t got  = total((Variant)v, threads);
+            double   mops = ns ? (double)want / ((double)ns / 1e3) : 0;
+            double   per  = (double)ns * threads / (double)want;
+            if (v == V_MUTEX) mutex_mops = mops;
+            if (got != want) {
+                fprintf(stderr, "%s, %d threads: counted %llu, want %llu\n", variant_names[v], threads,
+                        (unsigned long long)got, (unsigned long long)want);
+                failed = 1;
+            }
+            switch (cfg.format) {
+            case BENCH_FMT_TEXT:
+                if (v == 0) printf("  %7d", threads);
+                else        printf("  %7s", "");
+                printf("  %-9s %10.1f %10.2f %8.1fx\n", variant_names[v], mops, per,
+                       mutex_mops > 0 ? mops / mutex_mops : 0);
+                break;
+            case BENCH_FMT_CSV:
+                printf("%d,%s,%llu,%llu,%.3f,%.3f\n", threads, variant_names[v], (unsigned long long)want,
+                       (unsigned long long)ns, mops, per);
+                break;
+            case BENCH_FMT_JSON:
+                printf("%s\n    { \"threads\": %d, \"variant\": \"%s\", \"ops\": %llu, \"ns\": %llu, "
+                       "\"mops_per_s\": %.3f, \"ns_per_add\": %.3f }",
+                       first ? "" : ",", threads, variant_names[v], (unsigned long long)want,
+                       (unsigned long long)ns, mops, per);
+                first = 0;
+                break;
+            }
+        }
+        if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+        if (threads >= cfg.threads) break;
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    counter_destroy(&shared.counter);
+    return failed ? 1 : 0;
+}
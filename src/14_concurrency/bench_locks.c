@@ -0,0 +1,428 @@
+/*
+ * Lock benchmark — pthread mutex vs futex, ticket, MCS and adaptive locks
+ *
+ * Two measurements per lock:
+ *
+ *   uncontended   one thread, lock + unlock --uncontended times; the
+ *                 cost of the fast path when nobody else is there
+ *   contended     each of 2, 4, ... --threads threads for --ms
+ *                 milliseconds: lock, a short critical section (--cs
+ *                 updates of shared state), unlock, --think cpu_relax()es
+ *                 outside the lock
+ *
+ * The locks:
+ *
+ *   pthread     pthread_mutex_t, default attributes
+ *   futex       lock.c's FutexMutex: Drepper's three-state mutex
+ *   ticket      lock.c's TicketLock, FIFO, spins then yields
+ *   mcs         lock.c's McsLock, FIFO, each waiter on its own line
+ *   adaptive    lock.c's AdaptiveLock: exponential-backoff spin, then park
+ *
+ * Each contended sweep runs once per --affinity mode: "free" as the
+ * scheduler likes, "one" with the whole process on one CPU — what
+ * `taskset -c 0` would do, so that every wait for a preempted holder
+ * is visible.  Reported: Mops/s, wall ns per critical section,
+ * context switches (voluntary + involuntary, from getrusage) per 1000
+ * critical sections — the kernel transitions — and fairness, the
+ * fewest sections any thread got over the most.  The shared count must
+ * equal the sum of the threads' own, or the benchmark exits 1.
+ *
+ * Build: make bench_locks
+ * Run:   ./bin/bench_locks [--threads 2,4,8,16,32,64] [--ms N] [--cs N] [--think N]
+ *                          [--uncontended N] [--affinity free,one]
+ *                          [--format text|csv|json]
+ */
+
+#define _GNU_SOURCE         /* sched_setaffinity() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "../../include/bench.h"
+#include "lock.h"
+
+#define MAX_THREADS 256
+#define MAX_LIST    16
+#define LINE        128
+
+typedef enum { L_PTHREAD, L_FUTEX, L_TICKET, L_MCS, L_ADAPTIVE, LOCKS } LockKind;
+
+static const char *lock_names[LOCKS] = { "pthread", "futex", "ticket", "mcs", "adaptive" };
+
+enum { AFF_FREE, AFF_ONE, AFFINITIES };
+
+static const char *affinity_names[AFFINITIES] = { "free", "one" };
+
+typedef struct {
+    int            threads[MAX_LIST];
+    int            n_threads;
+    int            affinity[AFFINITIES];
+    int            n_affinity;
+    unsigned       ms;
+    unsigned       cs;
+    unsigned       think;
+    uint64_t       uncontended;
+    bench_format_t format;
+} Config;
+
+/* The locks and what they guard, each on its own lines */
+static struct {
+    _Alignas(LINE) pthread_mutex_t pthread;
+    _Alignas(LINE) FutexMutex      futex;
+    _Alignas(LINE) TicketLock      ticket;
+    _Alignas(LINE) McsLock         mcs;
+    _Alignas(LINE) AdaptiveLock    adaptive;
+    _Alignas(LINE) uint64_t        count;
+    uint64_t                       data[8];
+} shared = { .pthread = PTHREAD_MUTEX_INITIALIZER };
+
+static atomic_int stop;
+
+static void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+/* The critical section: a few dependent updates of shared state */
+static inline void critical(unsigned cs)
+{
+    shared.count++;
+    for (unsigned i = 0; i < cs; i++) shared.data[i & 7] += shared.data[(i + 1) & 7] + 1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Uncontended
+ * ════════════════════════════════════════════════════════════════ */
+
+static double uncontended_ns(LockKind k, uint64_t n)
+{
+    McsNode  node;
+    uint64_t t0 = bench_now_ns();
+    switch (k) {
+    case L_PTHREAD:
+        for (uint64_t i = 0; i < n; i++) {
+            pthread_mutex_lock(&shared.pthread);
+            pthread_mutex_unlock(&shared.pthread);
+        }
+        break;
+    case L_FUTEX:
+        for (uint64_t i = 0; i < n; i++) {
+            fmutex_lock(&shared.futex);
+            fmutex_unlock(&shared.futex);
+        }
+        break;
+    case L_TICKET:
+        for (uint64_t i = 0; i < n; i++) {
+            ticket_lock(&shared.ticket);
+            ticket_unlock(&shared.ticket);
+        }
+        break;
+    case L_MCS:
+        for (uint64_t i = 0; i < n; i++) {
+            mcs_lock(&shared.mcs, &node);
+            mcs_unlock(&shared.mcs, &node);
+        }
+        break;
+    case L_ADAPTIVE:
+        for (uint64_t i = 0; i < n; i++) {
+            adaptive_lock(&shared.adaptive);
+            adaptive_unlock(&shared.adaptive);
+        }
+        break;
+    default:
+        break;
+    }
+    return (double)(bench_now_ns() - t0) / (double)n;
+}
+
+static void *idle_thread(void *arg)
+{
+    return arg;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Contended
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    LockKind           k;
+    unsigned           cs, think;
+    pthread_barrier_t *start;
+    uint64_t           ops;
+    uint64_t           t0, t1;
+} Job;
+
+/* One lock's loop, with LOCK / UNLOCK inlined */
+#define LOOP(LOCK, UNLOCK)                                                  \
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {            \
+        LOCK;                                                               \
+        critical(j->cs);                                                    \
+        UNLOCK;                                                             \
+        ops++;                                                              \
+        for (unsigned i = 0; i < j->think; i++) cpu_relax();                \
+    }
+
+static void *worker(void *arg)
+{
+    Job     *j   = arg;
+    uint64_t ops = 0;
+    McsNode  node;
+    pthread_barrier_wait(j->start);
+    j->t0 = bench_now_ns();
+    switch (j->k) {
+    case L_PTHREAD:  LOOP(pthread_mutex_lock(&shared.pthread), pthread_mutex_unlock(&shared.pthread)); break;
+    case L_FUTEX:    LOOP(fmutex_lock(&shared.futex), fmutex_unlock(&shared.futex)); break;
+    case L_TICKET:   LOOP(ticket_lock(&shared.ticket), ticket_unlock(&shared.ticket)); break;
+    case L_MCS:      LOOP(mcs_lock(&shared.mcs, &node), mcs_unlock(&shared.mcs, &node)); break;
+    case L_ADAPTIVE: LOOP(adaptive_lock(&shared.adaptive), adaptive_unlock(&shared.adaptive)); break;
+    default:         break;
+    }
+    j->t1  = bench_now_ns();
+    j->ops = ops;
+    return NULL;
+}
+
+typedef struct {
+    uint64_t ops;               /* the threads' own counts, summed */
+    uint64_t counted;           /* shared.count */
+    uint64_t ns;
+    uint64_t csw;
+    double   fairness;
+} RunResult;
+
+static uint64_t context_switches(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)ru.ru_nvcsw + (uint64_t)ru.ru_nivcsw;
+}
+
+static int run(LockKind k, int threads, const Config *cfg, RunResult *r)
+{
+    static pthread_t tids[MAX_THREADS];
+    static Job       jobs[MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    shared.count = 0;
+    atomic_store(&stop, 0);
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (Job){ k, cfg->cs, cfg->think, &start, 0, 0, 0 };
+        if (pthread_create(&tids[t], NULL, worker, &jobs[t]) != 0) {
+            /* The barrier cannot be passed now; nobody has started */
+            fprintf(stderr, "could not start %d threads\n", threads);
+            exit(1);
+        }
+    }
+    uint64_t csw0 = context_switches();
+    pthread_barrier_wait(&start);
+    struct timespec ts = { cfg->ms / 1000, (long)(cfg->ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+    atomic_store(&stop, 1);
+
+    uint64_t t0 = UINT64_MAX, t1 = 0, lo = UINT64_MAX, hi = 0;
+    r->ops = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        if (jobs[t].t0 < t0) t0 = jobs[t].t0;
+        if (jobs[t].t1 > t1) t1 = jobs[t].t1;
+        if (jobs[t].ops < lo) lo = jobs[t].ops;
+        if (jobs[t].ops > hi) hi = jobs[t].ops;
+        r->ops += jobs[t].ops;
+    }
+    r->csw      = context_switches() - csw0;
+    r->ns       = t1 - t0;
+    r->counted  = shared.count;
+    r->fairness = hi ? (double)lo / (double)hi : 0;
+    pthread_barrier_destroy(&start);
+    return r->counted == r->ops ? 0 : -1;
+}
+
+/* Restrict the process to one CPU (its first allowed), or restore */
+static int set_affinity(int mode, cpu_set_t *saved)
+{
+    if (mode == AFF_FREE) return sched_setaffinity(0, sizeof *saved, saved);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, saved)) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            return sched_setaffinity(0, sizeof one, &one);
+        }
+    return -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--threads 2,4,8,16,32,64] [--ms N] [--cs N] [--think N]\n"
+            "       %*s [--uncontended N] [--affinity free,one] [--format text|csv|json]\n",
+            prog, (int)strlen(prog), "");
+}
+
+static int parse_threads(const char *s, Config *cfg)
+{
+    cfg->n_threads = 0;
+    while (*s) {
+        char *end;
+        long  t = strtol(s, &end, 10);
+        if (end == s || t < 1 || t > MAX_THREADS || cfg->n_threads == MAX_LIST) return -1;
+        cfg->threads[cfg->n_threads++] = (int)t;
+        if (*end && *end != ',') return -1;
+        s = *end ? end + 1 : end;
+    }
+    return cfg->n_threads ? 0 : -1;
+}
+
+static int parse_affinity(const char *s, Config *cfg)
+{
+    cfg->n_affinity = 0;
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        int    a   = 0;
+        while (a < AFFINITIES && (strlen(affinity_names[a]) != len || strncmp(s, affinity_names[a], len) != 0))
+            a++;
+        if (a == AFFINITIES || cfg->n_affinity == AFFINITIES) return -1;
+        cfg->affinity[cfg->n_affinity++] = a;
+        s += len;
+        if (*s) s++;
+    }
+    return cfg->n_affinity ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            if (parse_threads(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--ms") == 0) {
+            cfg->ms = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--cs") == 0) {
+            cfg->cs = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--think") == 0) {
+            cfg->think = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--uncontended") == 0) {
+            cfg->uncontended = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--affinity") == 0) {
+            if (parse_affinity(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->ms > 0 && cfg->uncontended > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { 2, 4, 8, 16, 32, 64 }, 6, { AFF_FREE, AFF_ONE }, 2, 100, 4, 0, 20000000, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    cpu_set_t saved;
+    if (sched_getaffinity(0, sizeof saved, &saved) != 0) {
+        perror("sched_getaffinity");
+        return 1;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* glibc drops the lock prefix from its mutex while the process has
+     * only ever had one thread; start one so that pthread pays what it
+     * pays in a real threaded program */
+    pthread_t idle;
+    if (pthread_create(&idle, NULL, idle_thread, NULL) != 0 || pthread_join(idle, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+    double unc[LOCKS];
+    for (int k = 0; k < LOCKS; k++) unc[k] = uncontended_ns((LockKind)k, cfg.uncontended);
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_locks: critical section of %u updates, think %u, %u ms per run, %ld CPUs online\n\n",
+               cfg.cs, cfg.think, cfg.ms, cpus);
+        printf("  uncontended lock + unlock:\n");
+        for (int k = 0; k < LOCKS; k++) printf("    %-9s %6.2f ns\n", lock_names[k], unc[k]);
+        printf("\n  %-8s %7s  %-9s %9s %9s %9s %8s %9s\n", "affinity", "threads", "lock", "Mops/s", "ns/op",
+               "csw/kop", "fairness", "vs pthread");
+        break;
+    case BENCH_FMT_CSV:
+        printf("affinity,threads,lock,ops,ns,mops_per_s,ns_per_op,csw_per_kop,fairness\n");
+        for (int k = 0; k < LOCKS; k++)
+            printf("uncontended,1,%s,%llu,%.0f,%.3f,%.3f,,\n", lock_names[k],
+                   (unsigned long long)cfg.uncontended, unc[k] * (double)cfg.uncontended, 1e3 / unc[k], unc[k]);
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"locks\",\n  \"uncontended_ns\": {");
+        for (int k = 0; k < LOCKS; k++) printf("%s \"%s\": %.3f", k ? "," : "", lock_names[k], unc[k]);
+        printf(" },\n  \"results\": [");
+        break;
+    }
+
+    int failed = 0, first = 1;
+    for (int a = 0; a < cfg.n_affinity; a++) {
+        int aff = cfg.affinity[a];
+        if (set_affinity(aff, &saved) != 0) {
+            perror("sched_setaffinity");
+            continue;
+        }
+        for (int ti = 0; ti < cfg.n_threads; ti++) {
+            int    threads = cfg.threads[ti];
+            double base    = 0;
+            for (int k = 0; k < LOCKS; k++) {
+                RunResult r;
+                if (run((LockKind)k, threads, &cfg, &r) != 0) {
+                    fprintf(stderr, "%s, %d threads: counted %llu, threads report %llu\n", lock_names[k],
+                            threads, (unsigned long long)r.counted, (unsigned long long)r.ops);
+                    failed = 1;
+                }
+                double mops = r.ns ? (double)r.ops / ((double)r.ns / 1e3) : 0;
+                double per  = r.ops ? (double)r.ns / (double)r.ops : 0;
+                double csw  = r.ops ? (double)r.csw * 1e3 / (double)r.ops : 0;
+                if (k == L_PTHREAD) base = mops;
+                switch (cfg.format) {
+                case BENCH_FMT_TEXT:
+                    if (k == 0) printf("  %-8s %7d", ti == 0 ? affinity_names[aff] : "", threads);
+                    else        printf("  %-8s %7s", "", "");
+                    printf("  %-9s %9.2f %9.1f %9.2f %8.2f %8.2fx\n", lock_names[k], mops, per, csw, r.fairness,
+                           base > 0 ? mops / base : 0);
+                    break;
+                case BENCH_FMT_CSV:
+                    printf("%s,%d,%s,%llu,%llu,%.3f,%.3f,%.3f,%.3f\n", affinity_names[aff], threads, lock_names[k],
+                           (unsigned long long)r.ops, (unsigned long long)r.ns, mops, per, csw, r.fairness);
+                    break;
+                case BENCH_FMT_JSON:
+                    printf("%s\n    { \"affinity\": \"%s\", \"threads\": %d, \"lock\": \"%s\", \"ops\": %llu, "
+                           "\"ns\": %llu, \"mops_per_s\": %.3f, \"ns_per_op\": %.3f, \"csw_per_kop\": %.3f, "
+                           "\"fairness\": %.3f }",
+                           first ? "" : ",", affinity_names[aff], threads, lock_names[k],
+                           (unsigned long long)r.ops, (unsigned long long)r.ns, mops, per, csw, r.fairness);
+                    first = 0;
+                    break;
+                }
+            }
+            if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+        }
+    }
+    sched_setaffinity(0, sizeof saved, &saved);
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * Thread pool benchmark — static split vs work stealing, by grain size
+ *
+ * Every index i in [0, --n) costs a short hash loop; for the uniform
+ * workload each costs the same, for the skewed one the cost grows from
+ * almost nothing at 0 to twice the mean at n.  The indices' hashes are
+ * summed:
+ *
+ *   serial     one thread, the baseline
+ *   static     --threads raw pthreads, started for the run, each given
+ *              an equal slice: the last slice of the skewed work is the
+ *              most expensive and everyone else waits for it
+ *   for        tpool.c's parallel_for(), writing every hash to an array
+ *              that is summed afterwards
+ *   reduce     tpool.c's parallel_reduce(), summing as it goes
+ *
+ * with the pool's variants at every --grains size.  The pool is created
+ * once; the pthreads are created and joined each run, as a one-off
+ * parallel loop written without a pool would.  Reported: best of --reps
+ * times, the speed-up over serial, and the pool's counts for the run —
+ * tasks, steals, lost steal races, parks and total idle time.  Tiny
+ * grains show in tasks and steals, big ones in idle time on the skewed
+ * work.  Any sum that differs from serial's exits 1.
+ *
+ * Build: make bench_pool
+ * Run:   ./bin/bench_pool [--threads N] [--n N] [--grains 1,64,1024,16384]
+ *                         [--reps N] [--pin 0|1] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../include/bench.h"
+#include "tpool.h"
+
+#define MAX_THREADS 256
+#define MAX_LIST    16
+#define MEAN_ROUNDS 32          /* hash rounds per index, on average */
+
+typedef enum { V_SERIAL, V_STATIC, V_FOR, V_REDUCE, VARIANTS } Variant;
+
+static const char *variant_names[VARIANTS] = { "serial", "static", "for", "reduce" };
+static const char *workload_names[2]       = { "uniform", "skewed" };
+
+typedef struct {
+    int            threads;
+    size_t         n;
+    size_t         grains[MAX_LIST];
+    int            n_grains;
+    int            reps;
+    int            pin;
+    bench_format_t format;
+} Config;
+
+/* ════════════════════════════════════════════════════════════════
+ *  The work
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    size_t    n;
+    int       skewed;
+    uint64_t *out;              /* for: one hash per index */
+} Work;
+
+static uint64_t work(const Work *w, size_t i)
+{
+    unsigned rounds = w->skewed ? (unsigned)(1 + 2 * MEAN_ROUNDS * (uint64_t)i / w->n) : MEAN_ROUNDS;
+    uint64_t x      = i + 1;
+    for (unsigned r = 0; r < rounds; r++) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+    }
+    return x;
+}
+
+static uint64_t sum_range(const Work *w, size_t begin, size_t end)
+{
+    uint64_t s = 0;
+    for (size_t i = begin; i < end; i++) s += work(w, i);
+    return s;
+}
+
+static void for_body(size_t begin, size_t end, void *ctx)
+{
+    Work *w = ctx;
+    for (size_t i = begin; i < end; i++) w->out[i] = work(w, i);
+}
+
+static void reduce_map(size_t begin, size_t end, void *ctx, void *acc)
+{
+    *(uint64_t *)acc += sum_range(ctx, begin, end);
+}
+
+static void reduce_combine(void *acc, const void *other, void *ctx)
+{
+    *(uint64_t *)acc += *(const uint64_t *)other;
+}
+
+/* Static split: one slice per thread, each sum on its own line */
+typedef struct {
+    const Work *w;
+    size_t      begin, end;
+    _Alignas(128) uint64_t sum;
+} Slice;
+
+static void *slice_main(void *arg)
+{
+    Slice *s = arg;
+    s->sum   = sum_range(s->w, s->begin, s->end);
+    return NULL;
+}
+
+static uint64_t static_split(const Work *w, int threads)
+{
+    static pthread_t tids[MAX_THREADS];
+    static Slice     slices[MAX_THREADS];
+    int              started = 0;
+    for (int t = 0; t < threads; t++) {
+        slices[t].w     = w;
+        slices[t].begin = w->n * (size_t)t / (size_t)threads;
+        slices[t].end   = w->n * (size_t)(t + 1) / (size_t)threads;
+        if (pthread_create(&tids[t], NULL, slice_main, &slices[t]) != 0) break;
+        started++;
+    }
+    uint64_t sum = 0;
+    for (int t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+        sum += slices[t].sum;
+    }
+    if (started < threads) sum += sum_range(w, slices[started].begin, w->n);
+    return sum;
+}
+
+static uint64_t run_once(Variant v, Work *w, TPool *pool, int threads, size_t grain)
+{
+    uint64_t sum = 0;
+    switch (v) {
+    case V_SERIAL:
+        return sum_range(w, 0, w->n);
+    case V_STATIC:
+        return static_split(w, threads);
+    case V_FOR:
+        parallel_for(pool, 0, w->n, grain, for_body, w);
+        for (size_t i = 0; i < w->n; i++) sum += w->out[i];
+        return sum;
+    case V_REDUCE:
+        parallel_reduce(pool, 0, w->n, grain, reduce_map, reduce_combine, &sum, sizeof sum, w);
+        return sum;
+    default:
+        return 0;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--threads N] [--n N] [--grains 1,64,1024,16384] [--reps N] [--pin 0|1]\n"
+            "       %*s [--format text|csv|json]\n",
+            prog, (int)strlen(prog), "");
+}
+
+static int parse_grains(const char *s, Config *cfg)
+{
+    cfg->n_grains = 0;
+    while (*s) {
+        char *end;
+        long  g = strtol(s, &end, 10);
+        if (end == s || g < 1 || cfg->n_grains == MAX_LIST) return -1;
+        cfg->grains[cfg->n_grains++] = (size_t)g;
+        if (*end && *end != ',') return -1;
+        s = *end ? end + 1 : end;
+    }
+    return cfg->n_grains ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            cfg->threads = atoi(val);
+        } else if (strcmp(opt, "--n") == 0) {
+            cfg->n = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--grains") == 0) {
+            if (parse_grains(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--pin") == 0) {
+            cfg->pin = atoi(val);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->threads >= 1 && cfg->threads <= MAX_THREADS && cfg->n > 0 && cfg->reps >= 1 ? 0 : -1;
+}
+
+static void report(const Config *cfg, int wl, Variant v, size_t grain, uint64_t ns, double speedup,
+                   const TPoolStats *st, int first)
+{
+    int    pooled = v == V_FOR || v == V_REDUCE;
+    double ms     = (double)ns / 1e6;
+    double idle   = (double)st->idle_ns / 1e6;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-8s  %-7s", v == V_SERIAL ? workload_names[wl] : "", variant_names[v]);
+        if (pooled) printf(" %7zu", grain);
+        else        printf(" %7s", "-");
+        printf(" %9.2f %7.2fx", ms, speedup);
+        if (pooled)
+            printf(" %8llu %7llu %7llu %6llu %9.1f\n", (unsigned long long)st->tasks,
+                   (unsigned long long)st->steals, (unsigned long long)st->steal_misses,
+                   (unsigned long long)st->parks, idle);
+        else
+            printf(" %8s %7s %7s %6s %9s\n", "-", "-", "-", "-", "-");
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%zu,%llu,%.3f,%llu,%llu,%llu,%llu,%.3f\n", workload_names[wl], variant_names[v],
+               pooled ? grain : 0, (unsigned long long)ns, speedup, (unsigned long long)st->tasks,
+               (unsigned long long)st->steals, (unsigned long long)st->steal_misses,
+               (unsigned long long)st->parks, idle);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"workload\": \"%s\", \"variant\": \"%s\", \"grain\": %zu, \"ns\": %llu, "
+               "\"speedup\": %.3f, \"tasks\": %llu, \"steals\": %llu, \"steal_misses\": %llu, "
+               "\"parks\": %llu, \"idle_ms\": %.3f }",
+               first ? "" : ",", workload_names[wl], variant_names[v], pooled ? grain : 0,
+               (unsigned long long)ns, speedup, (unsigned long long)st->tasks,
+               (unsigned long long)st->steals, (unsigned long long)st->steal_misses,
+               (unsigned long long)st->parks, idle);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long   cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    Config cfg  = { cpus > 1 ? (int)(cpus > MAX_THREADS ? MAX_THREADS : cpus) : 4,
+                    1 << 20, { 1, 64, 1024, 16384 }, 4, 3, 0, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    TPool    *pool = tpool_create(cfg.threads, cfg.pin ? TPOOL_PIN : 0);
+    uint64_t *out  = malloc(cfg.n * sizeof *out);
+    if (!pool || !out) {
+        perror("bench_pool");
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_pool: %zu indices, %d threads%s, best of %d, %ld CPUs online\n\n", cfg.n,
+               cfg.threads, cfg.pin ? " (pinned)" : "", cfg.reps, cpus);
+        printf("  %-8s  %-7s %7s %9s %8s %8s %7s %7s %6s %9s\n", "workload", "variant", "grain", "ms",
+               "speedup", "tasks", "steals", "misses", "parks", "idle ms");
+        break;
+    case BENCH_FMT_CSV:
+        printf("workload,variant,grain,ns,speedup,tasks,steals,steal_misses,parks,idle_ms\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"pool\",\n  \"threads\": %d,\n  \"n\": %zu,\n  \"results\": [",
+               cfg.threads, cfg.n);
+        break;
+    }
+
+    int failed = 0, first = 1;
+    for (int wl = 0; wl < 2; wl++) {
+        Work     w      = { cfg.n, wl, out };
+        uint64_t want   = 0, serial_ns = 0;
+        for (int v = 0; v < VARIANTS; v++) {
+            int pooled = v == V_FOR || v == V_REDUCE;
+            for (int g = 0; g < (pooled ? cfg.n_grains : 1); g++) {
+                size_t    grain = cfg.grains[g];
+                uint64_t  best  = UINT64_MAX;
+                TPoolStats st    = { 0 };
+                for (int r = 0; r < cfg.reps; r++) {
+                    TPoolStats s = { 0 };
+                    tpool_stats_reset(pool);
+                    uint64_t t0  = bench_now_ns();
+                    uint64_t got = run_once((Variant)v, &w, pool, cfg.threads, grain);
+                    uint64_t ns  = bench_now_ns() - t0;
+                    if (pooled) tpool_stats(pool, &s);
+                    if (v == V_SERIAL && r == 0) want = got;
+                    if (got != want) {
+                        fprintf(stderr, "%s %s grain %zu: sum %016llx, want %016llx\n", workload_names[wl],
+                                variant_names[v], grain, (unsigned long long)got, (unsigned long long)want);
+                        failed = 1;
+                    }
+                    if (ns < best) {
+                        best = ns;
+                        st   = s;
+                    }
+                }
+                if (v == V_SERIAL) serial_ns = best;
+                report(&cfg, wl, (Variant)v, grain, best, best ? (double)serial_ns / (double)best : 0, &st,
+                       first);
+                first = 0;
+            }
+        }
+        if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    tpool_destroy(pool);
+    free(out);
+    return failed ? 1 : 0;
+}
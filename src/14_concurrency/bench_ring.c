@@ -0,0 +1,425 @@
+/*
+ * Queue benchmark — mutex/condvar queue vs SPSC ring vs MPMC ring
+ *
+ * P producers each push --items items through one queue to C consumers,
+ * for each P = C in --pairs (1, 4 and 16 by default), with:
+ *
+ *   mutex              chapter 14's producer/consumer made a FIFO: one
+ *                      mutex, two condition variables, an item per lock
+ *   spsc, mpmc         ring.c, one item per call, spinning then
+ *                      sched_yield() when full or empty (spsc: 1P1C only)
+ *   *-batch            --batch items per push and per pop
+ *   *-futex            a RING_BLOCKING ring: sleep in futex() instead
+ *
+ * Each item is its producer's number and a timestamp (refreshed every
+ * 16 items, or per batch).  Consumers check that every producer's items
+ * arrive in order and sample the latency — pop time minus timestamp —
+ * of every 64th item.  Reported: throughput in Mitems/s and latency
+ * p50 / p99; a lost, duplicated or reordered item exits 1.  With fewer
+ * cores than threads the rows measure scheduling as much as queueing:
+ * spinning is worst there, sleeping best.
+ *
+ * Build: make bench_ring
+ * Run:   ./bin/bench_ring [--pairs 1,4,16] [--items N] [--capacity N] [--batch N]
+ *                         [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../../include/bench.h"
+#include "ring.h"
+
+#define MAX_PAIRS   64
+#define MAX_LIST    8
+#define TS_BITS     56
+#define TS_MASK     ((UINT64_C(1) << TS_BITS) - 1)
+#define SENTINEL    ((void *)1)     /* "no more items"; real items are >= 1 << 56 */
+#define SAMPLE_EVERY 64
+#define MAX_SAMPLES  (1 << 16)      /* per consumer */
+#define MAX_BATCH    1024
+
+typedef enum { Q_MUTEX, Q_SPSC, Q_MPMC } QueueKind;
+
+typedef struct {
+    const char *name;
+    QueueKind   kind;
+    int         batch;              /* use --batch */
+    int         flags;              /* RING_BLOCKING or 0 */
+} Variant;
+
+static const Variant variants[] = {
+    { "mutex",            Q_MUTEX, 0, 0 },
+    { "spsc",             Q_SPSC,  0, 0 },
+    { "spsc-batch",       Q_SPSC,  1, 0 },
+    { "spsc-futex",       Q_SPSC,  0, RING_BLOCKING },
+    { "mpmc",             Q_MPMC,  0, 0 },
+    { "mpmc-batch",       Q_MPMC,  1, 0 },
+    { "mpmc-futex",       Q_MPMC,  0, RING_BLOCKING },
+    { "mpmc-futex-batch", Q_MPMC,  1, RING_BLOCKING },
+};
+#define VARIANT_COUNT ((int)(sizeof(variants) / sizeof(variants[0])))
+
+typedef struct {
+    int            pairs[MAX_LIST];
+    int            n_pairs;
+    uint64_t       items;           /* per producer */
+    size_t         capacity;
+    size_t         batch;
+    bench_format_t format;
+} Config;
+
+/* ════════════════════════════════════════════════════════════════
+ *  The mutex/condvar queue
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    void          **slots;
+    size_t          cap, head, count;
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty, not_full;
+} LockedQueue;
+
+static int lq_init(LockedQueue *q, size_t cap)
+{
+    q->slots = malloc(cap * sizeof(void *));
+    if (!q->slots) return -1;
+    q->cap  = cap;
+    q->head = q->count = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return 0;
+}
+
+static void lq_destroy(LockedQueue *q)
+{
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+    free(q->slots);
+}
+
+static void lq_push(LockedQueue *q, void *item)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->cap) pthread_cond_wait(&q->not_full, &q->lock);
+    q->slots[(q->head + q->count++) % q->cap] = item;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void *lq_pop(LockedQueue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) pthread_cond_wait(&q->not_empty, &q->lock);
+    void *item = q->slots[q->head];
+    q->head    = (q->head + 1) % q->cap;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  One run
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const Variant *v;
+    LockedQueue    lq;
+    SpscRing       spsc;
+    MpmcRing       mpmc;
+    size_t         batch;
+    uint64_t       items;
+    int            producers;
+    pthread_barrier_t start;
+} Run;
+
+typedef struct {
+    Run      *run;
+    int       id;
+    uint64_t  received, bad;
+    uint64_t  last[MAX_PAIRS];      /* latest timestamp seen per producer */
+    uint64_t *samples;
+    size_t    n_samples;
+    uint64_t  done_ns;
+} Worker;
+
+static void push_n(Run *r, void **items, size_t n)
+{
+    switch (r->v->kind) {
+    case Q_MUTEX:
+        for (size_t i = 0; i < n; i++) lq_push(&r->lq, items[i]);
+        break;
+    case Q_SPSC:
+        if (n == 1) spsc_push_wait(&r->spsc, items[0]);
+        else        spsc_push_wait_n(&r->spsc, items, n);
+        break;
+    case Q_MPMC:
+        if (n == 1) mpmc_push_wait(&r->mpmc, items[0]);
+        else        mpmc_push_wait_n(&r->mpmc, items, n);
+        break;
+    }
+}
+
+static size_t pop_n(Run *r, void **out, size_t n)
+{
+    switch (r->v->kind) {
+    case Q_MUTEX: out[0] = lq_pop(&r->lq); return 1;
+    case Q_SPSC:
+        if (n == 1) { out[0] = spsc_pop_wait(&r->spsc); return 1; }
+        return spsc_pop_wait_n(&r->spsc, out, n);
+    default:
+        if (n == 1) { out[0] = mpmc_pop_wait(&r->mpmc); return 1; }
+        return mpmc_pop_wait_n(&r->mpmc, out, n);
+    }
+}
+
+static void *producer(void *arg)
+{
+    Worker  *w    = arg;
+    Run     *r    = w->run;
+    size_t   n    = r->v->batch ? r->batch : 1;
+    uint64_t id   = (uint64_t)(w->id + 1) << TS_BITS;
+    void    *buf[MAX_BATCH];
+    pthread_barrier_wait(&r->start);
+    uint64_t ts = 0;
+    for (uint64_t i = 0; i < r->items;) {
+        size_t k = r->items - i < n ? (size_t)(r->items - i) : n;
+        if (n > 1 || i % 16 == 0) ts = bench_now_ns() & TS_MASK;
+        for (size_t j = 0; j < k; j++) buf[j] = (void *)(uintptr_t)(id | ts);
+        push_n(r, buf, k);
+        i += k;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    Worker *w = arg;
+    Run    *r = w->run;
+    size_t  n = r->v->batch ? r->batch : 1;
+    void   *buf[MAX_BATCH];
+    pthread_barrier_wait(&r->start);
+    for (;;) {
+        size_t k    = pop_n(r, buf, n);
+        size_t ends = 0;
+        for (size_t j = 0; j < k; j++) {
+            if (buf[j] == SENTINEL) {
+                ends++;
+                continue;
+            }
+            uint64_t v    = (uint64_t)(uintptr_t)buf[j];
+            uint64_t prod = (v >> TS_BITS) - 1;
+            uint64_t ts   = v & TS_MASK;
+            if (prod >= (uint64_t)r->producers || ts < w->last[prod]) w->bad++;
+            else                                                       w->last[prod] = ts;
+            if (++w->received % SAMPLE_EVERY == 0 && w->n_samples < MAX_SAMPLES)
+                w->samples[w->n_samples++] = (bench_now_ns() & TS_MASK) - ts;
+        }
+        if (ends) {
+            /* One end marker per consumer; hand back any others this pop took */
+            for (size_t e = 1; e < ends; e++) {
+                void *s = SENTINEL;
+                push_n(r, &s, 1);
+            }
+            break;
+        }
+    }
+    w->done_ns = bench_now_ns();
+    return NULL;
+}
+
+typedef struct {
+    uint64_t ns, items, bad;
+    uint64_t p50, p99;
+} Result;
+
+static int run(const Variant *v, int pairs, const Config *cfg, Result *res)
+{
+    static Run       r;
+    static Worker    workers[2 * MAX_PAIRS];
+    static pthread_t tids[2 * MAX_PAIRS];
+    static uint64_t  all[MAX_PAIRS * MAX_SAMPLES];
+
+    memset(&r, 0, sizeof(r));
+    r.v         = v;
+    r.batch     = cfg->batch;
+    r.items     = cfg->items;
+    r.producers = pairs;
+    int rc = v->kind == Q_MUTEX ? lq_init(&r.lq, cfg->capacity)
+           : v->kind == Q_SPSC  ? spsc_init(&r.spsc, cfg->capacity, v->flags)
+                                : mpmc_init(&r.mpmc, cfg->capacity, v->flags);
+    if (rc != 0) return -1;
+    pthread_barrier_init(&r.start, NULL, (unsigned)(2 * pairs + 1));
+
+    int started = 0;
+    for (int t = 0; t < 2 * pairs; t++) {
+        Worker *w = &workers[t];
+        memset(w, 0, sizeof(*w));
+        w->run     = &r;
+        w->id      = t < pairs ? t : t - pairs;
+        w->samples = t < pairs ? NULL : &all[(size_t)(t - pairs) * MAX_SAMPLES];
+        if (pthread_create(&tids[t], NULL, t < pairs ? producer : consumer, w) != 0) break;
+        started++;
+    }
+    if (started < 2 * pairs) {
+        fprintf(stderr, "could not start %d threads\n", 2 * pairs);
+        exit(1);
+    }
+    pthread_barrier_wait(&r.start);
+    uint64_t t0 = bench_now_ns();
+    for (int t = 0; t < pairs; t++) pthread_join(tids[t], NULL);
+    for (int c = 0; c < pairs; c++) {
+        void *s = SENTINEL;
+        push_n(&r, &s, 1);
+    }
+    memset(res, 0, sizeof(*res));
+    uint64_t end = t0;
+    size_t   n   = 0;
+    for (int t = pairs; t < 2 * pairs; t++) {
+        pthread_join(tids[t], NULL);
+        Worker *w = &workers[t];
+        res->items += w->received;
+        res->bad += w->bad;
+        if (w->done_ns > end) end = w->done_ns;
+        memmove(&all[n], w->samples, w->n_samples * sizeof(uint64_t));
+        n += w->n_samples;
+    }
+    res->ns  = end - t0;
+    res->p99 = bench_percentile(all, n, 99);
+    res->p50 = bench_percentile(all, n, 50);
+
+    pthread_barrier_destroy(&r.start);
+    if (v->kind == Q_MUTEX)     lq_destroy(&r.lq);
+    else if (v->kind == Q_SPSC) spsc_destroy(&r.spsc);
+    else                        mpmc_destroy(&r.mpmc);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Command line and main
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--pairs 1,4,16] [--items N] [--capacity N] [--batch N]\n"
+            "          [--format text|csv|json]\n",
+            prog);
+}
+
+static int parse_pairs(const char *s, Config *cfg)
+{
+    cfg->n_pairs = 0;
+    while (*s) {
+        char *end;
+        long  p = strtol(s, &end, 10);
+        if (end == s || p < 1 || p > MAX_PAIRS || cfg->n_pairs == MAX_LIST) return -1;
+        cfg->pairs[cfg->n_pairs++] = (int)p;
+        if (*end && *end != ',') return -1;
+        s = *end ? end + 1 : end;
+    }
+    return cfg->n_pairs ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--pairs") == 0) {
+            if (parse_pairs(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--items") == 0) {
+            cfg->items = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--capacity") == 0) {
+            cfg->capacity = strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--batch") == 0) {
+            cfg->batch = strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->items > 0 && cfg->capacity >= 2 && cfg->batch >= 1 && cfg->batch <= MAX_BATCH ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { 1, 4, 16 }, 3, 200000, 1024, 32, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_ring: %llu items per producer, capacity %zu, batch %zu\n\n",
+               (unsigned long long)cfg.items, cfg.capacity, cfg.batch);
+        printf("  %-6s %-17s %10s %10s %10s %9s\n", "P x C", "queue", "Mitems/s", "p50 us", "p99 us",
+               "vs mutex");
+        break;
+    case BENCH_FMT_CSV:
+        printf("producers,consumers,queue,items,ns,mitems_per_s,latency_p50_ns,latency_p99_ns\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"ring\",\n  \"results\": [");
+        break;
+    }
+
+    int failed = 0, first = 1;
+    for (int p = 0; p < cfg.n_pairs; p++) {
+        int    pairs = cfg.pairs[p];
+        double base  = 0;
+        int    shown = 0;
+        for (int v = 0; v < VARIANT_COUNT; v++) {
+            if (variants[v].kind == Q_SPSC && pairs != 1) continue;
+            Result r;
+            if (run(&variants[v], pairs, &cfg, &r) != 0) {
+                fprintf(stderr, "%s: cannot create the queue\n", variants[v].name);
+                return 1;
+            }
+            uint64_t want  = (uint64_t)pairs * cfg.items;
+            double   mitem = r.ns ? (double)r.items / ((double)r.ns / 1e3) : 0;
+            if (variants[v].kind == Q_MUTEX) base = mitem;
+            if (r.items != want || r.bad) {
+                fprintf(stderr, "%s, %dx%d: %llu items of %llu, %llu out of order\n", variants[v].name, pairs,
+                        pairs, (unsigned long long)r.items, (unsigned long long)want,
+                        (unsigned long long)r.bad);
+                failed = 1;
+            }
+            switch (cfg.format) {
+            case BENCH_FMT_TEXT: {
+                char label[16] = "";
+                if (!shown++) snprintf(label, sizeof(label), "%dx%d", pairs, pairs);
+                printf("  %-6s %-17s %10.2f %10.1f %10.1f %8.2fx\n", label, variants[v].name, mitem,
+                       (double)r.p50 / 1e3, (double)r.p99 / 1e3, base > 0 ? mitem / base : 0);
+                break;
+            }
+            case BENCH_FMT_CSV:
+                printf("%d,%d,%s,%llu,%llu,%.3f,%llu,%llu\n", pairs, pairs, variants[v].name,
+                       (unsigned long long)r.items, (unsigned long long)r.ns, mitem, (unsigned long long)r.p50,
+                       (unsigned long long)r.p99);
+                break;
+            case BENCH_FMT_JSON:
+                printf("%s\n    { \"producers\": %d, \"consumers\": %d, \"queue\": \"%s\", \"items\": %llu, "
+                       "\"ns\": %llu, \"mitems_per_s\": %.3f, \"latency_p50_ns\": %llu, \"latency_p99_ns\": %llu }",
+                       first ? "" : ",", pairs, pairs, variants[v].name, (unsigned long long)r.items,
+                       (unsigned long long)r.ns, mitem, (unsigned long long)r.p50, (unsigned long long)r.p99);
+                first = 0;
+                break;
+            }
+        }
+        if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    return failed ? 1 : 0;
+}
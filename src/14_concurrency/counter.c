@@ -0,0 +1,64 @@
+/*
+ * Chapter 14 — Counters that scale with the number of threads
+ *
+ * See counter.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L     /* sysconf() */
+
+#include "counter.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+_Thread_local unsigned counter_slot_;
+
+static atomic_uint next_slot = 1;   /* 0 marks a thread without one */
+
+unsigned counter_slot_assign(void)
+{
+    unsigned s = atomic_fetch_add_explicit(&next_slot, 1, memory_order_relaxed);
+    if (s == 0) s = atomic_fetch_add_explicit(&next_slot, 1, memory_order_relaxed);
+    return counter_slot_ = s;
+}
+
+int counter_init(Counter *c, unsigned shards)
+{
+    if (shards == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        shards    = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    unsigned n = 1;
+    while (n < shards) n <<= 1;
+
+    c->shards = aligned_alloc(COUNTER_LINE, n * sizeof(CounterShard));
+    if (!c->shards) {
+        errno = ENOMEM;
+        return -1;
+    }
+    c->mask = n - 1;
+    for (unsigned i = 0; i < n; i++) atomic_init(&c->shards[i].v, 0);
+    return 0;
+}
+
+void counter_destroy(Counter *c)
+{
+    free(c->shards);
+    c->shards = NULL;
+    c->mask   = 0;
+}
+
+uint64_t counter_read(const Counter *c)
+{
+    uint64_t sum = 0;
+    for (unsigned i = 0; i <= c->mask; i++)
+        sum += atomic_load_explicit(&c->shards[i].v, memory_order_relaxed);
+    return sum;
+}
+
+void counter_reset(Counter *c)
+{
+    for (unsigned i = 0; i <= c->mask; i++)
+        atomic_store_explicit(&c->shards[i].v, 0, memory_order_relaxed);
+}
@@ -0,0 +1,97 @@
+/*
+ * Chapter 14 — Counters that scale with the number of threads
+ *
+ * A statistics counter is written on every request and read now and
+ * then.  Three costs stand in the way of making the write cheap:
+ *
+ *   a mutex          a lock and an unlock per increment, and a sleeping
+ *                    waiter when threads collide
+ *   one atomic       no lock, but every core's fetch-add needs the one
+ *                    cache line exclusively, so it bounces between them
+ *   false sharing    one atomic per thread side by side is no better:
+ *                    the cores still fight over the line they share
+ *
+ * A Counter is an array of shards, one cache line each, padded to
+ * COUNTER_LINE (128 bytes: x86 prefetches lines in 128-byte pairs, and
+ * some ARM cores have 128-byte lines).  Each thread adds, relaxed, to
+ * its own shard — threads are given shards round-robin as they first
+ * count — and counter_read() sums them.  A read is not a snapshot:
+ * adds that race with it may or may not be in the total, but every one
+ * finished before the read starts is.
+ *
+ * A CounterBatch goes further: a thread adds to a plain local and only
+ * touches its shard every `batch` counts (and on counter_batch_flush()),
+ * so up to batch - 1 counts per thread can be missing from a read.
+ *
+ * Needs C11 (<stdatomic.h>, _Alignas, _Thread_local).
+ */
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define COUNTER_LINE 128
+
+typedef struct {
+    _Alignas(COUNTER_LINE) atomic_uint_fast64_t v;
+} CounterShard;
+
+typedef struct {
+    CounterShard *shards;
+    unsigned      mask;             /* shard count - 1, a power of two */
+} Counter;
+
+typedef struct {
+    Counter *c;
+    uint64_t pending;
+    uint64_t batch;
+} CounterBatch;
+
+/* shards == 0: one per configured CPU.  Rounded up to a power of two.
+ * 0 on success; -1 with errno = ENOMEM */
+int      counter_init(Counter *c, unsigned shards);
+void     counter_destroy(Counter *c);
+
+/* Sum of the shards */
+uint64_t counter_read(const Counter *c);
+
+/* Not safe against concurrent adds: those may survive the reset */
+void     counter_reset(Counter *c);
+
+/* This thread's shard number, before masking; assigned on first use */
+extern _Thread_local unsigned counter_slot_;
+unsigned counter_slot_assign(void);
+
+static inline void counter_add(Counter *c, uint64_t n)
+{
+    unsigned slot = counter_slot_ ? counter_slot_ : counter_slot_assign();
+    atomic_fetch_add_explicit(&c->shards[slot & c->mask].v, n, memory_order_relaxed);
+}
+
+static inline void counter_inc(Counter *c)
+{
+    counter_add(c, 1);
+}
+
+static inline void counter_batch_init(CounterBatch *b, Counter *c, uint64_t batch)
+{
+    b->c       = c;
+    b->pending = 0;
+    b->batch   = batch ? batch : 1;
+}
+
+static inline void counter_batch_flush(CounterBatch *b)
+{
+    if (b->pending) counter_add(b->c, b->pending);
+    b->pending = 0;
+}
+
+static inline void counter_batch_add(CounterBatch *b, uint64_t n)
+{
+    b->pending += n;
+    if (b->pending >= b->batch) counter_batch_flush(b);
+}
+
+#endif /* COUNTER_H */
@@ -0,0 +1,65 @@
+/*
+ * Chapter 14 — Sleeping on a word, and spinning politely
+ *
+ * The waits under lock.c, ring.c and tpool.c.  futex_wait() sleeps
+ * while *word == expected, and may return early for no reason, so
+ * callers check again; futex_wake() wakes at most n sleepers on word.
+ * Both are private futexes (one process) on Linux.  Elsewhere a wait
+ * is a sched_yield() and a wake does nothing, which turns every sleep
+ * into a spin that yields — slower, still correct.
+ *
+ * cpu_relax() is the spin-loop hint: PAUSE on x86, YIELD on AArch64.
+ *
+ * The including file defines _GNU_SOURCE first, for syscall().
+ */
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static inline void futex_wait(atomic_uint *word, unsigned expected)
+{
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    (void)word;
+    (void)expected;
+    sched_yield();
+#endif
+}
+
+static inline void futex_wake(atomic_uint *word, int n)
+{
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#else
+    (void)word;
+    (void)n;
+#endif
+}
+
+static inline void futex_wake_all(atomic_uint *word)
+{
+    futex_wake(word, INT_MAX);
+}
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+#endif /* FUTEX_H */
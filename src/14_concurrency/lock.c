@@ -0,0 +1,166 @@
+/*
+ * Chapter 14 — Locks built on atomics and futex()
+ *
+ * See lock.h.  The futex mutex, from Drepper's paper:
+ *
+ *   lock:    CAS 0 -> 1; done if it was 0
+ *            otherwise: until an exchange with 2 returns 0,
+ *                       futex_wait(&state, 2)
+ *   unlock:  state - 1; if it was 2 (someone may sleep):
+ *                       state = 0, futex_wake(1)
+ *
+ * A thread that slept never knows whether others still do, so it takes
+ * the lock as 2; the price is at most one needless wake per sleep.
+ */
+
+#define _GNU_SOURCE         /* syscall() */
+
+#include "lock.h"
+#include "futex.h"
+
+#include <limits.h>
+#include <sched.h>
+#include <stddef.h>
+
+#define SPINS        256    /* ticket and MCS waits before yielding */
+#define ADAPTIVE_MAX 100    /* adaptive spin rounds, at most */
+#define BACKOFF_MAX  16     /* cpu_relax()es per adaptive round, at most */
+
+/* ════════════════════════════════════════════════════════════════
+ *  Helpers
+ * ════════════════════════════════════════════════════════════════ */
+
+/* The n-th look at a lock that is still held */
+static void spin_wait(unsigned n)
+{
+    if (n < SPINS) cpu_relax();
+    else           sched_yield();
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  FutexMutex
+ * ════════════════════════════════════════════════════════════════ */
+
+void fmutex_lock_slow(FutexMutex *m, unsigned seen)
+{
+    unsigned c = seen;
+    if (c != 2) c = atomic_exchange_explicit(&m->state, 2, memory_order_acquire);
+    while (c != 0) {
+        futex_wait(&m->state, 2);
+        c = atomic_exchange_explicit(&m->state, 2, memory_order_acquire);
+    }
+}
+
+void fmutex_wake(FutexMutex *m)
+{
+    atomic_store_explicit(&m->state, 0, memory_order_release);
+    futex_wake(&m->state, 1);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  FutexCond
+ * ════════════════════════════════════════════════════════════════ */
+
+void fcond_wait(FutexCond *c, FutexMutex *m)
+{
+    atomic_store_explicit(&c->mutex, m, memory_order_relaxed);
+    unsigned seq = atomic_load_explicit(&c->seq, memory_order_relaxed);
+    fmutex_unlock(m);
+    futex_wait(&c->seq, seq);
+    /* Broadcast may have moved other waiters onto m: take it as 2 */
+    fmutex_lock_slow(m, 1);
+}
+
+void fcond_signal(FutexCond *c)
+{
+    atomic_fetch_add_explicit(&c->seq, 1, memory_order_release);
+    futex_wake(&c->seq, 1);
+}
+
+void fcond_broadcast(FutexCond *c)
+{
+    FutexMutex *m = atomic_load_explicit(&c->mutex, memory_order_relaxed);
+    unsigned    seq = atomic_fetch_add_explicit(&c->seq, 1, memory_order_release) + 1;
+#ifdef __linux__
+    if (!m) {
+        futex_wake(&c->seq, INT_MAX);
+        return;
+    }
+    /* Wake one; the rest wait for m instead, and its unlocks wake them
+     * one at a time.  EAGAIN: seq moved on, and that signal woke them */
+    syscall(SYS_futex, &c->seq, FUTEX_CMP_REQUEUE_PRIVATE, 1, (void *)(long)INT_MAX, &m->state, seq);
+#else
+    (void)m;
+    (void)seq;
+#endif
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  TicketLock
+ * ════════════════════════════════════════════════════════════════ */
+
+void ticket_wait(TicketLock *l, unsigned ticket)
+{
+    for (unsigned n = 0;; n++) {
+        unsigned s = atomic_load_explicit(&l->serving, memory_order_acquire);
+        if (s == ticket) return;
+        /* Back off in proportion to the queue ahead of us */
+        if (n < SPINS)
+            for (unsigned i = ticket - s; i; i--) cpu_relax();
+        else
+            sched_yield();
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  McsLock
+ * ════════════════════════════════════════════════════════════════ */
+
+void mcs_lock(McsLock *l, McsNode *node)
+{
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->waiting, 1, memory_order_relaxed);
+    McsNode *prev = atomic_exchange_explicit(&l->tail, node, memory_order_acq_rel);
+    if (!prev) return;
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+    for (unsigned n = 0; atomic_load_explicit(&node->waiting, memory_order_acquire); n++) spin_wait(n);
+}
+
+void mcs_unlock(McsLock *l, McsNode *node)
+{
+    McsNode *next = atomic_load_explicit(&node->next, memory_order_acquire);
+    if (!next) {
+        McsNode *expected = node;
+        if (atomic_compare_exchange_strong_explicit(&l->tail, &expected, NULL, memory_order_release,
+                                                    memory_order_relaxed))
+            return;
+        /* Someone has swapped in behind us but not linked up yet */
+        for (unsigned n = 0; !(next = atomic_load_explicit(&node->next, memory_order_acquire)); n++)
+            spin_wait(n);
+    }
+    atomic_store_explicit(&next->waiting, 0, memory_order_release);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  AdaptiveLock
+ * ════════════════════════════════════════════════════════════════ */
+
+void adaptive_lock_slow(AdaptiveLock *l)
+{
+    unsigned avg   = atomic_load_explicit(&l->spins, memory_order_relaxed);
+    unsigned limit = avg * 2 + 10 < ADAPTIVE_MAX ? avg * 2 + 10 : ADAPTIVE_MAX;
+    unsigned round = 0, backoff = 1;
+    for (;;) {
+        if (round >= limit) {
+            fmutex_lock_slow(&l->m, atomic_load_explicit(&l->m.state, memory_order_relaxed));
+            break;
+        }
+        for (unsigned i = 0; i < backoff; i++) cpu_relax();
+        if (backoff < BACKOFF_MAX) backoff <<= 1;
+        round++;
+        /* Look before the CAS, so waiters do not keep taking the line */
+        if (atomic_load_explicit(&l->m.state, memory_order_relaxed) == 0 && fmutex_trylock(&l->m)) break;
+    }
+    /* glibc's estimate: an eighth of the way towards this acquisition */
+    atomic_store_explicit(&l->spins, (unsigned)((int)avg + ((int)round - (int)avg) / 8), memory_order_relaxed);
+}
@@ -0,0 +1,161 @@
+/*
+ * Chapter 14 — Locks built on atomics and futex()
+ *
+ * A pthread mutex is already a futex underneath; these show what it is
+ * made of, and the trade-offs it makes for you:
+ *
+ *   FutexMutex    Ulrich Drepper's "mutex3" ("Futexes Are Tricky"): one
+ *                 word, 0 free, 1 locked, 2 locked and maybe waited on.
+ *                 Lock and unlock are one atomic each when nobody
+ *                 waits; only a thread that has to sleep, and the
+ *                 unlock that follows it, make a system call.
+ *   FutexCond     a condition variable on a sequence word: a waiter
+ *                 sleeps until the word changes; broadcast moves the
+ *                 sleepers onto the mutex (FUTEX_CMP_REQUEUE) rather
+ *                 than wake them all to fight for it.
+ *   TicketLock    take a number, wait until it is served: strictly
+ *                 FIFO, but every waiter spins on the one word the
+ *                 holder writes, and a preempted waiter holds up all
+ *                 those behind it.
+ *   McsLock       Mellor-Crummey and Scott's queue lock: each waiter
+ *                 spins on a flag in its own McsNode (on its stack),
+ *                 which the previous holder sets — one cache line
+ *                 moves per hand-over, however many wait.
+ *   AdaptiveLock  FutexMutex's states, but a thread that finds it held
+ *                 first spins, pausing 1, 2, 4 ... cpu_relax()es
+ *                 between looks, and only parks when the spin budget
+ *                 runs out.  The budget follows how long recent
+ *                 acquisitions spun, as glibc's adaptive mutex does.
+ *
+ * The spinning locks (ticket, MCS) yield after a while, so a waiter
+ * does not burn the time slice of the very thread it waits for when
+ * there are more threads than CPUs — slow, but not stuck.
+ *
+ * Lock and unlock fast paths are inline; waiting is in lock.c.  Static
+ * initialisers are all-zero: *_INIT, or memset.  The locks are not
+ * recursive and not robust; unlocking a lock you do not hold is
+ * undefined.  futex() is Linux; elsewhere parking becomes
+ * sched_yield().
+ *
+ * Needs C11 (<stdatomic.h>).
+ */
+
+#ifndef LOCK_H
+#define LOCK_H
+
+#include <stdatomic.h>
+
+/* ── FutexMutex ─────────────────────────────────────────────────── */
+
+typedef struct {
+    atomic_uint state;          /* 0 free, 1 locked, 2 locked with waiters */
+} FutexMutex;
+
+#define FUTEX_MUTEX_INIT { 0 }
+
+void fmutex_lock_slow(FutexMutex *m, unsigned seen);
+void fmutex_wake(FutexMutex *m);
+
+static inline int fmutex_trylock(FutexMutex *m)
+{
+    unsigned c = 0;
+    return atomic_compare_exchange_strong_explicit(&m->state, &c, 1, memory_order_acquire,
+                                                   memory_order_relaxed);
+}
+
+static inline void fmutex_lock(FutexMutex *m)
+{
+    unsigned c = 0;
+    if (!atomic_compare_exchange_strong_explicit(&m->state, &c, 1, memory_order_acquire,
+                                                 memory_order_relaxed))
+        fmutex_lock_slow(m, c);
+}
+
+static inline void fmutex_unlock(FutexMutex *m)
+{
+    if (atomic_fetch_sub_explicit(&m->state, 1, memory_order_release) != 1) fmutex_wake(m);
+}
+
+/* ── FutexCond ──────────────────────────────────────────────────── */
+
+typedef struct {
+    atomic_uint seq;            /* + 1 on every signal or broadcast */
+    FutexMutex *_Atomic mutex;  /* the waiters', for broadcast's requeue */
+} FutexCond;
+
+#define FUTEX_COND_INIT { 0, NULL }
+
+/* Like pthread_cond_wait: m held on entry and on return; can wake
+ * spuriously, so wait in a loop on the condition.  Every waiter must
+ * use the same m */
+void fcond_wait(FutexCond *c, FutexMutex *m);
+void fcond_signal(FutexCond *c);
+void fcond_broadcast(FutexCond *c);
+
+/* ── TicketLock ─────────────────────────────────────────────────── */
+
+typedef struct {
+    atomic_uint next;           /* the next number to hand out */
+    atomic_uint serving;        /* the number that holds the lock */
+} TicketLock;
+
+#define TICKET_LOCK_INIT { 0, 0 }
+
+void ticket_wait(TicketLock *l, unsigned ticket);
+
+static inline void ticket_lock(TicketLock *l)
+{
+    unsigned t = atomic_fetch_add_explicit(&l->next, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&l->serving, memory_order_acquire) != t) ticket_wait(l, t);
+}
+
+static inline void ticket_unlock(TicketLock *l)
+{
+    unsigned s = atomic_load_explicit(&l->serving, memory_order_relaxed);
+    atomic_store_explicit(&l->serving, s + 1, memory_order_release);
+}
+
+/* ── McsLock ────────────────────────────────────────────────────── */
+
+typedef struct McsNode {
+    struct McsNode *_Atomic next;
+    atomic_int              waiting;
+} McsNode;
+
+typedef struct {
+    McsNode *_Atomic tail;      /* the last waiter, or the holder; NULL if free */
+} McsLock;
+
+#define MCS_LOCK_INIT { NULL }
+
+/* node is the caller's until the matching unlock returns */
+void mcs_lock(McsLock *l, McsNode *node);
+void mcs_unlock(McsLock *l, McsNode *node);
+
+/* ── AdaptiveLock ───────────────────────────────────────────────── */
+
+typedef struct {
+    FutexMutex  m;
+    atomic_uint spins;          /* recent spin rounds, averaged */
+} AdaptiveLock;
+
+#define ADAPTIVE_LOCK_INIT { FUTEX_MUTEX_INIT, 0 }
+
+void adaptive_lock_slow(AdaptiveLock *l);
+
+static inline int adaptive_trylock(AdaptiveLock *l)
+{
+    return fmutex_trylock(&l->m);
+}
+
+static inline void adaptive_lock(AdaptiveLock *l)
+{
+    if (!fmutex_trylock(&l->m)) adaptive_lock_slow(l);
+}
+
+static inline void adaptive_unlock(AdaptiveLock *l)
+{
+    fmutex_unlock(&l->m);
+}
+
+#endif /* LOCK_H */
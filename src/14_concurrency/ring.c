@@ -0,0 +1,327 @@
+/*
+ * Chapter 14 — Bounded lock-free queues of pointers
+ *
+ * See ring.h.  Sleeping and waking pair up like this:
+ *
+ *   waiter                          waker
+ *   v = seq | 1        (seq_cst)    publish the item (or the room)
+ *   try again; done if it works     fence              (seq_cst)
+ *   futex_wait(&seq, v)             if seq & 1: seq = seq + 2 & ~1,
+ *                                               futex_wake
+ *
+ * Either the waker's fence comes first and the waiter's retry sees the
+ * item, or the waker sees bit 0 and changes seq, and futex_wait()
+ * returns at once because seq is no longer v.  The waker clears the bit
+ * as it wakes, so pushes that follow, before the woken thread has run,
+ * make no system call.
+ */
+
+#define _GNU_SOURCE         /* syscall() */
+
+#include "ring.h"
+#include "futex.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#define SPINS 100           /* retries before yielding or sleeping */
+
+/* ════════════════════════════════════════════════════════════════
+ *  Waiting
+ * ════════════════════════════════════════════════════════════════ */
+
+static void wake(RingWaiters *w)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned v = atomic_load_explicit(&w->seq, memory_order_relaxed);
+    while (v & 1)
+        if (atomic_compare_exchange_weak_explicit(&w->seq, &v, (v + 2) & ~1u, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            futex_wake_all(&w->seq);
+            break;
+        }
+}
+
+typedef size_t (*RingOp)(void *ring, void **items, size_t n);
+
+/* op until it moves something: spin, then sleep (or yield) */
+static size_t wait_for(RingWaiters *w, int blocking, RingOp op, void *ring, void **items, size_t n)
+{
+    for (int spins = 0;; spins++) {
+        size_t k = op(ring, items, n);
+        if (k) return k;
+        if (spins < SPINS) {
+            cpu_relax();
+            continue;
+        }
+        if (!blocking) {
+            sched_yield();
+            continue;
+        }
+        unsigned v = atomic_fetch_or(&w->seq, 1) | 1;
+        k = op(ring, items, n);
+        if (k) return k;
+        futex_wait(&w->seq, v);
+    }
+}
+
+static uint64_t ring_size(size_t capacity)
+{
+    uint64_t n = 2;
+    while (n < capacity) n <<= 1;
+    return n;
+}
+
+static void waiters_init(RingWaiters *w)
+{
+    atomic_init(&w->seq, 0);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  SPSC
+ * ════════════════════════════════════════════════════════════════ */
+
+int spsc_init(SpscRing *r, size_t capacity, int flags)
+{
+    if (capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(void *)) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t n = ring_size(capacity);
+    r->slots   = malloc(n * sizeof(void *));
+    if (!r->slots) {
+        errno = ENOMEM;
+        return -1;
+    }
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->head, 0);
+    r->head_cache = r->tail_cache = 0;
+    r->mask       = n - 1;
+    r->blocking   = flags & RING_BLOCKING;
+    waiters_init(&r->not_full);
+    waiters_init(&r->not_empty);
+    return 0;
+}
+
+void spsc_destroy(SpscRing *r)
+{
+    free(r->slots);
+    r->slots = NULL;
+}
+
+size_t spsc_push_n(SpscRing *r, void *const *items, size_t n)
+{
+    uint64_t t    = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t room = r->mask + 1 - (t - r->head_cache);
+    if (room < n) {
+        r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+        room          = r->mask + 1 - (t - r->head_cache);
+    }
+    size_t k = n < room ? n : (size_t)room;
+    if (k == 0) return 0;
+    for (size_t i = 0; i < k; i++) r->slots[(t + i) & r->mask] = items[i];
+    atomic_store_explicit(&r->tail, t + k, memory_order_release);
+    if (r->blocking) wake(&r->not_empty);
+    return k;
+}
+
+size_t spsc_pop_n(SpscRing *r, void **out, size_t n)
+{
+    uint64_t h     = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint64_t avail = r->tail_cache - h;
+    if (avail < n) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        avail         = r->tail_cache - h;
+    }
+    size_t k = n < avail ? n : (size_t)avail;
+    if (k == 0) return 0;
+    for (size_t i = 0; i < k; i++) out[i] = r->slots[(h + i) & r->mask];
+    atomic_store_explicit(&r->head, h + k, memory_order_release);
+    if (r->blocking) wake(&r->not_full);
+    return k;
+}
+
+int spsc_push(SpscRing *r, void *item)
+{
+    return spsc_push_n(r, &item, 1) == 1;
+}
+
+void *spsc_pop(SpscRing *r)
+{
+    void *item;
+    return spsc_pop_n(r, &item, 1) ? item : NULL;
+}
+
+static size_t spsc_push_op(void *r, void **items, size_t n) { return spsc_push_n(r, items, n); }
+static size_t spsc_pop_op(void *r, void **items, size_t n)  { return spsc_pop_n(r, items, n); }
+
+void spsc_push_wait_n(SpscRing *r, void *const *items, size_t n)
+{
+    while (n) {
+        size_t k = wait_for(&r->not_full, r->blocking, spsc_push_op, r, (void **)items, n);
+        items += k;
+        n -= k;
+    }
+}
+
+void spsc_push_wait(SpscRing *r, void *item)
+{
+    spsc_push_wait_n(r, &item, 1);
+}
+
+size_t spsc_pop_wait_n(SpscRing *r, void **out, size_t n)
+{
+    return wait_for(&r->not_empty, r->blocking, spsc_pop_op, r, out, n);
+}
+
+void *spsc_pop_wait(SpscRing *r)
+{
+    void *item;
+    spsc_pop_wait_n(r, &item, 1);
+    return item;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  MPMC
+ * ════════════════════════════════════════════════════════════════ */
+
+int mpmc_init(MpmcRing *r, size_t capacity, int flags)
+{
+    if (capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(MpmcCell)) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t n = ring_size(capacity);
+    r->cells   = malloc(n * sizeof(MpmcCell));
+    if (!r->cells) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (uint64_t i = 0; i < n; i++) atomic_init(&r->cells[i].seq, i);
+    atomic_init(&r->enq, 0);
+    atomic_init(&r->deq, 0);
+    r->mask     = n - 1;
+    r->blocking = flags & RING_BLOCKING;
+    waiters_init(&r->not_full);
+    waiters_init(&r->not_empty);
+    return 0;
+}
+
+void mpmc_destroy(MpmcRing *r)
+{
+    free(r->cells);
+    r->cells = NULL;
+}
+
+/* Cells from pos on whose seq is pos + i + ready (0: free, 1: full), up
+ * to n; -1 if the first is a lap behind (full, or empty), 0 if another
+ * thread has taken pos already */
+static long ready_run(MpmcRing *r, uint64_t pos, size_t n, uint64_t ready)
+{
+    long k = 0;
+    for (; (size_t)k < n; k++) {
+        uint64_t seq  = atomic_load_explicit(&r->cells[(pos + k) & r->mask].seq, memory_order_acquire);
+        int64_t  diff = (int64_t)(seq - (pos + k + ready));
+        if (diff != 0) {
+            if (k == 0 && diff < 0) return -1;
+            break;
+        }
+    }
+    return k;
+}
+
+size_t mpmc_push_n(MpmcRing *r, void *const *items, size_t n)
+{
+    uint64_t pos = atomic_load_explicit(&r->enq, memory_order_relaxed);
+    for (;;) {
+        long k = ready_run(r, pos, n, 0);
+        if (k < 0) return 0;
+        if (k == 0) {
+            pos = atomic_load_explicit(&r->enq, memory_order_relaxed);
+            continue;
+        }
+        /* Nobody can take these cells but whoever moves enq past them */
+        if (atomic_compare_exchange_weak_explicit(&r->enq, &pos, pos + (uint64_t)k, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (long i = 0; i < k; i++) {
+                MpmcCell *c = &r->cells[(pos + i) & r->mask];
+                c->item     = items[i];
+                atomic_store_explicit(&c->seq, pos + i + 1, memory_order_release);
+            }
+            if (r->blocking) wake(&r->not_empty);
+            return (size_t)k;
+        }
+    }
+}
+
+size_t mpmc_pop_n(MpmcRing *r, void **out, size_t n)
+{
+    uint64_t pos = atomic_load_explicit(&r->deq, memory_order_relaxed);
+    for (;;) {
+        long k = ready_run(r, pos, n, 1);
+        if (k < 0) return 0;
+        if (k == 0) {
+            pos = atomic_load_explicit(&r->deq, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&r->deq, &pos, pos + (uint64_t)k, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (long i = 0; i < k; i++) {
+                MpmcCell *c = &r->cells[(pos + i) & r->mask];
+                out[i]      = c->item;
+                atomic_store_explicit(&c->seq, pos + i + r->mask + 1, memory_order_release);
+            }
+            if (r->blocking) wake(&r->not_full);
+            return (size_t)k;
+        }
+    }
+}
+
+size_t mpmc_count(MpmcRing *r)
+{
+    uint64_t d = atomic_load_explicit(&r->deq, memory_order_relaxed);
+    uint64_t e = atomic_load_explicit(&r->enq, memory_order_relaxed);
+    return e > d ? (size_t)(e - d) : 0;
+}
+
+int mpmc_push(MpmcRing *r, void *item)
+{
+    return mpmc_push_n(r, &item, 1) == 1;
+}
+
+void *mpmc_pop(MpmcRing *r)
+{
+    void *item;
+    return mpmc_pop_n(r, &item, 1) ? item : NULL;
+}
+
+static size_t mpmc_push_op(void *r, void **items, size_t n) { return mpmc_push_n(r, items, n); }
+static size_t mpmc_pop_op(void *r, void **items, size_t n)  { return mpmc_pop_n(r, items, n); }
+
+void mpmc_push_wait_n(MpmcRing *r, void *const *items, size_t n)
+{
+    while (n) {
+        size_t k = wait_for(&r->not_full, r->blocking, mpmc_push_op, r, (void **)items, n);
+        items += k;
+        n -= k;
+    }
+}
+
+void mpmc_push_wait(MpmcRing *r, void *item)
+{
+    mpmc_push_wait_n(r, &item, 1);
+}
+
+size_t mpmc_pop_wait_n(MpmcRing *r, void **out, size_t n)
+{
+    return wait_for(&r->not_empty, r->blocking, mpmc_pop_op, r, out, n);
+}
+
+void *mpmc_pop_wait(MpmcRing *r)
+{
+    void *item;
+    mpmc_pop_wait_n(r, &item, 1);
+    return item;
+}
@@ -0,0 +1,102 @@
+/*
+ * Chapter 14 — Bounded lock-free queues of pointers
+ *
+ * Two rings, both a power-of-two array of slots indexed by ever-growing
+ * 64-bit positions (position & mask is the slot):
+ *
+ *   SpscRing   one producer, one consumer; wait-free.  The producer
+ *              owns tail, the consumer head, each on its own cache
+ *              line, and each keeps a private copy of the other's
+ *              index, re-reading the shared one only when the copy
+ *              says the ring is full (or empty).  In steady state a
+ *              push or pop touches no line the other side writes
+ *              except the slot itself.
+ *   MpmcRing   any number of both; Dmitry Vyukov's bounded queue.
+ *              Every slot carries a sequence number that says whose
+ *              turn it is: seq == pos, free for the producer claiming
+ *              pos; seq == pos + 1, full, for the consumer claiming
+ *              pos.  A producer claims a position with one CAS on the
+ *              enqueue index, a batch of n with one CAS for all n.
+ *
+ * push/pop never block: they return 0 (full, empty) instead of waiting.
+ * The _n forms move up to n items and return how many they moved.
+ *
+ * A ring created with RING_BLOCKING also supports the _wait forms,
+ * which sleep in futex() (Linux; sched_yield() elsewhere) rather than
+ * spin until there is room or an item.  That costs every push and pop
+ * a full fence and a load to see whether anyone sleeps, so without the
+ * flag the _wait forms only spin and yield.
+ *
+ * NULL cannot be queued: pop returns it for "empty".
+ *
+ * Needs C11 (<stdatomic.h>, _Alignas).
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_LINE     128
+#define RING_BLOCKING 1
+
+/* Sleepers on one condition ("has room", "has items"): the futex word,
+ * bit 0 set while someone sleeps or is about to, + 2 on every wake */
+typedef struct {
+    atomic_uint seq;
+} RingWaiters;
+
+typedef struct {
+    _Alignas(RING_LINE) atomic_uint_fast64_t tail;     /* producer's */
+    uint64_t                                 head_cache;
+    _Alignas(RING_LINE) atomic_uint_fast64_t head;     /* consumer's */
+    uint64_t                                 tail_cache;
+    _Alignas(RING_LINE) void               **slots;
+    uint64_t                                 mask;
+    int                                      blocking;
+    RingWaiters                              not_full, not_empty;
+} SpscRing;
+
+typedef struct {
+    atomic_uint_fast64_t seq;
+    void                *item;
+} MpmcCell;
+
+typedef struct {
+    _Alignas(RING_LINE) atomic_uint_fast64_t enq;
+    _Alignas(RING_LINE) atomic_uint_fast64_t deq;
+    _Alignas(RING_LINE) MpmcCell           *cells;
+    uint64_t                                 mask;
+    int                                      blocking;
+    RingWaiters                              not_full, not_empty;
+} MpmcRing;
+
+/* capacity is rounded up to a power of two (at least 2); flags is 0 or
+ * RING_BLOCKING.  0 on success; -1 with errno = EINVAL or ENOMEM */
+int    spsc_init(SpscRing *r, size_t capacity, int flags);
+void   spsc_destroy(SpscRing *r);
+int    spsc_push(SpscRing *r, void *item);                      /* 1 pushed, 0 full */
+void  *spsc_pop(SpscRing *r);                                   /* NULL if empty */
+size_t spsc_push_n(SpscRing *r, void *const *items, size_t n);
+size_t spsc_pop_n(SpscRing *r, void **out, size_t n);
+void   spsc_push_wait(SpscRing *r, void *item);
+void   spsc_push_wait_n(SpscRing *r, void *const *items, size_t n);   /* all n */
+void  *spsc_pop_wait(SpscRing *r);
+size_t spsc_pop_wait_n(SpscRing *r, void **out, size_t n);     /* at least 1 */
+
+int    mpmc_init(MpmcRing *r, size_t capacity, int flags);
+void   mpmc_destroy(MpmcRing *r);
+int    mpmc_push(MpmcRing *r, void *item);
+void  *mpmc_pop(MpmcRing *r);
+size_t mpmc_push_n(MpmcRing *r, void *const *items, size_t n);
+size_t mpmc_pop_n(MpmcRing *r, void **out, size_t n);
+/* Items queued; only a hint while other threads push or pop */
+size_t mpmc_count(MpmcRing *r);
+void   mpmc_push_wait(MpmcRing *r, void *item);
+void   mpmc_push_wait_n(MpmcRing *r, void *const *items, size_t n);
+void  *mpmc_pop_wait(MpmcRing *r);
+size_t mpmc_pop_wait_n(MpmcRing *r, void **out, size_t n);
+
+#endif /* RING_H */
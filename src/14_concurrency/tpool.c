@@ -0,0 +1,566 @@
+/*
+ * Chapter 14 — A work-stealing thread pool
+ *
+ * See tpool.h.  The deque is the Chase-Lev deque as written for C11 by
+ * Lê, Pop, Cohen and Zappa Nardelli ("Correct and Efficient
+ * Work-Stealing for Weak Memory Models", 2013), with a fixed-size
+ * buffer: when it is full, a task runs its range without splitting
+ * further rather than grow it.
+ *
+ * Sleeping and waking pair up like ring.c's:
+ *
+ *   worker                           pusher
+ *   v = epoch                        publish the task
+ *   sleepers++, waking = 0 (seq_cst) fence              (seq_cst)
+ *   look for work; done if found     if sleepers && !waking:
+ *   futex_wait(&epoch, v)                waking = 1, epoch++, futex_wake(1)
+ *   sleepers--, waking = 0
+ *
+ * waking keeps a burst of pushes to one wake-up; the woken worker clears
+ * it, and if it then finds work, wakes the next.  A wake that reached
+ * nobody can leave waking set, so a worker clears it again on its way
+ * to sleep; the pusher that saw it set published its task before that,
+ * and the worker's look for work finds it.
+ */
+
+#define _GNU_SOURCE         /* pthread_setaffinity_np(), syscall() */
+
+#include "tpool.h"
+#include "ring.h"
+#include "futex.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define POOL_LINE   128
+#define DEQUE_SIZE  4096    /* tasks per worker; a power of two */
+#define INJECT_SIZE 1024    /* queued jobs from outside the pool */
+#define SPINS       64      /* empty searches before parking */
+#define MAX_THREADS 1024
+
+/* ════════════════════════════════════════════════════════════════
+ *  Types
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    TPoolForFn    fn;               /* one of fn, map */
+    TPoolMapFn    map;
+    void         *ctx;
+    char         *accs;             /* map: one accumulator per worker */
+    size_t        stride;
+    size_t        grain;
+    atomic_size_t pending;          /* indices not yet run */
+    atomic_uint   done;             /* futex word: 1 once pending is 0 */
+} Job;
+
+typedef struct {
+    Job   *job;
+    size_t begin, end;
+} Task;
+
+typedef struct {
+    _Alignas(POOL_LINE) _Atomic int64_t top;        /* thieves' end */
+    _Alignas(POOL_LINE) _Atomic int64_t bottom;     /* owner's end */
+    _Atomic(Task *) *buf;
+} Deque;
+
+/* Written only by the owning worker; read by tpool_stats() */
+typedef struct {
+    atomic_uint_fast64_t tasks, splits, steals, steal_misses, parks, idle_ns;
+} Counts;
+
+typedef struct {
+    Deque     dq;
+    _Alignas(POOL_LINE) Counts c;
+    TPool    *pool;
+    int       id;
+    uint32_t  rng;
+    pthread_t tid;
+} Worker;
+
+struct TPool {
+    Worker     *workers;
+    int         n;
+    int         flags;
+    MpmcRing    inject;
+    TPoolStats  base;               /* tpool_stats_reset()'s snapshot */
+    _Alignas(POOL_LINE) atomic_uint epoch;
+    atomic_int  sleepers;
+    atomic_int  waking;
+    atomic_int  stop;
+};
+
+static _Thread_local Worker *self;
+
+/* Stand-in for "another thief got it" */
+static Task abort_task;
+#define ABORT (&abort_task)
+
+/* ════════════════════════════════════════════════════════════════
+ *  Helpers
+ * ════════════════════════════════════════════════════════════════ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Only the owner writes its counts, so no read-modify-write is needed */
+static void bump(atomic_uint_fast64_t *c, uint64_t by)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+static uint32_t next_rand(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Chase-Lev deque
+ * ════════════════════════════════════════════════════════════════ */
+
+static int deque_init(Deque *d)
+{
+    d->buf = malloc(DEQUE_SIZE * sizeof *d->buf);
+    if (!d->buf) return -1;
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    return 0;
+}
+
+/* Owner only.  0 if full */
+static int deque_push(Deque *d, Task *t)
+{
+    int64_t b   = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - top >= DEQUE_SIZE) return 0;
+    atomic_store_explicit(&d->buf[b & (DEQUE_SIZE - 1)], t, memory_order_relaxed);
+    /* The paper's release fence and relaxed store, as one release store
+     * (the same code on x86, and visible to ThreadSanitizer) */
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return 1;
+}
+
+/* Owner only: the newest task, or NULL */
+static Task *deque_take(Deque *d)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&d->top, memory_order_relaxed);
+    Task   *t   = NULL;
+    if (top <= b) {
+        t = atomic_load_explicit(&d->buf[b & (DEQUE_SIZE - 1)], memory_order_relaxed);
+        if (top == b) {
+            /* The last one: race the thieves for it */
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed))
+                t = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return t;
+}
+
+/* Anyone: the oldest task, NULL if empty, ABORT if another thread took it */
+static Task *deque_steal(Deque *d)
+{
+    int64_t top = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (top >= b) return NULL;
+    Task *t = atomic_load_explicit(&d->buf[top & (DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return ABORT;
+    return t;
+}
+
+static int deque_has_work(Deque *d)
+{
+    return atomic_load_explicit(&d->bottom, memory_order_relaxed) >
+           atomic_load_explicit(&d->top, memory_order_relaxed);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scheduling
+ * ════════════════════════════════════════════════════════════════ */
+
+static void notify(TPool *p)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&p->sleepers, memory_order_relaxed) == 0) return;
+    if (atomic_exchange_explicit(&p->waking, 1, memory_order_relaxed)) return;
+    atomic_fetch_add_explicit(&p->epoch, 1, memory_order_relaxed);
+    futex_wake(&p->epoch, 1);
+}
+
+static int has_work(TPool *p)
+{
+    if (mpmc_count(&p->inject)) return 1;
+    for (int i = 0; i < p->n; i++)
+        if (deque_has_work(&p->workers[i].dq)) return 1;
+    return 0;
+}
+
+/* Own deque, then the inject queue, then one round of victims from a
+ * random starting point */
+static Task *find_task(TPool *p, Worker *w)
+{
+    Task *t = deque_take(&w->dq);
+    if (t) return t;
+    t = mpmc_pop(&p->inject);
+    if (t) {
+        notify(p);
+        return t;
+    }
+    int start = (int)(next_rand(&w->rng) % (uint32_t)p->n);
+    for (int i = 0; i < p->n; i++) {
+        Worker *v = &p->workers[(start + i) % p->n];
+        if (v == w) continue;
+        t = deque_steal(&v->dq);
+        if (t == ABORT) {
+            bump(&w->c.steal_misses, 1);
+        } else if (t) {
+            bump(&w->c.steals, 1);
+            notify(p);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/* Split off upper halves for thieves until the range is at most grain,
+ * then run it */
+static void run_task(Worker *w, Task *t)
+{
+    Job   *j = t->job;
+    size_t b = t->begin, e = t->end;
+    free(t);
+    while (e - b > j->grain) {
+        size_t mid = b + (e - b) / 2;
+        Task  *up  = malloc(sizeof *up);
+        if (!up) break;
+        *up = (Task){ j, mid, e };
+        if (!deque_push(&w->dq, up)) {
+            free(up);
+            break;
+        }
+        bump(&w->c.splits, 1);
+        notify(w->pool);
+        e = mid;
+    }
+    if (j->map) j->map(b, e, j->ctx, j->accs + (size_t)w->id * j->stride);
+    else        j->fn(b, e, j->ctx);
+    bump(&w->c.tasks, 1);
+    if (atomic_fetch_sub_explicit(&j->pending, e - b, memory_order_acq_rel) == e - b) {
+        /* The caller may return as soon as it sees done, so j can be
+         * gone by the wake; futex_wake() only uses the address */
+        atomic_store_explicit(&j->done, 1, memory_order_release);
+        futex_wake(&j->done, INT_MAX);
+    }
+}
+
+static void park(TPool *p)
+{
+    unsigned v = atomic_load_explicit(&p->epoch, memory_order_acquire);
+    atomic_fetch_add(&p->sleepers, 1);
+    atomic_store(&p->waking, 0);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!has_work(p) && !atomic_load(&p->stop)) {
+        bump(&self->c.parks, 1);
+        futex_wait(&p->epoch, v);
+    }
+    atomic_fetch_sub(&p->sleepers, 1);
+    atomic_store_explicit(&p->waking, 0, memory_order_relaxed);
+}
+
+static void pin(Worker *w)
+{
+#ifdef __linux__
+    cpu_set_t allowed, one;
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0) return;
+    int count = CPU_COUNT(&allowed);
+    if (count == 0) return;
+    int k = w->id % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (k-- == 0) {
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof one, &one);
+            return;
+        }
+    }
+#else
+    (void)w;
+#endif
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *w = arg;
+    TPool  *p = w->pool;
+    self      = w;
+    if (p->flags & TPOOL_PIN) pin(w);
+    uint64_t idle_since = 0;
+    for (int misses = 0;;) {
+        Task *t = find_task(p, w);
+        if (t) {
+            if (idle_since) bump(&w->c.idle_ns, now_ns() - idle_since);
+            idle_since = 0;
+            misses     = 0;
+            run_task(w, t);
+            continue;
+        }
+        if (atomic_load_explicit(&p->stop, memory_order_acquire)) break;
+        if (!idle_since) idle_since = now_ns();
+        if (++misses < SPINS) {
+            if (misses % 16) cpu_relax();
+            else             sched_yield();
+            continue;
+        }
+        park(p);
+        misses = 0;
+    }
+    if (idle_since) bump(&w->c.idle_ns, now_ns() - idle_since);
+    return NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  TPool
+ * ════════════════════════════════════════════════════════════════ */
+
+static void stop_workers(TPool *p, int started)
+{
+    atomic_store_explicit(&p->stop, 1, memory_order_release);
+    atomic_fetch_add(&p->epoch, 1);
+    futex_wake(&p->epoch, INT_MAX);
+    for (int i = 0; i < started; i++) pthread_join(p->workers[i].tid, NULL);
+}
+
+static void free_pool(TPool *p)
+{
+    for (int i = 0; i < p->n; i++) free(p->workers[i].dq.buf);
+    free(p->workers);
+    mpmc_destroy(&p->inject);
+    free(p);
+}
+
+TPool *tpool_create(int threads, int flags)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads   = cpus > 0 ? (int)(cpus < MAX_THREADS ? cpus : MAX_THREADS) : 1;
+    }
+    if (threads < 1 || threads > MAX_THREADS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    TPool *p = aligned_alloc(POOL_LINE, (sizeof(TPool) + POOL_LINE - 1) / POOL_LINE * POOL_LINE);
+    if (!p) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(p, 0, sizeof *p);
+    p->n     = threads;
+    p->flags = flags;
+    atomic_init(&p->epoch, 0);
+    atomic_init(&p->sleepers, 0);
+    atomic_init(&p->waking, 0);
+    atomic_init(&p->stop, 0);
+    if (mpmc_init(&p->inject, INJECT_SIZE, 0) != 0) {
+        free(p);
+        return NULL;
+    }
+    p->workers = aligned_alloc(POOL_LINE, (size_t)threads * sizeof(Worker));
+    if (!p->workers) {
+        mpmc_destroy(&p->inject);
+        free(p);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(p->workers, 0, (size_t)threads * sizeof(Worker));
+    for (int i = 0; i < threads; i++) {
+        Worker *w = &p->workers[i];
+        w->pool   = p;
+        w->id     = i;
+        w->rng    = 0x9e3779b9u * (uint32_t)(i + 1);
+        if (deque_init(&w->dq) != 0) {
+            free_pool(p);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        int err = pthread_create(&p->workers[i].tid, NULL, worker_main, &p->workers[i]);
+        if (err != 0) {
+            stop_workers(p, i);
+            free_pool(p);
+            errno = err;
+            return NULL;
+        }
+    }
+    return p;
+}
+
+void tpool_destroy(TPool *p)
+{
+    if (!p) return;
+    stop_workers(p, p->n);
+    free_pool(p);
+}
+
+int tpool_threads(const TPool *p)
+{
+    return (p ? p : tpool_default())->n;
+}
+
+static TPool         *default_pool;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void make_default(void)
+{
+    default_pool = tpool_create(0, 0);
+}
+
+TPool *tpool_default(void)
+{
+    pthread_once(&default_once, make_default);
+    return default_pool;
+}
+
+int tpool_worker_index(const TPool *p)
+{
+    if (!p) p = tpool_default();
+    return self && self->pool == p ? self->id : -1;
+}
+
+static void read_counts(const TPool *p, TPoolStats *s)
+{
+    memset(s, 0, sizeof *s);
+    for (int i = 0; i < p->n; i++) {
+        const Counts *c = &p->workers[i].c;
+        s->tasks        += atomic_load_explicit(&c->tasks, memory_order_relaxed);
+        s->splits       += atomic_load_explicit(&c->splits, memory_order_relaxed);
+        s->steals       += atomic_load_explicit(&c->steals, memory_order_relaxed);
+        s->steal_misses += atomic_load_explicit(&c->steal_misses, memory_order_relaxed);
+        s->parks        += atomic_load_explicit(&c->parks, memory_order_relaxed);
+        s->idle_ns      += atomic_load_explicit(&c->idle_ns, memory_order_relaxed);
+    }
+}
+
+void tpool_stats(const TPool *p, TPoolStats *total)
+{
+    if (!p) p = tpool_default();
+    read_counts(p, total);
+    total->tasks        -= p->base.tasks;
+    total->splits       -= p->base.splits;
+    total->steals       -= p->base.steals;
+    total->steal_misses -= p->base.steal_misses;
+    total->parks        -= p->base.parks;
+    total->idle_ns      -= p->base.idle_ns;
+}
+
+void tpool_stats_reset(TPool *p)
+{
+    if (!p) p = tpool_default();
+    read_counts(p, &p->base);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  parallel_for / parallel_reduce
+ * ════════════════════════════════════════════════════════════════ */
+
+static void run_job(TPool *p, Job *j, size_t begin, size_t end)
+{
+    Task *root = malloc(sizeof *root);
+    if (!root) {
+        /* Nothing to split with: do it all here */
+        if (j->map) j->map(begin, end, j->ctx, j->accs);
+        else        j->fn(begin, end, j->ctx);
+        return;
+    }
+    *root = (Task){ j, begin, end };
+
+    Worker *w = self && self->pool == p ? self : NULL;
+    if (!w) {
+        /* From outside: queue it, and sleep until the last piece is done */
+        while (!mpmc_push(&p->inject, root)) sched_yield();
+        notify(p);
+        while (!atomic_load_explicit(&j->done, memory_order_acquire)) futex_wait(&j->done, 0);
+        return;
+    }
+
+    /* From a task: split it here, then help with whatever is around */
+    run_task(w, root);
+    for (int misses = 0; !atomic_load_explicit(&j->done, memory_order_acquire);) {
+        Task *t = find_task(p, w);
+        if (t) {
+            run_task(w, t);
+            misses = 0;
+        } else if (++misses < SPINS) {
+            cpu_relax();
+        } else {
+            /* The rest is running elsewhere: done is set before the wake */
+            futex_wait(&j->done, 0);
+        }
+    }
+}
+
+void parallel_for(TPool *p, size_t begin, size_t end, size_t grain, TPoolForFn fn, void *ctx)
+{
+    if (end <= begin) return;
+    if (!p) p = tpool_default();
+    if (!p) {
+        fn(begin, end, ctx);
+        return;
+    }
+    Job j = { .fn = fn, .ctx = ctx, .grain = grain ? grain : 1 };
+    atomic_init(&j.pending, end - begin);
+    atomic_init(&j.done, 0);
+    run_job(p, &j, begin, end);
+}
+
+void parallel_reduce(TPool *p, size_t begin, size_t end, size_t grain, TPoolMapFn map,
+                     TPoolCombineFn combine, void *result, size_t size, void *ctx)
+{
+    if (end <= begin) return;
+    if (!p) p = tpool_default();
+    if (!p) {
+        map(begin, end, ctx, result);
+        return;
+    }
+    /* Each accumulator on its own lines */
+    size_t stride = (size + POOL_LINE - 1) / POOL_LINE * POOL_LINE;
+    char  *accs   = aligned_alloc(POOL_LINE, stride * (size_t)p->n);
+    if (!accs) {
+        map(begin, end, ctx, result);
+        return;
+    }
+    for (int i = 0; i < p->n; i++) memcpy(accs + (size_t)i * stride, result, size);
+
+    Job j = { .map = map, .ctx = ctx, .accs = accs, .stride = stride, .grain = grain ? grain : 1 };
+    atomic_init(&j.pending, end - begin);
+    atomic_init(&j.done, 0);
+    run_job(p, &j, begin, end);
+
+    for (int i = 0; i < p->n; i++) combine(result, accs + (size_t)i * stride, ctx);
+    free(accs);
+}
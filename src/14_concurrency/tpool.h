@@ -0,0 +1,85 @@
+/*
+ * Chapter 14 — A work-stealing thread pool
+ *
+ * Each worker owns a Chase-Lev deque of tasks.  It pushes and pops at
+ * the bottom, LIFO, so it keeps working on what is hot in its cache;
+ * idle workers steal from the top of a randomly chosen victim's deque,
+ * taking the oldest and, under recursive splitting, largest piece.
+ * Callers outside the pool hand work in through an MPMC ring (ring.c).
+ *
+ * parallel_for() splits [begin, end) lazily: a task bigger than grain
+ * halves itself, pushes the upper half for anyone to steal and goes on
+ * with the lower half, until it is at most grain long and runs fn on
+ * it.  Called from one of the pool's own tasks, the caller works on
+ * the job too (stealing whatever it can) until the last index is done,
+ * so nesting is fine; called from outside, it hands the job in and
+ * sleeps until it is done.  parallel_reduce() does the same with one
+ * accumulator per worker, combined in worker order at the end;
+ * combine must be associative, and for floating point the result can
+ * differ in the last bits from run to run.
+ *
+ * A worker that finds nothing to run or steal spins briefly, then
+ * sleeps on a futex (Linux; it yields elsewhere).  Pushing work wakes
+ * one sleeper, and a worker whose steal succeeds wakes the next, so a
+ * burst of work fans out without one system call per task.
+ *
+ * TPOOL_PIN pins worker i to the i-th CPU of the process's affinity
+ * mask (pthread_setaffinity_np), wrapping around.
+ *
+ * tpool_stats() adds up what workers did since the last reset: tasks
+ * run, splits, steals and steals lost to another thief, times parked,
+ * and idle time (from finding no task until finding one).  Steals
+ * approaching the task count mean pieces too small to be worth moving;
+ * much idle time with few tasks means too few pieces to go round.
+ *
+ * Needs C11 (<stdatomic.h>, _Alignas, _Thread_local).
+ */
+
+#ifndef TPOOL_H
+#define TPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TPOOL_PIN 1
+
+typedef struct TPool TPool;
+
+typedef struct {
+    uint64_t tasks;             /* leaf ranges run */
+    uint64_t splits;
+    uint64_t steals;
+    uint64_t steal_misses;      /* the victim had work, another thief got it */
+    uint64_t parks;
+    uint64_t idle_ns;
+} TPoolStats;
+
+typedef void (*TPoolForFn)(size_t begin, size_t end, void *ctx);
+typedef void (*TPoolMapFn)(size_t begin, size_t end, void *ctx, void *acc);
+typedef void (*TPoolCombineFn)(void *acc, const void *other, void *ctx);
+
+/* threads == 0: one per online CPU.  NULL with errno on failure */
+TPool *tpool_create(int threads, int flags);
+void  tpool_destroy(TPool *p);
+int   tpool_threads(const TPool *p);
+
+/* The pool the NULL pool argument means: created on first use with one
+ * worker per online CPU, never destroyed */
+TPool *tpool_default(void);
+
+/* fn over [begin, end) in pieces of at most grain (0: 1) indices;
+ * returns when every piece has run */
+void  parallel_for(TPool *p, size_t begin, size_t end, size_t grain, TPoolForFn fn, void *ctx);
+
+/* result holds the identity on entry (size bytes, copied into every
+ * accumulator) and the combined result on return */
+void  parallel_reduce(TPool *p, size_t begin, size_t end, size_t grain, TPoolMapFn map,
+                      TPoolCombineFn combine, void *result, size_t size, void *ctx);
+
+/* The calling thread's worker number in p, or -1 */
+int   tpool_worker_index(const TPool *p);
+
+void  tpool_stats(const TPool *p, TPoolStats *total);
+void  tpool_stats_reset(TPool *p);
+
+#endif /* TPOOL_H */
@@ -0,0 +1,323 @@
+/*
+ * bench_ipc — pipe vs vmsplice vs a shared-memory ring, child to parent
+ *
+ * For each transport (ipc.h) and message size, a forked child sends
+ * and the parent receives:
+ *
+ *   stream   the child sends messages back to back; the parent times
+ *            from the first message's send to the last one's arrival
+ *            — GB/s and messages per second
+ *   latency  the child sends one message, then waits for an 8-byte
+ *            ack on a second channel of the same kind; the parent
+ *            times each from send to complete arrival — p50 and p99
+ *
+ * Each message starts with its sequence number and the sender's
+ * CLOCK_MONOTONIC, and ends with the sequence number again; a message
+ * out of order, or torn, exits 1.  The splice sender rotates through
+ * enough buffers that it never rewrites one the pipe still lends out.
+ * A stream sends --mb-stream MB (at least 64 and at most --max-msgs
+ * messages); a latency run sends 1/8 of that, in at most --lat-msgs.
+ *
+ * Build: make bench_ipc
+ * Run:   ./bin/bench_ipc [--sizes 64,4K,64K,1M,16M] [--transport NAME|all]
+ *                        [--capacity-kb 1024] [--mb-stream 256]
+ *                        [--max-msgs 200000] [--lat-msgs 2000]
+ *                        [--format text|csv|json]
+ */
+
+#define _GNU_SOURCE         /* MAP_ANONYMOUS */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../../include/bench.h"
+#include "ipc.h"
+
+#define MAX_SIZES 16
+#define MIN_MSG   24                /* seq, stamp, seq */
+
+typedef struct {
+    size_t         sizes[MAX_SIZES];
+    int            n_sizes;
+    int            transport;       /* -1 = all */
+    size_t         capacity;
+    uint64_t       stream_bytes;
+    uint64_t       max_msgs, lat_msgs;
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    int      ok;
+    int      err;
+    int      bad;
+    uint64_t msgs, ns;              /* stream */
+    uint64_t lat_msgs, p50, p99;    /* latency */
+} Result;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Messages
+ * ════════════════════════════════════════════════════════════════ */
+
+static void stamp(unsigned char *m, size_t len, uint64_t seq)
+{
+    uint64_t now = bench_now_ns();
+    memcpy(m, &seq, 8);
+    memcpy(m + 8, &now, 8);
+    memcpy(m + len - 8, &seq, 8);
+}
+
+/* The send time, or 0 if m is not message seq */
+static uint64_t check(const unsigned char *m, size_t len, uint64_t seq)
+{
+    uint64_t a, b, t;
+    memcpy(&a, m, 8);
+    memcpy(&t, m + 8, 8);
+    memcpy(&b, m + len - 8, 8);
+    return a == seq && b == seq ? t : 0;
+}
+
+static uint64_t clamp(uint64_t v, uint64_t lo, uint64_t hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  One run
+ * ════════════════════════════════════════════════════════════════ */
+
+/* The child: send n messages of len, waiting for an ack after each
+ * when ack is set.  Exits nonzero on error */
+static void child(IpcChannel *data, IpcChannel *ack, size_t len, uint64_t n, int splice)
+{
+    ipc_sender(data);
+    if (ack) ipc_receiver(ack);
+    /* Pipe capacity / len + 1 buffers, so a lent one is gone before reuse */
+    size_t nbuf = splice ? ipc_capacity(data) / len + 2 : 1;
+    unsigned char *bufs = malloc(nbuf * len);
+    if (!bufs) _exit(2);
+    memset(bufs, 0xa5, nbuf * len);
+
+    int      waiting = ack != NULL;
+    uint64_t reply;
+    for (uint64_t seq = 0; seq < n; seq++) {
+        unsigned char *m = bufs + (size_t)(seq % nbuf) * len;
+        stamp(m, len, seq);
+        if (ipc_send(data, m, len) != 0) _exit(3);
+        if (waiting && ipc_recv(ack, &reply, sizeof(reply)) != sizeof(reply)) _exit(4);
+    }
+    ipc_close_send(data);
+    /* No free(bufs): the pipe may still hold pages lent from it, and a
+     * free() could write over them.  _exit() keeps the pages alive until
+     * the reader has taken them. */
+    _exit(0);
+}
+
+static int run(const Config *cfg, IpcTransport t, size_t len, int latency, uint64_t n, Result *r,
+               uint64_t *lat)
+{
+    IpcChannel *data = ipc_create(t, cfg->capacity);
+    IpcChannel *ack  = latency ? ipc_create(t, 0) : NULL;
+    unsigned char *buf = malloc(len);
+    if (!data || (latency && !ack) || !buf) {
+        r->err = errno;
+        ipc_destroy(data);
+        ipc_destroy(ack);
+        free(buf);
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) child(data, ack, len, n, t == IPC_SPLICE);
+    if (pid < 0) {
+        r->err = errno;
+        ipc_destroy(data);
+        ipc_destroy(ack);
+        free(buf);
+        return -1;
+    }
+    ipc_receiver(data);
+    if (ack) ipc_sender(ack);
+
+    uint64_t first = 0, last = 0, got = 0;
+    for (ssize_t m; (m = ipc_recv(data, buf, len)) > 0; got++) {
+        uint64_t now  = bench_now_ns();
+        uint64_t sent = (size_t)m == len ? check(buf, len, got) : 0;
+        if (!sent) {
+            r->bad = 1;
+            break;
+        }
+        if (got == 0) first = sent;
+        last = now;
+        if (latency) {
+            lat[got] = now - sent;
+            if (ipc_send(ack, &got, sizeof(got)) != 0) break;
+        }
+    }
+    int err = errno;
+    ipc_destroy(data);
+    ipc_destroy(ack);
+    free(buf);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (got != n || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (!r->bad) r->err = err ? err : EIO;
+        return -1;
+    }
+    if (latency) {
+        r->lat_msgs = n;
+        r->p50      = bench_percentile(lat, n, 50);
+        r->p99      = bench_percentile(lat, n, 99);
+    } else {
+        r->msgs = n;
+        r->ns   = last - first;
+    }
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--sizes 64,4K,64K,1M,16M] [--transport pipe|splice|shm|all]\n"
+            "       %*s [--capacity-kb 1024] [--mb-stream 256] [--max-msgs 200000]\n"
+            "       %*s [--lat-msgs 2000] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "", (int)strlen(argv0), "");
+}
+
+/* Sizes in bytes, with an optional K or M */
+static int parse_sizes(const char *val, Config *cfg)
+{
+    char list[256];
+    snprintf(list, sizeof(list), "%s", val);
+    cfg->n_sizes = 0;
+    for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char  *end;
+        size_t n = (size_t)strtoull(tok, &end, 10);
+        if (*end == 'K' || *end == 'k') n <<= 10, end++;
+        else if (*end == 'M' || *end == 'm') n <<= 20, end++;
+        if (*end || n < MIN_MSG || n > ((size_t)1 << 30) || cfg->n_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->n_sizes++] = n;
+    }
+    return cfg->n_sizes ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--sizes") == 0) {
+            if (parse_sizes(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--transport") == 0) {
+            IpcTransport t;
+            if (strcmp(val, "all") == 0)                 cfg->transport = -1;
+            else if (ipc_parse_transport(val, &t) == 0)  cfg->transport = (int)t;
+            else                                         return -1;
+        } else if (strcmp(opt, "--capacity-kb") == 0) {
+            cfg->capacity = (size_t)strtoull(val, NULL, 10) << 10;
+        } else if (strcmp(opt, "--mb-stream") == 0) {
+            cfg->stream_bytes = strtoull(val, NULL, 10) << 20;
+        } else if (strcmp(opt, "--max-msgs") == 0) {
+            cfg->max_msgs = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--lat-msgs") == 0) {
+            cfg->lat_msgs = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->capacity >= 4096 && cfg->max_msgs >= 64 && cfg->lat_msgs >= 8 ? 0 : -1;
+}
+
+static void report(const Config *cfg, IpcTransport t, size_t len, const Result *r, int *first)
+{
+    double secs = (double)r->ns / 1e9;
+    double gbs  = secs > 0 ? (double)(r->msgs * len) / secs / 1e9 : 0;
+    double rate = secs > 0 ? (double)r->msgs / secs : 0;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-7s %9zu", ipc_transport_name(t), len);
+        if (!r->ok) {
+            printf("  %s\n", r->bad ? "MESSAGES DIFFER" : strerror(r->err));
+            break;
+        }
+        printf(" %8llu %8.3f %11.0f %10.1f %10.1f\n", (unsigned long long)r->msgs, gbs, rate,
+               (double)r->p50 / 1e3, (double)r->p99 / 1e3);
+        break;
+    case BENCH_FMT_CSV:
+        if (!r->ok) break;
+        printf("%s,%zu,%llu,%.3f,%.0f,%.3f,%.3f\n", ipc_transport_name(t), len, (unsigned long long)r->msgs, gbs,
+               rate, (double)r->p50 / 1e3, (double)r->p99 / 1e3);
+        break;
+    case BENCH_FMT_JSON:
+        if (!r->ok) break;
+        printf("%s\n    { \"transport\": \"%s\", \"bytes\": %zu, \"messages\": %llu, \"gb_s\": %.3f, "
+               "\"msgs_per_s\": %.0f, \"p50_us\": %.3f, \"p99_us\": %.3f }",
+               *first ? "" : ",", ipc_transport_name(t), len, (unsigned long long)r->msgs, gbs, rate,
+               (double)r->p50 / 1e3, (double)r->p99 / 1e3);
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { 64, 4 << 10, 64 << 10, 1 << 20, 16 << 20 }, 5, -1, (size_t)1 << 20, (uint64_t)256 << 20,
+                   200000, 2000, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t *lat = malloc(cfg.lat_msgs * sizeof(*lat));
+    if (!lat) return 1;
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_ipc: child -> parent; capacity %zu KB; stream up to %llu MB, latency with an ack per "
+               "message\n\n",
+               cfg.capacity >> 10, (unsigned long long)(cfg.stream_bytes >> 20));
+        printf("  %-7s %9s %8s %8s %11s %10s %10s\n", "", "bytes", "msgs", "GB/s", "msgs/s", "p50 us", "p99 us");
+        break;
+    case BENCH_FMT_CSV:
+        printf("transport,bytes,messages,gb_s,msgs_per_s,p50_us,p99_us\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"ipc\",\n  \"results\": [");
+        break;
+    }
+
+    int failed = 0, first = 1;
+    for (int s = 0; s < cfg.n_sizes; s++) {
+        size_t len = cfg.sizes[s];
+        for (int t = 0; t < IPC_TRANSPORTS; t++) {
+            if (cfg.transport >= 0 && cfg.transport != t) continue;
+            Result   r;
+            uint64_t n    = clamp(cfg.stream_bytes / len, 64, cfg.max_msgs);
+            uint64_t nlat = clamp(cfg.stream_bytes / 8 / len, 8, cfg.lat_msgs);
+            memset(&r, 0, sizeof(r));
+            r.ok = run(&cfg, (IpcTransport)t, len, 0, n, &r, NULL) == 0 &&
+                   run(&cfg, (IpcTransport)t, len, 1, nlat, &r, lat) == 0;
+            report(&cfg, (IpcTransport)t, len, &r, &first);
+            failed |= r.bad || !r.ok;
+        }
+        if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    free(lat);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * Chapter 15 — Moving bulk data between a parent and a child
+ *
+ * See ipc.h.  Every transport carries the same stream: an 8-byte
+ * length, then the message.
+ *
+ * The shared ring is an SPSC byte queue: the sender owns tail, the
+ * receiver head, each on its own cache line.  Each side keeps its
+ * counter privately and publishes it every PUBLISH bytes, at the end
+ * of a message, and before it sleeps — so a large message streams
+ * while a small one costs one release store.  Sleeping is a futex on a
+ * sequence word the other side bumps:
+ *
+ *   sleeper:  seq = word; waiting = 1; recheck; futex_wait(word, seq)
+ *   waker:    publish; if (waiting) { word++; futex_wake(word) }
+ *
+ * The stores to waiting and to the counter, and the loads that follow
+ * them, are sequentially consistent, so either the sleeper's recheck
+ * sees the new counter or the waker sees waiting.  The mapping is
+ * shared between processes, so the futexes are not _PRIVATE.
+ */
+
+#define _GNU_SOURCE         /* vmsplice(), F_SETPIPE_SZ, syscall() */
+
+#include "ipc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define DEFAULT_CAP ((size_t)1 << 20)
+#define SPLICE_MIN  4096                    /* smaller messages are write()n */
+#define PUBLISH     ((uint64_t)64 << 10)    /* ring progress made visible this often */
+#define SPINS       2000                    /* polls before sleeping, with more than one CPU */
+#define CACHE_LINE  64
+
+typedef struct {
+    /* written by the sender */
+    uint64_t      tail;         /* bytes written */
+    uint32_t      tx_waiting;
+    uint32_t      closed;
+    uint32_t      data_seq;     /* futex: bumped when bytes arrive for a sleeping receiver */
+    char          pad1[CACHE_LINE - 20];
+    /* written by the receiver */
+    uint64_t      head;         /* bytes read */
+    uint32_t      rx_waiting;
+    uint32_t      gone;
+    uint32_t      space_seq;    /* futex: bumped when room appears for a sleeping sender */
+    char          pad2[CACHE_LINE - 20];
+    unsigned char bytes[];
+} Ring;
+
+enum { ROLE_BOTH, ROLE_SENDER, ROLE_RECEIVER };
+
+struct IpcChannel {
+    IpcTransport t;
+    int          role;
+    int          fd[2];         /* pipes: read end, write end */
+    size_t       cap;
+    Ring        *ring;
+    size_t       map_len;
+    uint64_t     pos;           /* private tail (sender) or head (receiver) */
+    uint64_t     published;
+    int          spins;
+    int          closed;
+};
+
+static const char *names[IPC_TRANSPORTS] = { "pipe", "splice", "shm" };
+
+const char *ipc_transport_name(IpcTransport t)
+{
+    return t >= 0 && t < IPC_TRANSPORTS ? names[t] : "?";
+}
+
+int ipc_parse_transport(const char *s, IpcTransport *out)
+{
+    for (int t = 0; t < IPC_TRANSPORTS; t++)
+        if (strcmp(s, names[t]) == 0) {
+            *out = (IpcTransport)t;
+            return 0;
+        }
+    return -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Helpers
+ * ════════════════════════════════════════════════════════════════ */
+
+static void futex_wait(uint32_t *word, uint32_t expected)
+{
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static void bump(uint32_t *word)
+{
+    __atomic_fetch_add(word, 1, __ATOMIC_SEQ_CST);
+    futex_wake(word);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Pipes
+ * ════════════════════════════════════════════════════════════════ */
+
+static int pipe_get(IpcChannel *c, void *buf, size_t n)
+{
+    while (n) {
+        ssize_t r = read(c->fd[0], buf, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return -1;
+        if (r == 0) return 1;               /* end of stream */
+        buf = (char *)buf + r;
+        n  -= (size_t)r;
+    }
+    return 0;
+}
+
+/* Write out every byte of iov[0 .. n-1]; vmsplice() for the splice
+ * transport.  Both may take part of an iovec */
+static int pipe_put(IpcChannel *c, struct iovec *iov, int n, int splice)
+{
+    while (n) {
+        ssize_t w = splice ? vmsplice(c->fd[1], iov, (unsigned long)n, 0) : writev(c->fd[1], iov, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) return -1;
+        size_t done = (size_t)w;
+        while (n && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n) {
+            iov->iov_base = (char *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Shared ring
+ * ════════════════════════════════════════════════════════════════ */
+
+static void ring_publish(IpcChannel *c)
+{
+    Ring *r = c->ring;
+    if (c->pos == c->published) return;
+    c->published = c->pos;
+    if (c->role == ROLE_SENDER) {
+        __atomic_store_n(&r->tail, c->pos, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&r->rx_waiting, __ATOMIC_SEQ_CST)) bump(&r->data_seq);
+    } else {
+        __atomic_store_n(&r->head, c->pos, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&r->tx_waiting, __ATOMIC_SEQ_CST)) bump(&r->space_seq);
+    }
+}
+
+/* Sleep until ready() or the other side has gone; the caller rechecks */
+static void ring_wait(IpcChannel *c, uint32_t *seq_word, uint32_t *waiting, int (*ready)(const IpcChannel *))
+{
+    ring_publish(c);
+    for (int i = 0; i < c->spins; i++) {
+        if (ready(c)) return;
+        cpu_relax();
+    }
+    uint32_t seq = __atomic_load_n(seq_word, __ATOMIC_ACQUIRE);
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+    if (!ready(c)) futex_wait(seq_word, seq);
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+}
+
+static int has_space(const IpcChannel *c)
+{
+    const Ring *r = c->ring;
+    return c->pos - __atomic_load_n(&r->head, __ATOMIC_SEQ_CST) < c->cap ||
+           __atomic_load_n(&r->gone, __ATOMIC_ACQUIRE);
+}
+
+static int has_data(const IpcChannel *c)
+{
+    const Ring *r = c->ring;
+    return __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST) != c->pos || __atomic_load_n(&r->closed, __ATOMIC_ACQUIRE);
+}
+
+static int ring_put(IpcChannel *c, const void *p, size_t n)
+{
+    Ring *r = c->ring;
+    while (n) {
+        uint64_t used = c->pos - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (used == c->cap) {
+            if (__atomic_load_n(&r->gone, __ATOMIC_ACQUIRE)) {
+                errno = EPIPE;
+                return -1;
+            }
+            ring_wait(c, &r->space_seq, &r->tx_waiting, has_space);
+            continue;
+        }
+        size_t off   = (size_t)(c->pos & (c->cap - 1));
+        size_t chunk = c->cap - (size_t)used;
+        if (chunk > c->cap - off) chunk = c->cap - off;
+        if (chunk > n)            chunk = n;
+        memcpy(r->bytes + off, p, chunk);
+        p       = (const char *)p + chunk;
+        n      -= chunk;
+        c->pos += chunk;
+        if (c->pos - c->published >= PUBLISH) ring_publish(c);
+    }
+    return 0;
+}
+
+/* 0, 1 at the end of the stream, -1 on error */
+static int ring_get(IpcChannel *c, void *p, size_t n)
+{
+    Ring *r = c->ring;
+    while (n) {
+        uint64_t avail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) - c->pos;
+        if (avail == 0) {
+            /* closed is set after the last publish: look at tail again */
+            if (__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE) && __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == c->pos)
+                return 1;
+            ring_wait(c, &r->data_seq, &r->rx_waiting, has_data);
+            continue;
+        }
+        size_t off   = (size_t)(c->pos & (c->cap - 1));
+        size_t chunk = avail < c->cap - off ? (size_t)avail : c->cap - off;
+        if (chunk > n) chunk = n;
+        memcpy(p, r->bytes + off, chunk);
+        p       = (char *)p + chunk;
+        n      -= chunk;
+        c->pos += chunk;
+        if (c->pos - c->published >= PUBLISH) ring_publish(c);
+    }
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Channels
+ * ════════════════════════════════════════════════════════════════ */
+
+IpcChannel *ipc_create(IpcTransport t, size_t capacity)
+{
+    if (t < 0 || t >= IPC_TRANSPORTS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    IpcChannel *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->t     = t;
+    c->fd[0] = c->fd[1] = -1;
+    c->cap   = capacity ? capacity : DEFAULT_CAP;
+
+    if (t == IPC_SHM) {
+        size_t cap = 4096;
+        while (cap < c->cap) cap <<= 1;
+        c->cap     = cap;
+        c->map_len = sizeof(Ring) + cap;
+        c->ring    = mmap(NULL, c->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (c->ring == MAP_FAILED) {
+            free(c);
+            return NULL;
+        }
+        c->spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPINS : 0;
+        return c;
+    }
+
+    if (pipe2(c->fd, O_CLOEXEC) != 0) {
+        free(c);
+        return NULL;
+    }
+    /* Best effort: keep whatever size the kernel allows */
+    fcntl(c->fd[1], F_SETPIPE_SZ, (int)(c->cap < INT_MAX ? c->cap : INT_MAX));
+    int got = fcntl(c->fd[1], F_GETPIPE_SZ);
+    if (got > 0) c->cap = (size_t)got;
+    return c;
+}
+
+void ipc_sender(IpcChannel *c)
+{
+    c->role = ROLE_SENDER;
+    if (c->fd[0] >= 0) close(c->fd[0]);
+    c->fd[0] = -1;
+}
+
+void ipc_receiver(IpcChannel *c)
+{
+    c->role = ROLE_RECEIVER;
+    if (c->fd[1] >= 0) close(c->fd[1]);
+    c->fd[1] = -1;
+}
+
+size_t ipc_capacity(const IpcChannel *c)
+{
+    return c->cap;
+}
+
+int ipc_send(IpcChannel *c, const void *msg, size_t len)
+{
+    uint64_t hdr = len;
+    if (c->closed) {
+        errno = EPIPE;
+        return -1;
+    }
+    if (c->t == IPC_SHM) {
+        if (ring_put(c, &hdr, sizeof(hdr)) != 0 || ring_put(c, msg, len) != 0) return -1;
+        ring_publish(c);
+        return 0;
+    }
+    struct iovec iov[2] = { { &hdr, sizeof(hdr) }, { (void *)msg, len } };
+    if (c->t == IPC_SPLICE && len >= SPLICE_MIN)
+        return pipe_put(c, iov, 1, 0) == 0 ? pipe_put(c, iov + 1, 1, 1) : -1;
+    return pipe_put(c, iov, 2, 0);
+}
+
+int ipc_close_send(IpcChannel *c)
+{
+    if (c->closed) return 0;
+    c->closed = 1;
+    if (c->t == IPC_SHM) {
+        ring_publish(c);
+        __atomic_store_n(&c->ring->closed, 1, __ATOMIC_RELEASE);
+        bump(&c->ring->data_seq);
+        return 0;
+    }
+    int rc = close(c->fd[1]);
+    c->fd[1] = -1;
+    return rc;
+}
+
+static int get(IpcChannel *c, void *buf, size_t n)
+{
+    return c->t == IPC_SHM ? ring_get(c, buf, n) : pipe_get(c, buf, n);
+}
+
+ssize_t ipc_recv(IpcChannel *c, void *buf, size_t cap)
+{
+    uint64_t hdr;
+    int      rc = get(c, &hdr, sizeof(hdr));
+    if (rc != 0) return rc > 0 ? 0 : -1;
+
+    if (hdr > cap) {                        /* keep the stream in step */
+        char scratch[4096];
+        for (uint64_t left = hdr; left;) {
+            size_t n = left < sizeof(scratch) ? (size_t)left : sizeof(scratch);
+            if ((rc = get(c, scratch, n)) != 0) break;
+            left -= n;
+        }
+        if (c->t == IPC_SHM) ring_publish(c);
+        errno = rc == 0 ? EMSGSIZE : rc > 0 ? EIO : errno;
+        return -1;
+    }
+    rc = get(c, buf, (size_t)hdr);
+    if (c->t == IPC_SHM) ring_publish(c);
+    if (rc != 0) {
+        if (rc > 0) errno = EIO;            /* the stream ended inside a message */
+        return -1;
+    }
+    return (ssize_t)hdr;
+}
+
+void ipc_destroy(IpcChannel *c)
+{
+    if (!c) return;
+    if (c->t == IPC_SHM) {
+        if (c->role == ROLE_SENDER) ipc_close_send(c);
+        if (c->role == ROLE_RECEIVER) {
+            ring_publish(c);
+            __atomic_store_n(&c->ring->gone, 1, __ATOMIC_RELEASE);
+            bump(&c->ring->space_seq);
+        }
+        munmap(c->ring, c->map_len);
+    }
+    if (c->fd[0] >= 0) close(c->fd[0]);
+    if (c->fd[1] >= 0) close(c->fd[1]);
+    free(c);
+}
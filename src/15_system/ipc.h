@@ -0,0 +1,72 @@
+/*
+ * Chapter 15 — Moving bulk data between a parent and a child
+ *
+ * One channel carries length-prefixed messages one way, from a sender
+ * process to a receiver process.  Create it before fork(); after it,
+ * each side calls ipc_sender() or ipc_receiver() to drop the ends it
+ * does not use.  Three transports, by who copies the bytes:
+ *
+ *   IPC_PIPE    write() and read(): the kernel copies into its pipe
+ *               buffers and out again — two copies, a system call per
+ *               message at each end.
+ *   IPC_SPLICE  vmsplice() puts the sender's pages themselves into the
+ *               pipe, by reference; read() copies them once, into the
+ *               receiver.  Messages under 4 KB are written as for
+ *               IPC_PIPE: referencing a page costs more than copying a
+ *               few bytes.
+ *   IPC_SHM     a byte ring in a MAP_SHARED|MAP_ANONYMOUS mapping that
+ *               both processes inherit: each side memcpy()s, and the
+ *               kernel takes part only when one side has to sleep —
+ *               on a futex in the ring, woken by the other.
+ *
+ * capacity is the pipe size (F_SETPIPE_SZ; unprivileged processes get
+ * at most /proc/sys/fs/pipe-max-size) or the ring size (rounded up to
+ * a power of two); 0 means 1 MB.  Messages may be larger: they stream
+ * through.
+ *
+ * IPC_SPLICE lends the buffer: the pipe reads it whenever the receiver
+ * does, so it must not change until then.  It is safe to reuse once at
+ * least ipc_capacity() bytes of later messages have gone through
+ * ipc_send() — the pipe cannot hold them and the old one too.
+ *
+ * ipc_send() returns 0, or -1 with errno: EPIPE once the receiver has
+ * gone (for the pipes, SIGPIPE first — the caller's to ignore).
+ * ipc_recv() returns the message length; 0 once the sender has called
+ * ipc_close_send() or ipc_destroy() (or, for the pipes, exited); or -1
+ * with errno — EMSGSIZE consumes a message longer than cap without
+ * storing it.  A sender that dies holding an IPC_SHM ring leaves its
+ * receiver waiting.  One sending and one receiving thread per channel.
+ */
+
+#ifndef IPC_H
+#define IPC_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef enum {
+    IPC_PIPE,
+    IPC_SPLICE,
+    IPC_SHM,
+    IPC_TRANSPORTS
+} IpcTransport;
+
+typedef struct IpcChannel IpcChannel;
+
+IpcChannel *ipc_create(IpcTransport t, size_t capacity);       /* NULL with errno */
+void        ipc_destroy(IpcChannel *c);                         /* in each process */
+
+void        ipc_sender(IpcChannel *c);
+void        ipc_receiver(IpcChannel *c);
+
+int         ipc_send(IpcChannel *c, const void *msg, size_t len);
+int         ipc_close_send(IpcChannel *c);
+ssize_t     ipc_recv(IpcChannel *c, void *buf, size_t cap);
+
+size_t      ipc_capacity(const IpcChannel *c);
+
+/* "pipe", "splice", "shm" */
+const char *ipc_transport_name(IpcTransport t);
+int         ipc_parse_transport(const char *s, IpcTransport *out);
+
+#endif /* IPC_H */
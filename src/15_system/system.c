@@ -13,6 +13,7 @@
  *   5. system() — convenience vs security trade-offs
  *   6. Pipes — IPC between parent and child via pipe() + fork()
  *   7. Time functions (time, localtime, strftime)
+ *   8. Bulk IPC — pipe vs vmsplice vs a shared-memory ring (ipc.h)
  *
  * Build: make 15_system
  * Run:   ./bin/15_system
@@ -28,6 +29,8 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include "../../include/bench.h"
+#include "ipc.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: Environment Variables
@@ -157,8 +160,10 @@ static void demo_fork(void)
 
     /* fork() duplicates the entire process.
      * Copy-On-Write (COW): the OS doesn't actually copy memory pages
-     * until one process writes to them.  This makes fork() fast even
-     * for processes using gigabytes of memory.
+     * until one process writes to them.  The page tables are still
+     * copied, though: milliseconds per GB of the parent's RSS.  To
+     * launch another program from a big process, vfork() or
+     * posix_spawn() skip that copy (chapter 27, spawn.c).
      *
      * File descriptors are INHERITED: child gets copies of all open
      * FDs (stdin, stdout, files, sockets, pipes).  This is how shell
@@ -326,6 +331,87 @@ static void demo_time(void)
     printf("  It is NOT thread-safe.  Use localtime_r() in threaded code.\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: Bulk IPC — pipe vs vmsplice vs a Shared Ring
+ * ════════════════════════════════════════════════════════════════ */
+
+#define IPC_DEMO_BYTES (8u << 20)
+#define IPC_DEMO_MSG   (64u << 10)
+
+static void demo_bulk_ipc(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: Bulk IPC — Zero-Copy Transports         ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    /* Section 6's pipe copies every byte twice: write() into kernel
+     * buffers, read() out again.  vmsplice() hands the pipe the
+     * sender's pages instead, so only the read copies; a ring in
+     * shared memory leaves the kernel out entirely until one side
+     * has to sleep.  The child sends 8 MB in 64 KB messages over each;
+     * the parent checks every byte. */
+    unsigned char *src = malloc(IPC_DEMO_BYTES);
+    unsigned char *dst = malloc(IPC_DEMO_BYTES);
+    if (!src || !dst) {
+        free(src);
+        free(dst);
+        return;
+    }
+    for (size_t i = 0; i < IPC_DEMO_BYTES; i++)
+        src[i] = (unsigned char)(i * 131 + (i >> 16));
+
+    for (int t = 0; t < IPC_TRANSPORTS; t++) {
+        IpcChannel *c = ipc_create((IpcTransport)t, 0);
+        if (!c) {
+            printf("  %-7s n/a (%s)\n", ipc_transport_name((IpcTransport)t), strerror(errno));
+            continue;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("  fork failed");
+            ipc_destroy(c);
+            break;
+        }
+        if (pid == 0) {
+            /* Each message is its own slice of src, so a page lent to
+             * the pipe by vmsplice() is never rewritten */
+            ipc_sender(c);
+            for (size_t off = 0; off < IPC_DEMO_BYTES; off += IPC_DEMO_MSG)
+                if (ipc_send(c, src + off, IPC_DEMO_MSG) != 0) _exit(1);
+            ipc_destroy(c);
+            _exit(0);
+        }
+
+        ipc_receiver(c);
+        size_t   got = 0;
+        ssize_t  n;
+        uint64_t t0 = 0, t1 = 0;
+        memset(dst, 0, IPC_DEMO_BYTES);
+        while (got < IPC_DEMO_BYTES && (n = ipc_recv(c, dst + got, IPC_DEMO_BYTES - got)) > 0) {
+            t1 = bench_now_ns();        /* timed from the first arrival: fork() excluded */
+            if (got == 0) t0 = t1;
+            got += (size_t)n;
+        }
+        ipc_destroy(c);
+        waitpid(pid, NULL, 0);
+        double ms = (double)(t1 - t0) / 1e6;
+
+        int ok = got == IPC_DEMO_BYTES && memcmp(src, dst, IPC_DEMO_BYTES) == 0;
+        printf("  %-7s %zu KB in %6.2f ms (%5.2f GB/s)  %s\n",
+               ipc_transport_name((IpcTransport)t), got >> 10, ms,
+               ms > 0 ? (double)got / (ms * 1e6) : 0.0, ok ? "verified" : "MISMATCH");
+    }
+    printf("\n");
+
+    printf("  Small messages favour the ring: no system call per message.\n");
+    printf("  Big ones favour vmsplice: one copy instead of two, however\n");
+    printf("  large.  See ./bin/bench_ipc for the full size sweep, with\n");
+    printf("  per-message latency.\n\n");
+
+    free(src);
+    free(dst);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════ */
@@ -341,6 +427,7 @@ int main(void)
     demo_system_cmd();
     demo_pipe();
     demo_time();
+    demo_bulk_ipc();
 
     DEMO_END();
     return 0;
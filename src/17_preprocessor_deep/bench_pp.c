@@ -0,0 +1,481 @@
+/*
+ * bench_pp — what pp.h's file cache, guard skip and memo save a build
+ *
+ * A synthetic project is written to a temporary directory: --headers
+ * headers, three in four with an #ifndef guard and the rest #pragma
+ * once, each including --fanout later ones and a base.h of shared
+ * macros, and comment-heavy like real headers; then --units sources
+ * that each include a handful of them and define --funcs functions
+ * built from the same few macro invocations.
+ *
+ * All units are preprocessed by one Pp, as a compile server would, in
+ * four ways:
+ *
+ *   naive        every #include resolved with stat(), opened, mapped
+ *                and read through (PP_NO_FILE_CACHE, PP_NO_GUARD_SKIP,
+ *                PP_NO_MEMO)
+ *   file cache   each header mapped once, each spelling resolved once
+ *   guard skip   and guarded or #pragma once headers not reread
+ *   memo         and repeated macro invocations not re-expanded
+ *
+ * Times are per unit from bench.h's runner, for a fresh Pp each run;
+ * opens, stat() calls, bytes read and skips are counted in one run.
+ * Every way must give the same tokens — each unit's output, whitespace
+ * runs taken as one, must hash the same, and the chapter 18 lexer must
+ * find the same tokens in it and no errors — or the benchmark exits 1.
+ * The files that cost the naive way most are then listed.
+ *
+ * Build: make bench_pp
+ * Run:   ./bin/bench_pp [--headers 200] [--fanout 4] [--units 20] [--funcs 40]
+ *                       [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../include/bench.h"
+#include "pp.h"
+#include "../18_lexical_analysis/lexer.h"
+
+#define N_MODES   4
+#define TOP_FILES 8
+
+typedef struct {
+    size_t         headers, fanout, units, funcs;
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    char     root[64];
+    char   **paths;                 /* every file written, to remove */
+    size_t   n_paths;
+    char   **units;                 /* the sources, to preprocess */
+} Project;
+
+typedef struct {
+    uint64_t hash;                  /* of every unit's output, spaces squeezed */
+    uint64_t tokens, errors;        /* the lexer's */
+    uint64_t out_bytes;
+    PpTotals totals;
+} Outcome;
+
+typedef struct {
+    const char *name;
+    unsigned    flags;
+} Mode;
+
+static const Mode modes[N_MODES] = {
+    { "naive",      PP_NO_FILE_CACHE | PP_NO_GUARD_SKIP | PP_NO_MEMO },
+    { "file cache", PP_NO_GUARD_SKIP | PP_NO_MEMO },
+    { "guard skip", PP_NO_MEMO },
+    { "memo",       0 },
+};
+
+static uint64_t xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The project
+ * ════════════════════════════════════════════════════════════════ */
+
+static int write_file(Project *p, const char *path, const StrBuf *b)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    size_t n = fwrite(sb_str(b), 1, sb_len(b), f);
+    if (fclose(f) != 0 || n != sb_len(b)) return -1;
+    char **paths = realloc(p->paths, (p->n_paths + 1) * sizeof *paths);
+    if (!paths) return -1;
+    p->paths = paths;
+    if (!(paths[p->n_paths] = strdup(path))) return -1;
+    p->n_paths++;
+    return 0;
+}
+
+static void comment_block(StrBuf *b, size_t n, uint64_t *seed)
+{
+    static const char *const words[] = { "returns", "the", "value", "of", "argument", "scaled", "by",
+                                         "entry", "table", "before", "calling", "must", "be", "locked" };
+    sb_puts(b, "/*\n");
+    for (size_t l = 0; l < n; l++) {
+        sb_puts(b, " *");
+        for (int w = 0; w < 9; w++) sb_printf(b, " %s", words[xorshift64(seed) % (sizeof words / sizeof words[0])]);
+        sb_putc(b, '\n');
+    }
+    sb_puts(b, " */\n");
+}
+
+static int make_project(Project *p, const Config *cfg, uint64_t *seed)
+{
+    memset(p, 0, sizeof *p);
+    snprintf(p->root, sizeof p->root, "/tmp/bench_pp.XXXXXX");
+    if (!mkdtemp(p->root)) return -1;
+
+    char   path[256];
+    StrBuf b;
+    int    rc = 0;
+    sb_init(&b);
+    snprintf(path, sizeof path, "%s/inc", p->root);
+    if (mkdir(path, 0700) != 0) rc = -1;
+    snprintf(path, sizeof path, "%s/src", p->root);
+    if (rc == 0 && mkdir(path, 0700) != 0) rc = -1;
+
+    /* base.h: the shared macros, included by every header */
+    sb_puts(&b, "#ifndef BASE_H\n#define BASE_H\n");
+    comment_block(&b, 12, seed);
+    sb_puts(&b, "#define SQR(x) ((x) * (x))\n"
+                "#define MUL(a, b) ((a) * (b))\n"
+                "#define ADD3(a, b, c) ((a) + (b) + (c))\n"
+                "#define POLY(x) ADD3(SQR(x), MUL(3, x), 7)\n"
+                "#define CLAMP0(x) ((x) - (x) * ((x) / ((x) * (x) + 1)))\n"
+                "#endif /* BASE_H */\n");
+    snprintf(path, sizeof path, "%s/inc/base.h", p->root);
+    if (rc == 0) rc = write_file(p, path, &b);
+
+    for (size_t h = 0; rc == 0 && h < cfg->headers; h++) {
+        int once = h % 4 == 3;
+        sb_clear(&b);
+        comment_block(&b, 3, seed);
+        if (once) sb_puts(&b, "#pragma once\n");
+        else      sb_printf(&b, "#ifndef H%zu_H\n#define H%zu_H\n", h, h);
+        sb_puts(&b, "#include \"base.h\"\n");
+        for (size_t k = 0; k < cfg->fanout && h + 1 < cfg->headers; k++)
+            sb_printf(&b, "#include <h%zu.h>\n", h + 1 + xorshift64(seed) % (cfg->headers - h - 1));
+        sb_printf(&b, "#define H%zu_K %zu\n#define H%zu_SCALE(x) MUL(x, H%zu_K)\n", h, h % 17, h, h);
+        for (int f = 0; f < 3; f++) {
+            comment_block(&b, 6, seed);
+            sb_printf(&b, "int h%zu_f%d(int x);\n", h, f);
+        }
+        sb_printf(&b, "#if H%zu_K > 8\nint h%zu_big(int x) { return H%zu_SCALE(x); }\n"
+                      "#else\nint h%zu_small(int x) { return SQR(x) + H%zu_K; }\n#endif\n",
+                  h, h, h, h, h);
+        if (!once) sb_printf(&b, "#endif /* H%zu_H */\n", h);
+        snprintf(path, sizeof path, "%s/inc/h%zu.h", p->root, h);
+        rc = write_file(p, path, &b);
+    }
+
+    size_t tops = cfg->headers / 4 ? cfg->headers / 4 : 1;
+    p->units = calloc(cfg->units, sizeof *p->units);
+    if (!p->units) rc = -1;
+    for (size_t u = 0; rc == 0 && u < cfg->units; u++) {
+        size_t hs[8];
+        sb_clear(&b);
+        comment_block(&b, 4, seed);
+        for (int k = 0; k < 8; k++) {
+            hs[k] = xorshift64(seed) % tops;
+            sb_printf(&b, "#include \"h%zu.h\"\n", hs[k]);
+        }
+        sb_putc(&b, '\n');
+        for (size_t f = 0; f < cfg->funcs; f++) {
+            size_t h = hs[f % 8];
+            sb_printf(&b, "int u%zu_f%zu(int x)\n{\n"
+                          "    int y = POLY(x) + POLY(x + 1) * CLAMP0(x);\n"
+                          "    return H%zu_SCALE(y) + SQR(POLY(x)) - h%zu_f%zu(y);\n}\n\n",
+                      u, f, h, h, f % 3);
+        }
+        snprintf(path, sizeof path, "%s/src/u%zu.c", p->root, u);
+        rc = write_file(p, path, &b);
+        if (rc == 0 && !(p->units[u] = strdup(path))) rc = -1;
+    }
+    sb_free(&b);
+    return rc;
+}
+
+static void remove_project(Project *p, const Config *cfg)
+{
+    char path[256];
+    for (size_t i = 0; i < p->n_paths; i++) {
+        unlink(p->paths[i]);
+        free(p->paths[i]);
+    }
+    for (size_t u = 0; p->units && u < cfg->units; u++) free(p->units[u]);
+    snprintf(path, sizeof path, "%s/inc", p->root);
+    rmdir(path);
+    snprintf(path, sizeof path, "%s/src", p->root);
+    rmdir(path);
+    rmdir(p->root);
+    free(p->paths);
+    free(p->units);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Running it
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Preprocess every unit with a new Pp; with o, also check the output */
+static Pp *build(const Config *cfg, const Project *p, unsigned flags, StrBuf *out, Outcome *o)
+{
+    char inc[sizeof p->root + 8];
+    Pp  *pp = pp_new(flags);
+    snprintf(inc, sizeof inc, "%s/inc", p->root);
+    if (!pp || pp_add_include_dir(pp, inc) != 0) {
+        pp_free(pp);
+        return NULL;
+    }
+    if (o) memset(o, 0, sizeof *o);
+    if (o) o->hash = 1469598103934665603ull;
+
+    for (size_t u = 0; u < cfg->units; u++) {
+        sb_clear(out);
+        if (pp_run(pp, p->units[u], out) != 0) {
+            fprintf(stderr, "bench_pp: %s\n", pp_error(pp));
+            pp_free(pp);
+            return NULL;
+        }
+        if (!o) continue;
+
+        const char *s = sb_str(out);
+        int space = 0;
+        for (size_t i = 0; i < sb_len(out); i++) {
+            unsigned char c = (unsigned char)s[i];
+            if (c == ' ' || c == '\n' || c == '\t') {
+                space = 1;
+                continue;
+            }
+            if (space) o->hash = (o->hash ^ ' ') * 1099511628211ull;
+            space   = 0;
+            o->hash = (o->hash ^ c) * 1099511628211ull;
+        }
+        o->hash = (o->hash ^ '\n') * 1099511628211ull;         /* between units */
+        o->out_bytes += sb_len(out);
+
+        TokenVec v;
+        token_vec_init(&v);
+        if (tokenize_spans(s, sb_len(out), &v) != 0) {
+            token_vec_free(&v);
+            pp_free(pp);
+            return NULL;
+        }
+        o->tokens += v.count;
+        for (size_t i = 0; i < v.count; i++) o->errors += v.data[i].type == TOK_ERROR;
+        token_vec_free(&v);
+    }
+    if (o) pp_totals(pp, &o->totals);
+    return pp;
+}
+
+static double time_mode(const Config *cfg, const Project *p, const Mode *m, StrBuf *out)
+{
+    bench_run_t run;
+    bench_run_init(&run, m->name, 1);
+    while (bench_run_next(&run)) {
+        for (uint64_t i = 0; i < run.batch; i++) {
+            Pp *pp = build(cfg, p, m->flags, out, NULL);
+            BENCH_OPAQUE(pp);
+            pp_free(pp);
+        }
+        bench_run_stop(&run);
+    }
+    return run.stats.median;
+}
+
+static void report(const Config *cfg, const Mode *m, double ns_per, double speedup, const Outcome *o,
+                   int same, int *first)
+{
+    const PpTotals *t = &o->totals;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-11s %10.1f %7.2fx %8llu %8llu %9.2f %8llu %9llu %9llu  %s\n", m->name, ns_per / 1e3, speedup,
+               (unsigned long long)t->opens, (unsigned long long)t->stats, (double)t->bytes / 1e6,
+               (unsigned long long)t->skipped, (unsigned long long)t->memo_hits, (unsigned long long)o->tokens,
+               same ? "✓" : "RESULTS DIFFER");
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%.1f,%.2f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d\n", m->name, ns_per, speedup,
+               (unsigned long long)t->opens, (unsigned long long)t->stats, (unsigned long long)t->bytes,
+               (unsigned long long)t->includes, (unsigned long long)t->skipped,
+               (unsigned long long)t->expansions, (unsigned long long)t->memo_hits,
+               (unsigned long long)o->tokens, same);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"mode\": \"%s\", \"ns_per_unit\": %.1f, \"vs_naive\": %.2f, \"opens\": %llu, "
+               "\"stats\": %llu, \"bytes_read\": %llu, \"includes\": %llu, \"skipped\": %llu, "
+               "\"expansions\": %llu, \"memo_hits\": %llu, \"tokens\": %llu, \"same_result\": %s }",
+               *first ? "" : ",", m->name, ns_per, speedup, (unsigned long long)t->opens,
+               (unsigned long long)t->stats, (unsigned long long)t->bytes, (unsigned long long)t->includes,
+               (unsigned long long)t->skipped, (unsigned long long)t->expansions,
+               (unsigned long long)t->memo_hits, (unsigned long long)o->tokens, same ? "true" : "false");
+        *first = 0;
+        break;
+    }
+}
+
+static const char *guard_name(const PpFileStats *s)
+{
+    return s->guard == PP_GUARD_IFNDEF ? "#ifndef" : s->guard == PP_GUARD_ONCE ? "once" : "-";
+}
+
+/* The files the naive way spent most time in, and what the best way did with them */
+static void report_files(const Config *cfg, const Pp *naive, const Pp *best)
+{
+    size_t n = pp_file_count(naive), top[TOP_FILES], k = 0;
+    for (; k < TOP_FILES && k < n; k++) {
+        size_t pick = SIZE_MAX;
+        for (size_t i = 0; i < n; i++) {
+            int used = 0;
+            for (size_t j = 0; j < k; j++) used |= top[j] == i;
+            if (!used && (pick == SIZE_MAX || pp_file_stats(naive, i)->ns > pp_file_stats(naive, pick)->ns)) pick = i;
+        }
+        top[k] = pick;
+    }
+
+    if (cfg->format == BENCH_FMT_TEXT)
+        printf("\n  Files the naive way spent most time in (one run; naive → memo):\n"
+               "  %-14s %-8s %9s %15s %15s %19s\n", "file", "guard", "includes", "opens", "scans", "µs (self)");
+    for (size_t j = 0; j < k; j++) {
+        const PpFileStats *a = pp_file_stats(naive, top[j]);
+        const PpFileStats *b = NULL;
+        for (size_t i = 0; i < pp_file_count(best); i++)
+            if (strcmp(pp_file_stats(best, i)->path, a->path) == 0) b = pp_file_stats(best, i);
+        if (!b) continue;
+        const char *name = strrchr(a->path, '/') ? strrchr(a->path, '/') + 1 : a->path;
+        switch (cfg->format) {
+        case BENCH_FMT_TEXT:
+            printf("  %-14s %-8s %9llu %6llu → %-6llu %6llu → %-6llu %8.1f → %-8.1f\n", name, guard_name(a),
+                   (unsigned long long)a->includes, (unsigned long long)a->opens, (unsigned long long)b->opens,
+                   (unsigned long long)a->scans, (unsigned long long)b->scans, (double)a->ns / 1e3,
+                   (double)b->ns / 1e3);
+            break;
+        case BENCH_FMT_CSV:
+            break;
+        case BENCH_FMT_JSON:
+            printf("%s\n    { \"file\": \"%s\", \"guard\": \"%s\", \"includes\": %llu, \"opens\": [%llu, %llu], "
+                   "\"scans\": [%llu, %llu], \"ns\": [%llu, %llu] }",
+                   j ? "," : "", name, guard_name(a), (unsigned long long)a->includes,
+                   (unsigned long long)a->opens, (unsigned long long)b->opens, (unsigned long long)a->scans,
+                   (unsigned long long)b->scans, (unsigned long long)a->ns, (unsigned long long)b->ns);
+            break;
+        }
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--headers 200] [--fanout 4] [--units 20] [--funcs 40]\n"
+            "       %*s [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--headers") == 0) {
+            cfg->headers = strtoul(val, NULL, 10);
+            if (cfg->headers < 1 || cfg->headers > 100000) return -1;
+        } else if (strcmp(opt, "--fanout") == 0) {
+            cfg->fanout = strtoul(val, NULL, 10);
+            if (cfg->fanout > 64) return -1;
+        } else if (strcmp(opt, "--units") == 0) {
+            cfg->units = strtoul(val, NULL, 10);
+            if (cfg->units < 1) return -1;
+        } else if (strcmp(opt, "--funcs") == 0) {
+            cfg->funcs = strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 200, 4, 20, 40, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Project  proj;
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    if (make_project(&proj, &cfg, &seed) != 0) {
+        perror("bench_pp");
+        remove_project(&proj, &cfg);
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_pp: %zu headers (fanout %zu), %zu units of %zu functions; µs per unit\n\n",
+               cfg.headers, cfg.fanout, cfg.units, cfg.funcs);
+        printf("  %-11s %10s %8s %8s %8s %9s %8s %9s %9s\n", "mode", "µs/unit", "vs naive", "opens", "stat()",
+               "MB read", "skipped", "memo hits", "tokens");
+        break;
+    case BENCH_FMT_CSV:
+        printf("mode,ns_per_unit,vs_naive,opens,stats,bytes_read,includes,skipped,expansions,memo_hits,tokens,"
+               "same_result\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"pp\",\n  \"headers\": %zu,\n  \"fanout\": %zu,\n  \"units\": %zu,\n"
+               "  \"funcs\": %zu,\n  \"results\": [",
+               cfg.headers, cfg.fanout, cfg.units, cfg.funcs);
+        break;
+    }
+
+    StrBuf  out;
+    Outcome ref, o;
+    Pp     *naive = NULL, *best = NULL;
+    double  base  = 0;
+    int     all   = 1, first = 1;
+    sb_init(&out);
+    for (int m = 0; m < N_MODES; m++) {
+        Pp *pp = build(&cfg, &proj, modes[m].flags, &out, &o);
+        if (!pp) {
+            all = 0;
+            break;
+        }
+        double ns   = time_mode(&cfg, &proj, &modes[m], &out) / (double)cfg.units;
+        int    same = o.errors == 0;
+        if (m == 0) {
+            base = ns;
+            ref  = o;
+        } else {
+            same &= o.hash == ref.hash && o.tokens == ref.tokens;
+        }
+        all &= same;
+        report(&cfg, &modes[m], ns, base / ns, &o, same, &first);
+        if (m == 0)
+            naive = pp;
+        else if (m == N_MODES - 1)
+            best = pp;
+        else
+            pp_free(pp);
+    }
+
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]");
+    if (naive && best) {
+        if (cfg.format == BENCH_FMT_JSON) printf(",\n  \"files\": [");
+        report_files(&cfg, naive, best);
+        if (cfg.format == BENCH_FMT_JSON) printf("\n  ]");
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n}\n");
+    if (cfg.format == BENCH_FMT_TEXT && all)
+        printf("\n  Every mode: identical tokens, %llu of them over %zu units lexed with no errors.\n",
+               (unsigned long long)ref.tokens, cfg.units);
+
+    pp_free(naive);
+    pp_free(best);
+    sb_free(&out);
+    remove_project(&proj, &cfg);
+    return all ? 0 : 1;
+}
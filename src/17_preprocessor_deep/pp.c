@@ -0,0 +1,1684 @@
+/*
+ * Chapter 17 — A working preprocessor (see pp.h)
+ *
+ * A file is read a line at a time.  Lines of text collect, as tokens
+ * pointing into the mapped file, until the next directive or the end
+ * of the file; that chunk is then macro-expanded and written out, so
+ * an invocation may span lines but never a directive, and every token
+ * is out before the file can be unmapped.
+ *
+ * Expansion works on token lists.  A macro's replacement is rescanned
+ * on its own, with the macro disabled — a name that meets its own
+ * disabled macro is painted and never expands again.  The one way the
+ * result can reach past the list is an invocation left open at its
+ * very end — a function-like name, or the name, its '(' and part of
+ * its arguments: that "open tail" goes back to the caller, to be
+ * finished by the tokens that follow there.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "pp.h"
+#include "../18_lexical_analysis/lexer.h"  /* SourceMap, and intern.h */
+
+#define PP_MAX_PARAMS 127
+#define PP_PATH_MAX   4096
+
+/* ════════════════════════════════════════════════════════════════
+ *  Tokens
+ * ════════════════════════════════════════════════════════════════ */
+
+enum {
+    PT_IDENT,
+    PT_NUMBER,                  /* a pp-number: 1, 0x1f, 1.5e+3, 10ul */
+    PT_CHAR,
+    PT_STRING,
+    PT_PUNCT,
+    PT_OTHER,                   /* any other single byte */
+    PT_SPACE,                   /* blanks, comments and \-newlines */
+    PT_NEWLINE,
+    PT_PLACEMARKER              /* an empty ## operand, gone once pasted */
+};
+
+#define PTF_NOEXPAND 0x1        /* painted: met its macro while disabled */
+#define PTF_MACRO    0x2        /* came out of a macro */
+#define PTF_PARAM    0x4        /* in a body: parameter number atom */
+#define PTF_COMMENT  0x8        /* a space run with a comment or \-newline */
+
+typedef struct {
+    const char *p;
+    uint32_t    len;
+    uint8_t     kind;
+    uint8_t     flags;
+    Atom        atom;           /* identifiers whose name is interned */
+} PpTok;
+
+typedef struct {
+    PpTok *v;
+    size_t n, cap;
+} PpToks;
+
+typedef struct {
+    const PpTok *v;
+    size_t       n;
+} PpSpan;
+
+typedef struct {
+    uint8_t  defined;
+    uint8_t  fn;
+    uint8_t  variadic;
+    uint32_t disabled;          /* > 0 while its replacement is rescanned */
+    uint32_t n_params;          /* __VA_ARGS__ is the last, if variadic */
+    PpTok   *body;
+    uint32_t n_body;
+    char    *text;              /* the body's bytes */
+} PpMacro;
+
+typedef struct {
+    uint64_t gen;               /* valid while pp->gen is still this */
+    PpTok   *toks;              /* the tokens, then their bytes: one block */
+    uint32_t n;
+} PpMemo;
+
+typedef struct {
+    char       *path;
+    size_t      dir_len;        /* path[0..dir_len) is its directory */
+    SourceMap   map;
+    int         mapped;
+    int         once;
+    Atom        guard;          /* the multiple-include guard, once known */
+    uint64_t    unit;           /* the last pp_run() that read it */
+    PpFileStats st;
+} PpFile;
+
+typedef struct {
+    uint8_t  active;            /* this branch is being output */
+    uint8_t  taken;             /* some branch of this #if has been */
+    uint8_t  parent;            /* the enclosing branch was active */
+    uint8_t  seen_else;
+    uint32_t line;
+} PpCond;
+
+struct Pp {
+    unsigned  flags;
+    char    **dirs;
+    size_t    n_dirs;
+    char    **defs;
+    size_t    n_defs;
+
+    Interner  names;            /* macro names and every body identifier */
+    PpMacro  *macros;           /* by atom */
+    size_t    n_macros;
+    Atom      va_args;
+    uint64_t  gen;              /* bumped by each #define and #undef */
+    uint64_t  painted;
+
+    Interner  keys;             /* "\1" dev ino, "\2" dir "\0" name */
+    uint32_t *lookup;           /* by key atom: file index + 1 */
+    size_t    n_lookup;
+    PpFile  **files;
+    size_t    n_files, cap_files;
+
+    Interner  memo_keys;        /* macro atom, then each argument's text */
+    PpMemo   *memo;             /* by memo key atom */
+    size_t    n_memo;
+
+    Arena     tmp;              /* pasted and stringified tokens */
+    PpToks    chunk;
+    PpToks    expanded;
+    PpToks    dir;
+    StrBuf    scratch;
+
+    StrBuf   *out;
+    int       prev_kind;        /* of the last token written */
+    int       prev_macro;
+    char      prev_last;
+
+    PpFile   *cur;
+    uint32_t  cur_line;
+    uint32_t  chunk_line;       /* where the text in chunk starts */
+    uint64_t  unit;
+    uint64_t  child_ns;
+    PpTotals  totals;
+    char      err[256];
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int pp_fail(Pp *pp, int err, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+static int pp_fail(Pp *pp, int err, const char *fmt, ...)
+{
+    int n = pp->cur ? snprintf(pp->err, sizeof pp->err, "%s:%u: ", pp->cur->path, pp->cur_line)
+                    : snprintf(pp->err, sizeof pp->err, "<command line>: ");
+    if (n < 0 || (size_t)n >= sizeof pp->err) n = 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(pp->err + n, sizeof pp->err - (size_t)n, fmt, ap);
+    va_end(ap);
+    errno = err;
+    return -1;
+}
+
+static int pp_oom(Pp *pp)
+{
+    return pp_fail(pp, ENOMEM, "out of memory");
+}
+
+static int pp_push(Pp *pp, PpToks *v, PpTok t)
+{
+    if (v->n == v->cap) {
+        size_t cap = v->cap ? 2 * v->cap : 64;
+        PpTok *p = realloc(v->v, cap * sizeof *p);
+        if (!p) return pp_oom(pp);
+        v->v   = p;
+        v->cap = cap;
+    }
+    v->v[v->n++] = t;
+    return 0;
+}
+
+static int is_ident_start(int c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_ident_char(int c)
+{
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+static int is_blank(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int is_space(const PpTok *t)
+{
+    return t->kind == PT_SPACE || t->kind == PT_NEWLINE;
+}
+
+static int tok_is(const PpTok *t, const char *s)
+{
+    size_t n = strlen(s);
+    return t->len == n && memcmp(t->p, s, n) == 0;
+}
+
+static int punct_is(const PpTok *t, char c)
+{
+    return t->kind == PT_PUNCT && t->len == 1 && t->p[0] == c;
+}
+
+static int paste_is(const PpTok *t)
+{
+    return t->kind == PT_PUNCT && t->len == 2 && t->p[0] == '#' && t->p[1] == '#';
+}
+
+static size_t skip_space(const PpTok *t, size_t i, size_t n)
+{
+    while (i < n && is_space(&t[i])) i++;
+    return i;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scanner
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *p, *end;
+    uint32_t    line;
+} Scan;
+
+static const char PUNCT3[][4] = { "...", "<<=", ">>=" };
+static const char PUNCT2[][3] = {
+    "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&",
+    "||", "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##"
+};
+
+/* The next token, or 0 at the end.  An identifier gets the atom of its
+ * name if that is interned already or, with insert, always */
+static int pp_scan(Pp *pp, Scan *s, PpTok *t, int insert)
+{
+    const char *p = s->p, *end = s->end;
+    if (p == end) return 0;
+
+    t->p     = p;
+    t->flags = 0;
+    t->atom  = ATOM_NONE;
+    int c = (unsigned char)*p;
+
+    if (c == '\n') {
+        t->kind = PT_NEWLINE;
+        s->line++;
+        p++;
+    } else if (is_blank(c) || c == '\\' || c == '/') {
+        const char *q = p;
+        for (;;) {
+            if (q < end && is_blank(*q)) {
+                q++;
+            } else if (q + 1 < end && q[0] == '\\' && q[1] == '\n') {
+                q += 2;
+                s->line++;
+                t->flags |= PTF_COMMENT;
+            } else if (q + 1 < end && q[0] == '/' && q[1] == '*') {
+                q += 2;
+                while (q < end && !(q[0] == '*' && q + 1 < end && q[1] == '/')) {
+                    if (*q == '\n') s->line++;
+                    q++;
+                }
+                q = q < end ? q + 2 : end;
+                t->flags |= PTF_COMMENT;
+            } else if (q + 1 < end && q[0] == '/' && q[1] == '/') {
+                while (q < end && *q != '\n') q++;
+                t->flags |= PTF_COMMENT;
+            } else {
+                break;
+            }
+        }
+        if (q > p) {
+            t->kind = PT_SPACE;
+            p = q;
+        } else {                        /* a lone '\\' or '/' */
+            t->kind = c == '/' ? PT_PUNCT : PT_OTHER;
+            p++;
+            if (c == '/' && p < end && *p == '=') p++;
+        }
+    } else if (is_ident_start(c)) {
+        while (p < end && is_ident_char(*p)) p++;
+        t->kind = PT_IDENT;
+        t->atom = insert ? intern(&pp->names, t->p, (size_t)(p - t->p))
+                         : intern_find(&pp->names, t->p, (size_t)(p - t->p));
+    } else if ((c >= '0' && c <= '9') || (c == '.' && p + 1 < end && p[1] >= '0' && p[1] <= '9')) {
+        p++;
+        while (p < end) {
+            char d = *p;
+            if ((d == 'e' || d == 'E' || d == 'p' || d == 'P') && p + 1 < end && (p[1] == '+' || p[1] == '-'))
+                p += 2;
+            else if (is_ident_char(d) || d == '.')
+                p++;
+            else
+                break;
+        }
+        t->kind = PT_NUMBER;
+    } else if (c == '"' || c == '\'') {
+        p++;
+        while (p < end && *p != c && *p != '\n') {
+            if (*p == '\\' && p + 1 < end) p++;
+            p++;
+        }
+        if (p < end && *p == c) p++;
+        t->kind = c == '"' ? PT_STRING : PT_CHAR;
+    } else {
+        size_t left = (size_t)(end - p), n = 0;
+        for (size_t i = 0; !n && left >= 3 && i < sizeof PUNCT3 / sizeof PUNCT3[0]; i++)
+            if (memcmp(p, PUNCT3[i], 3) == 0) n = 3;
+        for (size_t i = 0; !n && left >= 2 && i < sizeof PUNCT2 / sizeof PUNCT2[0]; i++)
+            if (memcmp(p, PUNCT2[i], 2) == 0) n = 2;
+        if (!n) n = 1;
+        t->kind = n > 1 || strchr("!#%&()*+,-.:;<=>?[]^{|}~", c) ? PT_PUNCT : PT_OTHER;
+        p += n;
+    }
+
+    t->len = (uint32_t)(p - t->p);
+    s->p   = p;
+    return 1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Macro table
+ * ════════════════════════════════════════════════════════════════ */
+
+static PpMacro *pp_macro(const Pp *pp, Atom a)
+{
+    return a != ATOM_NONE && a < pp->n_macros && pp->macros[a].defined ? &pp->macros[a] : NULL;
+}
+
+static void pp_macro_clear(PpMacro *m)
+{
+    free(m->body);
+    free(m->text);
+    memset(m, 0, sizeof *m);
+}
+
+static PpMacro *pp_macro_slot(Pp *pp, Atom a)
+{
+    if (a >= pp->n_macros) {
+        size_t n = pp->names.cap;
+        PpMacro *m = realloc(pp->macros, n * sizeof *m);
+        if (!m) return NULL;
+        memset(m + pp->n_macros, 0, (n - pp->n_macros) * sizeof *m);
+        pp->macros   = m;
+        pp->n_macros = n;
+    }
+    return &pp->macros[a];
+}
+
+/* #define, given the tokens after the directive name */
+static int pp_do_define(Pp *pp, const PpTok *t, size_t n)
+{
+    size_t i = skip_space(t, 0, n);
+    if (i == n || t[i].kind != PT_IDENT) return pp_fail(pp, EINVAL, "macro names must be identifiers");
+    Atom name = intern(&pp->names, t[i].p, t[i].len);
+    if (!name) return pp_oom(pp);
+    i++;
+
+    Atom     params[PP_MAX_PARAMS];
+    uint32_t np = 0;
+    int      fn = 0, variadic = 0;
+    if (i < n && punct_is(&t[i], '(')) {        /* no space before '(' */
+        fn = 1;
+        i  = skip_space(t, i + 1, n);
+        if (i < n && punct_is(&t[i], ')')) {
+            i++;
+        } else {
+            for (;;) {
+                i = skip_space(t, i, n);
+                if (np == PP_MAX_PARAMS) return pp_fail(pp, EINVAL, "more than %d parameters", PP_MAX_PARAMS);
+                if (i < n && t[i].kind == PT_PUNCT && tok_is(&t[i], "...")) {
+                    variadic     = 1;
+                    params[np++] = pp->va_args;
+                } else if (i < n && t[i].kind == PT_IDENT) {
+                    if (!(params[np++] = intern(&pp->names, t[i].p, t[i].len))) return pp_oom(pp);
+                } else {
+                    return pp_fail(pp, EINVAL, "expected parameter name");
+                }
+                i = skip_space(t, i + 1, n);
+                if (i < n && punct_is(&t[i], ',') && !variadic) {
+                    i++;
+                } else if (i < n && punct_is(&t[i], ')')) {
+                    i++;
+                    break;
+                } else {
+                    return pp_fail(pp, EINVAL, "expected ',' or ')' in parameter list");
+                }
+            }
+        }
+    }
+
+    size_t b = skip_space(t, i, n), e = n;
+    while (e > b && is_space(&t[e - 1])) e--;
+    if (e > b && (paste_is(&t[b]) || paste_is(&t[e - 1])))
+        return pp_fail(pp, EINVAL, "'##' cannot appear at either end of a macro expansion");
+
+    /* The body outlives the file it came from: copy its bytes */
+    size_t bytes = 0;
+    for (size_t k = b; k < e; k++) bytes += t[k].kind == PT_SPACE ? 1 : t[k].len;
+    PpTok *body = malloc((e - b + 1) * sizeof *body);
+    char  *text = malloc(bytes + 1);
+    if (!body || !text) {
+        free(body);
+        free(text);
+        return pp_oom(pp);
+    }
+    char *d = text;
+    for (size_t k = b; k < e; k++) {
+        PpTok *o = &body[k - b];
+        *o = t[k];
+        o->flags = 0;
+        if (t[k].kind == PT_SPACE) {
+            *d = ' ';
+            o->len = 1;
+        } else {
+            memcpy(d, t[k].p, t[k].len);
+        }
+        o->p = d;
+        d += o->len;
+        if (o->kind == PT_IDENT) {
+            if (!(o->atom = intern(&pp->names, o->p, o->len))) {
+                free(body);
+                free(text);
+                return pp_oom(pp);
+            }
+            for (uint32_t q = 0; q < np; q++) {
+                if (params[q] == o->atom) {
+                    o->flags = PTF_PARAM;
+                    o->atom  = q;
+                    break;
+                }
+            }
+        }
+    }
+
+    PpMacro *m = pp_macro_slot(pp, name);
+    if (!m) {
+        free(body);
+        free(text);
+        return pp_oom(pp);
+    }
+    pp_macro_clear(m);
+    m->defined  = 1;
+    m->fn       = (uint8_t)fn;
+    m->variadic = (uint8_t)variadic;
+    m->n_params = np;
+    m->body     = body;
+    m->n_body   = (uint32_t)(e - b);
+    m->text     = text;
+    pp->gen++;
+    return 0;
+}
+
+static int pp_do_undef(Pp *pp, const PpTok *t, size_t n)
+{
+    size_t i = skip_space(t, 0, n);
+    if (i == n || t[i].kind != PT_IDENT) return pp_fail(pp, EINVAL, "macro names must be identifiers");
+    PpMacro *m = pp_macro(pp, t[i].atom);
+    if (m) pp_macro_clear(m);
+    pp->gen++;
+    return 0;
+}
+
+static void pp_reset_macros(Pp *pp)
+{
+    for (size_t i = 0; i < pp->n_macros; i++) pp_macro_clear(&pp->macros[i]);
+    for (size_t i = 0; i < pp->n_memo; i++) free(pp->memo[i].toks);
+    free(pp->memo);
+    pp->memo   = NULL;
+    pp->n_memo = 0;
+    interner_free(&pp->memo_keys);
+    interner_init(&pp->memo_keys);
+    pp->gen++;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Expansion
+ * ════════════════════════════════════════════════════════════════ */
+
+#define PP_NO_OPEN SIZE_MAX
+
+static int pp_expand(Pp *pp, const PpTok *in, size_t n, PpToks *out, size_t *open);
+static int pp_expand_all(Pp *pp, const PpTok *in, size_t n, PpToks *out);
+
+/* The memo key of an invocation, or ATOM_NONE if an argument holds a
+ * painted name, whose expansion would depend on where it came from */
+static int pp_memo_key(Pp *pp, Atom name, const PpSpan *args, size_t n_args, Atom *key)
+{
+    StrBuf *k = &pp->scratch;
+    int bad = 0;
+    sb_clear(k);
+    bad |= sb_append(k, (const char *)&name, sizeof name);
+    for (size_t a = 0; a < n_args; a++) {
+        for (size_t i = 0; i < args[a].n; i++) {
+            const PpTok *t = &args[a].v[i];
+            if (t->flags & PTF_NOEXPAND) {
+                *key = ATOM_NONE;
+                return 0;
+            }
+            if (is_space(t))
+                bad |= sb_putc(k, ' ');
+            else
+                bad |= sb_append(k, t->p, t->len);
+        }
+        bad |= sb_putc(k, '\0');
+    }
+    if (bad || !(*key = intern(&pp->memo_keys, sb_str(k), sb_len(k)))) return pp_oom(pp);
+    return 0;
+}
+
+static int pp_memo_store(Pp *pp, Atom key, const PpTok *t, size_t n)
+{
+    if (key >= pp->n_memo) {
+        size_t cap = pp->memo_keys.cap;
+        PpMemo *m = realloc(pp->memo, cap * sizeof *m);
+        if (!m) return pp_oom(pp);
+        memset(m + pp->n_memo, 0, (cap - pp->n_memo) * sizeof *m);
+        pp->memo   = m;
+        pp->n_memo = cap;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) bytes += t[i].len;
+    PpTok *blk = malloc(n * sizeof *blk + bytes + 1);
+    if (!blk) return pp_oom(pp);
+    char *d = (char *)(blk + n);
+    for (size_t i = 0; i < n; i++) {
+        blk[i] = t[i];
+        memcpy(d, t[i].p, t[i].len);
+        blk[i].p = d;
+        d += t[i].len;
+    }
+    PpMemo *m = &pp->memo[key];
+    free(m->toks);
+    m->toks = blk;
+    m->n    = (uint32_t)n;
+    m->gen  = pp->gen;
+    return 0;
+}
+
+/* A copy of t in an expansion: marked as such, newlines flattened */
+static PpTok macro_tok(PpTok t)
+{
+    if (t.kind == PT_NEWLINE || t.kind == PT_SPACE) {
+        t.kind = PT_SPACE;
+        t.p    = " ";
+        t.len  = 1;
+    }
+    t.flags = (uint8_t)((t.flags & PTF_NOEXPAND) | PTF_MACRO);
+    return t;
+}
+
+static int pp_stringify(Pp *pp, const PpSpan *a, PpTok *out)
+{
+    StrBuf *b = &pp->scratch;
+    int bad = 0, space = 0;
+    sb_clear(b);
+    bad |= sb_putc(b, '"');
+    for (size_t i = 0; i < a->n; i++) {
+        const PpTok *t = &a->v[i];
+        if (is_space(t)) {
+            space = 1;
+            continue;
+        }
+        if (space) bad |= sb_putc(b, ' ');
+        space = 0;
+        if (t->kind == PT_STRING || t->kind == PT_CHAR) {
+            for (uint32_t k = 0; k < t->len; k++) {
+                if (t->p[k] == '"' || t->p[k] == '\\') bad |= sb_putc(b, '\\');
+                bad |= sb_putc(b, t->p[k]);
+            }
+        } else {
+            bad |= sb_append(b, t->p, t->len);
+        }
+    }
+    bad |= sb_putc(b, '"');
+
+    char *s = bad ? NULL : arena_alloc_aligned(&pp->tmp, sb_len(b), 1);
+    if (!s) return pp_oom(pp);
+    memcpy(s, sb_str(b), sb_len(b));
+    out->p     = s;
+    out->len   = (uint32_t)sb_len(b);
+    out->kind  = PT_STRING;
+    out->flags = PTF_MACRO;
+    out->atom  = ATOM_NONE;
+    return 0;
+}
+
+/* The last token of s ## r */
+static int pp_paste(Pp *pp, PpToks *s, PpTok r)
+{
+    if (s->n == 0 || s->v[s->n - 1].kind == PT_PLACEMARKER) {
+        if (s->n) s->n--;
+        return pp_push(pp, s, macro_tok(r));
+    }
+    if (r.kind == PT_PLACEMARKER) return 0;
+
+    PpTok *l = &s->v[s->n - 1];
+    size_t n = (size_t)l->len + r.len;
+    char  *p = arena_alloc_aligned(&pp->tmp, n, 1);
+    if (!p) return pp_oom(pp);
+    memcpy(p, l->p, l->len);
+    memcpy(p + l->len, r.p, r.len);
+
+    Scan  sc = { p, p + n, 0 };
+    PpTok t;
+    if (!pp_scan(pp, &sc, &t, 0) || sc.p != p + n || is_space(&t))
+        return pp_fail(pp, EINVAL, "pasting \"%.*s\" and \"%.*s\" does not give a valid preprocessing token",
+                       (int)l->len, l->p, (int)r.len, r.p);
+    t.flags = PTF_MACRO;
+    *l = t;
+    return 0;
+}
+
+/* m's body with the arguments put in: s is then to be rescanned */
+static int pp_substitute(Pp *pp, const PpMacro *m, const PpSpan *args, PpToks *s)
+{
+    PpToks *exp  = NULL;                /* arguments expanded, on first use */
+    char   *done = NULL;
+    if (m->n_params) {
+        exp  = calloc(m->n_params, sizeof *exp);
+        done = calloc(m->n_params, 1);
+        if (!exp || !done) {
+            free(exp);
+            free(done);
+            return pp_oom(pp);
+        }
+    }
+
+    int rc = 0, paste = 0;
+    for (uint32_t k = 0; rc == 0 && k < m->n_body; k++) {
+        const PpTok *b = &m->body[k];
+        if (b->kind == PT_SPACE) {
+            if (!paste) rc = pp_push(pp, s, macro_tok(*b));
+            continue;
+        }
+        if (paste_is(b)) {
+            while (s->n && s->v[s->n - 1].kind == PT_SPACE) s->n--;
+            paste = 1;
+            continue;
+        }
+
+        size_t next = skip_space(m->body, k + 1, m->n_body);
+        if (m->fn && punct_is(b, '#') && next < m->n_body && (m->body[next].flags & PTF_PARAM)) {
+            PpTok str;
+            rc = pp_stringify(pp, &args[m->body[next].atom], &str);
+            if (rc == 0) rc = paste ? pp_paste(pp, s, str) : pp_push(pp, s, str);
+            paste = 0;
+            k     = (uint32_t)next;
+            continue;
+        }
+
+        if (!(b->flags & PTF_PARAM)) {
+            rc    = paste ? pp_paste(pp, s, *b) : pp_push(pp, s, macro_tok(*b));
+            paste = 0;
+            continue;
+        }
+
+        uint32_t      p = b->atom;
+        const PpSpan *a = &args[p];
+        if (paste && m->variadic && p == m->n_params - 1 && s->n && punct_is(&s->v[s->n - 1], ',')) {
+            /* GNU ", ## __VA_ARGS__": the comma goes if there are none */
+            if (a->n == 0) s->n--;
+            for (size_t i = 0; rc == 0 && i < a->n; i++) rc = pp_push(pp, s, macro_tok(a->v[i]));
+        } else if (paste || (next < m->n_body && paste_is(&m->body[next]))) {
+            /* An operand of ## is pasted as written, not expanded */
+            if (a->n == 0) {
+                PpTok pm = { "", 0, PT_PLACEMARKER, PTF_MACRO, ATOM_NONE };
+                rc = paste ? pp_paste(pp, s, pm) : pp_push(pp, s, pm);
+            } else {
+                rc = paste ? pp_paste(pp, s, a->v[0]) : pp_push(pp, s, macro_tok(a->v[0]));
+                for (size_t i = 1; rc == 0 && i < a->n; i++) rc = pp_push(pp, s, macro_tok(a->v[i]));
+            }
+        } else {
+            if (!done[p]) {
+                rc      = pp_expand_all(pp, a->v, a->n, &exp[p]);
+                done[p] = 1;
+            }
+            for (size_t i = 0; rc == 0 && i < exp[p].n; i++) rc = pp_push(pp, s, macro_tok(exp[p].v[i]));
+        }
+        paste = 0;
+    }
+
+    size_t w = 0;
+    for (size_t i = 0; i < s->n; i++)
+        if (s->v[i].kind != PT_PLACEMARKER) s->v[w++] = s->v[i];
+    s->n = w;
+
+    for (uint32_t p = 0; p < m->n_params; p++) free(exp[p].v);
+    free(exp);
+    free(done);
+    return rc;
+}
+
+/* Expand an invocation of m (named name) onto out */
+static int pp_invoke(Pp *pp, Atom name, PpMacro *m, const PpSpan *args, size_t n_args,
+                     PpToks *out, size_t *open)
+{
+    pp->totals.expansions++;
+    *open = PP_NO_OPEN;
+
+    Atom key = ATOM_NONE;
+    if (m->fn && !(pp->flags & PP_NO_MEMO)) {
+        if (pp_memo_key(pp, name, args, n_args, &key) != 0) return -1;
+        if (key && key < pp->n_memo && pp->memo[key].toks && pp->memo[key].gen == pp->gen) {
+            const PpMemo *e = &pp->memo[key];
+            for (uint32_t i = 0; i < e->n; i++)
+                if (pp_push(pp, out, e->toks[i]) != 0) return -1;
+            pp->totals.memo_hits++;
+            return 0;
+        }
+    }
+
+    uint64_t painted = pp->painted;
+    size_t   mark    = out->n;
+    PpToks   s       = { NULL, 0, 0 };
+    int rc = pp_substitute(pp, m, args, &s);
+    if (rc == 0) {
+        m->disabled++;
+        rc = pp_expand(pp, s.v, s.n, out, open);
+        m->disabled--;
+    }
+    free(s.v);
+    if (rc == 0 && key && *open == PP_NO_OPEN && pp->painted == painted)
+        rc = pp_memo_store(pp, key, out->v + mark, out->n - mark);
+    return rc;
+}
+
+/* out[at..] is an invocation whose arguments went on past the list it
+ * came from: finish it with in[*i..n), and expand it.  1 if in ends
+ * first too, with the rest of in moved to out: the invocation is
+ * still open */
+static int pp_resume(Pp *pp, PpToks *out, size_t at, const PpTok *in, size_t *i, size_t n, size_t *open)
+{
+    size_t depth = 0, k;
+    for (size_t j = skip_space(out->v, at + 1, out->n) + 1; j < out->n; j++) {
+        if (punct_is(&out->v[j], '(')) depth++;
+        else if (punct_is(&out->v[j], ')')) depth--;
+    }
+    for (k = *i; k < n; k++) {
+        if (punct_is(&in[k], '(')) depth++;
+        else if (punct_is(&in[k], ')') && depth-- == 0) break;
+    }
+    if (k == n) {
+        for (; *i < n; (*i)++)
+            if (pp_push(pp, out, in[*i]) != 0) return -1;
+        return 1;
+    }
+
+    PpToks call = { NULL, 0, 0 };
+    int    rc   = 0;
+    for (size_t j = at; rc == 0 && j < out->n; j++) rc = pp_push(pp, &call, out->v[j]);
+    for (size_t j = *i; rc == 0 && j <= k; j++) rc = pp_push(pp, &call, in[j]);
+    out->n = at;
+    *i     = k + 1;
+    if (rc == 0) rc = pp_expand(pp, call.v, call.n, out, open);
+    free(call.v);
+    return rc;
+}
+
+/* Macro-expand in[0..n) onto out.  *open is where in out an
+ * invocation starts that in ended before finishing, or PP_NO_OPEN */
+static int pp_expand(Pp *pp, const PpTok *in, size_t n, PpToks *out, size_t *open)
+{
+    size_t i = 0, tail = PP_NO_OPEN;
+    int    have_pending = 0;
+    PpTok  pending;
+
+    while (have_pending || i < n) {
+        PpTok t = have_pending ? pending : in[i++];
+        have_pending = 0;
+
+        PpMacro *m = t.kind == PT_IDENT && !(t.flags & PTF_NOEXPAND) ? pp_macro(pp, t.atom) : NULL;
+        if (!m || m->disabled) {
+            if (m) {
+                t.flags |= PTF_NOEXPAND;
+                pp->painted++;
+            }
+            if (!is_space(&t)) tail = PP_NO_OPEN;
+            if (pp_push(pp, out, t) != 0) return -1;
+            continue;
+        }
+
+        PpSpan args[PP_MAX_PARAMS];
+        size_t n_args = 0;
+        if (m->fn) {
+            size_t j = skip_space(in, i, n);
+            if (j == n || !punct_is(&in[j], '(')) {
+                tail = j == n ? out->n : PP_NO_OPEN;
+                if (pp_push(pp, out, t) != 0) return -1;
+                continue;
+            }
+
+            size_t depth = 0, k = j + 1, start = k;
+            for (;; k++) {
+                if (k == n) {
+                    /* The arguments go on past in: the caller finishes them */
+                    *open = out->n;
+                    if (pp_push(pp, out, t) != 0) return -1;
+                    for (; i < n; i++)
+                        if (pp_push(pp, out, in[i]) != 0) return -1;
+                    return 0;
+                }
+                if (in[k].kind != PT_PUNCT || in[k].len != 1) continue;
+                char c = in[k].p[0];
+                if (c == '(') {
+                    depth++;
+                } else if (c == ')' && depth > 0) {
+                    depth--;
+                } else if (c == ')' || (c == ',' && depth == 0 && !(m->variadic && n_args + 1 == m->n_params))) {
+                    if (n_args == PP_MAX_PARAMS)
+                        return pp_fail(pp, EINVAL, "too many arguments to macro \"%s\"", atom_str(&pp->names, t.atom));
+                    size_t b = skip_space(in, start, k), e = k;
+                    while (e > b && is_space(&in[e - 1])) e--;
+                    args[n_args].v   = in + b;
+                    args[n_args++].n = e - b;
+                    start = k + 1;
+                    if (c == ')') break;
+                }
+            }
+            i = k + 1;
+
+            if (m->n_params == 0 && n_args == 1 && args[0].n == 0) n_args = 0;
+            if (m->variadic && n_args + 1 == m->n_params) {
+                args[n_args].v   = in + k;
+                args[n_args++].n = 0;
+            }
+            if (n_args != m->n_params)
+                return pp_fail(pp, EINVAL, "macro \"%s\" passed %zu arguments, but takes %u",
+                               atom_str(&pp->names, t.atom), n_args, m->n_params);
+        }
+
+        size_t sub, mark = out->n;
+        if (pp_invoke(pp, t.atom, m, args, n_args, out, &sub) != 0) return -1;
+        tail = PP_NO_OPEN;
+        if (out->n == mark) {
+            /* Expanded to nothing: "-EMPTY-" must still not write "--" */
+            PpTok pm = { "", 0, PT_PLACEMARKER, PTF_MACRO, ATOM_NONE };
+            if (pp_push(pp, out, pm) != 0) return -1;
+        }
+        while (sub != PP_NO_OPEN) {
+            if (skip_space(out->v, sub + 1, out->n) == out->n) {
+                /* Its last name may take its '(' from what follows here */
+                pending      = out->v[sub];
+                out->n       = sub;
+                have_pending = 1;
+                break;
+            }
+            /* "#define LP f(" then "LP 1)": the arguments go on here */
+            int rc = pp_resume(pp, out, sub, in, &i, n, &sub);
+            if (rc < 0) return -1;
+            if (rc > 0) {
+                tail = sub;
+                break;
+            }
+        }
+    }
+    *open = tail;
+    return 0;
+}
+
+/* pp_expand() of a list that nothing follows */
+static int pp_expand_all(Pp *pp, const PpTok *in, size_t n, PpToks *out)
+{
+    size_t open;
+    if (pp_expand(pp, in, n, out, &open) != 0) return -1;
+    if (open != PP_NO_OPEN && skip_space(out->v, open + 1, out->n) < out->n)
+        return pp_fail(pp, EINVAL, "unterminated argument list invoking macro \"%s\"",
+                       atom_str(&pp->names, out->v[open].atom));
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Output
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Would prev followed by t read back as different tokens? */
+static int would_merge(int prev_kind, char a, const PpTok *t)
+{
+    char b = t->p[0];
+    if (is_ident_char(a) && (is_ident_char(b) || b == '.')) return 1;
+    if (prev_kind == PT_NUMBER && (b == '+' || b == '-')) return 1;
+    if (a == '.' && b >= '0' && b <= '9') return 1;
+    if (prev_kind == PT_PUNCT && t->kind == PT_PUNCT) return 1;
+    if (prev_kind == PT_IDENT && (t->kind == PT_STRING || t->kind == PT_CHAR)) return 1;
+    return 0;
+}
+
+static int pp_write(Pp *pp, const PpTok *t, size_t n)
+{
+    StrBuf *o = pp->out;
+    int bad = 0;
+    for (size_t i = 0; i < n; i++) {
+        switch (t[i].kind) {
+        case PT_PLACEMARKER:
+            if (t[i].flags & PTF_MACRO) pp->prev_macro = 1;
+            continue;
+        case PT_NEWLINE:
+            bad |= sb_putc(o, '\n');
+            pp->prev_kind = PT_NEWLINE;
+            continue;
+        case PT_SPACE:
+            if (t[i].flags & (PTF_MACRO | PTF_COMMENT)) {
+                bad |= sb_putc(o, ' ');
+                if (!(t[i].flags & PTF_MACRO))      /* keep the lines a comment spans */
+                    for (uint32_t k = 0; k < t[i].len; k++)
+                        if (t[i].p[k] == '\n') bad |= sb_putc(o, '\n');
+            } else {
+                bad |= sb_append(o, t[i].p, t[i].len);
+            }
+            pp->prev_kind = PT_SPACE;
+            continue;
+        default:
+            if (pp->prev_kind != PT_SPACE && pp->prev_kind != PT_NEWLINE &&
+                (pp->prev_macro || (t[i].flags & PTF_MACRO)) &&
+                would_merge(pp->prev_kind, pp->prev_last, &t[i]))
+                bad |= sb_putc(o, ' ');
+            bad |= sb_append(o, t[i].p, t[i].len);
+            pp->prev_kind  = t[i].kind;
+            pp->prev_macro = (t[i].flags & PTF_MACRO) != 0;
+            pp->prev_last  = t[i].p[t[i].len - 1];
+        }
+    }
+    return bad ? pp_oom(pp) : 0;
+}
+
+/* Expand and write the text lines gathered since the last directive */
+static int pp_flush(Pp *pp)
+{
+    if (pp->chunk.n == 0) return 0;
+    pp->cur_line   = pp->chunk_line;
+    pp->expanded.n = 0;
+    if (pp_expand_all(pp, pp->chunk.v, pp->chunk.n, &pp->expanded) != 0) return -1;
+    pp->chunk.n = 0;
+    return pp_write(pp, pp->expanded.v, pp->expanded.n);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  #if expressions
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    Pp          *pp;
+    const PpTok *t;
+    size_t       i, n;
+} PpEval;
+
+static const PpTok *ev_peek(PpEval *e)
+{
+    e->i = skip_space(e->t, e->i, e->n);
+    return e->i < e->n ? &e->t[e->i] : NULL;
+}
+
+static int ev_op(PpEval *e, const char *op)
+{
+    const PpTok *t = ev_peek(e);
+    if (t && t->kind == PT_PUNCT && tok_is(t, op)) {
+        e->i++;
+        return 1;
+    }
+    return 0;
+}
+
+static int ev_char(PpEval *e, const PpTok *t, intmax_t *v)
+{
+    const char *p = t->p + 1, *end = t->p + t->len - 1;
+    if (t->len < 3 || t->p[t->len - 1] != '\'') return pp_fail(e->pp, EINVAL, "invalid character constant in #if");
+    if (*p != '\\') {
+        *v = (unsigned char)*p;
+        return 0;
+    }
+    p++;
+    switch (*p) {
+    case 'n': *v = '\n'; break;
+    case 't': *v = '\t'; break;
+    case 'r': *v = '\r'; break;
+    case 'a': *v = '\a'; break;
+    case 'b': *v = '\b'; break;
+    case 'f': *v = '\f'; break;
+    case 'v': *v = '\v'; break;
+    case 'x': *v = (intmax_t)strtol(p + 1, NULL, 16); break;
+    default:
+        if (*p >= '0' && *p <= '7') {
+            *v = 0;
+            for (; p < end && *p >= '0' && *p <= '7'; p++) *v = *v * 8 + (*p - '0');
+        } else {
+            *v = (unsigned char)*p;
+        }
+    }
+    return 0;
+}
+
+static int ev_cond(PpEval *e, intmax_t *v, int live);
+
+static int ev_unary(PpEval *e, intmax_t *v, int live)
+{
+    const PpTok *t = ev_peek(e);
+    if (!t) return pp_fail(e->pp, EINVAL, "#if expression ends early");
+    e->i++;
+
+    if (t->kind == PT_PUNCT && t->len == 1 && strchr("+-!~", t->p[0])) {
+        if (ev_unary(e, v, live) != 0) return -1;
+        switch (t->p[0]) {
+        case '-': *v = (intmax_t)(0 - (uintmax_t)*v); break;
+        case '!': *v = !*v; break;
+        case '~': *v = ~*v; break;
+        }
+        return 0;
+    }
+    if (punct_is(t, '(')) {
+        if (ev_cond(e, v, live) != 0) return -1;
+        if (!ev_op(e, ")")) return pp_fail(e->pp, EINVAL, "missing ')' in #if expression");
+        return 0;
+    }
+    if (t->kind == PT_NUMBER) {
+        char buf[64];
+        size_t len = t->len;
+        while (len && strchr("uUlL", t->p[len - 1])) len--;
+        if (len == 0 || len >= sizeof buf) return pp_fail(e->pp, EINVAL, "invalid integer constant in #if");
+        memcpy(buf, t->p, len);
+        buf[len] = '\0';
+        char *end;
+        *v = (intmax_t)strtoumax(buf, &end, 0);
+        if (*end) return pp_fail(e->pp, EINVAL, "invalid integer constant \"%s\" in #if", buf);
+        return 0;
+    }
+    if (t->kind == PT_CHAR) return ev_char(e, t, v);
+    if (t->kind == PT_IDENT) {              /* a name no macro replaced */
+        *v = 0;
+        return 0;
+    }
+    return pp_fail(e->pp, EINVAL, "token \"%.*s\" is not valid in #if expressions", (int)t->len, t->p);
+}
+
+static int ev_prec(const PpTok *t)
+{
+    static const struct { const char *op; int prec; } ops[] = {
+        { "*", 10 }, { "/", 10 }, { "%", 10 }, { "+", 9 },  { "-", 9 },
+        { "<<", 8 }, { ">>", 8 }, { "<", 7 },  { ">", 7 },  { "<=", 7 },
+        { ">=", 7 }, { "==", 6 }, { "!=", 6 }, { "&", 5 },  { "^", 4 },
+        { "|", 3 },  { "&&", 2 }, { "||", 1 },
+    };
+    if (!t || t->kind != PT_PUNCT) return 0;
+    for (size_t i = 0; i < sizeof ops / sizeof ops[0]; i++)
+        if (tok_is(t, ops[i].op)) return ops[i].prec;
+    return 0;
+}
+
+/* Precedence climbing; live is 0 in a branch && or || will not take,
+ * where dividing by zero is no error */
+static int ev_binary(PpEval *e, int min, intmax_t *v, int live)
+{
+    if (ev_unary(e, v, live) != 0) return -1;
+    for (;;) {
+        const PpTok *t = ev_peek(e);
+        int prec = ev_prec(t);
+        if (prec == 0 || prec < min) return 0;
+        e->i++;
+
+        int rlive = live && !(prec == 2 && !*v) && !(prec == 1 && *v);
+        intmax_t r;
+        if (ev_binary(e, prec + 1, &r, rlive) != 0) return -1;
+
+        uintmax_t a = (uintmax_t)*v, b = (uintmax_t)r;
+        char op0 = t->p[0], op1 = t->len > 1 ? t->p[1] : '\0';
+        switch (op0) {
+        case '*': *v = (intmax_t)(a * b); break;
+        case '+': *v = (intmax_t)(a + b); break;
+        case '-': *v = (intmax_t)(a - b); break;
+        case '/':
+        case '%':
+            if (r == 0) {
+                if (live) return pp_fail(e->pp, EINVAL, "division by zero in #if");
+                *v = 0;
+            } else if (r == -1) {
+                *v = op0 == '/' ? (intmax_t)(0 - a) : 0;
+            } else {
+                *v = op0 == '/' ? *v / r : *v % r;
+            }
+            break;
+        case '<':
+            if (op1 == '<') *v = r < 0 || r >= 64 ? 0 : (intmax_t)(a << r);
+            else            *v = op1 == '=' ? *v <= r : *v < r;
+            break;
+        case '>':
+            if (op1 == '>') *v = r < 0 || r >= 64 ? (*v < 0 ? -1 : 0) : *v >> r;
+            else            *v = op1 == '=' ? *v >= r : *v > r;
+            break;
+        case '=': *v = *v == r; break;
+        case '!': *v = *v != r; break;
+        case '&': *v = op1 == '&' ? (*v && r) : (intmax_t)(a & b); break;
+        case '|': *v = op1 == '|' ? (*v || r) : (intmax_t)(a | b); break;
+        case '^': *v = (intmax_t)(a ^ b); break;
+        }
+    }
+}
+
+static int ev_cond(PpEval *e, intmax_t *v, int live)
+{
+    if (ev_binary(e, 1, v, live) != 0) return -1;
+    if (!ev_op(e, "?")) return 0;
+    intmax_t a, b;
+    if (ev_cond(e, &a, live && *v) != 0) return -1;
+    if (!ev_op(e, ":")) return pp_fail(e->pp, EINVAL, "'?' without ':' in #if");
+    if (ev_cond(e, &b, live && !*v) != 0) return -1;
+    *v = *v ? a : b;
+    return 0;
+}
+
+/* The value of the #if (or #elif) whose tokens after the name are t */
+static int pp_eval_if(Pp *pp, const PpTok *t, size_t n, int *result)
+{
+    static const PpTok one  = { "1", 1, PT_NUMBER, 0, ATOM_NONE };
+    static const PpTok zero = { "0", 1, PT_NUMBER, 0, ATOM_NONE };
+    PpToks d = { NULL, 0, 0 }, x = { NULL, 0, 0 };
+    int rc = 0;
+
+    /* defined X and defined(X) go before the macros are expanded */
+    for (size_t i = 0; rc == 0 && i < n; i++) {
+        if (t[i].kind != PT_IDENT || !tok_is(&t[i], "defined")) {
+            rc = pp_push(pp, &d, t[i]);
+            continue;
+        }
+        size_t j = skip_space(t, i + 1, n);
+        int paren = j < n && punct_is(&t[j], '(');
+        if (paren) j = skip_space(t, j + 1, n);
+        if (j == n || t[j].kind != PT_IDENT) {
+            rc = pp_fail(pp, EINVAL, "operator \"defined\" requires an identifier");
+            break;
+        }
+        rc = pp_push(pp, &d, pp_macro(pp, t[j].atom) ? one : zero);
+        if (paren) {
+            j = skip_space(t, j + 1, n);
+            if (j == n || !punct_is(&t[j], ')')) rc = pp_fail(pp, EINVAL, "missing ')' after \"defined\"");
+        }
+        i = j;
+    }
+    if (rc == 0) rc = pp_expand_all(pp, d.v, d.n, &x);
+    if (rc == 0) {
+        PpEval   e = { pp, x.v, 0, x.n };
+        intmax_t v = 0;
+        if (!ev_peek(&e))          rc = pp_fail(pp, EINVAL, "#if with no expression");
+        else if ((rc = ev_cond(&e, &v, 1)) == 0 && ev_peek(&e))
+            rc = pp_fail(pp, EINVAL, "missing binary operator before \"%.*s\"",
+                         (int)e.t[e.i].len, e.t[e.i].p);
+        *result = v != 0;
+    }
+    free(d.v);
+    free(x.v);
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Files
+ * ════════════════════════════════════════════════════════════════ */
+
+static int pp_lookup_set(Pp *pp, Atom key, size_t file)
+{
+    if (key >= pp->n_lookup) {
+        size_t n = pp->keys.cap;
+        uint32_t *l = realloc(pp->lookup, n * sizeof *l);
+        if (!l) return pp_oom(pp);
+        memset(l + pp->n_lookup, 0, (n - pp->n_lookup) * sizeof *l);
+        pp->lookup   = l;
+        pp->n_lookup = n;
+    }
+    pp->lookup[key] = (uint32_t)file + 1;
+    return 0;
+}
+
+/* The entry for the file at path, found or made by its inode */
+static int pp_file_for(Pp *pp, const char *path, const struct stat *st, PpFile **out)
+{
+    char key[1 + sizeof st->st_dev + sizeof st->st_ino];
+    key[0] = '\1';
+    memcpy(key + 1, &st->st_dev, sizeof st->st_dev);
+    memcpy(key + 1 + sizeof st->st_dev, &st->st_ino, sizeof st->st_ino);
+    Atom a = intern(&pp->keys, key, sizeof key);
+    if (!a) return pp_oom(pp);
+    if (a < pp->n_lookup && pp->lookup[a]) {
+        *out = pp->files[pp->lookup[a] - 1];
+        return 0;
+    }
+
+    if (pp->n_files == pp->cap_files) {
+        size_t cap = pp->cap_files ? 2 * pp->cap_files : 16;
+        PpFile **f = realloc(pp->files, cap * sizeof *f);
+        if (!f) return pp_oom(pp);
+        pp->files     = f;
+        pp->cap_files = cap;
+    }
+    PpFile *f = calloc(1, sizeof *f);
+    if (!f || !(f->path = strdup(path))) {
+        free(f);
+        return pp_oom(pp);
+    }
+    const char *slash = strrchr(path, '/');
+    f->dir_len = slash ? (size_t)(slash - path) + (slash == path) : 0;
+    f->st.path = f->path;
+    pp->files[pp->n_files] = f;
+    if (pp_lookup_set(pp, a, pp->n_files) != 0) {
+        free(f->path);
+        free(f);
+        return -1;
+    }
+    pp->n_files++;
+    *out = f;
+    return 0;
+}
+
+/* Find the header an #include in from names */
+static int pp_resolve(Pp *pp, const PpFile *from, const char *name, int quoted, PpFile **out)
+{
+    Atom key = ATOM_NONE;
+    if (!(pp->flags & PP_NO_FILE_CACHE)) {
+        StrBuf *k = &pp->scratch;
+        int bad = 0;
+        sb_clear(k);
+        bad |= sb_putc(k, '\2');
+        if (quoted) bad |= sb_append(k, from->path, from->dir_len);
+        bad |= sb_putc(k, '\0');
+        bad |= sb_puts(k, name);
+        if (bad || !(key = intern(&pp->keys, sb_str(k), sb_len(k)))) return pp_oom(pp);
+        if (key < pp->n_lookup && pp->lookup[key]) {
+            *out = pp->files[pp->lookup[key] - 1];
+            return 0;
+        }
+    }
+
+    char   path[PP_PATH_MAX];
+    size_t n_cand = (name[0] == '/' ? 1 : (size_t)quoted + pp->n_dirs);
+    for (size_t c = 0; c < n_cand; c++) {
+        int len;
+        if (name[0] == '/')
+            len = snprintf(path, sizeof path, "%s", name);
+        else if (quoted && c == 0)
+            len = from->dir_len ? snprintf(path, sizeof path, "%.*s/%s", (int)from->dir_len, from->path, name)
+                                : snprintf(path, sizeof path, "%s", name);
+        else
+            len = snprintf(path, sizeof path, "%s/%s", pp->dirs[c - (size_t)quoted], name);
+        if (len < 0 || (size_t)len >= sizeof path) continue;
+
+        struct stat st;
+        pp->totals.stats++;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (pp_file_for(pp, path, &st, out) != 0) return -1;
+        if (key) {
+            size_t idx = 0;
+            while (pp->files[idx] != *out) idx++;
+            return pp_lookup_set(pp, key, idx);
+        }
+        return 0;
+    }
+    return pp_fail(pp, ENOENT, "%s: No such file or directory", name);
+}
+
+static int pp_include_name(const PpTok *t, size_t n, char *name, size_t size, int *quoted)
+{
+    size_t i = skip_space(t, 0, n), len = 0;
+    if (i < n && t[i].kind == PT_STRING && t[i].len >= 2 && t[i].p[0] == '"' && t[i].p[t[i].len - 1] == '"') {
+        len = t[i].len - 2;
+        if (len == 0 || len >= size) return -1;
+        memcpy(name, t[i].p + 1, len);
+        *quoted = 1;
+    } else if (i < n && punct_is(&t[i], '<')) {
+        for (i++; i < n && !punct_is(&t[i], '>'); i++) {
+            if (len + t[i].len >= size) return -1;
+            memcpy(name + len, t[i].p, t[i].len);
+            len += t[i].len;
+        }
+        if (i == n || len == 0) return -1;
+        *quoted = 0;
+    } else {
+        return -1;
+    }
+    name[len] = '\0';
+    return 0;
+}
+
+static int pp_enter(Pp *pp, PpFile *f, int depth);
+
+static int pp_include(Pp *pp, PpFile *from, const PpTok *t, size_t n, int depth)
+{
+    char name[PP_PATH_MAX];
+    int  quoted;
+    if (pp_include_name(t, n, name, sizeof name, &quoted) != 0) {
+        PpToks x = { NULL, 0, 0 };          /* #include MACRO */
+        int rc = pp_expand_all(pp, t, n, &x);
+        if (rc == 0 && pp_include_name(x.v, x.n, name, sizeof name, &quoted) != 0)
+            rc = pp_fail(pp, EINVAL, "#include expects \"FILENAME\" or <FILENAME>");
+        free(x.v);
+        if (rc != 0) return -1;
+    }
+
+    PpFile *f;
+    if (pp_resolve(pp, from, name, quoted, &f) != 0) return -1;
+    f->st.includes++;
+    pp->totals.includes++;
+    if (!(pp->flags & PP_NO_GUARD_SKIP) &&
+        ((f->once && f->unit == pp->unit) || pp_macro(pp, f->guard))) {
+        f->st.skipped++;
+        pp->totals.skipped++;
+        return 0;
+    }
+    return pp_enter(pp, f, depth + 1);
+}
+
+/* Read through f, which again is set for if this unit has read before */
+static int pp_file(Pp *pp, PpFile *f, int again, int depth)
+{
+    static const PpTok newline = { "\n", 1, PT_NEWLINE, 0, ATOM_NONE };
+    Scan   s = { f->map.data, f->map.data + f->map.size, 1 };
+    PpCond conds[PP_IF_DEPTH];
+    int    nc  = 0;
+    int    mio = 0;     /* 0: nothing yet, 1: in #ifndef X, 2: past its #endif, -1: unguarded */
+    Atom   mio_macro = ATOM_NONE;
+    PpTok  t, lead;
+
+    for (;;) {
+        uint32_t line   = s.line;
+        int      active = nc == 0 || conds[nc - 1].active;
+        int      lead_space = 0;
+        if (!pp_scan(pp, &s, &t, 0)) break;
+        if (t.kind == PT_SPACE) {
+            lead       = t;
+            lead_space = 1;
+            if (!pp_scan(pp, &s, &t, 0)) {
+                if (active && pp_push(pp, &pp->chunk, lead) != 0) return -1;
+                break;
+            }
+        }
+
+        if (!punct_is(&t, '#')) {
+            /* A line of text */
+            if (t.kind != PT_NEWLINE && mio != 1) mio = -1;
+            if (pp->chunk.n == 0) pp->chunk_line = line;
+            if (active) {
+                if (lead_space && pp_push(pp, &pp->chunk, lead) != 0) return -1;
+                for (;;) {
+                    if (pp_push(pp, &pp->chunk, t) != 0) return -1;
+                    if (t.kind == PT_NEWLINE || !pp_scan(pp, &s, &t, 0)) break;
+                }
+            } else {
+                while (t.kind != PT_NEWLINE && pp_scan(pp, &s, &t, 0)) {}
+                for (uint32_t l = line; l < s.line; l++)
+                    if (pp_push(pp, &pp->chunk, newline) != 0) return -1;
+            }
+            continue;
+        }
+
+        /* A directive */
+        pp->dir.n = 0;
+        while (pp_scan(pp, &s, &t, 0) && t.kind != PT_NEWLINE)
+            if (pp_push(pp, &pp->dir, t) != 0) return -1;
+        if (pp_flush(pp) != 0) return -1;
+        pp->cur_line = line;
+
+        const PpTok *d    = pp->dir.v;
+        size_t       nd   = pp->dir.n;
+        size_t       i    = skip_space(d, 0, nd);
+        const PpTok *name = i < nd ? &d[i] : NULL;
+        const PpTok *rest = d + (i < nd ? i + 1 : nd);
+        size_t       nr   = i < nd ? nd - i - 1 : 0;
+        int          rc   = 0, stop = 0;
+
+        /* The multiple-include optimization: is the file all one #ifndef? */
+        int is_ifndef = name && tok_is(name, "ifndef"), is_endif = name && tok_is(name, "endif");
+        if (mio == 0 && is_ifndef) {
+            size_t j = skip_space(rest, 0, nr);
+            mio       = j < nr && rest[j].kind == PT_IDENT ? 1 : -1;
+            mio_macro = mio == 1 ? intern(&pp->names, rest[j].p, rest[j].len) : ATOM_NONE;
+        } else if (mio == 1 && nc == 1 && is_endif) {
+            mio = 2;
+        } else if (mio == 0 || mio == 2 ||
+                   (mio == 1 && nc == 1 && name && (tok_is(name, "else") || tok_is(name, "elif")))) {
+            mio = -1;
+        }
+
+        if (!name || name->kind == PT_NUMBER) {
+            /* the null directive, or a line marker */
+        } else if (tok_is(name, "if") || tok_is(name, "ifdef") || tok_is(name, "ifndef")) {
+            if (nc == PP_IF_DEPTH) return pp_fail(pp, EINVAL, "#if nested more than %d deep", PP_IF_DEPTH);
+            int v = 0;
+            if (active) {
+                if (name->len == 2) {
+                    rc = pp_eval_if(pp, rest, nr, &v);
+                } else {
+                    size_t j = skip_space(rest, 0, nr);
+                    if (j == nr || rest[j].kind != PT_IDENT)
+                        return pp_fail(pp, EINVAL, "no macro name given in #%.*s directive", (int)name->len, name->p);
+                    v = (pp_macro(pp, rest[j].atom) != NULL) == (name->len == 5);
+                }
+            }
+            PpCond c = { (uint8_t)(active && v), (uint8_t)(!active || v), (uint8_t)active, 0, line };
+            conds[nc++] = c;
+        } else if (tok_is(name, "elif")) {
+            if (nc == 0 || conds[nc - 1].seen_else) return pp_fail(pp, EINVAL, "#elif without #if");
+            PpCond *c = &conds[nc - 1];
+            int v = 0;
+            if (c->parent && !c->taken) rc = pp_eval_if(pp, rest, nr, &v);
+            c->active = (uint8_t)v;
+            c->taken |= (uint8_t)v;
+        } else if (tok_is(name, "else")) {
+            if (nc == 0 || conds[nc - 1].seen_else) return pp_fail(pp, EINVAL, "#else without #if");
+            PpCond *c = &conds[nc - 1];
+            c->active    = c->parent && !c->taken;
+            c->taken     = 1;
+            c->seen_else = 1;
+        } else if (is_endif) {
+            if (nc == 0) return pp_fail(pp, EINVAL, "#endif without #if");
+            nc--;
+        } else if (!active) {
+            /* anything else is skipped along with the text around it */
+        } else if (tok_is(name, "include")) {
+            rc = pp_include(pp, f, rest, nr, depth);
+        } else if (tok_is(name, "define")) {
+            rc = pp_do_define(pp, rest, nr);
+        } else if (tok_is(name, "undef")) {
+            rc = pp_do_undef(pp, rest, nr);
+        } else if (tok_is(name, "pragma")) {
+            size_t j = skip_space(rest, 0, nr);
+            if (j < nr && tok_is(&rest[j], "once")) {
+                f->once     = 1;
+                f->st.guard = PP_GUARD_ONCE;
+                stop        = again;            /* read up to here for nothing */
+            }
+        } else if (tok_is(name, "error")) {
+            size_t j = skip_space(rest, 0, nr);
+            const char *msg = j < nr ? rest[j].p : "";
+            return pp_fail(pp, EINVAL, "#error %.*s", (int)(j < nr ? rest[nr - 1].p + rest[nr - 1].len - msg : 0), msg);
+        } else if (!tok_is(name, "warning") && !tok_is(name, "line")) {
+            return pp_fail(pp, EINVAL, "invalid preprocessing directive #%.*s", (int)name->len, name->p);
+        }
+        if (rc != 0) return -1;
+        if (stop) break;
+
+        if (pp->chunk.n == 0) pp->chunk_line = s.line;
+        for (uint32_t l = line; l < s.line; l++)
+            if (pp_push(pp, &pp->chunk, newline) != 0) return -1;
+    }
+
+    size_t bytes = (size_t)(s.p - f->map.data);
+    f->st.bytes       += bytes;
+    pp->totals.bytes  += bytes;
+    if (pp_flush(pp) != 0) return -1;
+    if (nc > 0 && s.p == s.end) {
+        pp->cur_line = conds[nc - 1].line;
+        return pp_fail(pp, EINVAL, "unterminated #if");
+    }
+    if (mio == 2 && !f->once) {
+        f->guard          = mio_macro;
+        f->st.guard       = PP_GUARD_IFNDEF;
+        f->st.guard_macro = atom_str(&pp->names, mio_macro);
+    }
+    return 0;
+}
+
+static int pp_enter(Pp *pp, PpFile *f, int depth)
+{
+    if (depth > PP_MAX_DEPTH) return pp_fail(pp, ELOOP, "#include nested more than %d deep", PP_MAX_DEPTH);
+    if (!f->mapped) {
+        if (source_map_open(&f->map, f->path) != 0) return pp_fail(pp, errno, "%s: %s", f->path, strerror(errno));
+        f->mapped = 1;
+        f->st.opens++;
+        pp->totals.opens++;
+    }
+
+    int      again = f->unit == pp->unit;
+    PpFile  *cur   = pp->cur;
+    uint32_t line  = pp->cur_line;
+    uint64_t start = now_ns(), child = pp->child_ns;
+    f->unit      = pp->unit;
+    pp->cur      = f;
+    pp->cur_line = 1;
+    pp->child_ns = 0;
+
+    int rc = pp_file(pp, f, again, depth);
+
+    uint64_t total = now_ns() - start;
+    f->st.ns    += total - pp->child_ns;
+    f->st.scans++;
+    pp->child_ns = child + total;
+    if (rc == 0) {
+        pp->cur      = cur;
+        pp->cur_line = line;
+    }
+    if (pp->flags & PP_NO_FILE_CACHE) {
+        source_map_close(&f->map);
+        f->mapped = 0;
+    }
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  API
+ * ════════════════════════════════════════════════════════════════ */
+
+Pp *pp_new(unsigned flags)
+{
+    Pp *pp = calloc(1, sizeof *pp);
+    if (!pp) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pp->flags = flags;
+    interner_init(&pp->names);
+    interner_init(&pp->keys);
+    interner_init(&pp->memo_keys);
+    arena_init(&pp->tmp, 16 * 1024);
+    sb_init(&pp->scratch);
+    if (!pp->names.atoms || !pp->names.slots || !pp->keys.atoms || !pp->keys.slots ||
+        !pp->memo_keys.atoms || !pp->memo_keys.slots ||
+        !(pp->va_args = intern_cstr(&pp->names, "__VA_ARGS__"))) {
+        pp_free(pp);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return pp;
+}
+
+void pp_free(Pp *pp)
+{
+    if (!pp) return;
+    pp_reset_macros(pp);
+    free(pp->macros);
+    for (size_t i = 0; i < pp->n_files; i++) {
+        if (pp->files[i]->mapped) source_map_close(&pp->files[i]->map);
+        free(pp->files[i]->path);
+        free(pp->files[i]);
+    }
+    free(pp->files);
+    free(pp->lookup);
+    for (size_t i = 0; i < pp->n_dirs; i++) free(pp->dirs[i]);
+    free(pp->dirs);
+    for (size_t i = 0; i < pp->n_defs; i++) free(pp->defs[i]);
+    free(pp->defs);
+    interner_free(&pp->names);
+    interner_free(&pp->keys);
+    interner_free(&pp->memo_keys);
+    arena_free(&pp->tmp);
+    free(pp->chunk.v);
+    free(pp->expanded.v);
+    free(pp->dir.v);
+    sb_free(&pp->scratch);
+    free(pp);
+}
+
+static int add_string(char ***list, size_t *n, const char *s)
+{
+    char **l = realloc(*list, (*n + 1) * sizeof *l);
+    if (!l) return -1;
+    *list = l;
+    if (!(l[*n] = strdup(s))) return -1;
+    (*n)++;
+    return 0;
+}
+
+int pp_add_include_dir(Pp *pp, const char *dir)
+{
+    if (add_string(&pp->dirs, &pp->n_dirs, dir) != 0) return pp_oom(pp);
+    return 0;
+}
+
+int pp_define(Pp *pp, const char *def)
+{
+    if (add_string(&pp->defs, &pp->n_defs, def) != 0) return pp_oom(pp);
+    return 0;
+}
+
+/* A -D string as the line "NAME body" for pp_do_define */
+static int pp_define_cmdline(Pp *pp, const char *def)
+{
+    StrBuf line;
+    const char *eq = strchr(def, '=');
+    int bad = 0;
+    sb_init(&line);
+    if (eq) {
+        bad |= sb_append(&line, def, (size_t)(eq - def));
+        bad |= sb_putc(&line, ' ');
+        bad |= sb_puts(&line, eq + 1);
+    } else {
+        bad |= sb_puts(&line, def);
+        bad |= sb_puts(&line, " 1");
+    }
+
+    int rc = bad ? pp_oom(pp) : 0;
+    Scan  s = { sb_str(&line), sb_str(&line) + sb_len(&line), 1 };
+    PpTok t;
+    pp->dir.n = 0;
+    while (rc == 0 && pp_scan(pp, &s, &t, 0))
+        rc = pp_push(pp, &pp->dir, t);
+    if (rc == 0) rc = pp_do_define(pp, pp->dir.v, pp->dir.n);
+    sb_free(&line);
+    return rc;
+}
+
+int pp_run(Pp *pp, const char *path, StrBuf *out)
+{
+    uint64_t start = now_ns();
+    pp->err[0]     = '\0';
+    pp->unit++;
+    pp->totals.units++;
+    pp_reset_macros(pp);
+    arena_reset(&pp->tmp);
+    pp->out        = out;
+    pp->cur        = NULL;
+    pp->chunk.n    = 0;
+    pp->prev_kind  = PT_NEWLINE;
+    pp->prev_macro = 0;
+
+    int rc = 0;
+    for (size_t i = 0; rc == 0 && i < pp->n_defs; i++) rc = pp_define_cmdline(pp, pp->defs[i]);
+
+    struct stat st;
+    PpFile *f = NULL;
+    if (rc == 0) {
+        pp->totals.stats++;
+        if (stat(path, &st) != 0)
+            rc = pp_fail(pp, errno, "%s: %s", path, strerror(errno));
+        else
+            rc = pp_file_for(pp, path, &st, &f);
+    }
+    if (rc == 0) {
+        f->st.includes++;
+        pp->totals.includes++;
+        rc = pp_enter(pp, f, 0);
+    }
+    pp->totals.ns += now_ns() - start;
+    return rc;
+}
+
+const char *pp_error(const Pp *pp)
+{
+    return pp->err;
+}
+
+size_t pp_file_count(const Pp *pp)
+{
+    return pp->n_files;
+}
+
+const PpFileStats *pp_file_stats(const Pp *pp, size_t i)
+{
+    return i < pp->n_files ? &pp->files[i]->st : NULL;
+}
+
+void pp_totals(const Pp *pp, PpTotals *t)
+{
+    *t = pp->totals;
+}
+
+void pp_reset_stats(Pp *pp)
+{
+    for (size_t i = 0; i < pp->n_files; i++) {
+        PpFileStats *st = &pp->files[i]->st;
+        st->includes = st->skipped = st->opens = st->scans = st->bytes = st->ns = 0;
+    }
+    memset(&pp->totals, 0, sizeof pp->totals);
+}
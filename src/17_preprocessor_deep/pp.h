@@ -0,0 +1,117 @@
+/*
+ * Chapter 17 — A working preprocessor, small enough to read
+ *
+ * pp_run() preprocesses one translation unit into a StrBuf that the
+ * chapter 18 lexer can take as it is.  Supported:
+ *
+ *   #include "x" / <x>   "x" looks beside the including file first, then
+ *                        in the pp_add_include_dir() directories in order
+ *   #define / #undef    object-like and function-like macros, #, ##,
+ *                        __VA_ARGS__ and GNU ", ## __VA_ARGS__"
+ *   #if #ifdef #ifndef #elif #else #endif   with defined(), integer
+ *                        arithmetic in intmax_t, and ?:
+ *   #pragma once, #error; other pragmas and #line are dropped
+ *
+ * Comments become a space and directive lines a blank line; no line
+ * markers are written, as the lexer has no '#' token.
+ *
+ * Header re-parsing is what dominates a build's front end, so:
+ *
+ *   file cache    a header is mapped once per Pp, keyed by (st_dev,
+ *                 st_ino) so two spellings of one file share an entry,
+ *                 and each (including directory, spelled name) is
+ *                 resolved with stat() once
+ *   guard skip    a file that is nothing but #ifndef X ... #endif, with
+ *                 only whitespace and comments outside, is remembered
+ *                 with X — the multiple-include optimization.  While X
+ *                 stays defined, or once a #pragma once file has been
+ *                 read in this unit, re-including the file costs a
+ *                 table lookup: it is neither reopened nor rescanned
+ *   memo          a function-like macro's expansion is cached by its
+ *                 raw argument text and reused until the next #define
+ *                 or #undef, unless the expansion depended on context
+ *                 (a macro it met was disabled, or it ended in an
+ *                 invocation that what follows it could finish)
+ *
+ * Each can be switched off for comparison: PP_NO_FILE_CACHE opens and
+ * maps a file for every #include, PP_NO_GUARD_SKIP reads guarded files
+ * again (a #pragma once file up to its pragma), PP_NO_MEMO expands
+ * every invocation afresh.  The same tokens come out either way; only
+ * the blank lines a re-read file leaves behind can differ.
+ *
+ * Macros are per unit — pp_run() starts from the pp_define() list —
+ * while the file cache, guards and statistics carry over, as in a
+ * compile server.  Functions return 0, or -1 with errno: ENOENT for a
+ * header not found, ELOOP past PP_MAX_DEPTH, EINVAL for a malformed
+ * directive or #error, ENOMEM; pp_error() then says "file:line: why".
+ */
+
+#ifndef PP_H
+#define PP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../07_strings/strbuf.h"
+
+#define PP_NO_FILE_CACHE 0x1u
+#define PP_NO_GUARD_SKIP 0x2u
+#define PP_NO_MEMO       0x4u
+
+#define PP_MAX_DEPTH 200            /* #include nesting */
+#define PP_IF_DEPTH  64             /* #if nesting within one file */
+
+typedef enum {
+    PP_GUARD_NONE,
+    PP_GUARD_IFNDEF,                /* #ifndef X ... #endif around it all */
+    PP_GUARD_ONCE                   /* #pragma once */
+} PpGuard;
+
+typedef struct {
+    const char *path;               /* as first found: dir/name */
+    PpGuard     guard;
+    const char *guard_macro;        /* X for PP_GUARD_IFNDEF, else NULL */
+    uint64_t    includes;           /* times named, the entry file included */
+    uint64_t    skipped;            /* of those, skipped without opening */
+    uint64_t    opens;              /* times opened and mapped */
+    uint64_t    scans;              /* times read through */
+    uint64_t    bytes;              /* bytes read through */
+    uint64_t    ns;                 /* time in the file, nested files excluded */
+} PpFileStats;
+
+typedef struct {
+    uint64_t units;                 /* pp_run() calls */
+    uint64_t includes;
+    uint64_t skipped;
+    uint64_t opens;
+    uint64_t stats;                 /* stat() calls to find headers */
+    uint64_t bytes;
+    uint64_t expansions;            /* macro invocations */
+    uint64_t memo_hits;
+    uint64_t ns;                    /* inside pp_run() */
+} PpTotals;
+
+typedef struct Pp Pp;
+
+/* NULL with errno (ENOMEM) */
+Pp   *pp_new(unsigned flags);
+void  pp_free(Pp *pp);
+
+int   pp_add_include_dir(Pp *pp, const char *dir);
+
+/* As -D: "NAME" defines NAME as 1, "NAME=body" and "F(a,b)=body" as
+ * written.  Takes effect from the next pp_run() */
+int   pp_define(Pp *pp, const char *def);
+
+/* Preprocess the file at path, appending the result to out */
+int   pp_run(Pp *pp, const char *path, StrBuf *out);
+
+const char *pp_error(const Pp *pp);
+
+/* Every file seen so far, in the order first found */
+size_t             pp_file_count(const Pp *pp);
+const PpFileStats *pp_file_stats(const Pp *pp, size_t i);
+void               pp_totals(const Pp *pp, PpTotals *t);
+void               pp_reset_stats(Pp *pp);
+
+#endif /* PP_H */
@@ -10,9 +10,15 @@
  *   6. Predefined macros (__FILE__, __LINE__, __func__, etc.)
  *   7. #pragma and _Pragma
  *   8. Include guards vs #pragma once
+ *   9. Macros that change behaviour with #ifdef
+ *  10. A working preprocessor (pp.h): headers cached by inode, guarded
+ *      and #pragma once files skipped on re-include, macro expansions
+ *      memoized — its output fed to the chapter 18 lexer
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/17_preprocessor_deep \
- *            src/17_preprocessor_deep/preprocessor_deep.c
+ *            src/17_preprocessor_deep/preprocessor_deep.c \
+ *            src/17_preprocessor_deep/pp.c src/07_strings/strbuf.c \
+ *            src/18_lexical_analysis/lexer.c
  * Run:   ./bin/17_preprocessor_deep
  *
  * Try:
@@ -21,9 +27,15 @@
  *   gcc -E -dD src/17_preprocessor_deep/preprocessor_deep.c | head -100
  */
 
+#define _POSIX_C_SOURCE 200809L    /* mkdtemp() for Section 10 */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "pp.h"
+#include "../18_lexical_analysis/lexer.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: #include Resolution
@@ -505,6 +517,172 @@ static void demo_conditional_macro_demo(void)
     printf("       (enables both debug macros)\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 10: A Working Preprocessor
+ * ════════════════════════════════════════════════════════════════ */
+
+/*
+ * pp.h implements #include, #define, #if and #pragma once for real.
+ * What makes it fast is not re-reading headers: a file that is one
+ * #ifndef X ... #endif is remembered with X, and while X is defined an
+ * #include of it is a table lookup — no open(), no scan.  Compilers do
+ * the same ("multiple-include optimization"); gcc -H shows each header
+ * read only once however often it is included.
+ */
+
+static const char *const pp_demo_files[][2] = {
+    { "config.h",
+      "/* build settings */\n"
+      "#ifndef CONFIG_H\n"
+      "#define CONFIG_H\n"
+      "#define SCALE 3\n"
+      "#define SQR(x) ((x) * (x))\n"
+      "#endif /* CONFIG_H */\n" },
+    { "util.h",
+      "#pragma once\n"
+      "#include \"config.h\"\n"
+      "int scale(int v) { return SQR(v) * SCALE; }\n" },
+    { "main.c",
+      "#include \"config.h\"\n"
+      "#include \"util.h\"\n"
+      "#include \"config.h\"   /* CONFIG_H is defined: skipped */\n"
+      "#include \"util.h\"     /* #pragma once: skipped */\n"
+      "#if SCALE > 2\n"
+      "int big(int v) { return SQR(v + 1); }\n"
+      "#else\n"
+      "int small(int v) { return v; }\n"
+      "#endif\n"
+      "int main() { return scale(2) + SQR(SCALE) + SQR(SCALE); }\n" },
+    { "rescan.c",
+      "#define f(x) [x]\n"
+      "#define LP f(\n"
+      "LP 1)\n"
+      "#undef f\n"
+      "/* C11 6.10.3.5 EXAMPLE 3 */\n"
+      "#define x 3\n"
+      "#define f(a) f(x * (a))\n"
+      "#undef x\n"
+      "#define x 2\n"
+      "#define g f\n"
+      "#define h g(~\n"
+      "h 5)\n" },
+};
+
+#define PP_DEMO_FILES (sizeof pp_demo_files / sizeof pp_demo_files[0])
+
+static void pp_demo_print(const StrBuf *out)
+{
+    printf("  Output (blank lines squeezed):\n");
+    const char *p = sb_str(out), *end = p + sb_len(out);
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t n = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        size_t k = 0;
+        while (k < n && p[k] == ' ') k++;
+        if (k < n) printf("    │ %.*s\n", (int)n, p);
+        p += n + 1;
+    }
+    printf("\n");
+}
+
+static void pp_demo_run(const char *dir, unsigned flags, const char *label, int show_output)
+{
+    char   path[256];
+    StrBuf out;
+    Pp    *pp = pp_new(flags);
+    sb_init(&out);
+    snprintf(path, sizeof path, "%s/main.c", dir);
+    if (!pp || pp_run(pp, path, &out) != 0) {
+        printf("  pp_run failed: %s\n\n", pp ? pp_error(pp) : "out of memory");
+        pp_free(pp);
+        sb_free(&out);
+        return;
+    }
+
+    if (show_output) pp_demo_print(&out);
+
+    PpTotals t;
+    pp_totals(pp, &t);
+    printf("  %s:\n", label);
+    printf("    %-10s %-16s %8s %8s %8s %8s\n", "file", "guard", "includes", "skipped", "opens", "scans");
+    for (size_t i = 0; i < pp_file_count(pp); i++) {
+        const PpFileStats *st = pp_file_stats(pp, i);
+        char guard[32];
+        if (st->guard == PP_GUARD_IFNDEF) snprintf(guard, sizeof guard, "#ifndef %s", st->guard_macro);
+        else snprintf(guard, sizeof guard, "%s", st->guard == PP_GUARD_ONCE ? "#pragma once" : "-");
+        printf("    %-10s %-16s %8llu %8llu %8llu %8llu\n", strrchr(st->path, '/') + 1, guard,
+               (unsigned long long)st->includes, (unsigned long long)st->skipped,
+               (unsigned long long)st->opens, (unsigned long long)st->scans);
+    }
+
+    TokenVec v;
+    token_vec_init(&v);
+    size_t errors = 0;
+    if (tokenize_spans(sb_str(&out), sb_len(&out), &v) == 0)
+        for (size_t i = 0; i < v.count; i++) errors += v.data[i].type == TOK_ERROR;
+    printf("    %llu macro expansions (%llu from the memo); the lexer found %zu tokens, %zu errors\n\n",
+           (unsigned long long)t.expansions, (unsigned long long)t.memo_hits, v.count, errors);
+    token_vec_free(&v);
+    pp_free(pp);
+    sb_free(&out);
+}
+
+static void demo_mini_preprocessor(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 10: A Working Preprocessor (pp.h)         ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    char dir[] = "/tmp/pp_demo.XXXXXX";
+    char path[256];
+    if (!mkdtemp(dir)) {
+        perror("  mkdtemp");
+        return;
+    }
+    for (size_t i = 0; i < PP_DEMO_FILES; i++) {
+        snprintf(path, sizeof path, "%s/%s", dir, pp_demo_files[i][0]);
+        FILE *f = fopen(path, "w");
+        if (f) {
+            fputs(pp_demo_files[i][1], f);
+            fclose(f);
+        }
+        printf("  ── %s ──\n", pp_demo_files[i][0]);
+        const char *p = pp_demo_files[i][1];
+        for (const char *nl; (nl = strchr(p, '\n')); p = nl + 1) printf("    %.*s\n", (int)(nl - p), p);
+    }
+    printf("\n");
+
+    pp_demo_run(dir, 0, "With the file cache, guard skip and memo", 1);
+    pp_demo_run(dir, PP_NO_FILE_CACHE | PP_NO_GUARD_SKIP | PP_NO_MEMO,
+                "The naive way: every #include opened and read", 0);
+
+    printf("  Same tokens either way.  The naive run opens config.h for each\n");
+    printf("  of its three #includes, and the last two reads find it all\n");
+    printf("  #ifndef'd away; across a few hundred headers that re-reading\n");
+    printf("  is most of the front end's time.\n");
+    printf("  Try: make bench_pp && ./bin/bench_pp\n\n");
+
+    /* rescan.c: the invocation a macro leaves open at the end of its
+     * expansion takes its arguments from the text after the macro */
+    Pp    *pp = pp_new(0);
+    StrBuf out;
+    sb_init(&out);
+    snprintf(path, sizeof path, "%s/rescan.c", dir);
+    printf("  rescan.c — LP and h end partway through an invocation of f,\n");
+    printf("  which reads on past them for the rest of its arguments:\n");
+    if (pp && pp_run(pp, path, &out) == 0) pp_demo_print(&out);
+    else printf("  pp_run failed: %s\n\n", pp ? pp_error(pp) : "out of memory");
+    printf("  gcc -E gives the same tokens: [1] and f(2 * (~ 5)).\n\n");
+    pp_free(pp);
+    sb_free(&out);
+
+    for (size_t i = 0; i < PP_DEMO_FILES; i++) {
+        snprintf(path, sizeof path, "%s/%s", dir, pp_demo_files[i][0]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main
  * ════════════════════════════════════════════════════════════════ */
@@ -524,6 +702,7 @@ int main(void)
     demo_pragma();
     demo_include_guards();
     demo_conditional_macro_demo();
+    demo_mini_preprocessor();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: The preprocessor is a powerful text-transform\n");
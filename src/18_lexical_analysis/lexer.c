@@ -0,0 +1,699 @@
+/*
+ * Chapter 18 — Mini C-subset lexer (shared module)
+ *
+ * See lexer.h for the API.  The scanner works on a bounded buffer
+ * (src, len) and never writes to it, so the same code lexes string
+ * literals in the demos and multi-megabyte files mapped with mmap.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Human-readable names */
+const char *token_type_name(TokenType t)
+{
+    switch (t) {
+        case TOK_KW_INT:      return "KW_INT";
+        case TOK_KW_RETURN:   return "KW_RETURN";
+        case TOK_IDENTIFIER:  return "IDENTIFIER";
+        case TOK_INT_LITERAL: return "INT_LITERAL";
+        case TOK_PLUS:        return "PLUS";
+        case TOK_MINUS:       return "MINUS";
+        case TOK_STAR:        return "STAR";
+        case TOK_SLASH:       return "SLASH";
+        case TOK_ASSIGN:      return "ASSIGN";
+        case TOK_SEMICOLON:   return "SEMICOLON";
+        case TOK_LPAREN:      return "LPAREN";
+        case TOK_RPAREN:      return "RPAREN";
+        case TOK_LBRACE:      return "LBRACE";
+        case TOK_RBRACE:      return "RBRACE";
+        case TOK_EOF:         return "EOF";
+        case TOK_ERROR:       return "ERROR";
+    }
+    return "UNKNOWN";
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Character-level helpers (bounds-checked — no NUL needed)
+ * ════════════════════════════════════════════════════════════════ */
+
+void lexer_init_buffer(Lexer *lex, const char *src, size_t len)
+{
+    lex->src        = src;
+    lex->len        = len;
+    lex->pos        = 0;
+    lex->line       = 1;
+    lex->col        = 1;
+    lex->line_start = 0;
+    lex->atoms      = NULL;
+}
+
+void lexer_set_interner(Lexer *lex, Interner *atoms)
+{
+    lex->atoms = atoms;
+}
+
+static int lexer_at_end(const Lexer *lex)
+{
+    return lex->pos >= lex->len;
+}
+
+/* Character at pos + ahead, or '\0' past the end of the buffer */
+static char lexer_peek_at(const Lexer *lex, size_t ahead)
+{
+    return (lex->pos + ahead < lex->len) ? lex->src[lex->pos + ahead] : '\0';
+}
+
+static char lexer_peek(const Lexer *lex)
+{
+    return lexer_peek_at(lex, 0);
+}
+
+static char lexer_advance(Lexer *lex)
+{
+    char c = lex->src[lex->pos++];
+    if (c == '\n') {
+        lex->line++;
+        lex->col = 1;
+        lex->line_start = lex->pos;
+    } else {
+        lex->col++;
+    }
+    return c;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scalar reference lexer (one byte at a time)
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Skip whitespace and comments */
+static void lexer_skip_whitespace_comments(Lexer *lex)
+{
+    while (!lexer_at_end(lex)) {
+        char c = lexer_peek(lex);
+
+        /* Whitespace */
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            lexer_advance(lex);
+            continue;
+        }
+
+        /* Line comment: // ... */
+        if (c == '/' && lexer_peek_at(lex, 1) == '/') {
+            lexer_advance(lex); /* skip / */
+            lexer_advance(lex); /* skip / */
+            while (!lexer_at_end(lex) && lexer_peek(lex) != '\n') {
+                lexer_advance(lex);
+            }
+            continue;
+        }
+
+        /* Block comment: slash-star ... star-slash */
+        if (c == '/' && lexer_peek_at(lex, 1) == '*') {
+            lexer_advance(lex); /* skip / */
+            lexer_advance(lex); /* skip * */
+            while (!lexer_at_end(lex)) {
+                if (lexer_peek(lex) == '*' && lexer_peek_at(lex, 1) == '/') {
+                    lexer_advance(lex); /* skip * */
+                    lexer_advance(lex); /* skip / */
+                    break;
+                }
+                lexer_advance(lex);
+            }
+            continue;
+        }
+
+        break; /* Not whitespace or comment */
+    }
+}
+
+static TokenType classify_word_scalar(const char *s, size_t n)
+{
+    if (n == 3 && memcmp(s, "int", 3) == 0)    return TOK_KW_INT;
+    if (n == 6 && memcmp(s, "return", 6) == 0) return TOK_KW_RETURN;
+    return TOK_IDENTIFIER;
+}
+
+static TokenType single_char_token(char c)
+{
+    switch (c) {
+        case '+': return TOK_PLUS;
+        case '-': return TOK_MINUS;
+        case '*': return TOK_STAR;
+        case '/': return TOK_SLASH;
+        case '=': return TOK_ASSIGN;
+        case ';': return TOK_SEMICOLON;
+        case '(': return TOK_LPAREN;
+        case ')': return TOK_RPAREN;
+        case '{': return TOK_LBRACE;
+        case '}': return TOK_RBRACE;
+        default:  return TOK_ERROR;
+    }
+}
+
+TokenSpan lexer_next_span_scalar(Lexer *lex)
+{
+    TokenSpan span;
+
+    lexer_skip_whitespace_comments(lex);
+
+    span.offset = lex->pos;
+    span.length = 0;
+    span.line   = lex->line;
+    span.col    = lex->col;
+    span.atom   = ATOM_NONE;
+
+    if (lexer_at_end(lex)) {
+        span.type = TOK_EOF;
+        return span;
+    }
+
+    char c = lexer_peek(lex);
+
+    /* Single-character tokens */
+    span.type = single_char_token(c);
+    if (span.type != TOK_ERROR) {
+        lexer_advance(lex);
+        span.length = 1;
+        return span;
+    }
+
+    /* Integer literal: [0-9]+ */
+    if (isdigit((unsigned char)c)) {
+        while (!lexer_at_end(lex) && isdigit((unsigned char)lexer_peek(lex)))
+            lexer_advance(lex);
+        span.type   = TOK_INT_LITERAL;
+        span.length = (uint32_t)(lex->pos - span.offset);
+        return span;
+    }
+
+    /* Identifier or keyword: [a-zA-Z_][a-zA-Z0-9_]* */
+    if (isalpha((unsigned char)c) || c == '_') {
+        while (!lexer_at_end(lex) &&
+               (isalnum((unsigned char)lexer_peek(lex)) || lexer_peek(lex) == '_'))
+            lexer_advance(lex);
+        span.length = (uint32_t)(lex->pos - span.offset);
+        span.type   = classify_word_scalar(lex->src + span.offset, span.length);
+        if (span.type == TOK_IDENTIFIER && lex->atoms)
+            span.atom = intern(lex->atoms, lex->src + span.offset, span.length);
+        return span;
+    }
+
+    /* Unrecognised character */
+    lexer_advance(lex);
+    span.type   = TOK_ERROR;
+    span.length = 1;
+    return span;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Perfect-hash keyword table
+ *
+ *  slot = (3·len + first char) mod 8 is collision-free for our
+ *  keywords, so classification is one hash, one length check and one
+ *  memcmp.  The table is built with designated initialisers on the
+ *  same KW_HASH() macro, so adding a keyword that collides makes GCC
+ *  warn (-Woverride-init, part of -Wextra) at compile time.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define KW_TABLE_SIZE 8
+#define KW_HASH(len, c0) \
+    ((((unsigned)(len) * 3u) + (unsigned char)(c0)) & (KW_TABLE_SIZE - 1))
+
+typedef struct {
+    const char *word;
+    uint8_t     len;
+    TokenType   type;
+} Keyword;
+
+static const Keyword kw_table[KW_TABLE_SIZE] = {
+    [KW_HASH(3, 'i')] = { "int",    3, TOK_KW_INT    },
+    [KW_HASH(6, 'r')] = { "return", 6, TOK_KW_RETURN },
+};
+
+static TokenType classify_word(const char *s, size_t n)
+{
+    const Keyword *kw = &kw_table[KW_HASH(n, s[0])];
+    if (kw->len == n && memcmp(s, kw->word, n) == 0)
+        return kw->type;
+    return TOK_IDENTIFIER;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  SIMD block primitives
+ *
+ *  Each lexv_* op works on LEX_W bytes; lexv_mask() turns a byte-wise
+ *  compare result into one bit per byte so the scanners below can use
+ *  ctz / popcount / clz on it, whatever the instruction set.
+ * ════════════════════════════════════════════════════════════════ */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LEX_SIMD_NAME "AVX2"
+#define LEX_W 32
+typedef __m256i lex_vec;
+#define lexv_load(p)    _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define lexv_splat(c)   _mm256_set1_epi8((char)(c))
+#define lexv_eq(a, b)   _mm256_cmpeq_epi8((a), (b))
+#define lexv_or(a, b)   _mm256_or_si256((a), (b))
+#define lexv_sub(a, b)  _mm256_sub_epi8((a), (b))
+#define lexv_le(a, b)   _mm256_cmpeq_epi8(_mm256_min_epu8((a), (b)), (a))
+#define lexv_mask(v)    ((uint32_t)_mm256_movemask_epi8(v))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LEX_SIMD_NAME "SSE2"
+#define LEX_W 16
+typedef __m128i lex_vec;
+#define lexv_load(p)    _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define lexv_splat(c)   _mm_set1_epi8((char)(c))
+#define lexv_eq(a, b)   _mm_cmpeq_epi8((a), (b))
+#define lexv_or(a, b)   _mm_or_si128((a), (b))
+#define lexv_sub(a, b)  _mm_sub_epi8((a), (b))
+#define lexv_le(a, b)   _mm_cmpeq_epi8(_mm_min_epu8((a), (b)), (a))
+#define lexv_mask(v)    ((uint32_t)_mm_movemask_epi8(v))
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LEX_SIMD_NAME "NEON"
+#define LEX_W 16
+typedef uint8x16_t lex_vec;
+#define lexv_load(p)    vld1q_u8((const uint8_t *)(const void *)(p))
+#define lexv_splat(c)   vdupq_n_u8((uint8_t)(c))
+#define lexv_eq(a, b)   vceqq_u8((a), (b))
+#define lexv_or(a, b)   vorrq_u8((a), (b))
+#define lexv_sub(a, b)  vsubq_u8((a), (b))
+#define lexv_le(a, b)   vcleq_u8((a), (b))
+/* NEON has no movemask: weight each lane by its bit, then add across */
+static inline uint32_t lexv_mask(uint8x16_t v)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t m = vandq_u8(v, vld1q_u8(weights));
+    return (uint32_t)vaddv_u8(vget_low_u8(m)) |
+           ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+}
+#else
+#define LEX_SIMD_NAME "scalar"
+#endif
+
+const char *lexer_simd_backend(void)
+{
+    return LEX_SIMD_NAME;
+}
+
+static inline int is_ident_char(unsigned char c)
+{
+    return (unsigned)((c | 0x20) - 'a') < 26u ||
+           (unsigned)(c - '0') < 10u || c == '_';
+}
+
+static inline int is_digit_char(unsigned char c)
+{
+    return (unsigned)(c - '0') < 10u;
+}
+
+#ifdef LEX_W
+#define LEX_FULL ((uint32_t)((1ull << LEX_W) - 1))
+
+/* lo <= v <= hi, unsigned, per byte */
+#define lexv_in_range(v, lo, hi) \
+    lexv_le(lexv_sub((v), lexv_splat(lo)), lexv_splat((hi) - (lo)))
+
+static inline uint32_t block_ident_mask(const char *p)
+{
+    lex_vec v      = lexv_load(p);
+    lex_vec alpha  = lexv_in_range(lexv_or(v, lexv_splat(0x20)), 'a', 'z');
+    lex_vec digit  = lexv_in_range(v, '0', '9');
+    lex_vec under  = lexv_eq(v, lexv_splat('_'));
+    return lexv_mask(lexv_or(lexv_or(alpha, digit), under));
+}
+
+static inline uint32_t block_digit_mask(const char *p)
+{
+    return lexv_mask(lexv_in_range(lexv_load(p), '0', '9'));
+}
+
+/* Whitespace mask, with the newline mask as a by-product of one load */
+static inline uint32_t block_ws_mask(const char *p, uint32_t *nl)
+{
+    lex_vec v  = lexv_load(p);
+    lex_vec lf = lexv_eq(v, lexv_splat('\n'));
+    lex_vec sp = lexv_or(lexv_eq(v, lexv_splat(' ')), lexv_eq(v, lexv_splat('\t')));
+    *nl = lexv_mask(lf);
+    return lexv_mask(lexv_or(lexv_or(sp, lf), lexv_eq(v, lexv_splat('\r'))));
+}
+#endif /* LEX_W */
+
+/* Account for the newlines in `nl` (bit i = byte base+i) in one step */
+static inline void note_newlines(Lexer *lex, size_t base, uint32_t nl)
+{
+    if (nl) {
+        lex->line      += (uint32_t)__builtin_popcount(nl);
+        lex->line_start = base + (size_t)(31 - __builtin_clz(nl)) + 1;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Fast scanners — whole blocks while they fit, scalar for the tail
+ * ════════════════════════════════════════════════════════════════ */
+
+static size_t scan_ident(const char *s, size_t pos, size_t len)
+{
+#ifdef LEX_W
+    while (pos + LEX_W <= len) {
+        uint32_t miss = ~block_ident_mask(s + pos) & LEX_FULL;
+        if (miss) return pos + (size_t)__builtin_ctz(miss);
+        pos += LEX_W;
+    }
+#endif
+    while (pos < len && is_ident_char((unsigned char)s[pos])) pos++;
+    return pos;
+}
+
+static size_t scan_digits(const char *s, size_t pos, size_t len)
+{
+#ifdef LEX_W
+    while (pos + LEX_W <= len) {
+        uint32_t miss = ~block_digit_mask(s + pos) & LEX_FULL;
+        if (miss) return pos + (size_t)__builtin_ctz(miss);
+        pos += LEX_W;
+    }
+#endif
+    while (pos < len && is_digit_char((unsigned char)s[pos])) pos++;
+    return pos;
+}
+
+/* Skip a whitespace run starting at pos, counting newlines in bulk */
+static size_t scan_whitespace(Lexer *lex, size_t pos)
+{
+    const char *s = lex->src;
+    size_t len = lex->len;
+#ifdef LEX_W
+    while (pos + LEX_W <= len) {
+        uint32_t nl;
+        uint32_t stop = ~block_ws_mask(s + pos, &nl) & LEX_FULL;
+        if (stop) {
+            /* only newlines before the first non-blank byte count */
+            note_newlines(lex, pos, nl & ((stop & (0u - stop)) - 1));
+            return pos + (size_t)__builtin_ctz(stop);
+        }
+        note_newlines(lex, pos, nl);
+        pos += LEX_W;
+    }
+#endif
+    for (; pos < len; pos++) {
+        char c = s[pos];
+        if (c == '\n') {
+            lex->line++;
+            lex->line_start = pos + 1;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            break;
+        }
+    }
+    return pos;
+}
+
+/* Position of the next '\n' at or after pos (len if none) */
+static size_t scan_line_end(const char *s, size_t pos, size_t len)
+{
+#ifdef LEX_W
+    const lex_vec lf = lexv_splat('\n');
+    while (pos + LEX_W <= len) {
+        uint32_t hit = lexv_mask(lexv_eq(lexv_load(s + pos), lf));
+        if (hit) return pos + (size_t)__builtin_ctz(hit);
+        pos += LEX_W;
+    }
+#endif
+    while (pos < len && s[pos] != '\n') pos++;
+    return pos;
+}
+
+/* pos is just past the opening slash-star; return the position just past
+ * the closing star-slash (or len if unterminated), counting newlines. */
+static size_t scan_block_comment(Lexer *lex, size_t pos)
+{
+    const char *s = lex->src;
+    size_t len = lex->len;
+#ifdef LEX_W
+    const lex_vec star = lexv_splat('*'), slash = lexv_splat('/');
+    const lex_vec lf   = lexv_splat('\n');
+    while (pos + LEX_W + 1 <= len) {
+        lex_vec  v   = lexv_load(s + pos);
+        uint32_t hit = lexv_mask(lexv_eq(v, star)) &
+                       lexv_mask(lexv_eq(lexv_load(s + pos + 1), slash));
+        uint32_t nl  = lexv_mask(lexv_eq(v, lf));
+        if (hit) {
+            unsigned bit = (unsigned)__builtin_ctz(hit);
+            note_newlines(lex, pos, nl & ((1u << bit) - 1));
+            return pos + bit + 2;
+        }
+        note_newlines(lex, pos, nl);
+        pos += LEX_W;
+    }
+#endif
+    for (; pos < len; pos++) {
+        if (s[pos] == '*' && pos + 1 < len && s[pos + 1] == '/')
+            return pos + 2;
+        if (s[pos] == '\n') {
+            lex->line++;
+            lex->line_start = pos + 1;
+        }
+    }
+    return len;
+}
+
+static size_t skip_whitespace_comments_fast(Lexer *lex, size_t pos)
+{
+    const char *s = lex->src;
+    size_t len = lex->len;
+
+    for (;;) {
+        pos = scan_whitespace(lex, pos);
+        if (pos + 1 >= len || s[pos] != '/') return pos;
+        if (s[pos + 1] == '/')
+            pos = scan_line_end(s, pos + 2, len);
+        else if (s[pos + 1] == '*')
+            pos = scan_block_comment(lex, pos + 2);
+        else
+            return pos;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Span lexer — the fast path
+ * ════════════════════════════════════════════════════════════════ */
+
+TokenSpan lexer_next_span(Lexer *lex)
+{
+    TokenSpan   span;
+    const char *s   = lex->src;
+    size_t      len = lex->len;
+    size_t      pos = skip_whitespace_comments_fast(lex, lex->pos);
+
+    span.offset = pos;
+    span.length = 0;
+    span.line   = lex->line;
+    span.col    = (uint32_t)(pos - lex->line_start + 1);
+    span.atom   = ATOM_NONE;
+
+    if (pos >= len) {
+        span.type = TOK_EOF;
+    } else {
+        unsigned char c = (unsigned char)s[pos];
+
+        span.type = single_char_token((char)c);
+        if (span.type != TOK_ERROR) {
+            pos++;
+        } else if (is_digit_char(c)) {
+            pos = scan_digits(s, pos + 1, len);
+            span.type = TOK_INT_LITERAL;
+        } else if (is_ident_char(c)) {          /* not a digit → [a-zA-Z_] */
+            pos = scan_ident(s, pos + 1, len);
+            span.type = classify_word(s + span.offset, pos - span.offset);
+            if (span.type == TOK_IDENTIFIER && lex->atoms)
+                span.atom = intern(lex->atoms, s + span.offset, pos - span.offset);
+        } else {
+            pos++;                              /* unrecognised character */
+        }
+    }
+
+    /* Tokens never span lines, so col follows from line_start */
+    span.length = (uint32_t)(pos - span.offset);
+    lex->pos    = pos;
+    lex->col    = (uint32_t)(pos - lex->line_start + 1);
+    return span;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Growable token vector
+ * ════════════════════════════════════════════════════════════════ */
+
+void token_vec_init(TokenVec *vec)
+{
+    vec->data  = NULL;
+    vec->count = 0;
+    vec->cap   = 0;
+}
+
+int token_vec_push(TokenVec *vec, TokenSpan span)
+{
+    if (vec->count == vec->cap) {
+        size_t new_cap = vec->cap ? vec->cap * 2 : 1024;
+        TokenSpan *p = realloc(vec->data, new_cap * sizeof(*p));
+        if (!p) return -1;
+        vec->data = p;
+        vec->cap  = new_cap;
+    }
+    vec->data[vec->count++] = span;
+    return 0;
+}
+
+void token_vec_free(TokenVec *vec)
+{
+    free(vec->data);
+    token_vec_init(vec);
+}
+
+int tokenize_spans(const char *src, size_t len, TokenVec *vec)
+{
+    return tokenize_spans_atoms(src, len, vec, NULL);
+}
+
+int tokenize_spans_atoms(const char *src, size_t len, TokenVec *vec, Interner *atoms)
+{
+    Lexer lex;
+    lexer_init_buffer(&lex, src, len);
+    lexer_set_interner(&lex, atoms);
+
+    /* Rough guess: one token per ~4 bytes of source saves most regrowths */
+    if (vec->cap < len / 4 + 1) {
+        TokenSpan *p = realloc(vec->data, (len / 4 + 1) * sizeof(*p));
+        if (p) {
+            vec->data = p;
+            vec->cap  = len / 4 + 1;
+        }
+    }
+
+    for (;;) {
+        TokenSpan span = lexer_next_span(&lex);
+        if (token_vec_push(vec, span) != 0) return -1;
+        if (span.type == TOK_EOF) return 0;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  mmap-backed source files
+ * ════════════════════════════════════════════════════════════════ */
+
+int source_map_open(SourceMap *map, const char *path)
+{
+    map->data = NULL;
+    map->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    if (st.st_size == 0) {          /* mmap rejects length 0 */
+        close(fd);
+        map->data = "";
+        return 0;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd);                      /* the mapping keeps the file alive */
+    if (p == MAP_FAILED) {
+        errno = saved;
+        return -1;
+    }
+
+    /* The lexer reads front to back — let the kernel read ahead */
+    posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    map->data = (const char *)p;
+    map->size = (size_t)st.st_size;
+    return 0;
+}
+
+void source_map_close(SourceMap *map)
+{
+    if (map->size > 0)
+        munmap((void *)map->data, map->size);
+    map->data = NULL;
+    map->size = 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Classic Token API
+ * ════════════════════════════════════════════════════════════════ */
+
+void lexer_init(Lexer *lex, const char *source)
+{
+    lexer_init_buffer(lex, source, strlen(source));
+}
+
+/* Copy a span's lexeme out into a Token (truncated to fit text[]) */
+Token token_from_span(const char *src, TokenSpan span)
+{
+    Token tok;
+    memset(&tok, 0, sizeof(tok));
+
+    tok.type = span.type;
+    tok.line = (int)span.line;
+    tok.col  = (int)span.col;
+    tok.atom = span.atom;
+
+    if (span.type == TOK_EOF) {
+        strcpy(tok.text, "<EOF>");
+        return tok;
+    }
+
+    size_t n = span.length;
+    if (n > TOKEN_TEXT_MAX - 2) n = TOKEN_TEXT_MAX - 2;
+    memcpy(tok.text, src + span.offset, n);
+    tok.text[n] = '\0';
+    return tok;
+}
+
+/* Read the next token */
+Token lexer_next_token(Lexer *lex)
+{
+    TokenSpan span = lexer_next_span(lex);
+    return token_from_span(lex->src, span);
+}
+
+/* Tokenize an entire source string and return count */
+int tokenize_all(const char *source, Token *tokens, int max_tokens)
+{
+    Lexer lex;
+    lexer_init(&lex, source);
+
+    int count = 0;
+    while (count < max_tokens) {
+        tokens[count] = lexer_next_token(&lex);
+        if (tokens[count].type == TOK_EOF) {
+            count++;
+            break;
+        }
+        count++;
+    }
+    return count;
+}
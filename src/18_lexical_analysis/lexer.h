@@ -0,0 +1,141 @@
+/*
+ * Chapter 18 — Mini C-subset lexer (shared module)
+ *
+ * The core of the lexer is span-based and zero-copy: a token is a
+ * (offset, length, line, col) view into the source buffer, which may be
+ * an ordinary string or a read-only mmap of a file.  Tokens come out one
+ * at a time through lexer_next_span() (pull iterator) or all at once into
+ * a growable TokenVec — there is no per-token copy and no token limit.
+ *
+ * The classic Token API (lexeme copied into text[64]) is a thin wrapper
+ * over the span lexer and is what the printing demos use.
+ *
+ * With an Interner attached (lexer_set_interner), identifier tokens also
+ * carry an atom: each distinct name is stored once and later phases
+ * compare names as integers (see include/intern.h).
+ *
+ *   Source buffer:  i n t   x   =   4 2 ;
+ *                   ^─────^ ^─^ ^─^ ^───^ ^
+ *   TokenSpan:      {0,3}  {4,1}{6,1}{8,2}{10,1}   (offset, length)
+ */
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../include/intern.h"
+
+/* Token types for our mini C-subset lexer */
+typedef enum {
+    TOK_KW_INT,         /* keyword: int     */
+    TOK_KW_RETURN,      /* keyword: return  */
+    TOK_IDENTIFIER,     /* [a-zA-Z_][a-zA-Z0-9_]* */
+    TOK_INT_LITERAL,    /* [0-9]+           */
+    TOK_PLUS,           /* +                */
+    TOK_MINUS,          /* -                */
+    TOK_STAR,           /* *                */
+    TOK_SLASH,          /* /                */
+    TOK_ASSIGN,         /* =                */
+    TOK_SEMICOLON,      /* ;                */
+    TOK_LPAREN,         /* (                */
+    TOK_RPAREN,         /* )                */
+    TOK_LBRACE,         /* {                */
+    TOK_RBRACE,         /* }                */
+    TOK_EOF,            /* end of input     */
+    TOK_ERROR           /* unrecognised     */
+} TokenType;
+
+/* A token as a view into the source — nothing is copied */
+typedef struct {
+    size_t    offset;       /* byte offset of the lexeme in the source */
+    uint32_t  length;       /* lexeme length in bytes                  */
+    uint32_t  line;         /* source line number (1-based)            */
+    uint32_t  col;          /* source column number (1-based)          */
+    TokenType type;
+    Atom      atom;         /* identifiers, when interning; else 0     */
+} TokenSpan;
+
+/* A self-contained token with its lexeme copied out (demo API) */
+#define TOKEN_TEXT_MAX 64
+
+typedef struct {
+    TokenType type;
+    char      text[TOKEN_TEXT_MAX]; /* the lexeme (actual text) */
+    int       line;                 /* source line number        */
+    int       col;                  /* source column number      */
+    Atom      atom;                 /* as in TokenSpan           */
+} Token;
+
+/* Lexer state: a bounded buffer, so no NUL terminator is required */
+typedef struct {
+    const char *src;        /* source bytes */
+    size_t      len;        /* number of bytes in src */
+    size_t      pos;        /* current position */
+    uint32_t    line;       /* current line */
+    uint32_t    col;        /* current column */
+    size_t      line_start; /* offset of the first byte of the current line */
+    Interner   *atoms;      /* identifier interner, or NULL */
+} Lexer;
+
+/* Growable array of spans — grows geometrically, no fixed cap */
+typedef struct {
+    TokenSpan *data;
+    size_t     count;
+    size_t     cap;
+} TokenVec;
+
+/* A source file mapped read-only into memory */
+typedef struct {
+    const char *data;
+    size_t      size;
+} SourceMap;
+
+const char *token_type_name(TokenType t);
+
+/* ── Core span lexer ─────────────────────────────────────────── */
+void      lexer_init_buffer(Lexer *lex, const char *src, size_t len);
+void      lexer_set_interner(Lexer *lex, Interner *atoms);
+
+/*
+ * lexer_next_span() is the fast path: whitespace runs, comments,
+ * identifiers and digit runs are scanned 16/32 bytes at a time with
+ * SSE2/AVX2/NEON (chosen at compile time), newlines are counted in bulk
+ * with popcount, and keywords are classified by a perfect hash.
+ *
+ * lexer_next_span_scalar() is the byte-at-a-time reference.  Both must
+ * produce identical spans for any input — see the differential check
+ * in the chapter demo, which make test_avx2 runs on an -mavx2 build.
+ */
+TokenSpan   lexer_next_span(Lexer *lex);
+TokenSpan   lexer_next_span_scalar(Lexer *lex);
+const char *lexer_simd_backend(void);   /* "AVX2", "SSE2", "NEON" or "scalar" */
+
+static inline const char *token_span_text(const Lexer *lex, TokenSpan span)
+{
+    return lex->src + span.offset;
+}
+
+/* ── Growable token vector ───────────────────────────────────── */
+void token_vec_init(TokenVec *vec);
+int  token_vec_push(TokenVec *vec, TokenSpan span);
+void token_vec_free(TokenVec *vec);
+
+/* Lex src[0..len) into vec (EOF span included).  Returns 0, or -1 on OOM. */
+int tokenize_spans(const char *src, size_t len, TokenVec *vec);
+/* Same, interning identifiers into atoms (which may be shared) */
+int tokenize_spans_atoms(const char *src, size_t len, TokenVec *vec, Interner *atoms);
+
+/* ── mmap-backed source ──────────────────────────────────────── */
+/* Returns 0 on success, -1 with errno set on failure. */
+int  source_map_open(SourceMap *map, const char *path);
+void source_map_close(SourceMap *map);
+
+/* ── Classic Token API (thin wrapper over the span lexer) ────── */
+void  lexer_init(Lexer *lex, const char *source);
+Token token_from_span(const char *src, TokenSpan span);
+Token lexer_next_token(Lexer *lex);
+int   tokenize_all(const char *source, Token *tokens, int max_tokens);
+
+#endif /* LEXER_H */
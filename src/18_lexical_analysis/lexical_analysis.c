@@ -16,19 +16,31 @@
  *   Whitespace:  (skipped)
  *   Comments:    // line comments and block comments
  *
+ * The lexer itself is in lexer.c: a zero-copy span lexer that can run
+ * over a file mapped with mmap (Section 7), wrapped by the classic
+ * Token API for the printing demos.  Section 9 attaches an Interner
+ * (include/intern.h) so identifiers come out as 32-bit atoms.
+ *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/18_lexical_analysis \
- *            src/18_lexical_analysis/lexical_analysis.c
+ *            src/18_lexical_analysis/lexical_analysis.c \
+ *            src/18_lexical_analysis/lexer.c
  * Run:   ./bin/18_lexical_analysis
+ *        ./bin/18_lexical_analysis FILE     (stream FILE through mmap)
  *
  * Try:
  *   gcc -E -dD src/18_lexical_analysis/lexical_analysis.c | head -50
  *   gcc -fsyntax-only src/18_lexical_analysis/lexical_analysis.c
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lexer.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: What Are Tokens?
@@ -70,239 +82,18 @@ static void demo_token_concepts(void)
 }
 
 /* ════════════════════════════════════════════════════════════════
- *  Section 2: Mini Tokenizer — Data Structures
+ *  Section 2-3: Mini Tokenizer — Data Structures & Implementation
+ *
+ *  The tokenizer lives in lexer.h / lexer.c so other tools (the
+ *  front-end benchmark, later chapters) can reuse it.  Its core is a
+ *  zero-copy span lexer: each token is an (offset, length, line, col)
+ *  view into the source.  Token / tokenize_all() below are the thin
+ *  copying wrapper used for printing.
  * ════════════════════════════════════════════════════════════════ */
 
-/* Token types for our mini C-subset lexer */
-typedef enum {
-    TOK_KW_INT,         /* keyword: int     */
-    TOK_KW_RETURN,      /* keyword: return  */
-    TOK_IDENTIFIER,     /* [a-zA-Z_][a-zA-Z0-9_]* */
-    TOK_INT_LITERAL,    /* [0-9]+           */
-    TOK_PLUS,           /* +                */
-    TOK_MINUS,          /* -                */
-    TOK_STAR,           /* *                */
-    TOK_SLASH,          /* /                */
-    TOK_ASSIGN,         /* =                */
-    TOK_SEMICOLON,      /* ;                */
-    TOK_LPAREN,         /* (                */
-    TOK_RPAREN,         /* )                */
-    TOK_LBRACE,         /* {                */
-    TOK_RBRACE,         /* }                */
-    TOK_EOF,            /* end of input     */
-    TOK_ERROR           /* unrecognised     */
-} TokenType;
-
-/* Human-readable names */
-static const char *token_type_name(TokenType t)
-{
-    switch (t) {
-        case TOK_KW_INT:      return "KW_INT";
-        case TOK_KW_RETURN:   return "KW_RETURN";
-        case TOK_IDENTIFIER:  return "IDENTIFIER";
-        case TOK_INT_LITERAL: return "INT_LITERAL";
-        case TOK_PLUS:        return "PLUS";
-        case TOK_MINUS:       return "MINUS";
-        case TOK_STAR:        return "STAR";
-        case TOK_SLASH:       return "SLASH";
-        case TOK_ASSIGN:      return "ASSIGN";
-        case TOK_SEMICOLON:   return "SEMICOLON";
-        case TOK_LPAREN:      return "LPAREN";
-        case TOK_RPAREN:      return "RPAREN";
-        case TOK_LBRACE:      return "LBRACE";
-        case TOK_RBRACE:      return "RBRACE";
-        case TOK_EOF:         return "EOF";
-        case TOK_ERROR:       return "ERROR";
-    }
-    return "UNKNOWN";
-}
-
-/* A single token */
-typedef struct {
-    TokenType type;
-    char      text[64];     /* the lexeme (actual text) */
-    int       line;         /* source line number        */
-    int       col;          /* source column number      */
-} Token;
-
 #define MAX_TOKENS 256
 
-/* ════════════════════════════════════════════════════════════════
- *  Section 3: Mini Tokenizer — Implementation
- * ════════════════════════════════════════════════════════════════ */
-
-typedef struct {
-    const char *src;        /* source string */
-    int         pos;        /* current position */
-    int         line;       /* current line */
-    int         col;        /* current column */
-} Lexer;
-
-static void lexer_init(Lexer *lex, const char *source)
-{
-    lex->src  = source;
-    lex->pos  = 0;
-    lex->line = 1;
-    lex->col  = 1;
-}
-
-static char lexer_peek(Lexer *lex)
-{
-    return lex->src[lex->pos];
-}
-
-static char lexer_advance(Lexer *lex)
-{
-    char c = lex->src[lex->pos++];
-    if (c == '\n') {
-        lex->line++;
-        lex->col = 1;
-    } else {
-        lex->col++;
-    }
-    return c;
-}
-
-static int lexer_at_end(Lexer *lex)
-{
-    return lex->src[lex->pos] == '\0';
-}
-
-/* Skip whitespace and comments */
-static void lexer_skip_whitespace_comments(Lexer *lex)
-{
-    while (!lexer_at_end(lex)) {
-        char c = lexer_peek(lex);
-
-        /* Whitespace */
-        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-            lexer_advance(lex);
-            continue;
-        }
-
-        /* Line comment: // ... */
-        if (c == '/' && lex->src[lex->pos + 1] == '/') {
-            lexer_advance(lex); /* skip / */
-            lexer_advance(lex); /* skip / */
-            while (!lexer_at_end(lex) && lexer_peek(lex) != '\n') {
-                lexer_advance(lex);
-            }
-            continue;
-        }
-
-        /* Block comment: slash-star ... star-slash */
-        if (c == '/' && lex->src[lex->pos + 1] == '*') {
-            lexer_advance(lex); /* skip / */
-            lexer_advance(lex); /* skip * */
-            while (!lexer_at_end(lex)) {
-                if (lexer_peek(lex) == '*' && lex->src[lex->pos + 1] == '/') {
-                    lexer_advance(lex); /* skip * */
-                    lexer_advance(lex); /* skip / */
-                    break;
-                }
-                lexer_advance(lex);
-            }
-            continue;
-        }
-
-        break; /* Not whitespace or comment */
-    }
-}
-
-/* Read the next token */
-static Token lexer_next_token(Lexer *lex)
-{
-    Token tok;
-    memset(&tok, 0, sizeof(tok));
-
-    lexer_skip_whitespace_comments(lex);
-
-    tok.line = lex->line;
-    tok.col  = lex->col;
-
-    if (lexer_at_end(lex)) {
-        tok.type = TOK_EOF;
-        strcpy(tok.text, "<EOF>");
-        return tok;
-    }
-
-    char c = lexer_peek(lex);
-
-    /* Single-character tokens */
-    switch (c) {
-        case '+': tok.type = TOK_PLUS;      break;
-        case '-': tok.type = TOK_MINUS;     break;
-        case '*': tok.type = TOK_STAR;      break;
-        case '=': tok.type = TOK_ASSIGN;    break;
-        case ';': tok.type = TOK_SEMICOLON; break;
-        case '(': tok.type = TOK_LPAREN;    break;
-        case ')': tok.type = TOK_RPAREN;    break;
-        case '{': tok.type = TOK_LBRACE;    break;
-        case '}': tok.type = TOK_RBRACE;    break;
-        default:  tok.type = TOK_ERROR;     break;
-    }
-
-    if (tok.type != TOK_ERROR) {
-        tok.text[0] = c;
-        tok.text[1] = '\0';
-        lexer_advance(lex);
-        return tok;
-    }
-
-    /* Integer literal: [0-9]+ */
-    if (isdigit((unsigned char)c)) {
-        int i = 0;
-        while (!lexer_at_end(lex) && isdigit((unsigned char)lexer_peek(lex))) {
-            if (i < 62) tok.text[i++] = lexer_peek(lex);
-            lexer_advance(lex);
-        }
-        tok.text[i] = '\0';
-        tok.type = TOK_INT_LITERAL;
-        return tok;
-    }
-
-    /* Identifier or keyword: [a-zA-Z_][a-zA-Z0-9_]* */
-    if (isalpha((unsigned char)c) || c == '_') {
-        int i = 0;
-        while (!lexer_at_end(lex) &&
-               (isalnum((unsigned char)lexer_peek(lex)) || lexer_peek(lex) == '_')) {
-            if (i < 62) tok.text[i++] = lexer_peek(lex);
-            lexer_advance(lex);
-        }
-        tok.text[i] = '\0';
-
-        /* Check for keywords */
-        if (strcmp(tok.text, "int") == 0)    tok.type = TOK_KW_INT;
-        else if (strcmp(tok.text, "return") == 0) tok.type = TOK_KW_RETURN;
-        else tok.type = TOK_IDENTIFIER;
-        return tok;
-    }
-
-    /* Unrecognised character */
-    tok.type = TOK_ERROR;
-    tok.text[0] = c;
-    tok.text[1] = '\0';
-    lexer_advance(lex);
-    return tok;
-}
-
-/* Tokenize an entire source string and return count */
-static int tokenize_all(const char *source, Token *tokens, int max_tokens)
-{
-    Lexer lex;
-    lexer_init(&lex, source);
-
-    int count = 0;
-    while (count < max_tokens) {
-        tokens[count] = lexer_next_token(&lex);
-        if (tokens[count].type == TOK_EOF) {
-            count++;
-            break;
-        }
-        count++;
-    }
-    return count;
-}
+#define ARRAY_SIZE_(a) (sizeof(a) / sizeof((a)[0]))
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 4: Tokenizer Demo
@@ -470,11 +261,324 @@ static void demo_token_categories(void)
     printf("  The LEXER doesn't distinguish — that's the parser's job.\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 7: Zero-Copy Streaming over an mmap'd File
+ * ════════════════════════════════════════════════════════════════ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Map a file and lex it with the pull iterator — print a summary */
+static int stream_file(const char *path, int show_first)
+{
+    SourceMap map;
+    if (source_map_open(&map, path) != 0) {
+        perror(path);
+        return -1;
+    }
+
+    size_t counts[TOK_ERROR + 1] = { 0 };
+    size_t total = 0;
+    Lexer  lex;
+    lexer_init_buffer(&lex, map.data, map.size);
+
+    if (show_first) {
+        printf("  First %d spans (offset, length, line:col → lexeme in the mapping):\n\n",
+               show_first);
+    }
+
+    double t0 = now_sec();
+    for (;;) {
+        TokenSpan span = lexer_next_span(&lex);
+        counts[span.type]++;
+        if (span.type == TOK_EOF) break;
+        if (total < (size_t)show_first) {
+            printf("    [%6zu +%-3u] %3u:%-3u %-12s '%.*s'\n",
+                   span.offset, span.length, span.line, span.col,
+                   token_type_name(span.type),
+                   (int)span.length, token_span_text(&lex, span));
+        }
+        total++;
+    }
+    double dt = now_sec() - t0;
+
+    printf("\n  File:   %s (%zu bytes, mapped at %p)\n", path, map.size,
+           (const void *)map.data);
+    printf("  Tokens: %zu in %.3f ms", total, dt * 1e3);
+    if (dt > 0)
+        printf("  (%.1f MB/s)", (double)map.size / dt / 1e6);
+    printf("\n  By type:");
+    for (int t = 0; t < TOK_EOF; t++) {
+        if (counts[t]) printf(" %s=%zu", token_type_name((TokenType)t), counts[t]);
+    }
+    printf("\n\n");
+
+    source_map_close(&map);
+    return 0;
+}
+
+static void demo_zero_copy_stream(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 7: Zero-Copy Streaming (mmap + spans)     ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    printf("The Token struct above copies every lexeme into text[64] and\n");
+    printf("tokenize_all() stops at MAX_TOKENS.  Fine for a demo, not for\n");
+    printf("a 100 MB generated source.  The core lexer instead returns\n");
+    printf("spans that point back into the input:\n\n");
+    printf("  typedef struct {\n");
+    printf("      size_t   offset;   uint32_t length;\n");
+    printf("      uint32_t line;     uint32_t col;   TokenType type;\n");
+    printf("      Atom     atom;     /* interned identifier, see Section 9 */\n");
+    printf("  } TokenSpan;           /* %zu bytes, vs %zu for Token */\n\n",
+           sizeof(TokenSpan), sizeof(Token));
+
+    /* Write a synthetic source file, then map it read-only */
+    char path[] = "/tmp/lexer_demo_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return;
+    }
+    FILE *f = fdopen(fd, "w");
+    for (int i = 0; i < 2000; i++) {
+        fprintf(f, "int v%d = (v%d + %d) * 3; /* step %d */\n", i, i / 2, i, i);
+        if (i % 100 == 0) fprintf(f, "// checkpoint %d\n", i);
+    }
+    fprintf(f, "return v1999;\n");
+    fclose(f);
+
+    printf("── Pull iterator over mmap(\"%s\") ──\n\n", path);
+    stream_file(path, 8);
+
+    /* Same file into a growable vector — no MAX_TOKENS limit */
+    SourceMap map;
+    if (source_map_open(&map, path) == 0) {
+        TokenVec vec;
+        token_vec_init(&vec);
+        if (tokenize_spans(map.data, map.size, &vec) == 0) {
+            printf("── tokenize_spans() into a TokenVec ──\n\n");
+            printf("  %zu spans (incl. EOF), capacity %zu — %zu KB of spans,\n",
+                   vec.count, vec.cap, vec.count * sizeof(TokenSpan) / 1024);
+            printf("  vs. %zu KB if every token carried a text[64] copy.\n",
+                   vec.count * sizeof(Token) / 1024);
+            printf("  Last token before EOF: '%.*s' at %u:%u\n\n",
+                   (int)vec.data[vec.count - 2].length,
+                   map.data + vec.data[vec.count - 2].offset,
+                   vec.data[vec.count - 2].line, vec.data[vec.count - 2].col);
+        }
+        token_vec_free(&vec);
+        source_map_close(&map);
+    }
+    unlink(path);
+
+    printf("  Try: ./bin/18_lexical_analysis some_big_file.c\n\n");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 8: SIMD Fast Path vs Scalar Reference
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Fill buf with n bytes of random C-ish text that exercises every path */
+static void random_source(char *buf, size_t n, unsigned *seed)
+{
+    static const char *frags[] = {
+        "int", "return", "x", "_tmp9", "identifier_longer_than_thirty_two_b",
+        "42", "1234567890123456789012345678901234", " ", "    ", "\t", "\n",
+        "\r\n", "// line comment\n", "/* block */", "/* multi\n line\n */",
+        "/*", "*/", "/", "*", "+", "-", "=", ";", "(", ")", "{", "}",
+        "@", "#", "\x80", "intx", "returned", "in", "                  "
+    };
+    size_t i = 0;
+    while (i < n) {
+        *seed = *seed * 1103515245u + 12345u;
+        const char *f = frags[(*seed >> 16) % ARRAY_SIZE_(frags)];
+        while (*f && i < n) buf[i++] = *f++;
+    }
+}
+
+static int spans_equal(TokenSpan a, TokenSpan b)
+{
+    return a.type == b.type && a.offset == b.offset && a.length == b.length &&
+           a.line == b.line && a.col == b.col && a.atom == b.atom;
+}
+
+/* Lex buf with both implementations; return the number of mismatches */
+static size_t diff_lexers(const char *buf, size_t n, size_t *tokens)
+{
+    Lexer    fast, ref;
+    Interner atoms;             /* shared: equal names must get equal atoms */
+    interner_init(&atoms);
+    lexer_init_buffer(&fast, buf, n);
+    lexer_init_buffer(&ref,  buf, n);
+    lexer_set_interner(&fast, &atoms);
+    lexer_set_interner(&ref,  &atoms);
+
+    size_t bad = 0;
+    for (;;) {
+        TokenSpan a = lexer_next_span(&fast);
+        TokenSpan b = lexer_next_span_scalar(&ref);
+        (*tokens)++;
+        if (!spans_equal(a, b)) {
+            if (bad == 0) {
+                printf("    MISMATCH at offset %zu: fast %s %zu+%u %u:%u, "
+                       "scalar %s %zu+%u %u:%u\n",
+                       b.offset, token_type_name(a.type), a.offset, a.length,
+                       a.line, a.col, token_type_name(b.type), b.offset,
+                       b.length, b.line, b.col);
+            }
+            bad++;
+            break;
+        }
+        if (a.type == TOK_EOF) break;
+    }
+    interner_free(&atoms);
+    return bad;
+}
+
+static double lex_throughput(const char *buf, size_t n, int fast)
+{
+    Lexer lex;
+    lexer_init_buffer(&lex, buf, n);
+    double t0 = now_sec();
+    for (;;) {
+        TokenSpan span = fast ? lexer_next_span(&lex) : lexer_next_span_scalar(&lex);
+        if (span.type == TOK_EOF) break;
+    }
+    double dt = now_sec() - t0;
+    return dt > 0 ? (double)n / dt / 1e6 : 0.0;
+}
+
+/* -1 if the two paths disagree anywhere */
+static int demo_simd_fast_path(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8: SIMD Fast Path vs Scalar Reference     ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    printf("lexer_next_span_scalar() is the textbook loop: one byte per\n");
+    printf("lexer_peek()/lexer_advance(), each updating line and col.\n\n");
+    printf("lexer_next_span() (backend: %s) instead:\n", lexer_simd_backend());
+    printf("  • compares 16/32 bytes at once and turns the result into a\n");
+    printf("    bitmask — ctz(mask) finds the end of a whitespace run,\n");
+    printf("    identifier, digit run, // comment or block comment\n");
+    printf("  • counts newlines with popcount(mask) and derives the column\n");
+    printf("    from the offset of the last newline (clz) — no per-byte\n");
+    printf("    bookkeeping\n");
+    printf("  • classifies keywords with a perfect hash:\n");
+    printf("      slot = (3*len + first_char) & 7 → one memcmp, no strcmp chain\n\n");
+
+    /* Differential check: both paths must agree on every span */
+    unsigned seed = 2024;
+    size_t   tokens = 0, bad = 0;
+    char     small[300];
+    for (int i = 0; i < 2000; i++) {
+        size_t n = (size_t)(i % (int)sizeof(small));
+        random_source(small, n, &seed);
+        bad += diff_lexers(small, n, &tokens);
+    }
+
+    size_t big_n = 4u << 20;
+    char  *big   = malloc(big_n);
+    if (!big) return bad ? -1 : 0;
+    random_source(big, big_n, &seed);
+    bad += diff_lexers(big, big_n, &tokens);
+
+    printf("── Differential test: 2000 random buffers + one 4 MB buffer ──\n\n");
+    printf("  %zu tokens compared, %zu mismatching buffers %s\n\n",
+           tokens, bad, bad ? "✗" : "✓");
+
+    double ref  = lex_throughput(big, big_n, 0);
+    double fast = lex_throughput(big, big_n, 1);
+    printf("── Throughput on the 4 MB buffer ──\n\n");
+    printf("  scalar reference : %8.1f MB/s\n", ref);
+    printf("  %-6s fast path : %8.1f MB/s", lexer_simd_backend(), fast);
+    if (ref > 0) printf("   (%.2fx)", fast / ref);
+    printf("\n\n  The width is fixed at compile time; make test_avx2 builds and\n");
+    printf("  runs this demo with -mavx2 for 32-byte blocks.\n\n");
+
+    free(big);
+    return bad ? -1 : 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 9: String Interning — Identifiers as Atoms
+ * ════════════════════════════════════════════════════════════════ */
+
+static void demo_interning(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 9: String Interning — Names as Atoms      ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    printf("A program names the same few identifiers over and over.  With\n");
+    printf("an Interner attached, the lexer stores each distinct name once\n");
+    printf("and hands out a 32-bit atom; later phases compare atoms with ==\n");
+    printf("and reuse the hash kept next to the string.\n\n");
+
+    const char *src =
+        "int count = 0;\n"
+        "int total = count + step;\n"
+        "{ int count = total * step; total = count; }\n"
+        "return total + count;\n";
+
+    Interner atoms;
+    TokenVec vec;
+    interner_init(&atoms);
+    token_vec_init(&vec);
+    if (tokenize_spans_atoms(src, strlen(src), &vec, &atoms) != 0) {
+        token_vec_free(&vec);
+        interner_free(&atoms);
+        return;
+    }
+
+    printf("── Source ──\n\n%s\n", src);
+    printf("── Identifier tokens ──\n\n");
+    size_t idents = 0, ident_bytes = 0;
+    for (size_t i = 0; i < vec.count; i++) {
+        TokenSpan s = vec.data[i];
+        if (s.type != TOK_IDENTIFIER) continue;
+        printf("  %2u:%-2u  %-6.*s → atom %u\n",
+               s.line, s.col, (int)s.length, src + s.offset, s.atom);
+        idents++;
+        ident_bytes += s.length;
+    }
+
+    size_t stored = 0;
+    for (Atom a = 1; a <= interner_size(&atoms); a++) stored += atom_len(&atoms, a) + 1;
+
+    printf("\n  %zu identifier tokens, %u distinct atoms\n", idents, interner_size(&atoms));
+    printf("  name bytes: %zu in the tokens, %zu stored once (with NULs)\n\n",
+           ident_bytes, stored);
+
+    Atom a = intern_find(&atoms, "count", 5);
+    Atom b = intern_cstr(&atoms, "count");
+    printf("  intern_find(\"count\") = %u, intern_cstr(\"count\") = %u → %s\n",
+           a, b, a == b ? "same atom, no new string" : "MISMATCH");
+    printf("  atom %u → \"%s\" (len %u, hash 0x%08x)\n\n",
+           a, atom_str(&atoms, a), atom_len(&atoms, a), atom_hash(&atoms, a));
+
+    printf("  Chapter 20's symbol table keys on these atoms, so looking up\n");
+    printf("  a name is an integer compare, not a strcmp per probe.\n\n");
+
+    token_vec_free(&vec);
+    interner_free(&atoms);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main
  * ════════════════════════════════════════════════════════════════ */
-int main(void)
+int main(int argc, char *argv[])
 {
+    /* ./bin/18_lexical_analysis FILE — stream FILE and print stats */
+    if (argc > 1)
+        return stream_file(argv[1], 0) == 0 ? 0 : 1;
+
     printf("╔══════════════════════════════════════════════════════╗\n");
     printf("║  Chapter 18 — Lexical Analysis (Tokenization)      ║\n");
     printf("║  Breaking source code into its atoms               ║\n");
@@ -484,6 +588,9 @@ int main(void)
     demo_tokenizer();
     demo_real_lexer();
     demo_token_categories();
+    demo_zero_copy_stream();
+    int status = demo_simd_fast_path() == 0 ? 0 : 1;
+    demo_interning();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: Characters → Tokens → ready for the Parser\n");
@@ -494,5 +601,5 @@ int main(void)
     printf("  tokens that the parser can work with.\n\n");
     printf("  Next up: Chapter 19 — Parsing & AST construction.\n\n");
 
-    return 0;
+    return status;
 }
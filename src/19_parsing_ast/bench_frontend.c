@@ -0,0 +1,604 @@
+/*
+ * Front-end throughput benchmark — chapters 18 and 19
+ *
+ * Generates deterministic C-like corpora and measures:
+ *   lex_tokens  chapter 18 tokenize_all()   (copying Token API)
+ *   lex_spans   chapter 18 tokenize_spans() (zero-copy span lexer)
+ *   parse       chapter 19 parse_expr() + free_ast()   (malloc per node)
+ *   parse_arena chapter 19 parse_expr() + arena_reset() (bump arena)
+ *   eval        chapter 19 eval_ast() over the parsed trees
+ *   parse_flat  chapter 19 flat_parse() into a reused FlatAst (SoA, iterative)
+ *   eval_flat   chapter 19 flat_eval() over the flat expressions
+ *   eval_vm     chapter 19 bc_eval() over bytecode compiled from the trees
+ *
+ * Corpus shapes:
+ *   ident    long identifiers, declarations and assignments
+ *   comment  mostly line and block comments
+ *   nested   deeply parenthesised expressions (--depth)
+ *   mixed    a blend of the three
+ *
+ * Each "file" is one generated buffer of about --size bytes.  The lexer
+ * stages lex it as C source; the parser stages lex/parse a matching
+ * file of NUL-separated expressions (the chapter 19 grammar has no
+ * identifiers or newlines, so it gets its own text of the same shape).
+ *
+ * Build: make bench_frontend
+ * Run:   ./bin/bench_frontend [--shape S|all] [--files N] [--size BYTES]
+ *                             [--depth D] [--reps R] [--seed S]
+ *                             [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "../18_lexical_analysis/lexer.h"
+#include "expr.h"
+#include "flat_ast.h"
+#include "bytecode.h"
+
+/* ════════════════════════════════════════════════════════════════
+ *  Configuration
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef enum { SHAPE_IDENT, SHAPE_COMMENT, SHAPE_NESTED, SHAPE_MIXED, SHAPE_COUNT } Shape;
+
+static const char *shape_names[SHAPE_COUNT] = { "ident", "comment", "nested", "mixed" };
+
+typedef struct {
+    int            shape;       /* -1 = all shapes */
+    int            files;
+    size_t         size;
+    int            depth;
+    int            reps;
+    unsigned       seed;
+    bench_format_t format;
+} Config;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Deterministic corpus generator
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    char  *data;
+    size_t len;
+    size_t cap;
+} Buf;
+
+static void buf_putc(Buf *b, char c)
+{
+    if (b->len + 1 >= b->cap) {
+        b->cap  = b->cap ? b->cap * 2 : 4096;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    b->data[b->len++] = c;
+    b->data[b->len]   = '\0';
+}
+
+static void buf_puts(Buf *b, const char *s)
+{
+    while (*s) buf_putc(b, *s++);
+}
+
+static void buf_printf(Buf *b, const char *fmt, int v)
+{
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), fmt, v);
+    buf_puts(b, tmp);
+}
+
+/* xorshift32 — fixed sequence for a given seed on every platform */
+static uint32_t rng_next(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static int rng_range(uint32_t *s, int n)
+{
+    return (int)(rng_next(s) % (uint32_t)n);
+}
+
+static void gen_identifier(Buf *b, uint32_t *rng)
+{
+    static const char *stems[] = { "count", "index", "buffer_length", "total_bytes",
+                                   "node_ptr", "result_value", "tmp", "hash_seed" };
+    buf_puts(b, stems[rng_range(rng, 8)]);
+    buf_printf(b, "_%d", rng_range(rng, 1000));
+}
+
+/* A parenthesised expression `depth` levels deep, in C-source form */
+static void gen_nested_c(Buf *b, uint32_t *rng, int depth)
+{
+    if (depth == 0) {
+        if (rng_range(rng, 2)) gen_identifier(b, rng);
+        else buf_printf(b, "%d", rng_range(rng, 100));
+        return;
+    }
+    buf_putc(b, '(');
+    gen_nested_c(b, rng, depth - 1);
+    buf_puts(b, rng_range(rng, 2) ? " + " : " * ");
+    buf_printf(b, "%d", rng_range(rng, 100));
+    buf_putc(b, ')');
+}
+
+static void gen_c_statement(Buf *b, uint32_t *rng, Shape shape, int depth)
+{
+    switch (shape) {
+    case SHAPE_IDENT:
+        buf_puts(b, "int ");
+        gen_identifier(b, rng);
+        buf_puts(b, " = ");
+        gen_identifier(b, rng);
+        buf_puts(b, " + ");
+        gen_identifier(b, rng);
+        buf_puts(b, " * ");
+        gen_identifier(b, rng);
+        buf_puts(b, ";\n");
+        break;
+    case SHAPE_COMMENT:
+        if (rng_range(rng, 2)) {
+            buf_puts(b, "/* The quick brown fox jumps over the lazy dog.\n"
+                        " * Generated block comment, line two of three\n"
+                        " * and the closing line of the comment block. */\n");
+        } else {
+            buf_puts(b, "// line comment: nothing to see here, keep scanning\n");
+        }
+        if (rng_range(rng, 4) == 0) {
+            buf_puts(b, "return ");
+            gen_identifier(b, rng);
+            buf_puts(b, ";\n");
+        }
+        break;
+    case SHAPE_NESTED:
+        buf_puts(b, "int v = ");
+        gen_nested_c(b, rng, depth);
+        buf_puts(b, ";\n");
+        break;
+    case SHAPE_MIXED:
+    case SHAPE_COUNT:
+        gen_c_statement(b, rng, (Shape)rng_range(rng, 3), depth / 2 + 1);
+        break;
+    }
+}
+
+/*
+ * Expression text for the chapter 19 grammar.  Values stay small:
+ * products and quotients are literal-only, nesting only adds literals,
+ * so eval_ast never overflows or divides by zero.
+ */
+static void gen_expr_term(Buf *b, uint32_t *rng)
+{
+    buf_printf(b, "%d", rng_range(rng, 90) + 1);
+    if (rng_range(rng, 2)) {
+        buf_puts(b, rng_range(rng, 2) ? " * " : " / ");
+        buf_printf(b, "%d", rng_range(rng, 9) + 1);
+    }
+}
+
+static void gen_expr_nested(Buf *b, uint32_t *rng, int depth)
+{
+    if (depth == 0) {
+        gen_expr_term(b, rng);
+        return;
+    }
+    if (rng_range(rng, 8) == 0) buf_putc(b, '-');
+    buf_putc(b, '(');
+    gen_expr_nested(b, rng, depth - 1);
+    buf_puts(b, rng_range(rng, 2) ? " + " : " - ");
+    gen_expr_term(b, rng);
+    buf_putc(b, ')');
+}
+
+static void gen_expression(Buf *b, uint32_t *rng, Shape shape, int depth)
+{
+    int terms = 8 + rng_range(rng, 24);
+    for (int i = 0; i < terms; i++) {
+        if (i) buf_puts(b, rng_range(rng, 2) ? " + " : " - ");
+        if (shape == SHAPE_NESTED || (shape == SHAPE_MIXED && rng_range(rng, 3) == 0))
+            gen_expr_nested(b, rng, shape == SHAPE_NESTED ? depth : depth / 2 + 1);
+        else
+            gen_expr_term(b, rng);
+    }
+}
+
+typedef struct {
+    Buf     src;        /* C-like source for the lexer stages      */
+    Buf     exprs;      /* NUL-separated expressions for the parser */
+    size_t  n_exprs;
+    size_t  tokens;     /* tokens in src (incl. EOF)               */
+    size_t  nodes;      /* AST nodes over all exprs                */
+} CorpusFile;
+
+static void gen_file(CorpusFile *f, Shape shape, const Config *cfg, int index)
+{
+    uint32_t rng = (cfg->seed * 2654435761u) ^ ((uint32_t)shape << 24) ^
+                   (uint32_t)(index + 1) * 40503u;
+    if (rng == 0) rng = 1;
+
+    memset(f, 0, sizeof(*f));
+    while (f->src.len < cfg->size)
+        gen_c_statement(&f->src, &rng, shape, cfg->depth);
+    while (f->exprs.len < cfg->size) {
+        gen_expression(&f->exprs, &rng, shape, cfg->depth);
+        buf_putc(&f->exprs, '\0');      /* separator; keeps the vector NUL-ended */
+        f->n_exprs++;
+    }
+}
+
+static void free_file(CorpusFile *f)
+{
+    free(f->src.data);
+    free(f->exprs.data);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Stages
+ * ════════════════════════════════════════════════════════════════ */
+
+static size_t count_nodes(const ASTNode *n)
+{
+    if (!n) return 0;
+    return 1 + count_nodes(n->left) + count_nodes(n->right);
+}
+
+typedef struct {
+    const char *stage;
+    const char *unit;
+    size_t      bytes;      /* per rep */
+    size_t      items;      /* per rep */
+    uint64_t    total_ns;   /* median rep */
+    uint64_t    p50_ns;
+    uint64_t    p99_ns;
+} Result;
+
+typedef enum {
+    STAGE_LEX_TOKENS, STAGE_LEX_SPANS, STAGE_PARSE, STAGE_PARSE_ARENA, STAGE_EVAL,
+    STAGE_PARSE_FLAT, STAGE_EVAL_FLAT, STAGE_EVAL_VM, STAGE_COUNT
+} Stage;
+
+static volatile long long sink;     /* keeps results observable */
+
+static uint64_t run_file(Stage stage, CorpusFile *f, Token *tokens, size_t max_tokens,
+                         TokenVec *vec, Arena *arena, ASTNode **roots,
+                         FlatAst *flat, FlatExpr *flat_roots, BcProgram *progs)
+{
+    uint64_t t0 = bench_now_ns();
+    switch (stage) {
+    case STAGE_LEX_TOKENS:
+        sink += tokenize_all(f->src.data, tokens, (int)max_tokens);
+        break;
+    case STAGE_LEX_SPANS:
+        vec->count = 0;
+        tokenize_spans(f->src.data, f->src.len, vec);
+        sink += (long long)vec->count;
+        break;
+    case STAGE_PARSE: {
+        const char *e = f->exprs.data;
+        for (size_t i = 0; i < f->n_exprs; i++) {
+            Parser p;
+            parser_init(&p, e);
+            free_ast(parse_expr(&p));
+            e += strlen(e) + 1;
+        }
+        break;
+    }
+    case STAGE_PARSE_ARENA: {
+        const char *e = f->exprs.data;
+        for (size_t i = 0; i < f->n_exprs; i++) {
+            Parser p;
+            parser_init_arena(&p, e, arena);
+            sink += parse_expr(&p)->type;
+            e += strlen(e) + 1;
+        }
+        arena_reset(arena);             /* whole file's trees in one step */
+        break;
+    }
+    case STAGE_EVAL: {
+        long long acc = 0;
+        for (size_t i = 0; i < f->n_exprs; i++) acc += eval_ast(roots[i]);
+        sink += acc;
+        break;
+    }
+    case STAGE_PARSE_FLAT: {
+        const char *e = f->exprs.data;
+        flat_ast_clear(flat);           /* keeps capacity across files */
+        for (size_t i = 0; i < f->n_exprs; i++) {
+            sink += flat_parse(flat, e).root;
+            e += strlen(e) + 1;
+        }
+        break;
+    }
+    case STAGE_EVAL_FLAT: {
+        long long acc = 0;
+        for (size_t i = 0; i < f->n_exprs; i++) acc += flat_eval(flat, flat_roots[i]);
+        sink += acc;
+        break;
+    }
+    case STAGE_EVAL_VM: {
+        long long acc = 0;
+        for (size_t i = 0; i < f->n_exprs; i++) acc += bc_eval(&progs[i], NULL);
+        sink += acc;
+        break;
+    }
+    case STAGE_COUNT:
+        break;
+    }
+    return bench_now_ns() - t0;
+}
+
+static Result run_stage(Stage stage, CorpusFile *files, const Config *cfg)
+{
+    static const char *names[STAGE_COUNT] = {
+        "lex_tokens", "lex_spans", "parse", "parse_arena", "eval",
+        "parse_flat", "eval_flat", "eval_vm"
+    };
+    Result r = { names[stage], stage <= STAGE_LEX_SPANS ? "tokens" : "nodes", 0, 0, 0, 0, 0 };
+
+    size_t max_tokens = 0;
+    for (int i = 0; i < cfg->files; i++) {
+        if (stage <= STAGE_LEX_SPANS) {
+            r.bytes += files[i].src.len;
+            r.items += files[i].tokens;
+        } else {
+            r.bytes += files[i].exprs.len;
+            r.items += files[i].nodes;
+        }
+        if (files[i].tokens > max_tokens) max_tokens = files[i].tokens;
+    }
+
+    Token   *tokens = stage == STAGE_LEX_TOKENS ? malloc(max_tokens * sizeof(Token)) : NULL;
+    TokenVec vec;
+    token_vec_init(&vec);
+    Arena arena;
+    arena_init(&arena, 256 * 1024);
+    FlatAst flat;
+    flat_ast_init(&flat);
+
+    uint64_t *lat  = malloc((size_t)cfg->files * (size_t)cfg->reps * sizeof(uint64_t));
+    uint64_t *reps = malloc((size_t)cfg->reps * sizeof(uint64_t));
+    size_t    n_lat = 0;
+
+    for (int rep = 0; rep < cfg->reps; rep++) {
+        uint64_t rep_total = 0;
+        for (int i = 0; i < cfg->files; i++) {
+            ASTNode **roots = NULL;
+            if (stage == STAGE_EVAL || stage == STAGE_EVAL_VM) {   /* parse untimed */
+                roots = malloc(files[i].n_exprs * sizeof(*roots));
+                const char *e = files[i].exprs.data;
+                for (size_t k = 0; k < files[i].n_exprs; k++) {
+                    Parser p;
+                    parser_init(&p, e);
+                    roots[k] = parse_expr(&p);
+                    e += strlen(e) + 1;
+                }
+            }
+            FlatExpr *flat_roots = NULL;
+            if (stage == STAGE_EVAL_FLAT) {
+                flat_roots = malloc(files[i].n_exprs * sizeof(*flat_roots));
+                flat_ast_clear(&flat);
+                const char *e = files[i].exprs.data;
+                for (size_t k = 0; k < files[i].n_exprs; k++) {
+                    flat_roots[k] = flat_parse(&flat, e);
+                    e += strlen(e) + 1;
+                }
+            }
+            BcProgram *progs = NULL;
+            if (stage == STAGE_EVAL_VM) {
+                progs = calloc(files[i].n_exprs, sizeof(*progs));
+                for (size_t k = 0; k < files[i].n_exprs; k++) bc_compile(roots[k], &progs[k]);
+            }
+            uint64_t ns = run_file(stage, &files[i], tokens, max_tokens, &vec, &arena, roots,
+                                   &flat, flat_roots, progs);
+            lat[n_lat++] = ns;
+            rep_total   += ns;
+            if (roots) {
+                for (size_t k = 0; k < files[i].n_exprs; k++) free_ast(roots[k]);
+                free(roots);
+            }
+            free(flat_roots);
+            if (progs) {
+                for (size_t k = 0; k < files[i].n_exprs; k++) bc_free(&progs[k]);
+                free(progs);
+            }
+        }
+        reps[rep] = rep_total;
+    }
+
+    r.total_ns = bench_percentile(reps, (size_t)cfg->reps, 50.0);
+    r.p50_ns   = bench_percentile(lat, n_lat, 50.0);
+    r.p99_ns   = bench_percentile(lat, n_lat, 99.0);
+
+    free(lat);
+    free(reps);
+    free(tokens);
+    token_vec_free(&vec);
+    arena_free(&arena);
+    flat_ast_free(&flat);
+    return r;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Reporting
+ * ════════════════════════════════════════════════════════════════ */
+
+static double mb_per_s(const Result *r)
+{
+    return r->total_ns ? (double)r->bytes / 1e6 / ((double)r->total_ns * 1e-9) : 0.0;
+}
+
+static double items_per_s(const Result *r)
+{
+    return r->total_ns ? (double)r->items / ((double)r->total_ns * 1e-9) : 0.0;
+}
+
+static void report_header(const Config *cfg)
+{
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_frontend: %d files x %zu bytes, depth %d, %d reps, seed %u\n\n",
+               cfg->files, cfg->size, cfg->depth, cfg->reps, cfg->seed);
+        printf("  %-11s %-8s %9s %9s %17s %10s %10s\n",
+               "stage", "shape", "MB", "MB/s", "items/s", "p50 us", "p99 us");
+        printf("  %-11s %-8s %9s %9s %17s %10s %10s\n",
+               "-----------", "--------", "---------", "---------",
+               "-----------------", "----------", "----------");
+        break;
+    case BENCH_FMT_CSV:
+        printf("stage,shape,files,bytes,items,unit,seconds,mb_per_s,items_per_s,"
+               "p50_us,p99_us\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"bench_frontend\",\n");
+        printf("  \"config\": { \"files\": %d, \"size\": %zu, \"depth\": %d, "
+               "\"reps\": %d, \"seed\": %u },\n",
+               cfg->files, cfg->size, cfg->depth, cfg->reps, cfg->seed);
+        printf("  \"results\": [");
+        break;
+    }
+}
+
+static void report_row(const Config *cfg, const char *shape, const Result *r, int first)
+{
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-11s %-8s %9.2f %9.1f %8.2f M %-6s %10.1f %10.1f\n",
+               r->stage, shape, (double)r->bytes / 1e6, mb_per_s(r),
+               items_per_s(r) / 1e6, r->unit, r->p50_ns / 1e3, r->p99_ns / 1e3);
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%d,%zu,%zu,%s,%.6f,%.3f,%.1f,%.3f,%.3f\n",
+               r->stage, shape, cfg->files, r->bytes, r->items, r->unit,
+               (double)r->total_ns * 1e-9, mb_per_s(r), items_per_s(r),
+               r->p50_ns / 1e3, r->p99_ns / 1e3);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"stage\": \"%s\", \"shape\": \"%s\", \"files\": %d, "
+               "\"bytes\": %zu, \"items\": %zu, \"unit\": \"%s\", \"seconds\": %.6f, "
+               "\"mb_per_s\": %.3f, \"items_per_s\": %.1f, \"p50_us\": %.3f, "
+               "\"p99_us\": %.3f }",
+               first ? "" : ",", r->stage, shape, cfg->files, r->bytes, r->items,
+               r->unit, (double)r->total_ns * 1e-9, mb_per_s(r), items_per_s(r),
+               r->p50_ns / 1e3, r->p99_ns / 1e3);
+        break;
+    }
+}
+
+static void report_footer(const Config *cfg)
+{
+    if (cfg->format == BENCH_FMT_JSON)
+        printf("\n  ]\n}\n");
+    else if (cfg->format == BENCH_FMT_TEXT)
+        printf("\n  items are tokens for lex_* and AST nodes for parse/eval.\n");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  main
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [--shape ident|comment|nested|mixed|all] [--files N]\n"
+            "          [--size BYTES] [--depth D] [--reps R] [--seed S]\n"
+            "          [--format text|csv|json]\n", argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+
+        if (strcmp(opt, "--shape") == 0) {
+            cfg->shape = -2;
+            if (strcmp(val, "all") == 0) cfg->shape = -1;
+            for (int s = 0; s < SHAPE_COUNT; s++)
+                if (strcmp(val, shape_names[s]) == 0) cfg->shape = s;
+            if (cfg->shape == -2) return -1;
+        } else if (strcmp(opt, "--files") == 0) {
+            cfg->files = atoi(val);
+        } else if (strcmp(opt, "--size") == 0) {
+            cfg->size = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--depth") == 0) {
+            cfg->depth = atoi(val);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--seed") == 0) {
+            cfg->seed = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    if (cfg->files < 1 || cfg->size < 1 || cfg->depth < 0 || cfg->reps < 1) return -1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { -1, 32, 64 * 1024, 32, 5, 1, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    report_header(&cfg);
+    int first = 1;
+    long long checksum = 0;
+
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        if (cfg.shape >= 0 && cfg.shape != shape) continue;
+
+        CorpusFile *files = calloc((size_t)cfg.files, sizeof(*files));
+        for (int i = 0; i < cfg.files; i++) {
+            CorpusFile *f = &files[i];
+            gen_file(f, (Shape)shape, &cfg, i);
+
+            /* Untimed pre-pass: item counts and the eval checksum */
+            TokenVec vec;
+            token_vec_init(&vec);
+            tokenize_spans(f->src.data, f->src.len, &vec);
+            f->tokens = vec.count;
+            token_vec_free(&vec);
+
+            const char *e = f->exprs.data;
+            for (size_t k = 0; k < f->n_exprs; k++) {
+                Parser p;
+                parser_init(&p, e);
+                ASTNode *root = parse_expr(&p);
+                f->nodes += count_nodes(root);
+                checksum += eval_ast(root);
+                free_ast(root);
+                e += strlen(e) + 1;
+            }
+        }
+
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            Result r = run_stage((Stage)stage, files, &cfg);
+            report_row(&cfg, shape_names[shape], &r, first);
+            first = 0;
+        }
+
+        for (int i = 0; i < cfg.files; i++) free_file(&files[i]);
+        free(files);
+    }
+
+    report_footer(&cfg);
+    if (cfg.format == BENCH_FMT_TEXT)
+        printf("  eval checksum: %lld\n", checksum);
+    return 0;
+}
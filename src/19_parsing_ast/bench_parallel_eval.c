@@ -0,0 +1,477 @@
+/*
+ * Parallel batch evaluator — chapter 19 expressions, one per line
+ *
+ * Evaluates a file of independent expressions on N threads:
+ *
+ *   mmap(file) ──► split at '\n' into chunks ──► pool workers
+ *                                                  │ own Arena each,
+ *                                                  │ parse + eval lines
+ *                                                  ▼
+ *                  per-chunk output buffers ──► written in input order
+ *
+ * Chunks are handed out by parallel_for() on a chapter 14 work-stealing
+ * pool, one chunk per task (there are several chunks per thread, so a
+ * worker stuck on a slow chunk has the rest stolen from it).  Each worker
+ * parses into its own bump arena and resets it after every line, so the
+ * hot path never touches the shared heap.  Chunk results are text kept
+ * in that chunk's buffer, so concatenating the buffers in chunk order
+ * reproduces input order whatever the schedule was.
+ *
+ * The scaling report runs the whole pipeline at 1, 2, 4, ... threads up
+ * to --threads and checks that every run produced identical output.
+ * Each chunk is a perfctr region (chapter 33), so every run also
+ * reports the workers' IPC and cache misses per 1000 instructions,
+ * summed over all of them — memory stalls show up there as threads are
+ * added — and the pool's steal count.
+ * Blank lines give blank output lines.
+ *
+ * Build: make bench_parallel_eval
+ * Run:   ./bin/bench_parallel_eval [--threads N] [--lines N] [--seed S]
+ *                                  [--output FILE|-] [--format text|csv|json]
+ *                                  [FILE]
+ *        Without FILE, --lines random expressions are generated into a
+ *        temporary file first.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../include/bench.h"
+#include "expr.h"
+#include "../33_debugging_tools/perfctr.h"
+#include "../14_concurrency/tpool.h"
+
+#define CHUNKS_PER_THREAD 8
+
+/* ════════════════════════════════════════════════════════════════
+ *  Input file
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *data;
+    size_t      size;
+} Input;
+
+static int input_open(const char *path, Input *in)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return -1; }
+    in->size = (size_t)st.st_size;
+    in->data = "";
+    if (in->size > 0) {
+        void *p = mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { close(fd); return -1; }
+        posix_madvise(p, in->size, POSIX_MADV_SEQUENTIAL);
+        in->data = p;
+    }
+    close(fd);
+    return 0;
+}
+
+static void input_close(Input *in)
+{
+    if (in->size > 0) munmap((void *)in->data, in->size);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Chunks and workers
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *begin;      /* first byte of the chunk's first line */
+    const char *end;        /* one past its last '\n' (or EOF)      */
+    char       *out;        /* results, one line per input line     */
+    size_t      out_len;
+    size_t      out_cap;
+    size_t      lines;
+} Chunk;
+
+typedef struct {
+    const Input *in;
+    Chunk       *chunks;
+    TPool       *pool;
+    Arena       *arenas;        /* one per pool worker */
+} Job;
+
+/* Cut [0, size) into n pieces whose boundaries sit just after a '\n' */
+static size_t split_chunks(const Input *in, Chunk *chunks, size_t n)
+{
+    const char *p = in->data, *end = in->data + in->size;
+    size_t count = 0;
+    for (size_t k = 1; k <= n && p < end; k++) {
+        const char *cut = k == n ? end : in->data + in->size / n * k;
+        if (cut < p) cut = p;
+        if (cut < end) {
+            const char *nl = memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        if (cut == p) continue;
+        memset(&chunks[count], 0, sizeof(chunks[count]));
+        chunks[count].begin = p;
+        chunks[count].end   = cut;
+        count++;
+        p = cut;
+    }
+    return count;
+}
+
+static int out_reserve(Chunk *c, size_t extra)
+{
+    if (c->out_len + extra <= c->out_cap) return 0;
+    size_t cap = c->out_cap ? c->out_cap : 4096;
+    while (cap < c->out_len + extra) cap *= 2;
+    char *p = realloc(c->out, cap);
+    if (!p) return -1;
+    c->out     = p;
+    c->out_cap = cap;
+    return 0;
+}
+
+static void out_int(Chunk *c, int v)
+{
+    char  tmp[16], *w = tmp + sizeof(tmp);
+    unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+    *--w = '\n';
+    do { *--w = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) *--w = '-';
+    size_t n = (size_t)(tmp + sizeof(tmp) - w);
+    if (out_reserve(c, n) == 0) {
+        memcpy(c->out + c->out_len, w, n);
+        c->out_len += n;
+    }
+}
+
+static void run_chunk(Chunk *c, const Input *in, Arena *arena)
+{
+    const char *file_end = in->data + in->size;
+    const char *p        = c->begin;
+
+    while (p < c->end) {
+        const char *nl = memchr(p, '\n', (size_t)(c->end - p));
+        const char *eol = nl ? nl : c->end;
+        c->lines++;
+
+        if (eol == p) {                         /* blank line */
+            if (out_reserve(c, 1) == 0) c->out[c->out_len++] = '\n';
+        } else {
+            /* The lexer stops at '\n'; only an unterminated last line
+             * needs a NUL-terminated copy. */
+            char *copy = NULL;
+            const char *src = p;
+            if (!nl && eol == file_end) {
+                copy = malloc((size_t)(eol - p) + 1);
+                if (!copy) break;
+                memcpy(copy, p, (size_t)(eol - p));
+                copy[eol - p] = '\0';
+                src = copy;
+            }
+
+            Parser parser;
+            parser_init_arena(&parser, src, arena);
+            out_int(c, eval_ast(parse_expr(&parser)));
+            arena_reset(arena);
+            free(copy);
+        }
+        p = nl ? nl + 1 : c->end;
+    }
+}
+
+/* All chunks of all runs; a run's share is the difference around it */
+static PerfRegion chunk_region = PERF_REGION_INIT("eval chunk");
+
+static void run_chunks(size_t begin, size_t end, void *ctx)
+{
+    Job       *job   = ctx;
+    Arena     *arena = &job->arenas[tpool_worker_index(job->pool)];
+    PerfSample start;
+    perfctr_begin(&chunk_region, &start);
+    for (size_t i = begin; i < end; i++) run_chunk(&job->chunks[i], job->in, arena);
+    perfctr_end(&chunk_region, &start);
+}
+
+typedef struct {
+    int      threads;
+    size_t   chunks;
+    size_t   lines;
+    size_t   out_bytes;
+    uint64_t ns;
+    uint64_t hash;          /* FNV-1a of the ordered output */
+    uint64_t steals;
+    PerfSample counters;    /* the workers', summed */
+} RunResult;
+
+static uint64_t fnv1a(uint64_t h, const char *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/* Evaluate the whole file on `threads` threads; optionally write results */
+static int run_parallel(const Input *in, int threads, FILE *out, RunResult *res)
+{
+    size_t max_chunks = (size_t)threads * CHUNKS_PER_THREAD;
+    Chunk *chunks     = malloc(max_chunks * sizeof(*chunks));
+    Arena *arenas     = malloc((size_t)threads * sizeof(*arenas));
+    TPool *pool       = chunks && arenas ? tpool_create(threads, 0) : NULL;
+    if (!pool) { free(chunks); free(arenas); return -1; }
+    for (int t = 0; t < threads; t++) arena_init(&arenas[t], 16 * 1024);
+
+    Job job = { in, chunks, pool, arenas };
+
+    PerfSample before, after;
+    TPoolStats  stats;
+    perfctr_region_read(&chunk_region, &before);
+    uint64_t t0 = bench_now_ns();
+    size_t n_chunks = split_chunks(in, chunks, max_chunks);
+    parallel_for(pool, 0, n_chunks, 1, run_chunks, &job);
+    res->ns = bench_now_ns() - t0;
+    perfctr_region_read(&chunk_region, &after);
+    perfctr_diff(&before, &after, &res->counters);
+    tpool_stats(pool, &stats);
+    tpool_destroy(pool);
+
+    res->threads   = threads;
+    res->chunks    = n_chunks;
+    res->steals    = stats.steals;
+    res->lines     = 0;
+    res->out_bytes = 0;
+    res->hash      = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n_chunks; i++) {
+        res->lines     += chunks[i].lines;
+        res->out_bytes += chunks[i].out_len;
+        res->hash       = fnv1a(res->hash, chunks[i].out, chunks[i].out_len);
+        if (out) fwrite(chunks[i].out, 1, chunks[i].out_len, out);
+        free(chunks[i].out);
+    }
+
+    for (int t = 0; t < threads; t++) arena_free(&arenas[t]);
+    free(arenas);
+    free(chunks);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Workload generator
+ * ════════════════════════════════════════════════════════════════ */
+
+static uint32_t xorshift32(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+/* Random expression; '/' only ever divides by a non-zero literal */
+static void gen_expr(FILE *f, uint32_t *rng, int depth)
+{
+    uint32_t r = xorshift32(rng);
+    if (depth == 0 || r % 4 == 0) {
+        fprintf(f, "%u", 1 + (r >> 8) % 99);
+        return;
+    }
+    static const char ops[] = "+-*/";
+    char op = ops[(r >> 4) % 4];
+    int  paren = (r >> 6) % 3 == 0;
+    if (paren) fputc('(', f);
+    gen_expr(f, rng, depth - 1);
+    fprintf(f, " %c ", op);
+    if (op == '/') fprintf(f, "%u", 1 + (r >> 8) % 9);
+    else           gen_expr(f, rng, depth - 1);
+    if (paren) fputc(')', f);
+}
+
+static int gen_file(char *path, size_t lines, uint32_t seed)
+{
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    FILE *f = fdopen(fd, "w");
+    if (!f) { close(fd); return -1; }
+    uint32_t rng = seed ? seed : 1;
+    for (size_t i = 0; i < lines; i++) {
+        gen_expr(f, &rng, 4);
+        fputc('\n', f);
+    }
+    return fclose(f);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    int            threads;
+    size_t         lines;
+    uint32_t       seed;
+    const char    *output;
+    const char    *input;
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--threads N] [--lines N] [--seed S] [--output FILE|-]\n"
+            "       %*s [--format text|csv|json] [FILE]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (opt[0] != '-' || strcmp(opt, "-") == 0) {
+            cfg->input = opt;
+            continue;
+        }
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--threads") == 0) {
+            cfg->threads = atoi(val);
+        } else if (strcmp(opt, "--lines") == 0) {
+            cfg->lines = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--seed") == 0) {
+            cfg->seed = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--output") == 0) {
+            cfg->output = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->threads >= 1 ? 0 : -1;
+}
+
+static void report(const Config *cfg, const RunResult *r, const RunResult *base, int first)
+{
+    double secs    = (double)r->ns / 1e9;
+    double speedup = (double)base->ns / (double)r->ns;
+    double ipc     = perfctr_ipc(&r->counters);
+    double mpki    = perfctr_per_kinstr(&r->counters, PERF_CACHE_MISSES);
+    char   ipc_s[16] = "-", mpki_s[16] = "-";
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        if (ipc >= 0) snprintf(ipc_s, sizeof(ipc_s), "%.2f", ipc);
+        if (mpki >= 0) snprintf(mpki_s, sizeof(mpki_s), "%.2f", mpki);
+        printf("  %7d %7zu %7llu %12.1f %10.2f %8.2fx %9.0f%% %5s %10s  %016llx\n",
+               r->threads, r->chunks, (unsigned long long)r->steals, secs * 1e3, (double)r->lines / secs / 1e6,
+               speedup, 100.0 * speedup / r->threads, ipc_s, mpki_s, (unsigned long long)r->hash);
+        break;
+    case BENCH_FMT_CSV:
+        if (ipc >= 0) snprintf(ipc_s, sizeof(ipc_s), "%.3f", ipc);
+        else          ipc_s[0] = '\0';
+        if (mpki >= 0) snprintf(mpki_s, sizeof(mpki_s), "%.3f", mpki);
+        else           mpki_s[0] = '\0';
+        printf("%d,%zu,%llu,%zu,%.6f,%.1f,%.3f,%016llx,%s,%s\n", r->threads, r->chunks,
+               (unsigned long long)r->steals, r->lines, secs, (double)r->lines / secs, speedup, (unsigned long long)r->hash, ipc_s, mpki_s);
+        break;
+    case BENCH_FMT_JSON:
+        if (ipc >= 0) snprintf(ipc_s, sizeof(ipc_s), "%.3f", ipc);
+        else          strcpy(ipc_s, "null");
+        if (mpki >= 0) snprintf(mpki_s, sizeof(mpki_s), "%.3f", mpki);
+        else           strcpy(mpki_s, "null");
+        printf("%s\n    { \"threads\": %d, \"chunks\": %zu, \"steals\": %llu, \"lines\": %zu, "
+               "\"seconds\": %.6f, \"lines_per_s\": %.1f, \"speedup\": %.3f, "
+               "\"output_hash\": \"%016llx\", \"ipc\": %s, \"cache_mpki\": %s }",
+               first ? "" : ",", r->threads, r->chunks, (unsigned long long)r->steals, r->lines, secs,
+               (double)r->lines / secs, speedup, (unsigned long long)r->hash, ipc_s, mpki_s);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    Config cfg  = { online > 0 ? (int)online : 1, 1000000, 1, NULL, NULL, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char tmp_path[] = "/tmp/bench_parallel_eval_XXXXXX";
+    const char *path = cfg.input;
+    if (!path) {
+        if (gen_file(tmp_path, cfg.lines, cfg.seed) != 0) {
+            perror("generate input");
+            return 1;
+        }
+        path = tmp_path;
+    }
+
+    Input in;
+    if (input_open(path, &in) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (!cfg.input) unlink(tmp_path);
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_parallel_eval: %s, %.1f MB, %ld cores online\n\n",
+               cfg.input ? cfg.input : "generated input", (double)in.size / 1e6, online);
+        printf("  %7s %7s %7s %12s %10s %9s %10s %5s %10s  %-16s\n",
+               "threads", "chunks", "steals", "ms", "M lines/s", "speedup", "efficiency", "IPC", "cache/kins",
+               "output hash");
+        break;
+    case BENCH_FMT_CSV:
+        printf("threads,chunks,steals,lines,seconds,lines_per_s,speedup,output_hash,ipc,cache_mpki\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"parallel_eval\",\n  \"bytes\": %zu,\n  \"runs\": [", in.size);
+        break;
+    }
+
+    /* Scaling: 1, 2, 4, ... and finally --threads itself */
+    RunResult base = { 0 }, r;
+    int identical = 1, first = 1;
+    for (int t = 1; ; t = t * 2 < cfg.threads ? t * 2 : cfg.threads) {
+        if (run_parallel(&in, t, NULL, &r) != 0) {
+            fprintf(stderr, "out of memory\n");
+            break;
+        }
+        if (first) base = r;
+        identical &= r.hash == base.hash;
+        report(&cfg, &r, &base, first);
+        first = 0;
+        if (t == cfg.threads) break;
+    }
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"identical_output\": %s\n}\n", identical ? "true" : "false");
+    else if (cfg.format == BENCH_FMT_TEXT) {
+        printf("\n  %zu lines; output %s across thread counts.\n", base.lines,
+               identical ? "identical" : "DIFFERS");
+        if (perfctr_status()[0]) printf("  Counters: %s\n", perfctr_status());
+    }
+
+    if (cfg.output) {
+        FILE *out = strcmp(cfg.output, "-") == 0 ? stdout : fopen(cfg.output, "w");
+        if (!out) {
+            fprintf(stderr, "%s: %s\n", cfg.output, strerror(errno));
+        } else {
+            run_parallel(&in, cfg.threads, out, &r);
+            if (out != stdout) fclose(out);
+        }
+    }
+
+    input_close(&in);
+    if (!cfg.input) unlink(tmp_path);
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+/*
+ * Chapter 19 — Bytecode compiler and register VM
+ *
+ * See bytecode.h for the instruction set.
+ */
+
+#include "bytecode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(BC_NO_COMPUTED_GOTO)
+#define BC_COMPUTED_GOTO 1
+#endif
+
+/* ════════════════════════════════════════════════════════════════
+ *  Compiler
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Registers needed per node, memoised in a small pointer-keyed table so
+ * long operator chains are not re-measured at every level. */
+typedef struct {
+    const ASTNode **keys;
+    uint32_t       *need;
+    size_t          mask;
+} NeedMap;
+
+static size_t count_nodes(const ASTNode *n)
+{
+    return n ? 1 + count_nodes(n->left) + count_nodes(n->right) : 0;
+}
+
+static uint32_t need_regs(NeedMap *m, const ASTNode *n)
+{
+    if (n->type == NODE_INT || n->type == NODE_VAR) return 1;
+
+    size_t h = ((uintptr_t)n >> 4) * 0x9E3779B97F4A7C15ull;
+    for (h &= m->mask; m->keys[h]; h = (h + 1) & m->mask)
+        if (m->keys[h] == n) return m->need[h];
+
+    uint32_t need;
+    if (n->type == NODE_UNARY_NEG) {
+        need = need_regs(m, n->left);
+    } else {
+        uint32_t l = need_regs(m, n->left);
+        uint32_t r = need_regs(m, n->right);
+        need = l == r ? l + 1 : (l > r ? l : r);
+    }
+
+    /* re-probe: the recursive calls may have taken the free slot we saw */
+    h = ((uintptr_t)n >> 4) * 0x9E3779B97F4A7C15ull;
+    for (h &= m->mask; m->keys[h]; h = (h + 1) & m->mask) {}
+    m->keys[h] = n;
+    m->need[h] = need;
+    return need;
+}
+
+static int emit(BcProgram *prog, BcOp op, uint32_t dst, uint32_t a, uint32_t b, int32_t imm)
+{
+    if (prog->count == prog->cap) {
+        uint32_t new_cap = prog->cap ? prog->cap * 2 : 32;
+        BcInstr *code = realloc(prog->code, new_cap * sizeof(*code));
+        if (!code) return -1;
+        prog->code = code;
+        prog->cap  = new_cap;
+    }
+    prog->code[prog->count++] = (BcInstr){ (uint8_t)op, (uint8_t)dst, (uint8_t)a, (uint8_t)b, imm };
+    if (dst + 1 > prog->n_regs) prog->n_regs = dst + 1;
+    return 0;
+}
+
+/* Emit code leaving n's value in register `base`, using base.. upward */
+static int compile_node(BcProgram *prog, NeedMap *m, const ASTNode *n, uint32_t base)
+{
+    switch (n->type) {
+        case NODE_INT:
+            return emit(prog, OP_CONST, base, 0, 0, n->int_value);
+
+        case NODE_VAR:
+            if ((uint32_t)n->int_value + 1 > prog->n_vars) prog->n_vars = (uint32_t)n->int_value + 1;
+            return emit(prog, OP_LOAD, base, 0, 0, n->int_value);
+
+        case NODE_UNARY_NEG:
+            if (compile_node(prog, m, n->left, base) != 0) return -1;
+            return emit(prog, OP_NEG, base, base, 0, 0);
+
+        case NODE_BINOP: {
+            BcOp op = n->op == '+' ? OP_ADD : n->op == '-' ? OP_SUB :
+                      n->op == '*' ? OP_MUL : OP_DIV;
+            /* Heavier side first, into `base`; the other side into base+1 */
+            if (need_regs(m, n->right) > need_regs(m, n->left)) {
+                if (compile_node(prog, m, n->right, base)     != 0) return -1;
+                if (compile_node(prog, m, n->left,  base + 1) != 0) return -1;
+                return emit(prog, op, base, base + 1, base, 0);
+            }
+            if (compile_node(prog, m, n->left,  base)     != 0) return -1;
+            if (compile_node(prog, m, n->right, base + 1) != 0) return -1;
+            return emit(prog, op, base, base, base + 1, 0);
+        }
+    }
+    return -1;
+}
+
+int bc_compile(const ASTNode *root, BcProgram *prog)
+{
+    prog->count  = 0;
+    prog->n_regs = 0;
+    prog->n_vars = 0;
+    if (!root) return -1;
+
+    size_t slots = 16;
+    while (slots < 2 * count_nodes(root)) slots *= 2;
+    NeedMap m = { calloc(slots, sizeof(*m.keys)), malloc(slots * sizeof(*m.need)), slots - 1 };
+    int rc = -1;
+
+    if (m.keys && m.need && need_regs(&m, root) <= BC_MAX_REGS &&
+        compile_node(prog, &m, root, 0) == 0 &&
+        emit(prog, OP_RET, 0, 0, 0, 0) == 0)
+        rc = 0;
+
+    free(m.keys);
+    free(m.need);
+    if (rc != 0) prog->count = 0;
+    return rc;
+}
+
+void bc_free(BcProgram *prog)
+{
+    free(prog->code);
+    memset(prog, 0, sizeof(*prog));
+}
+
+void bc_disassemble(const BcProgram *prog, const ExprVars *vars)
+{
+    static const char *names[OP_COUNT] = {
+        "const", "load", "add", "sub", "mul", "div", "neg", "ret"
+    };
+    for (uint32_t i = 0; i < prog->count; i++) {
+        const BcInstr *in = &prog->code[i];
+        printf("    %3u  ", i);
+        switch ((BcOp)in->op) {
+            case OP_CONST:
+                printf("r%u = const %d\n", in->dst, in->imm);
+                break;
+            case OP_LOAD:
+                printf("r%u = load  $%d", in->dst, in->imm);
+                if (vars && in->imm < vars->count) printf(" (%s)", vars->names[in->imm]);
+                printf("\n");
+                break;
+            case OP_NEG:
+                printf("r%u = neg   r%u\n", in->dst, in->a);
+                break;
+            case OP_RET:
+                printf("ret r%u\n", in->a);
+                break;
+            default:
+                printf("r%u = %-5s r%u, r%u\n", in->dst, names[in->op], in->a, in->b);
+                break;
+        }
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  VM
+ *
+ *  VM_START / VM_OP / VM_NEXT / VM_END let one interpreter body be
+ *  built either as a computed-goto threaded loop or as a switch.
+ * ════════════════════════════════════════════════════════════════ */
+
+#ifdef BC_COMPUTED_GOTO
+#define VM_TABLE                                                        \
+    static const void *const dispatch[OP_COUNT] = {                     \
+        [OP_CONST] = &&L_OP_CONST, [OP_LOAD] = &&L_OP_LOAD,             \
+        [OP_ADD]   = &&L_OP_ADD,   [OP_SUB]  = &&L_OP_SUB,              \
+        [OP_MUL]   = &&L_OP_MUL,   [OP_DIV]  = &&L_OP_DIV,              \
+        [OP_NEG]   = &&L_OP_NEG,   [OP_RET]  = &&L_OP_RET,              \
+    }
+#define VM_START()  goto *dispatch[ip->op];
+#define VM_OP(op)   L_##op:
+#define VM_NEXT()   do { ip++; goto *dispatch[ip->op]; } while (0)
+#define VM_END()
+#else
+#define VM_TABLE    ((void)0)
+#define VM_START()  for (;;) switch (ip->op) {
+#define VM_OP(op)   case op:
+#define VM_NEXT()   { ip++; continue; }     /* no do/while: continue must reach the for */
+#define VM_END()    default: return 0; }
+#endif
+
+int32_t bc_eval(const BcProgram *prog, const int32_t *vars)
+{
+    int32_t r[BC_MAX_REGS];
+    const BcInstr *ip = prog->code;
+    if (!ip) return 0;
+    VM_TABLE;
+
+    VM_START()
+    VM_OP(OP_CONST)
+        r[ip->dst] = ip->imm;
+        VM_NEXT();
+    VM_OP(OP_LOAD)
+        r[ip->dst] = vars[ip->imm];
+        VM_NEXT();
+    VM_OP(OP_ADD)
+        r[ip->dst] = wrap_add(r[ip->a], r[ip->b]);
+        VM_NEXT();
+    VM_OP(OP_SUB)
+        r[ip->dst] = wrap_sub(r[ip->a], r[ip->b]);
+        VM_NEXT();
+    VM_OP(OP_MUL)
+        r[ip->dst] = wrap_mul(r[ip->a], r[ip->b]);
+        VM_NEXT();
+    VM_OP(OP_DIV)
+        r[ip->dst] = safe_div(r[ip->a], r[ip->b]);
+        VM_NEXT();
+    VM_OP(OP_NEG)
+        r[ip->dst] = wrap_neg(r[ip->a]);
+        VM_NEXT();
+    VM_OP(OP_RET)
+        return r[ip->a];
+    VM_END()
+}
+
+/* Rows [row0, row0+n) with n <= BC_BLOCK; one dispatch per instruction */
+static size_t run_block(const BcProgram *prog, const int32_t *const vars[],
+                        size_t row0, size_t n, int32_t (*r)[BC_BLOCK], int32_t *out)
+{
+    uint8_t hit[BC_BLOCK] = { 0 };     /* row divided by zero */
+    const BcInstr *ip = prog->code;
+    VM_TABLE;
+
+#define LANES(expr) do {                                                \
+        int32_t *d = r[ip->dst];                                        \
+        const int32_t *x = r[ip->a], *y = r[ip->b];                     \
+        (void)x; (void)y;                                               \
+        for (size_t i = 0; i < n; i++) d[i] = (expr);                   \
+    } while (0)
+
+    VM_START()
+    VM_OP(OP_CONST)
+        LANES(ip->imm);
+        VM_NEXT();
+    VM_OP(OP_LOAD)
+        memcpy(r[ip->dst], vars[ip->imm] + row0, n * sizeof(int32_t));
+        VM_NEXT();
+    VM_OP(OP_ADD)
+        LANES(wrap_add(x[i], y[i]));
+        VM_NEXT();
+    VM_OP(OP_SUB)
+        LANES(wrap_sub(x[i], y[i]));
+        VM_NEXT();
+    VM_OP(OP_MUL)
+        LANES(wrap_mul(x[i], y[i]));
+        VM_NEXT();
+    VM_OP(OP_DIV) {
+        int32_t *d = r[ip->dst];
+        const int32_t *x = r[ip->a], *y = r[ip->b];
+        for (size_t i = 0; i < n; i++) {
+            hit[i] |= y[i] == 0;
+            d[i] = safe_div(x[i], y[i]);
+        }
+        VM_NEXT();
+    }
+    VM_OP(OP_NEG)
+        LANES(wrap_neg(x[i]));
+        VM_NEXT();
+    VM_OP(OP_RET) {
+        memcpy(out, r[ip->a], n * sizeof(int32_t));
+        size_t zero_rows = 0;
+        for (size_t i = 0; i < n; i++) zero_rows += hit[i];
+        return zero_rows;
+    }
+    VM_END()
+#undef LANES
+}
+
+size_t eval_batch(const BcProgram *prog, const int32_t *const vars[],
+                  size_t n_rows, int32_t *out)
+{
+    int32_t regs[BC_MAX_REGS][BC_BLOCK];
+    size_t  zero_rows = 0;
+
+    if (!prog->code) {
+        memset(out, 0, n_rows * sizeof(*out));
+        return 0;
+    }
+    for (size_t row0 = 0; row0 < n_rows; row0 += BC_BLOCK) {
+        size_t n = n_rows - row0 < BC_BLOCK ? n_rows - row0 : BC_BLOCK;
+        zero_rows += run_block(prog, vars, row0, n, regs, out + row0);
+    }
+    return zero_rows;
+}
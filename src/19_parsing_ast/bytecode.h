@@ -0,0 +1,87 @@
+/*
+ * Chapter 19 — Bytecode compiler and register VM
+ *
+ * Compiles an expression AST once into a short list of three-address
+ * register instructions, then evaluates it many times without walking
+ * the tree:
+ *
+ *   x * x + 3 * y          r0 = load  $0 (x)
+ *                          r1 = load  $0 (x)
+ *                          r0 = mul   r0, r1
+ *                          r1 = const 3
+ *                          r2 = load  $1 (y)
+ *                          r1 = mul   r1, r2
+ *                          r0 = add   r0, r1
+ *                          ret r0
+ *
+ * Registers are assigned Sethi–Ullman style: at each binary node the
+ * operand needing more registers is compiled first, so a program needs
+ * only O(log n) registers for balanced trees and 2 for operator chains.
+ *
+ * The VM dispatches with computed goto (GCC/Clang "labels as values")
+ * and falls back to a switch elsewhere or when BC_NO_COMPUTED_GOTO is
+ * defined.  eval_batch() runs the program over columnar input a block
+ * of rows at a time: every register is a vector of BC_BLOCK lanes, so
+ * each instruction is dispatched once per block and its body is a
+ * plain loop the compiler can vectorise.
+ *
+ * Arithmetic wraps on overflow (two's complement) and INT_MIN / -1
+ * gives INT_MIN instead of trapping.
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "expr.h"
+
+#define BC_MAX_REGS  64
+#define BC_BLOCK     64     /* rows per eval_batch() step */
+
+typedef enum {
+    OP_CONST,   /* r[dst] = imm               */
+    OP_LOAD,    /* r[dst] = vars[imm]         */
+    OP_ADD,     /* r[dst] = r[a] + r[b]       */
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,     /* r[dst] = r[b] ? r[a] / r[b] : 0 */
+    OP_NEG,     /* r[dst] = -r[a]             */
+    OP_RET,     /* return r[a]                */
+    OP_COUNT
+} BcOp;
+
+typedef struct {
+    uint8_t op;     /* BcOp */
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+    int32_t imm;    /* OP_CONST literal, OP_LOAD variable slot */
+} BcInstr;          /* 8 bytes */
+
+typedef struct {
+    BcInstr *code;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t n_regs;    /* registers used          */
+    uint32_t n_vars;    /* 1 + highest slot loaded */
+} BcProgram;
+
+/* Compile root into prog (which is reset first).  0 on success, -1 if
+ * the tree needs more than BC_MAX_REGS registers or memory runs out. */
+int     bc_compile(const ASTNode *root, BcProgram *prog);
+void    bc_free(BcProgram *prog);
+void    bc_disassemble(const BcProgram *prog, const ExprVars *vars);
+
+/* One row: vars[i] is variable i.  Silent, and total like eval_ast():
+ * overflow wraps, x / 0 = 0 and INT_MIN / -1 = INT_MIN. */
+int32_t bc_eval(const BcProgram *prog, const int32_t *vars);
+
+/* n_rows rows of columnar input: variable i of row r is vars[i][r];
+ * result r goes to out[r].  Silent; returns the number of rows that
+ * divided by zero (those rows' divisions yield 0). */
+size_t  eval_batch(const BcProgram *prog, const int32_t *const vars[],
+                   size_t n_rows, int32_t *out);
+
+#endif /* BYTECODE_H */
@@ -0,0 +1,529 @@
+/*
+ * Chapter 19 — Expression front-end (shared module)
+ *
+ * See expr.h for the grammar and API.
+ */
+
+#include "expr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 2: Lexer for the Expression Parser
+ * ════════════════════════════════════════════════════════════════ */
+
+void expr_lexer_init(ExprLexer *lex, const char *source)
+{
+    lex->src = source;
+    lex->pos = 0;
+}
+
+Tok expr_next_token(ExprLexer *lex)
+{
+    Tok tok = { T_EOF, 0, '\0', NULL, 0 };
+
+    /* Skip whitespace */
+    while (lex->src[lex->pos] == ' ' || lex->src[lex->pos] == '\t')
+        lex->pos++;
+
+    char c = lex->src[lex->pos];
+    if (c == '\0') return tok;
+
+    /* Integer literal */
+    if (isdigit((unsigned char)c)) {
+        tok.type = T_INT;
+        tok.value = 0;
+        while (isdigit((unsigned char)lex->src[lex->pos])) {
+            tok.value = tok.value * 10 + (lex->src[lex->pos] - '0');
+            lex->pos++;
+        }
+        return tok;
+    }
+
+    /* Identifier */
+    if (isalpha((unsigned char)c) || c == '_') {
+        tok.type = T_IDENT;
+        tok.text = lex->src + lex->pos;
+        while (isalnum((unsigned char)lex->src[lex->pos]) || lex->src[lex->pos] == '_')
+            lex->pos++;
+        tok.len = (int)(lex->src + lex->pos - tok.text);
+        return tok;
+    }
+
+    tok.ch = c;
+    lex->pos++;
+
+    switch (c) {
+        case '+': tok.type = T_PLUS;   return tok;
+        case '-': tok.type = T_MINUS;  return tok;
+        case '*': tok.type = T_STAR;   return tok;
+        case '/': tok.type = T_SLASH;  return tok;
+        case '(': tok.type = T_LPAREN; return tok;
+        case ')': tok.type = T_RPAREN; return tok;
+        default:
+            tok.type = T_ERROR;
+            return tok;
+    }
+}
+
+void expr_vars_init(ExprVars *vars)
+{
+    vars->count = 0;
+}
+
+int expr_vars_slot(ExprVars *vars, const char *name, int len)
+{
+    if (len >= EXPR_NAME_MAX) return -1;
+    for (int i = 0; i < vars->count; i++)
+        if (strncmp(vars->names[i], name, (size_t)len) == 0 && vars->names[i][len] == '\0')
+            return i;
+    if (vars->count == EXPR_MAX_VARS) return -1;
+    memcpy(vars->names[vars->count], name, (size_t)len);
+    vars->names[vars->count][len] = '\0';
+    return vars->count++;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 3: AST Node Definition
+ * ════════════════════════════════════════════════════════════════ */
+
+static ASTNode *alloc_node(Arena *arena)
+{
+    return arena ? ARENA_NEW(arena, ASTNode) : (ASTNode *)malloc(sizeof(ASTNode));
+}
+
+ASTNode *make_int_node(Arena *arena, int value)
+{
+    ASTNode *node = alloc_node(arena);
+    node->type      = NODE_INT;
+    node->int_value = value;
+    node->op        = '\0';
+    node->left      = NULL;
+    node->right     = NULL;
+    return node;
+}
+
+ASTNode *make_binop_node(Arena *arena, char op, ASTNode *left, ASTNode *right)
+{
+    ASTNode *node = alloc_node(arena);
+    node->type      = NODE_BINOP;
+    node->int_value = 0;
+    node->op        = op;
+    node->left      = left;
+    node->right     = right;
+    return node;
+}
+
+ASTNode *make_unary_neg_node(Arena *arena, ASTNode *child)
+{
+    ASTNode *node = alloc_node(arena);
+    node->type      = NODE_UNARY_NEG;
+    node->int_value = 0;
+    node->op        = '-';
+    node->left      = child;
+    node->right     = NULL;
+    return node;
+}
+
+ASTNode *make_var_node(Arena *arena, int slot)
+{
+    ASTNode *node = alloc_node(arena);
+    node->type      = NODE_VAR;
+    node->int_value = slot;
+    node->op        = '\0';
+    node->left      = NULL;
+    node->right     = NULL;
+    return node;
+}
+
+void free_ast(ASTNode *node)
+{
+    if (!node) return;
+    free_ast(node->left);
+    free_ast(node->right);
+    free(node);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 3b: Hash-consed DAG constructors
+ * ════════════════════════════════════════════════════════════════ */
+
+#define DAG_INITIAL_CAP 256
+
+void expr_dag_init(ExprDag *dag)
+{
+    dag->slots = calloc(DAG_INITIAL_CAP, sizeof(*dag->slots));
+    dag->cap   = dag->slots ? DAG_INITIAL_CAP : 0;
+    arena_init(&dag->arena, 0);
+    memset(&dag->stats, 0, sizeof(dag->stats));
+}
+
+void expr_dag_free(ExprDag *dag)
+{
+    free(dag->slots);
+    dag->slots = NULL;
+    dag->cap   = 0;
+    arena_free(&dag->arena);
+}
+
+static size_t dag_hash(NodeType type, char op, int value, const ASTNode *l, const ASTNode *r)
+{
+    uint64_t h = (uint64_t)type * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(unsigned char)op + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uint32_t)value + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)l + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)r + (h << 6) + (h >> 2);
+    return (size_t)(h ^ (h >> 29));
+}
+
+static int dag_grow(ExprDag *dag)
+{
+    size_t    new_cap = dag->cap ? dag->cap * 2 : DAG_INITIAL_CAP;
+    ASTNode **slots   = calloc(new_cap, sizeof(*slots));
+    if (!slots) return -1;
+    for (size_t i = 0; i < dag->cap; i++) {
+        ASTNode *n = dag->slots[i];
+        if (!n) continue;
+        size_t h = dag_hash(n->type, n->op, n->int_value, n->left, n->right) & (new_cap - 1);
+        while (slots[h]) h = (h + 1) & (new_cap - 1);
+        slots[h] = n;
+    }
+    free(dag->slots);
+    dag->slots = slots;
+    dag->cap   = new_cap;
+    return 0;
+}
+
+/* Return the unique node with these fields, creating it if needed */
+static ASTNode *dag_intern(ExprDag *dag, NodeType type, char op, int value,
+                           ASTNode *left, ASTNode *right)
+{
+    if ((dag->stats.nodes + 1) * 10 > dag->cap * 7 && dag_grow(dag) != 0)
+        return NULL;
+
+    size_t mask = dag->cap - 1;
+    size_t h    = dag_hash(type, op, value, left, right) & mask;
+    for (ASTNode *n; (n = dag->slots[h]) != NULL; h = (h + 1) & mask) {
+        if (n->type == type && n->op == op && n->int_value == value &&
+            n->left == left && n->right == right) {
+            dag->stats.hits++;
+            return n;
+        }
+    }
+
+    ASTNode *n = ARENA_NEW(&dag->arena, ASTNode);
+    if (!n) return NULL;
+    n->type      = type;
+    n->int_value = value;
+    n->op        = op;
+    n->left      = left;
+    n->right     = right;
+    dag->slots[h] = n;
+    dag->stats.nodes++;
+    return n;
+}
+
+ASTNode *dag_int(ExprDag *dag, int value)
+{
+    dag->stats.requests++;
+    return dag_intern(dag, NODE_INT, '\0', value, NULL, NULL);
+}
+
+ASTNode *dag_var(ExprDag *dag, int slot)
+{
+    dag->stats.requests++;
+    return dag_intern(dag, NODE_VAR, '\0', slot, NULL, NULL);
+}
+
+static int is_const(const ASTNode *n, int value)
+{
+    return n->type == NODE_INT && n->int_value == value;
+}
+
+static int is_leaf(const ASTNode *n)
+{
+    return n->type == NODE_INT || n->type == NODE_VAR;
+}
+
+ASTNode *dag_neg(ExprDag *dag, ASTNode *child)
+{
+    dag->stats.requests++;
+    if (!child) return NULL;
+    if (child->type == NODE_INT) {
+        dag->stats.folds++;
+        return dag_intern(dag, NODE_INT, '\0', wrap_neg(child->int_value), NULL, NULL);
+    }
+    if (child->type == NODE_UNARY_NEG) {
+        dag->stats.identities++;
+        return child->left;
+    }
+    return dag_intern(dag, NODE_UNARY_NEG, '-', 0, child, NULL);
+}
+
+ASTNode *dag_binop(ExprDag *dag, char op, ASTNode *left, ASTNode *right)
+{
+    dag->stats.requests++;
+    if (!left || !right) return NULL;
+
+    if (left->type == NODE_INT && right->type == NODE_INT) {
+        int32_t a = left->int_value, b = right->int_value;
+        int folded = 1, v = 0;
+        switch (op) {
+            case '+': v = wrap_add(a, b); break;
+            case '-': v = wrap_sub(a, b); break;
+            case '*': v = wrap_mul(a, b); break;
+            case '/': v = safe_div(a, b); break;
+            default:  folded = 0; break;
+        }
+        if (folded) {
+            dag->stats.folds++;
+            return dag_intern(dag, NODE_INT, '\0', v, NULL, NULL);
+        }
+    }
+
+    ASTNode *same = NULL;
+    switch (op) {
+        case '+':
+            if (is_const(right, 0)) same = left;
+            else if (is_const(left, 0)) same = right;
+            break;
+        case '-':
+            if (is_const(right, 0)) same = left;
+            break;
+        case '*':
+            if (is_const(right, 1)) same = left;
+            else if (is_const(left, 1)) same = right;
+            else if (is_const(right, 0) && is_leaf(left)) same = right;
+            else if (is_const(left, 0) && is_leaf(right)) same = left;
+            break;
+        case '/':
+            if (is_const(right, 1)) same = left;
+            break;
+    }
+    if (same) {
+        dag->stats.identities++;
+        return same;
+    }
+    return dag_intern(dag, NODE_BINOP, op, 0, left, right);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 4: Recursive Descent Parser
+ * ════════════════════════════════════════════════════════════════ */
+
+void parser_init(Parser *p, const char *source)
+{
+    parser_init_arena(p, source, NULL);
+}
+
+void parser_init_arena(Parser *p, const char *source, Arena *arena)
+{
+    expr_lexer_init(&p->lexer, source);
+    p->current = expr_next_token(&p->lexer);
+    p->arena   = arena;
+    p->vars    = NULL;
+    p->dag     = NULL;
+}
+
+void parser_set_vars(Parser *p, ExprVars *vars)
+{
+    p->vars = vars;
+}
+
+void parser_set_dag(Parser *p, ExprDag *dag)
+{
+    p->dag = dag;
+}
+
+/* Node construction goes through the DAG when one is attached */
+static ASTNode *new_int(Parser *p, int value)
+{
+    return p->dag ? dag_int(p->dag, value) : make_int_node(p->arena, value);
+}
+
+static ASTNode *new_var(Parser *p, int slot)
+{
+    return p->dag ? dag_var(p->dag, slot) : make_var_node(p->arena, slot);
+}
+
+static ASTNode *new_binop(Parser *p, char op, ASTNode *left, ASTNode *right)
+{
+    return p->dag ? dag_binop(p->dag, op, left, right) : make_binop_node(p->arena, op, left, right);
+}
+
+static ASTNode *new_neg(Parser *p, ASTNode *child)
+{
+    return p->dag ? dag_neg(p->dag, child) : make_unary_neg_node(p->arena, child);
+}
+
+void parser_advance(Parser *p)
+{
+    p->current = expr_next_token(&p->lexer);
+}
+
+int parser_expect(Parser *p, TokType type)
+{
+    if (p->current.type == type) {
+        parser_advance(p);
+        return 1;
+    }
+    printf("  [PARSE ERROR] Expected token type %d, got %d\n", type, p->current.type);
+    return 0;
+}
+
+/*
+ * factor → INTEGER | IDENT | '(' expr ')' | '-' factor
+ */
+ASTNode *parse_factor(Parser *p)
+{
+    /* Unary minus */
+    if (p->current.type == T_MINUS) {
+        parser_advance(p);
+        ASTNode *child = parse_factor(p);
+        return new_neg(p, child);
+    }
+
+    /* Parenthesised expression */
+    if (p->current.type == T_LPAREN) {
+        parser_advance(p);  /* consume '(' */
+        ASTNode *node = parse_expr(p);
+        parser_expect(p, T_RPAREN);  /* consume ')' */
+        return node;
+    }
+
+    /* Integer literal */
+    if (p->current.type == T_INT) {
+        int val = p->current.value;
+        parser_advance(p);
+        return new_int(p, val);
+    }
+
+    /* Variable */
+    if (p->current.type == T_IDENT && p->vars) {
+        int slot = expr_vars_slot(p->vars, p->current.text, p->current.len);
+        if (slot < 0) {
+            printf("  [PARSE ERROR] Too many variables or name too long: %.*s\n",
+                   p->current.len, p->current.text);
+            parser_advance(p);
+            return new_int(p, 0);
+        }
+        parser_advance(p);
+        return new_var(p, slot);
+    }
+
+    printf("  [PARSE ERROR] Unexpected token (type=%d)\n", p->current.type);
+    return new_int(p, 0);
+}
+
+/*
+ * term → factor (('*' | '/') factor)*
+ */
+ASTNode *parse_term(Parser *p)
+{
+    ASTNode *left = parse_factor(p);
+
+    while (p->current.type == T_STAR || p->current.type == T_SLASH) {
+        char op = (p->current.type == T_STAR) ? '*' : '/';
+        parser_advance(p);
+        ASTNode *right = parse_factor(p);
+        left = new_binop(p, op, left, right);
+    }
+
+    return left;
+}
+
+/*
+ * expr → term (('+' | '-') term)*
+ */
+ASTNode *parse_expr(Parser *p)
+{
+    ASTNode *left = parse_term(p);
+
+    while (p->current.type == T_PLUS || p->current.type == T_MINUS) {
+        char op = (p->current.type == T_PLUS) ? '+' : '-';
+        parser_advance(p);
+        ASTNode *right = parse_term(p);
+        left = new_binop(p, op, left, right);
+    }
+
+    return left;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 5: AST Printer (indented tree view)
+ * ════════════════════════════════════════════════════════════════ */
+
+static void print_ast_indent(ASTNode *node, int depth, const char *prefix)
+{
+    if (!node) return;
+
+    /* Print indentation */
+    for (int i = 0; i < depth; i++) printf("  ");
+    printf("%s", prefix);
+
+    switch (node->type) {
+        case NODE_INT:
+            printf("INT(%d)\n", node->int_value);
+            break;
+        case NODE_BINOP:
+            printf("BINOP '%c'\n", node->op);
+            print_ast_indent(node->left,  depth + 1, "├─L: ");
+            print_ast_indent(node->right, depth + 1, "└─R: ");
+            break;
+        case NODE_UNARY_NEG:
+            printf("NEG\n");
+            print_ast_indent(node->left, depth + 1, "└─ ");
+            break;
+        case NODE_VAR:
+            printf("VAR(#%d)\n", node->int_value);
+            break;
+    }
+}
+
+void print_ast(ASTNode *node)
+{
+    print_ast_indent(node, 2, "");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 6: AST Evaluator
+ * ════════════════════════════════════════════════════════════════ */
+
+int eval_ast(ASTNode *node)
+{
+    return eval_ast_env(node, NULL);
+}
+
+int eval_ast_env(ASTNode *node, const int *env)
+{
+    if (!node) return 0;
+
+    switch (node->type) {
+        case NODE_INT:
+            return node->int_value;
+
+        case NODE_VAR:
+            return env ? env[node->int_value] : 0;
+
+        case NODE_BINOP: {
+            int left  = eval_ast_env(node->left, env);
+            int right = eval_ast_env(node->right, env);
+            switch (node->op) {
+                case '+': return wrap_add(left, right);
+                case '-': return wrap_sub(left, right);
+                case '*': return wrap_mul(left, right);
+                case '/': return safe_div(left, right);
+            }
+            return 0;
+        }
+
+        case NODE_UNARY_NEG:
+            return wrap_neg(eval_ast_env(node->left, env));
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Chapter 19 — Expression front-end (shared module)
+ *
+ * Lexer, recursive-descent parser, AST, printer and evaluator for the
+ * chapter 19 expression language:
+ *
+ *   expr   → term (('+' | '-') term)*
+ *   term   → factor (('*' | '/') factor)*
+ *   factor → INTEGER | IDENT | '(' expr ')' | '-' factor
+ *
+ * Identifiers are variables.  A parser with an ExprVars table attached
+ * (parser_set_vars) gives each distinct name a slot number; the value
+ * of slot i is supplied at evaluation time as env[i].
+ *
+ * Used by the chapter demo (parsing_ast.c), bytecode.c and the
+ * front-end benchmark.
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdint.h>
+
+#include "../../include/arena.h"
+
+/* ── Tokens ──────────────────────────────────────────────────── */
+typedef enum {
+    T_INT,      /* integer literal          */
+    T_IDENT,    /* identifier [A-Za-z_]\w*  */
+    T_PLUS,     /* +                        */
+    T_MINUS,    /* -                        */
+    T_STAR,     /* *                        */
+    T_SLASH,    /* /                        */
+    T_LPAREN,   /* (                        */
+    T_RPAREN,   /* )                        */
+    T_EOF,      /* end of input             */
+    T_ERROR     /* unexpected character     */
+} TokType;
+
+typedef struct {
+    TokType type;
+    int     value;  /* only valid for T_INT */
+    char    ch;     /* the character for operators */
+    const char *text;   /* T_IDENT: start in the source */
+    int     len;        /* T_IDENT: length              */
+} Tok;
+
+typedef struct {
+    const char *src;
+    int         pos;
+} ExprLexer;
+
+void expr_lexer_init(ExprLexer *lex, const char *source);
+Tok  expr_next_token(ExprLexer *lex);
+
+/* ── Variables ───────────────────────────────────────────────── */
+#define EXPR_MAX_VARS  64
+#define EXPR_NAME_MAX  32
+
+typedef struct {
+    char names[EXPR_MAX_VARS][EXPR_NAME_MAX];
+    int  count;
+} ExprVars;
+
+void expr_vars_init(ExprVars *vars);
+/* Slot of name[0..len), adding it if new; -1 if the table is full or the name too long */
+int  expr_vars_slot(ExprVars *vars, const char *name, int len);
+
+/* ── AST ─────────────────────────────────────────────────────── */
+typedef enum {
+    NODE_INT,       /* leaf: integer literal     */
+    NODE_BINOP,     /* binary operator: +,-,*,/  */
+    NODE_UNARY_NEG, /* unary negation: -expr     */
+    NODE_VAR        /* leaf: variable slot       */
+} NodeType;
+
+typedef struct ASTNode {
+    NodeType type;
+    int      int_value;     /* NODE_INT value / NODE_VAR slot */
+    char     op;            /* for NODE_BINOP: '+','-','*','/' */
+    struct ASTNode *left;   /* left child (or child for unary) */
+    struct ASTNode *right;  /* right child               */
+} ASTNode;
+
+/*
+ * Node constructors allocate from `arena` when it is non-NULL, or with
+ * malloc when it is NULL.  A malloc'd tree is released node by node
+ * with free_ast(); an arena tree is released in O(1) by resetting the
+ * arena (free_ast must not be called on it).
+ */
+ASTNode *make_int_node(Arena *arena, int value);
+ASTNode *make_binop_node(Arena *arena, char op, ASTNode *left, ASTNode *right);
+ASTNode *make_unary_neg_node(Arena *arena, ASTNode *child);
+ASTNode *make_var_node(Arena *arena, int slot);
+void     free_ast(ASTNode *node);
+
+/* ── Hash-consed DAG ─────────────────────────────────────────── */
+/*
+ * An optional interning layer for the constructors.  dag_* look each
+ * node up by (type, op, value, left, right) and return the existing
+ * node when there is one, so equal subtrees are built once and the
+ * parser produces a DAG.  Children are already unique, so comparing
+ * them by pointer is a full structural comparison.
+ *
+ * Construction also folds:
+ *   constants   2 * 3 → 6,  -(4) → -4,  -(-x) → x
+ *   identities  x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1 → x
+ *               x * 0, 0 * x → 0 when x is a leaf
+ * Folding uses the evaluators' arithmetic (below), so 7 / 0 → 0 and
+ * INT_MIN / -1 → INT_MIN, and overflow wraps.
+ *
+ * DAG nodes are shared and live in the DAG's own arena: release them
+ * with expr_dag_free(), never free_ast().
+ */
+typedef struct {
+    size_t requests;    /* constructor calls                          */
+    size_t nodes;       /* distinct nodes allocated                   */
+    size_t hits;        /* calls answered by an existing node         */
+    size_t folds;       /* constant folds                             */
+    size_t identities;  /* algebraic identities applied               */
+} ExprDagStats;
+
+typedef struct {
+    ASTNode    **slots;     /* open addressing, NULL = empty */
+    size_t       cap;       /* power of two                  */
+    Arena        arena;
+    ExprDagStats stats;
+} ExprDag;
+
+void     expr_dag_init(ExprDag *dag);
+void     expr_dag_free(ExprDag *dag);
+ASTNode *dag_int(ExprDag *dag, int value);
+ASTNode *dag_var(ExprDag *dag, int slot);
+ASTNode *dag_binop(ExprDag *dag, char op, ASTNode *left, ASTNode *right);
+ASTNode *dag_neg(ExprDag *dag, ASTNode *child);
+
+/* ── Parser ──────────────────────────────────────────────────── */
+/*
+ * Parser state: holds the lexer and the current (lookahead) token.
+ * We use LL(1) — one token of lookahead.
+ */
+typedef struct {
+    ExprLexer lexer;
+    Tok       current;
+    Arena    *arena;    /* node allocator; NULL = malloc */
+    ExprVars *vars;     /* identifier slots; NULL = identifiers rejected */
+    ExprDag  *dag;      /* hash-consing constructors; NULL = plain tree */
+} Parser;
+
+void     parser_init(Parser *p, const char *source);
+void     parser_init_arena(Parser *p, const char *source, Arena *arena);
+void     parser_set_vars(Parser *p, ExprVars *vars);
+void     parser_set_dag(Parser *p, ExprDag *dag);    /* overrides the arena */
+void     parser_advance(Parser *p);
+int      parser_expect(Parser *p, TokType type);
+ASTNode *parse_expr(Parser *p);
+ASTNode *parse_term(Parser *p);
+ASTNode *parse_factor(Parser *p);
+
+/* ── Arithmetic ──────────────────────────────────────────────── */
+/* Every evaluator gives an expression the same value: two's-complement
+ * wrap on overflow, x / 0 = 0 and INT_MIN / -1 = INT_MIN */
+static inline int32_t wrap_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static inline int32_t wrap_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+static inline int32_t wrap_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+static inline int32_t wrap_neg(int32_t a)            { return (int32_t)(0u - (uint32_t)a); }
+static inline int32_t safe_div(int32_t a, int32_t b)
+{
+    return b == 0 ? 0 : b == -1 ? wrap_neg(a) : a / b;
+}
+
+/* ── Printing and evaluation ─────────────────────────────────── */
+void print_ast(ASTNode *node);
+int  eval_ast(ASTNode *node);                       /* variables read as 0 */
+int  eval_ast_env(ASTNode *node, const int *env);   /* variable i = env[i] */
+
+#endif /* EXPR_H */
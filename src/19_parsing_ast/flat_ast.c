@@ -0,0 +1,335 @@
+/*
+ * Chapter 19 — Flat (structure-of-arrays) AST
+ *
+ * See flat_ast.h for the layout.  Nothing in this file recurses.
+ */
+
+#include "flat_ast.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ════════════════════════════════════════════════════════════════
+ *  Node storage
+ * ════════════════════════════════════════════════════════════════ */
+
+void flat_ast_init(FlatAst *ast)
+{
+    memset(ast, 0, sizeof(*ast));
+}
+
+void flat_ast_clear(FlatAst *ast)
+{
+    ast->count = 0;
+}
+
+void flat_ast_free(FlatAst *ast)
+{
+    free(ast->kind);
+    free(ast->op);
+    free(ast->value);
+    free(ast->lhs);
+    free(ast->rhs);
+    free(ast->scratch);
+    flat_ast_init(ast);
+}
+
+/* realloc that leaves *p untouched on failure */
+static int grow_array(void **p, size_t elem, uint32_t new_cap)
+{
+    void *q = realloc(*p, elem * new_cap);
+    if (!q) return -1;
+    *p = q;
+    return 0;
+}
+
+static int flat_reserve(FlatAst *ast, uint32_t need)
+{
+    if (need <= ast->cap) return 0;
+    uint32_t new_cap = ast->cap ? ast->cap : 256;
+    while (new_cap < need) new_cap *= 2;
+
+    if (grow_array((void **)&ast->kind,    sizeof(*ast->kind),    new_cap) ||
+        grow_array((void **)&ast->op,      sizeof(*ast->op),      new_cap) ||
+        grow_array((void **)&ast->value,   sizeof(*ast->value),   new_cap) ||
+        grow_array((void **)&ast->lhs,     sizeof(*ast->lhs),     new_cap) ||
+        grow_array((void **)&ast->rhs,     sizeof(*ast->rhs),     new_cap) ||
+        grow_array((void **)&ast->scratch, sizeof(*ast->scratch), new_cap))
+        return -1;
+    ast->cap = new_cap;
+    return 0;
+}
+
+static uint32_t flat_push(FlatAst *ast, NodeType kind, char op, int32_t value,
+                          uint32_t lhs, uint32_t rhs)
+{
+    if (flat_reserve(ast, ast->count + 1) != 0) return FLAT_NONE;
+    uint32_t i = ast->count++;
+    ast->kind[i]  = (uint8_t)kind;
+    ast->op[i]    = op;
+    ast->value[i] = value;
+    ast->lhs[i]   = lhs;
+    ast->rhs[i]   = rhs;
+    return i;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Iterative operator-precedence parser
+ *
+ *  Two explicit stacks replace the call stack of parse_expr/term/factor:
+ *    operands — indices of finished subtrees
+ *    ops      — pending operators and open parentheses
+ *  An operator is reduced (popped into a node) as soon as one of lower
+ *  or equal precedence arrives, which gives left associativity and
+ *  emits nodes in post-order.
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef enum { PEND_BINOP, PEND_NEG, PEND_LPAREN } PendKind;
+
+typedef struct {
+    uint8_t kind;       /* PendKind */
+    char    op;
+    uint8_t prec;       /* + - : 1,  * / : 2,  unary - : 3 */
+} PendingOp;
+
+typedef struct {
+    void    *data;
+    uint32_t count;
+    uint32_t cap;
+} Stack;
+
+static void *stack_push(Stack *s, size_t elem)
+{
+    if (s->count == s->cap) {
+        uint32_t new_cap = s->cap ? s->cap * 2 : 64;
+        if (grow_array(&s->data, elem, new_cap) != 0) return NULL;
+        s->cap = new_cap;
+    }
+    return (char *)s->data + elem * s->count++;
+}
+
+#define STACK_TOP(s, T)  (((T *)(s).data)[(s).count - 1])
+#define STACK_POP(s, T)  (((T *)(s).data)[--(s).count])
+
+/* Pop one pending operator into a node; returns 0, or -1 on OOM */
+static int reduce(FlatAst *ast, Stack *operands, Stack *ops)
+{
+    PendingOp op = STACK_POP(*ops, PendingOp);
+    uint32_t  node;
+
+    if (op.kind == PEND_NEG) {
+        uint32_t child = STACK_POP(*operands, uint32_t);
+        node = flat_push(ast, NODE_UNARY_NEG, '-', 0, child, FLAT_NONE);
+    } else {
+        uint32_t right = STACK_POP(*operands, uint32_t);
+        uint32_t left  = STACK_POP(*operands, uint32_t);
+        node = flat_push(ast, NODE_BINOP, op.op, 0, left, right);
+    }
+    if (node == FLAT_NONE) return -1;
+    *(uint32_t *)stack_push(operands, sizeof(uint32_t)) = node;  /* never grows */
+    return 0;
+}
+
+static int binop_prec(TokType t)
+{
+    switch (t) {
+        case T_PLUS: case T_MINUS: return 1;
+        case T_STAR: case T_SLASH: return 2;
+        default:                   return 0;
+    }
+}
+
+FlatExpr flat_parse(FlatAst *ast, const char *source)
+{
+    FlatExpr  e = { ast->count, FLAT_NONE };
+    Stack     operands = { NULL, 0, 0 };
+    Stack     ops      = { NULL, 0, 0 };
+    ExprLexer lex;
+    int       expect_operand = 1;
+    int       oom = 0;
+
+    expr_lexer_init(&lex, source);
+    Tok tok = expr_next_token(&lex);
+
+    for (;;) {
+        if (expect_operand) {
+            if (tok.type == T_MINUS || tok.type == T_LPAREN) {
+                PendingOp *op = stack_push(&ops, sizeof(PendingOp));
+                if (!op) { oom = 1; break; }
+                op->kind = tok.type == T_MINUS ? PEND_NEG : PEND_LPAREN;
+                op->op   = tok.ch;
+                op->prec = 3;
+                tok = expr_next_token(&lex);
+                continue;
+            }
+
+            int32_t value = 0;
+            if (tok.type == T_INT) {
+                value = tok.value;
+                tok = expr_next_token(&lex);
+            } else {
+                /* same recovery as parse_factor(): use 0, keep the token */
+                printf("  [PARSE ERROR] Unexpected token (type=%d)\n", tok.type);
+            }
+            uint32_t leaf = flat_push(ast, NODE_INT, '\0', value, FLAT_NONE, FLAT_NONE);
+            uint32_t *slot = leaf == FLAT_NONE ? NULL : stack_push(&operands, sizeof(uint32_t));
+            if (!slot) { oom = 1; break; }
+            *slot = leaf;
+            expect_operand = 0;
+            continue;
+        }
+
+        int prec = binop_prec(tok.type);
+        if (prec) {
+            while (ops.count && STACK_TOP(ops, PendingOp).kind != PEND_LPAREN &&
+                   STACK_TOP(ops, PendingOp).prec >= prec) {
+                if (reduce(ast, &operands, &ops) != 0) { oom = 1; break; }
+            }
+            PendingOp *op = oom ? NULL : stack_push(&ops, sizeof(PendingOp));
+            if (!op) { oom = 1; break; }
+            op->kind = PEND_BINOP;
+            op->op   = tok.ch;
+            op->prec = (uint8_t)prec;
+            tok = expr_next_token(&lex);
+            expect_operand = 1;
+            continue;
+        }
+
+        if (tok.type == T_RPAREN) {
+            while (ops.count && STACK_TOP(ops, PendingOp).kind != PEND_LPAREN) {
+                if (reduce(ast, &operands, &ops) != 0) { oom = 1; break; }
+            }
+            if (oom || ops.count == 0) break;   /* unmatched ')' ends the expression */
+            ops.count--;                        /* drop the '(' */
+            tok = expr_next_token(&lex);
+            continue;
+        }
+
+        break;  /* EOF or a token that cannot continue an expression */
+    }
+
+    while (!oom && ops.count) {
+        if (STACK_TOP(ops, PendingOp).kind == PEND_LPAREN) {
+            printf("  [PARSE ERROR] Expected token type %d, got %d\n", T_RPAREN, tok.type);
+            ops.count--;
+            continue;
+        }
+        if (reduce(ast, &operands, &ops) != 0) oom = 1;
+    }
+
+    if (!oom && operands.count == 1)
+        e.root = STACK_TOP(operands, uint32_t);
+
+    free(operands.data);
+    free(ops.data);
+    return e;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Evaluation — one forward pass over the post-order run
+ * ════════════════════════════════════════════════════════════════ */
+
+int flat_eval(FlatAst *ast, FlatExpr e)
+{
+    if (e.root == FLAT_NONE) return 0;
+    int32_t *v = ast->scratch;
+
+    for (uint32_t i = e.first; i <= e.root; i++) {
+        switch ((NodeType)ast->kind[i]) {
+            case NODE_INT:
+                v[i] = ast->value[i];
+                break;
+            case NODE_UNARY_NEG:
+                v[i] = wrap_neg(v[ast->lhs[i]]);
+                break;
+            case NODE_VAR:      /* flat_parse() does not emit variables */
+                v[i] = 0;
+                break;
+            case NODE_BINOP: {
+                int32_t left  = v[ast->lhs[i]];
+                int32_t right = v[ast->rhs[i]];
+                switch (ast->op[i]) {
+                    case '+': v[i] = wrap_add(left, right); break;
+                    case '-': v[i] = wrap_sub(left, right); break;
+                    case '*': v[i] = wrap_mul(left, right); break;
+                    case '/': v[i] = safe_div(left, right); break;
+                    default:  v[i] = 0; break;
+                }
+                break;
+            }
+        }
+    }
+    return v[e.root];
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Printing
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint32_t node;
+    uint32_t depth;
+    uint8_t  prefix;
+} PrintItem;
+
+/* Pre-order tree view identical to print_ast(), driven by a heap stack */
+void flat_print(const FlatAst *ast, FlatExpr e)
+{
+    static const char *prefixes[] = { "", "├─L: ", "└─R: ", "└─ " };
+    if (e.root == FLAT_NONE) return;
+
+    Stack stack = { NULL, 0, 0 };
+    PrintItem *top = stack_push(&stack, sizeof(PrintItem));
+    if (!top) return;
+    *top = (PrintItem){ e.root, 2, 0 };
+
+    while (stack.count) {
+        PrintItem it = STACK_POP(stack, PrintItem);
+        uint32_t  n  = it.node;
+
+        for (uint32_t i = 0; i < it.depth; i++) printf("  ");
+        printf("%s", prefixes[it.prefix]);
+
+        PrintItem kids[2];
+        int       n_kids = 0;
+        switch ((NodeType)ast->kind[n]) {
+            case NODE_INT:
+                printf("INT(%d)\n", ast->value[n]);
+                break;
+            case NODE_BINOP:
+                printf("BINOP '%c'\n", ast->op[n]);
+                kids[n_kids++] = (PrintItem){ ast->rhs[n], it.depth + 1, 2 };
+                kids[n_kids++] = (PrintItem){ ast->lhs[n], it.depth + 1, 1 };
+                break;
+            case NODE_UNARY_NEG:
+                printf("NEG\n");
+                kids[n_kids++] = (PrintItem){ ast->lhs[n], it.depth + 1, 3 };
+                break;
+            case NODE_VAR:
+                printf("VAR(#%d)\n", ast->value[n]);
+                break;
+        }
+        /* push right before left so the left child prints first */
+        for (int k = 0; k < n_kids; k++) {
+            PrintItem *slot = stack_push(&stack, sizeof(PrintItem));
+            if (!slot) { free(stack.data); return; }
+            *slot = kids[k];
+        }
+    }
+    free(stack.data);
+}
+
+/* The node arrays in storage order — which is reverse Polish notation */
+void flat_print_postfix(const FlatAst *ast, FlatExpr e)
+{
+    if (e.root == FLAT_NONE) return;
+    for (uint32_t i = e.first; i <= e.root; i++) {
+        switch ((NodeType)ast->kind[i]) {
+            case NODE_INT:       printf("%d ", ast->value[i]); break;
+            case NODE_BINOP:     printf("%c ", ast->op[i]);    break;
+            case NODE_UNARY_NEG: printf("neg ");               break;
+            case NODE_VAR:       printf("$%d ", ast->value[i]); break;
+        }
+    }
+}
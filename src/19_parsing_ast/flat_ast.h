@@ -0,0 +1,64 @@
+/*
+ * Chapter 19 — Flat (structure-of-arrays) AST
+ *
+ * An alternative to the pointer-linked ASTNode.  Nodes live in parallel
+ * arrays and refer to their children by 32-bit index:
+ *
+ *   index:   0     1     2     3     4          source: 3 + 4 * 2
+ *   kind:   INT   INT   INT  BINOP BINOP
+ *   op:      .     .     .    '*'   '+'
+ *   value:   3     4     2     .     .
+ *   lhs:     .     .     .     1     0
+ *   rhs:     .     .     .     2     3
+ *
+ * flat_parse() is an iterative operator-precedence (Pratt-style) parser
+ * with explicit operand/operator stacks, so nesting depth is limited by
+ * heap memory, not the C stack.  Because it reduces operators in
+ * precedence order, nodes are appended in post-order: children always
+ * come before their parent and every subtree is a contiguous run of
+ * indices ending at its root.  flat_eval() is therefore one forward
+ * pass over that run — no recursion, no pointer chasing.
+ */
+
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <stdint.h>
+
+#include "expr.h"
+
+#define FLAT_NONE UINT32_MAX
+
+typedef struct {
+    uint8_t  *kind;     /* NodeType                             */
+    char     *op;       /* '+', '-', '*', '/' for NODE_BINOP    */
+    int32_t  *value;    /* literal for NODE_INT                 */
+    uint32_t *lhs;      /* left child / NEG operand, FLAT_NONE  */
+    uint32_t *rhs;      /* right child, FLAT_NONE               */
+    int32_t  *scratch;  /* per-node results for flat_eval()     */
+    uint32_t  count;
+    uint32_t  cap;
+} FlatAst;
+
+/* One parsed expression: nodes [first, root] in post-order */
+typedef struct {
+    uint32_t first;
+    uint32_t root;
+} FlatExpr;
+
+/* Bytes per node across the node arrays (scratch excluded) */
+#define FLAT_NODE_BYTES (sizeof(uint8_t) + sizeof(char) + sizeof(int32_t) + \
+                         2 * sizeof(uint32_t))
+
+void     flat_ast_init(FlatAst *ast);
+void     flat_ast_clear(FlatAst *ast);      /* drop nodes, keep capacity */
+void     flat_ast_free(FlatAst *ast);
+
+/* Parse source and append its nodes.  root is FLAT_NONE on OOM. */
+FlatExpr flat_parse(FlatAst *ast, const char *source);
+
+int      flat_eval(FlatAst *ast, FlatExpr e);
+void     flat_print(const FlatAst *ast, FlatExpr e);         /* same layout as print_ast */
+void     flat_print_postfix(const FlatAst *ast, FlatExpr e); /* array order = RPN       */
+
+#endif /* FLAT_AST_H */
@@ -6,17 +6,21 @@
  *   2. Recursive descent parser with correct operator precedence
  *   3. AST construction, printing, and evaluation
  *   4. Top-down vs bottom-up parsing concepts
+ *   5. A flat, index-linked AST built by an iterative parser
+ *   6. Compiling the AST to register bytecode and batch evaluation
+ *   7. Hash-consing the AST into a DAG with construction-time folding
  *
- * The parser handles: integer literals, +, -, *, /, and parentheses.
+ * The parser handles: integer literals, variables, +, -, *, /, and parentheses.
  *   Precedence: (parentheses) > {*, /} > {+, -}
  *
  * Grammar (BNF):
  *   expr   → term (('+' | '-') term)*
  *   term   → factor (('*' | '/') factor)*
- *   factor → INTEGER | '(' expr ')' | '-' factor
+ *   factor → INTEGER | IDENT | '(' expr ')' | '-' factor
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/19_parsing_ast \
- *            src/19_parsing_ast/parsing_ast.c
+ *            src/19_parsing_ast/parsing_ast.c src/19_parsing_ast/expr.c \
+ *            src/19_parsing_ast/flat_ast.c src/19_parsing_ast/bytecode.c
  * Run:   ./bin/19_parsing_ast
  *
  * Try:
@@ -27,7 +31,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <time.h>
+
+#include "expr.h"
+#include "flat_ast.h"
+#include "bytecode.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: Grammar Rules (BNF) Explanation
@@ -45,7 +53,7 @@ static void demo_grammar_concepts(void)
     printf("── Grammar for arithmetic expressions ──\n\n");
     printf("  expr   → term (('+' | '-') term)*\n");
     printf("  term   → factor (('*' | '/') factor)*\n");
-    printf("  factor → INTEGER | '(' expr ')' | '-' factor\n\n");
+    printf("  factor → INTEGER | IDENT | '(' expr ')' | '-' factor\n\n");
 
     printf("── Why this structure? ──\n\n");
     printf("  • 'expr' handles + and - (lowest precedence)\n");
@@ -74,308 +82,16 @@ static void demo_grammar_concepts(void)
 }
 
 /* ════════════════════════════════════════════════════════════════
- *  Section 2: Lexer for the Expression Parser
- * ════════════════════════════════════════════════════════════════ */
-
-typedef enum {
-    T_INT,      /* integer literal          */
-    T_PLUS,     /* +                        */
-    T_MINUS,    /* -                        */
-    T_STAR,     /* *                        */
-    T_SLASH,    /* /                        */
-    T_LPAREN,   /* (                        */
-    T_RPAREN,   /* )                        */
-    T_EOF,      /* end of input             */
-    T_ERROR     /* unexpected character     */
-} TokType;
-
-typedef struct {
-    TokType type;
-    int     value;  /* only valid for T_INT */
-    char    ch;     /* the character for operators */
-} Tok;
-
-typedef struct {
-    const char *src;
-    int         pos;
-} ExprLexer;
-
-static void expr_lexer_init(ExprLexer *lex, const char *source)
-{
-    lex->src = source;
-    lex->pos = 0;
-}
-
-static Tok expr_next_token(ExprLexer *lex)
-{
-    Tok tok = { T_EOF, 0, '\0' };
-
-    /* Skip whitespace */
-    while (lex->src[lex->pos] == ' ' || lex->src[lex->pos] == '\t')
-        lex->pos++;
-
-    char c = lex->src[lex->pos];
-    if (c == '\0') return tok;
-
-    /* Integer literal */
-    if (isdigit((unsigned char)c)) {
-        tok.type = T_INT;
-        tok.value = 0;
-        while (isdigit((unsigned char)lex->src[lex->pos])) {
-            tok.value = tok.value * 10 + (lex->src[lex->pos] - '0');
-            lex->pos++;
-        }
-        return tok;
-    }
-
-    tok.ch = c;
-    lex->pos++;
-
-    switch (c) {
-        case '+': tok.type = T_PLUS;   return tok;
-        case '-': tok.type = T_MINUS;  return tok;
-        case '*': tok.type = T_STAR;   return tok;
-        case '/': tok.type = T_SLASH;  return tok;
-        case '(': tok.type = T_LPAREN; return tok;
-        case ')': tok.type = T_RPAREN; return tok;
-        default:
-            tok.type = T_ERROR;
-            return tok;
-    }
-}
-
-/* ════════════════════════════════════════════════════════════════
- *  Section 3: AST Node Definition
- * ════════════════════════════════════════════════════════════════ */
-
-typedef enum {
-    NODE_INT,       /* leaf: integer literal     */
-    NODE_BINOP,     /* binary operator: +,-,*,/  */
-    NODE_UNARY_NEG  /* unary negation: -expr     */
-} NodeType;
-
-typedef struct ASTNode {
-    NodeType type;
-    int      int_value;     /* for NODE_INT              */
-    char     op;            /* for NODE_BINOP: '+','-','*','/' */
-    struct ASTNode *left;   /* left child (or child for unary) */
-    struct ASTNode *right;  /* right child               */
-} ASTNode;
-
-static ASTNode *make_int_node(int value)
-{
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
-    node->type      = NODE_INT;
-    node->int_value = value;
-    node->op        = '\0';
-    node->left      = NULL;
-    node->right     = NULL;
-    return node;
-}
-
-static ASTNode *make_binop_node(char op, ASTNode *left, ASTNode *right)
-{
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
-    node->type      = NODE_BINOP;
-    node->int_value = 0;
-    node->op        = op;
-    node->left      = left;
-    node->right     = right;
-    return node;
-}
-
-static ASTNode *make_unary_neg_node(ASTNode *child)
-{
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
-    node->type      = NODE_UNARY_NEG;
-    node->int_value = 0;
-    node->op        = '-';
-    node->left      = child;
-    node->right     = NULL;
-    return node;
-}
-
-static void free_ast(ASTNode *node)
-{
-    if (!node) return;
-    free_ast(node->left);
-    free_ast(node->right);
-    free(node);
-}
-
-/* ════════════════════════════════════════════════════════════════
- *  Section 4: Recursive Descent Parser
- * ════════════════════════════════════════════════════════════════ */
-
-/*
- * Parser state: holds the lexer and the current (lookahead) token.
- * We use LL(1) — one token of lookahead.
- */
-typedef struct {
-    ExprLexer lexer;
-    Tok       current;
-} Parser;
-
-static void parser_init(Parser *p, const char *source)
-{
-    expr_lexer_init(&p->lexer, source);
-    p->current = expr_next_token(&p->lexer);
-}
-
-static void parser_advance(Parser *p)
-{
-    p->current = expr_next_token(&p->lexer);
-}
-
-static int parser_expect(Parser *p, TokType type)
-{
-    if (p->current.type == type) {
-        parser_advance(p);
-        return 1;
-    }
-    printf("  [PARSE ERROR] Expected token type %d, got %d\n", type, p->current.type);
-    return 0;
-}
-
-/* Forward declarations for mutual recursion */
-static ASTNode *parse_expr(Parser *p);
-static ASTNode *parse_term(Parser *p);
-static ASTNode *parse_factor(Parser *p);
-
-/*
- * factor → INTEGER | '(' expr ')' | '-' factor
- */
-static ASTNode *parse_factor(Parser *p)
-{
-    /* Unary minus */
-    if (p->current.type == T_MINUS) {
-        parser_advance(p);
-        ASTNode *child = parse_factor(p);
-        return make_unary_neg_node(child);
-    }
-
-    /* Parenthesised expression */
-    if (p->current.type == T_LPAREN) {
-        parser_advance(p);  /* consume '(' */
-        ASTNode *node = parse_expr(p);
-        parser_expect(p, T_RPAREN);  /* consume ')' */
-        return node;
-    }
-
-    /* Integer literal */
-    if (p->current.type == T_INT) {
-        int val = p->current.value;
-        parser_advance(p);
-        return make_int_node(val);
-    }
-
-    printf("  [PARSE ERROR] Unexpected token (type=%d)\n", p->current.type);
-    return make_int_node(0);
-}
-
-/*
- * term → factor (('*' | '/') factor)*
- */
-static ASTNode *parse_term(Parser *p)
-{
-    ASTNode *left = parse_factor(p);
-
-    while (p->current.type == T_STAR || p->current.type == T_SLASH) {
-        char op = (p->current.type == T_STAR) ? '*' : '/';
-        parser_advance(p);
-        ASTNode *right = parse_factor(p);
-        left = make_binop_node(op, left, right);
-    }
-
-    return left;
-}
-
-/*
- * expr → term (('+' | '-') term)*
- */
-static ASTNode *parse_expr(Parser *p)
-{
-    ASTNode *left = parse_term(p);
-
-    while (p->current.type == T_PLUS || p->current.type == T_MINUS) {
-        char op = (p->current.type == T_PLUS) ? '+' : '-';
-        parser_advance(p);
-        ASTNode *right = parse_term(p);
-        left = make_binop_node(op, left, right);
-    }
-
-    return left;
-}
-
-/* ════════════════════════════════════════════════════════════════
- *  Section 5: AST Printer (indented tree view)
- * ════════════════════════════════════════════════════════════════ */
-
-static void print_ast_indent(ASTNode *node, int depth, const char *prefix)
-{
-    if (!node) return;
-
-    /* Print indentation */
-    for (int i = 0; i < depth; i++) printf("  ");
-    printf("%s", prefix);
-
-    switch (node->type) {
-        case NODE_INT:
-            printf("INT(%d)\n", node->int_value);
-            break;
-        case NODE_BINOP:
-            printf("BINOP '%c'\n", node->op);
-            print_ast_indent(node->left,  depth + 1, "├─L: ");
-            print_ast_indent(node->right, depth + 1, "└─R: ");
-            break;
-        case NODE_UNARY_NEG:
-            printf("NEG\n");
-            print_ast_indent(node->left, depth + 1, "└─ ");
-            break;
-    }
-}
-
-static void print_ast(ASTNode *node)
-{
-    print_ast_indent(node, 2, "");
-}
-
-/* ════════════════════════════════════════════════════════════════
- *  Section 6: AST Evaluator
+ *  Section 2-6: Lexer, AST, Parser, Printer and Evaluator
+ *
+ *  The expression front-end lives in expr.h / expr.c so the
+ *  front-end benchmark and later chapters can reuse it:
+ *    ExprLexer  → Tok stream          (expr_next_token)
+ *    Parser     → ASTNode tree        (parse_expr / parse_term / parse_factor)
+ *    print_ast  → indented tree view
+ *    eval_ast   → recursive evaluation
  * ════════════════════════════════════════════════════════════════ */
 
-static int eval_ast(ASTNode *node)
-{
-    if (!node) return 0;
-
-    switch (node->type) {
-        case NODE_INT:
-            return node->int_value;
-
-        case NODE_BINOP: {
-            int left  = eval_ast(node->left);
-            int right = eval_ast(node->right);
-            switch (node->op) {
-                case '+': return left + right;
-                case '-': return left - right;
-                case '*': return left * right;
-                case '/':
-                    if (right == 0) {
-                        printf("  [RUNTIME ERROR] Division by zero!\n");
-                        return 0;
-                    }
-                    return left / right;
-            }
-            return 0;
-        }
-
-        case NODE_UNARY_NEG:
-            return -eval_ast(node->left);
-    }
-
-    return 0;
-}
-
 /* ════════════════════════════════════════════════════════════════
  *  Section 7: Parsing Demos
  * ════════════════════════════════════════════════════════════════ */
@@ -384,8 +100,12 @@ static void demo_parse_and_eval(const char *expression)
 {
     printf("  Expression: \"%s\"\n\n", expression);
 
+    /* Nodes come from a bump arena: one reset frees the whole tree */
+    Arena arena;
+    arena_init(&arena, 4096);
+
     Parser p;
-    parser_init(&p, expression);
+    parser_init_arena(&p, expression, &arena);
     ASTNode *ast = parse_expr(&p);
 
     printf("  AST:\n");
@@ -393,9 +113,11 @@ static void demo_parse_and_eval(const char *expression)
     printf("\n");
 
     int result = eval_ast(ast);
-    printf("  Result: %d\n\n", result);
+    printf("  Result: %d\n", result);
+    printf("  (%zu nodes, %zu bytes from the arena, released by one arena_free)\n\n",
+           arena.allocated / sizeof(ASTNode), arena.allocated);
 
-    free_ast(ast);
+    arena_free(&arena);
 }
 
 static void demo_parsing(void)
@@ -508,6 +230,251 @@ static void demo_gcc_trees(void)
     printf("  different optimisations.\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Section 10: Flat (Structure-of-Arrays) AST
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Build "(((...(1)...)))" wrapped in `depth` parentheses with a unary
+ * minus every few levels — far deeper than parse_expr() could recurse. */
+static char *make_deep_expr(int depth)
+{
+    size_t len = (size_t)depth * 3 + 2;
+    char  *s   = malloc(len);
+    if (!s) return NULL;
+    char  *w   = s;
+    for (int i = 0; i < depth; i++) {
+        if (i % 4 == 0) *w++ = '-';
+        *w++ = '(';
+    }
+    *w++ = '1';
+    for (int i = 0; i < depth; i++) *w++ = ')';
+    *w = '\0';
+    return s;
+}
+
+static void demo_flat_ast(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 10: Flat (Structure-of-Arrays) AST        ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    printf("── Layout ──\n\n");
+    printf("  Pointer AST: one %zu-byte ASTNode per malloc/arena slot,\n",
+           sizeof(ASTNode));
+    printf("               children reached through 64-bit pointers.\n");
+    printf("  Flat AST:    kind[] op[] value[] lhs[] rhs[] — %zu bytes/node,\n",
+           (size_t)FLAT_NODE_BYTES);
+    printf("               children are 32-bit indices into the same arrays.\n\n");
+
+    printf("  The parser keeps its own operand/operator stacks on the heap\n");
+    printf("  and appends nodes in post-order, so evaluation is a single\n");
+    printf("  left-to-right sweep over the arrays.\n\n");
+
+    static const char *exprs[] = {
+        "3 + 4 * 2",
+        "(3 + 4) * 2",
+        "10 - 2 * 3 + 8 / 4",
+        "-5 + 3",
+        "(10 + 20) * 3 - 50 / (2 + 3)",
+    };
+
+    FlatAst ast;
+    flat_ast_init(&ast);
+
+    printf("── Flat vs pointer AST on the demo expressions ──\n\n");
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        Parser p;
+        parser_init(&p, exprs[i]);
+        ASTNode *tree = parse_expr(&p);
+        int tree_result = eval_ast(tree);
+        free_ast(tree);
+
+        FlatExpr e = flat_parse(&ast, exprs[i]);
+        int flat_result = flat_eval(&ast, e);
+
+        printf("  %-30s tree=%-4d flat=%-4d %s\n", exprs[i], tree_result,
+               flat_result, tree_result == flat_result ? "✓" : "✗ MISMATCH");
+        printf("    RPN (array order): ");
+        flat_print_postfix(&ast, e);
+        printf("\n");
+    }
+    printf("\n");
+
+    flat_ast_clear(&ast);
+    FlatExpr e = flat_parse(&ast, "3 + 4 * (2 - 1)");
+    printf("── flat_print(\"3 + 4 * (2 - 1)\") — same view as print_ast ──\n\n");
+    flat_print(&ast, e);
+    printf("\n");
+
+    const int depth = 100000;
+    char *deep = make_deep_expr(depth);
+    if (deep) {
+        flat_ast_clear(&ast);
+        e = flat_parse(&ast, deep);
+        printf("── %d levels of nesting ──\n\n", depth);
+        printf("  flat_parse: %u nodes, result %d (expected %d)\n",
+               ast.count, flat_eval(&ast, e), (depth / 4) % 2 ? -1 : 1);
+        printf("  parse_expr would need ~%d nested C calls for this input.\n\n",
+               depth * 3);
+        free(deep);
+    }
+
+    flat_ast_free(&ast);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 11: Bytecode Compiler and Register VM
+ * ════════════════════════════════════════════════════════════════ */
+
+static double seconds_since(clock_t t0)
+{
+    return (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+static void demo_bytecode(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 11: Bytecode Compiler & Register VM       ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    const char *src = "x * x + 3 * y - 7 / (z + 1)";
+    printf("  Expression: \"%s\"\n\n", src);
+
+    ExprVars vars;
+    expr_vars_init(&vars);
+    Parser p;
+    parser_init(&p, src);
+    parser_set_vars(&p, &vars);
+    ASTNode *ast = parse_expr(&p);
+
+    BcProgram prog = { 0 };
+    if (bc_compile(ast, &prog) != 0) {
+        printf("  compile failed\n\n");
+        free_ast(ast);
+        return;
+    }
+    printf("── Compiled once: %u instructions, %u registers, %u variables ──\n\n",
+           prog.count, prog.n_regs, prog.n_vars);
+    bc_disassemble(&prog, &vars);
+    printf("\n");
+
+    /* Columnar input: one array per variable */
+    enum { ROWS = 1 << 20 };
+    int32_t *cols[3], *out = malloc(ROWS * sizeof(int32_t));
+    int     *env_rows = malloc((size_t)ROWS * 3 * sizeof(int));
+    unsigned seed = 12345;
+    for (int v = 0; v < 3; v++) cols[v] = malloc(ROWS * sizeof(int32_t));
+    for (size_t r = 0; r < ROWS; r++) {
+        for (int v = 0; v < 3; v++) {
+            seed = seed * 1103515245u + 12345u;
+            cols[v][r] = (int32_t)((seed >> 16) % 100);
+            env_rows[r * 3 + v] = cols[v][r];
+        }
+    }
+
+    long long sum_tree = 0, sum_vm = 0, sum_batch = 0;
+
+    clock_t t0 = clock();
+    for (size_t r = 0; r < ROWS; r++) sum_tree += eval_ast_env(ast, &env_rows[r * 3]);
+    double t_tree = seconds_since(t0);
+
+    t0 = clock();
+    for (size_t r = 0; r < ROWS; r++) sum_vm += bc_eval(&prog, &env_rows[r * 3]);
+    double t_vm = seconds_since(t0);
+
+    t0 = clock();
+    eval_batch(&prog, (const int32_t *const *)cols, ROWS, out);
+    for (size_t r = 0; r < ROWS; r++) sum_batch += out[r];
+    double t_batch = seconds_since(t0);
+
+    printf("── %d rows (x, y, z in 0..99) ──\n\n", ROWS);
+    printf("  eval_ast_env (tree walk, per row)  %7.1f ms   sum %lld\n", t_tree * 1e3, sum_tree);
+    printf("  bc_eval      (VM, per row)         %7.1f ms   sum %lld\n", t_vm * 1e3, sum_vm);
+    printf("  eval_batch   (VM, %d-row blocks)   %7.1f ms   sum %lld\n", BC_BLOCK, t_batch * 1e3, sum_batch);
+    printf("  Results %s.\n\n", sum_tree == sum_vm && sum_vm == sum_batch ? "agree ✓" : "DIFFER ✗");
+
+    printf("  The tree walk pays a recursive call and a switch per node per row.\n");
+    printf("  eval_batch pays one dispatch per instruction per %d rows; each\n", BC_BLOCK);
+    printf("  instruction body is a flat loop over the block.\n\n");
+
+    for (int v = 0; v < 3; v++) free(cols[v]);
+    free(out);
+    free(env_rows);
+    bc_free(&prog);
+    free_ast(ast);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Section 12: Hash-Consed DAG with Constant Folding
+ * ════════════════════════════════════════════════════════════════ */
+
+static void dag_compare(const char *src, const int *env, int show_tree)
+{
+    ExprVars vars;
+    expr_vars_init(&vars);
+
+    Arena arena;
+    arena_init(&arena, 4096);
+    Parser p;
+    parser_init_arena(&p, src, &arena);
+    parser_set_vars(&p, &vars);
+    ASTNode *tree = parse_expr(&p);
+
+    ExprDag dag;
+    expr_dag_init(&dag);
+    parser_init(&p, src);
+    parser_set_vars(&p, &vars);
+    parser_set_dag(&p, &dag);
+    ASTNode *root = parse_expr(&p);
+
+    if (show_tree) {
+        printf("  DAG (shared nodes print once per use):\n");
+        print_ast(root);
+        printf("\n");
+    }
+
+    const ExprDagStats *st = &dag.stats;
+    int tree_result = eval_ast_env(tree, env);
+    int dag_result  = eval_ast_env(root, env);
+    printf("  tree nodes %6zu   dag nodes %6zu   saved %6zu (%.0f%%)\n",
+           arena.allocated / sizeof(ASTNode), st->nodes, st->requests - st->nodes,
+           100.0 * (double)(st->requests - st->nodes) / (double)st->requests);
+    printf("  hits %zu, constant folds %zu, identities %zu\n", st->hits, st->folds,
+           st->identities);
+    printf("  result: tree %d, dag %d %s\n\n", tree_result, dag_result,
+           tree_result == dag_result ? "✓" : "✗ MISMATCH");
+
+    expr_dag_free(&dag);
+    arena_free(&arena);
+}
+
+static void demo_dag(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Section 12: Hash-Consed DAG & Constant Folding    ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    printf("  dag_* constructors look up (type, op, value, left, right)\n");
+    printf("  before allocating, and fold constants and identities.\n\n");
+
+    const int env[] = { 6, 7, 5, 2 };   /* a, b, c, d */
+
+    const char *small = "(a * b + c) * (a * b + c) - (1 * d + 0) + 2 * 3 * 4";
+    printf("── \"%s\" (a=6 b=7 c=5 d=2) ──\n\n", small);
+    dag_compare(small, env, 1);
+
+    /* A generated expression with heavy repetition */
+    enum { TERMS = 2000 };
+    char *big = malloc(TERMS * 24);
+    if (!big) return;
+    char *w = big;
+    for (int i = 0; i < TERMS; i++)
+        w += sprintf(w, "%s(a * b + %d) * 1", i ? " + " : "", i % 10);
+    printf("── %d terms of the form (a * b + k) * 1, k = 0..9 ──\n\n", TERMS);
+    dag_compare(big, env, 0);
+    free(big);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main
  * ════════════════════════════════════════════════════════════════ */
@@ -522,6 +489,9 @@ int main(void)
     demo_parsing();
     demo_precedence();
     demo_gcc_trees();
+    demo_flat_ast();
+    demo_bytecode();
+    demo_dag();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: Tokens → Parser → AST → ready for semantic\n");
@@ -531,7 +501,9 @@ int main(void)
     printf("  Our recursive descent parser:\n");
     printf("    • One function per grammar rule\n");
     printf("    • Naturally encodes operator precedence\n");
-    printf("    • Builds an AST that can be printed and evaluated\n\n");
+    printf("    • Builds an AST that can be printed and evaluated\n");
+    printf("  The flat AST trades pointers for indices and recursion\n");
+    printf("  for explicit stacks.\n\n");
     printf("  Next up: Chapter 20 — Semantic Analysis.\n\n");
 
     return 0;
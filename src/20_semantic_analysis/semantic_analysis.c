@@ -7,9 +7,13 @@
  *   3. Type checking: detect type mismatches
  *   4. Implicit conversions: integer promotion, float↔int
  *   5. GCC warnings that correspond to semantic checks
+ *   6. Symbol table scaling: tens of thousands of names, deep scopes
+ *   7. Atoms end to end: the chapter 18 lexer and the symbol table
+ *      share one string interner
  *
  * Build: gcc -Wall -Wextra -std=c99 -o bin/20_semantic_analysis \
- *            src/20_semantic_analysis/semantic_analysis.c
+ *            src/20_semantic_analysis/semantic_analysis.c \
+ *            src/18_lexical_analysis/lexer.c
  * Run:   ./bin/20_semantic_analysis
  *
  * Try:
@@ -20,6 +24,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "../../include/arena.h"
+#include "../../include/intern.h"
+#include "../18_lexical_analysis/lexer.h"
 
 /* ════════════════════════════════════════════════════════════════
  *  Section 1: Type System — Definitions
@@ -66,169 +75,301 @@ static int is_numeric_type(VarType t)
  *  Section 2: Symbol Table — Hash Map Implementation
  * ════════════════════════════════════════════════════════════════ */
 
-#define SYMTAB_SIZE   64
-#define MAX_SCOPES    16
-#define MAX_NAME_LEN  32
+/*
+ * Layout:
+ *
+ *   slots[]  (open addressing, Robin Hood)    NameRec          Symbol stack
+ *   ┌──────┬──────┬───────┐               ┌────────────┐   ┌─────────┐
+ *   │ hash │ atom │ rec ──┼──────────────►│ atom7 top ─┼──►│ x scope2│─┐ shadowed
+ *   ├──────┼──────┼───────┤               └────────────┘   └─────────┘ │
+ *   │  0   │  0   │ NULL  │                                ┌─────────┐ │
+ *   └──────┴──────┴───────┘                                │ x scope0│◄┘
+ *                                                          └─────────┘
+ *   scope_log[level] → symbols declared in that scope (newest first)
+ *
+ * Names are atoms from an Interner (include/intern.h), either the
+ * table's own or one shared with the lexer.  The slot key is the atom
+ * and the hash is the one the interner computed once per distinct
+ * string, so a probe is two integer compares — no strcmp, no rehash.
+ *
+ * Each distinct name has one NameRec; its bindings form a shadow stack
+ * whose top is the innermost visible declaration, so lookup is a single
+ * probe sequence.  Each scope keeps an undo log of what it declared, so
+ * popping a scope touches only those symbols.  The slot array doubles
+ * when it is 3/4 full; NameRecs never move, so Symbols can point at
+ * theirs.
+ */
+
+#define SYMTAB_INITIAL_SLOTS 64
+#define MAX_NAME_LEN         32
+
+typedef struct NameRec NameRec;
 
 typedef struct Symbol {
-    char            name[MAX_NAME_LEN];
+    Atom            name;               /* in SymbolTable.atoms       */
     VarType         type;
     int             scope_level;
     int             is_initialised;
     int             line_declared;      /* source line of declaration */
-    struct Symbol  *next;               /* hash chain                */
+    NameRec        *rec;                /* the name's shadow stack    */
+    struct Symbol  *shadowed;           /* next-outer binding         */
+    struct Symbol  *scope_next;         /* undo log of its scope      */
 } Symbol;
 
+struct NameRec {
+    Symbol       *top;                  /* innermost binding, or NULL */
+    Atom          atom;
+};
+
+typedef struct {
+    uint32_t      hash;                 /* atom_hash(atom)            */
+    Atom          atom;
+    NameRec      *rec;                  /* NULL = empty slot          */
+} SymSlot;
+
 typedef struct {
-    Symbol *buckets[SYMTAB_SIZE];
-    int     current_scope;
-    int     scope_stack[MAX_SCOPES];    /* track scope entry points  */
-    int     scope_top;
-    int     total_symbols;
-    int     warnings;
-    int     errors;
+    Interner *atoms;                    /* own_atoms, or shared       */
+    Interner  own_atoms;
+    SymSlot *slots;
+    size_t   n_slots;                   /* power of two               */
+    size_t   n_names;
+    Arena    names;                     /* NameRec storage            */
+    Pool     pool;                      /* Symbol storage (arena.h)   */
+    Symbol **scope_log;                 /* per-level undo logs        */
+    int      scope_cap;
+    int      current_scope;
+    int      total_symbols;
+    int      warnings;
+    int      errors;
+    int      quiet;                     /* suppress per-symbol output */
 } SymbolTable;
 
-/* djb2 hash */
-static unsigned int hash_name(const char *name)
+/* Names come from `atoms` if given (e.g. the lexer's), else from an
+ * interner the table owns */
+static void symtab_init_shared(SymbolTable *st, Interner *atoms)
 {
-    unsigned int h = 5381;
-    while (*name) {
-        h = ((h << 5) + h) + (unsigned char)*name;
-        name++;
+    memset(st, 0, sizeof(SymbolTable));
+    if (!atoms) {
+        interner_init(&st->own_atoms);
+        atoms = &st->own_atoms;
     }
-    return h % SYMTAB_SIZE;
+    st->atoms   = atoms;
+    st->n_slots = SYMTAB_INITIAL_SLOTS;
+    st->slots   = calloc(st->n_slots, sizeof(SymSlot));
+    arena_init(&st->names, 16 * 1024);
+    POOL_INIT_FOR(&st->pool, Symbol, 64);
+    st->scope_cap = 16;
+    st->scope_log = calloc((size_t)st->scope_cap, sizeof(Symbol *));
+    st->current_scope = 0;
 }
 
 static void symtab_init(SymbolTable *st)
 {
-    memset(st, 0, sizeof(SymbolTable));
-    st->current_scope = 0;
-    st->scope_top     = 0;
+    symtab_init_shared(st, NULL);
 }
 
-/* Look up a symbol by name — searches from current scope outward */
-static Symbol *symtab_lookup(SymbolTable *st, const char *name)
+static const char *sym_name(const SymbolTable *st, const Symbol *sym)
 {
-    unsigned int idx = hash_name(name);
-    Symbol *sym = st->buckets[idx];
+    return atom_str(st->atoms, sym->name);
+}
 
-    /* Find the most recent (highest scope) match */
-    Symbol *best = NULL;
-    while (sym) {
-        if (strcmp(sym->name, name) == 0) {
-            if (!best || sym->scope_level > best->scope_level) {
-                best = sym;
-            }
+/* Distance of slot i from the home slot of `hash` */
+static size_t probe_dist(const SymbolTable *st, uint32_t hash, size_t i)
+{
+    return (i - (hash & (st->n_slots - 1))) & (st->n_slots - 1);
+}
+
+/* Robin Hood insert of a NameRec known to be absent */
+static void slots_place(SymbolTable *st, SymSlot item)
+{
+    size_t mask = st->n_slots - 1;
+    size_t i    = item.hash & mask;
+    size_t dist = 0;
+    while (st->slots[i].rec) {
+        size_t their = probe_dist(st, st->slots[i].hash, i);
+        if (their < dist) {             /* take from the rich */
+            SymSlot tmp   = st->slots[i];
+            st->slots[i]  = item;
+            item          = tmp;
+            dist          = their;
         }
-        sym = sym->next;
+        i = (i + 1) & mask;
+        dist++;
     }
-    return best;
+    st->slots[i] = item;
 }
 
-/* Look up a symbol in the CURRENT scope only */
-static Symbol *symtab_lookup_current_scope(SymbolTable *st, const char *name)
+static int symtab_grow(SymbolTable *st)
 {
-    unsigned int idx = hash_name(name);
-    Symbol *sym = st->buckets[idx];
-    while (sym) {
-        if (strcmp(sym->name, name) == 0 && sym->scope_level == st->current_scope)
-            return sym;
-        sym = sym->next;
+    SymSlot *old   = st->slots;
+    size_t   old_n = st->n_slots;
+    SymSlot *slots = calloc(old_n * 2, sizeof(SymSlot));
+    if (!slots) return -1;
+
+    st->slots   = slots;
+    st->n_slots = old_n * 2;
+    for (size_t i = 0; i < old_n; i++)
+        if (old[i].rec) slots_place(st, old[i]);
+    free(old);
+    return 0;
+}
+
+/* The NameRec for atom a, or NULL.  Stops early once the probe
+ * distance exceeds that of the resident entry (the Robin Hood
+ * invariant). */
+static NameRec *symtab_find_name(const SymbolTable *st, Atom a)
+{
+    uint32_t h    = atom_hash(st->atoms, a);
+    size_t   mask = st->n_slots - 1;
+    for (size_t i = h & mask, dist = 0; st->slots[i].rec; i = (i + 1) & mask, dist++) {
+        if (probe_dist(st, st->slots[i].hash, i) < dist) break;
+        if (st->slots[i].atom == a) return st->slots[i].rec;
     }
     return NULL;
 }
 
-/* Insert a new symbol */
-static Symbol *symtab_insert(SymbolTable *st, const char *name, VarType type,
-                              int initialised, int line)
+static NameRec *symtab_intern_name(SymbolTable *st, Atom a)
+{
+    NameRec *rec = symtab_find_name(st, a);
+    if (rec) return rec;
+
+    if ((st->n_names + 1) * 4 > st->n_slots * 3 && symtab_grow(st) != 0)
+        return NULL;
+
+    rec = arena_alloc_aligned(&st->names, sizeof(NameRec), ARENA_ALIGNOF(NameRec));
+    if (!rec) return NULL;
+    rec->top  = NULL;
+    rec->atom = a;
+
+    SymSlot item = { atom_hash(st->atoms, a), a, rec };
+    slots_place(st, item);
+    st->n_names++;
+    return rec;
+}
+
+/* Look up a symbol by atom — the innermost visible binding */
+static Symbol *symtab_lookup_atom(SymbolTable *st, Atom a)
+{
+    NameRec *rec = a == ATOM_NONE ? NULL : symtab_find_name(st, a);
+    return rec ? rec->top : NULL;
+}
+
+/* By string: a name never interned cannot be bound, and is not added */
+static Symbol *symtab_lookup(SymbolTable *st, const char *name)
+{
+    return symtab_lookup_atom(st, intern_find(st->atoms, name, strlen(name)));
+}
+
+/* Insert a new symbol named by atom a */
+static Symbol *symtab_insert_atom(SymbolTable *st, Atom a, VarType type,
+                                  int initialised, int line)
 {
+    NameRec *rec = a == ATOM_NONE ? NULL : symtab_intern_name(st, a);
+    if (!rec) {
+        perror("symtab_intern_name");
+        return NULL;
+    }
+    const char *name = atom_str(st->atoms, a);
+
     /* Check for redeclaration in same scope */
-    Symbol *existing = symtab_lookup_current_scope(st, name);
-    if (existing) {
+    Symbol *outer = rec->top;
+    if (outer && outer->scope_level == st->current_scope) {
         printf("    ❌ ERROR: '%s' already declared in this scope (line %d)\n",
-               name, existing->line_declared);
+               name, outer->line_declared);
         st->errors++;
         return NULL;
     }
 
     /* Check for shadowing */
-    Symbol *outer = symtab_lookup(st, name);
-    if (outer && outer->scope_level < st->current_scope) {
+    if (outer && !st->quiet) {
         printf("    ⚠  WARNING: '%s' shadows declaration from scope %d (line %d)\n",
                name, outer->scope_level, outer->line_declared);
         printf("       (gcc -Wshadow would warn about this)\n");
-        st->warnings++;
     }
+    if (outer) st->warnings++;
 
-    /* Create and insert */
-    Symbol *sym = (Symbol *)malloc(sizeof(Symbol));
-    strncpy(sym->name, name, MAX_NAME_LEN - 1);
-    sym->name[MAX_NAME_LEN - 1] = '\0';
+    /* Create and push onto the name's shadow stack and the scope's log */
+    Symbol *sym = (Symbol *)pool_alloc(&st->pool);
+    if (!sym) {
+        perror("pool_alloc");
+        return NULL;
+    }
+    sym->name            = a;
     sym->type            = type;
     sym->scope_level     = st->current_scope;
     sym->is_initialised  = initialised;
     sym->line_declared   = line;
+    sym->rec             = rec;
+    sym->shadowed        = outer;
+    rec->top             = sym;
 
-    unsigned int idx = hash_name(name);
-    sym->next            = st->buckets[idx];
-    st->buckets[idx]     = sym;
+    sym->scope_next      = st->scope_log[st->current_scope];
+    st->scope_log[st->current_scope] = sym;
     st->total_symbols++;
 
-    printf("    ✓ Declared: %-8s %-6s  (scope=%d, line=%d, init=%s)\n",
-           type_name(type), name, st->current_scope, line,
-           initialised ? "yes" : "no");
+    if (!st->quiet)
+        printf("    ✓ Declared: %-8s %-6s  (scope=%d, line=%d, init=%s)\n",
+               type_name(type), name, st->current_scope, line,
+               initialised ? "yes" : "no");
 
     return sym;
 }
 
+static Symbol *symtab_insert(SymbolTable *st, const char *name, VarType type,
+                              int initialised, int line)
+{
+    return symtab_insert_atom(st, intern_cstr(st->atoms, name), type, initialised, line);
+}
+
 /* Push a new scope */
 static void symtab_push_scope(SymbolTable *st)
 {
-    if (st->scope_top < MAX_SCOPES) {
-        st->scope_stack[st->scope_top++] = st->current_scope;
+    if (st->current_scope + 1 == st->scope_cap) {
+        int      cap = st->scope_cap * 2;
+        Symbol **log = realloc(st->scope_log, (size_t)cap * sizeof(Symbol *));
+        if (!log) {
+            perror("symtab_push_scope");
+            return;
+        }
+        st->scope_log = log;
+        st->scope_cap = cap;
     }
     st->current_scope++;
-    printf("    → Entering scope %d\n", st->current_scope);
+    st->scope_log[st->current_scope] = NULL;
+    if (!st->quiet) printf("    → Entering scope %d\n", st->current_scope);
 }
 
-/* Pop current scope — remove all symbols at this level */
+/* Pop current scope — unwind its undo log, nothing else */
 static void symtab_pop_scope(SymbolTable *st)
 {
-    printf("    ← Leaving scope %d\n", st->current_scope);
-
-    /* Remove symbols at current scope level */
-    for (int i = 0; i < SYMTAB_SIZE; i++) {
-        Symbol **pp = &st->buckets[i];
-        while (*pp) {
-            if ((*pp)->scope_level == st->current_scope) {
-                Symbol *doomed = *pp;
-                *pp = doomed->next;
-                free(doomed);
-                st->total_symbols--;
-            } else {
-                pp = &(*pp)->next;
-            }
-        }
-    }
+    if (!st->quiet) printf("    ← Leaving scope %d\n", st->current_scope);
 
-    if (st->scope_top > 0) {
-        st->current_scope = st->scope_stack[--st->scope_top];
+    Symbol *sym = st->scope_log[st->current_scope];
+    while (sym) {
+        Symbol *next = sym->scope_next;
+        sym->rec->top = sym->shadowed;  /* re-expose the outer binding */
+        pool_free(&st->pool, sym);
+        st->total_symbols--;
+        sym = next;
     }
+    st->scope_log[st->current_scope] = NULL;
+
+    if (st->current_scope > 0) st->current_scope--;
 }
 
-/* Free all remaining symbols */
+/* Free everything — pool and arena teardowns, no per-symbol walk */
 static void symtab_free(SymbolTable *st)
 {
-    for (int i = 0; i < SYMTAB_SIZE; i++) {
-        Symbol *sym = st->buckets[i];
-        while (sym) {
-            Symbol *next = sym->next;
-            free(sym);
-            sym = next;
-        }
-        st->buckets[i] = NULL;
-    }
+    pool_destroy(&st->pool);
+    arena_free(&st->names);
+    free(st->slots);
+    free(st->scope_log);
+    if (st->atoms == &st->own_atoms) interner_free(&st->own_atoms);
+    st->atoms         = NULL;
+    st->slots         = NULL;
+    st->scope_log     = NULL;
+    st->n_slots       = 0;
+    st->n_names       = 0;
     st->total_symbols = 0;
 }
 
@@ -341,9 +482,10 @@ static void demo_symbol_table(void)
     printf("A symbol table maps names → {type, scope, attributes}.\n");
     printf("It's the compiler's \"phone book\" for variables.\n\n");
 
-    printf("── Our implementation uses a hash map with chaining ──\n");
-    printf("  Hash function: djb2 (fast, reasonable distribution)\n");
-    printf("  %d buckets, separate chaining for collisions\n\n", SYMTAB_SIZE);
+    printf("── Our implementation uses open addressing ──\n");
+    printf("  Keys: interned atoms, hashed once per distinct name (FNV-1a)\n");
+    printf("  %d slots to start, Robin Hood probing, doubles at 3/4 load\n", SYMTAB_INITIAL_SLOTS);
+    printf("  One entry per name, holding a stack of its bindings\n\n");
 
     SymbolTable st;
     symtab_init(&st);
@@ -717,6 +859,172 @@ static void demo_full_scenario(void)
     symtab_free(&st);
 }
 
+/* ════════════════════════════════════════════════════════════════
+ *  Demo 7: Scaling — Many Symbols, Deep Scopes
+ * ════════════════════════════════════════════════════════════════ */
+
+static double ms_since(clock_t t0)
+{
+    return 1e3 * (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+static void demo_scaling(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Demo 7: Scaling — Many Symbols, Deep Scopes       ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    enum { GLOBALS = 50000, DEPTH = 10000, LOOKUPS = 200000 };
+    char name[MAX_NAME_LEN];
+
+    SymbolTable st;
+    symtab_init(&st);
+    st.quiet = 1;
+
+    clock_t t0 = clock();
+    for (int i = 0; i < GLOBALS; i++) {
+        snprintf(name, sizeof(name), "g%d", i);
+        symtab_insert(&st, name, TYPE_INT, 1, i);
+    }
+    double t_globals = ms_since(t0);
+
+    /* DEPTH nested blocks, each shadowing `v` and adding a local */
+    t0 = clock();
+    for (int d = 1; d <= DEPTH; d++) {
+        symtab_push_scope(&st);
+        symtab_insert(&st, "v", TYPE_INT, 1, d);
+        snprintf(name, sizeof(name), "t%d", d);
+        symtab_insert(&st, name, TYPE_FLOAT, 1, d);
+    }
+    double t_push = ms_since(t0);
+
+    t0 = clock();
+    int found = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+        snprintf(name, sizeof(name), "g%d", (int)((unsigned)i * 2654435761u % GLOBALS));
+        found += symtab_lookup(&st, name) != NULL;
+    }
+    Symbol *v = symtab_lookup(&st, "v");
+    double t_lookup = ms_since(t0);
+
+    /* The same lookups with the names already atoms, as a lexer with
+     * an interner would deliver them */
+    Atom *ids = malloc(LOOKUPS * sizeof(Atom));
+    int   found_atoms = 0;
+    double t_atoms = 0;
+    if (ids) {
+        for (int i = 0; i < LOOKUPS; i++) {
+            snprintf(name, sizeof(name), "g%d", (int)((unsigned)i * 2654435761u % GLOBALS));
+            ids[i] = intern_cstr(st.atoms, name);
+        }
+        t0 = clock();
+        for (int i = 0; i < LOOKUPS; i++)
+            found_atoms += symtab_lookup_atom(&st, ids[i]) != NULL;
+        t_atoms = ms_since(t0);
+        free(ids);
+    }
+    int    v_scope  = v ? v->scope_level : -1;
+    size_t slots = st.n_slots;
+    int    live  = st.total_symbols;
+
+    t0 = clock();
+    while (st.current_scope > 0) symtab_pop_scope(&st);
+    double t_pop = ms_since(t0);
+    Symbol *after = symtab_lookup(&st, "v");
+
+    printf("  %-40s %8.2f ms\n", "declare 50000 globals", t_globals);
+    printf("  %-40s %8.2f ms\n", "enter 10000 scopes, 2 declarations each", t_push);
+    printf("  %-40s %8.2f ms  (%d found)\n", "200000 lookups at depth 10000", t_lookup, found);
+    printf("  %-40s %8.2f ms  (%d found)\n", "  the same, by atom", t_atoms, found_atoms);
+    printf("  %-40s %8.2f ms\n\n", "leave all 10000 scopes", t_pop);
+
+    printf("  %d live symbols in %zu slots at the deepest point.\n", live, slots);
+    printf("  At depth %d, 'v' resolves to scope %d; after unwinding: %s.\n",
+           DEPTH, v_scope, after ? "still bound ✗" : "gone ✓");
+    printf("  %d shadowing warnings were counted (output suppressed).\n\n", st.warnings);
+
+    printf("  Each pop touches only its own scope's undo log, and a lookup\n");
+    printf("  is a single probe sequence whatever the nesting depth.\n\n");
+
+    symtab_free(&st);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Demo 8: Lexer → Symbol Table on Shared Atoms
+ * ════════════════════════════════════════════════════════════════ */
+
+static void demo_shared_atoms(void)
+{
+    printf("╔══════════════════════════════════════════════════════╗\n");
+    printf("║  Demo 8: Lexer → Symbol Table on Shared Atoms      ║\n");
+    printf("╚══════════════════════════════════════════════════════╝\n\n");
+
+    const char *src =
+        "int total = 0;\n"
+        "int step = 2;\n"
+        "{\n"
+        "    int total = step * 3;\n"
+        "    count = total + step;\n"
+        "}\n"
+        "return total;\n";
+
+    printf("The chapter 18 lexer and this symbol table share one Interner:\n");
+    printf("identifier tokens arrive as atoms and are declared and resolved\n");
+    printf("without ever touching their text.\n\n");
+    printf("── Source ──\n\n%s\n", src);
+
+    Interner atoms;
+    TokenVec toks;
+    interner_init(&atoms);
+    token_vec_init(&toks);
+    if (tokenize_spans_atoms(src, strlen(src), &toks, &atoms) != 0) {
+        perror("tokenize_spans_atoms");
+        token_vec_free(&toks);
+        interner_free(&atoms);
+        return;
+    }
+
+    SymbolTable st;
+    symtab_init_shared(&st, &atoms);
+
+    printf("── Walking the token stream ──\n\n");
+    size_t resolved = 0;
+    for (size_t i = 0; i < toks.count; i++) {
+        TokenSpan t = toks.data[i];
+        if (t.type == TOK_LBRACE) {
+            symtab_push_scope(&st);
+        } else if (t.type == TOK_RBRACE) {
+            symtab_pop_scope(&st);
+        } else if (t.type == TOK_IDENTIFIER) {
+            int decl = i > 0 && toks.data[i - 1].type == TOK_KW_INT;
+            int init = i + 1 < toks.count && toks.data[i + 1].type == TOK_ASSIGN;
+            if (decl) {
+                symtab_insert_atom(&st, t.atom, TYPE_INT, init, (int)t.line);
+                continue;
+            }
+            Symbol *sym = symtab_lookup_atom(&st, t.atom);
+            if (!sym) {
+                printf("    ❌ ERROR: use of undeclared identifier '%s' (line %u)\n",
+                       atom_str(&atoms, t.atom), t.line);
+                st.errors++;
+                continue;
+            }
+            printf("    • atom %-2u %-6s line %u → declared line %d, scope %d\n",
+                   t.atom, sym_name(&st, sym), t.line, sym->line_declared, sym->scope_level);
+            resolved++;
+        }
+    }
+
+    printf("\n  %zu uses resolved, %d error(s), %d warning(s);\n",
+           resolved, st.errors, st.warnings);
+    printf("  %u distinct names, each stored once for both phases.\n\n",
+           interner_size(&atoms));
+
+    symtab_free(&st);
+    token_vec_free(&toks);
+    interner_free(&atoms);
+}
+
 /* ════════════════════════════════════════════════════════════════
  *  main
  * ════════════════════════════════════════════════════════════════ */
@@ -740,6 +1048,8 @@ int main(void)
     demo_implicit_conversions();
     demo_gcc_warnings();
     demo_full_scenario();
+    demo_scaling();
+    demo_shared_atoms();
 
     printf("════════════════════════════════════════════════════════\n");
     printf(" Summary: AST + Symbol Table → type-checked, validated\n");
@@ -0,0 +1,330 @@
+/*
+ * Chapter 21 — Control-flow graph and dominators over TAC
+ *
+ * See cfg.h.  Nothing here recurses, so straight-line programs with
+ * hundreds of thousands of blocks are fine.
+ */
+
+#include "cfg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ════════════════════════════════════════════════════════════════
+ *  Blocks and edges
+ * ════════════════════════════════════════════════════════════════ */
+
+static int is_terminator(uint8_t op)
+{
+    return op == TAC_GOTO || op == TAC_IF_GT || op == TAC_IF_LT ||
+           op == TAC_IF_EQ || op == TAC_RET;
+}
+
+static void add_succ(CfgBlock *b, uint32_t s)
+{
+    if (b->n_succ == 1 && b->succ[0] == s) return;     /* if-target == fall-through */
+    b->succ[b->n_succ++] = s;
+}
+
+/* Reverse postorder of the blocks reachable from the entry */
+static int compute_rpo(Cfg *cfg)
+{
+    uint32_t  n     = cfg->n_blocks;
+    uint32_t *stack = malloc(n * sizeof(uint32_t));
+    uint8_t  *next  = calloc(n, 1);         /* next successor to visit, +1 once seen */
+    uint32_t *post  = malloc(n * sizeof(uint32_t));
+    uint32_t  sp = 0, n_post = 0;
+    if (!stack || !next || !post) { free(stack); free(next); free(post); return -1; }
+
+    stack[sp++] = cfg->entry;
+    next[cfg->entry] = 1;
+    while (sp) {
+        uint32_t  b  = stack[sp - 1];
+        CfgBlock *bb = &cfg->blocks[b];
+        if (next[b] - 1u < bb->n_succ) {
+            uint32_t s = bb->succ[next[b]++ - 1];
+            if (!next[s]) { next[s] = 1; stack[sp++] = s; }
+        } else {
+            post[n_post++] = b;
+            sp--;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) cfg->blocks[i].rpo = CFG_NONE;
+    for (uint32_t i = 0; i < n_post; i++) {
+        uint32_t b = post[n_post - 1 - i];
+        cfg->order[i] = b;
+        cfg->blocks[b].rpo = i;
+    }
+    cfg->n_reachable = n_post;
+    free(stack);
+    free(next);
+    free(post);
+    return 0;
+}
+
+int cfg_build(Cfg *cfg, const TacProgram *p)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    uint8_t *leader = calloc(p->count + 1, 1);
+    if (!leader) return -1;
+
+    /* Leaders: the first instruction, every label, every instruction
+     * after a terminator */
+    uint32_t n = 2;                 /* entry + exit */
+    for (uint32_t i = 0; i < p->count; i++) {
+        if (i == 0 || p->code[i].op == TAC_LABEL) leader[i] = 1;
+        if (is_terminator(p->code[i].op))         leader[i + 1] = 1;
+    }
+    for (uint32_t i = 0; i < p->count; i++) n += leader[i];
+
+    cfg->n_blocks    = n;
+    cfg->entry       = 0;
+    cfg->exit        = n - 1;
+    cfg->blocks      = calloc(n, sizeof(CfgBlock));
+    cfg->label_block = malloc((p->n_labels ? p->n_labels : 1) * sizeof(uint32_t));
+    cfg->order       = malloc(n * sizeof(uint32_t));
+    if (!cfg->blocks || !cfg->label_block || !cfg->order) goto oom;
+
+    for (uint32_t l = 0; l < p->n_labels; l++) cfg->label_block[l] = cfg->exit;  /* undefined label */
+
+    uint32_t b = 0;
+    for (uint32_t i = 0; i < p->count; i++) {
+        if (leader[i]) {
+            if (b) cfg->blocks[b].end = i;
+            cfg->blocks[++b].first = i;
+        }
+        if (p->code[i].op == TAC_LABEL) cfg->label_block[OPND_INDEX(p->code[i].dst)] = b;
+    }
+    if (b) cfg->blocks[b].end = p->count;
+    cfg->blocks[cfg->exit].first = cfg->blocks[cfg->exit].end = p->count;
+    free(leader);
+    leader = NULL;
+
+    /* Successors */
+    add_succ(&cfg->blocks[0], 1);
+    for (b = 1; b < cfg->exit; b++) {
+        CfgBlock       *bb   = &cfg->blocks[b];
+        const TacInstr *last = &p->code[bb->end - 1];
+        switch (last->op) {
+            case TAC_RET:
+                break;
+            case TAC_GOTO:
+                add_succ(bb, cfg->label_block[OPND_INDEX(last->dst)]);
+                break;
+            case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ:
+                add_succ(bb, b + 1);
+                add_succ(bb, cfg->label_block[OPND_INDEX(last->dst)]);
+                break;
+            default:
+                add_succ(bb, b + 1);
+                break;
+        }
+    }
+
+    /* Predecessors, as one array partitioned per block */
+    uint32_t n_edges = 0;
+    for (b = 0; b < n; b++)
+        for (uint32_t k = 0; k < cfg->blocks[b].n_succ; k++) {
+            cfg->blocks[cfg->blocks[b].succ[k]].n_preds++;
+            n_edges++;
+        }
+    cfg->preds = malloc((n_edges ? n_edges : 1) * sizeof(uint32_t));
+    if (!cfg->preds) goto oom;
+    for (uint32_t at = 0, i = 0; i < n; i++) {
+        cfg->blocks[i].pred_first = at;
+        at += cfg->blocks[i].n_preds;
+        cfg->blocks[i].n_preds = 0;
+    }
+    for (b = 0; b < n; b++)
+        for (uint32_t k = 0; k < cfg->blocks[b].n_succ; k++) {
+            CfgBlock *s = &cfg->blocks[cfg->blocks[b].succ[k]];
+            cfg->preds[s->pred_first + s->n_preds++] = b;
+        }
+
+    if (compute_rpo(cfg) != 0) goto oom;
+    return 0;
+
+oom:
+    free(leader);
+    cfg_free(cfg);
+    return -1;
+}
+
+void cfg_free(Cfg *cfg)
+{
+    free(cfg->blocks);
+    free(cfg->preds);
+    free(cfg->label_block);
+    free(cfg->order);
+    free(cfg->dom_first);
+    free(cfg->dom_kids);
+    free(cfg->df_first);
+    free(cfg->df);
+    memset(cfg, 0, sizeof(*cfg));
+}
+
+uint32_t cfg_pred_index(const Cfg *cfg, uint32_t s, uint32_t p)
+{
+    const CfgBlock *sb = &cfg->blocks[s];
+    for (uint32_t j = 0; j < sb->n_preds; j++)
+        if (cfg->preds[sb->pred_first + j] == p) return j;
+    return CFG_NONE;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Dominators (Cooper, Harvey & Kennedy)
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Walk the two fingers up the partial tree until they meet */
+static uint32_t intersect(const Cfg *cfg, uint32_t a, uint32_t b)
+{
+    while (a != b) {
+        while (cfg->blocks[a].rpo > cfg->blocks[b].rpo) a = cfg->blocks[a].idom;
+        while (cfg->blocks[b].rpo > cfg->blocks[a].rpo) b = cfg->blocks[b].idom;
+    }
+    return a;
+}
+
+int cfg_dominators(Cfg *cfg)
+{
+    CfgBlock *bl = cfg->blocks;
+    for (uint32_t i = 0; i < cfg->n_blocks; i++) bl[i].idom = CFG_NONE;
+    bl[cfg->entry].idom = cfg->entry;
+
+    for (int changed = 1; changed; ) {
+        changed = 0;
+        for (uint32_t k = 1; k < cfg->n_reachable; k++) {
+            uint32_t b        = cfg->order[k];
+            uint32_t new_idom = CFG_NONE;
+            for (uint32_t j = 0; j < bl[b].n_preds; j++) {
+                uint32_t p = cfg->preds[bl[b].pred_first + j];
+                if (bl[p].idom == CFG_NONE) continue;       /* not processed yet */
+                new_idom = new_idom == CFG_NONE ? p : intersect(cfg, p, new_idom);
+            }
+            if (bl[b].idom != new_idom) {
+                bl[b].idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    /* Dominator tree as CSR child lists, then preorder intervals */
+    free(cfg->dom_first);
+    free(cfg->dom_kids);
+    cfg->dom_first = calloc(cfg->n_blocks + 1, sizeof(uint32_t));
+    cfg->dom_kids  = malloc((cfg->n_reachable ? cfg->n_reachable : 1) * sizeof(uint32_t));
+    uint32_t *stack = malloc((cfg->n_reachable + 1) * sizeof(uint32_t));
+    if (!cfg->dom_first || !cfg->dom_kids || !stack) { free(stack); return -1; }
+
+    for (uint32_t k = 1; k < cfg->n_reachable; k++)
+        cfg->dom_first[bl[cfg->order[k]].idom + 1]++;
+    for (uint32_t i = 0; i < cfg->n_blocks; i++)
+        cfg->dom_first[i + 1] += cfg->dom_first[i];
+    for (uint32_t k = 1; k < cfg->n_reachable; k++) {       /* RPO keeps kids in order */
+        uint32_t b = cfg->order[k];
+        cfg->dom_kids[cfg->dom_first[bl[b].idom]++] = b;
+    }
+    for (uint32_t i = cfg->n_blocks; i > 0; i--) cfg->dom_first[i] = cfg->dom_first[i - 1];
+    cfg->dom_first[0] = 0;
+
+    /* Iterative preorder: a block's post number is the largest pre
+     * number in its subtree, so a dominates b iff pre(a) <= pre(b) <= post(a) */
+    uint32_t sp = 0, clock = 0;
+    stack[sp++] = cfg->entry;
+    while (sp) {
+        uint32_t b = stack[--sp];
+        bl[b].dom_pre = clock++;
+        for (uint32_t k = cfg->dom_first[b + 1]; k > cfg->dom_first[b]; k--)
+            stack[sp++] = cfg->dom_kids[k - 1];
+    }
+    for (uint32_t k = cfg->n_reachable; k > 0; k--) {        /* children before parents */
+        uint32_t b = cfg->order[k - 1];
+        uint32_t post = bl[b].dom_pre;
+        for (uint32_t j = cfg->dom_first[b]; j < cfg->dom_first[b + 1]; j++)
+            if (bl[cfg->dom_kids[j]].dom_post > post) post = bl[cfg->dom_kids[j]].dom_post;
+        bl[b].dom_post = post;
+    }
+    free(stack);
+    return 0;
+}
+
+int cfg_dominates(const Cfg *cfg, uint32_t a, uint32_t b)
+{
+    const CfgBlock *x = &cfg->blocks[a], *y = &cfg->blocks[b];
+    return x->dom_pre <= y->dom_pre && y->dom_pre <= x->dom_post;
+}
+
+/* DF(n) = blocks where n's dominance stops: for each join b and each
+ * predecessor p, every block from p up to (not including) idom(b) */
+int cfg_dominance_frontiers(Cfg *cfg)
+{
+    CfgBlock *bl    = cfg->blocks;
+    uint32_t *count = calloc(cfg->n_blocks + 1, sizeof(uint32_t));
+    uint32_t *last  = malloc(cfg->n_blocks * sizeof(uint32_t));
+    if (!count || !last) { free(count); free(last); return -1; }
+
+    /* Two rounds over the same walk: count, then fill */
+    for (int fill = 0; fill < 2; fill++) {
+        for (uint32_t i = 0; i < cfg->n_blocks; i++) last[i] = CFG_NONE;
+        for (uint32_t k = 0; k < cfg->n_reachable; k++) {
+            uint32_t b = cfg->order[k];
+            if (bl[b].n_preds < 2) continue;
+            for (uint32_t j = 0; j < bl[b].n_preds; j++) {
+                uint32_t runner = cfg->preds[bl[b].pred_first + j];
+                if (bl[runner].rpo == CFG_NONE) continue;
+                while (runner != bl[b].idom && last[runner] != b) {
+                    last[runner] = b;
+                    if (fill) cfg->df[count[runner]++] = b;
+                    else      count[runner + 1]++;
+                    runner = bl[runner].idom;
+                }
+            }
+        }
+        if (!fill) {
+            for (uint32_t i = 0; i < cfg->n_blocks; i++) count[i + 1] += count[i];
+            free(cfg->df);
+            cfg->df = malloc((count[cfg->n_blocks] ? count[cfg->n_blocks] : 1) * sizeof(uint32_t));
+            free(cfg->df_first);
+            cfg->df_first = malloc((cfg->n_blocks + 1) * sizeof(uint32_t));
+            if (!cfg->df || !cfg->df_first) { free(count); free(last); return -1; }
+            memcpy(cfg->df_first, count, (cfg->n_blocks + 1) * sizeof(uint32_t));
+        }
+    }
+    free(count);
+    free(last);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Printing
+ * ════════════════════════════════════════════════════════════════ */
+
+void print_cfg(const Cfg *cfg)
+{
+    for (uint32_t b = 0; b < cfg->n_blocks; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        printf("    B%-3u", b);
+        if (b == cfg->entry)     printf(" entry      ");
+        else if (b == cfg->exit) printf(" exit       ");
+        else                     printf(" [%3u,%3u)  ", bb->first, bb->end);
+        printf("succ:");
+        for (uint32_t k = 0; k < bb->n_succ; k++) printf(" B%u", bb->succ[k]);
+        printf("%*s", (int)(2 - bb->n_succ) * 4 + 2, "");
+        if (bb->rpo == CFG_NONE) {
+            printf("unreachable\n");
+            continue;
+        }
+        printf("idom: ");
+        if (b == cfg->entry) printf("-  ");
+        else                 printf("B%-2u", bb->idom);
+        if (cfg->df) {
+            printf("  DF: {");
+            for (uint32_t k = cfg->df_first[b]; k < cfg->df_first[b + 1]; k++)
+                printf("%sB%u", k == cfg->df_first[b] ? "" : " ", cfg->df[k]);
+            printf("}");
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Chapter 21 — Control-flow graph and dominators over TAC
+ *
+ * Splits a TacProgram into basic blocks at TAC_LABEL (a block starts
+ * there) and after TAC_GOTO / TAC_IF_* / TAC_RET (a block ends there),
+ * links them into a CFG, and computes the dominator tree and dominance
+ * frontiers with the Cooper–Harvey–Kennedy algorithms ("A Simple, Fast
+ * Dominance Algorithm"): iterate idom over reverse postorder until it
+ * settles, intersecting by walking up the partial tree.
+ *
+ *   block 0           empty entry, falls through to the first block
+ *   blocks 1 .. n-2   the program's instructions, in layout order
+ *   block n-1         empty exit: falling off the end of the code
+ *
+ * The synthetic entry has no predecessors even when the first label is
+ * a loop header, and the synthetic exit gives every fall-through a
+ * target, so only exit and TAC_RET blocks have no successors.
+ *
+ * Successor order: for TAC_IF_* blocks succ[0] is the fall-through and
+ * succ[1] the branch target (merged into one edge when they coincide).
+ */
+
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdint.h>
+
+#include "tac.h"
+
+#define CFG_NONE UINT32_MAX
+
+typedef struct {
+    uint32_t first;         /* TAC instructions [first, end)          */
+    uint32_t end;
+    uint32_t succ[2];
+    uint32_t n_succ;
+    uint32_t pred_first;    /* preds[pred_first .. + n_preds)          */
+    uint32_t n_preds;
+    uint32_t idom;          /* CFG_NONE if unreachable; entry: itself  */
+    uint32_t rpo;           /* index in order[], CFG_NONE if unreachable */
+    uint32_t dom_pre;       /* dominator-tree preorder interval,       */
+    uint32_t dom_post;      /*   for O(1) cfg_dominates()              */
+} CfgBlock;
+
+typedef struct {
+    CfgBlock *blocks;
+    uint32_t  n_blocks;
+    uint32_t  entry;        /* always 0            */
+    uint32_t  exit;         /* always n_blocks - 1 */
+    uint32_t *preds;        /* predecessor lists, ascending in each block */
+    uint32_t *label_block;  /* TAC label index → block                    */
+    uint32_t *order;        /* reachable blocks in reverse postorder      */
+    uint32_t  n_reachable;
+    uint32_t *dom_first;    /* dominator-tree children, CSR: n_blocks + 1 */
+    uint32_t *dom_kids;
+    uint32_t *df_first;     /* dominance frontiers, CSR: n_blocks + 1     */
+    uint32_t *df;           /* NULL until cfg_dominance_frontiers()       */
+} Cfg;
+
+/* Blocks, edges and reverse postorder.  0 on success, -1 on OOM. */
+int  cfg_build(Cfg *cfg, const TacProgram *p);
+/* idom[] and the dominator tree (needs cfg_build) */
+int  cfg_dominators(Cfg *cfg);
+/* DF sets (needs cfg_dominators) */
+int  cfg_dominance_frontiers(Cfg *cfg);
+void cfg_free(Cfg *cfg);
+
+/* Does a dominate b?  Both must be reachable. */
+int      cfg_dominates(const Cfg *cfg, uint32_t a, uint32_t b);
+/* Position of p in s's predecessor list — the edge p→s — or CFG_NONE */
+uint32_t cfg_pred_index(const Cfg *cfg, uint32_t s, uint32_t p);
+
+void print_cfg(const Cfg *cfg);
+
+#endif /* CFG_H */
@@ -2,12 +2,27 @@
  * ║  Chapter 21 — Intermediate Representation (IR)                  ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: Three-address code, SSA, GIMPLE, LLVM IR               ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Section 2 runs the compact TAC in tac.c: expressions parsed by the
+ * chapter 19 front-end are lowered to it, printed and executed.
+ * Section 3 takes it into SSA and back (cfg.c, ssa.c), optimising on
+ * the way.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/21_intermediate_repr \
+ *            src/21_intermediate_repr/intermediate_repr.c \
+ *            src/21_intermediate_repr/tac.c src/21_intermediate_repr/cfg.c \
+ *            src/21_intermediate_repr/ssa.c src/19_parsing_ast/expr.c
+ * Run:   ./bin/21_intermediate_repr
+ */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "ssa.h"
+#include "tac.h"
+
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — What Is Intermediate Representation?
  * ════════════════════════════════════════════════════════════════════ */
@@ -44,55 +59,43 @@ static void demo_what_is_ir(void)
  *  Section 2 — Three-Address Code
  * ════════════════════════════════════════════════════════════════════ */
 
-/* A simple three-address instruction */
-typedef enum { TAC_ADD, TAC_SUB, TAC_MUL, TAC_DIV, TAC_NEG,
-               TAC_ASSIGN, TAC_LABEL, TAC_GOTO,
-               TAC_IF_GT, TAC_IF_LT, TAC_IF_EQ } TacOp;
-
+/* The original string-operand layout, kept for the size comparison */
 typedef struct {
-    TacOp   op;
+    int     op;
     char    result[16];
     char    arg1[16];
     char    arg2[16];
-} TacInstr;
+} StringTacInstr;
+
+/* Parse src, giving its identifiers slots in vars */
+static ASTNode *parse_with_vars(const char *src, ExprVars *vars)
+{
+    Parser p;
+    parser_init(&p, src);
+    parser_set_vars(&p, vars);
+    return parse_expr(&p);
+}
 
-static void print_tac(const TacInstr *instr)
+/* Random expression over a, b, c, d: + - * only, and / by a nonzero
+ * literal, shallow enough that eval_ast_env() cannot overflow */
+static int random_expr(char *buf, int depth, unsigned *seed)
 {
-    switch (instr->op) {
-    case TAC_ADD:
-        printf("    %s = %s + %s\n", instr->result, instr->arg1, instr->arg2);
-        break;
-    case TAC_SUB:
-        printf("    %s = %s - %s\n", instr->result, instr->arg1, instr->arg2);
-        break;
-    case TAC_MUL:
-        printf("    %s = %s * %s\n", instr->result, instr->arg1, instr->arg2);
-        break;
-    case TAC_DIV:
-        printf("    %s = %s / %s\n", instr->result, instr->arg1, instr->arg2);
-        break;
-    case TAC_NEG:
-        printf("    %s = -%s\n", instr->result, instr->arg1);
-        break;
-    case TAC_ASSIGN:
-        printf("    %s = %s\n", instr->result, instr->arg1);
-        break;
-    case TAC_LABEL:
-        printf("  %s:\n", instr->result);
-        break;
-    case TAC_GOTO:
-        printf("    goto %s\n", instr->result);
-        break;
-    case TAC_IF_GT:
-        printf("    if %s > %s goto %s\n", instr->arg1, instr->arg2, instr->result);
-        break;
-    case TAC_IF_LT:
-        printf("    if %s < %s goto %s\n", instr->arg1, instr->arg2, instr->result);
-        break;
-    case TAC_IF_EQ:
-        printf("    if %s == %s goto %s\n", instr->arg1, instr->arg2, instr->result);
-        break;
+    *seed = *seed * 1103515245u + 12345u;
+    unsigned r = *seed >> 16;
+    if (depth == 0 || r % 4 == 0) {
+        if (r & 1) return sprintf(buf, "%c", "abcd"[(r >> 1) % 4]);
+        return sprintf(buf, "%u", (r >> 1) % 10);
+    }
+    if (r % 9 == 1) {
+        buf[0] = '-';
+        return 1 + random_expr(buf + 1, depth - 1, seed);
     }
+    int n = sprintf(buf, "(");
+    n += random_expr(buf + n, depth - 1, seed);
+    if (r % 7 == 2) return n + sprintf(buf + n, " / %u)", 1 + (r >> 4) % 9);
+    n += sprintf(buf + n, " %c ", "+-*"[(r >> 4) % 3]);
+    n += random_expr(buf + n, depth - 1, seed);
+    return n + sprintf(buf + n, ")");
 }
 
 static void demo_three_address_code(void)
@@ -104,59 +107,174 @@ static void demo_three_address_code(void)
     printf("Three-address code (TAC) uses at most three operands per instruction:\n");
     printf("    result = arg1  OP  arg2\n\n");
 
-    /* Example 1: a = b + c * d */
+    printf("Our TAC (tac.h) packs each instruction into %zu bytes: an opcode\n",
+           sizeof(TacInstr));
+    printf("and three 32-bit operands, each a 3-bit tag (temp, var, const,\n");
+    printf("label) over a 29-bit table index.  Spelling the operands out as\n");
+    printf("char[16] strings takes %zu bytes per instruction and a strcmp\n",
+           sizeof(StringTacInstr));
+    printf("for every operand comparison.\n\n");
+
+    /* Example 1: lowered from a real chapter 19 AST */
     printf("── Example 1: a = b + c * d ──────────────────────────────\n\n");
     printf("  Source C:   a = b + c * d;\n\n");
-    printf("  Three-address code:\n");
-    TacInstr ex1[] = {
-        { TAC_MUL,    "t1", "c",  "d"  },
-        { TAC_ADD,    "t2", "b",  "t1" },
-        { TAC_ASSIGN, "a",  "t2", ""   },
-    };
-    for (int i = 0; i < 3; i++) print_tac(&ex1[i]);
+    printf("  Lowered from the chapter 19 AST (leaves become operands,\n");
+    printf("  each interior node one instruction into a fresh temporary):\n");
+
+    ExprVars   vars;
+    TacProgram ex1;
+    expr_vars_init(&vars);
+    tac_init(&ex1);
+    ASTNode *ast = parse_with_vars("b + c * d", &vars);
+    if (ast && tac_lower_assign(&ex1, "a", ast, &vars) == 0) {
+        print_tac(&ex1);
+        printf("\n  %u instructions in %zu bytes; %u temps, %u variables\n",
+               ex1.count, ex1.count * sizeof(TacInstr), ex1.n_temps, ex1.n_vars);
+        printf("  As encoded:\n");
+        for (uint32_t i = 0; i < ex1.count; i++)
+            printf("    op=%-2u dst=%08x a=%08x b=%08x\n", ex1.code[i].op,
+                   ex1.code[i].dst, ex1.code[i].a, ex1.code[i].b);
+    }
+    free_ast(ast);
+    tac_free(&ex1);
+
+    /* A hash-consed DAG shares the repeated subtree; lowering keeps it shared */
+    printf("\n  With the chapter 19 hash-consed DAG, a repeated subtree is\n");
+    printf("  lowered once:  r = (x - y) * (x - y) + (x - y)\n");
+    ExprDag dag;
+    Parser  dp;
+    expr_dag_init(&dag);
+    expr_vars_init(&vars);
+    tac_init(&ex1);
+    parser_init(&dp, "(x - y) * (x - y) + (x - y)");
+    parser_set_vars(&dp, &vars);
+    parser_set_dag(&dp, &dag);
+    ast = parse_expr(&dp);
+    if (ast && tac_lower_assign(&ex1, "r", ast, &vars) == 0) print_tac(&ex1);
+    tac_free(&ex1);
+    expr_dag_free(&dag);
 
     /* Example 2: if (x > 0) y = x; else y = -x; */
     printf("\n── Example 2: if (x > 0) y = x; else y = -x; ───────────\n\n");
     printf("  Source C:   if (x > 0) y = x; else y = -x;\n\n");
-    printf("  Three-address code:\n");
-    TacInstr ex2[] = {
-        { TAC_IF_GT,  "L_then", "x",  "0"  },
-        { TAC_GOTO,   "L_else", "",    ""   },
-        { TAC_LABEL,  "L_then", "",    ""   },
-        { TAC_ASSIGN, "y",      "x",   ""   },
-        { TAC_GOTO,   "L_end",  "",    ""   },
-        { TAC_LABEL,  "L_else", "",    ""   },
-        { TAC_NEG,    "t1",     "x",   ""   },
-        { TAC_ASSIGN, "y",      "t1",  ""   },
-        { TAC_LABEL,  "L_end",  "",    ""   },
-    };
-    for (int i = 0; i < 9; i++) print_tac(&ex2[i]);
-
-    /* Example 3: for (i = 0; i < n; i++) sum += arr[i]; */
+    printf("  Three-address code (control flow built with tac_emit()):\n");
+    TacProgram ex2;
+    tac_init(&ex2);
+    {
+        TacOperand x = tac_var(&ex2, "x", 1), y = tac_var(&ex2, "y", 1);
+        TacOperand l_then = tac_label(&ex2), l_else = tac_label(&ex2), l_end = tac_label(&ex2);
+        TacOperand t = tac_temp(&ex2), zero = tac_const(&ex2, 0);
+        tac_emit(&ex2, TAC_IF_GT,  l_then, x, zero);
+        tac_emit(&ex2, TAC_GOTO,   l_else, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_LABEL,  l_then, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_ASSIGN, y, x, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_GOTO,   l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_LABEL,  l_else, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_NEG,    t, x, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_ASSIGN, y, t, TAC_NO_OPERAND);
+        tac_emit(&ex2, TAC_LABEL,  l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        print_tac(&ex2);
+
+        int32_t env[2] = { -7, 0 };
+        tac_exec(&ex2, env, NULL);
+        printf("\n  tac_exec with x = -7  →  y = %d\n", env[1]);
+    }
+    tac_free(&ex2);
+
+    /* Example 3: for (i = 0; i < n; i++) sum += i * i; */
     printf("\n── Example 3: for-loop → goto-based IR ───────────────────\n\n");
-    printf("  Source C:   for (i = 0; i < n; i++) sum += arr[i];\n\n");
+    printf("  Source C:   for (i = 0; i < n; i++) sum += i * i;\n\n");
     printf("  Three-address code:\n");
-    TacInstr ex3[] = {
-        { TAC_ASSIGN, "i",    "0",    ""    },
-        { TAC_LABEL,  "L_top","",     ""    },
-        { TAC_IF_LT,  "L_body","i",   "n"  },
-        { TAC_GOTO,   "L_end","",     ""    },
-        { TAC_LABEL,  "L_body","",    ""    },
-        { TAC_MUL,    "t1",   "i",    "4"   },  /* offset = i*sizeof(int) */
-        { TAC_ADD,    "t2",   "arr",  "t1"  },  /* address = arr + offset */
-        { TAC_ASSIGN, "t3",   "*t2",  ""    },  /* t3 = arr[i] */
-        { TAC_ADD,    "sum",  "sum",  "t3"  },
-        { TAC_ADD,    "i",    "i",    "1"   },
-        { TAC_GOTO,   "L_top","",     ""    },
-        { TAC_LABEL,  "L_end","",     ""    },
-    };
-    for (int i = 0; i < 12; i++) print_tac(&ex3[i]);
-    printf("\n");
+    TacProgram ex3;
+    tac_init(&ex3);
+    {
+        TacOperand n = tac_var(&ex3, "n", 1), i = tac_var(&ex3, "i", 1);
+        TacOperand sum = tac_var(&ex3, "sum", 3);
+        TacOperand l_top = tac_label(&ex3), l_body = tac_label(&ex3), l_end = tac_label(&ex3);
+        TacOperand t1 = tac_temp(&ex3), zero = tac_const(&ex3, 0), one = tac_const(&ex3, 1);
+        tac_emit(&ex3, TAC_ASSIGN, i, zero, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_LABEL,  l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_IF_LT,  l_body, i, n);
+        tac_emit(&ex3, TAC_GOTO,   l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_LABEL,  l_body, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_MUL,    t1, i, i);
+        tac_emit(&ex3, TAC_ADD,    sum, sum, t1);
+        tac_emit(&ex3, TAC_ADD,    i, i, one);
+        tac_emit(&ex3, TAC_GOTO,   l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_LABEL,  l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex3, TAC_RET,    TAC_NO_OPERAND, sum, TAC_NO_OPERAND);
+        print_tac(&ex3);
+
+        int32_t env[3] = { 10, 0, 0 };
+        printf("\n  tac_exec with n = 10  →  returns %d\n", tac_exec(&ex3, env, NULL));
+    }
+    tac_free(&ex3);
+
+    /* Lowering must preserve meaning: compare against the AST evaluator */
+    printf("\n── Check: lowering vs eval_ast_env() ────────────────────\n\n");
+    unsigned seed = 21;
+    int      checked = 0, bad = 0;
+    size_t   instrs = 0;
+    char     src[512];
+    for (int k = 0; k < 2000; k++) {
+        random_expr(src, 3, &seed);
+        expr_vars_init(&vars);
+        ASTNode   *root = parse_with_vars(src, &vars);
+        TacProgram prog;
+        tac_init(&prog);
+        if (root && tac_lower_return(&prog, root, &vars) == 0) {
+            for (int row = 0; row < 8; row++) {
+                int     env[EXPR_MAX_VARS];
+                int32_t tenv[EXPR_MAX_VARS];
+                for (int v = 0; v < vars.count; v++) {
+                    seed = seed * 1103515245u + 12345u;
+                    env[v] = (int)((seed >> 16) % 19) - 9;
+                }
+                /* TAC numbers variables by first use, the parser by first appearance */
+                for (uint32_t v = 0; v < prog.n_vars; v++)
+                    tenv[v] = env[expr_vars_slot(&vars, prog.vars[v], (int)strlen(prog.vars[v]))];
+                bad += tac_exec(&prog, tenv, NULL) != eval_ast_env(root, env);
+                checked++;
+            }
+            instrs += prog.count;
+        }
+        tac_free(&prog);
+        free_ast(root);
+    }
+    printf("  2000 random expressions (%zu instructions), %d evaluations:\n", instrs, checked);
+    printf("  %d mismatches %s\n\n", bad, bad ? "✗" : "✓");
 }
 
 /* ════════════════════════════════════════════════════════════════════
  *  Section 3 — Static Single Assignment (SSA) Form
+ *
+ *  ssa.c builds real SSA from the TAC above: CFG, dominators and
+ *  dominance frontiers (cfg.c), φ placement and renaming, then sparse
+ *  conditional constant propagation, dead-code elimination and the way
+ *  back to TAC.  The result is checked by running both programs.
  * ════════════════════════════════════════════════════════════════════ */
+
+/* Run the original and the round trip on the same inputs; 1 if the
+ * return value and every variable agree */
+static int same_behaviour(const TacProgram *p, const TacProgram *q, unsigned *seed)
+{
+    int32_t in_p[8] = { 0 }, in_q[8] = { 0 };
+    for (uint32_t v = 0; v < p->n_vars && v < 8; v++) {
+        *seed = *seed * 1103515245u + 12345u;
+        in_p[v] = in_q[v] = (int32_t)((*seed >> 16) % 41) - 20;
+    }
+    if (tac_exec(p, in_p, NULL) != tac_exec(q, in_q, NULL)) return 0;
+    return memcmp(in_p, in_q, sizeof(in_p)) == 0;
+}
+
+/* Build, optimise and leave SSA; -1 on OOM */
+static int ssa_round_trip(const TacProgram *p, SsaFunc *f, TacProgram *out)
+{
+    if (ssa_build(f, p) != 0 || ssa_sccp(f) != 0 || ssa_dce(f) != 0) return -1;
+    tac_init(out);
+    return ssa_to_tac(f, out);
+}
+
 static void demo_ssa(void)
 {
     printf("\n╔══════════════════════════════════════════════════════════╗\n");
@@ -164,38 +282,138 @@ static void demo_ssa(void)
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
     printf("In SSA form, every variable is assigned exactly once.\n");
-    printf("When a variable could come from two paths, a phi-node merges them.\n\n");
-
-    printf("── Before SSA ─────────────────────────────────────────────\n");
-    printf("    x = 1\n");
-    printf("    x = x + 1      ← 'x' assigned twice\n");
-    printf("    y = x * 2\n\n");
-
-    printf("── After SSA ──────────────────────────────────────────────\n");
-    printf("    x1 = 1\n");
-    printf("    x2 = x1 + 1    ← each 'x' is unique\n");
-    printf("    y1 = x2 * 2\n\n");
-
-    printf("── Phi-node example ───────────────────────────────────────\n\n");
-    printf("  Source C:   if (cond) x = 1; else x = 2;\n");
-    printf("              y = x + 3;\n\n");
-    printf("  SSA form:\n");
-    printf("    if (cond) goto L_then\n");
-    printf("    goto L_else\n");
-    printf("  L_then:\n");
-    printf("    x1 = 1\n");
-    printf("    goto L_merge\n");
-    printf("  L_else:\n");
-    printf("    x2 = 2\n");
-    printf("    goto L_merge\n");
-    printf("  L_merge:\n");
-    printf("    x3 = phi(x1, x2)      ← phi picks based on predecessor\n");
-    printf("    y1 = x3 + 3\n\n");
+    printf("When a variable could come from two paths, a φ-node merges them:\n");
+    printf("x.3 = φ(x.1, x.2) takes x.1 when control arrives from the first\n");
+    printf("predecessor and x.2 from the second.\n\n");
+
+    /* k = 4; if (k > 2) x = a + k; else x = a * 3;
+     * s = 0; for (i = 0; i < 3; i++) s = s + x; return s; */
+    printf("── Example: a constant branch and a loop ─────────────────\n\n");
+    printf("  Source C:   k = 4;\n");
+    printf("              if (k > 2) x = a + k; else x = a * 3;\n");
+    printf("              for (s = 0, i = 0; i < 3; i++) s = s + x;\n");
+    printf("              return s;\n\n");
+    TacProgram ex;
+    tac_init(&ex);
+    {
+        TacOperand a = tac_var(&ex, "a", 1), k = tac_var(&ex, "k", 1), x = tac_var(&ex, "x", 1);
+        TacOperand s = tac_var(&ex, "s", 1), i = tac_var(&ex, "i", 1);
+        TacOperand l_then = tac_label(&ex), l_join = tac_label(&ex);
+        TacOperand l_top = tac_label(&ex), l_body = tac_label(&ex), l_end = tac_label(&ex);
+        TacOperand zero = tac_const(&ex, 0), one = tac_const(&ex, 1);
+        tac_emit(&ex, TAC_ASSIGN, k, tac_const(&ex, 4), TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_IF_GT,  l_then, k, tac_const(&ex, 2));
+        tac_emit(&ex, TAC_MUL,    x, a, tac_const(&ex, 3));
+        tac_emit(&ex, TAC_GOTO,   l_join, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_LABEL,  l_then, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_ADD,    x, a, k);
+        tac_emit(&ex, TAC_LABEL,  l_join, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_ASSIGN, s, zero, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_ASSIGN, i, zero, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_LABEL,  l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_IF_LT,  l_body, i, tac_const(&ex, 3));
+        tac_emit(&ex, TAC_GOTO,   l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_LABEL,  l_body, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_ADD,    s, s, x);
+        tac_emit(&ex, TAC_ADD,    i, i, one);
+        tac_emit(&ex, TAC_GOTO,   l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_LABEL,  l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&ex, TAC_RET,    TAC_NO_OPERAND, s, TAC_NO_OPERAND);
+    }
+    printf("  Three-address code:\n");
+    print_tac(&ex);
+
+    SsaFunc f;
+    if (ssa_build(&f, &ex) != 0) {
+        printf("  (out of memory)\n");
+        ssa_free(&f);
+        tac_free(&ex);
+        return;
+    }
+    printf("\n  Control-flow graph, Cooper–Harvey–Kennedy dominators and\n");
+    printf("  dominance frontiers (B0 and the last block are synthetic):\n");
+    print_cfg(&f.cfg);
+
+    printf("\n  SSA (a φ wherever two definitions of a live name meet):\n");
+    print_ssa(&f);
+
+    ssa_sccp(&f);
+    ssa_dce(&f);
+    printf("\n  After SCCP and DCE: k.1 = 4 decides the branch, so B2 never\n");
+    printf("  runs and x.3 = φ(x.2, x.1) is just x.1:\n");
+    print_ssa(&f);
+
+    TacProgram back;
+    tac_init(&back);
+    ssa_to_tac(&f, &back);
+    printf("\n  Back to TAC (every value under its own name again, φs gone):\n");
+    print_tac(&back);
+    {
+        int32_t e1[5] = { 5, 0, 0, 0, 0 }, e2[5] = { 5, 0, 0, 0, 0 };
+        int32_t r1 = tac_exec(&ex, e1, NULL), r2 = tac_exec(&back, e2, NULL);
+        printf("\n  tac_exec with a = 5:  original returns %d, optimised %d, "
+               "variables %s\n", r1, r2, memcmp(e1, e2, sizeof(e1)) == 0 ? "agree ✓" : "differ ✗");
+    }
+    tac_free(&back);
+    ssa_free(&f);
+    tac_free(&ex);
+
+    /* Every pass is linear or close to it: time them on growing programs */
+    printf("\n── Scaling: random branchy programs (tac_generate) ───────\n\n");
+    printf("  %8s %7s %8s │ %6s %6s %7s %6s │ %6s %6s %6s │ %7s │ %6s\n",   /* φ: 2 bytes */
+           "TAC", "blocks", "φs", "cfg", "dom+df", "φ", "rename",
+           "sccp", "dce", "out", "ns/inst", "after");
+    printf("  %8s %7s %7s │ %27s │ %20s │ %7s │\n", "", "", "", "ms", "ms", "");
+    unsigned vseed = 12;
+    int      checked = 0, bad = 0;
+    for (uint32_t n = 1000; n <= 256000; n *= 4) {
+        TacProgram p, out;
+        tac_init(&p);
+        if (tac_generate(&p, n, n) != 0 || ssa_round_trip(&p, &f, &out) != 0) {
+            printf("  (out of memory)\n");
+            ssa_free(&f);
+            tac_free(&p);
+            break;
+        }
+        const SsaStats *st = &f.stats;
+        double total = st->ms_cfg + st->ms_dom + st->ms_df + st->ms_phi + st->ms_rename +
+                       st->ms_sccp + st->ms_dce + st->ms_out;
+        printf("  %8u %7u %7u │ %6.2f %6.2f %6.2f %6.2f │ %6.2f %6.2f %6.2f │ %7.1f │ %6u\n",
+               st->tac_in, st->blocks, st->phis, st->ms_cfg, st->ms_dom + st->ms_df,
+               st->ms_phi, st->ms_rename, st->ms_sccp, st->ms_dce, st->ms_out,
+               total * 1e6 / st->tac_in, st->tac_out);
+        if (n == 256000) {
+            printf("\n  Largest program: SCCP proved %u values constant, decided %u of\n"
+                   "  the branches and found %u blocks (%u SSA instructions) that\n"
+                   "  never run; DCE removed %u more, leaving %u TAC instructions.\n",
+                   st->const_values, st->folded_branches, st->dead_blocks,
+                   st->unreachable, st->dead, st->tac_out);
+        }
+        for (int row = 0; row < 4; row++, checked++) bad += !same_behaviour(&p, &out, &vseed);
+        tac_free(&out);
+        ssa_free(&f);
+        tac_free(&p);
+    }
+
+    /* And on many small ones, where every corner gets exercised */
+    for (uint32_t k = 0; k < 500; k++) {
+        TacProgram p, out;
+        tac_init(&p);
+        if (tac_generate(&p, 20 + k % 200, 1000 + k) == 0 && ssa_round_trip(&p, &f, &out) == 0)
+            for (int row = 0; row < 4; row++, checked++) bad += !same_behaviour(&p, &out, &vseed);
+        tac_free(&out);
+        ssa_free(&f);
+        tac_free(&p);
+    }
+    printf("\n  Check: original vs optimised TAC on random inputs (the 5 above\n");
+    printf("  and 500 small programs), %d runs: %d mismatches %s\n\n",
+           checked, bad, bad ? "✗" : "✓");
 
     printf("Why SSA?\n");
     printf("  - Each use has exactly one reaching definition → simpler analysis.\n");
-    printf("  - Enables constant propagation, dead code elimination,\n");
-    printf("    and many other optimisations more efficiently.\n");
+    printf("  - Constant propagation, dead code elimination and many other\n");
+    printf("    optimisations become sparse: they follow def-use edges instead\n");
+    printf("    of iterating dataflow sets over every block.\n");
     printf("  - Used by both GCC (GIMPLE-SSA) and LLVM IR.\n\n");
 }
 
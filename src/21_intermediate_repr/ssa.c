@@ -0,0 +1,928 @@
+/*
+ * Chapter 21 — SSA construction, SCCP, DCE and out-of-SSA over TAC
+ *
+ * See ssa.h.  Every pass is iterative (worklists and explicit stacks),
+ * linear in the program apart from the φ placement, which is linear in
+ * the size of the dominance frontiers it visits.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ssa.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/bench.h"
+
+static double ms_since(uint64_t t0)
+{
+    return (double)(bench_now_ns() - t0) / 1e6;
+}
+
+static int is_name(TacOperand o)
+{
+    return OPND_TAG(o) == OPND_VAR || OPND_TAG(o) == OPND_TEMP;
+}
+
+static uint32_t name_of(const TacProgram *p, TacOperand o)
+{
+    return OPND_TAG(o) == OPND_VAR ? OPND_INDEX(o) : p->n_vars + OPND_INDEX(o);
+}
+
+static TacOperand operand_of_name(const TacProgram *p, uint32_t n)
+{
+    return n < p->n_vars ? OPND(OPND_VAR, n) : OPND(OPND_TEMP, n - p->n_vars);
+}
+
+static int defines(uint8_t op)   { return tac_writes_dst(op); }
+static int uses_a(uint8_t op)    { return op != TAC_LABEL && op != TAC_GOTO && op != SSA_PHI; }
+static int uses_b(uint8_t op)    { return op != SSA_PHI && tac_reads_b(op); }
+static int is_branch(uint8_t op) { return tac_is_branch(op); }
+
+/* ════════════════════════════════════════════════════════════════
+ *  Construction: φ placement
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint32_t block;
+    uint32_t name;
+} PhiSite;
+
+/* (block, name) pairs needing a φ, unsorted; *n_out entries */
+static PhiSite *place_phis(const SsaFunc *f, uint32_t *n_out)
+{
+    const TacProgram *p   = f->src;
+    const Cfg        *cfg = &f->cfg;
+    uint32_t n_names = f->n_names, n_blocks = cfg->n_blocks;
+
+    uint32_t *stamp    = malloc((n_names ? n_names : 1) * sizeof(uint32_t));
+    uint8_t  *global   = calloc(n_names ? n_names : 1, 1);
+    uint32_t *ds_first = calloc(n_names + 1, sizeof(uint32_t));
+    uint32_t *ds       = NULL;
+    uint32_t *work     = malloc(n_blocks * sizeof(uint32_t));
+    uint32_t *has_phi  = malloc(n_blocks * sizeof(uint32_t));
+    uint32_t *in_work  = malloc(n_blocks * sizeof(uint32_t));
+    PhiSite  *sites    = NULL;
+    uint32_t  n_sites  = 0, cap_sites = 0;
+    int       ok       = 0;
+
+    if (!stamp || !global || !ds_first || !work || !has_phi || !in_work) goto out;
+
+    /* Globals (used before defined in some block) and def sites, in
+     * two rounds: count, then fill */
+    for (int fill = 0; fill < 2; fill++) {
+        for (uint32_t n = 0; n < n_names; n++) stamp[n] = CFG_NONE;
+        for (uint32_t b = 1; b < cfg->exit; b++) {
+            const CfgBlock *bb = &cfg->blocks[b];
+            if (bb->rpo == CFG_NONE) continue;
+            for (uint32_t i = bb->first; i < bb->end; i++) {
+                const TacInstr *in = &p->code[i];
+                if (!fill) {
+                    if (uses_a(in->op) && is_name(in->a) && stamp[name_of(p, in->a)] != b)
+                        global[name_of(p, in->a)] = 1;
+                    if (uses_b(in->op) && is_name(in->b) && stamp[name_of(p, in->b)] != b)
+                        global[name_of(p, in->b)] = 1;
+                }
+                if (!defines(in->op) || !is_name(in->dst)) continue;
+                uint32_t n = name_of(p, in->dst);
+                if (stamp[n] == b) continue;
+                stamp[n] = b;
+                if (fill) ds[ds_first[n]++] = b;
+                else      ds_first[n + 1]++;
+            }
+        }
+        if (!fill) {
+            for (uint32_t n = 0; n < n_names; n++) ds_first[n + 1] += ds_first[n];
+            ds = malloc((ds_first[n_names] ? ds_first[n_names] : 1) * sizeof(uint32_t));
+            if (!ds) goto out;
+        }
+    }
+    for (uint32_t n = n_names; n > 0; n--) ds_first[n] = ds_first[n - 1];     /* undo the fill cursor */
+    ds_first[0] = 0;
+    for (uint32_t v = 0; v < p->n_vars; v++) global[v] = 1;     /* outputs: used at the exits */
+
+    /* Iterated dominance frontier of each global name's def sites */
+    for (uint32_t b = 0; b < n_blocks; b++) has_phi[b] = in_work[b] = CFG_NONE;
+    for (uint32_t n = 0; n < n_names; n++) {
+        if (!global[n]) continue;
+        uint32_t sp = 0;
+        for (uint32_t k = ds_first[n]; k < ds_first[n + 1]; k++) {
+            work[sp++] = ds[k];
+            in_work[ds[k]] = n;
+        }
+        while (sp) {
+            uint32_t d = work[--sp];
+            for (uint32_t k = cfg->df_first[d]; k < cfg->df_first[d + 1]; k++) {
+                uint32_t y = cfg->df[k];
+                if (has_phi[y] == n) continue;
+                has_phi[y] = n;
+                if (n_sites == cap_sites) {
+                    uint32_t c = cap_sites ? cap_sites * 2 : 256;
+                    PhiSite *s = realloc(sites, c * sizeof(*s));
+                    if (!s) goto out;
+                    sites = s;
+                    cap_sites = c;
+                }
+                sites[n_sites++] = (PhiSite){ y, n };
+                if (in_work[y] != n) {
+                    in_work[y] = n;
+                    work[sp++] = y;
+                }
+            }
+        }
+    }
+    ok = 1;
+
+out:
+    free(stamp);
+    free(global);
+    free(ds_first);
+    free(ds);
+    free(work);
+    free(has_phi);
+    free(in_work);
+    if (!ok) { free(sites); return NULL; }
+    *n_out = n_sites;
+    return sites ? sites : malloc(1);
+}
+
+/* Lay the blocks out in order: each block's φs, then its instructions
+ * minus labels.  Unreachable blocks are left empty. */
+static int layout(SsaFunc *f, const PhiSite *sites, uint32_t n_sites)
+{
+    const TacProgram *p   = f->src;
+    const Cfg        *cfg = &f->cfg;
+    uint32_t n_blocks = cfg->n_blocks;
+
+    f->block_first = calloc(n_blocks + 1, sizeof(uint32_t));
+    uint32_t *phi_first = calloc(n_blocks + 1, sizeof(uint32_t));
+    uint32_t *by_block  = malloc((n_sites ? n_sites : 1) * sizeof(uint32_t));
+    if (!f->block_first || !phi_first || !by_block) { free(phi_first); free(by_block); return -1; }
+
+    /* Counting sort of the φ sites by block */
+    for (uint32_t k = 0; k < n_sites; k++) phi_first[sites[k].block + 1]++;
+    for (uint32_t b = 0; b < n_blocks; b++) phi_first[b + 1] += phi_first[b];
+    for (uint32_t k = 0; k < n_sites; k++) by_block[phi_first[sites[k].block]++] = sites[k].name;
+    for (uint32_t b = n_blocks; b > 0; b--) phi_first[b] = phi_first[b - 1];
+    phi_first[0] = 0;
+
+    uint32_t total = 0, n_args = 0, n_defs = 0;
+    for (uint32_t b = 0; b < n_blocks; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        f->block_first[b] = total;
+        if (bb->rpo == CFG_NONE) continue;
+        uint32_t phis = phi_first[b + 1] - phi_first[b];
+        total  += phis;
+        n_args += phis * bb->n_preds;
+        for (uint32_t i = bb->first; i < bb->end; i++) {
+            total  += p->code[i].op != TAC_LABEL;
+            n_defs += defines(p->code[i].op);
+        }
+    }
+    f->block_first[n_blocks] = total;
+
+    f->code     = malloc((total ? total : 1) * sizeof(SsaInstr));
+    f->phi_args = malloc((n_args ? n_args : 1) * sizeof(TacOperand));
+    f->values   = malloc((f->n_names + n_sites + n_defs + 1) * sizeof(SsaValue));
+    if (!f->code || !f->phi_args || !f->values) { free(phi_first); free(by_block); return -1; }
+
+    uint32_t at = 0;
+    for (uint32_t b = 0; b < n_blocks; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        if (bb->rpo == CFG_NONE) continue;
+        for (uint32_t k = phi_first[b]; k < phi_first[b + 1]; k++) {
+            TacOperand name = operand_of_name(p, by_block[k]);
+            f->code[at++] = (SsaInstr){ SSA_PHI, 1, 0, b, name, f->n_phi_args, name };
+            for (uint32_t j = 0; j < bb->n_preds; j++)      /* until renamed: entry value */
+                f->phi_args[f->n_phi_args++] = OPND(OPND_TEMP, by_block[k]);
+        }
+        for (uint32_t i = bb->first; i < bb->end; i++) {
+            const TacInstr *in = &p->code[i];
+            if (in->op == TAC_LABEL) continue;
+            f->code[at++] = (SsaInstr){ in->op, 1, 0, b, in->dst, in->a, in->b };
+        }
+    }
+    f->count = total;
+    f->stats.phis = n_sites;
+    f->stats.ssa_instrs = total;
+    free(phi_first);
+    free(by_block);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Construction: renaming
+ * ════════════════════════════════════════════════════════════════ */
+
+#define LEAVE 0x80000000u
+
+static uint32_t new_value(SsaFunc *f, uint32_t *ver, uint32_t name, uint32_t def)
+{
+    SsaValue *v = &f->values[f->n_values];
+    v->name    = name;
+    v->version = ++ver[name];
+    v->def     = def;
+    return f->n_values++;
+}
+
+static int rename_values(SsaFunc *f)
+{
+    const TacProgram *p   = f->src;
+    const Cfg        *cfg = &f->cfg;
+    uint32_t n_names = f->n_names;
+
+    uint32_t *cur   = malloc((n_names ? n_names : 1) * sizeof(uint32_t));
+    uint32_t *ver   = calloc(n_names ? n_names : 1, sizeof(uint32_t));
+    uint32_t *log_n = malloc((f->count ? f->count : 1) * sizeof(uint32_t));   /* undo log */
+    uint32_t *log_v = malloc((f->count ? f->count : 1) * sizeof(uint32_t));
+    uint32_t *mark  = malloc(cfg->n_blocks * sizeof(uint32_t));
+    uint32_t *stack = malloc((2 * cfg->n_reachable + 1) * sizeof(uint32_t));
+    f->exit_first   = malloc(cfg->n_blocks * sizeof(uint32_t));
+    int rc = -1;
+
+    uint32_t n_exits = 0;
+    for (uint32_t b = 0; b < cfg->n_blocks; b++)
+        n_exits += cfg->blocks[b].rpo != CFG_NONE && cfg->blocks[b].n_succ == 0;
+    f->exit_vals = malloc((n_exits * p->n_vars + 1) * sizeof(uint32_t));
+    if (!cur || !ver || !log_n || !log_v || !mark || !stack || !f->exit_first || !f->exit_vals)
+        goto out;
+
+    /* Entry values: value number = name number */
+    for (uint32_t n = 0; n < n_names; n++) {
+        f->values[n] = (SsaValue){ n, 0, SSA_ENTRY };
+        cur[n] = n;
+    }
+    f->n_values = n_names;
+    for (uint32_t b = 0; b < cfg->n_blocks; b++) f->exit_first[b] = SSA_ENTRY;
+
+    uint32_t sp = 0, n_log = 0, n_exit_vals = 0;
+    stack[sp++] = cfg->entry;
+    while (sp) {
+        uint32_t b = stack[--sp];
+        if (b & LEAVE) {                        /* pop this block's definitions */
+            for (uint32_t stop = mark[b & ~LEAVE]; n_log > stop; n_log--)
+                cur[log_n[n_log - 1]] = log_v[n_log - 1];
+            continue;
+        }
+        mark[b] = n_log;
+        stack[sp++] = b | LEAVE;
+
+        for (uint32_t i = f->block_first[b]; i < f->block_first[b + 1]; i++) {
+            SsaInstr *in = &f->code[i];
+            if (in->op != SSA_PHI) {
+                if (uses_a(in->op) && is_name(in->a)) in->a = OPND(OPND_TEMP, cur[name_of(p, in->a)]);
+                if (uses_b(in->op) && is_name(in->b)) in->b = OPND(OPND_TEMP, cur[name_of(p, in->b)]);
+            }
+            if (in->op == SSA_PHI || (defines(in->op) && is_name(in->dst))) {
+                uint32_t n = name_of(p, in->op == SSA_PHI ? in->b : in->dst);
+                uint32_t v = new_value(f, ver, n, i);
+                log_n[n_log]   = n;
+                log_v[n_log++] = cur[n];
+                cur[n]  = v;
+                in->dst = OPND(OPND_TEMP, v);
+            }
+        }
+
+        const CfgBlock *bb = &cfg->blocks[b];
+        for (uint32_t k = 0; k < bb->n_succ; k++) {
+            uint32_t s = bb->succ[k];
+            uint32_t j = cfg_pred_index(cfg, s, b);
+            for (uint32_t i = f->block_first[s]; i < f->block_first[s + 1] && f->code[i].op == SSA_PHI; i++)
+                f->phi_args[f->code[i].a + j] = OPND(OPND_TEMP, cur[name_of(p, f->code[i].b)]);
+        }
+        if (bb->n_succ == 0) {
+            f->exit_first[b] = n_exit_vals;
+            for (uint32_t v = 0; v < p->n_vars; v++) f->exit_vals[n_exit_vals++] = cur[v];
+        }
+
+        for (uint32_t k = cfg->dom_first[b + 1]; k > cfg->dom_first[b]; k--)
+            stack[sp++] = cfg->dom_kids[k - 1];
+    }
+    rc = 0;
+
+out:
+    free(cur);
+    free(ver);
+    free(log_n);
+    free(log_v);
+    free(mark);
+    free(stack);
+    return rc;
+}
+
+/* The answer without SCCP/DCE: everything reachable runs, nothing but
+ * the temporaries' entry values is known, every instruction is live */
+static int conservative_facts(SsaFunc *f)
+{
+    const Cfg *cfg = &f->cfg;
+    uint32_t n_edges = cfg->blocks[cfg->n_blocks - 1].pred_first + cfg->blocks[cfg->n_blocks - 1].n_preds;
+
+    f->lattice    = malloc(f->n_values ? f->n_values : 1);
+    f->lat_const  = calloc(f->n_values ? f->n_values : 1, sizeof(int32_t));
+    f->block_exec = malloc(cfg->n_blocks);
+    f->edge_exec  = malloc(n_edges ? n_edges : 1);
+    if (!f->lattice || !f->lat_const || !f->block_exec || !f->edge_exec) return -1;
+
+    for (uint32_t v = 0; v < f->n_values; v++)
+        f->lattice[v] = v < f->n_names && v >= f->src->n_vars ? LAT_CONST : LAT_BOTTOM;
+    for (uint32_t b = 0; b < cfg->n_blocks; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        f->block_exec[b] = bb->rpo != CFG_NONE;
+        for (uint32_t j = 0; j < bb->n_preds; j++)
+            f->edge_exec[bb->pred_first + j] = cfg->blocks[cfg->preds[bb->pred_first + j]].rpo != CFG_NONE;
+    }
+    return 0;
+}
+
+int ssa_build(SsaFunc *f, const TacProgram *p)
+{
+    memset(f, 0, sizeof(*f));
+    f->src = p;
+    f->n_names = p->n_vars + p->n_temps;
+    f->stats.tac_in = p->count;
+
+    uint64_t t0 = bench_now_ns();
+    if (cfg_build(&f->cfg, p) != 0) return -1;
+    f->stats.ms_cfg = ms_since(t0);
+    f->stats.blocks = f->cfg.n_blocks;
+
+    t0 = bench_now_ns();
+    if (cfg_dominators(&f->cfg) != 0) return -1;
+    f->stats.ms_dom = ms_since(t0);
+
+    t0 = bench_now_ns();
+    if (cfg_dominance_frontiers(&f->cfg) != 0) return -1;
+    f->stats.ms_df = ms_since(t0);
+
+    t0 = bench_now_ns();
+    uint32_t n_sites = 0;
+    PhiSite *sites   = place_phis(f, &n_sites);
+    int      rc      = sites ? layout(f, sites, n_sites) : -1;
+    free(sites);
+    if (rc != 0) return -1;
+    f->stats.ms_phi = ms_since(t0);
+
+    t0 = bench_now_ns();
+    if (rename_values(f) != 0) return -1;
+    f->stats.ms_rename = ms_since(t0);
+
+    return conservative_facts(f);
+}
+
+void ssa_free(SsaFunc *f)
+{
+    cfg_free(&f->cfg);
+    free(f->code);
+    free(f->block_first);
+    free(f->phi_args);
+    free(f->values);
+    free(f->exit_first);
+    free(f->exit_vals);
+    free(f->lattice);
+    free(f->lat_const);
+    free(f->block_exec);
+    free(f->edge_exec);
+    memset(f, 0, sizeof(*f));
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Sparse conditional constant propagation
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    SsaFunc  *f;
+    uint32_t *use_first;    /* users of each value, CSR */
+    uint32_t *uses;
+    uint32_t *edge_to;      /* cfg.preds[] slot → its target block */
+    uint32_t *flow;         /* edge worklist  */
+    uint32_t  n_flow;
+    uint32_t *ssa;          /* value worklist */
+    uint32_t  n_ssa;
+} Sccp;
+
+enum { EDGE_NO, EDGE_QUEUED, EDGE_YES };
+
+typedef struct {
+    uint8_t kind;
+    int32_t c;
+} Lat;
+
+static Lat lat_of(const SsaFunc *f, TacOperand o)
+{
+    if (OPND_TAG(o) == OPND_CONST) return (Lat){ LAT_CONST, tac_const_value(f->src, o) };
+    uint32_t v = OPND_INDEX(o);
+    return (Lat){ f->lattice[v], f->lat_const[v] };
+}
+
+static Lat lat_meet(Lat x, Lat y)
+{
+    if (x.kind == LAT_TOP) return y;
+    if (y.kind == LAT_TOP) return x;
+    if (x.kind == LAT_CONST && y.kind == LAT_CONST && x.c == y.c) return x;
+    return (Lat){ LAT_BOTTOM, 0 };
+}
+
+static void lat_lower(Sccp *s, TacOperand dst, Lat x)
+{
+    uint32_t v   = OPND_INDEX(dst);
+    Lat      old = { s->f->lattice[v], s->f->lat_const[v] };
+    Lat      now = lat_meet(old, x);
+    if (now.kind == old.kind && now.c == old.c) return;
+    s->f->lattice[v]   = now.kind;
+    s->f->lat_const[v] = now.c;
+    s->ssa[s->n_ssa++] = v;                 /* at most twice per value */
+}
+
+static void queue_edge(Sccp *s, uint32_t from, uint32_t to)
+{
+    const Cfg *cfg  = &s->f->cfg;
+    uint32_t   slot = cfg->blocks[to].pred_first + cfg_pred_index(cfg, to, from);
+    if (s->f->edge_exec[slot] != EDGE_NO) return;
+    s->f->edge_exec[slot] = EDGE_QUEUED;
+    s->flow[s->n_flow++]  = slot;           /* at most once per edge */
+}
+
+static void sccp_visit(Sccp *s, uint32_t i)
+{
+    SsaFunc        *f  = s->f;
+    const SsaInstr *in = &f->code[i];
+    const CfgBlock *bb = &f->cfg.blocks[in->block];
+
+    if (in->op == SSA_PHI) {
+        Lat acc = { LAT_TOP, 0 };
+        for (uint32_t j = 0; j < bb->n_preds; j++)
+            if (f->edge_exec[bb->pred_first + j] == EDGE_YES)
+                acc = lat_meet(acc, lat_of(f, f->phi_args[in->a + j]));
+        lat_lower(s, in->dst, acc);
+        return;
+    }
+    if (defines(in->op)) {
+        Lat x = lat_of(f, in->a);
+        Lat y = uses_b(in->op) ? lat_of(f, in->b) : (Lat){ LAT_CONST, 0 };
+        if (in->op == TAC_MUL && ((x.kind == LAT_CONST && x.c == 0) || (y.kind == LAT_CONST && y.c == 0)))
+            lat_lower(s, in->dst, (Lat){ LAT_CONST, 0 });
+        else if (x.kind == LAT_TOP || y.kind == LAT_TOP)
+            return;
+        else if (x.kind == LAT_BOTTOM || y.kind == LAT_BOTTOM)
+            lat_lower(s, in->dst, (Lat){ LAT_BOTTOM, 0 });
+        else
+            lat_lower(s, in->dst, (Lat){ LAT_CONST, tac_fold((TacOp)in->op, x.c, y.c) });
+        return;
+    }
+    if (is_branch(in->op)) {
+        Lat x = lat_of(f, in->a), y = lat_of(f, in->b);
+        if (x.kind == LAT_TOP || y.kind == LAT_TOP) return;
+        if (x.kind == LAT_CONST && y.kind == LAT_CONST && bb->n_succ == 2) {
+            int taken = tac_branch_taken((TacOp)in->op, x.c, y.c);
+            queue_edge(s, in->block, bb->succ[taken ? 1 : 0]);
+            return;
+        }
+        for (uint32_t k = 0; k < bb->n_succ; k++) queue_edge(s, in->block, bb->succ[k]);
+    }
+}
+
+static void sccp_visit_block(Sccp *s, uint32_t b, int phis_only)
+{
+    SsaFunc *f    = s->f;
+    uint32_t i    = f->block_first[b];
+    uint32_t end  = f->block_first[b + 1];
+    for (; i < end && (!phis_only || f->code[i].op == SSA_PHI); i++) sccp_visit(s, i);
+    if (phis_only) return;
+
+    int ends_in_branch = end > f->block_first[b] && is_branch(f->code[end - 1].op);
+    if (!ends_in_branch)
+        for (uint32_t k = 0; k < f->cfg.blocks[b].n_succ; k++)
+            queue_edge(s, b, f->cfg.blocks[b].succ[k]);
+}
+
+int ssa_sccp(SsaFunc *f)
+{
+    uint64_t   t0  = bench_now_ns();
+    const Cfg *cfg = &f->cfg;
+    uint32_t   n_edges = cfg->blocks[cfg->n_blocks - 1].pred_first + cfg->blocks[cfg->n_blocks - 1].n_preds;
+    Sccp s = { f, NULL, NULL, NULL, NULL, 0, NULL, 0 };
+    int  rc = -1;
+
+    s.use_first = calloc(f->n_values + 1, sizeof(uint32_t));
+    s.edge_to   = malloc((n_edges ? n_edges : 1) * sizeof(uint32_t));
+    s.flow      = malloc((n_edges ? n_edges : 1) * sizeof(uint32_t));
+    s.ssa       = malloc((2 * f->n_values + 1) * sizeof(uint32_t));
+    if (!s.use_first || !s.edge_to || !s.flow || !s.ssa) goto out;
+
+    /* Def-use chains, in two rounds: count, then fill */
+    for (int fill = 0; fill < 2; fill++) {
+        for (uint32_t i = 0; i < f->count; i++) {
+            const SsaInstr *in = &f->code[i];
+            TacOperand ops[2] = { uses_a(in->op) ? in->a : 0, uses_b(in->op) ? in->b : 0 };
+            uint32_t   n_ops  = in->op == SSA_PHI ? cfg->blocks[in->block].n_preds : 2;
+            for (uint32_t k = 0; k < n_ops; k++) {
+                TacOperand o = in->op == SSA_PHI ? f->phi_args[in->a + k] : ops[k];
+                if (OPND_TAG(o) != OPND_TEMP) continue;
+                if (fill) s.uses[s.use_first[OPND_INDEX(o)]++] = i;
+                else      s.use_first[OPND_INDEX(o) + 1]++;
+            }
+        }
+        if (!fill) {
+            for (uint32_t v = 0; v < f->n_values; v++) s.use_first[v + 1] += s.use_first[v];
+            s.uses = malloc((s.use_first[f->n_values] ? s.use_first[f->n_values] : 1) * sizeof(uint32_t));
+            if (!s.uses) goto out;
+        }
+    }
+    for (uint32_t v = f->n_values; v > 0; v--) s.use_first[v] = s.use_first[v - 1];
+    s.use_first[0] = 0;
+    for (uint32_t b = 0; b < cfg->n_blocks; b++)
+        for (uint32_t j = 0; j < cfg->blocks[b].n_preds; j++)
+            s.edge_to[cfg->blocks[b].pred_first + j] = b;
+
+    /* Optimistic start: nothing runs, nothing is known */
+    for (uint32_t v = 0; v < f->n_values; v++) {
+        f->lattice[v]   = v >= f->n_names ? LAT_TOP : v < f->src->n_vars ? LAT_BOTTOM : LAT_CONST;
+        f->lat_const[v] = 0;
+    }
+    memset(f->block_exec, 0, cfg->n_blocks);
+    memset(f->edge_exec, EDGE_NO, n_edges);
+
+    f->block_exec[cfg->entry] = 1;
+    sccp_visit_block(&s, cfg->entry, 0);
+    while (s.n_flow || s.n_ssa) {
+        while (s.n_flow) {
+            uint32_t slot = s.flow[--s.n_flow];
+            uint32_t b    = s.edge_to[slot];
+            f->edge_exec[slot] = EDGE_YES;
+            if (!f->block_exec[b]) {
+                f->block_exec[b] = 1;
+                sccp_visit_block(&s, b, 0);
+            } else {
+                sccp_visit_block(&s, b, 1);
+            }
+        }
+        while (s.n_ssa && !s.n_flow) {
+            uint32_t v = s.ssa[--s.n_ssa];
+            for (uint32_t k = s.use_first[v]; k < s.use_first[v + 1]; k++) {
+                uint32_t i = s.uses[k];
+                if (f->block_exec[f->code[i].block]) sccp_visit(&s, i);
+            }
+        }
+    }
+
+    /* Statistics */
+    f->stats.const_values = f->stats.folded_branches = 0;
+    f->stats.dead_blocks  = f->stats.unreachable = 0;
+    for (uint32_t v = f->n_names; v < f->n_values; v++)
+        f->stats.const_values += f->lattice[v] == LAT_CONST && f->block_exec[f->code[f->values[v].def].block];
+    for (uint32_t b = 1; b < cfg->exit; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        uint32_t first = f->block_first[b], end = f->block_first[b + 1];
+        if (!f->block_exec[b]) {
+            f->stats.dead_blocks++;
+            f->stats.unreachable += end - first;
+            continue;
+        }
+        if (end > first && is_branch(f->code[end - 1].op) && bb->n_succ == 2) {
+            uint32_t e0 = cfg->blocks[bb->succ[0]].pred_first + cfg_pred_index(cfg, bb->succ[0], b);
+            uint32_t e1 = cfg->blocks[bb->succ[1]].pred_first + cfg_pred_index(cfg, bb->succ[1], b);
+            f->stats.folded_branches += f->edge_exec[e0] != EDGE_YES || f->edge_exec[e1] != EDGE_YES;
+        }
+    }
+    rc = 0;
+
+out:
+    free(s.use_first);
+    free(s.uses);
+    free(s.edge_to);
+    free(s.flow);
+    free(s.ssa);
+    f->stats.ms_sccp = ms_since(t0);
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Dead-code elimination
+ *
+ *  Mark from the roots — returns, branches that still decide
+ *  something, and the values variables hold at the exits — through
+ *  operands to their definitions.  A value SCCP proved constant is
+ *  replaced by the constant wherever it is read; its definition stays
+ *  only if the value must also sit in its name (a φ argument or an
+ *  exit value), and then as a plain store of the constant.
+ * ════════════════════════════════════════════════════════════════ */
+
+static int both_edges_run(const SsaFunc *f, uint32_t b)
+{
+    const Cfg      *cfg = &f->cfg;
+    const CfgBlock *bb  = &cfg->blocks[b];
+    if (bb->n_succ != 2) return 0;
+    for (uint32_t k = 0; k < 2; k++) {
+        uint32_t s = bb->succ[k];
+        if (f->edge_exec[cfg->blocks[s].pred_first + cfg_pred_index(cfg, s, b)] == EDGE_NO) return 0;
+    }
+    return 1;
+}
+
+int ssa_dce(SsaFunc *f)
+{
+    uint64_t  t0   = bench_now_ns();
+    uint32_t *work = malloc((f->count ? f->count : 1) * sizeof(uint32_t));
+    uint32_t  sp   = 0;
+    if (!work) return -1;
+
+/* in_name: the value has to be in its name's storage, even if constant */
+#define MARK_VALUE(o, in_name)                                              \
+    do {                                                                    \
+        uint32_t v_ = OPND_INDEX(o);                                        \
+        if (OPND_TAG(o) == OPND_TEMP && f->values[v_].def != SSA_ENTRY &&   \
+            ((in_name) || f->lattice[v_] != LAT_CONST) &&                   \
+            !f->code[f->values[v_].def].live) {                             \
+            f->code[f->values[v_].def].live = 1;                            \
+            work[sp++] = f->values[v_].def;                                 \
+        }                                                                   \
+    } while (0)
+
+    for (uint32_t i = 0; i < f->count; i++) f->code[i].live = 0;
+    for (uint32_t b = 0; b < f->cfg.n_blocks; b++) {
+        if (!f->block_exec[b]) continue;
+        for (uint32_t i = f->block_first[b]; i < f->block_first[b + 1]; i++) {
+            SsaInstr *in = &f->code[i];
+            if (in->op == TAC_RET || in->op == TAC_GOTO || (is_branch(in->op) && both_edges_run(f, b))) {
+                in->live = 1;
+                work[sp++] = i;
+            }
+        }
+        if (f->exit_first[b] != SSA_ENTRY)
+            for (uint32_t v = 0; v < f->src->n_vars; v++)
+                MARK_VALUE(OPND(OPND_TEMP, f->exit_vals[f->exit_first[b] + v]), 1);
+    }
+
+    while (sp) {
+        const SsaInstr *in = &f->code[work[--sp]];
+        if ((in->op == SSA_PHI || defines(in->op)) && f->lattice[OPND_INDEX(in->dst)] == LAT_CONST)
+            continue;                           /* stored as the constant */
+        if (in->op == SSA_PHI) {
+            const CfgBlock *bb = &f->cfg.blocks[in->block];
+            for (uint32_t j = 0; j < bb->n_preds; j++)
+                if (f->edge_exec[bb->pred_first + j] != EDGE_NO) MARK_VALUE(f->phi_args[in->a + j], 1);
+            continue;
+        }
+        if (uses_a(in->op)) MARK_VALUE(in->a, 0);
+        if (uses_b(in->op)) MARK_VALUE(in->b, 0);
+    }
+#undef MARK_VALUE
+
+    f->stats.dead = 0;
+    for (uint32_t i = 0; i < f->count; i++)
+        f->stats.dead += f->block_exec[f->code[i].block] && !f->code[i].live &&
+                         (f->code[i].op == SSA_PHI || defines(f->code[i].op));
+    free(work);
+    f->stats.ms_dce = ms_since(t0);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Out of SSA
+ *
+ *  SCCP only substitutes constants and DCE only deletes, so the SSA
+ *  stays conventional: no two values of one source name are ever live
+ *  at the same time.  Every value can therefore go back to its source
+ *  name and the φs simply disappear (Briggs et al., "Practical
+ *  Improvements to the Construction and Destruction of SSA Form").
+ *  The one thing to put back is a constant that still has to sit in
+ *  its name — feeding a φ or a variable's exit — which DCE kept live
+ *  and which becomes  name = constant.
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    SsaFunc    *f;
+    TacProgram *out;
+    uint32_t   *label_of;       /* block → output label index, CFG_NONE */
+    int         oom;
+} OutSsa;
+
+static void out_emit(OutSsa *o, TacOp op, TacOperand dst, TacOperand a, TacOperand b)
+{
+    if (tac_emit(o->out, op, dst, a, b) != 0) o->oom = 1;
+}
+
+static TacOperand block_label(OutSsa *o, uint32_t b)
+{
+    if (o->label_of[b] == CFG_NONE) o->label_of[b] = OPND_INDEX(tac_label(o->out));
+    return OPND(OPND_LABEL, o->label_of[b]);
+}
+
+/* An SSA operand as an output operand */
+static TacOperand out_operand(OutSsa *o, TacOperand x)
+{
+    const SsaFunc *f = o->f;
+    if (OPND_TAG(x) == OPND_CONST) return tac_const(o->out, tac_const_value(f->src, x));
+    if (OPND_TAG(x) != OPND_TEMP)  return x;
+
+    uint32_t v = OPND_INDEX(x);
+    if (f->lattice[v] == LAT_CONST) return tac_const(o->out, f->lat_const[v]);
+    if (f->lattice[v] == LAT_TOP)   return tac_const(o->out, 0);   /* never read at run time */
+    return operand_of_name(f->src, f->values[v].name);
+}
+
+static TacOperand out_name(OutSsa *o, TacOperand value)
+{
+    return operand_of_name(o->f->src, o->f->values[OPND_INDEX(value)].name);
+}
+
+/* Remove labels nothing jumps to and number the rest densely */
+static void compact_labels(TacProgram *p)
+{
+    uint32_t *renum = malloc((p->n_labels ? p->n_labels : 1) * sizeof(uint32_t));
+    if (!renum) return;
+    for (uint32_t l = 0; l < p->n_labels; l++) renum[l] = CFG_NONE;
+    for (uint32_t i = 0; i < p->count; i++)
+        if (p->code[i].op == TAC_GOTO || is_branch(p->code[i].op))
+            renum[OPND_INDEX(p->code[i].dst)] = 0;
+
+    uint32_t n_labels = 0, at = 0;
+    for (uint32_t i = 0; i < p->count; i++) {
+        TacInstr in = p->code[i];
+        if (in.op == TAC_LABEL) {
+            uint32_t l = OPND_INDEX(in.dst);
+            if (renum[l] == CFG_NONE) continue;
+            renum[l] = n_labels++;
+        }
+        p->code[at++] = in;
+    }
+    p->count = at;
+    for (uint32_t i = 0; i < p->count; i++)
+        if (p->code[i].op == TAC_GOTO || p->code[i].op == TAC_LABEL || is_branch(p->code[i].op))
+            p->code[i].dst = OPND(OPND_LABEL, renum[OPND_INDEX(p->code[i].dst)]);
+    p->n_labels = n_labels;
+    free(renum);
+}
+
+int ssa_to_tac(SsaFunc *f, TacProgram *out)
+{
+    uint64_t   t0  = bench_now_ns();
+    const Cfg *cfg = &f->cfg;
+    OutSsa     o   = { f, out, NULL, 0 };
+
+    tac_free(out);
+    for (uint32_t v = 0; v < f->src->n_vars; v++)
+        if (tac_var(out, f->src->vars[v], strlen(f->src->vars[v])) == TAC_NO_OPERAND) o.oom = 1;
+    for (uint32_t t = 0; t < f->src->n_temps; t++)
+        if (tac_temp(out) == TAC_NO_OPERAND) o.oom = 1;
+
+    uint32_t *exec   = malloc(cfg->n_blocks * sizeof(uint32_t));
+    uint32_t  n_exec = 0;
+    o.label_of = malloc(cfg->n_blocks * sizeof(uint32_t));
+    if (!exec || !o.label_of) o.oom = 1;
+    for (uint32_t b = 0; b < cfg->n_blocks && !o.oom; b++) {
+        o.label_of[b] = CFG_NONE;
+        if (f->block_exec[b]) exec[n_exec++] = b;
+    }
+
+    for (uint32_t k = 0; k < n_exec && !o.oom; k++) {
+        uint32_t        b    = exec[k];
+        uint32_t        next = k + 1 < n_exec ? exec[k + 1] : CFG_NONE;
+        const CfgBlock *bb   = &cfg->blocks[b];
+        const SsaInstr *last = NULL;
+
+        if (b != cfg->entry) out_emit(&o, TAC_LABEL, block_label(&o, b), TAC_NO_OPERAND, TAC_NO_OPERAND);
+        for (uint32_t i = f->block_first[b]; i < f->block_first[b + 1]; i++) {
+            const SsaInstr *in = &f->code[i];
+            last = in;
+            if ((in->op != SSA_PHI && !defines(in->op)) || !in->live) continue;
+
+            uint32_t   v   = OPND_INDEX(in->dst);
+            TacOperand dst = out_name(&o, in->dst);
+            if (f->lattice[v] == LAT_CONST)         /* materialise */
+                out_emit(&o, TAC_ASSIGN, dst, tac_const(out, f->lat_const[v]), TAC_NO_OPERAND);
+            else if (in->op == SSA_PHI)
+                continue;                           /* already in its name */
+            else if (in->op == TAC_ASSIGN && out_operand(&o, in->a) == dst)
+                continue;
+            else
+                out_emit(&o, (TacOp)in->op, dst, out_operand(&o, in->a),
+                         uses_b(in->op) ? out_operand(&o, in->b) : TAC_NO_OPERAND);
+        }
+
+        if (bb->n_succ == 0) {
+            TacOperand r = last && last->op == TAC_RET ? out_operand(&o, last->a) : tac_const(out, 0);
+            out_emit(&o, TAC_RET, TAC_NO_OPERAND, r, TAC_NO_OPERAND);
+            continue;
+        }
+        if (last && is_branch(last->op) && both_edges_run(f, b)) {
+            out_emit(&o, (TacOp)last->op, block_label(&o, bb->succ[1]),
+                     out_operand(&o, last->a), out_operand(&o, last->b));
+            if (bb->succ[0] != next)
+                out_emit(&o, TAC_GOTO, block_label(&o, bb->succ[0]), TAC_NO_OPERAND, TAC_NO_OPERAND);
+            continue;
+        }
+
+        uint32_t s = bb->succ[0];               /* the one successor that runs */
+        for (uint32_t j = 0; j < bb->n_succ; j++) {
+            uint32_t c = bb->succ[j];
+            if (f->edge_exec[cfg->blocks[c].pred_first + cfg_pred_index(cfg, c, b)] != EDGE_NO) s = c;
+        }
+        if (s != next) out_emit(&o, TAC_GOTO, block_label(&o, s), TAC_NO_OPERAND, TAC_NO_OPERAND);
+    }
+    if (!o.oom) compact_labels(out);
+
+    free(exec);
+    free(o.label_of);
+    f->stats.tac_out = out->count;
+    f->stats.ms_out  = ms_since(t0);
+    return o.oom ? -1 : 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Printing
+ * ════════════════════════════════════════════════════════════════ */
+
+static void print_value(const SsaFunc *f, TacOperand o)
+{
+    if (OPND_TAG(o) != OPND_TEMP) {
+        print_tac_operand(f->src, o);
+        return;
+    }
+    const SsaValue *v = &f->values[OPND_INDEX(o)];
+    if (v->name < f->src->n_vars) printf("%s.%u", f->src->vars[v->name], v->version);
+    else                          printf("t%u.%u", v->name - f->src->n_vars, v->version);
+}
+
+void print_ssa(const SsaFunc *f)
+{
+    static const char *sym[] = { "+", "-", "*", "/", "<<", ">>>", ">>" };
+    const Cfg *cfg = &f->cfg;
+
+    for (uint32_t b = 0; b < cfg->n_blocks; b++) {
+        const CfgBlock *bb = &cfg->blocks[b];
+        if (bb->rpo == CFG_NONE) continue;
+        printf("  B%u%s:", b, b == cfg->entry ? " (entry)" : b == cfg->exit ? " (exit)" : "");
+        if (bb->n_preds) {
+            printf("   ; preds");
+            for (uint32_t j = 0; j < bb->n_preds; j++) printf(" B%u", cfg->preds[bb->pred_first + j]);
+        }
+        if (!f->block_exec[b]) printf("   ; never executes");
+        printf("\n");
+
+        for (uint32_t i = f->block_first[b]; i < f->block_first[b + 1]; i++) {
+            const SsaInstr *in = &f->code[i];
+            printf("    ");
+            if (in->op == SSA_PHI || defines(in->op)) {
+                print_value(f, in->dst);
+                printf(" = ");
+            }
+            switch (in->op) {
+                case SSA_PHI:
+                    printf("φ(");
+                    for (uint32_t j = 0; j < bb->n_preds; j++) {
+                        if (j) printf(", ");
+                        print_value(f, f->phi_args[in->a + j]);
+                    }
+                    printf(")");
+                    break;
+                case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV:
+                case TAC_SHL: case TAC_SHR: case TAC_SAR:
+                    print_value(f, in->a);
+                    printf(" %s ", sym[in->op]);
+                    print_value(f, in->b);
+                    break;
+                case TAC_NEG:
+                    printf("-");
+                    print_value(f, in->a);
+                    break;
+                case TAC_ASSIGN:
+                    print_value(f, in->a);
+                    break;
+                case TAC_GOTO:
+                    printf("goto B%u", bb->succ[0]);
+                    break;
+                case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ:
+                    printf("if ");
+                    print_value(f, in->a);
+                    printf(in->op == TAC_IF_GT ? " > " : in->op == TAC_IF_LT ? " < " : " == ");
+                    print_value(f, in->b);
+                    printf(" goto B%u else B%u", bb->succ[bb->n_succ - 1], bb->succ[0]);
+                    break;
+                case TAC_RET:
+                    printf("return ");
+                    print_value(f, in->a);
+                    break;
+            }
+            if ((in->op == SSA_PHI || defines(in->op)) && f->lattice[OPND_INDEX(in->dst)] == LAT_CONST)
+                printf("      ; = %d", f->lat_const[OPND_INDEX(in->dst)]);
+            else if (f->block_exec[b] && !in->live && (in->op == SSA_PHI || defines(in->op)))
+                printf("      ; dead");
+            printf("\n");
+        }
+        if (f->exit_first[b] != SSA_ENTRY) {
+            int any = 0;
+            for (uint32_t v = 0; v < f->src->n_vars; v++) {
+                uint32_t val = f->exit_vals[f->exit_first[b] + v];
+                if (val == v) continue;
+                printf(any ? ", " : "    ; leaves with ");
+                printf("%s = ", f->src->vars[v]);
+                print_value(f, OPND(OPND_TEMP, val));
+                any = 1;
+            }
+            if (any) printf("\n");
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * Chapter 21 — SSA construction, SCCP, DCE and out-of-SSA over TAC
+ *
+ *   TAC ─► CFG ─► dominators ─► DF ─► φ placement ─► renaming   ssa_build()
+ *       ─► sparse conditional constant propagation               ssa_sccp()
+ *       ─► dead-code elimination (mark live from the exits)      ssa_dce()
+ *       ─► back to TAC, each value under its source name         ssa_to_tac()
+ *
+ * Names are the program's variables and temporaries.  φ-functions go
+ * on the dominance frontiers of each name's definitions, for names
+ * that are live into some block ("semi-pruned" SSA), and renaming is a
+ * dominator-tree walk that keeps the current value of every name in an
+ * array plus an undo log — the same trick as chapter 20's scopes.
+ *
+ * Every name has an entry value (value number = name number): the
+ * caller's input for a variable, 0 for a temporary (tac_exec() starts
+ * temps at 0).  Variables are the program's outputs as well, so every
+ * exit block remembers which value each variable holds when it leaves,
+ * and those count as uses.
+ *
+ * SCCP (Wegman & Zadeck) tracks a three-level lattice per value —
+ * unknown, one constant, varying — and which CFG edges can execute,
+ * so constants flow through φs only from live edges and branches on
+ * constants prune whole regions.  DCE then keeps only what feeds a
+ * return, a live branch or a variable's exit value.
+ *
+ * Neither pass moves code or stretches a value's lifetime, so the SSA
+ * stays "conventional" and ssa_to_tac() can drop the φs and give every
+ * value its source name back — no copies, no split edges.  A pass that
+ * did move code would need real copy insertion here.
+ */
+
+#ifndef SSA_H
+#define SSA_H
+
+#include <stdint.h>
+
+#include "cfg.h"
+#include "tac.h"
+
+#define SSA_PHI    TAC_OP_COUNT     /* opcode of a φ-function */
+#define SSA_ENTRY  UINT32_MAX       /* SsaValue.def of entry values */
+
+/*
+ * Values are OPND_TEMP(value number) operands; constants stay
+ * OPND_CONST into the source program's table.  A φ keeps its arguments
+ * in phi_args[a ..], one per predecessor in CFG order, and its source
+ * name in b.  Branches keep only their compared operands — targets come
+ * from the CFG.  Labels are dropped.
+ */
+typedef struct {
+    uint8_t    op;          /* TacOp or SSA_PHI                 */
+    uint8_t    live;        /* set by ssa_dce()                 */
+    uint16_t   pad;
+    uint32_t   block;
+    TacOperand dst;
+    TacOperand a;
+    TacOperand b;
+} SsaInstr;                 /* 20 bytes */
+
+typedef struct {
+    uint32_t name;          /* variable v → v; temp t → n_vars + t */
+    uint32_t version;       /* x.0 is the entry value              */
+    uint32_t def;           /* defining instruction or SSA_ENTRY   */
+} SsaValue;
+
+typedef enum { LAT_TOP, LAT_CONST, LAT_BOTTOM } SsaLattice;
+
+typedef struct {
+    uint32_t tac_in;            /* instructions in the source program     */
+    uint32_t blocks;            /* CFG blocks, synthetic entry/exit incl. */
+    uint32_t phis;
+    uint32_t ssa_instrs;        /* including φs                           */
+    uint32_t const_values;      /* SCCP: values proven constant           */
+    uint32_t folded_branches;   /* SCCP: conditional branches decided     */
+    uint32_t dead_blocks;       /* SCCP: blocks that can never execute    */
+    uint32_t unreachable;       /* SSA instructions in those blocks       */
+    uint32_t dead;              /* DCE: instructions with no live use     */
+    uint32_t tac_out;           /* instructions after ssa_to_tac()        */
+    double   ms_cfg, ms_dom, ms_df, ms_phi, ms_rename;
+    double   ms_sccp, ms_dce, ms_out;
+} SsaStats;
+
+typedef struct {
+    const TacProgram *src;
+    Cfg         cfg;
+
+    SsaInstr   *code;
+    uint32_t    count;
+    uint32_t   *block_first;    /* block b: code[block_first[b] .. block_first[b+1]), φs first */
+    TacOperand *phi_args;
+    uint32_t    n_phi_args;
+
+    SsaValue   *values;
+    uint32_t    n_values;
+    uint32_t    n_names;
+    uint32_t   *exit_first;     /* exit block b: exit_vals[exit_first[b] + v]; else SSA_ENTRY */
+    uint32_t   *exit_vals;
+
+    /* Facts; ssa_build() fills in the conservative answer */
+    uint8_t    *lattice;        /* SsaLattice per value          */
+    int32_t    *lat_const;      /* the constant, for LAT_CONST   */
+    uint8_t    *block_exec;     /* block may execute             */
+    uint8_t    *edge_exec;      /* per cfg.preds[] slot          */
+
+    SsaStats    stats;
+} SsaFunc;
+
+/* All four return 0 on success, -1 on OOM */
+int  ssa_build(SsaFunc *f, const TacProgram *p);
+int  ssa_sccp(SsaFunc *f);
+int  ssa_dce(SsaFunc *f);
+int  ssa_to_tac(SsaFunc *f, TacProgram *out);       /* out is (re)initialised */
+void ssa_free(SsaFunc *f);
+
+/* Blocks with their φs and instructions; after ssa_sccp()/ssa_dce()
+ * constants and dead instructions are annotated */
+void print_ssa(const SsaFunc *f);
+
+#endif /* SSA_H */
@@ -0,0 +1,489 @@
+/*
+ * Chapter 21 — Three-address code
+ *
+ * See tac.h for the encoding.
+ */
+
+#include "tac.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ════════════════════════════════════════════════════════════════
+ *  Program and operand tables
+ * ════════════════════════════════════════════════════════════════ */
+
+void tac_init(TacProgram *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+void tac_free(TacProgram *p)
+{
+    free(p->code);
+    free(p->consts);
+    free(p->const_slots);
+    free(p->vars);
+    tac_init(p);
+}
+
+/* realloc that leaves *ptr untouched on failure */
+static int grow_array(void **ptr, uint32_t *cap, size_t elem, uint32_t first)
+{
+    uint32_t new_cap = *cap ? *cap * 2 : first;
+    void    *q       = realloc(*ptr, elem * new_cap);
+    if (!q) return -1;
+    *ptr = q;
+    *cap = new_cap;
+    return 0;
+}
+
+TacOperand tac_temp(TacProgram *p)
+{
+    if (p->n_temps > OPND_MAX_INDEX) return TAC_NO_OPERAND;
+    return OPND(OPND_TEMP, p->n_temps++);
+}
+
+TacOperand tac_label(TacProgram *p)
+{
+    if (p->n_labels > OPND_MAX_INDEX) return TAC_NO_OPERAND;
+    return OPND(OPND_LABEL, p->n_labels++);
+}
+
+static uint32_t const_home(int32_t value, uint32_t n_slots)
+{
+    uint32_t h = (uint32_t)value * 0x9E3779B1u;
+    return (h ^ h >> 16) & (n_slots - 1);
+}
+
+static int const_slots_grow(TacProgram *p)
+{
+    uint32_t  n     = p->n_const_slots ? p->n_const_slots * 2 : 64;
+    uint32_t *slots = calloc(n, sizeof(*slots));
+    if (!slots) return -1;
+    for (uint32_t i = 0; i < p->n_consts; i++) {
+        uint32_t h = const_home(p->consts[i], n);
+        while (slots[h]) h = (h + 1) & (n - 1);
+        slots[h] = i + 1;
+    }
+    free(p->const_slots);
+    p->const_slots   = slots;
+    p->n_const_slots = n;
+    return 0;
+}
+
+TacOperand tac_const(TacProgram *p, int32_t value)
+{
+    if ((p->n_consts + 1) * 2 > p->n_const_slots && const_slots_grow(p) != 0)
+        return TAC_NO_OPERAND;
+
+    uint32_t mask = p->n_const_slots - 1;
+    uint32_t h    = const_home(value, p->n_const_slots);
+    for (; p->const_slots[h]; h = (h + 1) & mask)
+        if (p->consts[p->const_slots[h] - 1] == value)
+            return OPND(OPND_CONST, p->const_slots[h] - 1);
+
+    if (p->n_consts > OPND_MAX_INDEX) return TAC_NO_OPERAND;
+    if (p->n_consts == p->consts_cap &&
+        grow_array((void **)&p->consts, &p->consts_cap, sizeof(*p->consts), 64) != 0)
+        return TAC_NO_OPERAND;
+    p->consts[p->n_consts] = value;
+    p->const_slots[h]      = ++p->n_consts;
+    return OPND(OPND_CONST, p->n_consts - 1);
+}
+
+/* Programs name a handful of variables, so a linear scan is enough */
+TacOperand tac_var(TacProgram *p, const char *name, size_t len)
+{
+    if (len == 0 || len >= TAC_NAME_MAX) return TAC_NO_OPERAND;
+    for (uint32_t i = 0; i < p->n_vars; i++)
+        if (strncmp(p->vars[i], name, len) == 0 && p->vars[i][len] == '\0')
+            return OPND(OPND_VAR, i);
+
+    if (p->n_vars > OPND_MAX_INDEX) return TAC_NO_OPERAND;
+    if (p->n_vars == p->vars_cap &&
+        grow_array((void **)&p->vars, &p->vars_cap, sizeof(*p->vars), 16) != 0)
+        return TAC_NO_OPERAND;
+    memcpy(p->vars[p->n_vars], name, len);
+    p->vars[p->n_vars][len] = '\0';
+    return OPND(OPND_VAR, p->n_vars++);
+}
+
+int32_t tac_const_value(const TacProgram *p, TacOperand o)
+{
+    return p->consts[OPND_INDEX(o)];
+}
+
+const char *tac_var_name(const TacProgram *p, TacOperand o)
+{
+    return p->vars[OPND_INDEX(o)];
+}
+
+int tac_emit(TacProgram *p, TacOp op, TacOperand dst, TacOperand a, TacOperand b)
+{
+    if (p->count == p->cap &&
+        grow_array((void **)&p->code, &p->cap, sizeof(*p->code), 64) != 0)
+        return -1;
+    p->code[p->count++] = (TacInstr){ (uint8_t)op, { 0, 0, 0 }, dst, a, b };
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Lowering
+ *
+ *  Post-order: operands first, then one instruction into a fresh
+ *  temporary.  Leaves are operands, not instructions.  A small
+ *  pointer-keyed map remembers the operand of every interior node, so
+ *  a subtree shared by a hash-consed DAG is computed once.
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const ASTNode **keys;
+    TacOperand     *vals;
+    size_t          mask;
+} LowerMap;
+
+typedef struct {
+    TacProgram     *prog;
+    const ExprVars *vars;
+    LowerMap        memo;
+} Lowering;
+
+static size_t count_nodes(const ASTNode *n)
+{
+    return n ? 1 + count_nodes(n->left) + count_nodes(n->right) : 0;
+}
+
+static size_t memo_slot(const LowerMap *m, const ASTNode *n)
+{
+    size_t h = (((uintptr_t)n >> 4) * 0x9E3779B97F4A7C15ull) & m->mask;
+    while (m->keys[h] && m->keys[h] != n) h = (h + 1) & m->mask;
+    return h;
+}
+
+static TacOperand lower_var(Lowering *lw, int slot)
+{
+    char name[TAC_NAME_MAX];
+    if (lw->vars && slot < lw->vars->count)
+        return tac_var(lw->prog, lw->vars->names[slot], strlen(lw->vars->names[slot]));
+    int len = snprintf(name, sizeof(name), "$%d", slot);
+    return tac_var(lw->prog, name, (size_t)len);
+}
+
+static TacOperand lower_node(Lowering *lw, const ASTNode *n)
+{
+    switch (n->type) {
+        case NODE_INT: return tac_const(lw->prog, n->int_value);
+        case NODE_VAR: return lower_var(lw, n->int_value);
+        default:       break;
+    }
+
+    size_t h = memo_slot(&lw->memo, n);
+    if (lw->memo.keys[h]) return lw->memo.vals[h];
+
+    TacOperand a = lower_node(lw, n->left);
+    TacOperand b = TAC_NO_OPERAND;
+    TacOp      op = TAC_NEG;
+    if (a == TAC_NO_OPERAND) return TAC_NO_OPERAND;
+    if (n->type == NODE_BINOP) {
+        b  = lower_node(lw, n->right);
+        op = n->op == '+' ? TAC_ADD : n->op == '-' ? TAC_SUB :
+             n->op == '*' ? TAC_MUL : TAC_DIV;
+        if (b == TAC_NO_OPERAND) return TAC_NO_OPERAND;
+    }
+
+    TacOperand t = tac_temp(lw->prog);
+    if (t == TAC_NO_OPERAND || tac_emit(lw->prog, op, t, a, b) != 0)
+        return TAC_NO_OPERAND;
+
+    h = memo_slot(&lw->memo, n);        /* the children may have filled our slot */
+    lw->memo.keys[h] = n;
+    lw->memo.vals[h] = t;
+    return t;
+}
+
+TacOperand tac_lower_expr(TacProgram *p, const ASTNode *root, const ExprVars *vars)
+{
+    if (!root) return TAC_NO_OPERAND;
+
+    size_t slots = 16;
+    while (slots < 2 * count_nodes(root)) slots *= 2;
+    Lowering lw = { p, vars, { calloc(slots, sizeof(ASTNode *)), malloc(slots * sizeof(TacOperand)), slots - 1 } };
+
+    TacOperand result = TAC_NO_OPERAND;
+    if (lw.memo.keys && lw.memo.vals)
+        result = lower_node(&lw, root);
+
+    free(lw.memo.keys);
+    free(lw.memo.vals);
+    return result;
+}
+
+int tac_lower_assign(TacProgram *p, const char *name, const ASTNode *root, const ExprVars *vars)
+{
+    TacOperand dst = tac_var(p, name, strlen(name));
+    TacOperand v   = dst == TAC_NO_OPERAND ? TAC_NO_OPERAND : tac_lower_expr(p, root, vars);
+    if (v == TAC_NO_OPERAND) return -1;
+    return tac_emit(p, TAC_ASSIGN, dst, v, TAC_NO_OPERAND);
+}
+
+int tac_lower_return(TacProgram *p, const ASTNode *root, const ExprVars *vars)
+{
+    TacOperand v = tac_lower_expr(p, root, vars);
+    if (v == TAC_NO_OPERAND) return -1;
+    return tac_emit(p, TAC_RET, TAC_NO_OPERAND, v, TAC_NO_OPERAND);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Printing
+ * ════════════════════════════════════════════════════════════════ */
+
+void print_tac_operand(const TacProgram *p, TacOperand o)
+{
+    switch (OPND_TAG(o)) {
+        case OPND_TEMP:  printf("t%u", OPND_INDEX(o));              break;
+        case OPND_VAR:   printf("%s", tac_var_name(p, o));          break;
+        case OPND_CONST: printf("%d", tac_const_value(p, o));       break;
+        case OPND_LABEL: printf("L%u", OPND_INDEX(o));              break;
+        default:         printf("_");                               break;
+    }
+}
+
+void print_tac_instr(const TacProgram *p, const TacInstr *in)
+{
+    static const char *binop[] = { "+", "-", "*", "/", "<<", ">>>", ">>" };
+
+    switch ((TacOp)in->op) {
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV:
+        case TAC_SHL: case TAC_SHR: case TAC_SAR:
+            printf("    ");
+            print_tac_operand(p, in->dst);
+            printf(" = ");
+            print_tac_operand(p, in->a);
+            printf(" %s ", binop[in->op - TAC_ADD]);
+            print_tac_operand(p, in->b);
+            break;
+        case TAC_NEG:
+        case TAC_ASSIGN:
+            printf("    ");
+            print_tac_operand(p, in->dst);
+            printf(in->op == TAC_NEG ? " = -" : " = ");
+            print_tac_operand(p, in->a);
+            break;
+        case TAC_LABEL:
+            printf("  ");
+            print_tac_operand(p, in->dst);
+            printf(":");
+            break;
+        case TAC_GOTO:
+            printf("    goto ");
+            print_tac_operand(p, in->dst);
+            break;
+        case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ:
+            printf("    if ");
+            print_tac_operand(p, in->a);
+            printf(in->op == TAC_IF_GT ? " > " : in->op == TAC_IF_LT ? " < " : " == ");
+            print_tac_operand(p, in->b);
+            printf(" goto ");
+            print_tac_operand(p, in->dst);
+            break;
+        case TAC_RET:
+            printf("    return ");
+            print_tac_operand(p, in->a);
+            break;
+        default:
+            printf("    <bad op %u>", in->op);
+            break;
+    }
+    printf("\n");
+}
+
+void print_tac(const TacProgram *p)
+{
+    for (uint32_t i = 0; i < p->count; i++) print_tac_instr(p, &p->code[i]);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Execution
+ * ════════════════════════════════════════════════════════════════ */
+
+int32_t tac_fold(TacOp op, int32_t a, int32_t b)
+{
+    switch (op) {
+        case TAC_ADD:    return wrap_add(a, b);
+        case TAC_SUB:    return wrap_sub(a, b);
+        case TAC_MUL:    return wrap_mul(a, b);
+        case TAC_DIV:    return safe_div(a, b);
+        case TAC_SHL:    return (int32_t)((uint32_t)a << (b & 31));
+        case TAC_SHR:    return (int32_t)((uint32_t)a >> (b & 31));
+        case TAC_SAR:    return a < 0 ? (int32_t)~(~(uint32_t)a >> (b & 31))
+                                      : (int32_t)((uint32_t)a >> (b & 31));
+        case TAC_NEG:    return wrap_neg(a);
+        case TAC_ASSIGN: return a;
+        default:         return 0;
+    }
+}
+
+int tac_branch_taken(TacOp op, int32_t a, int32_t b)
+{
+    return op == TAC_IF_GT ? a > b : op == TAC_IF_LT ? a < b : a == b;
+}
+
+int32_t tac_exec(const TacProgram *p, int32_t *vars, size_t *div_zero)
+{
+    int32_t  *temps  = calloc(p->n_temps ? p->n_temps : 1, sizeof(int32_t));
+    uint32_t *target = malloc((p->n_labels ? p->n_labels : 1) * sizeof(uint32_t));
+    size_t    zeros  = 0;
+    int32_t   result = 0;
+
+    if (!temps || !target) goto done;
+    for (uint32_t i = 0; i < p->count; i++)
+        if (p->code[i].op == TAC_LABEL) target[OPND_INDEX(p->code[i].dst)] = i;
+
+#define VAL(o)  (OPND_TAG(o) == OPND_TEMP  ? temps[OPND_INDEX(o)]  :   \
+                 OPND_TAG(o) == OPND_VAR   ? vars[OPND_INDEX(o)]   :   \
+                 OPND_TAG(o) == OPND_CONST ? p->consts[OPND_INDEX(o)] : 0)
+
+    for (uint32_t pc = 0; pc < p->count; pc++) {
+        const TacInstr *in = &p->code[pc];
+        int32_t v;
+        switch ((TacOp)in->op) {
+            case TAC_ADD: case TAC_SUB: case TAC_MUL:
+            case TAC_SHL: case TAC_SHR: case TAC_SAR:
+            case TAC_NEG: case TAC_ASSIGN:
+                v = tac_fold((TacOp)in->op, VAL(in->a), VAL(in->b));
+                break;
+            case TAC_DIV: {
+                int32_t y = VAL(in->b);
+                if (y == 0) zeros++;
+                v = tac_fold(TAC_DIV, VAL(in->a), y);
+                break;
+            }
+            case TAC_GOTO:
+                pc = target[OPND_INDEX(in->dst)];
+                continue;
+            case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ:
+                if (tac_branch_taken((TacOp)in->op, VAL(in->a), VAL(in->b)))
+                    pc = target[OPND_INDEX(in->dst)];
+                continue;
+            case TAC_RET:
+                result = VAL(in->a);
+                goto done;
+            default:
+                continue;       /* TAC_LABEL */
+        }
+        if (OPND_TAG(in->dst) == OPND_TEMP) temps[OPND_INDEX(in->dst)] = v;
+        else if (OPND_TAG(in->dst) == OPND_VAR) vars[OPND_INDEX(in->dst)] = v;
+    }
+#undef VAL
+
+done:
+    free(temps);
+    free(target);
+    if (div_zero) *div_zero = zeros;
+    return result;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Random test programs
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    TacProgram *p;
+    uint32_t    seed;
+    TacOperand  in[4];      /* variables a..d     */
+    TacOperand  loc[TAC_GEN_MAX_LOCALS];    /* t0 ..  */
+    uint32_t    n_loc;
+    TacOperand  ctr[2];     /* loop counters      */
+    int         oom;
+} Gen;
+
+static uint32_t gen_rand(Gen *g)
+{
+    g->seed = g->seed * 1103515245u + 12345u;
+    return g->seed >> 16;
+}
+
+static void gen_emit(Gen *g, TacOp op, TacOperand dst, TacOperand a, TacOperand b)
+{
+    if (tac_emit(g->p, op, dst, a, b) != 0) g->oom = 1;
+}
+
+static TacOperand gen_operand(Gen *g)
+{
+    uint32_t r = gen_rand(g) % 10;
+    if (r < 5) return g->loc[gen_rand(g) % g->n_loc];
+    if (r < 7) return g->in[gen_rand(g) % 4];
+    return tac_const(g->p, (int32_t)(gen_rand(g) % 10));
+}
+
+static void gen_block(Gen *g, int depth, int n_stmts)
+{
+    static const TacOp arith[] = { TAC_ADD, TAC_ADD, TAC_SUB, TAC_MUL, TAC_MUL,
+                                   TAC_DIV, TAC_NEG, TAC_ASSIGN };
+    static const TacOp cmp[]   = { TAC_IF_GT, TAC_IF_LT, TAC_IF_EQ };
+
+    for (int i = 0; i < n_stmts && !g->oom; i++) {
+        uint32_t r = gen_rand(g) % 100;
+
+        if (r < 12 && depth < 3) {              /* if (x cmp y) { ... } else { ... } */
+            TacOperand l_then = tac_label(g->p), l_end = tac_label(g->p);
+            TacOperand x = g->loc[gen_rand(g) % g->n_loc], y = gen_operand(g);
+            gen_emit(g, cmp[gen_rand(g) % 3], l_then, x, y);
+            gen_block(g, depth + 1, 1 + (int)(gen_rand(g) % 3));
+            gen_emit(g, TAC_GOTO, l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_emit(g, TAC_LABEL, l_then, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_block(g, depth + 1, 1 + (int)(gen_rand(g) % 3));
+            gen_emit(g, TAC_LABEL, l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        } else if (r < 16 && depth < 2) {       /* for (c = 0; c < k; c++) { ... } */
+            TacOperand c = g->ctr[depth];
+            TacOperand l_top = tac_label(g->p), l_body = tac_label(g->p), l_end = tac_label(g->p);
+            gen_emit(g, TAC_ASSIGN, c, tac_const(g->p, 0), TAC_NO_OPERAND);
+            gen_emit(g, TAC_LABEL, l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_emit(g, TAC_IF_LT, l_body, c, tac_const(g->p, 1 + (int32_t)(gen_rand(g) % 4)));
+            gen_emit(g, TAC_GOTO, l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_emit(g, TAC_LABEL, l_body, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_block(g, depth + 1, 1 + (int)(gen_rand(g) % 4));
+            gen_emit(g, TAC_ADD, c, c, tac_const(g->p, 1));
+            gen_emit(g, TAC_GOTO, l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+            gen_emit(g, TAC_LABEL, l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        } else {                                /* t = x op y */
+            TacOp op = arith[gen_rand(g) % 8];
+            TacOperand dst = gen_rand(g) % 10 ? g->loc[gen_rand(g) % g->n_loc] : g->in[gen_rand(g) % 4];
+            TacOperand a   = gen_operand(g);
+            TacOperand b   = op == TAC_NEG || op == TAC_ASSIGN ? TAC_NO_OPERAND : gen_operand(g);
+            gen_emit(g, op, dst, a, b);
+        }
+    }
+}
+
+int tac_generate(TacProgram *p, uint32_t n_instrs, uint32_t seed)
+{
+    return tac_generate_wide(p, n_instrs, 8, seed);
+}
+
+int tac_generate_wide(TacProgram *p, uint32_t n_instrs, uint32_t n_locals, uint32_t seed)
+{
+    Gen g = { p, seed, { 0 }, { 0 }, 0, { 0 }, 0 };
+    if (n_locals < 2 || n_locals > TAC_GEN_MAX_LOCALS) return -1;
+    g.n_loc = n_locals;
+    for (int i = 0; i < 4; i++) g.in[i] = tac_var(p, &"abcd"[i], 1);
+    for (uint32_t i = 0; i < g.n_loc; i++) g.loc[i] = tac_temp(p);
+    for (int i = 0; i < 2; i++) g.ctr[i] = tac_temp(p);
+
+    uint32_t start = p->count, half = g.n_loc / 2;
+    for (uint32_t i = 0; i < half; i++)
+        gen_emit(&g, TAC_ASSIGN, g.loc[i], tac_const(p, (int32_t)(gen_rand(&g) % 8)), TAC_NO_OPERAND);
+    for (uint32_t i = half; i < g.n_loc; i++)
+        gen_emit(&g, TAC_ADD, g.loc[i], g.in[i % 4], tac_const(p, (int32_t)i));
+
+    while (!g.oom && p->count - start + g.n_loc + 1 < n_instrs)
+        gen_block(&g, 0, 1);
+
+    TacOperand sum = tac_temp(p);
+    gen_emit(&g, TAC_ASSIGN, sum, g.loc[0], TAC_NO_OPERAND);
+    for (uint32_t i = 1; i < g.n_loc; i++) gen_emit(&g, TAC_ADD, sum, sum, g.loc[i]);
+    gen_emit(&g, TAC_RET, TAC_NO_OPERAND, sum, TAC_NO_OPERAND);
+    return g.oom ? -1 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Chapter 21 — Three-address code (shared module)
+ *
+ * A compact TAC: every instruction is one opcode and three 32-bit
+ * operands, 16 bytes, stored back to back in one growable buffer.
+ *
+ *   a = b + c * d            t0 = c * d
+ *                            t1 = b + t0
+ *                            a = t1
+ *
+ * An operand is a tagged index, not a string:
+ *
+ *    31   29 28                             0
+ *   ┌──────┬────────────────────────────────┐
+ *   │ tag  │ index                          │   tag: temp, var, const, label
+ *   └──────┴────────────────────────────────┘
+ *
+ * Temporaries and labels are just numbers; variables index the
+ * program's name table and constants its value table (each distinct
+ * value stored once).  Comparing two operands is one integer compare,
+ * and a pass can keep per-temp or per-variable facts in plain arrays.
+ *
+ * tac_lower_*() translate a chapter 19 expression AST (including
+ * variables and hash-consed DAGs, whose shared subtrees are lowered
+ * once).  Control flow has no source syntax in that language, so
+ * branches and loops are built directly with tac_emit().
+ *
+ * Arithmetic in tac_exec() wraps on overflow, x / 0 gives 0 and
+ * INT_MIN / -1 gives INT_MIN, as in the chapter 19 VM.  Shift counts
+ * are taken mod 32.  Every op is total, so an optimiser may evaluate
+ * one speculatively.
+ */
+
+#ifndef TAC_H
+#define TAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../19_parsing_ast/expr.h"
+
+/* ── Operands ────────────────────────────────────────────────── */
+typedef uint32_t TacOperand;
+
+typedef enum {
+    OPND_NONE,      /* unused operand slot           */
+    OPND_TEMP,      /* t<index>                      */
+    OPND_VAR,       /* vars[index]                   */
+    OPND_CONST,     /* consts[index]                 */
+    OPND_LABEL      /* L<index>                      */
+} TacTag;
+
+#define OPND_SHIFT       29
+#define OPND_MAX_INDEX   ((1u << OPND_SHIFT) - 1)
+#define OPND(tag, idx)   ((TacOperand)(((uint32_t)(tag) << OPND_SHIFT) | (uint32_t)(idx)))
+#define OPND_TAG(o)      ((TacTag)((o) >> OPND_SHIFT))
+#define OPND_INDEX(o)    ((uint32_t)(o) & OPND_MAX_INDEX)
+#define TAC_NO_OPERAND   ((TacOperand)0)
+
+/* ── Instructions ────────────────────────────────────────────── */
+typedef enum {
+    TAC_ADD,        /* dst = a + b                   */
+    TAC_SUB,        /* dst = a - b                   */
+    TAC_MUL,        /* dst = a * b                   */
+    TAC_DIV,        /* dst = a / b                   */
+    TAC_SHL,        /* dst = a << b                  */
+    TAC_SHR,        /* dst = a >>> b  (logical)      */
+    TAC_SAR,        /* dst = a >> b   (arithmetic)   */
+    TAC_NEG,        /* dst = -a                      */
+    TAC_ASSIGN,     /* dst = a                       */
+    TAC_LABEL,      /* dst:                          */
+    TAC_GOTO,       /* goto dst                      */
+    TAC_IF_GT,      /* if a > b goto dst             */
+    TAC_IF_LT,      /* if a < b goto dst             */
+    TAC_IF_EQ,      /* if a == b goto dst            */
+    TAC_RET,        /* return a                      */
+    TAC_OP_COUNT
+} TacOp;
+
+/* Which slots an op uses: TAC_ADD .. TAC_ASSIGN write dst, the binary
+ * ops and the branches read b as well as a */
+static inline int tac_writes_dst(int op) { return op <= TAC_ASSIGN; }
+static inline int tac_reads_b(int op)    { return op <= TAC_SAR || (op >= TAC_IF_GT && op <= TAC_IF_EQ); }
+static inline int tac_is_branch(int op)  { return op >= TAC_IF_GT && op <= TAC_IF_EQ; }
+
+typedef struct {
+    uint8_t    op;          /* TacOp */
+    uint8_t    pad[3];
+    TacOperand dst;
+    TacOperand a;
+    TacOperand b;
+} TacInstr;                 /* 16 bytes */
+
+#define TAC_NAME_MAX 32
+
+typedef struct {
+    TacInstr *code;
+    uint32_t  count;
+    uint32_t  cap;
+
+    int32_t  *consts;                   /* constant table              */
+    uint32_t  n_consts;
+    uint32_t  consts_cap;
+    uint32_t *const_slots;              /* value → index + 1, 0 = empty */
+    uint32_t  n_const_slots;            /* power of two                */
+
+    char    (*vars)[TAC_NAME_MAX];      /* variable name table         */
+    uint32_t  n_vars;
+    uint32_t  vars_cap;
+
+    uint32_t  n_temps;
+    uint32_t  n_labels;
+} TacProgram;
+
+void tac_init(TacProgram *p);
+void tac_free(TacProgram *p);
+
+/* Operand constructors.  All return TAC_NO_OPERAND on OOM or when the
+ * index space (or TAC_NAME_MAX) is exceeded. */
+TacOperand tac_temp(TacProgram *p);                     /* a fresh temporary */
+TacOperand tac_label(TacProgram *p);                    /* a fresh label     */
+TacOperand tac_const(TacProgram *p, int32_t value);     /* interned          */
+TacOperand tac_var(TacProgram *p, const char *name, size_t len);   /* find or add */
+
+int32_t     tac_const_value(const TacProgram *p, TacOperand o);
+const char *tac_var_name(const TacProgram *p, TacOperand o);
+
+/* Append one instruction.  0 on success, -1 on OOM. */
+int tac_emit(TacProgram *p, TacOp op, TacOperand dst, TacOperand a, TacOperand b);
+
+/* ── Lowering from the chapter 19 AST ───────────────────────── */
+/*
+ * The operand holding root's value: a constant or variable for a leaf,
+ * otherwise a temporary computed by the instructions appended to p.
+ * NODE_VAR slot i maps to the TAC variable vars->names[i] ("$i" when
+ * vars is NULL).  TAC_NO_OPERAND on failure.
+ */
+TacOperand tac_lower_expr(TacProgram *p, const ASTNode *root, const ExprVars *vars);
+
+/* name = root;  and  return root;   0 on success, -1 on failure */
+int tac_lower_assign(TacProgram *p, const char *name, const ASTNode *root, const ExprVars *vars);
+int tac_lower_return(TacProgram *p, const ASTNode *root, const ExprVars *vars);
+
+/* ── Semantics ───────────────────────────────────────────────── */
+/* The value of an arithmetic op (TAC_ADD .. TAC_ASSIGN; b ignored for
+ * NEG and ASSIGN), exactly as tac_exec() computes it: wrapping, with
+ * x / 0 = 0 and INT_MIN / -1 = INT_MIN.  Optimisers fold with this. */
+int32_t tac_fold(TacOp op, int32_t a, int32_t b);
+/* Whether a TAC_IF_* with operand values a, b jumps */
+int     tac_branch_taken(TacOp op, int32_t a, int32_t b);
+
+/* ── Printing and execution ─────────────────────────────────── */
+void print_tac_operand(const TacProgram *p, TacOperand o);
+void print_tac_instr(const TacProgram *p, const TacInstr *in);
+void print_tac(const TacProgram *p);
+
+/*
+ * Run p with variable i starting at vars[i] (p->n_vars entries, updated
+ * in place).  Returns the value of the first TAC_RET reached, or 0 if
+ * execution falls off the end (or memory runs out).  *div_zero, if
+ * non-NULL, receives the number of divisions by zero performed.
+ */
+int32_t tac_exec(const TacProgram *p, int32_t *vars, size_t *div_zero);
+
+/* ── Test programs ───────────────────────────────────────────── */
+/*
+ * Append a random structured program of roughly n_instrs instructions:
+ * arithmetic, if/else diamonds and small counted loops (nested at most
+ * two deep) over the temporaries t0..t7 and the variables a, b, c, d
+ * (mostly read, now and then written), returning the sum of t0..t7.  t0..t3 start out as constants,
+ * so many values and branches can be folded.  Deterministic for a given
+ * seed; the program always terminates.  0 on success, -1 on OOM.
+ */
+int tac_generate(TacProgram *p, uint32_t n_instrs, uint32_t seed);
+
+/* The same over n_locals temporaries (2 .. TAC_GEN_MAX_LOCALS; half of
+ * them start as constants), all live to the final sum: register
+ * pressure for the chapter 23 allocator.  tac_generate() is n_locals = 8. */
+#define TAC_GEN_MAX_LOCALS 64
+int tac_generate_wide(TacProgram *p, uint32_t n_instrs, uint32_t n_locals, uint32_t seed);
+
+#endif /* TAC_H */
@@ -0,0 +1,454 @@
+/*
+ * Loop optimisation microbenchmarks — chapter 22
+ *
+ * Each transformation Section 5 describes, as a before/after kernel pair:
+ *
+ *   licm         out[i] = a[i] + x / y     vs  t = x / y hoisted
+ *   unroll       sum += a[i], one chain    vs  four accumulators, unrolled by 4
+ *   vectorise    c[i] = a[i] * k + b[i]    vs  GNU C vectors, 4 lanes
+ *                one element at a time
+ *   interchange  for (j) for (i) m[i][j]   vs  for (i) for (j) m[i][j]
+ *
+ * The "before" kernels pin the untransformed shape with empty asm
+ * statements: an operand the compiler must assume changes every
+ * iteration (so x / y cannot be hoisted, the sum stays one dependence
+ * chain, and nothing is vectorised or interchanged).  Without them -O2
+ * would quietly apply the transformation to the baseline too.  The
+ * "after" kernels are written transformed by hand.  Every result goes
+ * through bench_escape(), so neither kernel can be deleted as dead.
+ *
+ * Sizes are working sets (all of a kernel's arrays together) chosen to
+ * sit in L1, L2, the last-level cache and DRAM.  Each measurement is
+ * one warmup run that also calibrates how many kernel calls make a
+ * sample of about --sample-ms, then --reps samples; the report is the
+ * median ns per element with its median absolute deviation (MAD), the
+ * bandwidth that implies and the before/after speedup.  Before and after
+ * must agree on their checksum.  Hardware counters over the samples
+ * (perfctr.c, chapter 33) add each kernel's IPC and its cache, branch
+ * and dTLB misses per 1000 instructions, where the kernel allows them.
+ *
+ * The Makefile builds this file three times, so each level can be run
+ * side by side (make bench_loops_compare):
+ *
+ *   bin/bench_loops_O0       -O0
+ *   bin/bench_loops_O2       -O2
+ *   bin/bench_loops_O3       -O3 -march=native
+ *
+ * Build: make bench_loops
+ * Run:   ./bin/bench_loops_O2 [--kernel licm|unroll|vectorise|interchange|all]
+ *                             [--max-mb MB] [--reps R] [--sample-ms MS]
+ *                             [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "../33_debugging_tools/perfctr.h"
+
+#ifndef BENCH_OPT_LEVEL
+#define BENCH_OPT_LEVEL "?"
+#endif
+
+/* ════════════════════════════════════════════════════════════════
+ *  Kernels — each returns a checksum of what it computed
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint32_t *a, *b, *c;    /* n elements each (interchange: a is side × side) */
+    size_t    n;
+    size_t    side;
+    uint32_t  x, y;
+} Data;
+
+static uint32_t checksum(const uint32_t *v, size_t n)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i += 61) h = (h ^ v[i]) * 16777619u;
+    return h ^ v[n - 1];
+}
+
+/* ── LICM ─────────────────────────────────────────────────── */
+static uint32_t licm_before(Data *d)
+{
+    uint32_t *a = d->a, *out = d->c, x = d->x, y = d->y;
+    for (size_t i = 0; i < d->n; i++) {
+        BENCH_OPAQUE(x);                    /* x "changes": x / y stays in the loop */
+        out[i] = a[i] + x / y;
+    }
+    bench_escape(out);
+    return checksum(out, d->n);
+}
+
+static uint32_t licm_after(Data *d)
+{
+    uint32_t *a = d->a, *out = d->c, x = d->x, y = d->y;
+    uint32_t  t = x / y;
+    for (size_t i = 0; i < d->n; i++) out[i] = a[i] + t;
+    bench_escape(out);
+    return checksum(out, d->n);
+}
+
+/* ── Unrolling ────────────────────────────────────────────── */
+static uint32_t unroll_before(Data *d)
+{
+    const uint32_t *a = d->a;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < d->n; i++) {
+        sum += a[i];
+        BENCH_OPAQUE(sum);                  /* one add per iteration, in order */
+    }
+    return sum;
+}
+
+/* Four independent chains: each BENCH_OPAQUE still stops vectorisation, so
+ * the only difference from the baseline is the unrolling itself */
+static uint32_t unroll_after(Data *d)
+{
+    const uint32_t *a = d->a;
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t   i  = 0;
+    for (; i + 4 <= d->n; i += 4) {
+        s0 += a[i];
+        s1 += a[i + 1];
+        s2 += a[i + 2];
+        s3 += a[i + 3];
+        BENCH_OPAQUE(s0);
+        BENCH_OPAQUE(s1);
+        BENCH_OPAQUE(s2);
+        BENCH_OPAQUE(s3);
+    }
+    for (; i < d->n; i++) s0 += a[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+/* ── Vectorisation ────────────────────────────────────────── */
+typedef uint32_t V4 __attribute__((vector_size(16)));
+
+static uint32_t vectorise_before(Data *d)
+{
+    const uint32_t *a = d->a, *b = d->b;
+    uint32_t *c = d->c, k = d->x;
+    for (size_t i = 0; i < d->n; i++) {
+        uint32_t v = a[i] * k;
+        BENCH_OPAQUE(v);                    /* one lane at a time */
+        c[i] = v + b[i];
+    }
+    bench_escape(c);
+    return checksum(c, d->n);
+}
+
+static uint32_t vectorise_after(Data *d)
+{
+    const uint32_t *a = d->a, *b = d->b;
+    uint32_t *c = d->c, k = d->x;
+    V4     kv = { k, k, k, k };
+    size_t i  = 0;
+    for (; i + 4 <= d->n; i += 4) {
+        V4 va, vb;
+        memcpy(&va, a + i, sizeof(va));     /* no alignment assumed */
+        memcpy(&vb, b + i, sizeof(vb));
+        V4 vc = va * kv + vb;
+        memcpy(c + i, &vc, sizeof(vc));
+    }
+    for (; i < d->n; i++) c[i] = a[i] * k + b[i];
+    bench_escape(c);
+    return checksum(c, d->n);
+}
+
+/* ── Interchange ──────────────────────────────────────────── */
+static uint32_t interchange_before(Data *d)
+{
+    const uint32_t *m = d->a;
+    size_t   side = d->side;
+    uint32_t sum  = 0;
+    for (size_t j = 0; j < side; j++)
+        for (size_t i = 0; i < side; i++) {
+            sum += m[i * side + j] * (uint32_t)(j + 1);     /* stride: side * 4 bytes */
+            BENCH_OPAQUE(sum);
+        }
+    return sum;
+}
+
+static uint32_t interchange_after(Data *d)
+{
+    const uint32_t *m = d->a;
+    size_t   side = d->side;
+    uint32_t sum  = 0;
+    for (size_t i = 0; i < side; i++)
+        for (size_t j = 0; j < side; j++) {
+            sum += m[i * side + j] * (uint32_t)(j + 1);     /* stride: 4 bytes */
+            BENCH_OPAQUE(sum);
+        }
+    return sum;
+}
+
+typedef uint32_t (*KernelFn)(Data *d);
+
+typedef struct {
+    const char *name;
+    KernelFn    before, after;
+    int         arrays;             /* n-element arrays in the working set   */
+    int         bytes_per_elem;     /* bytes read + written per element      */
+} Kernel;
+
+static const Kernel kernels[] = {
+    { "licm",        licm_before,        licm_after,        2,  8 },
+    { "unroll",      unroll_before,      unroll_after,      1,  4 },
+    { "vectorise",   vectorise_before,   vectorise_after,   3, 12 },
+    { "interchange", interchange_before, interchange_after, 1,  4 },
+};
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/* ════════════════════════════════════════════════════════════════
+ *  Measurement
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    double   ns_per_elem;       /* median */
+    double   mad;               /* median absolute deviation, ns/elem */
+    uint32_t sum;
+    int      calls;             /* kernel calls per sample */
+    PerfSample counters;        /* over all the samples */
+} Sample;
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, int n)
+{
+    qsort(v, (size_t)n, sizeof(*v), cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static void measure(KernelFn fn, Data *d, int reps, double sample_ms, Sample *out)
+{
+    /* Warmup: pages faulted in, caches and predictors trained; its time
+     * decides the calls per sample */
+    uint64_t t0 = bench_now_ns();
+    out->sum    = fn(d);
+    uint64_t one = bench_now_ns() - t0;
+    out->calls  = one > 0 ? (int)(sample_ms * 1e6 / (double)one) : 1000;
+    if (out->calls < 1)    out->calls = 1;
+    if (out->calls > 1000) out->calls = 1000;
+
+    double v[64], dev[64];
+    PerfSample start, end;
+    perfctr_read(&start);
+    for (int r = 0; r < reps; r++) {
+        t0 = bench_now_ns();
+        for (int c = 0; c < out->calls; c++) out->sum = fn(d);
+        v[r] = (double)(bench_now_ns() - t0) / ((double)out->calls * (double)d->n);
+    }
+    perfctr_read(&end);
+    perfctr_diff(&start, &end, &out->counters);
+    out->ns_per_elem = median(v, reps);
+    for (int r = 0; r < reps; r++) dev[r] = v[r] > out->ns_per_elem ? v[r] - out->ns_per_elem
+                                                                    : out->ns_per_elem - v[r];
+    out->mad = median(dev, reps);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Configuration and report
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *label;
+    size_t      bytes;          /* working set */
+} Size;
+
+static const Size sizes[] = {
+    { "L1",   16u << 10 },
+    { "L2",  192u << 10 },
+    { "LLC",   4u << 20 },
+    { "DRAM", 64u << 20 },
+};
+#define SIZE_COUNT ((int)(sizeof(sizes) / sizeof(sizes[0])))
+
+typedef struct {
+    int            kernel;      /* -1 = all */
+    size_t         max_mb;
+    int            reps;
+    double         sample_ms;
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--kernel licm|unroll|vectorise|interchange|all] [--max-mb MB]\n"
+            "       %*s [--reps R] [--sample-ms MS] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--kernel") == 0) {
+            cfg->kernel = -2;
+            if (strcmp(val, "all") == 0) cfg->kernel = -1;
+            for (int k = 0; k < KERNEL_COUNT; k++)
+                if (strcmp(val, kernels[k].name) == 0) cfg->kernel = k;
+            if (cfg->kernel == -2) return -1;
+        } else if (strcmp(opt, "--max-mb") == 0) {
+            cfg->max_mb = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--sample-ms") == 0) {
+            cfg->sample_ms = atof(val);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && cfg->reps <= 64 && cfg->sample_ms > 0 ? 0 : -1;
+}
+
+/* Counter-derived columns; -1 (not counted) is "-", empty or null */
+static const struct {
+    const char *key;
+    PerfCounter c;              /* PERF_CYCLES: IPC */
+} rates[] = {
+    { "ipc",         PERF_CYCLES },
+    { "cache_mpki",  PERF_CACHE_MISSES },
+    { "branch_mpki", PERF_BRANCH_MISSES },
+    { "dtlb_mpki",   PERF_DTLB_MISSES },
+};
+#define RATE_COUNT ((int)(sizeof(rates) / sizeof(rates[0])))
+
+static double rate(const Sample *s, int i)
+{
+    return rates[i].c == PERF_CYCLES ? perfctr_ipc(&s->counters) : perfctr_per_kinstr(&s->counters, rates[i].c);
+}
+
+static void report(const Config *cfg, const Kernel *k, const Size *s, size_t ws,
+                   const Sample *b, const Sample *a, int first)
+{
+    double gbs_b = k->bytes_per_elem / b->ns_per_elem, gbs_a = k->bytes_per_elem / a->ns_per_elem;
+    double speedup = b->ns_per_elem / a->ns_per_elem;
+    int    same    = a->sum == b->sum;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT: {
+        char ipc_b[16] = "-", ipc_a[16] = "-";
+        if (rate(b, 0) >= 0) snprintf(ipc_b, sizeof(ipc_b), "%.2f", rate(b, 0));
+        if (rate(a, 0) >= 0) snprintf(ipc_a, sizeof(ipc_a), "%.2f", rate(a, 0));
+        printf("  %-11s %-4s %8.0f KiB  %7.3f ±%-6.3f %7.3f ±%-6.3f %7.2f %7.2f %7.2fx %5s %5s  %s\n",
+               k->name, s->label, (double)ws / 1024, b->ns_per_elem, b->mad, a->ns_per_elem, a->mad,
+               gbs_b, gbs_a, speedup, ipc_b, ipc_a, same ? "✓" : "CHECKSUM DIFFERS");
+        break;
+    }
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%s,%zu,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%d", BENCH_OPT_LEVEL, k->name,
+               s->label, ws, b->ns_per_elem, b->mad, a->ns_per_elem, a->mad, gbs_b, gbs_a, speedup, same);
+        for (int half = 0; half < 2; half++)
+            for (int i = 0; i < RATE_COUNT; i++) {
+                double v = rate(half ? a : b, i);
+                if (v < 0) printf(",");
+                else       printf(",%.3f", v);
+            }
+        printf("\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"kernel\": \"%s\", \"size\": \"%s\", \"bytes\": %zu, "
+               "\"before_ns_per_elem\": %.4f, \"before_mad\": %.4f, "
+               "\"after_ns_per_elem\": %.4f, \"after_mad\": %.4f, "
+               "\"before_gb_s\": %.3f, \"after_gb_s\": %.3f, \"speedup\": %.3f, \"same_result\": %s",
+               first ? "" : ",", k->name, s->label, ws, b->ns_per_elem, b->mad, a->ns_per_elem,
+               a->mad, gbs_b, gbs_a, speedup, same ? "true" : "false");
+        for (int half = 0; half < 2; half++)
+            for (int i = 0; i < RATE_COUNT; i++) {
+                double v = rate(half ? a : b, i);
+                if (v < 0) printf(", \"%s_%s\": null", half ? "after" : "before", rates[i].key);
+                else       printf(", \"%s_%s\": %.3f", half ? "after" : "before", rates[i].key, v);
+            }
+        printf(" }");
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { -1, 64, 11, 5.0, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_loops %s: %d reps of ~%.0f ms, median ± MAD\n\n", BENCH_OPT_LEVEL,
+               cfg.reps, cfg.sample_ms);
+        printf("  %-11s %-4s %12s  %-15s %-15s %7s %7s %8s %5s %5s\n", "kernel", "size", "working set",
+               "before ns/el", "after ns/el", "before", "after", "speedup", "IPC", "IPC");
+        printf("  %-11s %-4s %12s  %-15s %-15s %7s %7s %8s %5s %5s\n", "", "", "", "", "", "GB/s", "GB/s", "",
+               "bef.", "aft.");
+        break;
+    case BENCH_FMT_CSV:
+        printf("level,kernel,size,bytes,before_ns_per_elem,before_mad,after_ns_per_elem,"
+               "after_mad,before_gb_s,after_gb_s,speedup,same_result,"
+               "before_ipc,before_cache_mpki,before_branch_mpki,before_dtlb_mpki,"
+               "after_ipc,after_cache_mpki,after_branch_mpki,after_dtlb_mpki\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"loops\",\n  \"level\": \"%s\",\n  \"results\": [", BENCH_OPT_LEVEL);
+        break;
+    }
+
+    int all_same = 1, first = 1;
+    for (int s = 0; s < SIZE_COUNT; s++) {
+        if (sizes[s].bytes > cfg.max_mb << 20) continue;
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+            if (cfg.kernel >= 0 && cfg.kernel != k) continue;
+            const Kernel *kn = &kernels[k];
+
+            Data d = { 0 };
+            d.n = sizes[s].bytes / ((size_t)kn->arrays * sizeof(uint32_t));
+            if (kn->before == interchange_before) {
+                for (d.side = 1; (d.side + 1) * (d.side + 1) <= d.n; d.side++) {}
+                d.n = d.side * d.side;
+            }
+            d.a = malloc(d.n * sizeof(uint32_t));
+            d.b = malloc(d.n * sizeof(uint32_t));
+            d.c = malloc(d.n * sizeof(uint32_t));
+            if (!d.a || !d.b || !d.c) {
+                fprintf(stderr, "out of memory\n");
+                free(d.a); free(d.b); free(d.c);
+                return 1;
+            }
+            for (size_t i = 0; i < d.n; i++) {
+                d.a[i] = (uint32_t)(i * 2654435761u) >> 8;
+                d.b[i] = (uint32_t)i ^ 0x5bd1e995u;
+            }
+            d.x = 1000003u + (uint32_t)s;
+            d.y = 7u;
+
+            Sample before, after;
+            measure(kn->before, &d, cfg.reps, cfg.sample_ms, &before);
+            measure(kn->after,  &d, cfg.reps, cfg.sample_ms, &after);
+            all_same &= before.sum == after.sum;
+            report(&cfg, kn, &sizes[s], (size_t)kn->arrays * d.n * sizeof(uint32_t), &before, &after, first);
+            first = 0;
+            free(d.a); free(d.b); free(d.c);
+        }
+        if (cfg.format == BENCH_FMT_TEXT && cfg.kernel < 0) printf("\n");
+    }
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"same_results\": %s\n}\n", all_same ? "true" : "false");
+    else if (cfg.format == BENCH_FMT_TEXT) {
+        printf("  Before and after %s on every checksum.\n", all_same ? "agree" : "DISAGREE");
+        if (perfctr_status()[0]) printf("  Counters: %s\n", perfctr_status());
+    }
+    return all_same ? 0 : 1;
+}
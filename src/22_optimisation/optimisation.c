@@ -2,13 +2,137 @@
  * ║  Chapter 22 — Optimisation Passes                               ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: Constant folding, DCE, strength reduction, inlining    ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Sections 2, 3, 4, 5, 7 and 10 run the real passes in passes.c on
+ * chapter 21 three-address code and check every result by executing
+ * the program before and after.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/22_optimisation \
+ *            src/22_optimisation/optimisation.c src/22_optimisation/passes.c \
+ *            src/21_intermediate_repr/tac.c src/21_intermediate_repr/cfg.c \
+ *            src/21_intermediate_repr/ssa.c src/19_parsing_ast/expr.c
+ * Run:   ./bin/22_optimisation                 (the chapter)
+ *        ./bin/22_optimisation -O2 [--size N] [--seed S] [--print]
+ *        ./bin/22_optimisation --passes fold,cse,dce [--size N] ...
+ */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "bench.h"
+#include "passes.h"
+
+#define MAX_VARS 32     /* variables a demo program may have */
+
+/* ════════════════════════════════════════════════════════════════════
+ *  Helpers — TAC from little programs, and checking a pass's work
+ * ════════════════════════════════════════════════════════════════════ */
+
+/* "x = 3 * 4; y = x + 1; return y": each statement parsed by the
+ * chapter 19 front-end and lowered to TAC.  0 on success. */
+static int lower_program(TacProgram *p, const char *src)
+{
+    ExprVars vars;
+    char     stmt[256];
+    expr_vars_init(&vars);
+    while (*src) {
+        size_t len = strcspn(src, ";");
+        if (len >= sizeof(stmt)) return -1;
+        memcpy(stmt, src, len);
+        stmt[len] = '\0';
+        src += len + (src[len] == ';');
+
+        char *s = stmt;
+        while (*s == ' ') s++;
+        if (!*s) continue;
+        int   is_ret = strncmp(s, "return ", 7) == 0;
+        char *eq     = is_ret ? NULL : strchr(s, '=');
+        char *expr   = is_ret ? s + 7 : eq ? eq + 1 : NULL;
+        if (!expr) return -1;
+        if (eq) {
+            char *end = eq;
+            while (end > s && end[-1] == ' ') end--;
+            *end = '\0';
+        }
+
+        Parser parser;
+        parser_init(&parser, expr);
+        parser_set_vars(&parser, &vars);
+        ASTNode *root = parse_expr(&parser);
+        int rc = !root ? -1 : is_ret ? tac_lower_return(p, root, &vars)
+                                     : tac_lower_assign(p, s, root, &vars);
+        free_ast(root);
+        if (rc != 0) return -1;
+    }
+    return 0;
+}
+
+/* Run before and after on the same random inputs; the number of runs
+ * whose return value or final variables differ */
+static int count_mismatches(const TacProgram *before, const TacProgram *after, int runs, unsigned *seed)
+{
+    int bad = 0;
+    if (before->n_vars > MAX_VARS) return runs;
+    for (int r = 0; r < runs; r++) {
+        int32_t x[MAX_VARS] = { 0 }, y[MAX_VARS] = { 0 };
+        for (uint32_t v = 0; v < before->n_vars; v++) {
+            *seed = *seed * 1103515245u + 12345u;
+            x[v] = y[v] = (int32_t)((*seed >> 16) % 61) - 30;
+        }
+        bad += tac_exec(before, x, NULL) != tac_exec(after, y, NULL) || memcmp(x, y, sizeof(x)) != 0;
+    }
+    return bad;
+}
+
+static int copy_program(TacProgram *dst, const TacProgram *src)
+{
+    tac_init(dst);
+    for (uint32_t v = 0; v < src->n_vars; v++)
+        if (tac_var(dst, src->vars[v], strlen(src->vars[v])) == TAC_NO_OPERAND) return -1;
+    for (uint32_t c = 0; c < src->n_consts; c++)
+        if (tac_const(dst, src->consts[c]) == TAC_NO_OPERAND) return -1;   /* same indices */
+    for (uint32_t i = 0; i < src->count; i++) {
+        const TacInstr *in = &src->code[i];
+        if (tac_emit(dst, (TacOp)in->op, in->dst, in->a, in->b) != 0) return -1;
+    }
+    dst->n_temps  = src->n_temps;
+    dst->n_labels = src->n_labels;
+    return 0;
+}
+
+/* Before, after, the pass report and a 64-run behaviour check */
+static void show_passes(TacProgram *p, const char *spec)
+{
+    TacProgram  orig;
+    OptPipeline pl;
+    OptReport   r;
+    unsigned    seed = 22;
+
+    if (opt_parse(&pl, spec) != 0 || copy_program(&orig, p) != 0) {
+        printf("  (setup failed)\n");
+        return;
+    }
+    printf("  Before:\n");
+    print_tac(p);
+    if (opt_run(p, &pl, &r) != 0) {
+        printf("  (out of memory)\n");
+        tac_free(&orig);
+        return;
+    }
+    printf("\n  After %s:\n", spec);
+    print_tac(p);
+    printf("\n");
+    print_opt_report(&r);
+    int bad = count_mismatches(&orig, p, 64, &seed);
+    printf("\n  64 runs on random inputs, before vs after: %d mismatches %s\n\n", bad, bad ? "✗" : "✓");
+    tac_free(&orig);
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — Why Optimise?
  * ════════════════════════════════════════════════════════════════════ */
@@ -48,24 +172,24 @@ static void demo_constant_folding(void)
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
     printf("Constant folding evaluates expressions whose operands are\n");
-    printf("known at compile time, replacing them with the result.\n\n");
+    printf("known at compile time, replacing them with the result.\n");
+    printf("Constant propagation feeds it: once width = 10 is known, every\n");
+    printf("later read of width in the block is the constant 10.\n\n");
 
-    printf("  Before:  int x = 3 * 4 + 1;\n");
-    printf("  After:   int x = 13;          ← computed at compile time\n\n");
+    printf("  Source:  width = 10; height = 20;\n");
+    printf("           area = width * height + 3 * 4;  return area * 1 - 0\n\n");
 
-    printf("  Before:  int y = sizeof(int) * 8;\n");
-    printf("  After:   int y = 32;\n\n");
+    TacProgram p;
+    tac_init(&p);
+    if (lower_program(&p, "width = 10; height = 20; area = width * height + 3 * 4;"
+                          "return area * 1 - 0") == 0)
+        show_passes(&p, "fold,dce");
+    tac_free(&p);
 
-    /* Demonstrate: the compiler will fold this */
-    int a = 3 * 4 + 1;   /* compiler folds to 13 */
-    int b = 100 / 5 - 3;  /* compiler folds to 17 */
-    printf("  Demo: a = 3*4+1 = %d, b = 100/5-3 = %d\n", a, b);
-    printf("  (At -O2, no multiply/divide instructions are generated.)\n\n");
-
-    printf("  Constant propagation extends this:\n");
-    printf("    int width = 10;\n");
-    printf("    int height = 20;\n");
-    printf("    int area = width * height;  →  int area = 200;\n\n");
+    printf("  The fold pass also applies identities that hold for every x:\n");
+    printf("  x + 0, x - 0, x * 1, x / 1 → x;  x * 0, 0 / x, x - x → 0;\n");
+    printf("  0 - x, x * -1 → -x.  The dce pass then drops the temporaries\n");
+    printf("  nothing reads any more.\n\n");
 
     printf("╔══════════════════════════════════════════════════════════╗\n");
     printf("║  Compare assembly:                                      ║\n");
@@ -78,20 +202,6 @@ static void demo_constant_folding(void)
 /* ════════════════════════════════════════════════════════════════════
  *  Section 3 — Dead Code Elimination (DCE)
  * ════════════════════════════════════════════════════════════════════ */
-
-/* This function has unreachable code after return */
-static int dce_example(int x)
-{
-    if (x > 0)
-        return x;
-    else
-        return -x;
-
-    /* Dead code — never reached.  The compiler removes it at -O2. */
-    printf("This line is dead code!\n");
-    return 0;
-}
-
 static void demo_dead_code_elimination(void)
 {
     printf("\n╔══════════════════════════════════════════════════════════╗\n");
@@ -99,21 +209,40 @@ static void demo_dead_code_elimination(void)
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
     printf("DCE removes code that can never execute or whose result\n");
-    printf("is never used.\n\n");
-
-    printf("  Example 1 — Unreachable code:\n");
-    printf("    return x;\n");
-    printf("    printf(\"dead!\");  ← removed by compiler\n\n");
-
-    printf("  Example 2 — Unused variable:\n");
-    printf("    int unused = expensive_function();  ← removed if pure\n\n");
-
-    printf("  Example 3 — Constant condition:\n");
-    printf("    if (0) { ... }   ← entire block removed\n\n");
-
-    printf("  Demo: dce_example(5)  = %d\n", dce_example(5));
-    printf("  Demo: dce_example(-3) = %d\n", dce_example(-3));
-    printf("  (The dead printf was never executed.)\n\n");
+    printf("is never used.  Here fold decides a constant branch, which\n");
+    printf("leaves the else-arm unreachable; liveness then finds the\n");
+    printf("temporaries nobody reads.\n\n");
+
+    printf("  Source C:  t = x * 2;            ← never used\n");
+    printf("             k = 0;\n");
+    printf("             if (k > 0) y = x * 100; else y = x + 1;\n");
+    printf("             u = y * y;            ← never used\n");
+    printf("             return y;\n\n");
+
+    TacProgram p;
+    tac_init(&p);
+    {
+        TacOperand x = tac_var(&p, "x", 1), k = tac_var(&p, "k", 1), y = tac_var(&p, "y", 1);
+        TacOperand t0 = tac_temp(&p), t1 = tac_temp(&p), t2 = tac_temp(&p);
+        TacOperand l_then = tac_label(&p), l_end = tac_label(&p);
+        tac_emit(&p, TAC_MUL,    t0, x, tac_const(&p, 2));
+        tac_emit(&p, TAC_ASSIGN, k, tac_const(&p, 0), TAC_NO_OPERAND);
+        tac_emit(&p, TAC_IF_GT,  l_then, k, tac_const(&p, 0));
+        tac_emit(&p, TAC_ADD,    y, x, tac_const(&p, 1));
+        tac_emit(&p, TAC_GOTO,   l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_LABEL,  l_then, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_MUL,    t1, x, tac_const(&p, 100));
+        tac_emit(&p, TAC_ASSIGN, y, t1, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_LABEL,  l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_MUL,    t2, y, y);
+        tac_emit(&p, TAC_RET,    TAC_NO_OPERAND, y, TAC_NO_OPERAND);
+        show_passes(&p, "fold,dce");
+    }
+    tac_free(&p);
+
+    printf("  Variables are the program's outputs, so k = 0 and y stay: only\n");
+    printf("  temporaries can die.  A `goto` to the very next label and\n");
+    printf("  labels no jump uses go too.\n\n");
 
     printf("  With -Wall, GCC warns:\n");
     printf("    warning: will never be executed [-Wunreachable-code]\n\n");
@@ -141,12 +270,18 @@ static void demo_strength_reduction(void)
     printf("  │ x * 15                 │ (x<<4) - x                  │\n");
     printf("  └────────────────────────┴─────────────────────────────┘\n\n");
 
-    int x = 42;
-    printf("  Demo: x = %d\n", x);
-    printf("    x * 8  = %d   (compiler uses: x << 3)\n", x * 8);
-    printf("    x / 4  = %d   (compiler uses: x >> 2)\n", x / 4);
-    printf("    x %% 8  = %d    (compiler uses: x & 7)\n", x % 8);
-    printf("\n");
+    printf("  For a signed x, x / 4 is not just x >> 2: division rounds\n");
+    printf("  toward zero and the shift toward -∞ (-7 / 4 = -1, -7 >> 2 = -2).\n");
+    printf("  The pass adds 3 to negative x first, computed without a branch\n");
+    printf("  from the sign bit (>>> is the logical shift):\n\n");
+
+    TacProgram p;
+    tac_init(&p);
+    if (lower_program(&p, "a = x * 8; b = x / 4; c = 16 * x; d = x * 7; return a + b + c + d") == 0)
+        show_passes(&p, "strength");
+    tac_free(&p);
+
+    printf("  x * 7 stays: 7 is not a power of two.\n\n");
 
     printf("  Also applies inside loops:\n");
     printf("    for (i = 0; i < n; i++)\n");
@@ -170,10 +305,43 @@ static void demo_loop_optimisations(void)
 
     printf("  1. Loop-Invariant Code Motion (LICM):\n");
     printf("     Move computations that don't change between iterations\n");
-    printf("     outside the loop.\n");
-    printf("       Before: for (i=0; i<n; i++) a[i] = x * y + i;\n");
-    printf("       After:  t = x * y;\n");
-    printf("               for (i=0; i<n; i++) a[i] = t + i;\n\n");
+    printf("     outside the loop.  The licm pass finds natural loops (a\n");
+    printf("     back edge to a block that dominates it), and moves any\n");
+    printf("     arithmetic whose operands the loop never writes into a\n");
+    printf("     new preheader:\n\n");
+    printf("       Source C:  s = 0;\n");
+    printf("                  for (i = 0; i < n; i++) s = s + x * y + i;\n");
+    printf("                  return s;\n\n");
+
+    TacProgram p;
+    tac_init(&p);
+    {
+        TacOperand n = tac_var(&p, "n", 1), x = tac_var(&p, "x", 1), y = tac_var(&p, "y", 1);
+        TacOperand s = tac_var(&p, "s", 1), i = tac_var(&p, "i", 1);
+        TacOperand t0 = tac_temp(&p), t1 = tac_temp(&p);
+        TacOperand l_top = tac_label(&p), l_body = tac_label(&p), l_end = tac_label(&p);
+        TacOperand zero = tac_const(&p, 0);
+        tac_emit(&p, TAC_ASSIGN, s, zero, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_ASSIGN, i, zero, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_LABEL,  l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_IF_LT,  l_body, i, n);
+        tac_emit(&p, TAC_GOTO,   l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_LABEL,  l_body, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_MUL,    t0, x, y);
+        tac_emit(&p, TAC_ADD,    t1, s, t0);
+        tac_emit(&p, TAC_ADD,    s, t1, i);
+        tac_emit(&p, TAC_ADD,    i, i, tac_const(&p, 1));
+        tac_emit(&p, TAC_GOTO,   l_top, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_LABEL,  l_end, TAC_NO_OPERAND, TAC_NO_OPERAND);
+        tac_emit(&p, TAC_RET,    TAC_NO_OPERAND, s, TAC_NO_OPERAND);
+        show_passes(&p, "licm");
+    }
+    tac_free(&p);
+
+    printf("     The multiply now runs once; the loop keeps a copy t0 = t2,\n");
+    printf("     which is correct whether or not the loop runs at all.\n");
+    printf("     Evaluating x * y when n = 0 is harmless: TAC arithmetic\n");
+    printf("     cannot trap.\n\n");
 
     printf("  2. Loop Unrolling:\n");
     printf("     Reduce loop overhead by duplicating the body.\n");
@@ -190,14 +358,6 @@ static void demo_loop_optimisations(void)
     printf("       Before: for(j) for(i) a[i][j]    ← column-major, cache-hostile\n");
     printf("       After:  for(i) for(j) a[i][j]    ← row-major, cache-friendly\n\n");
 
-    /* Demonstrate unrolling */
-    int arr[] = {10, 20, 30, 40, 50, 60, 70, 80};
-    int sum_loop = 0, sum_unrolled = 0;
-    for (int i = 0; i < 8; i++) sum_loop += arr[i];
-    /* Manual unroll */
-    sum_unrolled = arr[0]+arr[1]+arr[2]+arr[3]+arr[4]+arr[5]+arr[6]+arr[7];
-    printf("  Demo: sum(loop)=%d, sum(unrolled)=%d  (same result)\n\n", sum_loop, sum_unrolled);
-
     printf("╔══════════════════════════════════════════════════════════╗\n");
     printf("║  See which optimisations GCC applies:                   ║\n");
     printf("║  gcc -O2 -fopt-info-optimized optimisation.c -o /dev/null║\n");
@@ -249,23 +409,20 @@ static void demo_cse(void)
     printf("║  Section 7 — Common Subexpression Elimination (CSE)     ║\n");
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
-    printf("CSE detects repeated expressions and computes them once.\n\n");
+    printf("CSE detects repeated expressions and computes them once.\n");
+    printf("Local value numbering gives every value in a block a number —\n");
+    printf("b + c and c + b get the same one — and remembers which name\n");
+    printf("holds it; a repeat becomes a copy, and reads go to the first\n");
+    printf("holder, so the copies die in DCE.\n\n");
 
-    printf("  Before:\n");
-    printf("    a = b + c;\n");
-    printf("    d = b + c + e;   ← 'b + c' computed again\n\n");
-    printf("  After:\n");
-    printf("    t1 = b + c;\n");
-    printf("    a = t1;\n");
-    printf("    d = t1 + e;      ← reuse previous result\n\n");
-
-    /* Demo CSE with array indexing */
-    int arr[5] = {10, 20, 30, 40, 50};
-    int idx = 2;
-    int val1 = arr[idx] + 1;     /* arr[idx] computed here */
-    int val2 = arr[idx] * 2;     /* arr[idx] reused via CSE */
-    printf("  Demo: arr[%d]+1 = %d, arr[%d]*2 = %d\n", idx, val1, idx, val2);
-    printf("  (The address calculation arr+idx*4 is done once.)\n\n");
+    printf("  Source:  a = b + c;  d = b + c + e;  f = (c + b) * e;\n");
+    printf("           return a + d + f\n\n");
+
+    TacProgram p;
+    tac_init(&p);
+    if (lower_program(&p, "a = b + c; d = b + c + e; f = (c + b) * e; return a + d + f") == 0)
+        show_passes(&p, "cse,dce");
+    tac_free(&p);
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -329,11 +486,199 @@ static void demo_summary(void)
     printf("  └───────────────────────────────┴──────┴──────┴──────┘\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════════
+ *  Section 10 — An Optimisation Pipeline
+ * ════════════════════════════════════════════════════════════════════ */
+
+/* Average tac_exec() time in µs over reps runs on fixed inputs */
+static double exec_us(const TacProgram *p, int reps)
+{
+    uint64_t t0 = bench_now_ns();
+    for (int r = 0; r < reps; r++) {
+        int32_t vars[MAX_VARS] = { 3, -5, 7, 11 };
+        tac_exec(p, vars, NULL);
+    }
+    return (double)(bench_now_ns() - t0) / 1e3 / reps;
+}
+
+/* Copy base, run spec over it and print one summary row (and the
+ * per-pass report first when verbose).  0 on success. */
+static int pipeline_row(const TacProgram *base, const char *spec, int verbose, int print)
+{
+    TacProgram  p;
+    OptPipeline pl;
+    OptReport   r;
+    unsigned    seed = 10;
+
+    if (opt_parse(&pl, spec) != 0) return -1;
+    if (copy_program(&p, base) != 0 || opt_run(&p, &pl, &r) != 0) {
+        printf("  (out of memory)\n");
+        tac_free(&p);
+        return -1;
+    }
+    if (print) {
+        print_tac(&p);
+        printf("\n");
+    }
+    if (verbose) {
+        printf("  %s:\n", spec);
+        print_opt_report(&r);
+        printf("\n");
+    }
+    int bad = count_mismatches(base, &p, 16, &seed);
+    printf("    %-22s %8u %10.2f %12.1f   %s\n", spec, p.count, r.ms, exec_us(&p, 20),
+           bad ? "MISMATCH ✗" : "✓");
+    tac_free(&p);
+    return bad ? -1 : 0;
+}
+
+static void pipeline_header(void)
+{
+    printf("    %-22s %8s %10s %12s   %s\n", "pipeline", "instrs", "opt ms", "exec µs/run", "same result");
+}
+
+static void demo_pipeline(void)
+{
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║  Section 10 — An Optimisation Pipeline                  ║\n");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+
+    printf("A pipeline is a list of passes, each re-run until a run changes\n");
+    printf("nothing.  The presets:\n\n");
+    printf("    -O0   (nothing)\n");
+    printf("    -O1   fold, dce\n");
+    printf("    -O2   sccp, fold, licm, strength, cse, fold, dce\n\n");
+    printf("sccp is chapter 21's SSA round trip: constants followed through\n");
+    printf("the whole CFG, not one block at a time.  Later passes clean up\n");
+    printf("after earlier ones — licm leaves copies for cse and dce, strength\n");
+    printf("leaves constants for fold.\n\n");
+
+    TacProgram base;
+    tac_init(&base);
+    if (tac_generate(&base, 20000, 22) != 0) {
+        printf("  (out of memory)\n");
+        tac_free(&base);
+        return;
+    }
+    printf("── A generated branchy program, %u instructions ──\n\n", base.count);
+    pipeline_row(&base, "-O2", 1, 0);
+    pipeline_header();
+    static const char *const specs[] = { "-O0", "-O1", "-O2", "fold,cse,dce", "sccp,dce" };
+    for (size_t k = 0; k < sizeof(specs) / sizeof(specs[0]); k++)
+        pipeline_row(&base, specs[k], 0, 0);
+    tac_free(&base);
+
+    /* Every single pass and every preset on many small programs */
+    printf("\n── Checking: 300 random programs × each pass and preset ──\n\n");
+    static const char *const checks[] = { "fold", "cse", "dce", "strength", "licm", "sccp",
+                                          "-O1", "-O2", "licm,strength,cse,fold,dce" };
+    unsigned seed = 2022;
+    for (size_t k = 0; k < sizeof(checks) / sizeof(checks[0]); k++) {
+        OptPipeline pl;
+        uint64_t    in = 0, out = 0;
+        int         bad = 0, failed = 0;
+        opt_parse(&pl, checks[k]);
+        for (uint32_t s = 1; s <= 300; s++) {
+            TacProgram a, b;
+            tac_init(&a);
+            tac_init(&b);
+            if (tac_generate(&a, 20 + s % 180, s) != 0 || copy_program(&b, &a) != 0 ||
+                opt_run(&b, &pl, NULL) != 0) {
+                failed = 1;
+            } else {
+                in  += a.count;
+                out += b.count;
+                bad += count_mismatches(&a, &b, 3, &seed);
+            }
+            tac_free(&a);
+            tac_free(&b);
+            if (failed) break;
+        }
+        printf("    %-28s %6llu → %6llu instrs   %d mismatches %s\n", checks[k],
+               (unsigned long long)in, (unsigned long long)out, bad,
+               bad || failed ? "✗" : "✓");
+    }
+    printf("\n");
+}
+
+/* ════════════════════════════════════════════════════════════════════
+ *  Command line — one pipeline over one generated program
+ * ════════════════════════════════════════════════════════════════════ */
+typedef struct {
+    const char *spec;
+    uint32_t    size;
+    uint32_t    seed;
+    int         print;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [-O0|-O1|-O2 | --passes fold,cse,dce,strength,licm,sccp]\n"
+            "          [--size INSTRS] [--seed S] [--print]\n", argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (strcmp(opt, "-O0") == 0 || strcmp(opt, "-O1") == 0 || strcmp(opt, "-O2") == 0) {
+            cfg->spec = opt;
+            continue;
+        }
+        if (strcmp(opt, "--print") == 0) {
+            cfg->print = 1;
+            continue;
+        }
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+
+        if (strcmp(opt, "--passes") == 0) {
+            cfg->spec = val;
+        } else if (strcmp(opt, "--size") == 0) {
+            long n = atol(val);
+            if (n < 1 || n > 10000000) return -1;
+            cfg->size = (uint32_t)n;
+        } else if (strcmp(opt, "--seed") == 0) {
+            cfg->seed = (uint32_t)strtoul(val, NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+    OptPipeline pl;
+    return opt_parse(&pl, cfg->spec);
+}
+
+static int run_cli(int argc, char *argv[])
+{
+    Config cfg = { "-O2", 20000, 22, 0 };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TacProgram base;
+    tac_init(&base);
+    if (tac_generate(&base, cfg.size, cfg.seed) != 0) {
+        fprintf(stderr, "out of memory\n");
+        tac_free(&base);
+        return 1;
+    }
+    printf("Generated program: %u instructions (seed %u)\n\n", base.count, cfg.seed);
+    pipeline_header();
+    pipeline_row(&base, "-O0", 0, 0);
+    int rc = pipeline_row(&base, cfg.spec, 1, cfg.print);
+    tac_free(&base);
+    return rc == 0 ? 0 : 1;
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════════ */
-int main(void)
+int main(int argc, char *argv[])
 {
+    if (argc > 1) return run_cli(argc, argv);
+
     printf("╔══════════════════════════════════════════════════════════════╗\n");
     printf("║  Chapter 22 — Optimisation Passes                           ║\n");
     printf("║  Modular-C-Demos                                            ║\n");
@@ -348,6 +693,7 @@ int main(void)
     demo_cse();
     demo_tail_call();
     demo_summary();
+    demo_pipeline();
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 22 — Optimisation Passes\n");
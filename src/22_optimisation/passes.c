@@ -0,0 +1,913 @@
+/*
+ * Chapter 22 — Optimisation passes over chapter 21 TAC
+ *
+ * See passes.h.  "Names" are the variables and temporaries: variable v
+ * is name v, temporary t is name n_vars + t, so per-name facts live in
+ * plain arrays.  Local passes (fold, cse) cut the code into blocks at
+ * labels and after jumps, stamping facts with a block counter instead
+ * of clearing them; global passes (dce, licm) use the chapter 21 CFG.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "passes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/bench.h"
+#include "../21_intermediate_repr/cfg.h"
+#include "../21_intermediate_repr/ssa.h"
+
+#define NONE UINT32_MAX
+
+static const char *const pass_names[OPT_PASS_COUNT] = {
+    "fold", "cse", "dce", "strength", "licm", "sccp"
+};
+
+const char *opt_pass_name(OptPass pass)
+{
+    return pass < OPT_PASS_COUNT ? pass_names[pass] : "?";
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Helpers
+ * ════════════════════════════════════════════════════════════════ */
+
+static int is_name(TacOperand o)
+{
+    return OPND_TAG(o) == OPND_VAR || OPND_TAG(o) == OPND_TEMP;
+}
+
+static uint32_t name_of(const TacProgram *p, TacOperand o)
+{
+    return OPND_TAG(o) == OPND_VAR ? OPND_INDEX(o) : p->n_vars + OPND_INDEX(o);
+}
+
+static TacOperand name_operand(const TacProgram *p, uint32_t n)
+{
+    return n < p->n_vars ? OPND(OPND_VAR, n) : OPND(OPND_TEMP, n - p->n_vars);
+}
+
+static int reads_a(int op)   { return op != TAC_LABEL && op != TAC_GOTO; }
+static int ends_block(int op) { return op == TAC_GOTO || op == TAC_RET || tac_is_branch(op); }
+
+static int const_of(const TacProgram *p, TacOperand o, int32_t *c)
+{
+    if (OPND_TAG(o) != OPND_CONST) return 0;
+    *c = tac_const_value(p, o);
+    return 1;
+}
+
+/* k if c == 2^k for 1 <= k <= 30, else -1 */
+static int log2_exact(int32_t c)
+{
+    if (c < 2 || (c & (c - 1))) return -1;
+    int k = 0;
+    while ((1 << k) != c) k++;
+    return k;
+}
+
+/* Delete every instruction with drop[i] set */
+static void drop_marked(TacProgram *p, const uint8_t *drop)
+{
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < p->count; i++)
+        if (!drop[i]) p->code[at++] = p->code[i];
+    p->count = at;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  fold — local constant propagation, folding and identities
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Rewrite in as something cheaper if its operands allow; 1 if changed.
+ * *oom is set if a constant could not be added. */
+static int simplify(TacProgram *p, TacInstr *in, int *oom)
+{
+    int32_t    x = 0, y = 0;
+    int        cx = const_of(p, in->a, &x);
+    int        cy = tac_reads_b(in->op) && const_of(p, in->b, &y);
+    TacOperand result = TAC_NO_OPERAND;       /* dst = result */
+    int        neg = 0;                       /* dst = -result */
+
+    if (in->op == TAC_ASSIGN) return 0;
+    if (cx && (cy || !tac_reads_b(in->op))) {
+        result = tac_const(p, tac_fold((TacOp)in->op, x, y));
+        if (result == TAC_NO_OPERAND) { *oom = 1; return 0; }
+    } else {
+        switch (in->op) {
+            case TAC_ADD:
+                if (cy && y == 0) result = in->a;
+                else if (cx && x == 0) result = in->b;
+                break;
+            case TAC_SUB:
+                if (cy && y == 0) result = in->a;
+                else if (cx && x == 0) { result = in->b; neg = 1; }
+                else if (in->a == in->b) result = tac_const(p, 0);
+                break;
+            case TAC_MUL:
+                if ((cx && x == 0) || (cy && y == 0)) result = tac_const(p, 0);
+                else if (cy && y == 1) result = in->a;
+                else if (cx && x == 1) result = in->b;
+                else if (cy && y == -1) { result = in->a; neg = 1; }
+                else if (cx && x == -1) { result = in->b; neg = 1; }
+                break;
+            case TAC_DIV:
+                if (cy && y == 1) result = in->a;
+                else if (cy && y == -1) { result = in->a; neg = 1; }
+                else if ((cx && x == 0) || (cy && y == 0)) result = tac_const(p, 0);
+                break;
+            case TAC_SHL: case TAC_SHR: case TAC_SAR:
+                if (cy && (y & 31) == 0) result = in->a;
+                else if (cx && x == 0) result = tac_const(p, 0);
+                break;
+        }
+        if (result == TAC_NO_OPERAND) return 0;
+    }
+    in->op = neg ? TAC_NEG : TAC_ASSIGN;
+    in->a  = result;
+    in->b  = TAC_NO_OPERAND;
+    return 1;
+}
+
+static int pass_fold(TacProgram *p, uint32_t *changed)
+{
+    uint32_t  n     = p->n_vars + p->n_temps;
+    int32_t  *val   = malloc((n ? n : 1) * sizeof(int32_t));
+    uint32_t *known = malloc((n ? n : 1) * sizeof(uint32_t));   /* block stamp */
+    uint8_t  *drop  = calloc(p->count + 1, 1);
+    uint32_t  blk   = 0, ch = 0;
+    int       oom   = !val || !known || !drop;
+
+    for (uint32_t k = 0; k < n && !oom; k++) known[k] = NONE;
+    for (uint32_t i = 0; i < p->count && !oom; i++) {
+        TacInstr *in = &p->code[i];
+        if (in->op == TAC_LABEL) { blk++; continue; }
+
+        /* Propagate: a name holding a known constant reads as it */
+        TacOperand *ops[2] = { reads_a(in->op) ? &in->a : NULL, tac_reads_b(in->op) ? &in->b : NULL };
+        for (int k = 0; k < 2; k++) {
+            if (!ops[k] || !is_name(*ops[k]) || known[name_of(p, *ops[k])] != blk) continue;
+            TacOperand c = tac_const(p, val[name_of(p, *ops[k])]);
+            if (c == TAC_NO_OPERAND) { oom = 1; break; }
+            *ops[k] = c;
+            ch++;
+        }
+
+        if (tac_writes_dst(in->op)) {
+            uint32_t d = name_of(p, in->dst);
+            ch += simplify(p, in, &oom);
+            if (in->op == TAC_ASSIGN && in->a == in->dst) {     /* x = x */
+                drop[i] = 1;
+                ch++;
+                continue;
+            }
+            int32_t c;
+            if (in->op == TAC_ASSIGN && const_of(p, in->a, &c)) {
+                val[d]   = c;
+                known[d] = blk;
+            } else {
+                known[d] = NONE;
+            }
+        } else if (tac_is_branch(in->op)) {
+            int32_t x, y;
+            int     taken = -1;
+            if (const_of(p, in->a, &x) && const_of(p, in->b, &y))
+                taken = tac_branch_taken((TacOp)in->op, x, y);
+            else if (in->a == in->b)
+                taken = in->op == TAC_IF_EQ;
+            if (taken == 1) {
+                in->op = TAC_GOTO;
+                in->a = in->b = TAC_NO_OPERAND;
+                ch++;
+            } else if (taken == 0) {
+                drop[i] = 1;
+                ch++;
+            }
+        }
+        if (ends_block(in->op)) blk++;
+    }
+    if (!oom) drop_marked(p, drop);
+
+    free(val);
+    free(known);
+    free(drop);
+    *changed = ch;
+    return oom ? -1 : 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  cse — local value numbering
+ *
+ *  Every operand gets a value number: a constant by its table index,
+ *  a name by what was last stored in it, an expression by (op, value
+ *  numbers of its operands), found in a hash table.  Each value number
+ *  remembers a "home": the first name it was stored in, valid while
+ *  that name still holds it.
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint32_t stamp;         /* block + 1; anything else means empty */
+    uint32_t op, va, vb;
+    uint32_t vn;
+} LvnSlot;
+
+typedef struct {
+    TacProgram *p;
+    uint32_t    blk;
+    uint32_t   *name_vn, *name_stamp;
+    uint32_t   *const_vn, *const_stamp;
+    uint32_t   *home;       /* vn → name, NONE  */
+    TacOperand *lit;        /* vn → constant operand, TAC_NO_OPERAND */
+    uint32_t    n_vn;
+    LvnSlot    *table;
+    uint32_t    mask;
+} Lvn;
+
+static uint32_t lvn_new(Lvn *l, uint32_t home, TacOperand lit)
+{
+    l->home[l->n_vn] = home;
+    l->lit[l->n_vn]  = lit;
+    return l->n_vn++;
+}
+
+static int lvn_holds(const Lvn *l, uint32_t name, uint32_t vn)
+{
+    return l->name_stamp[name] == l->blk && l->name_vn[name] == vn;
+}
+
+static uint32_t lvn_of(Lvn *l, TacOperand o)
+{
+    if (OPND_TAG(o) == OPND_CONST) {
+        uint32_t k = OPND_INDEX(o);
+        if (l->const_stamp[k] != l->blk) {
+            l->const_vn[k]    = lvn_new(l, NONE, o);
+            l->const_stamp[k] = l->blk;
+        }
+        return l->const_vn[k];
+    }
+    uint32_t n = name_of(l->p, o);
+    if (l->name_stamp[n] != l->blk) {
+        l->name_vn[n]    = lvn_new(l, n, TAC_NO_OPERAND);
+        l->name_stamp[n] = l->blk;
+    }
+    return l->name_vn[n];
+}
+
+/* An operand currently holding vn, or TAC_NO_OPERAND */
+static TacOperand lvn_best(const Lvn *l, uint32_t vn)
+{
+    if (l->lit[vn] != TAC_NO_OPERAND) return l->lit[vn];
+    if (l->home[vn] != NONE && lvn_holds(l, l->home[vn], vn)) return name_operand(l->p, l->home[vn]);
+    return TAC_NO_OPERAND;
+}
+
+static LvnSlot *lvn_find(Lvn *l, uint32_t op, uint32_t va, uint32_t vb)
+{
+    uint32_t h = (op * 0x9E3779B1u) ^ (va * 0x85EBCA77u) ^ (vb * 0xC2B2AE3Du);
+    h ^= h >> 15;
+    for (uint32_t i = h & l->mask;; i = (i + 1) & l->mask) {
+        LvnSlot *s = &l->table[i];
+        if (s->stamp != l->blk + 1) return s;                   /* empty: insert here */
+        if (s->op == op && s->va == va && s->vb == vb) return s;
+    }
+}
+
+static int pass_cse(TacProgram *p, uint32_t *changed)
+{
+    uint32_t n = p->n_vars + p->n_temps, size = 16;
+    while (size < 2 * p->count + 2) size *= 2;
+
+    Lvn l = { p, 0, NULL, NULL, NULL, NULL, NULL, NULL, 0, NULL, size - 1 };
+    l.name_vn     = malloc((n ? n : 1) * sizeof(uint32_t));
+    l.name_stamp  = malloc((n ? n : 1) * sizeof(uint32_t));
+    l.const_vn    = malloc((p->n_consts ? p->n_consts : 1) * sizeof(uint32_t));
+    l.const_stamp = malloc((p->n_consts ? p->n_consts : 1) * sizeof(uint32_t));
+    l.home        = malloc((3 * (size_t)p->count + 1) * sizeof(uint32_t));    /* ≤ 3 new per instruction */
+    l.lit         = malloc((3 * (size_t)p->count + 1) * sizeof(TacOperand));
+    l.table       = calloc(size, sizeof(LvnSlot));
+    uint32_t ch = 0;
+    int      oom = !l.name_vn || !l.name_stamp || !l.const_vn || !l.const_stamp || !l.home || !l.lit || !l.table;
+
+    for (uint32_t k = 0; k < n && !oom; k++) l.name_stamp[k] = NONE;
+    for (uint32_t k = 0; k < p->n_consts && !oom; k++) l.const_stamp[k] = NONE;
+
+    for (uint32_t i = 0; i < p->count && !oom; i++) {
+        TacInstr *in = &p->code[i];
+        if (in->op == TAC_LABEL) { l.blk++; continue; }
+
+        /* Read every operand from the best place holding its value */
+        TacOperand *ops[2] = { reads_a(in->op) ? &in->a : NULL, tac_reads_b(in->op) ? &in->b : NULL };
+        uint32_t    vn[2]  = { NONE, NONE };
+        for (int k = 0; k < 2; k++) {
+            if (!ops[k] || OPND_TAG(*ops[k]) == OPND_NONE) continue;
+            vn[k] = lvn_of(&l, *ops[k]);
+            TacOperand best = lvn_best(&l, vn[k]);
+            if (best != TAC_NO_OPERAND && best != *ops[k]) {
+                *ops[k] = best;
+                ch++;
+            }
+        }
+
+        if (tac_writes_dst(in->op)) {
+            uint32_t v;
+            if (in->op == TAC_ASSIGN) {
+                v = vn[0];
+            } else {
+                uint32_t va = vn[0], vb = vn[1];
+                if ((in->op == TAC_ADD || in->op == TAC_MUL) && va > vb) { uint32_t t = va; va = vb; vb = t; }
+                LvnSlot *s = lvn_find(&l, in->op, va, vb);
+                if (s->stamp == l.blk + 1) {
+                    v = s->vn;
+                    TacOperand best = lvn_best(&l, v);
+                    if (best != TAC_NO_OPERAND) {       /* computed already: copy it */
+                        in->op = TAC_ASSIGN;
+                        in->a  = best;
+                        in->b  = TAC_NO_OPERAND;
+                        ch++;
+                    }
+                } else {
+                    v = lvn_new(&l, NONE, TAC_NO_OPERAND);
+                    *s = (LvnSlot){ l.blk + 1, in->op, va, vb, v };
+                }
+            }
+            uint32_t d = name_of(p, in->dst);
+            l.name_vn[d]    = v;
+            l.name_stamp[d] = l.blk;
+            if (lvn_best(&l, v) == TAC_NO_OPERAND) l.home[v] = d;
+        }
+        if (ends_block(in->op)) l.blk++;
+    }
+
+    free(l.name_vn);
+    free(l.name_stamp);
+    free(l.const_vn);
+    free(l.const_stamp);
+    free(l.home);
+    free(l.lit);
+    free(l.table);
+    *changed = ch;
+    return oom ? -1 : 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  dce — unreachable code, dead stores, redundant jumps and labels
+ *
+ *  Liveness only tracks the names that can be live across a block
+ *  boundary: the variables (live at every exit) and the names some
+ *  block reads before writing.  Everything else is block-local.
+ *  Uses by dead instructions don't count ("faint" variables), so a
+ *  dead chain spanning blocks, or looping round a back edge, dies in
+ *  one run rather than one link per run.
+ * ════════════════════════════════════════════════════════════════ */
+
+/* One block backwards from live (its live-out), leaving its live-in.
+ * Names with a liveness bit live in the bitset; the rest are local to
+ * the block and live while stamp[name] == visit.  Only a needed
+ * instruction (a live result, a branch or a return) makes its operands
+ * live.  With drop, the dead writes are marked and counted. */
+static uint32_t dce_walk(const TacProgram *p, const CfgBlock *bb, const uint32_t *bit,
+                         uint64_t *live, uint32_t *stamp, uint32_t visit, uint8_t *drop)
+{
+    uint32_t dead = 0;
+    for (uint32_t i = bb->end; i-- > bb->first; ) {
+        const TacInstr *in = &p->code[i];
+        if (tac_writes_dst(in->op)) {
+            uint32_t d = name_of(p, in->dst), bd = bit[d];
+            int      needed;
+            if (bd != NONE) {
+                needed = (int)((live[bd / 64] >> (bd % 64)) & 1);
+                live[bd / 64] &= ~(1ull << (bd % 64));
+            } else {
+                needed = stamp[d] == visit;
+                stamp[d] = NONE;
+            }
+            if (!needed) {
+                if (drop) { drop[i] = 1; dead++; }
+                continue;
+            }
+        }
+        TacOperand ops[2] = { reads_a(in->op) ? in->a : 0, tac_reads_b(in->op) ? in->b : 0 };
+        for (int k = 0; k < 2; k++) {
+            if (!is_name(ops[k])) continue;
+            uint32_t m = name_of(p, ops[k]);
+            if (bit[m] != NONE) live[bit[m] / 64] |= 1ull << (bit[m] % 64);
+            else stamp[m] = visit;
+        }
+    }
+    return dead;
+}
+
+static int pass_dce(TacProgram *p, uint32_t *changed)
+{
+    Cfg cfg;
+    if (cfg_build(&cfg, p) != 0) { cfg_free(&cfg); return -1; }
+
+    uint32_t  n     = p->n_vars + p->n_temps, nb = cfg.n_blocks;
+    uint8_t  *drop  = calloc(p->count + 1, 1);
+    uint32_t *bit   = malloc((n ? n : 1) * sizeof(uint32_t));      /* name → liveness bit */
+    uint32_t *who   = malloc((n ? n : 1) * sizeof(uint32_t));      /* bit → name */
+    uint32_t *stamp = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint64_t *sets  = NULL;
+    uint32_t  n_bits = 0, ch = 0;
+    int       rc = -1;
+    if (!drop || !bit || !who || !stamp) goto out;
+
+    /* Unreachable blocks go entirely */
+    for (uint32_t b = 1; b < cfg.exit; b++) {
+        if (cfg.blocks[b].rpo != CFG_NONE) continue;
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].end; i++) drop[i] = 1;
+        ch += cfg.blocks[b].end - cfg.blocks[b].first;
+    }
+
+    /* Which names need a liveness bit */
+    for (uint32_t k = 0; k < n; k++) bit[k] = stamp[k] = NONE;
+    for (uint32_t v = 0; v < p->n_vars; v++) { bit[v] = n_bits; who[n_bits++] = v; }
+    for (uint32_t r = 0; r < cfg.n_reachable; r++) {
+        uint32_t b = cfg.order[r];
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].end; i++) {
+            const TacInstr *in = &p->code[i];
+            TacOperand ops[2] = { reads_a(in->op) ? in->a : 0, tac_reads_b(in->op) ? in->b : 0 };
+            for (int k = 0; k < 2; k++) {
+                if (!is_name(ops[k])) continue;
+                uint32_t m = name_of(p, ops[k]);
+                if (stamp[m] != b && bit[m] == NONE) { bit[m] = n_bits; who[n_bits++] = m; }
+            }
+            if (tac_writes_dst(in->op)) stamp[name_of(p, in->dst)] = b;
+        }
+    }
+
+    /* Live-in and live-out per block, to the fixpoint, sweeping in
+     * postorder so most facts arrive at once */
+    uint32_t words = (n_bits + 63) / 64;
+    size_t   per   = (size_t)nb * words;
+    sets = calloc(2 * per + 2 * words + 1, sizeof(uint64_t));
+    if (!sets) goto out;
+    uint64_t *in_ = sets, *out_ = sets + per, *outputs = sets + 2 * per, *cur = outputs + words;
+    for (uint32_t v = 0; v < p->n_vars; v++) outputs[v / 64] |= 1ull << (v % 64);
+
+    uint32_t visit = 0;
+    for (uint32_t k = 0; k < n; k++) stamp[k] = NONE;
+    for (int again = 1; again; ) {
+        again = 0;
+        for (uint32_t r = cfg.n_reachable; r > 0; r--) {
+            uint32_t        b  = cfg.order[r - 1];
+            const CfgBlock *bb = &cfg.blocks[b];
+            uint64_t       *li = in_ + b * words;
+            for (uint32_t w = 0; w < words; w++) {
+                uint64_t x = bb->n_succ ? 0 : outputs[w];
+                for (uint32_t k = 0; k < bb->n_succ; k++) x |= in_[bb->succ[k] * words + w];
+                out_[b * words + w] = cur[w] = x;
+            }
+            dce_walk(p, bb, bit, cur, stamp, ++visit, NULL);
+            for (uint32_t w = 0; w < words; w++)
+                if (cur[w] != li[w]) { li[w] = cur[w]; again = 1; }
+        }
+    }
+
+    /* Dead stores: the same walk from each block's final live-out */
+    for (uint32_t r = 0; r < cfg.n_reachable; r++) {
+        uint32_t b = cfg.order[r];
+        memcpy(cur, out_ + b * words, words * sizeof(uint64_t));
+        ch += dce_walk(p, &cfg.blocks[b], bit, cur, stamp, ++visit, drop);
+    }
+
+    /* Jumps to the very next instruction (past any labels), then
+     * labels nothing jumps to */
+    uint32_t *uses = calloc(p->n_labels + 1, sizeof(uint32_t));
+    if (!uses) goto out;
+    for (uint32_t i = 0; i < p->count; i++)
+        if (!drop[i] && (p->code[i].op == TAC_GOTO || tac_is_branch(p->code[i].op)))
+            uses[OPND_INDEX(p->code[i].dst)]++;
+    for (uint32_t i = p->count; i-- > 0; ) {       /* backwards: goto L; goto L; L: */
+        const TacInstr *in = &p->code[i];
+        if (drop[i] || (in->op != TAC_GOTO && !tac_is_branch(in->op))) continue;
+        for (uint32_t j = i + 1; j < p->count; j++) {
+            if (drop[j]) continue;
+            if (p->code[j].op != TAC_LABEL) break;
+            if (p->code[j].dst == in->dst) {
+                drop[i] = 1;
+                uses[OPND_INDEX(in->dst)]--;
+                ch++;
+                break;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < p->count; i++)
+        if (!drop[i] && p->code[i].op == TAC_LABEL && !uses[OPND_INDEX(p->code[i].dst)]) {
+            drop[i] = 1;
+            ch++;
+        }
+    free(uses);
+
+    drop_marked(p, drop);
+    rc = 0;
+
+out:
+    cfg_free(&cfg);
+    free(drop);
+    free(bit);
+    free(who);
+    free(stamp);
+    free(sets);
+    *changed = ch;
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  strength — multiplies and divides by powers of two
+ *
+ *  x / 2^k rounds toward zero, an arithmetic shift toward -∞, so a
+ *  negative x first gets 2^k - 1 added (the usual compiler sequence):
+ *
+ *      t1 = x >> 31          -1 if x < 0, else 0
+ *      t2 = t1 >>> (32 - k)  2^k - 1 if x < 0, else 0
+ *      t3 = x + t2
+ *      d  = t3 >> k
+ * ════════════════════════════════════════════════════════════════ */
+
+static int pass_strength(TacProgram *p, uint32_t *changed)
+{
+    TacInstr *old = p->code;
+    uint32_t  n_old = p->count, ch = 0;
+    int       oom = 0;
+
+    p->code  = NULL;
+    p->count = p->cap = 0;
+
+#define EMIT(op, d, x, y)  do { if (tac_emit(p, op, d, x, y) != 0) oom = 1; } while (0)
+#define K(c)               tac_const(p, (int32_t)(c))
+
+    for (uint32_t i = 0; i < n_old && !oom; i++) {
+        TacInstr in = old[i];
+        int32_t  c;
+        int      k;
+        if (in.op == TAC_MUL && const_of(p, in.b, &c) && ((k = log2_exact(c)) > 0 || c == INT32_MIN)) {
+            EMIT(TAC_SHL, in.dst, in.a, K(k > 0 ? k : 31));
+            ch++;
+        } else if (in.op == TAC_MUL && const_of(p, in.a, &c) && ((k = log2_exact(c)) > 0 || c == INT32_MIN)) {
+            EMIT(TAC_SHL, in.dst, in.b, K(k > 0 ? k : 31));
+            ch++;
+        } else if (in.op == TAC_DIV && const_of(p, in.b, &c) && (k = log2_exact(c)) > 0 &&
+                   !const_of(p, in.a, &c)) {
+            TacOperand t1 = k == 1 ? TAC_NO_OPERAND : tac_temp(p), t2 = tac_temp(p), t3 = tac_temp(p);
+            if ((k > 1 && t1 == TAC_NO_OPERAND) || t2 == TAC_NO_OPERAND || t3 == TAC_NO_OPERAND) {
+                oom = 1;
+                break;
+            }
+            if (k == 1) {
+                EMIT(TAC_SHR, t2, in.a, K(31));
+            } else {
+                EMIT(TAC_SAR, t1, in.a, K(31));
+                EMIT(TAC_SHR, t2, t1, K(32 - k));
+            }
+            EMIT(TAC_ADD, t3, in.a, t2);
+            EMIT(TAC_SAR, in.dst, t3, K(k));
+            ch++;
+        } else {
+            EMIT((TacOp)in.op, in.dst, in.a, in.b);
+        }
+    }
+#undef EMIT
+#undef K
+
+    if (oom) {                                  /* put the original back */
+        free(p->code);
+        p->code  = old;
+        p->count = p->cap = n_old;
+        return -1;
+    }
+    free(old);
+    *changed = ch;
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  licm — loop-invariant code motion
+ *
+ *  A natural loop is a header h plus every block that reaches a back
+ *  edge b→h (h dominates b) without passing h; back edges sharing a
+ *  header make one loop.  An arithmetic instruction whose operands no
+ *  instruction in the loop writes is invariant.  It moves into a new
+ *  preheader as  t = a op b  for a fresh temporary t and leaves
+ *  d = t  behind, which is right whether or not d is live around the
+ *  loop.  Each instruction moves out of its innermost loop only; the
+ *  next run can carry it further out.
+ *
+ *  The preheader goes right before the header's label.  Jumps from
+ *  outside the loop are retargeted to it; a fall-through from inside
+ *  (the layout predecessor being a latch) gets a jump over it.
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint32_t header;
+    uint32_t first, size;       /* body[first .. first + size) */
+    uint32_t pre_label;         /* NONE until something is hoisted */
+    int      irreducible;       /* entered other than through the header */
+} Loop;
+
+static const uint32_t *sort_sizes;
+
+static int by_size_desc(const void *x, const void *y)
+{
+    uint32_t a = sort_sizes[*(const uint32_t *)x], b = sort_sizes[*(const uint32_t *)y];
+    return a < b ? 1 : a > b ? -1 : 0;
+}
+
+static int pass_licm(TacProgram *p, uint32_t *changed)
+{
+    Cfg cfg;
+    *changed = 0;
+    if (cfg_build(&cfg, p) != 0 || cfg_dominators(&cfg) != 0) { cfg_free(&cfg); return -1; }
+
+    uint32_t  nb = cfg.n_blocks, n = p->n_vars + p->n_temps;
+    uint32_t *loop_of = malloc(nb * sizeof(uint32_t));    /* header → loop */
+    uint32_t *mark    = malloc(nb * sizeof(uint32_t));
+    uint32_t *inner   = malloc(nb * sizeof(uint32_t));    /* block → innermost loop */
+    uint32_t *work    = malloc(nb * sizeof(uint32_t));
+    uint32_t *def_in  = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint32_t *hoist   = malloc((p->count + 1) * sizeof(uint32_t));   /* instr → fresh temp */
+    uint32_t *pre_at  = malloc((p->count + 1) * sizeof(uint32_t));   /* instr → loop */
+    Loop     *loops   = NULL;
+    uint32_t *body    = NULL, *order = NULL, *sizes = NULL;
+    uint32_t  n_loops = 0, n_body = 0, cap_body = 0, ch = 0;
+    int       rc = -1;
+    TacInstr *old = NULL;
+
+    if (!loop_of || !mark || !inner || !work || !def_in || !hoist || !pre_at) goto out;
+    for (uint32_t b = 0; b < nb; b++) loop_of[b] = mark[b] = inner[b] = NONE;
+
+    /* Headers: targets of back edges */
+    for (uint32_t r = 0; r < cfg.n_reachable; r++) {
+        uint32_t b = cfg.order[r];
+        for (uint32_t k = 0; k < cfg.blocks[b].n_succ; k++) {
+            uint32_t h = cfg.blocks[b].succ[k];
+            if (loop_of[h] == NONE && cfg_dominates(&cfg, h, b)) loop_of[h] = n_loops++;
+        }
+    }
+    if (n_loops == 0) { rc = 0; goto out; }
+    loops = calloc(n_loops, sizeof(Loop));
+    order = malloc(n_loops * sizeof(uint32_t));
+    sizes = malloc(n_loops * sizeof(uint32_t));
+    if (!loops || !order || !sizes) goto out;
+
+    /* Bodies: walk predecessors back from the latches, stopping at h */
+    for (uint32_t h = 0; h < nb; h++) {
+        uint32_t L = loop_of[h];
+        if (L == NONE) continue;
+        loops[L] = (Loop){ h, n_body, 0, NONE, 0 };
+        uint32_t sp = 0;
+        mark[h] = L;
+        work[sp++] = h;
+        while (sp) {
+            uint32_t x = work[--sp];
+            if (n_body == cap_body) {
+                uint32_t  c = cap_body ? 2 * cap_body : 256;
+                uint32_t *nbody = realloc(body, c * sizeof(uint32_t));
+                if (!nbody) goto out;
+                body = nbody;
+                cap_body = c;
+            }
+            body[n_body++] = x;
+            const CfgBlock *xb = &cfg.blocks[x];
+            for (uint32_t j = 0; j < xb->n_preds; j++) {
+                uint32_t y = cfg.preds[xb->pred_first + j];
+                if (mark[y] == L || cfg.blocks[y].rpo == CFG_NONE) continue;
+                if (!cfg_dominates(&cfg, h, y)) {
+                    if (x != h) loops[L].irreducible = 1;
+                    continue;                                           /* entry edge */
+                }
+                mark[y] = L;
+                work[sp++] = y;
+            }
+        }
+        loops[L].size = n_body - loops[L].first;
+    }
+
+    /* Innermost loop of each block: paint the big loops first */
+    for (uint32_t L = 0; L < n_loops; L++) { order[L] = L; sizes[L] = loops[L].size; }
+    sort_sizes = sizes;
+    qsort(order, n_loops, sizeof(uint32_t), by_size_desc);
+    for (uint32_t k = 0; k < n_loops; k++) {
+        const Loop *lp = &loops[order[k]];
+        for (uint32_t j = 0; j < lp->size; j++) inner[body[lp->first + j]] = order[k];
+    }
+
+    /* Invariant instructions */
+    for (uint32_t i = 0; i <= p->count; i++) hoist[i] = pre_at[i] = NONE;
+    for (uint32_t k = 0; k < n; k++) def_in[k] = NONE;
+    for (uint32_t L = 0; L < n_loops; L++) {
+        Loop           *lp = &loops[L];
+        const CfgBlock *hb = &cfg.blocks[lp->header];
+        if (lp->irreducible || hb->first == hb->end || p->code[hb->first].op != TAC_LABEL) continue;
+        for (uint32_t j = 0; j < lp->size; j++) {
+            const CfgBlock *bb = &cfg.blocks[body[lp->first + j]];
+            for (uint32_t i = bb->first; i < bb->end; i++)
+                if (tac_writes_dst(p->code[i].op)) def_in[name_of(p, p->code[i].dst)] = L;
+        }
+        for (uint32_t j = 0; j < lp->size; j++) {
+            uint32_t        b  = body[lp->first + j];
+            const CfgBlock *bb = &cfg.blocks[b];
+            if (inner[b] != L) continue;
+            for (uint32_t i = bb->first; i < bb->end; i++) {
+                const TacInstr *in = &p->code[i];
+                if (!tac_writes_dst(in->op) || in->op == TAC_ASSIGN) continue;
+                int invariant = 1, all_const = 1;
+                TacOperand ops[2] = { in->a, tac_reads_b(in->op) ? in->b : TAC_NO_OPERAND };
+                for (int k = 0; k < 2; k++) {
+                    if (is_name(ops[k])) {
+                        all_const = 0;
+                        invariant &= def_in[name_of(p, ops[k])] != L;
+                    }
+                }
+                if (!invariant || all_const) continue;
+                TacOperand t = tac_temp(p);
+                if (t == TAC_NO_OPERAND) goto out;
+                if (lp->pre_label == NONE) {
+                    TacOperand l = tac_label(p);
+                    if (l == TAC_NO_OPERAND) goto out;
+                    lp->pre_label = OPND_INDEX(l);
+                    pre_at[hb->first] = L;
+                }
+                hoist[i] = OPND_INDEX(t);
+                ch++;
+            }
+        }
+    }
+    if (ch == 0) { rc = 0; goto out; }
+
+    /* Re-emit with the preheaders in place */
+    old = p->code;
+    uint32_t n_old = p->count;
+    p->code  = NULL;
+    p->count = p->cap = 0;
+    int oom = 0;
+#define EMIT(op, d, x, y)  do { if (tac_emit(p, op, d, x, y) != 0) oom = 1; } while (0)
+    for (uint32_t b = 1; b < cfg.exit && !oom; b++) {
+        const CfgBlock *bb = &cfg.blocks[b];
+        for (uint32_t i = bb->first; i < bb->end; i++) {
+            TacInstr in = old[i];
+            uint32_t L  = pre_at[i];
+            if (L != NONE) {
+                const Loop     *lp   = &loops[L];
+                const CfgBlock *prev = &cfg.blocks[b - 1];
+                if (b > 1 && prev->rpo != CFG_NONE && prev->first < prev->end &&
+                    old[prev->end - 1].op != TAC_GOTO && old[prev->end - 1].op != TAC_RET &&
+                    cfg_dominates(&cfg, lp->header, b - 1))
+                    EMIT(TAC_GOTO, in.dst, TAC_NO_OPERAND, TAC_NO_OPERAND);
+                EMIT(TAC_LABEL, OPND(OPND_LABEL, lp->pre_label), TAC_NO_OPERAND, TAC_NO_OPERAND);
+                for (uint32_t j = 0; j < lp->size; j++) {
+                    const CfgBlock *hb = &cfg.blocks[body[lp->first + j]];
+                    if (inner[body[lp->first + j]] != L) continue;
+                    for (uint32_t m = hb->first; m < hb->end; m++)
+                        if (hoist[m] != NONE)
+                            EMIT((TacOp)old[m].op, OPND(OPND_TEMP, hoist[m]), old[m].a, old[m].b);
+                }
+            }
+            if (hoist[i] != NONE) {
+                in.op = TAC_ASSIGN;
+                in.a  = OPND(OPND_TEMP, hoist[i]);
+                in.b  = TAC_NO_OPERAND;
+            } else if (in.op == TAC_GOTO || tac_is_branch(in.op)) {
+                uint32_t t = cfg.label_block[OPND_INDEX(in.dst)];
+                if (loop_of[t] != NONE && loops[loop_of[t]].pre_label != NONE &&
+                    (bb->rpo == CFG_NONE || !cfg_dominates(&cfg, t, b)))
+                    in.dst = OPND(OPND_LABEL, loops[loop_of[t]].pre_label);
+            }
+            EMIT((TacOp)in.op, in.dst, in.a, in.b);
+        }
+    }
+#undef EMIT
+    if (oom) {
+        free(p->code);
+        p->code  = old;
+        p->count = p->cap = n_old;
+        old = NULL;
+        goto out;
+    }
+    rc = 0;
+    *changed = ch;
+
+out:
+    cfg_free(&cfg);
+    free(old);
+    free(loop_of);
+    free(mark);
+    free(inner);
+    free(work);
+    free(def_in);
+    free(hoist);
+    free(pre_at);
+    free(loops);
+    free(body);
+    free(order);
+    free(sizes);
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  sccp — the chapter 21 SSA round trip
+ * ════════════════════════════════════════════════════════════════ */
+
+static int pass_sccp(TacProgram *p, uint32_t *changed)
+{
+    SsaFunc    f;
+    TacProgram out;
+    tac_init(&out);
+    if (ssa_build(&f, p) != 0 || ssa_sccp(&f) != 0 || ssa_dce(&f) != 0 || ssa_to_tac(&f, &out) != 0) {
+        ssa_free(&f);
+        tac_free(&out);
+        return -1;
+    }
+    *changed = f.stats.folded_branches + (p->count > out.count ? p->count - out.count : 0);
+    ssa_free(&f);
+    tac_free(p);
+    *p = out;
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Pipelines
+ * ════════════════════════════════════════════════════════════════ */
+
+int opt_run_pass(TacProgram *p, OptPass pass, uint32_t *changed)
+{
+    *changed = 0;
+    switch (pass) {
+        case OPT_FOLD:     return pass_fold(p, changed);
+        case OPT_CSE:      return pass_cse(p, changed);
+        case OPT_DCE:      return pass_dce(p, changed);
+        case OPT_STRENGTH: return pass_strength(p, changed);
+        case OPT_LICM:     return pass_licm(p, changed);
+        case OPT_SCCP:     return pass_sccp(p, changed);
+        default:           return -1;
+    }
+}
+
+int opt_parse(OptPipeline *pl, const char *spec)
+{
+    static const char *const presets[] = {
+        "",
+        "fold,dce",
+        "sccp,fold,licm,strength,cse,fold,dce",
+    };
+    pl->n = 0;
+    if (spec[0] == '-' && spec[1] == 'O' && spec[2] >= '0' && spec[2] <= '2' && !spec[3])
+        spec = presets[spec[2] - '0'];
+
+    while (*spec) {
+        size_t len = strcspn(spec, ",");
+        int    k;
+        for (k = 0; k < OPT_PASS_COUNT; k++)
+            if (strlen(pass_names[k]) == len && strncmp(spec, pass_names[k], len) == 0) break;
+        if (k == OPT_PASS_COUNT || pl->n == OPT_MAX_PASSES) return -1;
+        pl->pass[pl->n++] = (OptPass)k;
+        spec += len;
+        if (*spec == ',') spec++;
+    }
+    return 0;
+}
+
+int opt_run(TacProgram *p, const OptPipeline *pl, OptReport *r)
+{
+    OptReport scratch;
+    if (!r) r = &scratch;
+    memset(r, 0, sizeof(*r));
+
+    uint64_t t_all = bench_now_ns();
+    for (int k = 0; k < pl->n; k++) {
+        OptPassStats *s = &r->pass[r->n++];
+        s->pass   = pl->pass[k];
+        s->before = p->count;
+        uint64_t t0 = bench_now_ns();
+        while (s->iterations < OPT_MAX_ITERATIONS) {
+            uint32_t ch = 0;
+            if (opt_run_pass(p, s->pass, &ch) != 0) return -1;
+            s->changed += ch;
+            s->iterations++;
+            if (ch == 0) break;
+        }
+        s->after = p->count;
+        s->ms    = (double)(bench_now_ns() - t0) / 1e6;
+    }
+    r->ms = (double)(bench_now_ns() - t_all) / 1e6;
+    return 0;
+}
+
+void print_opt_report(const OptReport *r)
+{
+    printf("    %-9s %8s %8s %8s %8s %5s %9s\n",
+           "pass", "before", "after", "removed", "changed", "runs", "ms");
+    for (int k = 0; k < r->n; k++) {
+        const OptPassStats *s = &r->pass[k];
+        printf("    %-9s %8u %8u %8lld %8u %5u %9.3f\n", opt_pass_name(s->pass), s->before, s->after,
+               (long long)s->before - s->after, s->changed, s->iterations, s->ms);
+    }
+    if (r->n) {
+        printf("    %-9s %8u %8u %8lld %8s %5s %9.3f\n", "total", r->pass[0].before,
+               r->pass[r->n - 1].after, (long long)r->pass[0].before - r->pass[r->n - 1].after,
+               "", "", r->ms);
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * Chapter 22 — Optimisation passes over chapter 21 TAC
+ *
+ *   fold      constants propagated and folded inside each block,
+ *             algebraic identities (x + 0, x * 1, x * 0, 0 - x ...),
+ *             branches on constants turned into jumps or removed
+ *   cse       local value numbering: an expression this block already
+ *             computed becomes a copy of a name still holding it, and
+ *             every operand is read from the oldest name holding its
+ *             value (so the copies die)
+ *   dce       unreachable blocks, jumps to the next instruction, unused
+ *             labels, and assignments nothing reads — backward liveness
+ *             over the CFG, with variables live at every exit
+ *   strength  x * 2^k → x << k,  x / 2^k → a shift with the rounding
+ *             fix-up for negative x (division truncates toward zero)
+ *   licm      arithmetic whose operands no instruction in a natural loop
+ *             writes moves to a new preheader; the loop keeps a copy
+ *   sccp      chapter 21's SSA round trip: constants propagated through
+ *             the whole CFG, branches decided, SSA dead-code removal
+ *
+ * A pipeline is a list of passes.  Each pass is re-run until a run
+ * changes nothing (at most OPT_MAX_ITERATIONS runs), and reports the
+ * instructions it removed, what it changed, the runs it took and its
+ * wall time.  Presets:
+ *
+ *   -O0   (nothing)
+ *   -O1   fold, dce
+ *   -O2   sccp, fold, licm, strength, cse, fold, dce
+ *
+ * Passes rewrite the TacProgram in place and keep what tac_exec()
+ * observes: the return value and every variable's final value.  TAC
+ * arithmetic is total (x / 0 = 0), so evaluating an instruction the
+ * original would have skipped — as LICM does for a loop that runs zero
+ * times — is harmless.
+ */
+
+#ifndef PASSES_H
+#define PASSES_H
+
+#include <stdint.h>
+
+#include "../21_intermediate_repr/tac.h"
+
+typedef enum {
+    OPT_FOLD,
+    OPT_CSE,
+    OPT_DCE,
+    OPT_STRENGTH,
+    OPT_LICM,
+    OPT_SCCP,
+    OPT_PASS_COUNT
+} OptPass;
+
+#define OPT_MAX_PASSES      16
+#define OPT_MAX_ITERATIONS  16
+
+typedef struct {
+    OptPass pass[OPT_MAX_PASSES];
+    int     n;
+} OptPipeline;
+
+typedef struct {
+    OptPass  pass;
+    uint32_t before;        /* instructions going in           */
+    uint32_t after;         /* ... and coming out              */
+    uint32_t changed;       /* instructions rewritten, removed or hoisted */
+    uint32_t iterations;    /* runs, the last one changing nothing */
+    double   ms;
+} OptPassStats;
+
+typedef struct {
+    OptPassStats pass[OPT_MAX_PASSES];
+    int          n;
+    double       ms;
+} OptReport;
+
+const char *opt_pass_name(OptPass pass);
+
+/* "-O0" / "-O1" / "-O2" or a comma-separated pass list such as
+ * "fold,cse,dce".  0 on success, -1 for an unknown name or too many. */
+int opt_parse(OptPipeline *pl, const char *spec);
+
+/* One run of one pass; *changed receives what it changed.
+ * 0 on success, -1 on OOM (p is then unchanged or still valid). */
+int opt_run_pass(TacProgram *p, OptPass pass, uint32_t *changed);
+
+/* The whole pipeline, each pass to its fixpoint.  r may be NULL. */
+int opt_run(TacProgram *p, const OptPipeline *pl, OptReport *r);
+
+void print_opt_report(const OptReport *r);
+
+#endif /* PASSES_H */
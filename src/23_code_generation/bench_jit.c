@@ -0,0 +1,278 @@
+/*
+ * Expression evaluation benchmark — tree walk vs bytecode VM vs JIT
+ *
+ * Each hot expression is compiled once and evaluated over --rows rows
+ * of random variable values by every engine:
+ *
+ *   tree     chapter 19 eval_ast_env(): recursive walk of the AST
+ *   vm       chapter 19 bc_eval(): register bytecode, computed goto
+ *   tac      chapter 21 tac_exec(): the TAC interpreter (the JIT's fallback)
+ *   jit      jit.c: the same TAC as native code
+ *   jit-O2   ... after chapter 22's -O2 pipeline
+ *   jit-ra   ... and with regalloc.c's linear scan instead of the stack
+ *
+ * Every engine must produce the same checksum over all rows.  Times are
+ * the median of --reps runs, as ns per evaluation, and the speedup is
+ * against the tree walk.  Compile times (bytecode, TAC lowering, JIT
+ * emit + mmap) are reported once per expression.
+ *
+ * Build: make bench_jit
+ * Run:   ./bin/bench_jit [--rows N] [--reps R] [--seed S] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "../19_parsing_ast/bytecode.h"
+#include "../22_optimisation/passes.h"
+#include "jit.h"
+#include "regalloc.h"
+
+#define N_VARS 6    /* a b c d x y */
+
+static const char *const var_names[N_VARS] = { "a", "b", "c", "d", "x", "y" };
+
+static const struct { const char *name, *src; } exprs[] = {
+    { "small",  "x * x + 3 * y" },
+    { "horner", "((a * x + b) * x + c) * x + d" },
+    { "common", "(a + b) * (a + b) - (c - d) * (c - d) + (a + b) * (c - d) / 7" },
+    { "wide",   "a * 3 + b * 5 - c * 7 + d * 11 - x * 13 + y * 17 + (a - b) * (c - d) * (x - y)"
+                " + (a * b - c * d) / 9 + (x + 1) * (y + 2) * 4 - (a + c + x) * (b + d + y)" },
+};
+#define EXPR_COUNT ((int)(sizeof(exprs) / sizeof(exprs[0])))
+
+typedef enum { ENG_TREE, ENG_VM, ENG_TAC, ENG_JIT, ENG_JIT_O2, ENG_JIT_RA, ENG_COUNT } Engine;
+
+static const char *const engine_names[ENG_COUNT] = { "tree", "vm", "tac", "jit", "jit-O2", "jit-ra" };
+
+typedef struct {
+    ASTNode   *root;
+    BcProgram  bc;
+    TacProgram tac, tac_o2;
+    JitCode    jit, jit_o2, jit_ra;
+    double     ms_bc, ms_tac, ms_jit, ms_ra;
+} Compiled;
+
+typedef struct {
+    size_t         rows;
+    int            reps;
+    uint32_t       seed;
+    bench_format_t format;
+} Config;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Compiling and running
+ * ════════════════════════════════════════════════════════════════ */
+
+static int compile(Compiled *c, const char *src)
+{
+    ExprVars vars;
+    Parser   parser;
+    memset(c, 0, sizeof(*c));
+    expr_vars_init(&vars);
+    for (int v = 0; v < N_VARS; v++) expr_vars_slot(&vars, var_names[v], 1);   /* slot v */
+    parser_init(&parser, src);
+    parser_set_vars(&parser, &vars);
+    c->root = parse_expr(&parser);
+    if (!c->root) return -1;
+
+    uint64_t t0 = bench_now_ns();
+    if (bc_compile(c->root, &c->bc) != 0) return -1;
+    c->ms_bc = (double)(bench_now_ns() - t0) / 1e6;
+
+    /* TAC variable i must be slot i, whatever order the tree uses them in */
+    t0 = bench_now_ns();
+    tac_init(&c->tac);
+    for (int v = 0; v < N_VARS; v++) tac_var(&c->tac, var_names[v], 1);
+    if (tac_lower_return(&c->tac, c->root, &vars) != 0) return -1;
+    c->ms_tac = (double)(bench_now_ns() - t0) / 1e6;
+
+    tac_init(&c->tac_o2);
+    for (int v = 0; v < N_VARS; v++) tac_var(&c->tac_o2, var_names[v], 1);
+    OptPipeline pl;
+    if (tac_lower_return(&c->tac_o2, c->root, &vars) != 0 || opt_parse(&pl, "-O2") != 0 ||
+        opt_run(&c->tac_o2, &pl, NULL) != 0)
+        return -1;
+
+    t0 = bench_now_ns();
+    if (jit_compile(&c->jit, &c->tac, NULL) != 0) return -1;
+    c->ms_jit = (double)(bench_now_ns() - t0) / 1e6;
+    if (jit_compile(&c->jit_o2, &c->tac_o2, NULL) != 0) return -1;
+
+    /* No host back end: jit_compile() interprets whatever it is given */
+    RegAlloc ra;
+    if (JIT_HOST == JIT_ARCH_COUNT) return jit_compile(&c->jit_ra, &c->tac_o2, NULL);
+    if (ra_allocate(&ra, &c->tac_o2, JIT_HOST, 0) != 0) return -1;
+    c->ms_ra = ra.ms_liveness + ra.ms_scan;
+    int rc = jit_compile(&c->jit_ra, &c->tac_o2, &ra);
+    ra_free(&ra);
+    return rc;
+}
+
+static void release(Compiled *c)
+{
+    free_ast(c->root);
+    bc_free(&c->bc);
+    jit_free(&c->jit);
+    jit_free(&c->jit_o2);
+    jit_free(&c->jit_ra);
+    tac_free(&c->tac);
+    tac_free(&c->tac_o2);
+}
+
+/* One pass over all rows; the sum of the results */
+static uint32_t run(Compiled *c, Engine e, int32_t *rows, size_t n)
+{
+    uint32_t sum = 0;
+    for (size_t r = 0; r < n; r++) {
+        int32_t *v = rows + r * N_VARS;
+        int32_t  x;
+        switch (e) {
+        case ENG_TREE:   x = eval_ast_env(c->root, v);      break;
+        case ENG_VM:     x = bc_eval(&c->bc, v);            break;
+        case ENG_TAC:    x = tac_exec(&c->tac, v, NULL);    break;
+        case ENG_JIT:    x = jit_call(&c->jit, v);          break;
+        case ENG_JIT_O2: x = jit_call(&c->jit_o2, v);       break;
+        default:         x = jit_call(&c->jit_ra, v);       break;
+        }
+        sum += (uint32_t)x;
+    }
+    return sum;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Command line and report
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--rows N] [--reps R] [--seed S] [--format text|csv|json]\n", argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--rows") == 0) {
+            cfg->rows = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--seed") == 0) {
+            cfg->seed = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->rows >= 1 && cfg->reps >= 1 ? 0 : -1;
+}
+
+static const JitCode *jit_of(const Compiled *c, Engine g)
+{
+    return g == ENG_JIT ? &c->jit : g == ENG_JIT_O2 ? &c->jit_o2 : &c->jit_ra;
+}
+
+static void report(const Config *cfg, int e, Engine g, const Compiled *c, double ns,
+                   double base_ns, uint32_t sum, int first)
+{
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-7s %-7s %10.2f %9.2fx   %08x\n", first ? exprs[e].name : "", engine_names[g],
+               ns, base_ns / ns, sum);
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%s,%zu,%.3f,%.3f,%08x,%d\n", exprs[e].name, engine_names[g], cfg->rows, ns,
+               base_ns / ns, sum, g >= ENG_JIT ? jit_of(c, g)->fn != NULL : 0);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"expr\": \"%s\", \"engine\": \"%s\", \"rows\": %zu, \"ns_per_eval\": %.3f, "
+               "\"speedup\": %.3f, \"checksum\": \"%08x\" }",
+               e == 0 && first && g == ENG_TREE ? "" : ",", exprs[e].name, engine_names[g],
+               cfg->rows, ns, base_ns / ns, sum);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 1000000, 5, 23, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int32_t *rows = malloc(cfg.rows * N_VARS * sizeof(int32_t));
+    if (!rows) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    uint32_t rng = cfg.seed * 2654435761u + 1;
+    for (size_t i = 0; i < cfg.rows * N_VARS; i++) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        rows[i] = (int32_t)(rng % 2001) - 1000;
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_jit: %zu rows, median of %d runs, JIT for %s%s\n\n", cfg.rows, cfg.reps,
+               jit_arch_name(JIT_HOST), JIT_HOST == JIT_ARCH_COUNT ? " (interpreting)" : "");
+        printf("  %-7s %-7s %10s %10s   %-8s\n", "expr", "engine", "ns/eval", "vs tree", "checksum");
+        break;
+    case BENCH_FMT_CSV:
+        printf("expr,engine,rows,ns_per_eval,speedup,checksum,native\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"jit\",\n  \"arch\": \"%s\",\n  \"results\": [",
+               jit_arch_name(JIT_HOST));
+        break;
+    }
+
+    int agree = 1;
+    for (int e = 0; e < EXPR_COUNT; e++) {
+        Compiled c;
+        if (compile(&c, exprs[e].src) != 0) {
+            fprintf(stderr, "%s: compile failed\n", exprs[e].name);
+            release(&c);
+            free(rows);
+            return 1;
+        }
+        double   base_ns = 0;
+        uint32_t base_sum = 0;
+        for (int g = 0; g < ENG_COUNT; g++) {
+            uint64_t t[64];
+            uint32_t sum  = 0;
+            int      reps = cfg.reps < 64 ? cfg.reps : 64;
+            run(&c, (Engine)g, rows, cfg.rows < 1000 ? cfg.rows : 1000);     /* warmup */
+            for (int r = 0; r < reps; r++) {
+                uint64_t t0 = bench_now_ns();
+                sum  = run(&c, (Engine)g, rows, cfg.rows);
+                t[r] = bench_now_ns() - t0;
+            }
+            double ns = (double)bench_percentile(t, (size_t)reps, 50) / (double)cfg.rows;
+            if (g == ENG_TREE) { base_ns = ns; base_sum = sum; }
+            agree &= sum == base_sum;
+            report(&cfg, e, (Engine)g, &c, ns, base_ns, sum, g == ENG_TREE);
+        }
+        if (cfg.format == BENCH_FMT_TEXT)
+            printf("  %-7s compile: bytecode %.3f ms, TAC %.3f ms, JIT %.3f ms, regalloc %.3f ms\n"
+                   "  %-7s          %u TAC → %u at -O2; %zu bytes on the stack, %zu in registers\n\n",
+                   "", c.ms_bc, c.ms_tac, c.ms_jit, c.ms_ra, "", c.tac.count, c.tac_o2.count,
+                   c.jit_o2.size, c.jit_ra.size);
+        release(&c);
+    }
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"same_results\": %s\n}\n", agree ? "true" : "false");
+    else if (cfg.format == BENCH_FMT_TEXT)
+        printf("  Every engine %s on every checksum.\n", agree ? "agrees" : "DISAGREES");
+    free(rows);
+    return agree ? 0 : 1;
+}
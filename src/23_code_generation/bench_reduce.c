@@ -0,0 +1,322 @@
+/*
+ * Reduction kernel benchmark — scalar vs auto-vectorised vs SIMD
+ *
+ * Every reduce.c kernel in every variant this CPU runs, over working
+ * sets sized for L1, L2, the last-level cache and DRAM:
+ *
+ *   sum_i32  sum_i64  minmax      read 4 bytes per element
+ *   dot_i64                       read 8
+ *   prefix_i32                    read 4, write 4
+ *   prefix_i64                    read 4, write 8
+ *
+ * "scalar" is reduce_scalar.c at the default -O2, which GCC leaves
+ * scalar; "autovec" is the same file built -O3 -march=native, i.e.
+ * what the compiler's vectoriser makes of the loops.  Each variant's
+ * result (the whole output, for the prefix sums) must equal scalar's.
+ *
+ * Measurement as in bench_loops: a warmup call calibrates the calls
+ * per sample of about --sample-ms, then --reps samples; the report is
+ * the median, in GB/s of the bytes above.
+ *
+ * Build: make bench_reduce
+ * Run:   ./bin/bench_reduce [--kernel NAME|all] [--max-mb MB] [--reps R]
+ *                           [--sample-ms MS] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "reduce.h"
+
+static inline void escape(const void *p) { __asm__ volatile("" : : "r"(p) : "memory"); }
+
+/* ════════════════════════════════════════════════════════════════
+ *  Kernels — one call through a variant, returning its result
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    int32_t *a, *b;
+    int32_t *out32;
+    int64_t *out64;
+    size_t   n;
+} Data;
+
+typedef uint64_t (*KernelFn)(const ReduceKernels *k, Data *d);
+
+static uint64_t run_sum_i32(const ReduceKernels *k, Data *d) { return (uint32_t)k->sum_i32(d->a, d->n); }
+static uint64_t run_sum_i64(const ReduceKernels *k, Data *d) { return (uint64_t)k->sum_i64(d->a, d->n); }
+static uint64_t run_dot_i64(const ReduceKernels *k, Data *d) { return (uint64_t)k->dot_i64(d->a, d->b, d->n); }
+
+static uint64_t run_minmax(const ReduceKernels *k, Data *d)
+{
+    int32_t lo, hi;
+    k->minmax(d->a, d->n, &lo, &hi);
+    return (uint64_t)(uint32_t)lo << 32 | (uint32_t)hi;
+}
+
+static uint64_t run_prefix_i32(const ReduceKernels *k, Data *d)
+{
+    k->prefix_i32(d->a, d->out32, d->n);
+    escape(d->out32);
+    return (uint32_t)d->out32[d->n - 1];
+}
+
+static uint64_t run_prefix_i64(const ReduceKernels *k, Data *d)
+{
+    k->prefix_i64(d->a, d->out64, d->n);
+    escape(d->out64);
+    return (uint64_t)d->out64[d->n - 1];
+}
+
+typedef struct {
+    const char *name;
+    KernelFn    run;
+    int         bytes_per_elem;     /* read + written */
+    int         out_bytes;          /* per element, into out32/out64 */
+} Kernel;
+
+static const Kernel kernels[] = {
+    { "sum_i32",    run_sum_i32,    4, 0 },
+    { "sum_i64",    run_sum_i64,    4, 0 },
+    { "minmax",     run_minmax,     4, 0 },
+    { "dot_i64",    run_dot_i64,    8, 0 },
+    { "prefix_i32", run_prefix_i32, 8, 4 },
+    { "prefix_i64", run_prefix_i64, 12, 8 },
+};
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/* Same result as scalar, including the whole prefix-sum output */
+static int agrees(const Kernel *kn, const ReduceKernels *k, const ReduceKernels *ref, Data *d,
+                  void *scratch)
+{
+    uint64_t want = kn->run(ref, d);
+    if (kn->out_bytes) memcpy(scratch, kn->out_bytes == 4 ? (void *)d->out32 : (void *)d->out64,
+                              d->n * (size_t)kn->out_bytes);
+    if (kn->run(k, d) != want) return 0;
+    return !kn->out_bytes ||
+           memcmp(scratch, kn->out_bytes == 4 ? (void *)d->out32 : (void *)d->out64,
+                  d->n * (size_t)kn->out_bytes) == 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Measurement
+ * ════════════════════════════════════════════════════════════════ */
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, int n)
+{
+    qsort(v, (size_t)n, sizeof(*v), cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/* Median ns per element */
+static double measure(const Kernel *kn, const ReduceKernels *k, Data *d, int reps, double sample_ms)
+{
+    uint64_t t0  = bench_now_ns();
+    kn->run(k, d);
+    uint64_t one = bench_now_ns() - t0;
+    int calls = one > 0 ? (int)(sample_ms * 1e6 / (double)one) : 1000;
+    if (calls < 1)    calls = 1;
+    if (calls > 1000) calls = 1000;
+
+    double   v[64];
+    uint64_t sink = 0;
+    for (int r = 0; r < reps; r++) {
+        t0 = bench_now_ns();
+        for (int c = 0; c < calls; c++) sink += kn->run(k, d);
+        v[r] = (double)(bench_now_ns() - t0) / ((double)calls * (double)d->n);
+    }
+    escape(&sink);
+    return median(v, reps);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Configuration and report
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    const char *label;
+    size_t      bytes;          /* working set */
+} Size;
+
+static const Size sizes[] = {
+    { "L1",   16u << 10 },
+    { "L2",  192u << 10 },
+    { "LLC",   4u << 20 },
+    { "DRAM", 64u << 20 },
+};
+#define SIZE_COUNT ((int)(sizeof(sizes) / sizeof(sizes[0])))
+
+#define MAX_VARIANTS 8
+
+typedef struct {
+    int            kernel;      /* -1 = all */
+    size_t         max_mb;
+    int            reps;
+    double         sample_ms;
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--kernel sum_i32|sum_i64|minmax|dot_i64|prefix_i32|prefix_i64|all]\n"
+            "       %*s [--max-mb MB] [--reps R] [--sample-ms MS] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--kernel") == 0) {
+            cfg->kernel = -2;
+            if (strcmp(val, "all") == 0) cfg->kernel = -1;
+            for (int k = 0; k < KERNEL_COUNT; k++)
+                if (strcmp(val, kernels[k].name) == 0) cfg->kernel = k;
+            if (cfg->kernel == -2) return -1;
+        } else if (strcmp(opt, "--max-mb") == 0) {
+            cfg->max_mb = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--sample-ms") == 0) {
+            cfg->sample_ms = atof(val);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && cfg->reps <= 64 && cfg->sample_ms > 0 ? 0 : -1;
+}
+
+static void report(const Config *cfg, const Kernel *kn, const Size *s, size_t ws,
+                   const ReduceKernels *const *var, size_t n_var, const double *ns,
+                   const int *same, int *first)
+{
+    double gbs[MAX_VARIANTS];
+    int    all_same = 1;
+    for (size_t v = 0; v < n_var; v++) {
+        gbs[v]    = kn->bytes_per_elem / ns[v];
+        all_same &= same[v];
+    }
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        /* var[0] is scalar, var[1] autovec; the one reduce_best() picks is last */
+        printf("  %-10s %-4s %8.0f KiB", kn->name, s->label, (double)ws / 1024);
+        for (size_t v = 0; v < n_var; v++) printf(" %8.2f", gbs[v]);
+        printf("  %7.2fx %7.2fx  %s\n", ns[0] / ns[n_var - 1], ns[1] / ns[n_var - 1],
+               all_same ? "✓" : "RESULTS DIFFER");
+        break;
+    case BENCH_FMT_CSV:
+        for (size_t v = 0; v < n_var; v++)
+            printf("%s,%s,%zu,%s,%.4f,%.3f,%.3f,%d\n", kn->name, s->label, ws, var[v]->name, ns[v],
+                   gbs[v], ns[0] / ns[v], same[v]);
+        break;
+    case BENCH_FMT_JSON:
+        for (size_t v = 0; v < n_var; v++) {
+            printf("%s\n    { \"kernel\": \"%s\", \"size\": \"%s\", \"bytes\": %zu, \"variant\": \"%s\", "
+                   "\"ns_per_elem\": %.4f, \"gb_s\": %.3f, \"vs_scalar\": %.3f, \"same_result\": %s }",
+                   *first ? "" : ",", kn->name, s->label, ws, var[v]->name, ns[v], gbs[v],
+                   ns[0] / ns[v], same[v] ? "true" : "false");
+            *first = 0;
+        }
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { -1, 64, 11, 5.0, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* scalar, autovec, then the hand-written ones this CPU runs */
+    static const ReduceKernels autovec = {
+        "autovec", reduce_autovec_sum_i32, reduce_autovec_sum_i64, reduce_autovec_minmax,
+        reduce_autovec_dot_i64, reduce_autovec_prefix_i32, reduce_autovec_prefix_i64,
+    };
+    const ReduceKernels *simd[MAX_VARIANTS], *var[MAX_VARIANTS];
+    size_t n_simd = reduce_variants(simd, MAX_VARIANTS - 1), n_var = 0;
+    var[n_var++] = simd[0];
+    var[n_var++] = &autovec;
+    for (size_t v = 1; v < n_simd; v++) var[n_var++] = simd[v];
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_reduce: %d reps of ~%.0f ms, median GB/s; reduce_*() dispatch to %s\n\n",
+               cfg.reps, cfg.sample_ms, reduce_best()->name);
+        printf("  %-10s %-4s %12s", "kernel", "size", "working set");
+        for (size_t v = 0; v < n_var; v++) printf(" %8s", var[v]->name);
+        printf("  %8s %8s\n", reduce_best()->name, reduce_best()->name);
+        printf("  %-10s %-4s %12s", "", "", "");
+        for (size_t v = 0; v < n_var; v++) printf(" %8s", "GB/s");
+        printf("  %8s %8s\n", "/scalar", "/autovec");
+        break;
+    case BENCH_FMT_CSV:
+        printf("kernel,size,bytes,variant,ns_per_elem,gb_s,vs_scalar,same_result\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"reduce\",\n  \"dispatch\": \"%s\",\n  \"results\": [",
+               reduce_best()->name);
+        break;
+    }
+
+    int all_same = 1, first = 1;
+    for (int s = 0; s < SIZE_COUNT; s++) {
+        if (sizes[s].bytes > cfg.max_mb << 20) continue;
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+            if (cfg.kernel >= 0 && cfg.kernel != k) continue;
+            const Kernel *kn = &kernels[k];
+
+            Data d = { 0 };
+            d.n     = sizes[s].bytes / (size_t)kn->bytes_per_elem;
+            d.a     = malloc(d.n * sizeof(int32_t));
+            d.b     = malloc(d.n * sizeof(int32_t));
+            d.out32 = malloc(d.n * sizeof(int32_t));
+            d.out64 = malloc(d.n * sizeof(int64_t));
+            void *scratch = malloc(d.n * sizeof(int64_t));
+            if (!d.a || !d.b || !d.out32 || !d.out64 || !scratch) {
+                fprintf(stderr, "out of memory\n");
+                free(d.a); free(d.b); free(d.out32); free(d.out64); free(scratch);
+                return 1;
+            }
+            /* The full int32_t range, so the 32-bit kernels wrap */
+            for (size_t i = 0; i < d.n; i++) {
+                d.a[i] = (int32_t)(uint32_t)(i * 2654435761u ^ (i >> 7));
+                d.b[i] = (int32_t)(((uint32_t)i ^ 0x5bd1e995u) * 3u);
+            }
+
+            double ns[MAX_VARIANTS];
+            int    same[MAX_VARIANTS];
+            for (size_t v = 0; v < n_var; v++) {
+                same[v]   = v == 0 || agrees(kn, var[v], var[0], &d, scratch);
+                all_same &= same[v];
+                ns[v]     = measure(kn, var[v], &d, cfg.reps, cfg.sample_ms);
+            }
+            report(&cfg, kn, &sizes[s], d.n * (size_t)kn->bytes_per_elem, var, n_var, ns, same, &first);
+            free(d.a); free(d.b); free(d.out32); free(d.out64); free(scratch);
+        }
+        if (cfg.format == BENCH_FMT_TEXT && cfg.kernel < 0) printf("\n");
+    }
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"same_results\": %s\n}\n", all_same ? "true" : "false");
+    else if (cfg.format == BENCH_FMT_TEXT)
+        printf("  Every variant %s with scalar.\n", all_same ? "agrees" : "DISAGREES");
+    return all_same ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+/*
+ * Register allocation benchmark — linear scan vs everything on the stack
+ *
+ * Generated functions (chapter 21's tac_generate_wide(): branches,
+ * loops and --locals temporaries all live to the end) of growing size
+ * are allocated by regalloc.c and compiled by jit.c twice: with the
+ * allocation, and with every temporary in its stack slot.  Per
+ * function:
+ *
+ *   max-live   most intervals live at one point — the pressure
+ *   spill      intervals in a slot all their life / split part-way
+ *   slots      spill slots after reuse, against one per temporary
+ *   mem ops    static slot loads + stores in the code, both ways
+ *   alloc      liveness (CFG, bitset dataflow, intervals) + scan time
+ *   ns/call    median time to run the function, both ways (host only)
+ *
+ * Every allocated function is checked against tac_exec() on the same
+ * inputs.  --regs caps the registers to force spilling; --arch aarch64
+ * on an x86 host reports the allocation without running it.
+ *
+ * Build: make bench_regalloc
+ * Run:   ./bin/bench_regalloc [--instrs N] [--locals W] [--regs K] [--arch x86-64|aarch64]
+ *                             [--reps R] [--seed S] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../../include/bench.h"
+#include "regalloc.h"
+
+typedef struct {
+    uint32_t       instrs;          /* 0: the default sweep */
+    uint32_t       locals;          /* 0: the default sweep */
+    uint32_t       regs;            /* 0: all of them       */
+    JitArch        arch;
+    int            reps;
+    uint32_t       seed;
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    uint32_t instrs, locals;
+    RegAlloc ra;
+    size_t   bytes_stack, bytes_ra;
+    double   ns_stack, ns_ra;       /* 0: not run (not the host) */
+    int      ok;
+} Result;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Measuring one function
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Median ns per call over reps samples of enough calls to take ~1 ms */
+static double time_calls(const JitCode *j, const int32_t *init, uint32_t n_vars, int reps)
+{
+    int32_t  vars[8];
+    uint64_t t[64];
+    uint64_t calls = 1;
+    memcpy(vars, init, n_vars * sizeof(int32_t));
+    uint64_t t0 = bench_now_ns();
+    jit_call(j, vars);
+    uint64_t once = bench_now_ns() - t0;
+    if (once < 1000000) calls = 1000000 / (once + 1) + 1;
+
+    if (reps > 64) reps = 64;
+    for (int r = 0; r < reps; r++) {
+        t0 = bench_now_ns();
+        for (uint64_t c = 0; c < calls; c++) {
+            memcpy(vars, init, n_vars * sizeof(int32_t));
+            jit_call(j, vars);
+        }
+        t[r] = bench_now_ns() - t0;
+    }
+    return (double)bench_percentile(t, (size_t)reps, 50) / (double)calls;
+}
+
+static int measure(Result *res, const Config *cfg, uint32_t instrs, uint32_t locals)
+{
+    TacProgram p;
+    memset(res, 0, sizeof(*res));
+    res->instrs = instrs;
+    res->locals = locals;
+    tac_init(&p);
+    if (tac_generate_wide(&p, instrs, locals, cfg->seed + instrs + locals) != 0 ||
+        ra_allocate(&res->ra, &p, cfg->arch, cfg->regs) != 0) {
+        tac_free(&p);
+        return -1;
+    }
+
+    JitCode stack, alloc;
+    memset(&stack, 0, sizeof(stack));
+    memset(&alloc, 0, sizeof(alloc));
+    int rc = -1;
+    if (cfg->arch != JIT_HOST) {
+        /* Encode only: the sizes, but nothing to run */
+        if (jit_emit(&stack, &p, cfg->arch, NULL) == 0 && jit_emit(&alloc, &p, cfg->arch, &res->ra) == 0) {
+            res->bytes_stack = stack.size;
+            res->bytes_ra    = alloc.size;
+            res->ok          = 1;
+            rc               = 0;
+        }
+    } else if (jit_compile(&stack, &p, NULL) == 0 && jit_compile(&alloc, &p, &res->ra) == 0) {
+        int32_t  init[8] = { 0 }, x[8], y[8], z[8];
+        uint32_t rng = cfg->seed * 2654435761u + 1;
+        for (uint32_t v = 0; v < p.n_vars && v < 8; v++) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            init[v] = (int32_t)(rng % 2001) - 1000;
+        }
+        memcpy(x, init, sizeof(x));
+        memcpy(y, init, sizeof(y));
+        memcpy(z, init, sizeof(z));
+        int32_t want = tac_exec(&p, x, NULL);
+        res->ok = jit_call(&stack, y) == want && jit_call(&alloc, z) == want &&
+                  memcmp(x, y, sizeof(x)) == 0 && memcmp(x, z, sizeof(x)) == 0;
+        res->bytes_stack = stack.size;
+        res->bytes_ra    = alloc.size;
+        if (alloc.fn && stack.fn) {
+            res->ns_stack = time_calls(&stack, init, p.n_vars, cfg->reps);
+            res->ns_ra    = time_calls(&alloc, init, p.n_vars, cfg->reps);
+        }
+        rc = 0;
+    }
+    jit_free(&stack);
+    jit_free(&alloc);
+    tac_free(&p);
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Command line and report
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--instrs N] [--locals W] [--regs K] [--arch x86-64|aarch64]\n"
+                    "       %*s [--reps R] [--seed S] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--instrs") == 0) {
+            cfg->instrs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--locals") == 0) {
+            cfg->locals = (uint32_t)strtoul(val, NULL, 10);
+            if (cfg->locals < 2 || cfg->locals > TAC_GEN_MAX_LOCALS) return -1;
+        } else if (strcmp(opt, "--regs") == 0) {
+            cfg->regs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--arch") == 0) {
+            if (strcmp(val, "x86-64") == 0)       cfg->arch = JIT_X86_64;
+            else if (strcmp(val, "aarch64") == 0) cfg->arch = JIT_AARCH64;
+            else return -1;
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--seed") == 0) {
+            cfg->seed = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && (cfg->instrs == 0 || cfg->instrs >= 16) ? 0 : -1;
+}
+
+static void report(const Config *cfg, const Result *r, int first)
+{
+    const RegAlloc *ra   = &r->ra;
+    uint32_t        base = ra->base_reads + ra->base_writes, mem = ra->mem_reads + ra->mem_writes;
+    double          ms   = ra->ms_liveness + ra->ms_scan;
+
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %7u %6u %8u %5u/%-5u %6u/%-6u %8u → %-7u %7.3f + %-6.3f",
+               r->instrs, r->locals, ra->max_live, ra->n_spilled, ra->n_split, ra->n_slots,
+               ra->n_temps, base, mem, ra->ms_liveness, ra->ms_scan);
+        if (r->ns_ra > 0)
+            printf(" %9.0f → %-8.0f %5.2fx", r->ns_stack, r->ns_ra, r->ns_stack / r->ns_ra);
+        else
+            printf(" %9s   %-8s %6s", "-", "-", "");
+        printf(" %s\n", r->ok ? "✓" : "✗");
+        break;
+    case BENCH_FMT_CSV:
+        printf("%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.4f,%.4f,%zu,%zu,%.1f,%.1f,%d\n",
+               jit_arch_name(cfg->arch), r->instrs, r->locals, ra->n_regs, ra->n_intervals,
+               ra->max_live, ra->n_spilled, ra->n_split, ra->n_slots, ra->n_reloads, base, mem,
+               ra->ms_liveness, ra->ms_scan, r->bytes_stack, r->bytes_ra, r->ns_stack, r->ns_ra, r->ok);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"instrs\": %u, \"locals\": %u, \"intervals\": %u, \"max_live\": %u, "
+               "\"spilled\": %u, \"split\": %u, \"slots\": %u, \"temps\": %u, \"reloads\": %u, "
+               "\"mem_ops_stack\": %u, \"mem_ops_ra\": %u, \"alloc_ms\": %.4f, "
+               "\"bytes_stack\": %zu, \"bytes_ra\": %zu, \"ns_per_call_stack\": %.1f, "
+               "\"ns_per_call_ra\": %.1f, \"ok\": %s }",
+               first ? "" : ",", r->instrs, r->locals, ra->n_intervals, ra->max_live, ra->n_spilled,
+               ra->n_split, ra->n_slots, ra->n_temps, ra->n_reloads, base, mem, ms, r->bytes_stack,
+               r->bytes_ra, r->ns_stack, r->ns_ra, r->ok ? "true" : "false");
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t sizes[]  = { 1000, 10000, 100000 };
+    static const uint32_t widths[] = { 8, 16, 32, 64 };
+    Config cfg = { 0, 0, 0, JIT_HOST == JIT_ARCH_COUNT ? JIT_X86_64 : JIT_HOST, 5, 16, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    const RaTarget *target = ra_target(cfg.arch);
+    uint32_t n_regs = cfg.regs && cfg.regs < target->n_regs ? cfg.regs : target->n_regs;
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_regalloc: %s, %u registers%s, median of %d runs\n\n", jit_arch_name(cfg.arch),
+               n_regs, cfg.arch == JIT_HOST ? "" : " (not the host: allocation only)", cfg.reps);
+        printf("  %7s %6s %8s %5s/%-5s %6s/%-6s %8s → %-7s %7s + %-6s %9s → %-8s\n", "instrs",
+               "locals", "max-live", "spill", "split", "slots", "temps", "mem ops", "ra", "live ms",
+               "scan", "ns/call", "ra");
+        break;
+    case BENCH_FMT_CSV:
+        printf("arch,instrs,locals,regs,intervals,max_live,spilled,split,slots,reloads,mem_ops_stack,"
+               "mem_ops_ra,liveness_ms,scan_ms,bytes_stack,bytes_ra,ns_per_call_stack,ns_per_call_ra,ok\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"regalloc\",\n  \"arch\": \"%s\",\n  \"registers\": %u,\n  \"results\": [",
+               jit_arch_name(cfg.arch), n_regs);
+        break;
+    }
+
+    int all_ok = 1, first = 1;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t instrs = cfg.instrs ? cfg.instrs : sizes[s];
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            uint32_t locals = cfg.locals ? cfg.locals : widths[w];
+            Result   r;
+            if (measure(&r, &cfg, instrs, locals) != 0) {
+                fprintf(stderr, "%u instrs × %u locals: out of memory or not encodable\n", instrs, locals);
+                ra_free(&r.ra);
+                return 1;
+            }
+            report(&cfg, &r, first);
+            all_ok &= r.ok;
+            first = 0;
+            ra_free(&r.ra);
+            if (cfg.locals) break;
+        }
+        if (cfg.instrs) break;
+    }
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"all_ok\": %s\n}\n", all_ok ? "true" : "false");
+    else if (cfg.format == BENCH_FMT_TEXT)
+        printf("\n  %s\n", all_ok ? "Every function agrees with tac_exec() both ways."
+                                  : "SOME FUNCTIONS DISAGREE with tac_exec().");
+    return all_ok ? 0 : 1;
+}
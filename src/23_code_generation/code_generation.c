@@ -2,12 +2,31 @@
  * ║  Chapter 23 — Code Generation                                   ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: Register alloc, instruction selection, calling conv    ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Section 8 compiles chapter 21 three-address code to x86-64 and
+ * AArch64 machine code with jit.c and runs it from executable pages;
+ * Section 9 gives its temporaries registers with regalloc.c.  Section 6
+ * runs array_sum()'s SIMD relatives from reduce.c.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/23_code_generation \
+ *            src/23_code_generation/code_generation.c src/23_code_generation/jit.c \
+ *            src/23_code_generation/regalloc.c src/23_code_generation/reduce.c \
+ *            src/23_code_generation/reduce_scalar.c src/21_intermediate_repr/tac.c \
+ *            src/21_intermediate_repr/cfg.c src/19_parsing_ast/expr.c
+ * Run:   ./bin/23_code_generation
+ */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "jit.h"
+#include "reduce.h"
+#include "regalloc.h"
+
 /* ════════════════════════════════════════════════════════════════════
  *  Example functions — designed to produce readable assembly
  *  Compile with: gcc -S -masm=intel -O0 code_generation.c
@@ -223,6 +242,9 @@ static void demo_register_allocation(void)
     printf("  Modern compilers (GCC, LLVM) use more sophisticated algorithms:\n");
     printf("    GCC:  IRA (Integrated Register Allocator)\n");
     printf("    LLVM: Greedy register allocator with live range splitting\n\n");
+
+    printf("  JITs usually pick linear scan instead: one pass over intervals\n");
+    printf("  sorted by start, no graph to build.  Section 9 runs one.\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -261,6 +283,38 @@ static void demo_array_sum_codegen(void)
     printf("        ret                      ; return sum in eax\n\n");
 
     printf("  Demo: array_sum({10,20,30,40,50}, 5) = %d\n\n", result);
+
+    /* The same loop done n lanes at a time: reduce.c */
+    printf("── Vectorised by hand, chosen at run time (reduce.c) ──\n\n");
+    printf("  One SIMD add covers 4 lanes (SSE2, NEON), 8 (AVX2) or 16\n");
+    printf("  (AVX-512); the lanes are folded together once, at the end.\n");
+    printf("  One binary holds every variant; on Linux, GNU ifunc binds\n");
+    printf("  reduce_sum_i32() and friends to the best one this CPU runs\n");
+    printf("  when the program loads.\n\n");
+
+    /* Near INT32_MAX, so the 32-bit sum wraps and the 64-bit one does not */
+    enum { N = 1000 };
+    static int32_t big[N], ramp[N], prefix[N];
+    for (int i = 0; i < N; i++) {
+        big[i]  = INT32_MAX - i * 7919;
+        ramp[i] = i - N / 2;
+    }
+    const ReduceKernels *v[8];
+    size_t n_var = reduce_variants(v, 8);
+    printf("  %-8s %12s %14s %12s %12s %12s\n", "variant", "sum_i32", "sum_i64", "min", "dot_i64",
+           "prefix[999]");
+    for (size_t k = 0; k < n_var; k++) {
+        int32_t lo, hi;
+        v[k]->minmax(ramp, N, &lo, &hi);
+        v[k]->prefix_i32(ramp, prefix, N);
+        printf("  %-8s %12d %14lld %12d %12lld %12d\n", v[k]->name, v[k]->sum_i32(big, N),
+               (long long)v[k]->sum_i64(big, N), lo, (long long)v[k]->dot_i64(ramp, ramp, N),
+               prefix[N - 1]);
+    }
+    printf("\n  reduce_*() use: %s.  Every variant must print the same row;\n", reduce_best()->name);
+    printf("  sum_i32 wraps modulo 2^32 where sum_i64 stays exact.\n");
+    printf("  GB/s per variant, against -O3 -march=native auto-vectorisation:\n");
+    printf("    make bench_reduce && ./bin/bench_reduce\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -289,6 +343,229 @@ static void demo_try_it(void)
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════════
+ *  Section 8 — A JIT for Three-Address Code
+ * ════════════════════════════════════════════════════════════════════ */
+
+/* One random input per variable, the same for the interpreter and the JIT */
+static int jit_mismatches(const JitCode *j, const TacProgram *p, int runs, unsigned *seed)
+{
+    int32_t x[64], y[64];
+    int     bad = 0;
+    if (p->n_vars > 64) return runs;
+    for (int r = 0; r < runs; r++) {
+        for (uint32_t v = 0; v < p->n_vars; v++) {
+            *seed = *seed * 1103515245u + 12345u;
+            x[v] = y[v] = (int32_t)(*seed >> 8) - (1 << 23);
+        }
+        bad += tac_exec(p, x, NULL) != jit_call(j, y) ||
+               memcmp(x, y, p->n_vars * sizeof(int32_t)) != 0;
+    }
+    return bad;
+}
+
+static void demo_jit(void)
+{
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8 — A JIT for Three-Address Code               ║\n");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+
+    printf("jit.c selects instructions for chapter 21 TAC one instruction at a\n");
+    printf("time: load the operands into two scratch registers, compute, store.\n");
+    printf("Variables live in the caller's array, temporaries on the stack, and\n");
+    printf("constants become immediates.  The result is an ordinary function:\n\n");
+    printf("    int32_t fn(int32_t *vars);      /* rdi on x86-64, x0 on AArch64 */\n\n");
+
+    static const char *const src = "(a + b) * (a - b) / 3 + b * 8";
+    ExprVars  vars;
+    Parser    parser;
+    TacProgram p;
+    expr_vars_init(&vars);
+    parser_init(&parser, src);
+    parser_set_vars(&parser, &vars);
+    ASTNode *root = parse_expr(&parser);
+    tac_init(&p);
+    if (!root || tac_lower_return(&p, root, &vars) != 0) {
+        printf("  (could not lower %s)\n", src);
+        free_ast(root);
+        tac_free(&p);
+        return;
+    }
+    free_ast(root);
+    printf("── return %s ──\n\n", src);
+    print_tac(&p);
+
+    for (int arch = 0; arch < JIT_ARCH_COUNT; arch++) {
+        JitCode j;
+        memset(&j, 0, sizeof(j));
+        if (jit_emit(&j, &p, (JitArch)arch, NULL) == 0) {
+            printf("\n  %s, %zu bytes%s:\n", jit_arch_name((JitArch)arch), j.size,
+                   arch == JIT_HOST ? " (this machine)" : "");
+            print_jit_code(&j);
+        }
+        jit_free(&j);
+    }
+
+    printf("\nMaking it runnable, without ever having a page that is both\n");
+    printf("writable and executable (W^X):\n\n");
+    printf("    1. mmap(PROT_READ | PROT_WRITE)    and copy the code in\n");
+    printf("    2. __builtin___clear_cache()       (AArch64 i-cache is not coherent)\n");
+    printf("    3. mprotect(PROT_READ | PROT_EXEC)\n");
+    printf("    4. call it through a function pointer\n\n");
+
+    JitCode j;
+    memset(&j, 0, sizeof(j));
+    if (jit_compile(&j, &p, NULL) != 0) {
+        printf("  (out of memory)\n");
+        tac_free(&p);
+        return;
+    }
+    int32_t in[2] = { 17, 5 }, again[2] = { 17, 5 };
+    if (j.fn)
+        printf("  native:      a = 17, b = 5 → %d   (emit %.3f ms, map %.3f ms)\n",
+               jit_call(&j, in), j.ms_emit, j.ms_map);
+    else
+        printf("  no back end here: jit_call() interprets → %d\n", jit_call(&j, in));
+    printf("  tac_exec():  a = 17, b = 5 → %d\n", tac_exec(&p, again, NULL));
+    jit_free(&j);
+    tac_free(&p);
+
+    /* Branches and loops: the generated programs from chapter 21 */
+    printf("\n── Checking: 200 generated branchy programs × 5 inputs ──\n\n");
+    unsigned seed = 23;
+    int      bad = 0, native = 0;
+    size_t   instrs = 0, bytes = 0;
+    for (uint32_t s = 1; s <= 200; s++) {
+        tac_init(&p);
+        memset(&j, 0, sizeof(j));
+        if (tac_generate(&p, 20 + s % 300, s) == 0 && jit_compile(&j, &p, NULL) == 0) {
+            native += j.fn != NULL;
+            instrs += p.count;
+            bytes  += j.size;
+            bad    += jit_mismatches(&j, &p, 5, &seed);
+        } else {
+            bad++;
+        }
+        jit_free(&j);
+        tac_free(&p);
+    }
+    printf("    %d/200 compiled natively, %zu TAC → %zu bytes (%.1f per instr)\n",
+           native, instrs, bytes, instrs ? (double)bytes / (double)instrs : 0.0);
+    printf("    %d mismatches against tac_exec() %s\n\n", bad, bad ? "✗" : "✓");
+    printf("The code is naive — every value round-trips through memory — yet it\n");
+    printf("beats the chapter 19 bytecode VM: no dispatch, no decoding.  Compare\n");
+    printf("with:  make bench_jit && ./bin/bench_jit\n\n");
+}
+
+/* ════════════════════════════════════════════════════════════════════
+ *  Section 9 — Linear-Scan Register Allocation
+ * ════════════════════════════════════════════════════════════════════ */
+static void demo_linear_scan(void)
+{
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║  Section 9 — Linear-Scan Register Allocation            ║\n");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+
+    printf("regalloc.c gives Section 8's temporaries registers:\n\n");
+    printf("  1. Liveness — backward dataflow over the CFG, one bit per temporary\n");
+    printf("  2. Intervals — each temporary's first to last live position\n");
+    printf("  3. Scan — by start; expire ended intervals; with no register free,\n");
+    printf("     split or spill whichever active interval ends last\n\n");
+    printf("Graph colouring looks at every interference and colours better; linear\n");
+    printf("scan is one sort and one pass, which is what a JIT can afford.\n\n");
+
+    static const char *const src = "(a * b + c * d) * (a - d) - (b + c) * (a * d - b)";
+    ExprVars   vars;
+    Parser     parser;
+    TacProgram p;
+    expr_vars_init(&vars);
+    parser_init(&parser, src);
+    parser_set_vars(&parser, &vars);
+    ASTNode *root = parse_expr(&parser);
+    tac_init(&p);
+    if (!root || tac_lower_return(&p, root, &vars) != 0) {
+        printf("  (could not lower %s)\n", src);
+        free_ast(root);
+        tac_free(&p);
+        return;
+    }
+    free_ast(root);
+    printf("── return %s ──\n\n", src);
+    print_tac(&p);
+
+    /* Three values are live at once: with two registers, watch the scan spill */
+    RegAlloc ra;
+    printf("\n  x86-64 with only 2 registers:\n\n");
+    if (ra_allocate(&ra, &p, JIT_X86_64, 2) == 0) {
+        print_ra(&ra);
+        print_ra_stats(&ra);
+        JitCode j;
+        memset(&j, 0, sizeof(j));
+        if (jit_emit(&j, &p, JIT_X86_64, &ra) == 0) {
+            printf("\n  %zu bytes:\n", j.size);
+            print_jit_code(&j);
+        }
+        jit_free(&j);
+    }
+    ra_free(&ra);
+
+    printf("\n  x86-64 with all of them:\n\n");
+    if (ra_allocate(&ra, &p, JIT_X86_64, 0) == 0)
+        print_ra_stats(&ra);
+    ra_free(&ra);
+
+    JitCode stack, alloc;
+    memset(&stack, 0, sizeof(stack));
+    memset(&alloc, 0, sizeof(alloc));
+    if (ra_allocate(&ra, &p, JIT_HOST == JIT_ARCH_COUNT ? JIT_X86_64 : JIT_HOST, 0) == 0 &&
+        jit_compile(&stack, &p, NULL) == 0 && jit_compile(&alloc, &p, &ra) == 0) {
+        int32_t x[4] = { 7, -3, 5, 2 }, y[4] = { 7, -3, 5, 2 }, z[4] = { 7, -3, 5, 2 };
+        printf("\n  a, b, c, d = 7, -3, 5, 2:  stack %d (%zu bytes), registers %d (%zu bytes),"
+               " tac_exec() %d\n", jit_call(&stack, x), stack.size, jit_call(&alloc, y),
+               alloc.size, tac_exec(&p, z, NULL));
+    }
+    jit_free(&stack);
+    jit_free(&alloc);
+    ra_free(&ra);
+    tac_free(&p);
+
+    /* Loops too: a backward jump into a register part must reload it */
+    printf("\n── Checking: 200 generated programs × 3 register budgets × 5 inputs ──\n\n");
+    static const uint32_t budgets[] = { 2, 4, 0 };
+    unsigned seed = 9;
+    int      bad = 0;
+    uint32_t spilled = 0, split = 0, reloads = 0;
+    for (uint32_t s = 1; s <= 200; s++) {
+        tac_init(&p);
+        if (tac_generate_wide(&p, 20 + s % 300, 4 + s % 24, s) != 0) {
+            bad++;
+            tac_free(&p);
+            continue;
+        }
+        for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+            JitCode j;
+            memset(&j, 0, sizeof(j));
+            if (ra_allocate(&ra, &p, JIT_HOST == JIT_ARCH_COUNT ? JIT_X86_64 : JIT_HOST,
+                            budgets[b]) == 0 &&
+                jit_compile(&j, &p, &ra) == 0) {
+                spilled += ra.n_spilled;
+                split   += ra.n_split;
+                reloads += ra.n_reloads;
+                bad     += jit_mismatches(&j, &p, 5, &seed);
+            } else {
+                bad++;
+            }
+            jit_free(&j);
+            ra_free(&ra);
+        }
+        tac_free(&p);
+    }
+    printf("    %u spilled, %u split, %u reloads on backward jumps\n", spilled, split, reloads);
+    printf("    %d mismatches against tac_exec() %s\n\n", bad, bad ? "✗" : "✓");
+    printf("Sizes, spill counts, allocation time and run time against the\n");
+    printf("all-on-stack code:  make bench_regalloc && ./bin/bench_regalloc\n\n");
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════════ */
@@ -306,6 +583,8 @@ int main(void)
     demo_register_allocation();
     demo_array_sum_codegen();
     demo_try_it();
+    demo_jit();
+    demo_linear_scan();
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 23 — Code Generation\n");
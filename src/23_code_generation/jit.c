@@ -0,0 +1,795 @@
+/*
+ * Chapter 23 — TAC to x86-64 / AArch64 machine code — see jit.h
+ */
+
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS with -std=c99 */
+
+#include "jit.h"
+#include "regalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../include/bench.h"
+
+#define NONE UINT32_MAX
+
+const char *jit_arch_name(JitArch arch)
+{
+    return arch == JIT_X86_64 ? "x86-64" : arch == JIT_AARCH64 ? "AArch64" : "none";
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Code buffer, labels and fixups (shared by both back ends)
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef enum { FIX_X86_REL32, FIX_A64_B26, FIX_A64_BCOND19 } FixKind;
+
+typedef struct {
+    uint32_t at;            /* x86: the rel32 field; AArch64: the instruction */
+    uint32_t label;
+    FixKind  kind;
+} Fixup;
+
+typedef struct {
+    uint32_t at;            /* the branch's instruction */
+    uint32_t label;         /* its TAC target           */
+} Tramp;
+
+typedef struct {
+    JitCode          *j;
+    const TacProgram *p;
+    const RegAlloc   *ra;           /* NULL: every temporary in its own slot  */
+    uint32_t          pos;          /* the TAC instruction being selected     */
+    uint32_t         *label_at;     /* code offset, NONE until placed: TAC    */
+    uint32_t          n_target;     /*   labels, then one per trampoline      */
+    Fixup            *fix;
+    uint32_t          n_fix, fix_cap;
+    Tramp            *tramp;
+    uint32_t          n_tramp;
+    uint32_t          frame;        /* bytes of saves and slots, 16-aligned   */
+    uint32_t          slot0;        /* first temporary slot, in 4-byte units  */
+    uint8_t           saves[RA_MAX_REGS];   /* callee-saved registers in use  */
+    uint32_t          n_saves;
+    TacOperand        cached;       /* name the accumulator holds, or TAC_NO_OPERAND */
+    int               oom;
+} Asm;
+
+static void put(Asm *a, const void *bytes, size_t n)
+{
+    JitCode *j = a->j;
+    if (a->oom) return;
+    if (j->size + n > j->cap) {
+        size_t   cap  = j->cap ? j->cap * 2 : 4096;
+        while (cap < j->size + n) cap *= 2;
+        uint8_t *code = realloc(j->code, cap);
+        if (!code) { a->oom = 1; return; }
+        j->code = code;
+        j->cap  = cap;
+    }
+    memcpy(j->code + j->size, bytes, n);
+    j->size += n;
+}
+
+static void put8(Asm *a, uint8_t b) { put(a, &b, 1); }
+
+static void put32(Asm *a, uint32_t v)       /* little-endian on both targets */
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    put(a, b, 4);
+}
+
+static uint32_t here(const Asm *a) { return (uint32_t)a->j->size; }
+
+static void add_fixup(Asm *a, uint32_t at, TacOperand label, FixKind kind)
+{
+    if (a->n_fix == a->fix_cap) {
+        uint32_t cap = a->fix_cap ? a->fix_cap * 2 : 64;
+        Fixup   *fix = realloc(a->fix, cap * sizeof(*fix));
+        if (!fix) { a->oom = 1; return; }
+        a->fix     = fix;
+        a->fix_cap = cap;
+    }
+    a->fix[a->n_fix++] = (Fixup){ at, OPND_INDEX(label), kind };
+}
+
+static uint32_t get32(const Asm *a, uint32_t at)
+{
+    const uint8_t *b = a->j->code + at;
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static void set32(Asm *a, uint32_t at, uint32_t v)
+{
+    uint8_t *b = a->j->code + at;
+    b[0] = (uint8_t)v; b[1] = (uint8_t)(v >> 8); b[2] = (uint8_t)(v >> 16); b[3] = (uint8_t)(v >> 24);
+}
+
+/* A conditional branch whose taken edge reloads registers goes to a
+ * trampoline after the code: the reloads, then a jump to label */
+static TacOperand trampoline(Asm *a, TacOperand label)
+{
+    uint32_t k = a->n_tramp++;              /* room for one per branch */
+    a->tramp[k] = (Tramp){ a->pos, OPND_INDEX(label) };
+    return OPND(OPND_LABEL, a->p->n_labels + k);
+}
+
+/* 0, or 1 if a label was never placed or a branch is out of range */
+static int patch(Asm *a)
+{
+    for (uint32_t f = 0; f < a->n_fix; f++) {
+        const Fixup *fx = &a->fix[f];
+        if (fx->label >= a->n_target || a->label_at[fx->label] == NONE) return 1;
+        int64_t to = a->label_at[fx->label];
+        switch (fx->kind) {
+        case FIX_X86_REL32:
+            set32(a, fx->at, (uint32_t)(int32_t)(to - (fx->at + 4)));
+            break;
+        case FIX_A64_B26: {
+            int64_t d = (to - fx->at) / 4;
+            if (d < -(1 << 25) || d >= (1 << 25)) return 1;
+            set32(a, fx->at, get32(a, fx->at) | ((uint32_t)d & 0x3FFFFFF));
+            break;
+        }
+        case FIX_A64_BCOND19: {
+            int64_t d = (to - fx->at) / 4;
+            if (d < -(1 << 18) || d >= (1 << 18)) return 1;
+            set32(a, fx->at, get32(a, fx->at) | ((uint32_t)d & 0x7FFFF) << 5);
+            break;
+        }
+        }
+    }
+    return 0;
+}
+
+static int is_name(TacOperand o) { return OPND_TAG(o) == OPND_TEMP || OPND_TAG(o) == OPND_VAR; }
+
+/* The register holding o at the instruction being selected, as it is
+ * read (def = 0) or written (def = 1); -1: o lives in memory there */
+static int reg_of(const Asm *a, TacOperand o, int def)
+{
+    if (!a->ra || OPND_TAG(o) != OPND_TEMP) return -1;
+    return ra_reg_at(a->ra, OPND_INDEX(o), def ? RA_DEF(a->pos) : RA_USE(a->pos));
+}
+
+/* Must a write to o reach memory?  Always, unless o has a register and
+ * no spill slot (a split interval writes through to its slot) */
+static int writes_memory(const Asm *a, TacOperand o)
+{
+    return reg_of(a, o, 1) < 0 || a->ra->iv[OPND_INDEX(o)].slot != RA_NEVER;
+}
+
+/* o's home in memory, in 4-byte units: vars[i], or a stack slot */
+static uint32_t slot_of(const Asm *a, TacOperand o)
+{
+    if (OPND_TAG(o) != OPND_TEMP) return OPND_INDEX(o);
+    return a->slot0 + (a->ra ? a->ra->iv[OPND_INDEX(o)].slot : OPND_INDEX(o));
+}
+
+/* Does the jump at the current instruction to label reload anything? */
+static int has_reloads(const Asm *a, TacOperand label)
+{
+    return a->ra && ra_next_reload(a->ra, a->pos, OPND_INDEX(label), 0) != RA_NEVER;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  x86-64 (System V: vars in rdi, result in eax)
+ *
+ *  eax is the accumulator and ecx the second operand; shifts want
+ *  their count in cl anyway, and idiv clobbers edx.  Temporaries sit
+ *  at [rsp + 4·slot] or in the registers regalloc.c hands out.
+ * ════════════════════════════════════════════════════════════════ */
+
+enum { EAX = 0, ECX = 1 };
+
+/* ModRM (+ SIB) + displacement addressing a name's memory home */
+static void x86_mem(Asm *a, int reg, TacOperand o)
+{
+    uint32_t disp = 4 * slot_of(a, o);
+    int      rsp  = OPND_TAG(o) == OPND_TEMP;
+    int      mod  = disp < 128 ? 0x40 : 0x80;
+    put8(a, (uint8_t)(mod | reg << 3 | (rsp ? 4 : 7)));
+    if (rsp) put8(a, 0x24);
+    if (mod == 0x40) put8(a, (uint8_t)disp);
+    else             put32(a, disp);
+}
+
+/* [REX.B] op ModRM with reg (eax or ecx) in the reg field and, as r/m,
+ * whatever holds o: its register or its memory */
+static void x86_rm(Asm *a, const uint8_t *op, size_t n, int reg, TacOperand o, int def)
+{
+    int r = reg_of(a, o, def);
+    if (r >= 8) put8(a, 0x41);
+    put(a, op, n);
+    if (r >= 0) put8(a, (uint8_t)(0xC0 | reg << 3 | (r & 7)));
+    else        x86_mem(a, reg, o);
+}
+
+static const uint8_t X86_MOV_LOAD[] = { 0x8B }, X86_MOV_STORE[] = { 0x89 };
+
+static void x86_load(Asm *a, int reg, TacOperand o)
+{
+    if (!is_name(o)) {                                  /* a constant (an empty slot reads 0) */
+        int32_t c = OPND_TAG(o) == OPND_CONST ? tac_const_value(a->p, o) : 0;
+        if (reg == EAX) a->cached = TAC_NO_OPERAND;
+        if (c == 0) {                                   /* xor reg, reg */
+            put8(a, 0x31);
+            put8(a, (uint8_t)(0xC0 | reg << 3 | reg));
+        } else {                                        /* mov reg, imm32 */
+            put8(a, (uint8_t)(0xB8 + reg));
+            put32(a, (uint32_t)c);
+        }
+        return;
+    }
+    if (o == a->cached) {
+        if (reg != EAX) { put8(a, 0x89); put8(a, (uint8_t)(0xC0 | EAX << 3 | reg)); }
+        return;
+    }
+    x86_rm(a, X86_MOV_LOAD, 1, reg, o, 0);              /* mov reg, r/m */
+    if (reg == EAX) a->cached = o;
+}
+
+static void x86_store(Asm *a, TacOperand o)
+{
+    if (reg_of(a, o, 1) >= 0) x86_rm(a, X86_MOV_STORE, 1, EAX, o, 1);     /* mov r, eax */
+    if (writes_memory(a, o)) {                          /* mov [slot], eax */
+        put8(a, 0x89);
+        x86_mem(a, EAX, o);
+    }
+    a->cached = o;
+}
+
+/* mov r, [slot] for every register the jump to label must reload */
+static void x86_reloads(Asm *a, TacOperand label)
+{
+    if (!a->ra) return;
+    for (uint32_t t = ra_next_reload(a->ra, a->pos, OPND_INDEX(label), 0); t != RA_NEVER;
+         t = ra_next_reload(a->ra, a->pos, OPND_INDEX(label), t + 1)) {
+        int r = a->ra->target->regs[a->ra->iv[t].reg].hw;
+        if (r >= 8) put8(a, 0x44);                      /* REX.R */
+        put8(a, 0x8B);
+        x86_mem(a, r & 7, OPND(OPND_TEMP, t));
+    }
+}
+
+static void x86_push_pop(Asm *a, int r, int pop)
+{
+    if (r >= 8) put8(a, 0x41);
+    put8(a, (uint8_t)((pop ? 0x58 : 0x50) + (r & 7)));
+}
+
+static void x86_epilogue(Asm *a)
+{
+    if (a->frame) {                                     /* add rsp, frame */
+        static const uint8_t add_rsp[] = { 0x48, 0x81, 0xC4 };
+        put(a, add_rsp, sizeof(add_rsp));
+        put32(a, a->frame);
+    }
+    for (uint32_t k = a->n_saves; k-- > 0; ) x86_push_pop(a, a->saves[k], 1);
+    put8(a, 0xC3);                                      /* ret */
+}
+
+static void x86_prologue(Asm *a)
+{
+    for (uint32_t k = 0; k < a->n_saves; k++) x86_push_pop(a, a->saves[k], 0);
+    if (a->frame) {
+        static const uint8_t sub_rsp[] = { 0x48, 0x81, 0xEC };
+        put(a, sub_rsp, sizeof(sub_rsp));
+        put32(a, a->frame);
+    }
+    /* tac_exec() starts temporaries at 0: with an allocation only the
+     * ones read before they are written need it */
+    if (a->ra) {
+        for (uint32_t t = 0; t < a->ra->n_temps; t++) {
+            if (!(a->ra->entry_live[t / 64] >> (t % 64) & 1)) continue;
+            int r = ra_reg_at(a->ra, t, 0);
+            if (r >= 0) {                               /* xor r, r */
+                if (r >= 8) put8(a, 0x45);
+                put8(a, 0x31);
+                put8(a, (uint8_t)(0xC0 | (r & 7) << 3 | (r & 7)));
+            }
+            if (a->ra->iv[t].slot != RA_NEVER) {        /* mov dword [slot], 0 */
+                put8(a, 0xC7);
+                x86_mem(a, 0, OPND(OPND_TEMP, t));
+                put32(a, 0);
+            }
+        }
+        return;
+    }
+    if (!a->frame) return;
+    if (a->p->n_temps <= 8) {
+        put8(a, 0x31); put8(a, 0xC0);                   /* xor eax, eax */
+        for (uint32_t t = 0; t < a->p->n_temps; t++) {
+            put8(a, 0x89);
+            x86_mem(a, EAX, OPND(OPND_TEMP, t));
+        }
+        return;
+    }
+    static const uint8_t save_rdi[] = { 0x48, 0x89, 0xFA,           /* mov rdx, rdi  */
+                                        0x48, 0x89, 0xE7 };         /* mov rdi, rsp  */
+    static const uint8_t stos[]     = { 0x31, 0xC0,                 /* xor eax, eax  */
+                                        0xF3, 0x48, 0xAB,           /* rep stosq     */
+                                        0x48, 0x89, 0xD7 };         /* mov rdi, rdx  */
+    put(a, save_rdi, sizeof(save_rdi));
+    put8(a, 0xB9);                                      /* mov ecx, frame / 8 */
+    put32(a, a->frame / 8);
+    put(a, stos, sizeof(stos));
+}
+
+/* jmp rel32 to label (a TAC label or a trampoline) */
+static void x86_jmp(Asm *a, TacOperand label)
+{
+    put8(a, 0xE9);
+    add_fixup(a, here(a), label, FIX_X86_REL32);
+    put32(a, 0);
+}
+
+static void x86_instr(Asm *a, const TacInstr *in)
+{
+    const TacProgram *p  = a->p;
+    int               bc = !is_name(in->b);            /* a constant, or an empty slot: 0 */
+    int32_t           c  = OPND_TAG(in->b) == OPND_CONST ? tac_const_value(p, in->b) : 0;
+
+    switch ((TacOp)in->op) {
+    case TAC_ADD: case TAC_SUB: case TAC_MUL:
+    case TAC_SHL: case TAC_SHR: case TAC_SAR: {
+        static const uint8_t imm_op[] = { 0x05, 0x2D };             /* add/sub eax, imm32 */
+        static const uint8_t shift[]  = { 0xE0, 0xE8, 0xF8 };       /* /4 shl, /5 shr, /7 sar */
+        static const uint8_t rm_op[][2] = { { 0x03 }, { 0x2B }, { 0x0F, 0xAF } };   /* add, sub, imul eax, r/m */
+        x86_load(a, EAX, in->a);
+        int sh = in->op >= TAC_SHL ? in->op - TAC_SHL : -1;
+        if (bc && sh >= 0) {                            /* shl eax, imm8 */
+            put8(a, 0xC1); put8(a, shift[sh]); put8(a, (uint8_t)(c & 31));
+        } else if (bc && in->op == TAC_MUL) {           /* imul eax, eax, imm32 */
+            put8(a, 0x69); put8(a, 0xC0); put32(a, (uint32_t)c);
+        } else if (bc) {
+            put8(a, imm_op[in->op]); put32(a, (uint32_t)c);
+        } else if (sh >= 0) {
+            x86_load(a, ECX, in->b);
+            put8(a, 0xD3); put8(a, shift[sh]);          /* shl eax, cl */
+        } else {
+            x86_rm(a, rm_op[in->op], in->op == TAC_MUL ? 2 : 1, EAX, in->b, 0);
+        }
+        x86_store(a, in->dst);
+        break;
+    }
+    case TAC_DIV:
+        x86_load(a, EAX, in->a);
+        if (bc && c == 0) {
+            put8(a, 0x31); put8(a, 0xC0);               /* x / 0 = 0 */
+        } else if (bc && c == -1) {
+            put8(a, 0xF7); put8(a, 0xD8);               /* x / -1 = -x, wrapping */
+        } else if (bc) {
+            put8(a, 0xB9); put32(a, (uint32_t)c);       /* mov ecx, imm32 */
+            put8(a, 0x99);                              /* cdq */
+            put8(a, 0xF7); put8(a, 0xF9);               /* idiv ecx */
+        } else {
+            /* idiv traps on both special cases, so they go around it */
+            static const uint8_t div[] = {
+                0x85, 0xC9,             /*       test ecx, ecx    */
+                0x74, 0x0E,             /*       jz   zero        */
+                0x83, 0xF9, 0xFF,       /*       cmp  ecx, -1     */
+                0x75, 0x04,             /*       jne  do          */
+                0xF7, 0xD8,             /*       neg  eax         */
+                0xEB, 0x07,             /*       jmp  done        */
+                0x99,                   /* do:   cdq              */
+                0xF7, 0xF9,             /*       idiv ecx         */
+                0xEB, 0x02,             /*       jmp  done        */
+                0x31, 0xC0,             /* zero: xor  eax, eax    */
+            };                          /* done:                  */
+            x86_load(a, ECX, in->b);
+            put(a, div, sizeof(div));
+        }
+        x86_store(a, in->dst);
+        break;
+    case TAC_NEG:
+        x86_load(a, EAX, in->a);
+        put8(a, 0xF7); put8(a, 0xD8);                   /* neg eax */
+        x86_store(a, in->dst);
+        break;
+    case TAC_ASSIGN:
+        if (OPND_TAG(in->a) == OPND_CONST) {
+            uint32_t v = (uint32_t)tac_const_value(p, in->a);
+            int      r = reg_of(a, in->dst, 1);
+            if (r >= 0) {                               /* mov r, imm32 */
+                if (r >= 8) put8(a, 0x41);
+                put8(a, (uint8_t)(0xB8 + (r & 7)));
+                put32(a, v);
+            }
+            if (writes_memory(a, in->dst)) {            /* mov dword [slot], imm32 */
+                put8(a, 0xC7);
+                x86_mem(a, 0, in->dst);
+                put32(a, v);
+            }
+            if (a->cached == in->dst) a->cached = TAC_NO_OPERAND;
+        } else {
+            x86_load(a, EAX, in->a);
+            x86_store(a, in->dst);
+        }
+        break;
+    case TAC_LABEL:
+        a->label_at[OPND_INDEX(in->dst)] = here(a);
+        a->cached = TAC_NO_OPERAND;                     /* a join point */
+        break;
+    case TAC_GOTO:
+        x86_reloads(a, in->dst);
+        x86_jmp(a, in->dst);
+        break;
+    case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ: {
+        static const uint8_t jcc[] = { 0x8F, 0x8C, 0x84 };          /* jg, jl, je rel32 */
+        static const uint8_t cmp_rm[] = { 0x3B };                   /* cmp eax, r/m */
+        x86_load(a, EAX, in->a);
+        if (bc) {
+            put8(a, 0x3D); put32(a, (uint32_t)c);       /* cmp eax, imm32 */
+        } else {
+            x86_rm(a, cmp_rm, 1, EAX, in->b, 0);
+        }
+        put8(a, 0x0F); put8(a, jcc[in->op - TAC_IF_GT]);
+        add_fixup(a, here(a), has_reloads(a, in->dst) ? trampoline(a, in->dst) : in->dst, FIX_X86_REL32);
+        put32(a, 0);
+        break;
+    }
+    case TAC_RET:
+        x86_load(a, EAX, in->a);
+        x86_epilogue(a);
+        break;
+    default:
+        break;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  AArch64 (AAPCS64: vars in x0, result in w0)
+ *
+ *  w9 is the accumulator, w10 the second operand, w16 an index
+ *  scratch for slots past the 12-bit scaled offset.  Temporaries sit
+ *  at [sp + 4·slot] (above any saved callee-saved registers) or in
+ *  allocated registers, which three-operand instructions use directly.
+ *  Every instruction is one 32-bit word.
+ * ════════════════════════════════════════════════════════════════ */
+
+enum { W9 = 9, W10 = 10, W16 = 16, SP = 31, WZR = 31 };
+
+static void a64(Asm *a, uint32_t insn) { put32(a, insn); }
+
+static void a64_movimm(Asm *a, int rd, int32_t v)
+{
+    uint32_t u = (uint32_t)v;
+    if ((u >> 16) == 0xFFFF) {                                  /* movn rd, #~u */
+        a64(a, 0x12800000 | (~u & 0xFFFF) << 5 | (uint32_t)rd);
+        return;
+    }
+    a64(a, 0x52800000 | (u & 0xFFFF) << 5 | (uint32_t)rd);      /* movz rd, #lo */
+    if (u >> 16) a64(a, 0x72A00000 | (u >> 16) << 5 | (uint32_t)rd);   /* movk rd, #hi, lsl 16 */
+}
+
+static void a64_mov(Asm *a, int rd, int rm)                     /* mov rd, rm (orr rd, wzr, rm) */
+{
+    if (rd != rm) a64(a, 0x2A0003E0 | (uint32_t)rm << 16 | (uint32_t)rd);
+}
+
+/* ldr/str rt, [x0 or sp + 4·slot] */
+static void a64_mem(Asm *a, int store, int rt, TacOperand o)
+{
+    uint32_t idx  = slot_of(a, o);
+    uint32_t base = OPND_TAG(o) == OPND_TEMP ? SP : 0;
+    if (idx < 4096) {
+        a64(a, (store ? 0xB9000000 : 0xB9400000) | idx << 10 | base << 5 | (uint32_t)rt);
+        return;
+    }
+    a64_movimm(a, W16, (int32_t)idx);                             /* [base, w16, uxtw #2] */
+    a64(a, (store ? 0xB8205800 : 0xB8605800) | (uint32_t)W16 << 16 | base << 5 | (uint32_t)rt);
+}
+
+static void a64_load(Asm *a, int rd, TacOperand o)
+{
+    if (!is_name(o)) {
+        a64_movimm(a, rd, OPND_TAG(o) == OPND_CONST ? tac_const_value(a->p, o) : 0);
+        if (rd == W9) a->cached = TAC_NO_OPERAND;
+        return;
+    }
+    int r = reg_of(a, o, 0);
+    if (r >= 0)               a64_mov(a, rd, r);
+    else if (o == a->cached) { a64_mov(a, rd, W9); return; }
+    else                      a64_mem(a, 0, rd, o);
+    if (rd == W9) a->cached = o;
+}
+
+/* A register holding o: its own, w9 if it is cached there, or else
+ * scratch with o loaded into it */
+static int a64_src(Asm *a, TacOperand o, int scratch)
+{
+    int r = reg_of(a, o, 0);
+    if (r >= 0) return r;
+    if (is_name(o) && o == a->cached) return W9;
+    a64_load(a, scratch, o);
+    return scratch;
+}
+
+/* Where to compute o: its register, or w9 and then memory */
+static int a64_dst(const Asm *a, TacOperand o)
+{
+    int r = reg_of(a, o, 1);
+    return r >= 0 ? r : W9;
+}
+
+/* o has just been computed into rd (a64_dst()) */
+static void a64_store(Asm *a, TacOperand o, int rd)
+{
+    if (writes_memory(a, o)) a64_mem(a, 1, rd, o);
+    if (rd == W9)            a->cached = o;
+    else if (a->cached == o) a->cached = TAC_NO_OPERAND;    /* w9 holds the old value */
+}
+
+static void a64_reloads(Asm *a, TacOperand label)
+{
+    if (!a->ra) return;
+    for (uint32_t t = ra_next_reload(a->ra, a->pos, OPND_INDEX(label), 0); t != RA_NEVER;
+         t = ra_next_reload(a->ra, a->pos, OPND_INDEX(label), t + 1))
+        a64_mem(a, 0, a->ra->target->regs[a->ra->iv[t].reg].hw, OPND(OPND_TEMP, t));
+}
+
+/* add/sub sp, sp, #frame — up to 24 bits as two 12-bit halves */
+static void a64_sp(Asm *a, int sub)
+{
+    uint32_t op = sub ? 0xD10003FF : 0x910003FF;
+    if (a->frame >> 12)   a64(a, op | 0x400000 | (a->frame >> 12) << 10);
+    if (a->frame & 0xFFF) a64(a, op | (a->frame & 0xFFF) << 10);
+}
+
+static void a64_prologue(Asm *a)
+{
+    if (a->frame) a64_sp(a, 1);
+    for (uint32_t k = 0; k < a->n_saves; k++)           /* str xN, [sp, #8k] */
+        a64(a, 0xF9000000 | k << 10 | (uint32_t)SP << 5 | a->saves[k]);
+    if (a->ra) {
+        for (uint32_t t = 0; t < a->ra->n_temps; t++) {
+            if (!(a->ra->entry_live[t / 64] >> (t % 64) & 1)) continue;
+            int r = ra_reg_at(a->ra, t, 0);
+            if (r >= 0) a64_movimm(a, r, 0);
+            if (a->ra->iv[t].slot != RA_NEVER) a64_mem(a, 1, WZR, OPND(OPND_TEMP, t));
+        }
+        return;
+    }
+    if (!a->frame) return;
+    if (a->p->n_temps <= 8) {
+        for (uint32_t t = 0; t < a->p->n_temps; t++) a64_mem(a, 1, WZR, OPND(OPND_TEMP, t));
+        return;
+    }
+    a64(a, 0x910003EB);                                 /*       mov  x11, sp               */
+    a64_movimm(a, 12, (int32_t)(a->frame / 16));        /*       mov  w12, #frame/16        */
+    a64(a, 0xA8817D7F);                                 /* loop: stp  xzr, xzr, [x11], #16  */
+    a64(a, 0x7100058C);                                 /*       subs w12, w12, #1          */
+    a64(a, 0x54000000 | (0x7FFFEu << 5) | 1);           /*       b.ne loop                  */
+}
+
+static void a64_epilogue(Asm *a)
+{
+    for (uint32_t k = 0; k < a->n_saves; k++)           /* ldr xN, [sp, #8k] */
+        a64(a, 0xF9400000 | k << 10 | (uint32_t)SP << 5 | a->saves[k]);
+    if (a->frame) a64_sp(a, 0);
+    a64(a, 0xD65F03C0);                                 /* ret */
+}
+
+static void a64_b(Asm *a, TacOperand label)
+{
+    add_fixup(a, here(a), label, FIX_A64_B26);
+    a64(a, 0x14000000);                                 /* b label */
+}
+
+static void a64_instr(Asm *a, const TacInstr *in)
+{
+    const TacProgram *p  = a->p;
+    int               bc = !is_name(in->b);
+    int32_t           c  = OPND_TAG(in->b) == OPND_CONST ? tac_const_value(p, in->b) : 0;
+
+    switch ((TacOp)in->op) {
+    case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV:
+    case TAC_SHL: case TAC_SHR: case TAC_SAR: {
+        /* add, sub, mul (madd with wzr), sdiv, lslv, lsrv, asrv  rd, rn, rm */
+        static const uint32_t reg_op[] = { 0x0B000000, 0x4B000000, 0x1B007C00, 0x1AC00C00,
+                                           0x1AC02000, 0x1AC02400, 0x1AC02800 };
+        int      rn  = a64_src(a, in->a, W9);
+        int      rd  = a64_dst(a, in->dst);
+        uint32_t ops = (uint32_t)rn << 5 | (uint32_t)rd;
+        int add = in->op == TAC_ADD, sub = in->op == TAC_SUB;
+        if (bc && (add || sub) && c > -4096 && c < 4096) {
+            int neg = (c < 0) != sub;                   /* x + -5 is sub #5 */
+            uint32_t imm = (uint32_t)(c < 0 ? -c : c);
+            a64(a, (neg ? 0x51000000 : 0x11000000) | imm << 10 | ops);
+        } else if (bc && in->op >= TAC_SHL) {
+            uint32_t s = (uint32_t)c & 31;
+            if (in->op == TAC_SHL)      a64(a, 0x53000000 | ((32 - s) & 31) << 16 | (31 - s) << 10 | ops);
+            else if (in->op == TAC_SHR) a64(a, 0x53007C00 | s << 16 | ops);     /* lsr #s */
+            else                        a64(a, 0x13007C00 | s << 16 | ops);     /* asr #s */
+        } else if (bc && in->op == TAC_DIV && c == 1) {
+            a64_mov(a, rd, rn);                         /* x / 1 = x */
+        } else {
+            int rm = a64_src(a, in->b, W10);            /* sdiv: x / 0 = 0, INT_MIN / -1 = INT_MIN */
+            a64(a, reg_op[in->op] | (uint32_t)rm << 16 | ops);
+        }
+        a64_store(a, in->dst, rd);
+        break;
+    }
+    case TAC_NEG: {
+        int rn = a64_src(a, in->a, W9);
+        int rd = a64_dst(a, in->dst);
+        a64(a, 0x4B0003E0 | (uint32_t)rn << 16 | (uint32_t)rd);     /* neg rd, rn */
+        a64_store(a, in->dst, rd);
+        break;
+    }
+    case TAC_ASSIGN: {
+        int rd = a64_dst(a, in->dst);
+        a64_load(a, rd, in->a);
+        a64_store(a, in->dst, rd);
+        break;
+    }
+    case TAC_LABEL:
+        a->label_at[OPND_INDEX(in->dst)] = here(a);
+        a->cached = TAC_NO_OPERAND;
+        break;
+    case TAC_GOTO:
+        a64_reloads(a, in->dst);
+        a64_b(a, in->dst);
+        break;
+    case TAC_IF_GT: case TAC_IF_LT: case TAC_IF_EQ: {
+        static const uint32_t cond[] = { 0xC, 0xB, 0x0 };           /* gt, lt, eq */
+        uint32_t rn = (uint32_t)a64_src(a, in->a, W9) << 5;
+        if (bc && c >= 0 && c < 4096)        a64(a, 0x7100001F | (uint32_t)c << 10 | rn);   /* cmp rn, #c */
+        else if (bc && c < 0 && c > -4096)   a64(a, 0x3100001F | (uint32_t)-c << 10 | rn);  /* cmn rn, #-c */
+        else                                 a64(a, 0x6B00001F | (uint32_t)a64_src(a, in->b, W10) << 16 | rn);
+        add_fixup(a, here(a), has_reloads(a, in->dst) ? trampoline(a, in->dst) : in->dst, FIX_A64_BCOND19);
+        a64(a, 0x54000000 | cond[in->op - TAC_IF_GT]);  /* b.cond label */
+        break;
+    }
+    case TAC_RET:
+        a64_load(a, 0, in->a);                          /* w0 */
+        a64_epilogue(a);
+        break;
+    default:
+        break;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void emit_trampolines(Asm *a)
+{
+    for (uint32_t k = 0; k < a->n_tramp; k++) {
+        TacOperand label = OPND(OPND_LABEL, a->tramp[k].label);
+        a->label_at[a->p->n_labels + k] = here(a);
+        a->pos = a->tramp[k].at;
+        if (a->j->arch == JIT_X86_64) {
+            x86_reloads(a, label);
+            x86_jmp(a, label);
+        } else {
+            a64_reloads(a, label);
+            a64_b(a, label);
+        }
+    }
+}
+
+/* 0 on success, -1 on OOM, 1 if p cannot be encoded */
+static int emit(JitCode *j, const TacProgram *p, JitArch arch, const RegAlloc *ra)
+{
+    Asm a;
+    memset(&a, 0, sizeof(a));
+    a.j      = j;
+    a.p      = p;
+    a.ra     = ra;
+    a.cached = TAC_NO_OPERAND;
+    j->arch  = arch;
+    j->size  = 0;
+    j->src   = p;
+    if (arch >= JIT_ARCH_COUNT) return 1;
+    if (ra && (ra->target->arch != arch || ra->n_temps != p->n_temps || ra->n_labels != p->n_labels))
+        return 1;
+
+    uint32_t n_branches = 0;
+    if (ra) {
+        for (uint32_t r = 0; r < ra->n_regs; r++)
+            if ((ra->used >> r & 1) && ra->target->regs[r].callee_saved)
+                a.saves[a.n_saves++] = ra->target->regs[r].hw;
+        for (uint32_t i = 0; i < p->count; i++) n_branches += tac_is_branch(p->code[i].op);
+    }
+    uint64_t save_bytes = arch == JIT_AARCH64 ? 8 * a.n_saves : 0;   /* x86 pushes */
+    uint64_t frame      = (save_bytes + 4 * (uint64_t)(ra ? ra->n_slots : p->n_temps) + 15) & ~(uint64_t)15;
+    if (frame > JIT_MAX_FRAME) return 1;
+    a.frame    = (uint32_t)frame;
+    a.slot0    = (uint32_t)save_bytes / 4;
+    a.n_target = p->n_labels + n_branches;
+    a.label_at = malloc((a.n_target ? a.n_target : 1) * sizeof(uint32_t));
+    a.tramp    = malloc((n_branches ? n_branches : 1) * sizeof(Tramp));
+    if (!a.label_at || !a.tramp) {
+        free(a.label_at);
+        free(a.tramp);
+        return -1;
+    }
+    for (uint32_t l = 0; l < a.n_target; l++) a.label_at[l] = NONE;
+
+    uint64_t t0 = bench_now_ns();
+    if (arch == JIT_X86_64) x86_prologue(&a);
+    else                    a64_prologue(&a);
+    for (uint32_t i = 0; i < p->count && !a.oom; i++) {
+        const TacInstr *in = &p->code[i];
+        if (tac_writes_dst(in->op) && !is_name(in->dst)) continue;     /* tac_exec() drops these too */
+        a.pos = i;
+        if (arch == JIT_X86_64) x86_instr(&a, in);
+        else                    a64_instr(&a, in);
+    }
+    /* Falling off the end returns 0 */
+    if (arch == JIT_X86_64) {
+        put8(&a, 0x31); put8(&a, 0xC0);
+        x86_epilogue(&a);
+    } else {
+        a64(&a, 0x52800000);                            /* mov w0, #0 */
+        a64_epilogue(&a);
+    }
+    emit_trampolines(&a);
+    int rc = a.oom ? -1 : patch(&a);
+    j->ms_emit = (double)(bench_now_ns() - t0) / 1e6;
+
+    free(a.label_at);
+    free(a.fix);
+    free(a.tramp);
+    return rc;
+}
+int jit_emit(JitCode *j, const TacProgram *p, JitArch arch, const RegAlloc *ra)
+{
+    return emit(j, p, arch, ra) == 0 ? 0 : -1;
+}
+
+int jit_compile(JitCode *j, const TacProgram *p, const RegAlloc *ra)
+{
+    j->fn  = NULL;
+    j->src = p;
+    if (JIT_HOST == JIT_ARCH_COUNT) return 0;
+
+    int rc = emit(j, p, JIT_HOST, ra);
+    if (rc != 0) return rc < 0 ? -1 : 0;
+
+    /* W^X: written while read/write, then read/execute — never both */
+    uint64_t t0   = bench_now_ns();
+    long     page = sysconf(_SC_PAGESIZE);
+    size_t   size = (j->size + (size_t)page - 1) & ~((size_t)page - 1);
+    void    *mem  = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+    memcpy(mem, j->code, j->size);
+    __builtin___clear_cache((char *)mem, (char *)mem + j->size);    /* AArch64 i-cache */
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return 0;
+    }
+    j->pages      = mem;
+    j->pages_size = size;
+    j->ms_map     = (double)(bench_now_ns() - t0) / 1e6;
+
+    /* ISO C has no function ↔ object pointer conversion; POSIX (dlsym) relies on it */
+    memcpy(&j->fn, &mem, sizeof(mem));
+    return 0;
+}
+
+void jit_free(JitCode *j)
+{
+    if (j->pages) munmap(j->pages, j->pages_size);
+    free(j->code);
+    memset(j, 0, sizeof(*j));
+}
+
+void print_jit_code(const JitCode *j)
+{
+    for (size_t i = 0; i < j->size; i += 16) {
+        printf("    %04zx  ", i);
+        for (size_t k = i; k < i + 16 && k < j->size; k++) {
+            printf("%02x", j->code[k]);
+            /* AArch64 words as units, x86 bytes */
+            if (j->arch != JIT_AARCH64 || k % 4 == 3) printf(" ");
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Chapter 23 — A JIT from chapter 21 TAC to x86-64 or AArch64
+ *
+ *   TacProgram ─► instruction selection ─► bytes ─► mmap(RW) ─► mprotect(RX)
+ *                 (one pass, labels        in a       copy        flip: never
+ *                  patched at the end)     buffer                 W and X at once
+ *
+ * The compiled function is   int32_t fn(int32_t *vars)   — variable i is
+ * vars[i], updated in place, and the result is the first TAC_RET's
+ * value (0 if execution falls off the end): exactly tac_exec().
+ *
+ * Variables live in the caller's array (base in rdi / x0).  Without a
+ * register allocation temporaries live in a zeroed stack frame, and
+ * each instruction loads its operands into two scratch registers (eax,
+ * ecx / w9, w10), computes, and stores the result.  With one from
+ * regalloc.c, temporaries sit in the registers it chose, and in spill
+ * slots where it ran out; AArch64 then computes straight into them
+ * (add w3, w1, w2).  Constants become immediates where the ISA has a
+ * form for them (add eax, 5 / add w9, w9, #5).  The one cache: a load
+ * of the name the accumulator already holds (just stored or loaded) is
+ * skipped, until the next label.
+ *
+ * Division keeps TAC's total semantics: x86 idiv traps on x / 0 and
+ * INT_MIN / -1, so the x86 code tests for both first; AArch64 sdiv
+ * already gives 0 and INT_MIN.  Shift counts are mod 32 on both.
+ *
+ * Both back ends run on any host — jit_emit() only produces bytes, so
+ * the demo can show the AArch64 code on an x86 machine.  jit_compile()
+ * makes them executable for the host's architecture; elsewhere (or if
+ * the pages cannot be made executable) jit_call() falls back to the
+ * tac_exec() interpreter.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../21_intermediate_repr/tac.h"
+
+typedef enum { JIT_X86_64, JIT_AARCH64, JIT_ARCH_COUNT } JitArch;
+
+#if defined(__x86_64__)
+#define JIT_HOST JIT_X86_64
+#elif defined(__aarch64__)
+#define JIT_HOST JIT_AARCH64
+#else
+#define JIT_HOST JIT_ARCH_COUNT     /* no back end: always interpret */
+#endif
+
+#define JIT_MAX_FRAME (1u << 20)    /* bytes of temporaries on the stack */
+
+typedef int32_t (*JitFn)(int32_t *vars);
+
+struct RegAlloc;                    /* regalloc.h */
+
+typedef struct {
+    JitArch           arch;
+    uint8_t          *code;         /* jit_emit(): the machine code      */
+    size_t            size;
+    size_t            cap;
+
+    void             *pages;        /* jit_compile(): mmap'd, read + exec */
+    size_t            pages_size;
+    JitFn             fn;           /* NULL: jit_call() interprets        */
+
+    const TacProgram *src;
+    double            ms_emit;      /* instruction selection and patching */
+    double            ms_map;       /* mmap, copy, mprotect               */
+} JitCode;
+
+const char *jit_arch_name(JitArch arch);
+
+/* Machine code for p in j->code, with temporaries where ra put them
+ * (ra_allocate() for arch), or all on the stack if ra is NULL.  0 on
+ * success; -1 on OOM or a program the back end cannot encode (frame
+ * over JIT_MAX_FRAME, a jump to a label that is never placed, a branch
+ * out of range, an allocation for another program or target). */
+int  jit_emit(JitCode *j, const TacProgram *p, JitArch arch, const struct RegAlloc *ra);
+
+/* jit_emit() for the host, then executable pages.  Always 0 unless
+ * memory runs out: if there is no host back end, or encoding or mapping
+ * fails, j->fn stays NULL and jit_call() interprets p instead.  p must
+ * outlive j; ra need not. */
+int  jit_compile(JitCode *j, const TacProgram *p, const struct RegAlloc *ra);
+
+static inline int32_t jit_call(const JitCode *j, int32_t *vars)
+{
+    return j->fn ? j->fn(vars) : tac_exec(j->src, vars, NULL);
+}
+
+void jit_free(JitCode *j);
+
+/* Hex dump of the emitted code, 16 bytes per line */
+void print_jit_code(const JitCode *j);
+
+#endif /* JIT_H */
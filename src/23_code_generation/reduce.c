@@ -0,0 +1,665 @@
+/*
+ * Chapter 23 — SIMD reduction kernels and their runtime dispatch
+ *
+ * Three shapes recur below, whatever the width:
+ *
+ *   fold     two independent accumulators (so the loop is not one add
+ *            long dependence chain), combined and folded across lanes
+ *            once at the end
+ *   widen    the _i64 kernels sign-extend 32-bit lanes to 64 before
+ *            adding; dot_i64 multiplies the even and the odd lanes
+ *            32 × 32 → 64 separately
+ *   scan     an inclusive prefix sum in a register takes log2(lanes)
+ *            shift-and-add steps, plus the carry from the blocks before:
+ *
+ *                x          a    b    c    d
+ *                x += x<<1  a   a+b  b+c  c+d
+ *                x += x<<2  a   a+b a+b+c a+b+c+d
+ *
+ *            The carry grows by each block's own total (x's last lane,
+ *            broadcast), so the only loop-carried dependence is one add
+ *            per block; the scan itself overlaps across blocks.
+ *
+ * SSE2 and AVX2 finish the last n % lanes elements with scalar code;
+ * AVX-512 uses a masked load (and store) instead.
+ */
+
+#include "reduce.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define REDUCE_X86 1
+#include <immintrin.h>
+#if defined(__linux__)
+#define REDUCE_IFUNC 1              /* glibc's dynamic linker resolves them */
+#endif
+#endif
+
+#if defined(__aarch64__)
+#define REDUCE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* ════════════════════════════════════════════════════════════════
+ *  Scalar tails, shared by the variants
+ * ════════════════════════════════════════════════════════════════ */
+
+static inline void minmax_tail(const int32_t *a, size_t i, size_t n, int32_t *lo, int32_t *hi)
+{
+    for (; i < n; i++) {
+        *lo = a[i] < *lo ? a[i] : *lo;
+        *hi = a[i] > *hi ? a[i] : *hi;
+    }
+}
+
+static inline uint64_t dot_tail(const int32_t *a, const int32_t *b, size_t i, size_t n, uint64_t s)
+{
+    for (; i < n; i++) s += (uint64_t)((int64_t)a[i] * b[i]);
+    return s;
+}
+
+static inline void prefix_i32_tail(const int32_t *a, int32_t *out, size_t i, size_t n, uint32_t s)
+{
+    for (; i < n; i++) {
+        s += (uint32_t)a[i];
+        out[i] = (int32_t)s;
+    }
+}
+
+static inline void prefix_i64_tail(const int32_t *a, int64_t *out, size_t i, size_t n, int64_t s)
+{
+    for (; i < n; i++) {
+        s += a[i];
+        out[i] = s;
+    }
+}
+
+static const ReduceKernels scalar_kernels = {
+    "scalar", reduce_scalar_sum_i32, reduce_scalar_sum_i64, reduce_scalar_minmax,
+    reduce_scalar_dot_i64, reduce_scalar_prefix_i32, reduce_scalar_prefix_i64,
+};
+
+#ifdef REDUCE_X86
+/* ════════════════════════════════════════════════════════════════
+ *  SSE2 — 4 × 32 bits, the x86-64 baseline
+ *
+ *  SSE2 has no signed 32-bit min/max (pminsd is SSE4.1), no signed
+ *  32 × 32 → 64 multiply (pmuldq, SSE4.1) and no sign extension
+ *  (pmovsxdq, SSE4.1): they are built from compares, the unsigned
+ *  multiply and unpacking against the sign.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define LOAD128(p)  _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define STORE128(p, v) _mm_storeu_si128((__m128i *)(void *)(p), (v))
+
+static inline uint32_t sse2_hsum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+static inline uint64_t sse2_hsum64(__m128i v)
+{
+    return (uint64_t)_mm_cvtsi128_si64(_mm_add_epi64(v, _mm_unpackhi_epi64(v, v)));
+}
+
+static inline __m128i sse2_min32(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+static inline __m128i sse2_max32(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+static int32_t sse2_sum_i32(const int32_t *a, size_t n)
+{
+    __m128i s0 = _mm_setzero_si128(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_epi32(s0, LOAD128(a + i));
+        s1 = _mm_add_epi32(s1, LOAD128(a + i + 4));
+    }
+    uint32_t s = sse2_hsum32(_mm_add_epi32(s0, s1));
+    for (; i < n; i++) s += (uint32_t)a[i];
+    return (int32_t)s;
+}
+
+static int64_t sse2_sum_i64(const int32_t *a, size_t n)
+{
+    __m128i s0 = _mm_setzero_si128(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = LOAD128(a + i), sign = _mm_srai_epi32(v, 31);
+        s0 = _mm_add_epi64(s0, _mm_unpacklo_epi32(v, sign));
+        s1 = _mm_add_epi64(s1, _mm_unpackhi_epi32(v, sign));
+    }
+    int64_t s = (int64_t)sse2_hsum64(_mm_add_epi64(s0, s1));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+static void sse2_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    __m128i lo = _mm_set1_epi32(INT32_MAX), hi = _mm_set1_epi32(INT32_MIN);
+    size_t  i  = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = LOAD128(a + i);
+        lo = sse2_min32(lo, v);
+        hi = sse2_max32(hi, v);
+    }
+    lo = sse2_min32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo = sse2_min32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = sse2_max32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = sse2_max32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    *min = _mm_cvtsi128_si32(lo);
+    *max = _mm_cvtsi128_si32(hi);
+    minmax_tail(a, i, n, min, max);
+}
+
+/* Signed lanes multiplied as unsigned are off by 2^32 × (b if a < 0,
+ * plus a if b < 0); that correction only needs its low 32 bits */
+static int64_t sse2_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+{
+    const __m128i odd = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i s0 = _mm_setzero_si128(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i va = LOAD128(a + i), vb = LOAD128(b + i);
+        __m128i fix = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(va, 31), vb),
+                                    _mm_and_si128(_mm_srai_epi32(vb, 31), va));
+        __m128i even = _mm_mul_epu32(va, vb);
+        __m128i odds = _mm_mul_epu32(_mm_srli_epi64(va, 32), _mm_srli_epi64(vb, 32));
+        s0 = _mm_add_epi64(s0, _mm_sub_epi64(even, _mm_slli_epi64(fix, 32)));
+        s1 = _mm_add_epi64(s1, _mm_sub_epi64(odds, _mm_and_si128(fix, odd)));
+    }
+    return (int64_t)dot_tail(a, b, i, n, sse2_hsum64(_mm_add_epi64(s0, s1)));
+}
+
+static void sse2_prefix_i32(const int32_t *a, int32_t *out, size_t n)
+{
+    __m128i carry = _mm_setzero_si128();
+    size_t  i     = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = LOAD128(a + i);
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        STORE128(out + i, _mm_add_epi32(x, carry));
+        carry = _mm_add_epi32(carry, _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    prefix_i32_tail(a, out, i, n, (uint32_t)_mm_cvtsi128_si32(carry));
+}
+
+static void sse2_prefix_i64(const int32_t *a, int64_t *out, size_t n)
+{
+    __m128i carry = _mm_setzero_si128();
+    size_t  i     = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v  = LOAD128(a + i), sign = _mm_srai_epi32(v, 31);
+        __m128i lo = _mm_unpacklo_epi32(v, sign), hi = _mm_unpackhi_epi32(v, sign);
+        lo = _mm_add_epi64(lo, _mm_slli_si128(lo, 8));
+        hi = _mm_add_epi64(_mm_add_epi64(hi, _mm_slli_si128(hi, 8)), _mm_unpackhi_epi64(lo, lo));
+        STORE128(out + i, _mm_add_epi64(lo, carry));
+        STORE128(out + i + 2, _mm_add_epi64(hi, carry));
+        carry = _mm_add_epi64(carry, _mm_unpackhi_epi64(hi, hi));
+    }
+    prefix_i64_tail(a, out, i, n, _mm_cvtsi128_si64(carry));
+}
+
+static const ReduceKernels sse2_kernels = {
+    "sse2", sse2_sum_i32, sse2_sum_i64, sse2_minmax, sse2_dot_i64, sse2_prefix_i32, sse2_prefix_i64,
+};
+
+/* ════════════════════════════════════════════════════════════════
+ *  AVX2 — 8 × 32 bits
+ *
+ *  256-bit shifts and shuffles work within each 128-bit half, so a
+ *  scan finishes by adding the low half's total to the high half.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define AVX2 __attribute__((target("avx2")))
+#define LOAD256(p)  _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define STORE256(p, v) _mm256_storeu_si256((__m256i *)(void *)(p), (v))
+
+AVX2 static inline __m128i avx2_fold32(__m256i v)
+{
+    return _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+AVX2 static inline __m128i avx2_fold64(__m256i v)
+{
+    return _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+AVX2 static int32_t avx2_sum_i32(const int32_t *a, size_t n)
+{
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_epi32(s0, LOAD256(a + i));
+        s1 = _mm256_add_epi32(s1, LOAD256(a + i + 8));
+    }
+    uint32_t s = sse2_hsum32(avx2_fold32(_mm256_add_epi32(s0, s1)));
+    for (; i < n; i++) s += (uint32_t)a[i];
+    return (int32_t)s;
+}
+
+AVX2 static int64_t avx2_sum_i64(const int32_t *a, size_t n)
+{
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_cvtepi32_epi64(LOAD128(a + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_cvtepi32_epi64(LOAD128(a + i + 4)));
+    }
+    int64_t s = (int64_t)sse2_hsum64(avx2_fold64(_mm256_add_epi64(s0, s1)));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+AVX2 static void avx2_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    __m256i lo = _mm256_set1_epi32(INT32_MAX), hi = _mm256_set1_epi32(INT32_MIN);
+    size_t  i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = LOAD256(a + i);
+        lo = _mm256_min_epi32(lo, v);
+        hi = _mm256_max_epi32(hi, v);
+    }
+    __m128i l = _mm_min_epi32(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1));
+    __m128i h = _mm_max_epi32(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1));
+    l = _mm_min_epi32(l, _mm_shuffle_epi32(l, _MM_SHUFFLE(1, 0, 3, 2)));
+    l = _mm_min_epi32(l, _mm_shuffle_epi32(l, _MM_SHUFFLE(2, 3, 0, 1)));
+    h = _mm_max_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_max_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    *min = _mm_cvtsi128_si32(l);
+    *max = _mm_cvtsi128_si32(h);
+    minmax_tail(a, i, n, min, max);
+}
+
+/* vpmuldq multiplies the low (even) 32 bits of each 64-bit lane */
+AVX2 static int64_t avx2_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+{
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = LOAD256(a + i), vb = LOAD256(b + i);
+        s0 = _mm256_add_epi64(s0, _mm256_mul_epi32(va, vb));
+        s1 = _mm256_add_epi64(s1, _mm256_mul_epi32(_mm256_srli_epi64(va, 32), _mm256_srli_epi64(vb, 32)));
+    }
+    return (int64_t)dot_tail(a, b, i, n, sse2_hsum64(avx2_fold64(_mm256_add_epi64(s0, s1))));
+}
+
+AVX2 static void avx2_prefix_i32(const int32_t *a, int32_t *out, size_t n)
+{
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    size_t  i     = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = LOAD256(a + i);
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        __m256i low = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));    /* [0, low total] */
+        STORE256(out + i, _mm256_add_epi32(x, carry));
+        carry = _mm256_add_epi32(carry, _mm256_permutevar8x32_epi32(x, last));
+    }
+    prefix_i32_tail(a, out, i, n, (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(carry)));
+}
+
+AVX2 static inline __m256i avx2_scan64(__m256i x)
+{
+    x = _mm256_add_epi64(x, _mm256_slli_si256(x, 8));
+    __m256i low = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 1, 1, 1));
+    return _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0xF0));
+}
+
+AVX2 static void avx2_prefix_i64(const int32_t *a, int64_t *out, size_t n)
+{
+    __m256i carry = _mm256_setzero_si256();
+    size_t  i     = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lo = avx2_scan64(_mm256_cvtepi32_epi64(LOAD128(a + i)));
+        __m256i hi = avx2_scan64(_mm256_cvtepi32_epi64(LOAD128(a + i + 4)));
+        hi = _mm256_add_epi64(hi, _mm256_permute4x64_epi64(lo, _MM_SHUFFLE(3, 3, 3, 3)));
+        STORE256(out + i, _mm256_add_epi64(lo, carry));
+        STORE256(out + i + 4, _mm256_add_epi64(hi, carry));
+        carry = _mm256_add_epi64(carry, _mm256_permute4x64_epi64(hi, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    prefix_i64_tail(a, out, i, n, _mm_cvtsi128_si64(_mm256_castsi256_si128(carry)));
+}
+
+static const ReduceKernels avx2_kernels = {
+    "avx2", avx2_sum_i32, avx2_sum_i64, avx2_minmax, avx2_dot_i64, avx2_prefix_i32, avx2_prefix_i64,
+};
+
+/* ════════════════════════════════════════════════════════════════
+ *  AVX-512F — 16 × 32 bits
+ *
+ *  valignd shifts across the whole register, so a scan needs no
+ *  fix-up between halves, and the tail is one masked iteration.
+ * ════════════════════════════════════════════════════════════════ */
+
+#define AVX512 __attribute__((target("avx512f")))
+
+AVX512 static inline __mmask16 avx512_tail(size_t left)
+{
+    return (__mmask16)((1u << left) - 1);       /* left < 16 */
+}
+
+/* Not _mm512_reduce_add_*(): GCC's finish with int additions, which
+ * may overflow */
+AVX512 static inline uint32_t avx512_hsum32(__m512i v)
+{
+    __m256i h = _mm256_add_epi32(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+    return sse2_hsum32(avx2_fold32(h));
+}
+
+AVX512 static inline uint64_t avx512_hsum64(__m512i v)
+{
+    __m256i h = _mm256_add_epi64(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+    return sse2_hsum64(avx2_fold64(h));
+}
+
+AVX512 static int32_t avx512_sum_i32(const int32_t *a, size_t n)
+{
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm512_add_epi32(s0, _mm512_loadu_si512(a + i));
+        s1 = _mm512_add_epi32(s1, _mm512_loadu_si512(a + i + 16));
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? (__mmask16)0xFFFF : avx512_tail(n - i);
+        s0 = _mm512_add_epi32(s0, _mm512_maskz_loadu_epi32(m, a + i));
+    }
+    return (int32_t)avx512_hsum32(_mm512_add_epi32(s0, s1));
+}
+
+AVX512 static int64_t avx512_sum_i64(const int32_t *a, size_t n)
+{
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    size_t  i  = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_add_epi64(s0, _mm512_cvtepi32_epi64(LOAD256(a + i)));
+        s1 = _mm512_add_epi64(s1, _mm512_cvtepi32_epi64(LOAD256(a + i + 8)));
+    }
+    if (i < n) {
+        __m512i v = _mm512_maskz_loadu_epi32(avx512_tail(n - i), a + i);
+        s0 = _mm512_add_epi64(s0, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+        s1 = _mm512_add_epi64(s1, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+    }
+    return (int64_t)avx512_hsum64(_mm512_add_epi64(s0, s1));
+}
+
+AVX512 static void avx512_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    __m512i lo = _mm512_set1_epi32(INT32_MAX), hi = _mm512_set1_epi32(INT32_MIN);
+    size_t  i  = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_loadu_si512(a + i);
+        lo = _mm512_min_epi32(lo, v);
+        hi = _mm512_max_epi32(hi, v);
+    }
+    if (i < n) {
+        __mmask16 m = avx512_tail(n - i);
+        __m512i   v = _mm512_maskz_loadu_epi32(m, a + i);
+        lo = _mm512_mask_min_epi32(lo, m, lo, v);   /* lanes outside m keep lo */
+        hi = _mm512_mask_max_epi32(hi, m, hi, v);
+    }
+    *min = _mm512_reduce_min_epi32(lo);
+    *max = _mm512_reduce_max_epi32(hi);
+}
+
+AVX512 static int64_t avx512_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+{
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+    size_t  i  = 0;
+    for (; i < n; i += 16) {
+        __mmask16 m  = n - i >= 16 ? (__mmask16)0xFFFF : avx512_tail(n - i);
+        __m512i   va = _mm512_maskz_loadu_epi32(m, a + i), vb = _mm512_maskz_loadu_epi32(m, b + i);
+        s0 = _mm512_add_epi64(s0, _mm512_mul_epi32(va, vb));
+        s1 = _mm512_add_epi64(s1, _mm512_mul_epi32(_mm512_srli_epi64(va, 32), _mm512_srli_epi64(vb, 32)));
+    }
+    return (int64_t)avx512_hsum64(_mm512_add_epi64(s0, s1));
+}
+
+AVX512 static void avx512_prefix_i32(const int32_t *a, int32_t *out, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512(), last = _mm512_set1_epi32(15);
+    __m512i carry = zero;
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? (__mmask16)0xFFFF : avx512_tail(n - i);
+        __m512i   x = _mm512_maskz_loadu_epi32(m, a + i);
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 15));      /* x << 1 lane */
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 14));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 12));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 8));
+        _mm512_mask_storeu_epi32(out + i, m, _mm512_add_epi32(x, carry));
+        carry = _mm512_add_epi32(carry, _mm512_permutexvar_epi32(last, x));
+    }
+}
+
+AVX512 static inline __m512i avx512_scan64(__m512i x)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    x = _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 7));
+    x = _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 6));
+    return _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 4));
+}
+
+AVX512 static void avx512_prefix_i64(const int32_t *a, int64_t *out, size_t n)
+{
+    const __m512i last = _mm512_set1_epi64(7);
+    __m512i carry = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m  = n - i >= 16 ? (__mmask16)0xFFFF : avx512_tail(n - i);
+        __m512i   v  = _mm512_maskz_loadu_epi32(m, a + i);
+        __m512i   lo = avx512_scan64(_mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+        __m512i   hi = avx512_scan64(_mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+        hi = _mm512_add_epi64(hi, _mm512_permutexvar_epi64(last, lo));
+        _mm512_mask_storeu_epi64(out + i, (__mmask8)m, _mm512_add_epi64(lo, carry));
+        _mm512_mask_storeu_epi64(out + i + 8, (__mmask8)(m >> 8), _mm512_add_epi64(hi, carry));
+        carry = _mm512_add_epi64(carry, _mm512_permutexvar_epi64(last, hi));
+    }
+}
+
+static const ReduceKernels avx512_kernels = {
+    "avx512", avx512_sum_i32, avx512_sum_i64, avx512_minmax, avx512_dot_i64, avx512_prefix_i32,
+    avx512_prefix_i64,
+};
+#endif /* REDUCE_X86 */
+
+#ifdef REDUCE_NEON
+/* ════════════════════════════════════════════════════════════════
+ *  NEON — 4 × 32 bits, the AArch64 baseline
+ *
+ *  Across-lane reductions (addv, sminv, smaxv) and widening adds and
+ *  multiplies (sadalp, smlal) are single instructions here.
+ * ════════════════════════════════════════════════════════════════ */
+
+static int32_t neon_sum_i32(const int32_t *a, size_t n)
+{
+    int32x4_t s0 = vdupq_n_s32(0), s1 = s0;
+    size_t    i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = vaddq_s32(s0, vld1q_s32(a + i));
+        s1 = vaddq_s32(s1, vld1q_s32(a + i + 4));
+    }
+    uint32_t s = (uint32_t)vaddvq_s32(vaddq_s32(s0, s1));
+    for (; i < n; i++) s += (uint32_t)a[i];
+    return (int32_t)s;
+}
+
+static int64_t neon_sum_i64(const int32_t *a, size_t n)
+{
+    int64x2_t s0 = vdupq_n_s64(0), s1 = s0;
+    size_t    i  = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = vpadalq_s32(s0, vld1q_s32(a + i));     /* s0 += pairwise sums, widened */
+        s1 = vpadalq_s32(s1, vld1q_s32(a + i + 4));
+    }
+    int64_t s = vaddvq_s64(vaddq_s64(s0, s1));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+static void neon_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    int32x4_t lo = vdupq_n_s32(INT32_MAX), hi = vdupq_n_s32(INT32_MIN);
+    size_t    i  = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t v = vld1q_s32(a + i);
+        lo = vminq_s32(lo, v);
+        hi = vmaxq_s32(hi, v);
+    }
+    *min = vminvq_s32(lo);
+    *max = vmaxvq_s32(hi);
+    minmax_tail(a, i, n, min, max);
+}
+
+static int64_t neon_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+{
+    int64x2_t s0 = vdupq_n_s64(0), s1 = s0;
+    size_t    i  = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t va = vld1q_s32(a + i), vb = vld1q_s32(b + i);
+        s0 = vmlal_s32(s0, vget_low_s32(va), vget_low_s32(vb));
+        s1 = vmlal_high_s32(s1, va, vb);
+    }
+    return (int64_t)dot_tail(a, b, i, n, (uint64_t)vaddvq_s64(vaddq_s64(s0, s1)));
+}
+
+static void neon_prefix_i32(const int32_t *a, int32_t *out, size_t n)
+{
+    const int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t carry = zero;
+    size_t    i     = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t x = vld1q_s32(a + i);
+        x = vaddq_s32(x, vextq_s32(zero, x, 3));    /* [0, x0, x1, x2] */
+        x = vaddq_s32(x, vextq_s32(zero, x, 2));
+        vst1q_s32(out + i, vaddq_s32(x, carry));
+        carry = vaddq_s32(carry, vdupq_laneq_s32(x, 3));
+    }
+    prefix_i32_tail(a, out, i, n, (uint32_t)vgetq_lane_s32(carry, 0));
+}
+
+static void neon_prefix_i64(const int32_t *a, int64_t *out, size_t n)
+{
+    const int64x2_t zero = vdupq_n_s64(0);
+    int64x2_t carry = zero;
+    size_t    i     = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t v  = vld1q_s32(a + i);
+        int64x2_t lo = vmovl_s32(vget_low_s32(v)), hi = vmovl_high_s32(v);
+        lo = vaddq_s64(lo, vextq_s64(zero, lo, 1));
+        hi = vaddq_s64(vaddq_s64(hi, vextq_s64(zero, hi, 1)), vdupq_laneq_s64(lo, 1));
+        vst1q_s64(out + i, vaddq_s64(lo, carry));
+        vst1q_s64(out + i + 2, vaddq_s64(hi, carry));
+        carry = vaddq_s64(carry, vdupq_laneq_s64(hi, 1));
+    }
+    prefix_i64_tail(a, out, i, n, vgetq_lane_s64(carry, 0));
+}
+
+static const ReduceKernels neon_kernels = {
+    "neon", neon_sum_i32, neon_sum_i64, neon_minmax, neon_dot_i64, neon_prefix_i32, neon_prefix_i64,
+};
+#endif /* REDUCE_NEON */
+
+/* ════════════════════════════════════════════════════════════════
+ *  Dispatch
+ * ════════════════════════════════════════════════════════════════ */
+
+size_t reduce_variants(const ReduceKernels **out, size_t max)
+{
+    size_t n = 0;
+    if (n < max) out[n++] = &scalar_kernels;
+#ifdef REDUCE_X86
+    __builtin_cpu_init();
+    if (n < max) out[n++] = &sse2_kernels;
+    if (n < max && __builtin_cpu_supports("avx2"))    out[n++] = &avx2_kernels;
+    if (n < max && __builtin_cpu_supports("avx512f")) out[n++] = &avx512_kernels;
+#endif
+#ifdef REDUCE_NEON
+    if (n < max) out[n++] = &neon_kernels;
+#endif
+    return n;
+}
+
+/* Also called by the ifunc resolvers, while the dynamic linker is still
+ * relocating and before any sanitizer runtime is up: __builtin_cpu_init()
+ * must come first, nothing here may call through the PLT, and ASan must
+ * not check the memory it reads */
+#define RESOLVER __attribute__((no_sanitize_address))
+
+RESOLVER static const ReduceKernels *select_best(void)
+{
+#if defined(REDUCE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return &avx512_kernels;
+    if (__builtin_cpu_supports("avx2"))    return &avx2_kernels;
+    return &sse2_kernels;
+#elif defined(REDUCE_NEON)
+    return &neon_kernels;
+#else
+    return &scalar_kernels;
+#endif
+}
+
+const ReduceKernels *reduce_best(void)
+{
+    static const ReduceKernels *best;
+    const ReduceKernels *k = __atomic_load_n(&best, __ATOMIC_ACQUIRE);
+    if (!k) {
+        k = select_best();      /* racing threads choose the same one */
+        __atomic_store_n(&best, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+#ifdef REDUCE_IFUNC
+typedef int32_t (*SumI32Fn)(const int32_t *, size_t);
+typedef int64_t (*SumI64Fn)(const int32_t *, size_t);
+typedef void    (*MinMaxFn)(const int32_t *, size_t, int32_t *, int32_t *);
+typedef int64_t (*DotFn)(const int32_t *, const int32_t *, size_t);
+typedef void    (*PrefixI32Fn)(const int32_t *, int32_t *, size_t);
+typedef void    (*PrefixI64Fn)(const int32_t *, int64_t *, size_t);
+
+RESOLVER static SumI32Fn    resolve_sum_i32(void)    { return select_best()->sum_i32; }
+RESOLVER static SumI64Fn    resolve_sum_i64(void)    { return select_best()->sum_i64; }
+RESOLVER static MinMaxFn    resolve_minmax(void)     { return select_best()->minmax; }
+RESOLVER static DotFn       resolve_dot_i64(void)    { return select_best()->dot_i64; }
+RESOLVER static PrefixI32Fn resolve_prefix_i32(void) { return select_best()->prefix_i32; }
+RESOLVER static PrefixI64Fn resolve_prefix_i64(void) { return select_best()->prefix_i64; }
+
+int32_t reduce_sum_i32(const int32_t *a, size_t n) __attribute__((ifunc("resolve_sum_i32")));
+int64_t reduce_sum_i64(const int32_t *a, size_t n) __attribute__((ifunc("resolve_sum_i64")));
+void    reduce_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+        __attribute__((ifunc("resolve_minmax")));
+int64_t reduce_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+        __attribute__((ifunc("resolve_dot_i64")));
+void    reduce_prefix_i32(const int32_t *a, int32_t *out, size_t n)
+        __attribute__((ifunc("resolve_prefix_i32")));
+void    reduce_prefix_i64(const int32_t *a, int64_t *out, size_t n)
+        __attribute__((ifunc("resolve_prefix_i64")));
+#else
+int32_t reduce_sum_i32(const int32_t *a, size_t n) { return reduce_best()->sum_i32(a, n); }
+int64_t reduce_sum_i64(const int32_t *a, size_t n) { return reduce_best()->sum_i64(a, n); }
+
+void reduce_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    reduce_best()->minmax(a, n, min, max);
+}
+
+int64_t reduce_dot_i64(const int32_t *a, const int32_t *b, size_t n)
+{
+    return reduce_best()->dot_i64(a, b, n);
+}
+
+void reduce_prefix_i32(const int32_t *a, int32_t *out, size_t n) { reduce_best()->prefix_i32(a, out, n); }
+void reduce_prefix_i64(const int32_t *a, int64_t *out, size_t n) { reduce_best()->prefix_i64(a, out, n); }
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Chapter 23 — Reduction kernels with runtime-dispatched SIMD variants
+ *
+ * Section 6's array_sum() is the shape every one of these has: one pass
+ * over an int32_t array, folding it into an accumulator.  Each kernel
+ * comes in up to six variants:
+ *
+ *   scalar    plain loops (reduce_scalar.c), the reference
+ *   autovec   the same loops built -O3 -march=native (bench_reduce only)
+ *   sse2      x86-64 baseline: 4 lanes, no pmulld/pminsd/pmovsx
+ *   avx2      8 lanes
+ *   avx512    16 lanes (AVX-512F)
+ *   neon      AArch64 baseline: 4 lanes
+ *
+ * The SIMD variants are compiled with per-function target attributes,
+ * so one binary carries them all; reduce_best() picks the widest the
+ * CPU (and OS, for the AVX register state) supports, once.  The
+ * reduce_*() entry points below call it: on x86-64 Linux they are GNU
+ * ifunc symbols, resolved by the dynamic linker before main(), so a
+ * call costs what a call through the PLT does; elsewhere they go
+ * through the pointer reduce_best() returns.
+ *
+ * Every variant returns bit-for-bit the same results, in any lane order:
+ * the 32-bit kernels wrap modulo 2^32 (as unsigned arithmetic does, so
+ * int overflow is never undefined), and the _i64 ones accumulate in 64
+ * bits — exact for sums of fewer than 2^32 elements, and modulo 2^64
+ * for dot products whose true value does not fit.
+ */
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    int32_t (*sum_i32)(const int32_t *a, size_t n);
+    int64_t (*sum_i64)(const int32_t *a, size_t n);
+    /* n == 0: *min = INT32_MAX, *max = INT32_MIN */
+    void    (*minmax)(const int32_t *a, size_t n, int32_t *min, int32_t *max);
+    int64_t (*dot_i64)(const int32_t *a, const int32_t *b, size_t n);
+    /* Inclusive: out[i] = a[0] + ... + a[i]; out may be a */
+    void    (*prefix_i32)(const int32_t *a, int32_t *out, size_t n);
+    void    (*prefix_i64)(const int32_t *a, int64_t *out, size_t n);
+} ReduceKernels;
+
+/* The variants this CPU can run, scalar first and best last; returns
+ * how many (≤ max) were stored in out */
+size_t reduce_variants(const ReduceKernels **out, size_t max);
+
+/* The best of them, chosen on the first call */
+const ReduceKernels *reduce_best(void);
+
+/* Dispatched to reduce_best() */
+int32_t reduce_sum_i32(const int32_t *a, size_t n);
+int64_t reduce_sum_i64(const int32_t *a, size_t n);
+void    reduce_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max);
+int64_t reduce_dot_i64(const int32_t *a, const int32_t *b, size_t n);
+void    reduce_prefix_i32(const int32_t *a, int32_t *out, size_t n);
+void    reduce_prefix_i64(const int32_t *a, int64_t *out, size_t n);
+
+/* reduce_scalar.c: the reference loops, and the same loops compiled
+ * -O3 -march=native as reduce_autovec_*() (-DREDUCE_AUTOVEC) */
+int32_t reduce_scalar_sum_i32(const int32_t *a, size_t n);
+int64_t reduce_scalar_sum_i64(const int32_t *a, size_t n);
+void    reduce_scalar_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max);
+int64_t reduce_scalar_dot_i64(const int32_t *a, const int32_t *b, size_t n);
+void    reduce_scalar_prefix_i32(const int32_t *a, int32_t *out, size_t n);
+void    reduce_scalar_prefix_i64(const int32_t *a, int64_t *out, size_t n);
+
+int32_t reduce_autovec_sum_i32(const int32_t *a, size_t n);
+int64_t reduce_autovec_sum_i64(const int32_t *a, size_t n);
+void    reduce_autovec_minmax(const int32_t *a, size_t n, int32_t *min, int32_t *max);
+int64_t reduce_autovec_dot_i64(const int32_t *a, const int32_t *b, size_t n);
+void    reduce_autovec_prefix_i32(const int32_t *a, int32_t *out, size_t n);
+void    reduce_autovec_prefix_i64(const int32_t *a, int64_t *out, size_t n);
+
+#endif /* REDUCE_H */
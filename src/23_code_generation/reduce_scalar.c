@@ -0,0 +1,70 @@
+/*
+ * Chapter 23 — The reduction kernels as plain C loops
+ *
+ * The reference every SIMD variant in reduce.c must match.  The
+ * Makefile also builds this file a second time, -O3 -march=native
+ * -DREDUCE_AUTOVEC, where the loops are renamed reduce_autovec_*() —
+ * what the compiler's own vectoriser makes of them, for bench_reduce
+ * to compare with the hand-written variants.
+ *
+ * Arithmetic is unsigned so that wrapping is defined; converting back
+ * to a signed type is modulo 2^N on every compiler this repo supports.
+ */
+
+#include "reduce.h"
+
+#ifdef REDUCE_AUTOVEC
+#define KERNEL(name) reduce_autovec_##name
+#else
+#define KERNEL(name) reduce_scalar_##name
+#endif
+
+int32_t KERNEL(sum_i32)(const int32_t *a, size_t n)
+{
+    uint32_t s = 0;
+    for (size_t i = 0; i < n; i++) s += (uint32_t)a[i];
+    return (int32_t)s;
+}
+
+int64_t KERNEL(sum_i64)(const int32_t *a, size_t n)
+{
+    int64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += a[i];
+    return s;
+}
+
+void KERNEL(minmax)(const int32_t *a, size_t n, int32_t *min, int32_t *max)
+{
+    int32_t lo = INT32_MAX, hi = INT32_MIN;
+    for (size_t i = 0; i < n; i++) {
+        lo = a[i] < lo ? a[i] : lo;
+        hi = a[i] > hi ? a[i] : hi;
+    }
+    *min = lo;
+    *max = hi;
+}
+
+int64_t KERNEL(dot_i64)(const int32_t *a, const int32_t *b, size_t n)
+{
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += (uint64_t)((int64_t)a[i] * b[i]);
+    return (int64_t)s;
+}
+
+void KERNEL(prefix_i32)(const int32_t *a, int32_t *out, size_t n)
+{
+    uint32_t s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += (uint32_t)a[i];
+        out[i] = (int32_t)s;
+    }
+}
+
+void KERNEL(prefix_i64)(const int32_t *a, int64_t *out, size_t n)
+{
+    int64_t s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += a[i];
+        out[i] = s;
+    }
+}
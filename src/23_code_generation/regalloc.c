@@ -0,0 +1,396 @@
+/*
+ * Chapter 23 — Linear-scan register allocation — see regalloc.h
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "regalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/bench.h"
+#include "../21_intermediate_repr/cfg.h"
+
+/* ════════════════════════════════════════════════════════════════
+ *  Targets — what jit.c does not already use for itself
+ * ════════════════════════════════════════════════════════════════ */
+
+/* System V: eax, ecx, edx are the JIT's scratch and rdi the vars */
+static const RaReg x86_regs[] = {
+    { "esi", 6, 0 },   { "r8d", 8, 0 },   { "r9d", 9, 0 },   { "r10d", 10, 0 }, { "r11d", 11, 0 },
+    { "ebx", 3, 1 },   { "ebp", 5, 1 },   { "r12d", 12, 1 }, { "r13d", 13, 1 }, { "r14d", 14, 1 },
+    { "r15d", 15, 1 },
+};
+
+/* AAPCS64: x0 holds the vars, w9, w10 and w16 are scratch, x17 and
+ * x18 are left alone (IP1, platform register) */
+static const RaReg a64_regs[] = {
+    { "w1", 1, 0 },   { "w2", 2, 0 },   { "w3", 3, 0 },   { "w4", 4, 0 },   { "w5", 5, 0 },
+    { "w6", 6, 0 },   { "w7", 7, 0 },   { "w8", 8, 0 },   { "w11", 11, 0 }, { "w12", 12, 0 },
+    { "w13", 13, 0 }, { "w14", 14, 0 }, { "w15", 15, 0 },
+    { "w19", 19, 1 }, { "w20", 20, 1 }, { "w21", 21, 1 }, { "w22", 22, 1 }, { "w23", 23, 1 },
+    { "w24", 24, 1 }, { "w25", 25, 1 }, { "w26", 26, 1 }, { "w27", 27, 1 }, { "w28", 28, 1 },
+};
+
+static const RaTarget targets[JIT_ARCH_COUNT] = {
+    { JIT_X86_64,  x86_regs, sizeof(x86_regs) / sizeof(x86_regs[0]) },
+    { JIT_AARCH64, a64_regs, sizeof(a64_regs) / sizeof(a64_regs[0]) },
+};
+
+const RaTarget *ra_target(JitArch arch)
+{
+    return arch < JIT_ARCH_COUNT ? &targets[arch] : NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Liveness
+ * ════════════════════════════════════════════════════════════════ */
+
+#define BIT_SET(s, t)   ((s)[(t) / 64] |= 1ull << ((t) % 64))
+#define BIT_TEST(s, t)  ((s)[(t) / 64] >> ((t) % 64) & 1)
+
+/* Instructions that jit.c and tac_exec() skip: a result with nowhere to go */
+static int is_dropped(const TacInstr *in)
+{
+    return tac_writes_dst(in->op) && OPND_TAG(in->dst) != OPND_TEMP && OPND_TAG(in->dst) != OPND_VAR;
+}
+
+/* The temporaries in reads (at most two) */
+static int temp_reads(const TacInstr *in, uint32_t out[2])
+{
+    int n = 0;
+    if (in->op == TAC_LABEL || in->op == TAC_GOTO || in->op >= TAC_OP_COUNT || is_dropped(in)) return 0;
+    if (OPND_TAG(in->a) == OPND_TEMP) out[n++] = OPND_INDEX(in->a);
+    if (tac_reads_b(in->op) && OPND_TAG(in->b) == OPND_TEMP) out[n++] = OPND_INDEX(in->b);
+    return n;
+}
+
+/* The temporary in writes, or RA_NEVER */
+static uint32_t temp_write(const TacInstr *in)
+{
+    return tac_writes_dst(in->op) && OPND_TAG(in->dst) == OPND_TEMP ? OPND_INDEX(in->dst) : RA_NEVER;
+}
+
+static void extend(RaInterval *iv, uint32_t pos)
+{
+    if (pos < iv->start) iv->start = pos;
+    if (pos > iv->end)   iv->end   = pos;
+}
+
+static void extend_set(RaInterval *iv, const uint64_t *set, uint32_t n_words, uint32_t pos)
+{
+    for (uint32_t w = 0; w < n_words; w++)
+        for (uint64_t bits = set[w]; bits; bits &= bits - 1)
+            extend(&iv[w * 64 + (uint32_t)__builtin_ctzll(bits)], pos);
+}
+
+/* live_in per block, then the intervals, entry_live and label_live */
+static int liveness(RegAlloc *ra, const TacProgram *p)
+{
+    Cfg cfg;
+    if (cfg_build(&cfg, p) != 0) return -1;
+
+    uint32_t  nb = cfg.n_blocks, W = ra->n_words;
+    uint64_t *mem = calloc((size_t)nb * W * 4, sizeof(uint64_t));
+    if (!mem) { cfg_free(&cfg); return -1; }
+    uint64_t *use = mem, *def = use + (size_t)nb * W, *in = def + (size_t)nb * W, *out = in + (size_t)nb * W;
+
+    for (uint32_t b = 0; b < nb; b++) {
+        uint64_t *u = use + (size_t)b * W, *d = def + (size_t)b * W;
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].end; i++) {
+            uint32_t r[2], w = temp_write(&p->code[i]);
+            int      n = temp_reads(&p->code[i], r);
+            for (int k = 0; k < n; k++)
+                if (!BIT_TEST(d, r[k])) BIT_SET(u, r[k]);
+            if (w != RA_NEVER) BIT_SET(d, w);
+        }
+    }
+
+    /* Backward, last block first: a loop body settles in a few sweeps */
+    for (int changed = 1; changed; ) {
+        changed = 0;
+        ra->sweeps++;
+        for (uint32_t b = nb; b-- > 0; ) {
+            const CfgBlock *bb = &cfg.blocks[b];
+            uint64_t       *o  = out + (size_t)b * W, *i = in + (size_t)b * W;
+            const uint64_t *u  = use + (size_t)b * W, *d = def + (size_t)b * W;
+            for (uint32_t w = 0; w < W; w++) {
+                uint64_t x = 0;
+                for (uint32_t s = 0; s < bb->n_succ; s++) x |= in[(size_t)bb->succ[s] * W + w];
+                uint64_t y = u[w] | (x & ~d[w]);
+                o[w] = x;
+                if (y != i[w]) { i[w] = y; changed = 1; }
+            }
+        }
+    }
+
+    /* The hull of every position a temporary is live at */
+    for (uint32_t b = 0; b < nb; b++) {
+        const CfgBlock *bb = &cfg.blocks[b];
+        if (bb->first == bb->end) continue;
+        extend_set(ra->iv, out + (size_t)b * W, W, RA_DEF(bb->end - 1));
+        extend_set(ra->iv, in + (size_t)b * W, W, RA_USE(bb->first));
+        for (uint32_t i = bb->first; i < bb->end; i++) {
+            uint32_t r[2], w = temp_write(&p->code[i]);
+            int      n = temp_reads(&p->code[i], r);
+            for (int k = 0; k < n; k++) extend(&ra->iv[r[k]], RA_USE(i));
+            if (w != RA_NEVER) extend(&ra->iv[w], RA_DEF(i));
+        }
+    }
+
+    memcpy(ra->entry_live, in + (size_t)cfg.entry * W, W * sizeof(uint64_t));
+    for (uint32_t l = 0; l < ra->n_labels; l++)
+        memcpy(ra->label_live + (size_t)l * W, in + (size_t)cfg.label_block[l] * W, W * sizeof(uint64_t));
+    for (uint32_t i = 0; i < p->count; i++)
+        if (p->code[i].op == TAC_LABEL && OPND_INDEX(p->code[i].dst) < ra->n_labels)
+            ra->label_pos[OPND_INDEX(p->code[i].dst)] = i;      /* the last one, as tac_exec() */
+
+    free(mem);
+    cfg_free(&cfg);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Linear scan
+ * ════════════════════════════════════════════════════════════════ */
+
+static int cmp_u64(const void *x, const void *y)
+{
+    uint64_t a = *(const uint64_t *)x, b = *(const uint64_t *)y;
+    return a < b ? -1 : a > b;
+}
+
+typedef struct {
+    uint32_t *end;          /* per slot: where its last owner's interval ends */
+    uint32_t  n, cap;
+} Slots;
+
+/* First fit: a slot whose owners all end before iv starts.  A split
+ * interval writes its slot from its start, not from the split, so
+ * that is the overlap that counts. */
+static int give_slot(Slots *s, RaInterval *iv)
+{
+    for (uint32_t k = 0; k < s->n; k++)
+        if (s->end[k] < iv->start) {
+            s->end[k] = iv->end;
+            iv->slot  = k;
+            return 0;
+        }
+    if (s->n == s->cap) {
+        uint32_t  cap = s->cap ? s->cap * 2 : 16;
+        uint32_t *end = realloc(s->end, cap * sizeof(uint32_t));
+        if (!end) return -1;
+        s->end = end;
+        s->cap = cap;
+    }
+    s->end[s->n] = iv->end;
+    iv->slot     = s->n++;
+    return 0;
+}
+
+static int scan(RegAlloc *ra)
+{
+    RaInterval *iv    = ra->iv;
+    uint64_t   *order = malloc((ra->n_intervals ? ra->n_intervals : 1) * sizeof(uint64_t));
+    if (!order) return -1;
+    uint32_t n = 0;
+    for (uint32_t t = 0; t < ra->n_temps; t++)
+        if (iv[t].start <= iv[t].end) order[n++] = (uint64_t)iv[t].start << 32 | t;
+    qsort(order, n, sizeof(uint64_t), cmp_u64);
+
+    uint32_t active[RA_MAX_REGS], n_active = 0;     /* by end, ascending */
+    uint32_t free_regs = ra->n_regs == 32 ? ~0u : (1u << ra->n_regs) - 1;
+    Slots    slots = { NULL, 0, 0 };
+    int      rc = 0;
+
+    for (uint32_t k = 0; k < n && rc == 0; k++) {
+        uint32_t    t   = (uint32_t)order[k];
+        RaInterval *cur = &iv[t];
+
+        uint32_t expired = 0;
+        while (expired < n_active && iv[active[expired]].end < cur->start)
+            free_regs |= 1u << iv[active[expired++]].reg;
+        memmove(active, active + expired, (n_active - expired) * sizeof(uint32_t));
+        n_active -= expired;
+
+        if (!free_regs) {
+            /* The one ending last gives way */
+            RaInterval *v = &iv[active[n_active - 1]];
+            if (v->end <= cur->end) {
+                cur->split = cur->start;
+                ra->n_spilled++;
+                rc = give_slot(&slots, cur);
+                continue;
+            }
+            free_regs |= 1u << v->reg;
+            if (v->start == cur->start) {
+                v->reg = -1;
+                ra->n_spilled++;
+            } else {
+                ra->n_split++;
+            }
+            v->split = cur->start;
+            n_active--;
+            rc = give_slot(&slots, v);
+        }
+        uint32_t r = (uint32_t)__builtin_ctz(free_regs);
+        free_regs &= ~(1u << r);
+        cur->reg  = (int32_t)r;
+        ra->used |= 1u << r;
+
+        uint32_t at = n_active;
+        while (at > 0 && iv[active[at - 1]].end > cur->end) {
+            active[at] = active[at - 1];
+            at--;
+        }
+        active[at] = t;
+        n_active++;
+    }
+
+    ra->n_slots = slots.n;
+    free(slots.end);
+    free(order);
+    return rc;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver and statistics
+ * ════════════════════════════════════════════════════════════════ */
+
+uint32_t ra_next_reload(const RegAlloc *ra, uint32_t i, uint32_t label, uint32_t t)
+{
+    if (label >= ra->n_labels || ra->label_pos[label] == RA_NEVER) return RA_NEVER;
+    uint32_t        q    = ra->label_pos[label];
+    const uint64_t *live = ra->label_live + (size_t)label * ra->n_words;
+    for (; t < ra->n_temps; t++) {
+        uint64_t bits = live[t / 64] >> (t % 64);
+        if (!bits) {                                /* on to the next word */
+            t |= 63;
+            continue;
+        }
+        t += (uint32_t)__builtin_ctzll(bits);
+        if (ra_reg_at(ra, t, RA_USE(q)) >= 0 && ra_reg_at(ra, t, RA_USE(i)) < 0) return t;
+    }
+    return RA_NEVER;
+}
+
+static void count_accesses(RegAlloc *ra, const TacProgram *p)
+{
+    for (uint32_t i = 0; i < p->count; i++) {
+        const TacInstr *in = &p->code[i];
+        uint32_t        r[2], w = temp_write(in);
+        int             n = temp_reads(in, r);
+        for (int k = 0; k < n; k++) {
+            ra->base_reads++;
+            ra->mem_reads += ra_reg_at(ra, r[k], RA_USE(i)) < 0;
+        }
+        if (w != RA_NEVER) {
+            ra->base_writes++;
+            ra->mem_writes += ra_reg_at(ra, w, RA_DEF(i)) < 0 || ra->iv[w].slot != RA_NEVER;
+        }
+        if (in->op == TAC_GOTO || tac_is_branch(in->op))
+            for (uint32_t t = ra_next_reload(ra, i, OPND_INDEX(in->dst), 0); t != RA_NEVER;
+                 t = ra_next_reload(ra, i, OPND_INDEX(in->dst), t + 1))
+                ra->n_reloads++;
+    }
+    ra->mem_reads += ra->n_reloads;
+
+    /* Pressure: +1 where an interval starts, -1 just after it ends */
+    uint32_t  n_pos = 2 * p->count + 2;
+    int32_t  *delta = calloc(n_pos, sizeof(int32_t));
+    if (!delta) return;
+    for (uint32_t t = 0; t < ra->n_temps; t++)
+        if (ra->iv[t].start <= ra->iv[t].end) {
+            delta[ra->iv[t].start]++;
+            delta[ra->iv[t].end + 1]--;
+        }
+    int32_t live = 0;
+    for (uint32_t pos = 0; pos < n_pos; pos++) {
+        live += delta[pos];
+        if (live > (int32_t)ra->max_live) ra->max_live = (uint32_t)live;
+    }
+    free(delta);
+}
+
+int ra_allocate(RegAlloc *ra, const TacProgram *p, JitArch arch, uint32_t max_regs)
+{
+    memset(ra, 0, sizeof(*ra));
+    ra->target = ra_target(arch);
+    if (!ra->target) return -1;
+    ra->n_regs   = max_regs && max_regs < ra->target->n_regs ? max_regs : ra->target->n_regs;
+    ra->n_temps  = p->n_temps;
+    ra->n_labels = p->n_labels;
+    ra->n_words  = p->n_temps ? (p->n_temps + 63) / 64 : 1;
+
+    ra->iv         = malloc((p->n_temps ? p->n_temps : 1) * sizeof(RaInterval));
+    ra->entry_live = calloc(ra->n_words, sizeof(uint64_t));
+    ra->label_live = calloc((size_t)(p->n_labels ? p->n_labels : 1) * ra->n_words, sizeof(uint64_t));
+    ra->label_pos  = malloc((p->n_labels ? p->n_labels : 1) * sizeof(uint32_t));
+    if (!ra->iv || !ra->entry_live || !ra->label_live || !ra->label_pos) {
+        ra_free(ra);
+        return -1;
+    }
+    for (uint32_t t = 0; t < p->n_temps; t++)
+        ra->iv[t] = (RaInterval){ RA_NEVER, 0, RA_NEVER, RA_NEVER, -1 };
+    for (uint32_t l = 0; l < p->n_labels; l++) ra->label_pos[l] = RA_NEVER;
+
+    uint64_t t0 = bench_now_ns();
+    if (liveness(ra, p) != 0) {
+        ra_free(ra);
+        return -1;
+    }
+    uint64_t t1 = bench_now_ns();
+    for (uint32_t t = 0; t < p->n_temps; t++) ra->n_intervals += ra->iv[t].start <= ra->iv[t].end;
+    if (scan(ra) != 0) {
+        ra_free(ra);
+        return -1;
+    }
+    uint64_t t2 = bench_now_ns();
+    ra->ms_liveness = (double)(t1 - t0) / 1e6;
+    ra->ms_scan     = (double)(t2 - t1) / 1e6;
+
+    for (uint32_t r = 0; r < ra->n_regs; r++)
+        ra->n_callee_saved += (ra->used >> r & 1) && ra->target->regs[r].callee_saved;
+    count_accesses(ra, p);
+    return 0;
+}
+
+void ra_free(RegAlloc *ra)
+{
+    free(ra->iv);
+    free(ra->entry_live);
+    free(ra->label_live);
+    free(ra->label_pos);
+    memset(ra, 0, sizeof(*ra));
+}
+
+void print_ra(const RegAlloc *ra)
+{
+    for (uint32_t t = 0; t < ra->n_temps; t++) {
+        const RaInterval *iv = &ra->iv[t];
+        if (iv->start > iv->end) continue;
+        printf("    t%-4u [%4u%c, %4u%c]  ", t, iv->start / 2, iv->start & 1 ? 'w' : 'r',
+               iv->end / 2, iv->end & 1 ? 'w' : 'r');
+        if (iv->reg >= 0) printf("%s", ra->target->regs[iv->reg].name);
+        if (iv->reg >= 0 && iv->slot != RA_NEVER)
+            printf(", slot %u from %u%c", iv->slot, iv->split / 2, iv->split & 1 ? 'w' : 'r');
+        else if (iv->slot != RA_NEVER)
+            printf("slot %u", iv->slot);
+        printf("%s\n", BIT_TEST(ra->entry_live, t) ? "   (live on entry)" : "");
+    }
+}
+
+void print_ra_stats(const RegAlloc *ra)
+{
+    printf("    intervals %u, at most %u live at once; %u of %u %s registers used (%u callee-saved)\n",
+           ra->n_intervals, ra->max_live, (uint32_t)__builtin_popcount(ra->used), ra->n_regs,
+           jit_arch_name(ra->target->arch), ra->n_callee_saved);
+    printf("    spilled %u whole, split %u; %u slots after reuse (stack baseline: %u)\n",
+           ra->n_spilled, ra->n_split, ra->n_slots, ra->n_temps);
+    printf("    memory reads %u (baseline %u), writes %u (baseline %u), %u reloads on jumps\n",
+           ra->mem_reads, ra->base_reads, ra->mem_writes, ra->base_writes, ra->n_reloads);
+    printf("    liveness %.3f ms (%u sweeps), scan %.3f ms\n",
+           ra->ms_liveness, ra->sweeps, ra->ms_scan);
+}
@@ -0,0 +1,122 @@
+/*
+ * Chapter 23 — Linear-scan register allocation for TAC temporaries
+ *
+ *   TacProgram ─► CFG ─► liveness ─► live intervals ─► linear scan ─► RegAlloc ─► jit_emit()
+ *
+ * Liveness is the backward dataflow over chapter 21's basic blocks,
+ * one bit per temporary, 64 temporaries per word operation:
+ *
+ *   out(B) = ∪ in(S) over successors S       in(B) = use(B) ∪ (out(B) − def(B))
+ *
+ * swept from the last block to the first until nothing changes.  A
+ * temporary's interval is the hull of everywhere it is live, in code
+ * layout order.  Instruction i reads at position 2i and writes at
+ * 2i + 1, so a value whose last read is the instruction defining
+ * another can hand that one its register.
+ *
+ * Linear scan (Poletto & Sarkar, "Linear Scan Register Allocation",
+ * 1999) visits intervals by start, expiring the active ones that have
+ * ended.  With every register taken, the active interval that ends
+ * last gives way: if that is not the new one, it is split — it keeps
+ * its register up to here and lives in a spill slot afterwards — and
+ * otherwise the new interval is spilled whole.  Slots are reused by
+ * intervals that do not overlap.
+ *
+ * A split interval is written through: every definition stores to the
+ * slot as well, so the slot holds the value wherever it is live.  The
+ * nesting of hull intervals then leaves one repair for the JIT: a jump
+ * from the slot part back into the register part reloads the register
+ * (ra_next_reload()).
+ *
+ * Only temporaries get registers; variables stay in the caller's
+ * array.  The JIT's functions make no calls, so caller-saved registers
+ * (chapter 31) are free and handed out first; callee-saved ones cost a
+ * save and restore in the prologue and epilogue.
+ */
+
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stdint.h>
+
+#include "jit.h"
+
+#define RA_NEVER    UINT32_MAX
+#define RA_MAX_REGS 32
+
+#define RA_USE(i)   (2 * (uint32_t)(i))         /* instruction i reads ...  */
+#define RA_DEF(i)   (2 * (uint32_t)(i) + 1)     /* ... then writes          */
+
+typedef struct {
+    const char *name;
+    uint8_t     hw;             /* encoding number */
+    uint8_t     callee_saved;
+} RaReg;
+
+typedef struct {
+    JitArch      arch;
+    const RaReg *regs;          /* in preference order: caller-saved first */
+    uint32_t     n_regs;
+} RaTarget;
+
+/* The registers jit.c leaves free on arch: NULL if there is no back end */
+const RaTarget *ra_target(JitArch arch);
+
+typedef struct {
+    uint32_t start, end;        /* positions, inclusive; start > end: never live */
+    uint32_t split;             /* in the slot from here on; RA_NEVER: never     */
+    uint32_t slot;              /* RA_NEVER: none                                */
+    int32_t  reg;               /* index into target->regs, -1: none             */
+} RaInterval;
+
+typedef struct RegAlloc {
+    const RaTarget *target;
+    uint32_t        n_regs;         /* of target->regs, the first n_regs are used */
+    uint32_t        n_temps;
+    RaInterval     *iv;             /* per temporary                              */
+    uint32_t        n_words;        /* bitset size in 64-bit words                */
+    uint64_t       *entry_live;     /* read before written: start at 0            */
+    uint64_t       *label_live;     /* per label, live on entry: n_words each     */
+    uint32_t       *label_pos;      /* per label, its instruction, RA_NEVER: none */
+    uint32_t        n_labels;
+    uint32_t        n_slots;        /* spill slots after reuse                    */
+    uint32_t        used;           /* bit r: target->regs[r] is handed out       */
+
+    /* Statistics */
+    uint32_t        n_intervals;    /* temporaries that are ever live             */
+    uint32_t        max_live;       /* most intervals overlapping one position    */
+    uint32_t        n_spilled;      /* in a slot all their life                   */
+    uint32_t        n_split;        /* in a register, then a slot                 */
+    uint32_t        n_callee_saved; /* of the registers used                      */
+    uint32_t        n_reloads;      /* jumps × registers reloaded on them         */
+    uint32_t        mem_reads;      /* static slot accesses by the allocated code */
+    uint32_t        mem_writes;     /*   (reloads count as reads)                 */
+    uint32_t        base_reads;     /* ... and with every temporary in memory     */
+    uint32_t        base_writes;
+    uint32_t        sweeps;         /* liveness iterations                        */
+    double          ms_liveness;    /* CFG, dataflow and intervals                */
+    double          ms_scan;
+} RegAlloc;
+
+/* Allocate p's temporaries for arch with at most max_regs registers
+ * (0: all of them).  0 on success, -1 on OOM or if arch has no back end. */
+int  ra_allocate(RegAlloc *ra, const TacProgram *p, JitArch arch, uint32_t max_regs);
+void ra_free(RegAlloc *ra);
+
+/* The hardware register holding temporary t at position pos, or -1 if
+ * it is in its slot (or nowhere) there */
+static inline int ra_reg_at(const RegAlloc *ra, uint32_t t, uint32_t pos)
+{
+    const RaInterval *iv = &ra->iv[t];
+    return iv->reg >= 0 && pos < iv->split ? ra->target->regs[iv->reg].hw : -1;
+}
+
+/* The first temporary ≥ t that the jump at instruction i to label must
+ * reload into its register, or RA_NEVER */
+uint32_t ra_next_reload(const RegAlloc *ra, uint32_t i, uint32_t label, uint32_t t);
+
+/* Intervals, one line each, and the summary */
+void print_ra(const RegAlloc *ra);
+void print_ra_stats(const RegAlloc *ra);
+
+#endif /* REGALLOC_H */
@@ -2,12 +2,27 @@
  * ║  Chapter 24 — Assembler & ELF Object Files                      ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: .s→.o, ELF format, sections, symbols, relocations     ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Sections 3 to 6 read this program's own file, /proc/self/exe, with
+ * the zero-copy reader in elf_reader.c instead of asking for readelf,
+ * nm and objdump, and check every symbol they find against the
+ * address the running program actually uses.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/24_assembler_elf \
+ *            src/24_assembler_elf/assembler_elf.c src/24_assembler_elf/elf_reader.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/auxv.h>
+
+#include "bench.h"
+#include "elf_reader.h"
 
 /* ── Data items placed into various ELF sections ─────────────── */
 
@@ -29,6 +44,61 @@ char        bss_buf[256];       /* zero-filled at load */
 static int helper_func(int x) { return x * 2; }  /* LOCAL in .text */
 int         public_func(int x) { return x + 1; }  /* GLOBAL in .text */
 
+/* ── This program's own ELF file ─────────────────────────────── */
+
+static ElfFile   self;
+static int       have_self;
+static uintptr_t load_bias;     /* runtime address − link-time address */
+
+/* Where the kernel put our program headers, minus where PT_PHDR says
+ * they were linked: 0 for a fixed-address executable, the ASLR slide
+ * for a PIE */
+static uintptr_t find_load_bias(const ElfFile *f)
+{
+    for (uint32_t i = 0; i < f->n_ph; i++)
+        if (f->ph[i].p_type == PT_PHDR)
+            return (uintptr_t)getauxval(AT_PHDR) - (uintptr_t)f->ph[i].p_vaddr;
+    return 0;
+}
+
+static int no_self(void)
+{
+    if (!have_self) printf("  (/proc/self/exe could not be read; skipping the live part)\n\n");
+    return !have_self;
+}
+
+/* The symbols the demos look up, with the address the compiler uses for
+ * each — taking it also keeps the static ones from being optimised away */
+static const struct {
+    const char *name;
+    const void *addr;
+    const char *decl;
+} our_syms[] = {
+    { "ro_string",   ro_string,            "const char ro_string[] = \"Hello\";" },
+    { "ro_table",    ro_table,             "const int  ro_table[4] = {1,2,3,4};" },
+    { "rw_int",      &rw_int,              "int        rw_int = 42;" },
+    { "rw_static",   &rw_static,           "static int rw_static = 99;" },
+    { "bss_int",     &bss_int,             "int        bss_int;" },
+    { "bss_static",  &bss_static,          "static int bss_static;" },
+    { "bss_buf",     bss_buf,              "char       bss_buf[256];" },
+    { "public_func", (const void *)(uintptr_t)public_func, "int public_func(int x) {...}" },
+    { "helper_func", (const void *)(uintptr_t)helper_func, "static int helper_func(int x) {...}" },
+};
+#define N_OUR_SYMS (sizeof(our_syms) / sizeof(our_syms[0]))
+
+/* The letter nm prints for a symbol */
+static char nm_letter(const ElfFile *f, const Elf64_Sym *s)
+{
+    if (s->st_shndx == SHN_UNDEF) return ELF64_ST_BIND(s->st_info) == STB_WEAK ? 'w' : 'U';
+    const Elf64_Shdr *sec = elf_section(f, s->st_shndx);
+    char c = !sec                             ? 'A'
+           : (sec->sh_flags & SHF_EXECINSTR)  ? 'T'
+           : sec->sh_type == SHT_NOBITS       ? 'B'
+           : !(sec->sh_flags & SHF_WRITE)     ? 'R'
+                                              : 'D';
+    return ELF64_ST_BIND(s->st_info) == STB_LOCAL ? (char)(c - 'A' + 'a') : c;
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — What the Assembler Does
  * ════════════════════════════════════════════════════════════════════ */
@@ -123,24 +193,35 @@ static void demo_elf_sections(void)
     printf("  │ .note.*     │ Build metadata (GNU build-id)            │\n");
     printf("  └─────────────┴──────────────────────────────────────────┘\n\n");
 
-    printf("Demo — which section does each go into?\n\n");
-
-    printf("  const char ro_string[] = \"Hello\";    → .rodata\n");
-    printf("  const int  ro_table[4] = {1,2,3,4};  → .rodata\n");
-    printf("  int        rw_int = 42;              → .data\n");
-    printf("  static int rw_static = 99;           → .data  (LOCAL sym)\n");
-    printf("  int        bss_int;                  → .bss   (GLOBAL)\n");
-    printf("  static int bss_static;               → .bss   (LOCAL)\n");
-    printf("  char       bss_buf[256];             → .bss   (256 bytes)\n");
-    printf("  int public_func(int x) {...}         → .text  (GLOBAL)\n");
-    printf("  static int helper_func(int x) {...}  → .text  (LOCAL)\n\n");
-
     /* Use the variables so they aren't optimised away */
     printf("  Values: ro_string=\"%s\", rw_int=%d, rw_static=%d\n",
            ro_string, rw_int, rw_static);
     printf("          bss_int=%d, bss_static=%d\n", bss_int, bss_static);
     printf("          helper_func(5)=%d, public_func(5)=%d\n\n",
            helper_func(5), public_func(5));
+
+    if (no_self()) return;
+
+    printf("The sections of this program, read from /proc/self/exe\n");
+    printf("(the linker has merged the .o files' sections; .rela.text\n");
+    printf("is gone, .rela.dyn and .rela.plt are the loader's):\n\n");
+    print_elf_sections(&self);
+    printf("    flags: A alloc, W write, X exec, M merge, S strings, I info link, T TLS\n\n");
+
+    printf("Demo — which section did each go into?  Looked up by name,\n");
+    printf("then checked: load bias + st_value must be the address the\n");
+    printf("code itself uses (load bias here: %#lx).\n\n", (unsigned long)load_bias);
+
+    int bad = 0;
+    for (size_t i = 0; i < N_OUR_SYMS; i++) {
+        const Elf64_Sym  *s   = elf_lookup(&self, our_syms[i].name, NULL);
+        const Elf64_Shdr *sec = s ? elf_section(&self, s->st_shndx) : NULL;
+        int ok = s && (uintptr_t)our_syms[i].addr == load_bias + s->st_value;
+        bad += !ok;
+        printf("  %-38s → %-8s %-7s %s\n", our_syms[i].decl, sec ? elf_section_name(&self, sec) : "?",
+               s ? elf_bind_name(ELF64_ST_BIND(s->st_info)) : "missing", ok ? "address ok" : "MISMATCH");
+    }
+    printf("\n  %zu symbols, %d address mismatches\n\n", N_OUR_SYMS, bad);
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -168,21 +249,49 @@ static void demo_symbol_table(void)
     printf("  │ SHN_UNDEF     │ Undefined (need linker to resolve)  │\n");
     printf("  └───────────────┴──────────────────────────────────────┘\n\n");
 
-    printf("  Expected nm output for this file:\n");
-    printf("    0000...  T main              (GLOBAL, .text)\n");
-    printf("    0000...  T public_func       (GLOBAL, .text)\n");
-    printf("    0000...  t helper_func       (LOCAL,  .text)\n");
-    printf("    0000...  D rw_int            (GLOBAL, .data)\n");
-    printf("    0000...  d rw_static         (LOCAL,  .data)\n");
-    printf("    0000...  R ro_string         (GLOBAL, .rodata)\n");
-    printf("    0000...  B bss_int           (GLOBAL, .bss)\n");
-    printf("    0000...  b bss_static        (LOCAL,  .bss)\n");
-    printf("             U printf            (UNDEFINED — external)\n\n");
-
     printf("  nm symbol codes:\n");
     printf("    T/t = .text,  D/d = .data,  B/b = .bss\n");
     printf("    R/r = .rodata,  U = undefined (external)\n");
     printf("    Uppercase = GLOBAL,  lowercase = LOCAL\n\n");
+
+    if (no_self()) return;
+
+    const ElfSymtab *st = elf_symtab(&self, ELF_SYMTAB), *dyn = elf_symtab(&self, ELF_DYNSYM);
+    printf("  This program has %u .symtab and %u .dynsym entries.\n", st->count, dyn->count);
+    printf("  nm's view of ours, from elf_lookup() (a hash index over both\n");
+    printf("  tables, built on the first call):\n\n");
+
+    static const char *names[] = { "main", "public_func", "helper_func", "rw_int", "rw_static",
+                                   "ro_string", "bss_int", "bss_static", "printf" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        ElfSymKind       kind;
+        const Elf64_Sym *s = elf_lookup(&self, names[i], &kind);
+        if (!s) {
+            printf("    %16s    %-14s (not found)\n", "", names[i]);
+            continue;
+        }
+        const Elf64_Shdr *sec = elf_section(&self, s->st_shndx);
+        if (s->st_shndx == SHN_UNDEF)
+            printf("    %16s  %c %-14s (UNDEFINED in %s — resolved at load time)\n", "",
+                   nm_letter(&self, s), names[i], kind == ELF_DYNSYM ? ".dynsym" : ".symtab");
+        else
+            printf("    %016llx  %c %-14s (%s, %s, %llu bytes)\n", (unsigned long long)s->st_value,
+                   nm_letter(&self, s), names[i], elf_bind_name(ELF64_ST_BIND(s->st_info)),
+                   sec ? elf_section_name(&self, sec) : "?", (unsigned long long)s->st_size);
+    }
+
+    /* The other direction: an address inside a function or array */
+    printf("\n  And by address, with elf_symbol_at() (symbols sorted by value):\n\n");
+    const void *probes[] = { (const void *)((uintptr_t)public_func + 1), &ro_table[2], &bss_buf[100] };
+    for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        uint64_t         addr = (uint64_t)((uintptr_t)probes[i] - load_bias);
+        ElfSymKind       kind;
+        const Elf64_Sym *s    = elf_symbol_at(&self, addr, &kind);
+        printf("    %#llx  →  %s+%llu\n", (unsigned long long)addr,
+               s ? elf_sym_name(elf_symtab(&self, kind), s) : "?",
+               s ? (unsigned long long)(addr - s->st_value) : 0ull);
+    }
+    printf("\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -212,49 +321,101 @@ static void demo_relocations(void)
     printf("  │ R_X86_64_64          │ Absolute 64-bit address      │\n");
     printf("  └──────────────────────┴──────────────────────────────┘\n\n");
 
-    printf("  Example relocation (from objdump -r):\n");
-    printf("    OFFSET           TYPE               VALUE\n");
+    printf("  In a .o, objdump -r shows e.g.\n");
     printf("    000000000042     R_X86_64_PLT32     printf-0x4\n\n");
 
     printf("  The linker resolves these in the final step.\n\n");
+
+    if (no_self()) return;
+
+    printf("  What it could not resolve is left for the dynamic loader.\n");
+    printf("  This program's own (RELATIVE: the PIE slide; GLOB_DAT and\n");
+    printf("  JUMP_SLOT: a GOT entry for a libc symbol such as printf):\n\n");
+    int any = 0;
+    for (uint32_t i = 1; i < self.n_sh; i++) {
+        const Elf64_Shdr *s = elf_section(&self, i);
+        if (s->sh_type != SHT_RELA && s->sh_type != SHT_REL) continue;
+        print_elf_relocs(&self, s, 8);
+        printf("\n");
+        any = 1;
+    }
+    if (!any) printf("    (none — a static, fixed-address executable)\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
  *  Section 6 — Examining Object Files
  * ════════════════════════════════════════════════════════════════════ */
+
+/* What a query costs without an index: a walk of the whole table */
+static const Elf64_Sym *scan_by_name(const ElfSymtab *t, const char *name)
+{
+    for (uint32_t i = 1; i < t->count; i++)
+        if (strcmp(elf_sym_name(t, &t->sym[i]), name) == 0) return &t->sym[i];
+    return NULL;
+}
+
 static void demo_tools(void)
 {
     printf("\n╔══════════════════════════════════════════════════════════╗\n");
     printf("║  Section 6 — Examining Object Files                     ║\n");
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
-    printf("╔══════════════════════════════════════════════════════════╗\n");
-    printf("║  Compile to object file:                                ║\n");
-    printf("║  gcc -c assembler_elf.c -o assembler_elf.o              ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View ELF header:                                       ║\n");
-    printf("║  readelf -h assembler_elf.o                             ║\n");
-    printf("║                                                         ║\n");
-    printf("║  List sections:                                         ║\n");
-    printf("║  readelf -S assembler_elf.o                             ║\n");
-    printf("║                                                         ║\n");
-    printf("║  List symbols:                                          ║\n");
-    printf("║  readelf -s assembler_elf.o                             ║\n");
-    printf("║  nm assembler_elf.o                                     ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View relocations:                                      ║\n");
-    printf("║  readelf -r assembler_elf.o                             ║\n");
-    printf("║  objdump -r assembler_elf.o                             ║\n");
-    printf("║                                                         ║\n");
-    printf("║  Disassemble:                                           ║\n");
-    printf("║  objdump -d -M intel assembler_elf.o                    ║\n");
-    printf("║                                                         ║\n");
-    printf("║  Hex dump of .rodata:                                   ║\n");
-    printf("║  objdump -s -j .rodata assembler_elf.o                  ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View raw hex:                                          ║\n");
-    printf("║  hexdump -C assembler_elf.o | head -20                  ║\n");
-    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+    printf("  The binutils commands and what answers them in-process:\n\n");
+    printf("  ┌──────────────────────┬───────────────────────────────────┐\n");
+    printf("  │ Command              │ elf_reader.h                      │\n");
+    printf("  ├──────────────────────┼───────────────────────────────────┤\n");
+    printf("  │ readelf -h           │ print_elf_header()                │\n");
+    printf("  │ readelf -l           │ print_elf_segments()              │\n");
+    printf("  │ readelf -S           │ print_elf_sections()              │\n");
+    printf("  │ readelf -s / nm      │ print_elf_symbols(), elf_lookup() │\n");
+    printf("  │ readelf -r           │ print_elf_relocs()                │\n");
+    printf("  │ readelf -d           │ print_elf_dynamic()               │\n");
+    printf("  │ objdump -s -j <sec>  │ elf_section_data(), elf_vaddr()   │\n");
+    printf("  │ addr2line-style      │ elf_symbol_at(), elf_section_at() │\n");
+    printf("  └──────────────────────┴───────────────────────────────────┘\n\n");
+
+    printf("  elf_open() reads a .o the same way; disassembly is still\n");
+    printf("  objdump's job:\n");
+    printf("    gcc -c assembler_elf.c -o assembler_elf.o\n");
+    printf("    objdump -d -M intel assembler_elf.o     (disassembly)\n\n");
+
+    if (no_self()) return;
+
+    printf("  readelf -h, from the mapping:\n");
+    print_elf_header(&self);
+
+    /* objdump -s: the file bytes behind a runtime address */
+    const char *file_copy = elf_vaddr(&self, (uintptr_t)ro_string - load_bias, sizeof(ro_string));
+    printf("\n  ro_string's bytes in the file: \"%s\" (%s the copy in memory)\n\n",
+           file_copy ? file_copy : "?",
+           file_copy && memcmp(file_copy, ro_string, sizeof(ro_string)) == 0 ? "equal to" : "NOT");
+
+    /* What spawning a tool per query would replace */
+    ElfFile  f;
+    uint64_t t0 = bench_now_ns();
+    if (elf_open(&f, "/proc/self/exe") != 0) return;
+    uint64_t t1 = bench_now_ns();
+    elf_index(&f);
+    uint64_t t2 = bench_now_ns();
+
+    enum { LOOKUPS = 200000 };
+    const ElfSymtab *st   = elf_symtab(&f, ELF_SYMTAB);
+    uintptr_t        sink = 0;
+    uint64_t t3 = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) sink += (uintptr_t)elf_lookup(&f, our_syms[i % N_OUR_SYMS].name, NULL);
+    uint64_t t4 = bench_now_ns();
+    for (int i = 0; i < LOOKUPS; i++) sink += (uintptr_t)scan_by_name(st, our_syms[i % N_OUR_SYMS].name);
+    uint64_t t5 = bench_now_ns();
+    uint32_t n_syms = st->count;
+    elf_close(&f);
+
+    printf("  Cost on this %zu-byte file (%u symbols):\n", self.size, n_syms);
+    printf("    elf_open (mmap + checks)   %8.1f us\n", (double)(t1 - t0) / 1e3);
+    printf("    elf_index (all three)      %8.1f us\n", (double)(t2 - t1) / 1e3);
+    printf("    elf_lookup, indexed        %8.1f ns/lookup\n", (double)(t4 - t3) / LOOKUPS);
+    printf("    linear .symtab scan        %8.1f ns/lookup\n", (double)(t5 - t4) / LOOKUPS);
+    printf("  (a fork+exec of readelf alone costs around a millisecond)\n\n");
+    if (sink == 1) printf("\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -294,6 +455,9 @@ int main(void)
     printf("║  Modular-C-Demos                                            ║\n");
     printf("╚══════════════════════════════════════════════════════════════╝\n");
 
+    have_self = elf_open(&self, "/proc/self/exe") == 0;
+    if (have_self) load_bias = find_load_bias(&self);
+
     demo_assembler();
     demo_elf_format();
     demo_elf_sections();
@@ -301,6 +465,7 @@ int main(void)
     demo_relocations();
     demo_tools();
     demo_section_flags();
+    elf_close(&self);
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 24 — Assembler & ELF Object Files\n");
@@ -0,0 +1,707 @@
+/*
+ * Chapter 24 — A zero-copy ELF reader
+ *
+ * See elf_reader.h.  Validation happens once, in elf_open_mem(); every
+ * accessor after it trusts the offsets it checked and re-checks only
+ * what a table entry can point at (a name offset, a section's bytes).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "elf_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ENTRY(kind, i)  ((uint32_t)(kind) << 31 | (uint32_t)(i))
+#define ENTRY_KIND(e)   ((ElfSymKind)((e) >> 31))
+#define ENTRY_INDEX(e)  ((e) & 0x7fffffffu)
+#define EMPTY           UINT32_MAX
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_DATA ELFDATA2MSB
+#else
+#define HOST_DATA ELFDATA2LSB
+#endif
+
+/* [off, off + len) inside the file, without overflowing */
+static int in_file(const ElfFile *f, uint64_t off, uint64_t len)
+{
+    return off <= f->size && len <= f->size - off;
+}
+
+/* A table of n entries of size bytes at off, in the file and aligned */
+static int table_ok(const ElfFile *f, uint64_t off, uint64_t n, uint64_t size)
+{
+    return off % 8 == 0 && n <= f->size / size && in_file(f, off, n * size);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Opening
+ * ════════════════════════════════════════════════════════════════ */
+
+static void find_symtab(ElfFile *f, ElfSymKind kind, uint32_t sh_type)
+{
+    for (uint32_t i = 1; i < f->n_sh; i++) {
+        const Elf64_Shdr *s = &f->sh[i];
+        if (s->sh_type != sh_type || s->sh_entsize != sizeof(Elf64_Sym)) continue;
+        if (!table_ok(f, s->sh_offset, s->sh_size / sizeof(Elf64_Sym), sizeof(Elf64_Sym)) ||
+            s->sh_link == 0 || s->sh_link >= f->n_sh)
+            return;
+        const Elf64_Shdr *str = &f->sh[s->sh_link];
+        if (!in_file(f, str->sh_offset, str->sh_size)) return;
+        ElfSymtab *t = &f->tabs[kind];
+        t->sym      = (const Elf64_Sym *)(const void *)(f->base + s->sh_offset);
+        t->count    = (uint32_t)(s->sh_size / sizeof(Elf64_Sym));
+        t->str      = (const char *)f->base + str->sh_offset;
+        t->str_size = str->sh_size;
+        t->sec      = s;
+        return;
+    }
+}
+
+/* .dynamic by section (sh_link names its strings) or, if the section
+ * headers were stripped, by segment with .dynsym's strings */
+static void find_dynamic(ElfFile *f)
+{
+    uint64_t off = 0, size = 0;
+    for (uint32_t i = 1; i < f->n_sh && !size; i++) {
+        const Elf64_Shdr *s = &f->sh[i];
+        if (s->sh_type != SHT_DYNAMIC) continue;
+        off  = s->sh_offset;
+        size = s->sh_size;
+        if (s->sh_link && s->sh_link < f->n_sh && in_file(f, f->sh[s->sh_link].sh_offset,
+                                                          f->sh[s->sh_link].sh_size)) {
+            f->dynstr      = (const char *)f->base + f->sh[s->sh_link].sh_offset;
+            f->dynstr_size = f->sh[s->sh_link].sh_size;
+        }
+    }
+    for (uint32_t i = 0; i < f->n_ph && !size; i++)
+        if (f->ph[i].p_type == PT_DYNAMIC) {
+            off  = f->ph[i].p_offset;
+            size = f->ph[i].p_filesz;
+        }
+    if (!size || !table_ok(f, off, size / sizeof(Elf64_Dyn), sizeof(Elf64_Dyn))) return;
+    f->dyn   = (const Elf64_Dyn *)(const void *)(f->base + off);
+    f->n_dyn = (uint32_t)(size / sizeof(Elf64_Dyn));
+    for (uint32_t i = 0; i < f->n_dyn; i++)
+        if (f->dyn[i].d_tag == DT_NULL) f->n_dyn = i;
+    if (!f->dynstr && f->tabs[ELF_DYNSYM].count) {
+        f->dynstr      = f->tabs[ELF_DYNSYM].str;
+        f->dynstr_size = f->tabs[ELF_DYNSYM].str_size;
+    }
+}
+
+int elf_open_mem(ElfFile *f, const void *data, size_t size)
+{
+    memset(f, 0, sizeof(*f));
+    f->base = data;
+    f->size = size;
+
+    const Elf64_Ehdr *eh = data;
+    if ((uintptr_t)data % 8 != 0 || size < sizeof(*eh) ||
+        memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+        eh->e_ident[EI_DATA] != HOST_DATA || eh->e_ident[EI_VERSION] != EV_CURRENT)
+        goto bad;
+    f->eh = eh;
+
+    /* Section headers: counts past 0xff00 live in section 0 */
+    if (eh->e_shoff) {
+        if (eh->e_shentsize != sizeof(Elf64_Shdr) || !table_ok(f, eh->e_shoff, 1, sizeof(Elf64_Shdr)))
+            goto bad;
+        f->sh = (const Elf64_Shdr *)(const void *)(f->base + eh->e_shoff);
+        uint64_t n = eh->e_shnum ? eh->e_shnum : f->sh[0].sh_size;
+        if (n > UINT32_MAX || !table_ok(f, eh->e_shoff, n, sizeof(Elf64_Shdr))) goto bad;
+        f->n_sh = (uint32_t)n;
+        uint32_t str = eh->e_shstrndx == SHN_XINDEX ? f->sh[0].sh_link : eh->e_shstrndx;
+        if (str != SHN_UNDEF && str < f->n_sh && in_file(f, f->sh[str].sh_offset, f->sh[str].sh_size)) {
+            f->shstr      = (const char *)f->base + f->sh[str].sh_offset;
+            f->shstr_size = f->sh[str].sh_size;
+        }
+    }
+
+    if (eh->e_phoff && eh->e_phnum) {
+        uint64_t n = eh->e_phnum == PN_XNUM && f->n_sh ? f->sh[0].sh_info : eh->e_phnum;
+        if (eh->e_phentsize != sizeof(Elf64_Phdr) || !table_ok(f, eh->e_phoff, n, sizeof(Elf64_Phdr)))
+            goto bad;
+        f->ph   = (const Elf64_Phdr *)(const void *)(f->base + eh->e_phoff);
+        f->n_ph = (uint32_t)n;
+    }
+
+    find_symtab(f, ELF_SYMTAB, SHT_SYMTAB);
+    find_symtab(f, ELF_DYNSYM, SHT_DYNSYM);
+    find_dynamic(f);
+    return 0;
+
+bad:
+    memset(f, 0, sizeof(*f));
+    errno = ENOEXEC;
+    return -1;
+}
+
+int elf_open(ElfFile *f, const char *path)
+{
+    memset(f, 0, sizeof(*f));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    if (st.st_size < (off_t)sizeof(Elf64_Ehdr)) {
+        close(fd);
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd);                      /* the mapping keeps the file alive */
+    if (p == MAP_FAILED) {
+        errno = saved;
+        return -1;
+    }
+    if (elf_open_mem(f, p, (size_t)st.st_size) != 0) {
+        munmap(p, (size_t)st.st_size);
+        errno = ENOEXEC;
+        return -1;
+    }
+    f->mapped = 1;
+    return 0;
+}
+
+void elf_close(ElfFile *f)
+{
+    free(f->name_index);
+    free(f->addr_index);
+    free(f->sec_index);
+    if (f->mapped) munmap((void *)f->base, f->size);
+    memset(f, 0, sizeof(*f));
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Sections and segments
+ * ════════════════════════════════════════════════════════════════ */
+
+const Elf64_Shdr *elf_section(const ElfFile *f, uint32_t i)
+{
+    return i < f->n_sh ? &f->sh[i] : NULL;
+}
+
+static const char *str_at(const char *tab, uint64_t size, uint64_t off)
+{
+    if (!tab || off >= size || !memchr(tab + off, '\0', size - off)) return "";
+    return tab + off;
+}
+
+const char *elf_section_name(const ElfFile *f, const Elf64_Shdr *s)
+{
+    return str_at(f->shstr, f->shstr_size, s->sh_name);
+}
+
+/* Sections number in the tens: no index */
+const Elf64_Shdr *elf_section_by_name(const ElfFile *f, const char *name)
+{
+    for (uint32_t i = 1; i < f->n_sh; i++)
+        if (strcmp(elf_section_name(f, &f->sh[i]), name) == 0) return &f->sh[i];
+    return NULL;
+}
+
+const void *elf_section_data(const ElfFile *f, const Elf64_Shdr *s)
+{
+    if (s->sh_type == SHT_NOBITS || !in_file(f, s->sh_offset, s->sh_size)) return NULL;
+    return f->base + s->sh_offset;
+}
+
+const void *elf_segment_data(const ElfFile *f, const Elf64_Phdr *p)
+{
+    return in_file(f, p->p_offset, p->p_filesz) ? f->base + p->p_offset : NULL;
+}
+
+const void *elf_vaddr(const ElfFile *f, uint64_t addr, uint64_t size)
+{
+    for (uint32_t i = 0; i < f->n_ph; i++) {
+        const Elf64_Phdr *p = &f->ph[i];
+        if (p->p_type != PT_LOAD || addr < p->p_vaddr || addr - p->p_vaddr > p->p_filesz ||
+            size > p->p_filesz - (addr - p->p_vaddr))
+            continue;
+        uint64_t off = p->p_offset + (addr - p->p_vaddr);
+        return in_file(f, off, size) ? f->base + off : NULL;
+    }
+    return NULL;
+}
+
+const char *elf_interp(const ElfFile *f)
+{
+    for (uint32_t i = 0; i < f->n_ph; i++) {
+        const Elf64_Phdr *p = &f->ph[i];
+        if (p->p_type != PT_INTERP || !p->p_filesz) continue;
+        const char *s = elf_segment_data(f, p);
+        return s && memchr(s, '\0', p->p_filesz) ? s : NULL;
+    }
+    return NULL;
+}
+
+/* ── Section by address ───────────────────────────────────────── */
+
+static const ElfFile *sort_file;        /* qsort() has no context argument */
+
+static int cmp_sec_addr(const void *a, const void *b)
+{
+    uint64_t x = sort_file->sh[*(const uint32_t *)a].sh_addr;
+    uint64_t y = sort_file->sh[*(const uint32_t *)b].sh_addr;
+    return (x > y) - (x < y);
+}
+
+/* Allocated, non-empty sections, except .tbss: its addresses are a TLS
+ * template's and overlap the sections after it */
+static int build_sec_index(ElfFile *f)
+{
+    if (f->sec_index || f->n_sh == 0) return 0;
+    uint32_t *idx = malloc(f->n_sh * sizeof(uint32_t)), n = 0;
+    if (!idx) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (uint32_t i = 1; i < f->n_sh; i++) {
+        const Elf64_Shdr *s = &f->sh[i];
+        if ((s->sh_flags & SHF_ALLOC) && s->sh_size &&
+            !((s->sh_flags & SHF_TLS) && s->sh_type == SHT_NOBITS))
+            idx[n++] = i;
+    }
+    sort_file = f;
+    qsort(idx, n, sizeof(uint32_t), cmp_sec_addr);
+    f->sec_index   = idx;
+    f->n_sec_index = n;
+    return 0;
+}
+
+const Elf64_Shdr *elf_section_at(ElfFile *f, uint64_t addr)
+{
+    if (build_sec_index(f) != 0) return NULL;
+    uint32_t lo = 0, hi = f->n_sec_index;         /* first with sh_addr > addr */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (f->sh[f->sec_index[mid]].sh_addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+    const Elf64_Shdr *s = &f->sh[f->sec_index[lo - 1]];
+    return addr - s->sh_addr < s->sh_size ? s : NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Symbols
+ * ════════════════════════════════════════════════════════════════ */
+
+const ElfSymtab *elf_symtab(const ElfFile *f, ElfSymKind kind)
+{
+    return &f->tabs[kind];
+}
+
+const char *elf_sym_name(const ElfSymtab *t, const Elf64_Sym *s)
+{
+    return str_at(t->str, t->str_size, s->st_name);
+}
+
+static const Elf64_Sym *entry_sym(const ElfFile *f, uint32_t e)
+{
+    return &f->tabs[ENTRY_KIND(e)].sym[ENTRY_INDEX(e)];
+}
+
+static const char *entry_name(const ElfFile *f, uint32_t e)
+{
+    return elf_sym_name(&f->tabs[ENTRY_KIND(e)], entry_sym(f, e));
+}
+
+/* The hash DT_GNU_HASH uses (Bernstein's h * 33 + c) */
+static uint32_t name_hash(const char *s)
+{
+    uint32_t h = 5381;
+    for (; *s; s++) h = h * 33 + (uint8_t)*s;
+    return h;
+}
+
+/* Which of two same-named symbols elf_lookup() answers with */
+static int rank(const Elf64_Sym *s)
+{
+    if (s->st_shndx == SHN_UNDEF) return 0;
+    switch (ELF64_ST_BIND(s->st_info)) {
+    case STB_GLOBAL: return 3;
+    case STB_WEAK:   return 2;
+    default:         return 1;
+    }
+}
+
+static int skip_for_names(const Elf64_Sym *s)
+{
+    unsigned type = ELF64_ST_TYPE(s->st_info);
+    return s->st_name == 0 || type == STT_SECTION || type == STT_FILE;
+}
+
+static int build_name_index(ElfFile *f)
+{
+    if (f->name_index) return 0;
+    uint64_t n = 0;
+    for (int k = 0; k < ELF_SYMTAB_COUNT; k++) n += f->tabs[k].count;
+    uint32_t cap = 16;
+    while (cap < 2 * n) cap *= 2;
+    uint32_t *idx = malloc(cap * sizeof(uint32_t));
+    if (!idx) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(idx, 0xff, cap * sizeof(uint32_t));
+
+    for (int k = 0; k < ELF_SYMTAB_COUNT; k++) {
+        const ElfSymtab *t = &f->tabs[k];
+        for (uint32_t i = 1; i < t->count; i++) {
+            if (skip_for_names(&t->sym[i])) continue;
+            const char *name = elf_sym_name(t, &t->sym[i]);
+            uint32_t    h    = name_hash(name) & (cap - 1);
+            while (idx[h] != EMPTY && strcmp(entry_name(f, idx[h]), name) != 0) h = (h + 1) & (cap - 1);
+            if (idx[h] == EMPTY || rank(&t->sym[i]) > rank(entry_sym(f, idx[h])))
+                idx[h] = ENTRY(k, i);
+        }
+    }
+    f->name_index = idx;
+    f->name_mask  = cap - 1;
+    return 0;
+}
+
+const Elf64_Sym *elf_lookup(ElfFile *f, const char *name, ElfSymKind *kind)
+{
+    if (build_name_index(f) != 0) return NULL;
+    for (uint32_t h = name_hash(name) & f->name_mask; f->name_index[h] != EMPTY; h = (h + 1) & f->name_mask) {
+        uint32_t e = f->name_index[h];
+        if (strcmp(entry_name(f, e), name) == 0) {
+            if (kind) *kind = ENTRY_KIND(e);
+            return entry_sym(f, e);
+        }
+    }
+    return NULL;
+}
+
+/* ── Symbol by address ────────────────────────────────────────── */
+
+static int cmp_sym_value(const void *a, const void *b)
+{
+    const Elf64_Sym *x = entry_sym(sort_file, *(const uint32_t *)a);
+    const Elf64_Sym *y = entry_sym(sort_file, *(const uint32_t *)b);
+    if (x->st_value != y->st_value) return (x->st_value > y->st_value) - (x->st_value < y->st_value);
+    return (rank(x) < rank(y)) - (rank(x) > rank(y));      /* globals first */
+}
+
+static int build_addr_index(ElfFile *f)
+{
+    if (f->addr_index) return 0;
+    ElfSymKind       k = f->tabs[ELF_SYMTAB].count ? ELF_SYMTAB : ELF_DYNSYM;
+    const ElfSymtab *t = &f->tabs[k];
+    uint32_t *idx = malloc((t->count + 1) * sizeof(uint32_t)), n = 0;
+    if (!idx) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (uint32_t i = 1; i < t->count; i++) {
+        unsigned type = ELF64_ST_TYPE(t->sym[i].st_info);
+        if (t->sym[i].st_shndx != SHN_UNDEF && t->sym[i].st_shndx != SHN_ABS &&
+            (type == STT_FUNC || type == STT_OBJECT || type == STT_NOTYPE || type == STT_GNU_IFUNC))
+            idx[n++] = ENTRY(k, i);
+    }
+    sort_file = f;
+    qsort(idx, n, sizeof(uint32_t), cmp_sym_value);
+    f->addr_index = idx;
+    f->n_addr     = n;
+    return 0;
+}
+
+const Elf64_Sym *elf_symbol_at(ElfFile *f, uint64_t addr, ElfSymKind *kind)
+{
+    if (build_addr_index(f) != 0) return NULL;
+    uint32_t lo = 0, hi = f->n_addr;               /* first with st_value > addr */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (entry_sym(f, f->addr_index[mid])->st_value <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    /* Among the symbols at that value (globals sorted first), the first
+     * that covers addr; a size-0 label covers only itself */
+    uint64_t value = lo ? entry_sym(f, f->addr_index[lo - 1])->st_value : 0;
+    uint32_t i     = lo;
+    while (i > 0 && entry_sym(f, f->addr_index[i - 1])->st_value == value) i--;
+    for (; i < lo; i++) {
+        const Elf64_Sym *s = entry_sym(f, f->addr_index[i]);
+        if (addr - s->st_value < s->st_size || (s->st_size == 0 && addr == s->st_value)) {
+            if (kind) *kind = ENTRY_KIND(f->addr_index[i]);
+            return s;
+        }
+    }
+    return NULL;
+}
+
+int elf_index(ElfFile *f)
+{
+    return build_name_index(f) || build_addr_index(f) || build_sec_index(f) ? -1 : 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Relocations and the dynamic section
+ * ════════════════════════════════════════════════════════════════ */
+
+int elf_relocs(const ElfFile *f, const Elf64_Shdr *s, ElfRelocs *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (s->sh_type != SHT_RELA && s->sh_type != SHT_REL) return -1;
+    out->rela    = s->sh_type == SHT_RELA;
+    out->entsize = out->rela ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+    out->sec     = s;
+    out->data    = elf_section_data(f, s);
+    out->count   = out->data && s->sh_entsize == out->entsize ? s->sh_size / out->entsize : 0;
+    out->target  = s->sh_info && s->sh_info < f->n_sh ? &f->sh[s->sh_info] : NULL;
+    for (int k = 0; k < ELF_SYMTAB_COUNT; k++)
+        if (f->tabs[k].sec && f->tabs[k].sec == elf_section(f, s->sh_link)) out->symbols = &f->tabs[k];
+    return 0;
+}
+
+/* Decoded through memcpy: REL/RELA entries carry no alignment promise */
+void elf_reloc(const ElfRelocs *r, uint64_t i, ElfReloc *out)
+{
+    Elf64_Rela e = { 0, 0, 0 };
+    memcpy(&e, r->data + i * r->entsize, (size_t)r->entsize);
+    out->offset = e.r_offset;
+    out->type   = (uint32_t)ELF64_R_TYPE(e.r_info);
+    out->sym    = (uint32_t)ELF64_R_SYM(e.r_info);
+    out->addend = r->rela ? e.r_addend : 0;
+    if (r->symbols && out->sym >= r->symbols->count) out->sym = 0;
+}
+
+const Elf64_Dyn *elf_dynamic(const ElfFile *f, uint32_t *count)
+{
+    if (count) *count = f->n_dyn;
+    return f->dyn;
+}
+
+const char *elf_dyn_str(const ElfFile *f, uint64_t offset)
+{
+    return str_at(f->dynstr, f->dynstr_size, offset);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Names
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    int64_t     value;
+    const char *name;
+} Name;
+
+#define N(x) { x, #x }
+
+static const char *lookup_name(const Name *t, size_t n, int64_t v, size_t skip)
+{
+    for (size_t i = 0; i < n; i++)
+        if (t[i].value == v) return t[i].name + skip;
+    return "?";
+}
+
+#define NAME_OF(table, v, prefix) \
+    lookup_name(table, sizeof(table) / sizeof(table[0]), (int64_t)(v), sizeof(prefix) - 1)
+
+const char *elf_type_name(uint16_t e_type)
+{
+    static const Name t[] = { N(ET_NONE), N(ET_REL), N(ET_EXEC), N(ET_DYN), N(ET_CORE) };
+    return NAME_OF(t, e_type, "ET_");
+}
+
+const char *elf_machine_name(uint16_t e_machine)
+{
+    static const Name t[] = { N(EM_386), N(EM_ARM), N(EM_X86_64), N(EM_AARCH64), N(EM_RISCV) };
+    return NAME_OF(t, e_machine, "EM_");
+}
+
+const char *elf_segment_type_name(uint32_t p_type)
+{
+    static const Name t[] = {
+        N(PT_NULL), N(PT_LOAD), N(PT_DYNAMIC), N(PT_INTERP), N(PT_NOTE), N(PT_SHLIB), N(PT_PHDR),
+        N(PT_TLS), N(PT_GNU_EH_FRAME), N(PT_GNU_STACK), N(PT_GNU_RELRO), N(PT_GNU_PROPERTY),
+    };
+    return NAME_OF(t, p_type, "PT_");
+}
+
+const char *elf_section_type_name(uint32_t sh_type)
+{
+    static const Name t[] = {
+        N(SHT_NULL), N(SHT_PROGBITS), N(SHT_SYMTAB), N(SHT_STRTAB), N(SHT_RELA), N(SHT_HASH),
+        N(SHT_DYNAMIC), N(SHT_NOTE), N(SHT_NOBITS), N(SHT_REL), N(SHT_DYNSYM), N(SHT_INIT_ARRAY),
+        N(SHT_FINI_ARRAY), N(SHT_PREINIT_ARRAY), N(SHT_GROUP), N(SHT_SYMTAB_SHNDX), N(SHT_RELR),
+        N(SHT_GNU_HASH), N(SHT_GNU_verdef), N(SHT_GNU_verneed), N(SHT_GNU_versym),
+    };
+    return NAME_OF(t, sh_type, "SHT_");
+}
+
+const char *elf_bind_name(unsigned bind)
+{
+    static const Name t[] = { N(STB_LOCAL), N(STB_GLOBAL), N(STB_WEAK), N(STB_GNU_UNIQUE) };
+    return NAME_OF(t, bind, "STB_");
+}
+
+const char *elf_sym_type_name(unsigned type)
+{
+    static const Name t[] = {
+        N(STT_NOTYPE), N(STT_OBJECT), N(STT_FUNC), N(STT_SECTION), N(STT_FILE), N(STT_COMMON),
+        N(STT_TLS), N(STT_GNU_IFUNC),
+    };
+    return NAME_OF(t, type, "STT_");
+}
+
+const char *elf_reloc_type_name(uint16_t e_machine, uint32_t type)
+{
+    static const Name x86[] = {
+        N(R_X86_64_NONE), N(R_X86_64_64), N(R_X86_64_PC32), N(R_X86_64_GOT32), N(R_X86_64_PLT32),
+        N(R_X86_64_COPY), N(R_X86_64_GLOB_DAT), N(R_X86_64_JUMP_SLOT), N(R_X86_64_RELATIVE),
+        N(R_X86_64_GOTPCREL), N(R_X86_64_32), N(R_X86_64_32S), N(R_X86_64_DTPMOD64),
+        N(R_X86_64_DTPOFF64), N(R_X86_64_TPOFF64), N(R_X86_64_TLSGD), N(R_X86_64_TLSLD),
+        N(R_X86_64_DTPOFF32), N(R_X86_64_GOTTPOFF), N(R_X86_64_TPOFF32), N(R_X86_64_PC64),
+        N(R_X86_64_GOTPC32), N(R_X86_64_IRELATIVE), N(R_X86_64_GOTPCRELX), N(R_X86_64_REX_GOTPCRELX),
+    };
+    static const Name a64[] = {
+        N(R_AARCH64_NONE), N(R_AARCH64_ABS64), N(R_AARCH64_PREL32), N(R_AARCH64_ADR_PREL_PG_HI21),
+        N(R_AARCH64_ADD_ABS_LO12_NC), N(R_AARCH64_JUMP26), N(R_AARCH64_CALL26),
+        N(R_AARCH64_LDST64_ABS_LO12_NC), N(R_AARCH64_ADR_GOT_PAGE), N(R_AARCH64_LD64_GOT_LO12_NC),
+        N(R_AARCH64_COPY), N(R_AARCH64_GLOB_DAT), N(R_AARCH64_JUMP_SLOT), N(R_AARCH64_RELATIVE),
+        N(R_AARCH64_TLS_TPREL), N(R_AARCH64_TLSDESC), N(R_AARCH64_IRELATIVE),
+    };
+    if (e_machine == EM_X86_64)  return NAME_OF(x86, type, "R_X86_64_");
+    if (e_machine == EM_AARCH64) return NAME_OF(a64, type, "R_AARCH64_");
+    return "?";
+}
+
+const char *elf_dyn_tag_name(int64_t tag)
+{
+    static const Name t[] = {
+        N(DT_NULL), N(DT_NEEDED), N(DT_PLTRELSZ), N(DT_PLTGOT), N(DT_HASH), N(DT_STRTAB),
+        N(DT_SYMTAB), N(DT_RELA), N(DT_RELASZ), N(DT_RELAENT), N(DT_STRSZ), N(DT_SYMENT),
+        N(DT_INIT), N(DT_FINI), N(DT_SONAME), N(DT_RPATH), N(DT_SYMBOLIC), N(DT_REL), N(DT_RELSZ),
+        N(DT_RELENT), N(DT_PLTREL), N(DT_DEBUG), N(DT_TEXTREL), N(DT_JMPREL), N(DT_BIND_NOW),
+        N(DT_INIT_ARRAY), N(DT_FINI_ARRAY), N(DT_INIT_ARRAYSZ), N(DT_FINI_ARRAYSZ), N(DT_RUNPATH),
+        N(DT_FLAGS), N(DT_PREINIT_ARRAY), N(DT_PREINIT_ARRAYSZ), N(DT_RELRSZ), N(DT_RELR),
+        N(DT_RELRENT), N(DT_GNU_HASH), N(DT_VERSYM), N(DT_RELACOUNT), N(DT_RELCOUNT),
+        N(DT_FLAGS_1), N(DT_VERDEF), N(DT_VERDEFNUM), N(DT_VERNEED), N(DT_VERNEEDNUM),
+    };
+    return NAME_OF(t, tag, "DT_");
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Printing — readelf's tables, from the mapping
+ * ════════════════════════════════════════════════════════════════ */
+
+static void flags_str(char *out, uint64_t flags, const char *letters, const uint64_t *bits, int n)
+{
+    int k = 0;
+    for (int i = 0; i < n; i++)
+        if (flags & bits[i]) out[k++] = letters[i];
+    out[k] = '\0';
+}
+
+void print_elf_header(const ElfFile *f)
+{
+    const Elf64_Ehdr *eh = f->eh;
+    printf("    type %s, machine %s, entry 0x%llx\n", elf_type_name(eh->e_type),
+           elf_machine_name(eh->e_machine), (unsigned long long)eh->e_entry);
+    printf("    %u program headers at 0x%llx, %u section headers at 0x%llx, names in section %u\n",
+           f->n_ph, (unsigned long long)eh->e_phoff, f->n_sh, (unsigned long long)eh->e_shoff,
+           eh->e_shstrndx);
+    printf("    %zu bytes; .symtab %u symbols, .dynsym %u, .dynamic %u entries\n", f->size,
+           f->tabs[ELF_SYMTAB].count, f->tabs[ELF_DYNSYM].count, f->n_dyn);
+}
+
+void print_elf_segments(const ElfFile *f)
+{
+    static const uint64_t bits[] = { PF_R, PF_W, PF_X };
+    printf("    %-14s %10s %18s %10s %10s  %s\n", "type", "offset", "vaddr", "filesz", "memsz", "flags");
+    for (uint32_t i = 0; i < f->n_ph; i++) {
+        const Elf64_Phdr *p = &f->ph[i];
+        char flags[4];
+        flags_str(flags, p->p_flags, "RWX", bits, 3);
+        printf("    %-14s %#10llx %#18llx %#10llx %#10llx  %s\n", elf_segment_type_name(p->p_type),
+               (unsigned long long)p->p_offset, (unsigned long long)p->p_vaddr,
+               (unsigned long long)p->p_filesz, (unsigned long long)p->p_memsz, flags);
+    }
+}
+
+void print_elf_sections(const ElfFile *f)
+{
+    static const uint64_t bits[] = { SHF_ALLOC, SHF_WRITE, SHF_EXECINSTR, SHF_MERGE, SHF_STRINGS,
+                                     SHF_INFO_LINK, SHF_TLS };
+    printf("    %3s %-20s %-14s %18s %10s %10s  %s\n", "nr", "name", "type", "addr", "offset",
+           "size", "flags");
+    for (uint32_t i = 1; i < f->n_sh; i++) {
+        const Elf64_Shdr *s = &f->sh[i];
+        char flags[8];
+        flags_str(flags, s->sh_flags, "AWXMSIT", bits, 7);
+        printf("    %3u %-20s %-14s %#18llx %#10llx %#10llx  %s\n", i, elf_section_name(f, s),
+               elf_section_type_name(s->sh_type), (unsigned long long)s->sh_addr,
+               (unsigned long long)s->sh_offset, (unsigned long long)s->sh_size, flags);
+    }
+}
+
+void print_elf_symbols(const ElfFile *f, ElfSymKind kind, uint32_t max)
+{
+    const ElfSymtab *t = &f->tabs[kind];
+    uint32_t n = max && max < t->count ? max : t->count;
+    printf("    %5s %18s %6s %-7s %-7s %-20s %s\n", "nr", "value", "size", "type", "bind", "section",
+           "name");
+    for (uint32_t i = 1; i < n; i++) {
+        const Elf64_Sym *s = &t->sym[i];
+        const char *sec = s->st_shndx == SHN_UNDEF ? "UND"
+                        : s->st_shndx == SHN_ABS   ? "ABS"
+                        : s->st_shndx < f->n_sh    ? elf_section_name(f, &f->sh[s->st_shndx])
+                                                   : "?";
+        printf("    %5u %#18llx %6llu %-7s %-7s %-20s %s\n", i, (unsigned long long)s->st_value,
+               (unsigned long long)s->st_size, elf_sym_type_name(ELF64_ST_TYPE(s->st_info)),
+               elf_bind_name(ELF64_ST_BIND(s->st_info)), sec, elf_sym_name(t, s));
+    }
+    if (n < t->count) printf("    ... %u more\n", t->count - n);
+}
+
+void print_elf_relocs(const ElfFile *f, const Elf64_Shdr *s, uint32_t max)
+{
+    ElfRelocs r;
+    if (elf_relocs(f, s, &r) != 0) return;
+    uint64_t n = max && max < r.count ? max : r.count;
+    printf("    %s: %llu entries, patching %s\n", elf_section_name(f, s), (unsigned long long)r.count,
+           r.target ? elf_section_name(f, r.target) : "the loaded image");
+    for (uint64_t i = 0; i < n; i++) {
+        ElfReloc e;
+        elf_reloc(&r, i, &e);
+        const char *sym = e.sym && r.symbols ? elf_sym_name(r.symbols, &r.symbols->sym[e.sym]) : "";
+        uint64_t    mag = e.addend < 0 ? 0 - (uint64_t)e.addend : (uint64_t)e.addend;
+        printf("      %#12llx  %-22s %s%s%#llx\n", (unsigned long long)e.offset,
+               elf_reloc_type_name(f->eh->e_machine, e.type), sym,
+               e.addend < 0 ? " - " : *sym ? " + " : "", (unsigned long long)mag);
+    }
+    if (n < r.count) printf("      ... %llu more\n", (unsigned long long)(r.count - n));
+}
+
+void print_elf_dynamic(const ElfFile *f)
+{
+    for (uint32_t i = 0; i < f->n_dyn; i++) {
+        const Elf64_Dyn *d = &f->dyn[i];
+        int str = d->d_tag == DT_NEEDED || d->d_tag == DT_SONAME || d->d_tag == DT_RPATH ||
+                  d->d_tag == DT_RUNPATH;
+        if (str)
+            printf("    %-18s %s\n", elf_dyn_tag_name(d->d_tag), elf_dyn_str(f, d->d_un.d_val));
+        else
+            printf("    %-18s %#llx\n", elf_dyn_tag_name(d->d_tag), (unsigned long long)d->d_un.d_val);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * Chapter 24 — A zero-copy ELF reader
+ *
+ * elf_open() maps a file read-only and checks, once, that every table
+ * it will hand out lies inside the mapping.  From then on every answer
+ * is a pointer into the file: the ELF header, program and section
+ * headers, symbol and string tables, relocations and the dynamic
+ * section are read where they lie, never copied or converted.
+ *
+ * Three queries would have to scan a table each time, so they build an
+ * index on first use:
+ *
+ *   elf_lookup()      symbol by name      hash table over .symtab + .dynsym
+ *   elf_symbol_at()   symbol by address   symbols sorted by value
+ *   elf_section_at()  section by address  SHF_ALLOC sections sorted by address
+ *
+ * Opening and walking cost nothing until asked; a query pays for its
+ * index once.  elf_index() builds all three up front, after which every
+ * query only reads and any number of threads may share the ElfFile.
+ *
+ * Only ELFCLASS64 in the host's byte order is accepted — what x86-64
+ * and AArch64 Linux run — so the structures in <elf.h> overlay the file
+ * directly.  Anything else, or a table that runs off the end of the
+ * file, fails to open with errno = ENOEXEC.
+ */
+
+#ifndef ELF_READER_H
+#define ELF_READER_H
+
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { ELF_SYMTAB, ELF_DYNSYM, ELF_SYMTAB_COUNT } ElfSymKind;
+
+typedef struct {
+    const Elf64_Sym  *sym;
+    uint32_t          count;        /* 0: the file has no such table */
+    const char       *str;          /* its string table */
+    uint64_t          str_size;
+    const Elf64_Shdr *sec;
+} ElfSymtab;
+
+typedef struct {
+    uint64_t offset;                /* r_offset: where to patch */
+    uint32_t type;                  /* R_X86_64_*, R_AARCH64_* */
+    uint32_t sym;                   /* index into the table's symbols, 0: none */
+    int64_t  addend;                /* 0 for SHT_REL */
+} ElfReloc;
+
+typedef struct {
+    const Elf64_Shdr *sec;          /* the SHT_RELA or SHT_REL section */
+    const Elf64_Shdr *target;       /* the section patched, NULL: the loaded image */
+    const ElfSymtab  *symbols;      /* NULL: sh_link is not a symbol table */
+    const uint8_t    *data;
+    uint64_t          count, entsize;
+    int               rela;
+} ElfRelocs;
+
+typedef struct {
+    const uint8_t    *base;
+    size_t            size;
+    int               mapped;       /* elf_open(): munmap() on close */
+
+    const Elf64_Ehdr *eh;
+    const Elf64_Phdr *ph;
+    uint32_t          n_ph;
+    const Elf64_Shdr *sh;
+    uint32_t          n_sh;
+    const char       *shstr;        /* section names */
+    uint64_t          shstr_size;
+    ElfSymtab         tabs[ELF_SYMTAB_COUNT];
+    const Elf64_Dyn  *dyn;
+    uint32_t          n_dyn;
+    const char       *dynstr;
+    uint64_t          dynstr_size;
+
+    /* Lazy indexes; entries are kind << 31 | symbol index */
+    uint32_t         *name_index;   /* open addressing, UINT32_MAX: empty */
+    uint32_t          name_mask;
+    uint32_t         *addr_index;   /* by st_value */
+    uint32_t          n_addr;
+    uint32_t         *sec_index;    /* section numbers, by sh_addr */
+    uint32_t          n_sec_index;
+} ElfFile;
+
+/* 0, or -1 with errno set (ENOEXEC: not an ELF64 file this reader takes) */
+int  elf_open(ElfFile *f, const char *path);
+/* The same checks over a caller's buffer, which must outlive f and be
+ * 8-byte aligned */
+int  elf_open_mem(ElfFile *f, const void *data, size_t size);
+void elf_close(ElfFile *f);
+/* Build every index now: 0, or -1 with errno = ENOMEM */
+int  elf_index(ElfFile *f);
+
+/* ── Sections and segments ───────────────────────────────────── */
+const Elf64_Shdr *elf_section(const ElfFile *f, uint32_t i);        /* NULL: no such section */
+const char       *elf_section_name(const ElfFile *f, const Elf64_Shdr *s);
+const Elf64_Shdr *elf_section_by_name(const ElfFile *f, const char *name);
+/* The section's bytes; NULL for SHT_NOBITS or if they are not in the file */
+const void       *elf_section_data(const ElfFile *f, const Elf64_Shdr *s);
+/* The allocated section whose addresses cover addr, or NULL */
+const Elf64_Shdr *elf_section_at(ElfFile *f, uint64_t addr);
+
+const void       *elf_segment_data(const ElfFile *f, const Elf64_Phdr *p);
+/* The file bytes loaded at [addr, addr + size), or NULL if no PT_LOAD
+ * segment holds all of them in the file */
+const void       *elf_vaddr(const ElfFile *f, uint64_t addr, uint64_t size);
+const char       *elf_interp(const ElfFile *f);                     /* NULL: no PT_INTERP */
+
+/* ── Symbols ─────────────────────────────────────────────────── */
+const ElfSymtab  *elf_symtab(const ElfFile *f, ElfSymKind kind);
+const char       *elf_sym_name(const ElfSymtab *t, const Elf64_Sym *s);  /* "" if out of range */
+/* By name over both tables: a defined global, else a defined weak, else
+ * a defined local, else an undefined reference; *kind says which table */
+const Elf64_Sym  *elf_lookup(ElfFile *f, const char *name, ElfSymKind *kind);
+/* The code or data symbol with the greatest value ≤ addr, if addr is
+ * inside it (from .symtab, or .dynsym if the file is stripped) */
+const Elf64_Sym  *elf_symbol_at(ElfFile *f, uint64_t addr, ElfSymKind *kind);
+
+/* ── Relocations and the dynamic section ─────────────────────── */
+int  elf_relocs(const ElfFile *f, const Elf64_Shdr *s, ElfRelocs *out);  /* -1: not REL/RELA */
+void elf_reloc(const ElfRelocs *r, uint64_t i, ElfReloc *out);
+
+const Elf64_Dyn *elf_dynamic(const ElfFile *f, uint32_t *count);    /* NULL: static */
+const char      *elf_dyn_str(const ElfFile *f, uint64_t offset);    /* DT_NEEDED etc.; "" if bad */
+
+/* ── Names, for printing ─────────────────────────────────────── */
+const char *elf_type_name(uint16_t e_type);
+const char *elf_machine_name(uint16_t e_machine);
+const char *elf_segment_type_name(uint32_t p_type);
+const char *elf_section_type_name(uint32_t sh_type);
+const char *elf_bind_name(unsigned bind);
+const char *elf_sym_type_name(unsigned type);
+const char *elf_reloc_type_name(uint16_t e_machine, uint32_t type);
+const char *elf_dyn_tag_name(int64_t tag);
+
+void print_elf_header(const ElfFile *f);
+void print_elf_segments(const ElfFile *f);
+void print_elf_sections(const ElfFile *f);
+void print_elf_symbols(const ElfFile *f, ElfSymKind kind, uint32_t max);   /* max 0: all */
+void print_elf_relocs(const ElfFile *f, const Elf64_Shdr *s, uint32_t max);
+void print_elf_dynamic(const ElfFile *f);
+
+#endif /* ELF_READER_H */
@@ -2,12 +2,33 @@
  * ║  Chapter 26 — ELF Executable Layout                             ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: ELF header, program headers, segments, entry point     ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Sections 2 to 6 read this program's own file, /proc/self/exe, with
+ * chapter 24's zero-copy reader rather than asking for readelf.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/26_elf_executable \
+ *            src/26_elf_executable/elf_executable.c src/24_assembler_elf/elf_reader.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/auxv.h>
+
+#include "../24_assembler_elf/elf_reader.h"
+
+static ElfFile self;            /* /proc/self/exe */
+static int     have_self;
+
+static int no_self(void)
+{
+    if (!have_self) printf("  (/proc/self/exe could not be read; skipping the live part)\n\n");
+    return !have_self;
+}
 
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — From Object Files to Executables
@@ -75,6 +96,16 @@ static void demo_elf_header(void)
 
     printf("  Modern Linux creates PIE (Position Independent Executable)\n");
     printf("  by default: e_type = ET_DYN, loaded at random address (ASLR).\n\n");
+
+    if (no_self()) return;
+
+    const unsigned char *id = self.eh->e_ident;
+    printf("  This program's header:\n");
+    printf("    e_ident  %02x %02x %02x %02x  class %u  data %u  version %u  OS/ABI %u\n",
+           id[0], id[1], id[2], id[3], id[EI_CLASS], id[EI_DATA], id[EI_VERSION], id[EI_OSABI]);
+    print_elf_header(&self);
+    printf("\n  The kernel agrees: AT_ENTRY = %#lx, which is e_entry plus\n", getauxval(AT_ENTRY));
+    printf("  the load address %#lx.\n\n", getauxval(AT_ENTRY) - (unsigned long)self.eh->e_entry);
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -114,6 +145,30 @@ static void demo_program_headers(void)
     printf("    - File offset and size (bytes in file)\n");
     printf("    - Virtual address and memory size\n");
     printf("    - Permissions: R (read), W (write), X (execute)\n\n");
+
+    if (no_self()) return;
+
+    printf("  This program's program headers:\n\n");
+    print_elf_segments(&self);
+
+    /* Which sections each LOAD segment carries: the ones whose
+     * addresses fall inside it */
+    printf("\n  Section to segment mapping (LOAD only):\n");
+    for (uint32_t i = 0; i < self.n_ph; i++) {
+        const Elf64_Phdr *p = &self.ph[i];
+        if (p->p_type != PT_LOAD) continue;
+        printf("    %2u %c%c%c:", i, p->p_flags & PF_R ? 'R' : '-', p->p_flags & PF_W ? 'W' : '-',
+               p->p_flags & PF_X ? 'X' : '-');
+        for (uint32_t s = 1; s < self.n_sh; s++) {
+            const Elf64_Shdr *sh = elf_section(&self, s);
+            if ((sh->sh_flags & SHF_ALLOC) && !(sh->sh_flags & SHF_TLS && sh->sh_type == SHT_NOBITS) &&
+                sh->sh_addr >= p->p_vaddr && sh->sh_addr < p->p_vaddr + p->p_memsz)
+                printf(" %s", elf_section_name(&self, sh));
+        }
+        printf("\n");
+    }
+    printf("\n  filesz < memsz in the RW segment is .bss: memory the\n");
+    printf("  loader zero-fills and the file never stores.\n\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -153,6 +208,26 @@ static void demo_memory_layout(void)
            (void*)"Hello from .rodata");
     printf("    global_counter  could be at an address in .data\n");
     printf("    (Use /proc/self/maps to see the full memory map.)\n\n");
+
+    if (no_self()) return;
+
+    /* Back from a runtime address to the section it came from:
+     * subtract the load address, then elf_section_at() */
+    uintptr_t   bias = (uintptr_t)getauxval(AT_ENTRY) - (uintptr_t)self.eh->e_entry;
+    const struct { const char *what; const void *addr; } probes[] = {
+        { "demo_memory_layout", (const void *)(uintptr_t)demo_memory_layout },
+        { "a string literal",   "Hello from .rodata" },
+        { "&self",              &self },
+        { "&have_self",         &have_self },
+    };
+    printf("  The same addresses, mapped back to sections of the file:\n");
+    for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        uint64_t          addr = (uint64_t)((uintptr_t)probes[i].addr - bias);
+        const Elf64_Shdr *s    = elf_section_at(&self, addr);
+        printf("    %-20s %#10llx  →  %s\n", probes[i].what, (unsigned long long)addr,
+               s ? elf_section_name(&self, s) : "?");
+    }
+    printf("\n");
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -176,7 +251,10 @@ static void demo_interp(void)
     printf("  On AArch64:\n");
     printf("    /lib/ld-linux-aarch64.so.1\n\n");
 
-    printf("  View it: readelf -p .interp ./elf_executable\n\n");
+    if (have_self) {
+        const char *interp = elf_interp(&self);
+        printf("  This program's PT_INTERP: %s\n\n", interp ? interp : "(none — static)");
+    }
 
     printf("  When the kernel sees .interp, it loads the dynamic linker\n");
     printf("  INSTEAD of jumping directly to the program. The dynamic\n");
@@ -196,25 +274,26 @@ static void demo_examine_exe(void)
     printf("║  Section 6 — Examining Executables                      ║\n");
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 
+    printf("  readelf -h / -l / -S are print_elf_header(), _segments()\n");
+    printf("  and _sections() above; readelf -d is the dynamic section:\n\n");
+
+    if (!no_self()) {
+        print_elf_dynamic(&self);
+        uint32_t         n;
+        const Elf64_Dyn *d = elf_dynamic(&self, &n);
+        printf("\n  Libraries the loader must find first (DT_NEEDED):");
+        for (uint32_t i = 0; d && i < n; i++)
+            if (d[i].d_tag == DT_NEEDED) printf(" %s", elf_dyn_str(&self, d[i].d_un.d_val));
+        printf("\n\n");
+    }
+
     printf("╔══════════════════════════════════════════════════════════╗\n");
-    printf("║  View ELF header:                                       ║\n");
-    printf("║  readelf -h ./elf_executable                            ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View program headers (segments):                       ║\n");
-    printf("║  readelf -l ./elf_executable                            ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View section headers:                                  ║\n");
-    printf("║  readelf -S ./elf_executable                            ║\n");
-    printf("║                                                         ║\n");
-    printf("║  View dynamic section:                                  ║\n");
-    printf("║  readelf -d ./elf_executable                            ║\n");
-    printf("║                                                         ║\n");
     printf("║  View memory map of running process:                    ║\n");
     printf("║  cat /proc/self/maps                                    ║\n");
     printf("║                                                         ║\n");
     printf("║  Compare .o vs executable:                              ║\n");
-    printf("║  readelf -h file.o  (e_type = ET_REL, entry = 0x0)     ║\n");
-    printf("║  readelf -h a.out   (e_type = ET_DYN, entry = 0x...)   ║\n");
+    printf("║  .o:    ET_REL, entry 0x0, no program headers           ║\n");
+    printf("║  a.out: ET_DYN, entry 0x..., PT_LOAD, PT_INTERP, ...    ║\n");
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 }
 
@@ -228,12 +307,15 @@ int main(void)
     printf("║  Modular-C-Demos                                            ║\n");
     printf("╚══════════════════════════════════════════════════════════════╝\n");
 
+    have_self = elf_open(&self, "/proc/self/exe") == 0;
+
     demo_obj_to_exe();
     demo_elf_header();
     demo_program_headers();
     demo_memory_layout();
     demo_interp();
     demo_examine_exe();
+    elf_close(&self);
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 26 — ELF Executable Layout\n");
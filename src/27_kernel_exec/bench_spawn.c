@@ -0,0 +1,284 @@
+/*
+ * Spawn benchmark — fork+exec vs vfork vs clone(CLONE_VM) vs posix_spawn
+ *
+ * Grows this process's RSS step by step (--rss-mb, touched 4 KB pages
+ * with THP refused, like a long-lived heap) and at each size launches
+ * --prog --reps times through every spawn.c backend.  Reported per
+ * backend: the time until spawn_start() returns — the child has exec'd,
+ * the parent may go on — and until the child has been reaped.  Per
+ * size: the page tables the RSS costs (VmPTE) and how long a bare
+ * fork() takes to copy them, the part of fork+exec that grows with the
+ * parent and that the other backends skip.
+ *
+ * Before measuring each backend must run the program with exit status
+ * 0 and fail on a missing one with ENOENT; otherwise it exits 1.
+ * Sizes over 3/4 of MemAvailable are skipped.
+ *
+ * Build: make bench_spawn
+ * Run:   ./bin/bench_spawn [--rss-mb 10,100,1000,10000] [--backend NAME|all]
+ *                          [--reps N] [--prog PATH] [--format text|csv|json]
+ *        NAME is fork, vfork, clone or posix_spawn; --prog runs with no
+ *        arguments (default /bin/true).
+ */
+
+#define _GNU_SOURCE         /* MADV_NOHUGEPAGE */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "../../include/bench.h"
+#include "spawn.h"
+
+#define MAX_SIZES 16
+#define MAX_REPS  1000
+
+typedef struct {
+    size_t         sizes[MAX_SIZES];
+    int            n_sizes;
+    int            backend;         /* -1 = all */
+    int            reps;
+    const char    *prog;
+    bench_format_t format;
+} Config;
+
+/* ════════════════════════════════════════════════════════════════
+ *  The parent's RSS
+ * ════════════════════════════════════════════════════════════════ */
+
+static size_t meminfo_kb(const char *path, const char *key)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char   line[128];
+    size_t klen = strlen(key), kb = 0;
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, key, klen) == 0 && sscanf(line + klen, " %zu", &kb) == 1) break;
+    fclose(f);
+    return kb;
+}
+
+/* One mapping, grown by mremap() and touched as it grows */
+typedef struct {
+    char  *base;
+    size_t size;
+} Ballast;
+
+static int ballast_grow(Ballast *b, size_t size)
+{
+    if (size <= b->size) return 0;
+    char *p = b->base ? mremap(b->base, b->size, size, MREMAP_MAYMOVE)
+                      : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return -1;
+    /* 4 KB pages, as malloc's heap would get with THP in madvise mode */
+    madvise(p, size, MADV_NOHUGEPAGE);
+    for (size_t off = b->size; off < size; off += 4096) p[off] = 1;
+    b->base = p;
+    b->size = size;
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Measurements
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint64_t start_med, start_p90, total_med;
+} Timing;
+
+static int check(SpawnBackend be, const char *prog)
+{
+    char *argv[]   = { (char *)prog, NULL };
+    char *none[]   = { "/nonexistent/bench_spawn", NULL };
+    int   rc       = spawn_run(be, prog, argv, NULL, NULL);
+    int   missing  = spawn_run(be, none[0], none, NULL, NULL);
+    int   err      = errno;
+    if (rc != 0) {
+        fprintf(stderr, "%s: %s exited %d (%s)\n", spawn_backend_name(be), prog, rc,
+                rc < 0 ? strerror(errno) : "want 0");
+        return -1;
+    }
+    if (missing != -1 || err != ENOENT) {
+        fprintf(stderr, "%s: a missing program gave %d, errno %d; want -1, ENOENT\n",
+                spawn_backend_name(be), missing, err);
+        return -1;
+    }
+    return 0;
+}
+
+static int measure(SpawnBackend be, const char *prog, int reps, Timing *t)
+{
+    static uint64_t start[MAX_REPS], total[MAX_REPS];
+    char           *argv[] = { (char *)prog, NULL };
+    for (int r = 0; r < reps; r++) {
+        pid_t    pid;
+        uint64_t t0 = bench_now_ns();
+        if (spawn_start(be, prog, argv, NULL, NULL, &pid) != 0) return -1;
+        uint64_t t1 = bench_now_ns();
+        if (spawn_wait(pid) != 0) return -1;
+        start[r] = t1 - t0;
+        total[r] = bench_now_ns() - t0;
+    }
+    t->total_med = bench_percentile(total, (size_t)reps, 50);
+    t->start_p90 = bench_percentile(start, (size_t)reps, 90);
+    t->start_med = bench_percentile(start, (size_t)reps, 50);
+    return 0;
+}
+
+/* A bare fork() whose child exits at once: the page-table copy, and
+ * the teardown of the copy, which the parent does not wait for */
+static uint64_t fork_only(int reps)
+{
+    static uint64_t v[MAX_REPS];
+    for (int r = 0; r < reps; r++) {
+        uint64_t t0  = bench_now_ns();
+        pid_t    pid = fork();
+        if (pid == 0) _exit(0);
+        v[r] = bench_now_ns() - t0;
+        if (pid < 0) return 0;
+        waitpid(pid, NULL, 0);
+    }
+    return bench_percentile(v, (size_t)reps, 50);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Command line and main
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--rss-mb 10,100,1000,10000] [--backend fork|vfork|clone|posix_spawn|all]\n"
+            "          [--reps N] [--prog PATH] [--format text|csv|json]\n",
+            prog);
+}
+
+static int parse_sizes(const char *s, Config *cfg)
+{
+    cfg->n_sizes = 0;
+    while (*s) {
+        char *end;
+        long  mb = strtol(s, &end, 10);
+        if (end == s || mb <= 0 || cfg->n_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->n_sizes++] = (size_t)mb << 20;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return cfg->n_sizes > 0 ? 0 : -1;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--rss-mb") == 0) {
+            if (parse_sizes(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--backend") == 0) {
+            SpawnBackend be;
+            if (strcmp(val, "all") == 0)                 cfg->backend = -1;
+            else if (spawn_parse_backend(val, &be) == 0) cfg->backend = (int)be;
+            else                                         return -1;
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--prog") == 0) {
+            cfg->prog = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && cfg->reps <= MAX_REPS ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { (size_t)10 << 20, (size_t)100 << 20, (size_t)1000 << 20, (size_t)10000 << 20 },
+                   4, -1, 20, "/bin/true", BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (int b = 0; b < SPAWN_BACKENDS; b++)
+        if ((cfg.backend < 0 || cfg.backend == b) && check((SpawnBackend)b, cfg.prog) != 0) return 1;
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_spawn: %s, median of %d launches; start = until spawn_start() returns,\n"
+               "total = until the child is reaped\n\n", cfg.prog, cfg.reps);
+        printf("  %8s %8s %9s  %-12s %9s %9s %9s %8s\n", "RSS MB", "PTE KB", "fork() us", "backend",
+               "start us", "p90 us", "total us", "vs fork");
+        break;
+    case BENCH_FMT_CSV:
+        printf("rss_bytes,pte_bytes,fork_only_us,backend,start_us,start_p90_us,total_us\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"spawn\",\n  \"results\": [");
+        break;
+    }
+
+    Ballast ballast = { NULL, 0 };
+    int     failed  = 0, first = 1;
+    for (int s = 0; s < cfg.n_sizes; s++) {
+        size_t size = cfg.sizes[s];
+        size_t avail = meminfo_kb("/proc/meminfo", "MemAvailable:") << 10;
+        const char *skip = NULL;
+        if (avail && size > ballast.size && size - ballast.size > avail / 4 * 3)
+            skip = "over 3/4 of MemAvailable";
+        else if (ballast_grow(&ballast, size) != 0)
+            skip = strerror(errno);
+        if (skip) {
+            if (cfg.format == BENCH_FMT_TEXT) printf("  %8zu  n/a (%s)\n\n", size >> 20, skip);
+            continue;
+        }
+        size_t   pte        = meminfo_kb("/proc/self/status", "VmPTE:") << 10;
+        uint64_t bare       = fork_only(cfg.reps);
+        uint64_t fork_start = 0;
+        for (int b = 0; b < SPAWN_BACKENDS; b++) {
+            if (cfg.backend >= 0 && cfg.backend != b) continue;
+            Timing t;
+            if (measure((SpawnBackend)b, cfg.prog, cfg.reps, &t) != 0) {
+                fprintf(stderr, "%s: %s\n", spawn_backend_name((SpawnBackend)b), strerror(errno));
+                failed = 1;
+                continue;
+            }
+            if (b == SPAWN_FORK) fork_start = t.start_med;
+            switch (cfg.format) {
+            case BENCH_FMT_TEXT:
+                if (b == cfg.backend || (cfg.backend < 0 && b == 0))
+                    printf("  %8zu %8zu %9.1f", size >> 20, pte >> 10, (double)bare / 1e3);
+                else
+                    printf("  %8s %8s %9s", "", "", "");
+                printf("  %-12s %9.1f %9.1f %9.1f", spawn_backend_name((SpawnBackend)b),
+                       (double)t.start_med / 1e3, (double)t.start_p90 / 1e3, (double)t.total_med / 1e3);
+                if (fork_start && t.start_med) printf(" %7.1fx", (double)fork_start / (double)t.start_med);
+                printf("\n");
+                break;
+            case BENCH_FMT_CSV:
+                printf("%zu,%zu,%.3f,%s,%.3f,%.3f,%.3f\n", size, pte, (double)bare / 1e3,
+                       spawn_backend_name((SpawnBackend)b), (double)t.start_med / 1e3,
+                       (double)t.start_p90 / 1e3, (double)t.total_med / 1e3);
+                break;
+            case BENCH_FMT_JSON:
+                printf("%s\n    { \"rss_bytes\": %zu, \"pte_bytes\": %zu, \"fork_only_us\": %.3f, "
+                       "\"backend\": \"%s\", \"start_us\": %.3f, \"start_p90_us\": %.3f, \"total_us\": %.3f }",
+                       first ? "" : ",", size, pte, (double)bare / 1e3, spawn_backend_name((SpawnBackend)b),
+                       (double)t.start_med / 1e3, (double)t.start_p90 / 1e3, (double)t.total_med / 1e3);
+                first = 0;
+                break;
+            }
+        }
+        if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+    if (ballast.base) munmap(ballast.base, ballast.size);
+    return failed ? 1 : 0;
+}
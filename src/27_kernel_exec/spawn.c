@@ -0,0 +1,227 @@
+/*
+ * Chapter 27 — Launching a program without copying the parent
+ *
+ * See spawn.h.  The shared-memory children (vfork, clone) run on
+ * borrowed memory: whatever they write, the parent sees.  So the parent
+ * blocks every signal first — a handler running in the child would run
+ * on the parent's data — and the child puts any caught signal back to
+ * SIG_DFL before restoring the mask for the exec.
+ */
+
+#define _GNU_SOURCE         /* vfork(), clone(), pipe2() */
+
+#include "spawn.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#define CLONE_STACK ((size_t)64 << 10)
+
+static const char *names[SPAWN_BACKENDS] = { "fork", "vfork", "clone", "posix_spawn" };
+
+const char *spawn_backend_name(SpawnBackend be)
+{
+    return be >= 0 && be < SPAWN_BACKENDS ? names[be] : "?";
+}
+
+int spawn_parse_backend(const char *s, SpawnBackend *out)
+{
+    for (int b = 0; b < SPAWN_BACKENDS; b++)
+        if (strcmp(s, names[b]) == 0) {
+            *out = (SpawnBackend)b;
+            return 0;
+        }
+    return -1;
+}
+
+/* What the child needs, and where a shared-memory child leaves the
+ * exec's errno */
+typedef struct {
+    const char      *path;
+    char *const     *argv;
+    char *const     *envp;
+    const SpawnOpts *opts;
+    const sigset_t  *mask;          /* to restore before the exec; NULL: leave it */
+    volatile int     err;
+} Child;
+
+static int redirect(const SpawnOpts *o)
+{
+    if (!o) return 0;
+    if (o->stdin_fd  >= 0 && dup2(o->stdin_fd,  0) < 0) return -1;
+    if (o->stdout_fd >= 0 && dup2(o->stdout_fd, 1) < 0) return -1;
+    if (o->stderr_fd >= 0 && dup2(o->stderr_fd, 2) < 0) return -1;
+    return 0;
+}
+
+/* Only async-signal-safe calls from here on; returns only on failure,
+ * with c->err set */
+static void child_exec(Child *c)
+{
+    if (c->mask) {
+        struct sigaction sa;
+        for (int sig = 1; sig < NSIG; sig++) {
+            if (sigaction(sig, NULL, &sa) != 0) continue;
+            if (sa.sa_handler == SIG_IGN || sa.sa_handler == SIG_DFL) continue;
+            sa.sa_handler = SIG_DFL;
+            sa.sa_flags   = 0;
+            sigaction(sig, &sa, NULL);
+        }
+    }
+    if (redirect(c->opts) == 0) {
+        if (c->mask) sigprocmask(SIG_SETMASK, c->mask, NULL);
+        execve(c->path, c->argv, c->envp);
+    }
+    c->err = errno;
+}
+
+static int clone_child(void *arg)
+{
+    child_exec(arg);
+    _exit(127);
+}
+
+/* Block everything, start the child, wait (the kernel does) until it has
+ * exec'd or died, then read what it left in c->err */
+static int start_shared(SpawnBackend be, Child *c, pid_t *pid)
+{
+    sigset_t all, old;
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+    c->mask = &old;
+    c->err  = 0;
+
+    pid_t p;
+    int   err = 0;
+    if (be == SPAWN_VFORK) {
+        p = vfork();
+        if (p == 0) {
+            child_exec(c);
+            _exit(127);
+        }
+        if (p < 0) err = errno;
+    } else {
+        void *stack = mmap(NULL, CLONE_STACK, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (stack == MAP_FAILED) {
+            p   = -1;
+            err = errno;
+        } else {
+            /* The stack grows down on every architecture Linux has but one */
+            p = clone(clone_child, (char *)stack + CLONE_STACK, CLONE_VM | CLONE_VFORK | SIGCHLD, c);
+            if (p < 0) err = errno;
+            munmap(stack, CLONE_STACK);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+
+    if (p > 0 && c->err) {                  /* it ran, but the exec failed */
+        err = c->err;
+        waitpid(p, NULL, 0);
+        p = -1;
+    }
+    if (p < 0) {
+        errno = err;
+        return -1;
+    }
+    *pid = p;
+    return 0;
+}
+
+/* fork(): the child's memory is its own, so a failed exec reports its
+ * errno through a pipe that a successful exec closes */
+static int start_fork(Child *c, pid_t *pid)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+    pid_t p = fork();
+    if (p < 0) {
+        int err = errno;
+        close(fds[0]);
+        close(fds[1]);
+        errno = err;
+        return -1;
+    }
+    if (p == 0) {
+        close(fds[0]);
+        c->mask = NULL;
+        child_exec(c);
+        int err = c->err;
+        if (write(fds[1], &err, sizeof(err)) < 0) _exit(127);
+        _exit(127);
+    }
+    close(fds[1]);
+    int     err = 0;
+    ssize_t n;
+    do n = read(fds[0], &err, sizeof(err));
+    while (n < 0 && errno == EINTR);
+    close(fds[0]);
+    if (n == (ssize_t)sizeof(err)) {
+        waitpid(p, NULL, 0);
+        errno = err;
+        return -1;
+    }
+    *pid = p;
+    return 0;
+}
+
+static int start_posix(Child *c, pid_t *pid)
+{
+    posix_spawn_file_actions_t fa, *fap = NULL;
+    const SpawnOpts           *o = c->opts;
+    if (o && (o->stdin_fd >= 0 || o->stdout_fd >= 0 || o->stderr_fd >= 0)) {
+        posix_spawn_file_actions_init(&fa);
+        if (o->stdin_fd  >= 0) posix_spawn_file_actions_adddup2(&fa, o->stdin_fd,  0);
+        if (o->stdout_fd >= 0) posix_spawn_file_actions_adddup2(&fa, o->stdout_fd, 1);
+        if (o->stderr_fd >= 0) posix_spawn_file_actions_adddup2(&fa, o->stderr_fd, 2);
+        fap = &fa;
+    }
+    int rc = posix_spawn(pid, c->path, fap, NULL, c->argv, c->envp);
+    if (fap) posix_spawn_file_actions_destroy(fap);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int spawn_start(SpawnBackend be, const char *path, char *const argv[], char *const envp[],
+                const SpawnOpts *opts, pid_t *pid)
+{
+    Child c = { path, argv, envp ? envp : environ, opts, NULL, 0 };
+    switch (be) {
+    case SPAWN_FORK:     return start_fork(&c, pid);
+    case SPAWN_VFORK:
+    case SPAWN_CLONE_VM: return start_shared(be, &c, pid);
+    case SPAWN_POSIX:    return start_posix(&c, pid);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+int spawn_wait(pid_t pid)
+{
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) return -1;
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+int spawn_run(SpawnBackend be, const char *path, char *const argv[], char *const envp[],
+              const SpawnOpts *opts)
+{
+    pid_t pid;
+    if (spawn_start(be, path, argv, envp, opts, &pid) != 0) return -1;
+    return spawn_wait(pid);
+}
@@ -0,0 +1,66 @@
+/*
+ * Chapter 27 — Launching a program without copying the parent
+ *
+ * fork() copies the parent's page tables (and marks every private page
+ * copy-on-write) only for execve() to throw them away a moment later,
+ * so fork+exec costs grow with the parent's RSS — 10 to 20 ms per GB
+ * of touched 4 KB pages is typical.  The other backends take tens of
+ * microseconds at any size; they never copy the address space:
+ *
+ *   SPAWN_FORK       fork() + execve(), the baseline
+ *   SPAWN_VFORK      vfork() + execve(): the child borrows the parent's
+ *                    memory and the parent sleeps until it has exec'd
+ *   SPAWN_CLONE_VM   clone(CLONE_VM | CLONE_VFORK) + execve(), the same
+ *                    on a stack of its own, so the child cannot clobber
+ *                    the parent's frames
+ *   SPAWN_POSIX      posix_spawn(), which glibc implements the same way
+ *
+ * All four give the same child: the standard descriptors from opts (or
+ * inherited), signal handlers reset to SIG_DFL, the parent's signal
+ * mask.  In the shared-memory backends the child only calls dup2(),
+ * sigaction(), sigprocmask(), execve() and _exit(), with all signals
+ * blocked until the exec, and reports a failed exec back through
+ * memory; the fork backend uses a close-on-exec pipe.  Either way
+ * spawn_start() fails with the exec's errno rather than handing back a
+ * child that exits 127.
+ */
+
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <sys/types.h>
+
+typedef enum {
+    SPAWN_FORK,
+    SPAWN_VFORK,
+    SPAWN_CLONE_VM,
+    SPAWN_POSIX,
+    SPAWN_BACKENDS
+} SpawnBackend;
+
+typedef struct {
+    int stdin_fd;           /* dup2()ed onto 0, 1, 2 in the child; -1 inherits */
+    int stdout_fd;
+    int stderr_fd;
+} SpawnOpts;
+
+#define SPAWN_OPTS_INHERIT { -1, -1, -1 }
+
+/* Start path with argv and envp (NULL: the parent's environ).
+ * opts may be NULL.  0 with *pid set; -1 with errno, the exec's own
+ * (ENOENT, EACCES, ...) if the program could not be started. */
+int         spawn_start(SpawnBackend be, const char *path, char *const argv[], char *const envp[],
+                        const SpawnOpts *opts, pid_t *pid);
+
+/* waitpid() retried on EINTR; the exit status, 128 + signal number if
+ * killed, -1 with errno on failure */
+int         spawn_wait(pid_t pid);
+
+/* spawn_start() then spawn_wait() */
+int         spawn_run(SpawnBackend be, const char *path, char *const argv[], char *const envp[],
+                      const SpawnOpts *opts);
+
+const char *spawn_backend_name(SpawnBackend be);    /* "fork", "vfork", "clone", "posix_spawn" */
+int         spawn_parse_backend(const char *s, SpawnBackend *out);
+
+#endif /* SPAWN_H */
@@ -0,0 +1,391 @@
+/*
+ * Symbol lookup benchmark — DT_GNU_HASH vs DT_HASH vs linear vs dlsym
+ *
+ * For each library: every symbol it exports is looked up by name with
+ * each symres.c method and with dlsym() on a dlopen() handle, then the
+ * same names with "_x" appended, which no library defines:
+ *
+ *   hit ns     median ns per lookup that finds its symbol
+ *   miss ns    median ns per lookup that does not — the common case for
+ *              ld.so, which asks every library in the search order
+ *   bloom      share of the misses DT_GNU_HASH's Bloom filter rejects
+ *              without touching a bucket
+ *
+ * A linear scan of 100k symbols per lookup would take minutes, so that
+ * method gets --linear-max names (default 100) spread over the table.
+ *
+ * Every method must return the same .dynsym entry for every name, and
+ * dlsym() the same address (load bias + st_value; IFUNC and TLS symbols
+ * resolve to something else and are only checked for being found).
+ *
+ * Libraries: libc.so.6 as loaded into this process and
+ * bin/libsymlib100k.so, 100000 generated symbols; or --lib PATH, any
+ * number of times.
+ *
+ * Build: make bench_symres
+ * Run:   ./bin/bench_symres [--lib PATH]... [--reps R] [--linear-max N]
+ *                           [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dlfcn.h>
+
+#include "../../include/bench.h"
+#include "symres.h"
+
+#define MAX_LIBS 8
+#define DLSYM    SYMRES_METHOD_COUNT        /* the fourth "method" */
+#define METHODS  (SYMRES_METHOD_COUNT + 1)
+
+typedef struct {
+    const char    *libs[MAX_LIBS];
+    int            n_libs;
+    int            reps;
+    size_t         linear_max;
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    SymResolver  r;
+    void        *handle;
+    const char **hits, **misses;
+    size_t       n;
+    const char **lin_hits, **lin_misses;    /* the sample for SYMRES_LINEAR */
+    size_t       n_lin;
+} Lib;
+
+static const char *method_name(int m)
+{
+    return m == DLSYM ? "dlsym" : symres_method_name((SymresMethod)m);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Measurement
+ * ════════════════════════════════════════════════════════════════ */
+
+static uintptr_t pass(Lib *l, int m, const char **names, size_t n)
+{
+    uintptr_t sink = 0;
+    if (m == DLSYM)
+        for (size_t i = 0; i < n; i++) sink += (uintptr_t)dlsym(l->handle, names[i]);
+    else
+        for (size_t i = 0; i < n; i++) sink += (uintptr_t)symres_lookup(&l->r, (SymresMethod)m, names[i]);
+    return sink;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Median ns per lookup over reps passes (one untimed pass warms up) */
+static double measure(Lib *l, int m, const char **names, size_t n, int reps)
+{
+    double    v[64];
+    uintptr_t sink = pass(l, m, names, n);
+    for (int r = 0; r < reps; r++) {
+        uint64_t t0 = bench_now_ns();
+        sink += pass(l, m, names, n);
+        v[r] = (double)(bench_now_ns() - t0) / (double)n;
+    }
+    bench_escape(&sink);
+    qsort(v, (size_t)reps, sizeof(*v), cmp_double);
+    return reps % 2 ? v[reps / 2] : (v[reps / 2 - 1] + v[reps / 2]) / 2;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Checking every method against the others and dlsym()
+ * ════════════════════════════════════════════════════════════════ */
+
+static int check(Lib *l, size_t *unchecked)
+{
+    int       bad  = 0;
+    uintptr_t bias = 0;
+    int       have_bias = 0;
+    *unchecked = 0;
+
+    for (size_t i = 0; i < l->n; i++) {
+        const Elf64_Sym *want = symres_lookup(&l->r, symres_best(&l->r), l->hits[i]);
+        /* SYMRES_LINEAR is checked on its sample below */
+        for (int m = 0; m < SYMRES_LINEAR; m++) {
+            if (!symres_has(&l->r, (SymresMethod)m)) continue;
+            bad += symres_lookup(&l->r, (SymresMethod)m, l->hits[i]) != want;
+            bad += symres_lookup(&l->r, (SymresMethod)m, l->misses[i]) != NULL;
+        }
+
+        void    *addr = dlsym(l->handle, l->hits[i]);
+        unsigned type = want ? ELF64_ST_TYPE(want->st_info) : STT_NOTYPE;
+        if (!want || !addr) {
+            bad++;
+        } else if (type == STT_GNU_IFUNC || type == STT_TLS) {
+            (*unchecked)++;
+        } else if (!have_bias) {
+            bias      = (uintptr_t)addr - (uintptr_t)want->st_value;
+            have_bias = 1;
+        } else if ((uintptr_t)addr != bias + (uintptr_t)want->st_value) {
+            bad++;
+        }
+    }
+    for (size_t i = 0; i < l->n_lin; i++) {
+        if (symres_lookup(&l->r, SYMRES_LINEAR, l->lin_hits[i]) !=
+            symres_lookup(&l->r, symres_best(&l->r), l->lin_hits[i]))
+            bad++;
+        if (symres_lookup(&l->r, SYMRES_LINEAR, l->lin_misses[i])) bad++;
+    }
+    return bad;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Loading
+ * ════════════════════════════════════════════════════════════════ */
+
+static int load(Lib *l, ElfFile *f, const char *path, size_t linear_max)
+{
+    memset(l, 0, sizeof(*l));
+    if (elf_open(f, path) != 0) {
+        perror(path);
+        return -1;
+    }
+    if (symres_init(&l->r, f) != 0) {
+        fprintf(stderr, "%s: no .dynsym\n", path);
+        elf_close(f);
+        return -1;
+    }
+    l->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!l->handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        elf_close(f);
+        return -1;
+    }
+
+    /* Hits point into the mapping; each miss is a hit plus "_x" */
+    const ElfSymtab *t = l->r.dynsym;
+    l->hits   = malloc(t->count * sizeof(char *));
+    l->misses = malloc(t->count * sizeof(char *));
+    size_t bytes = 0;
+    for (uint32_t i = 1; i < t->count; i++)
+        if (symres_exported(&l->r, i)) bytes += strlen(elf_sym_name(t, &t->sym[i])) + 3;
+    char *buf = malloc(bytes + 1);
+    if (!l->hits || !l->misses || !buf) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    for (uint32_t i = 1; i < t->count; i++) {
+        if (!symres_exported(&l->r, i)) continue;
+        const char *name = elf_sym_name(t, &t->sym[i]);
+        size_t      len  = strlen(name);
+        l->hits[l->n]    = name;
+        l->misses[l->n]  = buf;
+        memcpy(buf, name, len);
+        memcpy(buf + len, "_x", 3);
+        buf += len + 3;
+        l->n++;
+    }
+
+    l->n_lin      = l->n < linear_max ? l->n : linear_max;
+    l->lin_hits   = malloc((l->n_lin + 1) * sizeof(char *));
+    l->lin_misses = malloc((l->n_lin + 1) * sizeof(char *));
+    if (!l->lin_hits || !l->lin_misses) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    for (size_t i = 0; i < l->n_lin; i++) {
+        size_t k = i * l->n / l->n_lin;
+        l->lin_hits[i]   = l->hits[k];
+        l->lin_misses[i] = l->misses[k];
+    }
+    return 0;
+}
+
+static void unload(Lib *l, ElfFile *f)
+{
+    if (l->n) free((void *)l->misses[0]);
+    free(l->hits);
+    free(l->misses);
+    free(l->lin_hits);
+    free(l->lin_misses);
+    dlclose(l->handle);
+    elf_close(f);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Configuration and report
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--lib PATH]... [--reps R] [--linear-max N] [--format text|csv|json]\n",
+            argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--lib") == 0) {
+            if (cfg->n_libs == MAX_LIBS) return -1;
+            cfg->libs[cfg->n_libs++] = val;
+        } else if (strcmp(opt, "--reps") == 0) {
+            cfg->reps = atoi(val);
+        } else if (strcmp(opt, "--linear-max") == 0) {
+            cfg->linear_max = (size_t)strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->reps >= 1 && cfg->reps <= 64 && cfg->linear_max >= 1 ? 0 : -1;
+}
+
+typedef struct {
+    double hit_ns, miss_ns;
+    double strcmp_per_hit;
+    double bloom;               /* share of misses rejected; < 0: n/a */
+} Result;
+
+static void report(const Config *cfg, const char *path, const Lib *l, const Result *res,
+                   int bad, size_t unchecked, int *first)
+{
+    const char *file = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %s  (%s)\n", file, path);
+        printf("    %zu exported symbols", l->n);
+        if (l->r.gnu_buckets)
+            printf("; GNU: %u buckets, %u-word Bloom filter, shift %u", l->r.gnu_nbuckets,
+                   l->r.gnu_bloom_size, l->r.gnu_bloom_shift);
+        if (l->r.sysv_buckets) printf("; SysV: %u buckets", l->r.sysv_nbuckets);
+        printf("\n\n    %-24s %10s %10s %12s %8s\n", "method", "hit ns", "miss ns", "strcmp/hit", "bloom");
+        for (int m = 0; m < METHODS; m++) {
+            char label[40];
+            if (m == SYMRES_LINEAR)
+                snprintf(label, sizeof(label), "linear (%zu sampled)", l->n_lin);
+            else
+                snprintf(label, sizeof(label), "%s", method_name(m));
+            if (m < SYMRES_METHOD_COUNT && !symres_has(&l->r, (SymresMethod)m)) {
+                printf("    %-24s %10s %10s\n", label, "n/a", "n/a");
+                continue;
+            }
+            printf("    %-24s %10.1f %10.1f", label, res[m].hit_ns, res[m].miss_ns);
+            if (m == DLSYM) printf(" %12s", "");
+            else printf(" %12.2f", res[m].strcmp_per_hit);
+            if (res[m].bloom >= 0) printf(" %7.1f%%", 100 * res[m].bloom);
+            printf("\n");
+        }
+        printf("\n    %s (%zu IFUNC/TLS symbols checked only for being found)\n\n",
+               bad ? "RESULTS DIFFER" : "every method agrees with dlsym()", unchecked);
+        break;
+    case BENCH_FMT_CSV:
+        for (int m = 0; m < METHODS; m++) {
+            if (m < SYMRES_METHOD_COUNT && !symres_has(&l->r, (SymresMethod)m)) continue;
+            printf("%s,%zu,%s,%zu,%.2f,%.2f,%.3f,%.4f,%d\n", file, l->n, method_name(m),
+                   m == SYMRES_LINEAR ? l->n_lin : l->n, res[m].hit_ns, res[m].miss_ns,
+                   m == DLSYM ? 0.0 : res[m].strcmp_per_hit, res[m].bloom, bad == 0);
+        }
+        break;
+    case BENCH_FMT_JSON:
+        for (int m = 0; m < METHODS; m++) {
+            if (m < SYMRES_METHOD_COUNT && !symres_has(&l->r, (SymresMethod)m)) continue;
+            printf("%s\n    { \"library\": \"%s\", \"symbols\": %zu, \"method\": \"%s\", \"names\": %zu, "
+                   "\"hit_ns\": %.2f, \"miss_ns\": %.2f",
+                   *first ? "" : ",", file, l->n, method_name(m), m == SYMRES_LINEAR ? l->n_lin : l->n,
+                   res[m].hit_ns, res[m].miss_ns);
+            if (m != DLSYM) printf(", \"strcmp_per_hit\": %.3f", res[m].strcmp_per_hit);
+            if (res[m].bloom >= 0) printf(", \"bloom_reject_rate\": %.4f", res[m].bloom);
+            printf(", \"agrees\": %s }", bad ? "false" : "true");
+            *first = 0;
+        }
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { 0 }, 0, 11, 100, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* Defaults: this process's libc, and the generated library next to
+     * the binary */
+    static char libc_path[4096], synth_path[4096];
+    if (cfg.n_libs == 0) {
+        if (symres_mapped_path("libc.so.6", libc_path, sizeof(libc_path)) == 0)
+            cfg.libs[cfg.n_libs++] = libc_path;
+        const char *slash = strrchr(argv[0], '/');
+        int dir = slash ? (int)(slash - argv[0]) : 1;
+        snprintf(synth_path, sizeof(synth_path), "%.*s/libsymlib100k.so", dir, slash ? argv[0] : ".");
+        FILE *probe = fopen(synth_path, "rb");
+        if (probe) {
+            fclose(probe);
+            cfg.libs[cfg.n_libs++] = synth_path;
+        } else if (cfg.format == BENCH_FMT_TEXT) {
+            printf("(%s not found; make bench_symres builds it)\n", synth_path);
+        }
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_symres: %d reps, median ns per lookup; misses are each name + \"_x\"\n\n", cfg.reps);
+        break;
+    case BENCH_FMT_CSV:
+        printf("library,symbols,method,names,hit_ns,miss_ns,strcmp_per_hit,bloom_reject_rate,agrees\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"symres\",\n  \"results\": [");
+        break;
+    }
+
+    int all_ok = 1, first = 1;
+    for (int li = 0; li < cfg.n_libs; li++) {
+        Lib     l;
+        ElfFile f;
+        if (load(&l, &f, cfg.libs[li], cfg.linear_max) != 0) {
+            all_ok = 0;
+            continue;
+        }
+        size_t unchecked;
+        int    bad = check(&l, &unchecked);
+        all_ok &= bad == 0;
+
+        Result res[METHODS];
+        for (int m = 0; m < METHODS; m++) {
+            res[m].bloom = -1;
+            res[m].strcmp_per_hit = 0;
+            if (m < SYMRES_METHOD_COUNT && !symres_has(&l.r, (SymresMethod)m)) continue;
+            const char **hits   = m == SYMRES_LINEAR ? l.lin_hits : l.hits;
+            const char **misses = m == SYMRES_LINEAR ? l.lin_misses : l.misses;
+            size_t       n      = m == SYMRES_LINEAR ? l.n_lin : l.n;
+
+            res[m].hit_ns  = measure(&l, m, hits, n, cfg.reps);
+            res[m].miss_ns = measure(&l, m, misses, n, cfg.reps);
+            if (m == DLSYM) continue;
+
+            /* One counted pass of each for the per-lookup statistics */
+            memset(&l.r.stats, 0, sizeof(l.r.stats));
+            pass(&l, m, hits, n);
+            res[m].strcmp_per_hit = (double)l.r.stats.strcmps / (double)n;
+            if (m == SYMRES_GNU) {
+                memset(&l.r.stats, 0, sizeof(l.r.stats));
+                pass(&l, m, misses, n);
+                res[m].bloom = (double)l.r.stats.bloom_rejects / (double)n;
+            }
+        }
+        report(&cfg, cfg.libs[li], &l, res, bad, unchecked, &first);
+        unload(&l, &f);
+    }
+
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ],\n  \"agrees\": %s\n}\n", all_ok ? "true" : "false");
+    return all_ok ? 0 : 1;
+}
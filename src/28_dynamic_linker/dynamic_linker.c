@@ -2,13 +2,27 @@
  * ║  Chapter 28 — Dynamic Linker (ld-linux.so)                      ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: ld.so, PLT/GOT, lazy binding, symbol lookup            ║
- * ╚══════════════════════════════════════════════════════════════════╝ */
+ * ╚══════════════════════════════════════════════════════════════════╝
+ *
+ * Section 4 repeats dlsym()'s lookups by hand with symres.c, walking
+ * libm's DT_GNU_HASH table read from the file with chapter 24's ELF
+ * reader; bench_symres times the same lookups over whole libraries.
+ *
+ * Build: gcc -Wall -Wextra -std=c99 -Iinclude -o bin/28_dynamic_linker \
+ *            src/28_dynamic_linker/dynamic_linker.c src/28_dynamic_linker/symres.c \
+ *            src/24_assembler_elf/elf_reader.c -ldl
+ */
+
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <dlfcn.h>     /* dlopen, dlsym, dlclose */
 
+#include "symres.h"
+
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — What the Dynamic Linker Does
  * ════════════════════════════════════════════════════════════════════ */
@@ -131,6 +145,31 @@ static void demo_pic(void)
 /* ════════════════════════════════════════════════════════════════════
  *  Section 4 — dlopen / dlsym (Runtime Loading)
  * ════════════════════════════════════════════════════════════════════ */
+
+/* One DT_GNU_HASH lookup, step by step, as ld.so's do_lookup() does it */
+static void trace_gnu_lookup(SymResolver *r, const char *name)
+{
+    uint32_t h    = symres_gnu_hash(name);
+    uint32_t wi   = (h / 64) & (r->gnu_bloom_size - 1);
+    uint32_t b1   = h % 64, b2 = (h >> r->gnu_bloom_shift) % 64;
+    uint64_t word = r->gnu_bloom[wi];
+    int      pass = (word >> b1 & 1) && (word >> b2 & 1);
+
+    printf("    \"%s\": hash %#010x; Bloom word %u, bits %u and %u: %s\n", name, h, wi, b1, b2,
+           pass ? "both set" : "not both set → absent, no bucket read");
+    if (!pass) return;
+
+    uint32_t i = r->gnu_buckets[h % r->gnu_nbuckets];
+    printf("      bucket %u starts at .dynsym[%u]\n", h % r->gnu_nbuckets, i);
+    for (; i != 0; i++) {
+        uint32_t ch    = r->gnu_chain[i - r->gnu_symoffset];
+        int      match = (ch | 1) == (h | 1);
+        printf("      [%u] hash %#010x %-5s %s\n", i, ch & ~1u, match ? "equal" : "",
+               match ? symres_name(r, &r->dynsym->sym[i]) : "");
+        if ((match && strcmp(symres_name(r, &r->dynsym->sym[i]), name) == 0) || (ch & 1)) break;
+    }
+}
+
 static void demo_dlopen(void)
 {
     printf("\n╔══════════════════════════════════════════════════════════╗\n");
@@ -154,6 +193,52 @@ static void demo_dlopen(void)
             printf("    cos(0.0) = %f\n", cosine(0.0));
             printf("    sin(1.5708) = %f  (approx pi/2)\n", sine(1.5708));
         }
+
+        /* The same lookups by hand, from libm's file */
+        char    path[4096];
+        ElfFile f;
+        SymResolver r;
+        if (symres_mapped_path("libm.so.6", path, sizeof(path)) == 0 && elf_open(&f, path) == 0) {
+            if (symres_init(&r, &f) == 0 && symres_has(&r, SYMRES_GNU)) {
+                printf("\n  The same lookups by hand, in %s\n", path);
+                printf("  (%u .dynsym entries, %u GNU hash buckets, %u-word Bloom filter):\n\n",
+                       r.dynsym->count, r.gnu_nbuckets, r.gnu_bloom_size);
+                trace_gnu_lookup(&r, "cos");
+                trace_gnu_lookup(&r, "cosine");
+
+                /* load bias = where dlsym() found a plain (non-IFUNC) symbol
+                 * minus its st_value */
+                uintptr_t bias = 0;
+                for (uint32_t i = 1; i < r.dynsym->count && !bias; i++) {
+                    const Elf64_Sym *s = &r.dynsym->sym[i];
+                    unsigned type = ELF64_ST_TYPE(s->st_info);
+                    void    *addr;
+                    if (symres_exported(&r, i) && (type == STT_FUNC || type == STT_OBJECT) &&
+                        (addr = dlsym(handle, symres_name(&r, s))) != NULL)
+                        bias = (uintptr_t)addr - (uintptr_t)s->st_value;
+                }
+                printf("\n    libm's load bias: %#lx\n", (unsigned long)bias);
+                const char *names[] = { "cos", "sin", "sqrt", "ldexp" };
+                for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+                    const Elf64_Sym *s    = symres_lookup(&r, SYMRES_GNU, names[i]);
+                    void            *addr = dlsym(handle, names[i]);
+                    if (!s || !addr) continue;
+                    if (ELF64_ST_TYPE(s->st_info) == STT_GNU_IFUNC)
+                        printf("    %-6s IFUNC: st_value %#llx is its resolver; dlsym() ran it and got\n"
+                               "           bias + %#lx, the variant chosen for this CPU\n",
+                               names[i], (unsigned long long)s->st_value,
+                               (unsigned long)((uintptr_t)addr - bias));
+                    else
+                        printf("    %-6s st_value %#llx + bias %s dlsym()'s %p\n", names[i],
+                               (unsigned long long)s->st_value,
+                               (uintptr_t)addr == bias + (uintptr_t)s->st_value ? "==" : "!=", addr);
+                }
+                printf("\n    Without DT_GNU_HASH: DT_HASH (%s here), else a scan of\n",
+                       symres_has(&r, SYMRES_SYSV) ? "present" : "absent");
+                printf("    every .dynsym entry.  make bench_symres times all three.\n");
+            }
+            elf_close(&f);
+        }
         dlclose(handle);
     } else {
         printf("  (dlopen demo skipped: %s)\n", dlerror());
@@ -0,0 +1,52 @@
+/*
+ * Chapter 28 — Generate a shared library with many exported symbols
+ *
+ * Writes C source for N exported symbols to stdout, named like a large
+ * plugin's API (module_noun_verb_suffix, 15 to 35 characters), one in
+ * eight a function and the rest data.  The Makefile compiles it into
+ * bin/libsymlib100k.so with both DT_GNU_HASH and DT_HASH for
+ * bench_symres.
+ *
+ * Build: make bench_symres
+ * Run:   ./bin/gen_symlib [N] > symlib.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *modules[] = { "gfx", "net", "audio", "storage", "ui", "script", "physics", "db" };
+static const char *nouns[]   = { "buffer", "texture", "socket", "stream", "widget", "queue",
+                                 "context", "session", "cache", "shader", "entity", "record" };
+static const char *verbs[]   = { "create", "destroy", "bind", "update", "flush", "resolve",
+                                 "serialize", "lookup", "attach", "release" };
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+int main(int argc, char *argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 100000;
+    if (n <= 0) {
+        fprintf(stderr, "usage: %s [N]\n", argv[0]);
+        return 1;
+    }
+
+    printf("/* Generated by gen_symlib: %ld exported symbols */\n\n", n);
+    for (long i = 0; i < n; i++) {
+        /* A multiplicative hash spreads the word choices; the index in
+         * base 36 keeps every name unique */
+        unsigned long h = (unsigned long)i * 2654435761ul;
+        char          suffix[16];
+        int           k = 0;
+        for (long v = i; k == 0 || v > 0; v /= 36) suffix[k++] = "0123456789abcdefghijklmnopqrstuvwxyz"[v % 36];
+        suffix[k] = '\0';
+
+        const char *m = modules[h % COUNT(modules)];
+        const char *o = nouns[(h >> 8) % COUNT(nouns)];
+        const char *v = verbs[(h >> 16) % COUNT(verbs)];
+        if (i % 8 == 0)
+            printf("int %s_%s_%s_%s(int x) { return x + %ld; }\n", m, o, v, suffix, i % 1000);
+        else
+            printf("int %s_%s_%s_%s = %ld;\n", m, o, v, suffix, i);
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * Chapter 28 — Resolving a symbol the way ld.so does
+ *
+ * See symres.h.  symres_init() checks that each table lies inside the
+ * file and that every symbol index it can produce is inside .dynsym, so
+ * the lookups themselves bound nothing but their loops.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "symres.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/* ════════════════════════════════════════════════════════════════
+ *  Setup
+ * ════════════════════════════════════════════════════════════════ */
+
+static uint64_t dyn_value(const ElfFile *f, int64_t tag)
+{
+    uint32_t         n;
+    const Elf64_Dyn *d = elf_dynamic(f, &n);
+    for (uint32_t i = 0; d && i < n; i++)
+        if (d[i].d_tag == tag) return d[i].d_un.d_val;
+    return 0;
+}
+
+/* The DT_GNU_HASH layout, ELFCLASS64:
+ *   nbuckets, symoffset, bloom_size, bloom_shift      4 × uint32_t
+ *   bloom[bloom_size]                                 uint64_t
+ *   buckets[nbuckets]                                 uint32_t
+ *   chain[symbols - symoffset]                        uint32_t
+ * chain[i - symoffset] is symbol i's hash with bit 0 replaced by
+ * "last in its bucket" */
+static void init_gnu(SymResolver *r, uint64_t addr)
+{
+    const uint32_t *h = elf_vaddr(r->elf, addr, 16);
+    if (!h || addr % 8 != 0) return;
+    uint32_t nbuckets = h[0], symoffset = h[1], bloom_size = h[2], shift = h[3];
+    uint32_t count    = r->dynsym->count;
+    if (nbuckets == 0 || symoffset > count || bloom_size == 0 || (bloom_size & (bloom_size - 1)) ||
+        shift >= 64)
+        return;
+    uint64_t size = 16 + (uint64_t)bloom_size * 8 + ((uint64_t)nbuckets + (count - symoffset)) * 4;
+    const uint8_t *p = elf_vaddr(r->elf, addr, size);
+    if (!p) return;
+
+    const uint32_t *buckets = (const uint32_t *)(const void *)(p + 16 + (uint64_t)bloom_size * 8);
+    for (uint32_t b = 0; b < nbuckets; b++)
+        if (buckets[b] != 0 && (buckets[b] < symoffset || buckets[b] >= count)) return;
+    /* Every chain must end inside .dynsym */
+    const uint32_t *chain = buckets + nbuckets;
+    if (count > symoffset && !(chain[count - symoffset - 1] & 1)) return;
+
+    r->gnu_nbuckets    = nbuckets;
+    r->gnu_symoffset   = symoffset;
+    r->gnu_bloom_size  = bloom_size;
+    r->gnu_bloom_shift = shift;
+    r->gnu_bloom       = (const uint64_t *)(const void *)(p + 16);
+    r->gnu_buckets     = buckets;
+    r->gnu_chain       = chain;
+}
+
+/* DT_HASH: nbucket, nchain, bucket[nbucket], chain[nchain], all uint32_t */
+static void init_sysv(SymResolver *r, uint64_t addr)
+{
+    const uint32_t *h = elf_vaddr(r->elf, addr, 8);
+    if (!h || addr % 4 != 0) return;
+    uint32_t nbuckets = h[0], nchain = h[1];
+    if (nbuckets == 0 || nchain > r->dynsym->count) return;
+    if (!elf_vaddr(r->elf, addr, 8 + ((uint64_t)nbuckets + nchain) * 4)) return;
+    for (uint64_t i = 0; i < (uint64_t)nbuckets + nchain; i++)
+        if (h[2 + i] >= nchain) return;
+    r->sysv_nbuckets = nbuckets;
+    r->sysv_nchain   = nchain;
+    r->sysv_buckets  = h + 2;
+    r->sysv_chain    = h + 2 + nbuckets;
+}
+
+int symres_init(SymResolver *r, const ElfFile *f)
+{
+    memset(r, 0, sizeof(*r));
+    r->elf    = f;
+    r->dynsym = elf_symtab(f, ELF_DYNSYM);
+    if (r->dynsym->count == 0) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    uint64_t vs = dyn_value(f, DT_VERSYM);
+    if (vs && vs % 2 == 0) r->versym = elf_vaddr(f, vs, (uint64_t)r->dynsym->count * 2);
+
+    uint64_t gnu = dyn_value(f, DT_GNU_HASH), sysv = dyn_value(f, DT_HASH);
+    if (gnu)  init_gnu(r, gnu);
+    if (sysv) init_sysv(r, sysv);
+    return 0;
+}
+
+int symres_has(const SymResolver *r, SymresMethod m)
+{
+    switch (m) {
+    case SYMRES_GNU:    return r->gnu_buckets != NULL;
+    case SYMRES_SYSV:   return r->sysv_buckets != NULL;
+    case SYMRES_LINEAR: return 1;
+    default:            return 0;
+    }
+}
+
+SymresMethod symres_best(const SymResolver *r)
+{
+    return r->gnu_buckets ? SYMRES_GNU : r->sysv_buckets ? SYMRES_SYSV : SYMRES_LINEAR;
+}
+
+const char *symres_method_name(SymresMethod m)
+{
+    static const char *names[] = { "gnu-hash", "sysv-hash", "linear" };
+    return (unsigned)m < SYMRES_METHOD_COUNT ? names[m] : "?";
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Matching
+ * ════════════════════════════════════════════════════════════════ */
+
+uint32_t symres_gnu_hash(const char *name)
+{
+    uint32_t h = 5381;
+    for (const unsigned char *s = (const unsigned char *)name; *s; s++) h = h * 33 + *s;
+    return h;
+}
+
+uint32_t symres_sysv_hash(const char *name)
+{
+    uint32_t h = 0;
+    for (const unsigned char *s = (const unsigned char *)name; *s; s++) {
+        h = (h << 4) + *s;
+        uint32_t g = h & 0xf0000000u;
+        if (g) h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+int symres_exported(const SymResolver *r, uint32_t i)
+{
+    const Elf64_Sym *s    = &r->dynsym->sym[i];
+    unsigned         bind = ELF64_ST_BIND(s->st_info), type = ELF64_ST_TYPE(s->st_info);
+    if (s->st_shndx == SHN_UNDEF || (s->st_value == 0 && type != STT_TLS)) return 0;
+    if (bind != STB_GLOBAL && bind != STB_WEAK && bind != STB_GNU_UNIQUE) return 0;
+    if (type == STT_SECTION || type == STT_FILE) return 0;
+    /* Index 0 is local; bit 15 marks a non-default (name@VERSION) one */
+    return !r->versym || ((r->versym[i] & 0x7fff) != 0 && !(r->versym[i] & 0x8000));
+}
+
+static int name_is(SymResolver *r, uint32_t i, const char *name)
+{
+    r->stats.strcmps++;
+    return strcmp(elf_sym_name(r->dynsym, &r->dynsym->sym[i]), name) == 0;
+}
+
+const char *symres_name(const SymResolver *r, const Elf64_Sym *s)
+{
+    return elf_sym_name(r->dynsym, s);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The three lookups
+ * ════════════════════════════════════════════════════════════════ */
+
+static const Elf64_Sym *lookup_gnu(SymResolver *r, const char *name)
+{
+    uint32_t h = symres_gnu_hash(name);
+
+    /* Bloom filter: two bits of one word, picked by h and h >> shift;
+     * if either is clear no symbol has this hash */
+    uint64_t word = r->gnu_bloom[(h / 64) & (r->gnu_bloom_size - 1)];
+    uint64_t mask = (uint64_t)1 << (h % 64) | (uint64_t)1 << ((h >> r->gnu_bloom_shift) % 64);
+    if ((word & mask) != mask) {
+        r->stats.bloom_rejects++;
+        return NULL;
+    }
+
+    uint32_t i = r->gnu_buckets[h % r->gnu_nbuckets];
+    if (i == 0) {
+        r->stats.empty_buckets++;
+        return NULL;
+    }
+    /* The bucket's symbols are consecutive; compare hashes (ignoring
+     * the end-of-chain bit) before names */
+    for (;; i++) {
+        uint32_t ch = r->gnu_chain[i - r->gnu_symoffset];
+        r->stats.chain_steps++;
+        if ((ch | 1) == (h | 1) && name_is(r, i, name) && symres_exported(r, i))
+            return &r->dynsym->sym[i];
+        if (ch & 1) return NULL;
+    }
+}
+
+static const Elf64_Sym *lookup_sysv(SymResolver *r, const char *name)
+{
+    uint32_t i = r->sysv_buckets[symres_sysv_hash(name) % r->sysv_nbuckets];
+    if (i == 0) {
+        r->stats.empty_buckets++;
+        return NULL;
+    }
+    /* A chain cannot be longer than the table; stop a looping one */
+    for (uint32_t steps = 0; i != 0 && steps < r->sysv_nchain; i = r->sysv_chain[i], steps++) {
+        r->stats.chain_steps++;
+        if (name_is(r, i, name) && symres_exported(r, i)) return &r->dynsym->sym[i];
+    }
+    return NULL;
+}
+
+static const Elf64_Sym *lookup_linear(SymResolver *r, const char *name)
+{
+    for (uint32_t i = 1; i < r->dynsym->count; i++)
+        if (name_is(r, i, name) && symres_exported(r, i)) return &r->dynsym->sym[i];
+    return NULL;
+}
+
+const Elf64_Sym *symres_lookup(SymResolver *r, SymresMethod m, const char *name)
+{
+    if (!symres_has(r, m)) return NULL;
+    r->stats.lookups++;
+    switch (m) {
+    case SYMRES_GNU:  return lookup_gnu(r, name);
+    case SYMRES_SYSV: return lookup_sysv(r, name);
+    default:          return lookup_linear(r, name);
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Finding a loaded object's file
+ * ════════════════════════════════════════════════════════════════ */
+
+int symres_mapped_path(const char *file, char *path, size_t size)
+{
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (!maps) return -1;
+
+    char   line[4096];
+    size_t flen = strlen(file);
+    int    found = 0;
+    while (!found && fgets(line, sizeof(line), maps)) {
+        char *p = strchr(line, '/');
+        if (!p) continue;
+        p[strcspn(p, "\n")] = '\0';
+        size_t plen = strlen(p);
+        if (plen > flen && p[plen - flen - 1] == '/' && strcmp(p + plen - flen, file) == 0 && plen < size) {
+            memcpy(path, p, plen + 1);
+            found = 1;
+        }
+    }
+    fclose(maps);
+    if (!found) errno = ENOENT;
+    return found ? 0 : -1;
+}
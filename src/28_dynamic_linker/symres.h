@@ -0,0 +1,84 @@
+/*
+ * Chapter 28 — Resolving a symbol the way ld.so does
+ *
+ * Given a shared object opened with chapter 24's ELF reader, find an
+ * exported symbol by name with one of three methods:
+ *
+ *   SYMRES_GNU     DT_GNU_HASH: a Bloom filter rejects most misses after
+ *                  one 64-bit load; a hit, or a false positive, walks one
+ *                  bucket's chain, where symbols of equal hash sit next
+ *                  to each other and comparing 31-bit hashes saves most
+ *                  strcmp() calls.  What binutils and glibc emit today.
+ *   SYMRES_SYSV    DT_HASH: the original ELF hash table, one bucket and
+ *                  a linked chain, a strcmp() per entry
+ *   SYMRES_LINEAR  every .dynsym entry in turn — what is left when a
+ *                  file has neither table
+ *
+ * A symbol matches as ld.so's do_lookup() would for an unversioned
+ * dlsym(): defined, GLOBAL, WEAK or GNU_UNIQUE, and not a hidden
+ * version (memcpy@GLIBC_2.2.5 loses to memcpy@@GLIBC_2.14).  All three
+ * methods return the same entry for every name.
+ *
+ * Everything is read in place from the ElfFile's mapping; the hash
+ * tables are found through the dynamic section's DT_* addresses, as the
+ * loader finds them.
+ */
+
+#ifndef SYMRES_H
+#define SYMRES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../24_assembler_elf/elf_reader.h"
+
+typedef enum { SYMRES_GNU, SYMRES_SYSV, SYMRES_LINEAR, SYMRES_METHOD_COUNT } SymresMethod;
+
+/* Counters every lookup adds to; clear them with memset */
+typedef struct {
+    uint64_t lookups;
+    uint64_t bloom_rejects;     /* SYMRES_GNU: misses answered by the filter */
+    uint64_t empty_buckets;     /* misses answered by an empty bucket */
+    uint64_t chain_steps;       /* hash table entries examined */
+    uint64_t strcmps;
+} SymresStats;
+
+typedef struct {
+    const ElfFile   *elf;
+    const ElfSymtab *dynsym;
+    const uint16_t  *versym;            /* NULL: unversioned */
+
+    /* DT_GNU_HASH; gnu_buckets NULL: absent */
+    uint32_t         gnu_nbuckets, gnu_symoffset, gnu_bloom_size, gnu_bloom_shift;
+    const uint64_t  *gnu_bloom;
+    const uint32_t  *gnu_buckets, *gnu_chain;
+
+    /* DT_HASH; sysv_buckets NULL: absent */
+    uint32_t         sysv_nbuckets, sysv_nchain;
+    const uint32_t  *sysv_buckets, *sysv_chain;
+
+    SymresStats      stats;
+} SymResolver;
+
+/* 0, or -1 with errno = ENOENT if f has no .dynsym */
+int  symres_init(SymResolver *r, const ElfFile *f);
+int  symres_has(const SymResolver *r, SymresMethod m);
+/* The best method f supports: GNU, else SYSV, else LINEAR */
+SymresMethod symres_best(const SymResolver *r);
+const char  *symres_method_name(SymresMethod m);
+
+/* NULL: not exported (or m is not available) */
+const Elf64_Sym *symres_lookup(SymResolver *r, SymresMethod m, const char *name);
+const char      *symres_name(const SymResolver *r, const Elf64_Sym *s);
+
+uint32_t symres_gnu_hash(const char *name);     /* h = h * 33 + c, from 5381 */
+uint32_t symres_sysv_hash(const char *name);    /* the System V ABI's elf_hash() */
+
+/* Is this .dynsym entry one a lookup may return? */
+int  symres_exported(const SymResolver *r, uint32_t index);
+
+/* The path of the loaded object whose file name is `file` (for example
+ * "libc.so.6"), from /proc/self/maps: 0, or -1 with errno = ENOENT */
+int  symres_mapped_path(const char *file, char *path, size_t size);
+
+#endif /* SYMRES_H */
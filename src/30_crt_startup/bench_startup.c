@@ -0,0 +1,360 @@
+/*
+ * Startup latency benchmark — lazy binding, -z now, -static, -static-pie
+ *
+ * Launches startup_sample, built four ways, --runs times each (the
+ * variants take turns, so drift in the machine hits all four alike) and
+ * reports, from the parent's timestamp just before posix_spawn():
+ *
+ *   to ctor    until the first constructor runs: exec, the kernel's
+ *              loading, ld.so or the static start code, libc's setup
+ *   ctors      the constructors themselves
+ *   to main    until main() — what a short-lived worker pays to start
+ *   total      until waitpid() returns, exit and reaping included
+ *   faults     minor page faults counted by the time main() runs
+ *
+ * and the relocations each variant processes: those in its own file
+ * (read with chapter 24's ELF reader) and, for the dynamic two, ld.so's
+ * own count from LD_DEBUG=statistics, at startup and by exit; lazy
+ * binding defers the JUMP_SLOT entries until a call needs them.
+ *
+ * Build: make bench_startup
+ * Run:   ./bin/bench_startup [--runs N] [--dir DIR] [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../../include/bench.h"
+#include "../24_assembler_elf/elf_reader.h"
+#include "bench_startup.h"
+
+#define WARMUP 20
+
+typedef struct {
+    const char *name, *file, *what;
+    int         dynamic;
+} Variant;
+
+static const Variant variants[] = {
+    { "lazy",       "startup_lazy",       "dynamic, lazy PLT binding", 1 },
+    { "now",        "startup_now",        "dynamic, -z now",           1 },
+    { "static",     "startup_static",     "-static",                   0 },
+    { "static-pie", "startup_static_pie", "-static-pie",               0 },
+};
+#define VARIANT_COUNT ((int)(sizeof(variants) / sizeof(variants[0])))
+
+typedef struct {
+    char      path[4096 + 32];
+    int       present;
+    /* Relocations in the file */
+    uint64_t  relocs, jump_slots, relative;
+    /* ld.so's count; -1: not dynamic, or LD_DEBUG said nothing */
+    long      ldso_startup, ldso_final;
+    /* Per run, in ns (faults: a count) */
+    uint64_t *to_ctor, *ctors, *to_main, *total, *faults;
+    int       n;
+} Result;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Running one child
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Spawn path with envp, its fd 3 (and fd 2, if err_fd >= 0) redirected;
+ * t0 is taken just before the spawn.  0, or -1 if it could not run or
+ * failed */
+static int run_child(const char *path, char *const envp[], int report_fd, int err_fd, uint64_t *t0,
+                     uint64_t *t_end)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, report_fd, 3);
+    if (err_fd >= 0) posix_spawn_file_actions_adddup2(&fa, err_fd, 2);
+
+    char *argv[] = { (char *)path, NULL };
+    pid_t pid;
+    *t0 = bench_now_ns();
+    int rc = posix_spawn(&pid, path, &fa, NULL, argv, envp);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) return -1;
+    *t_end = bench_now_ns();
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* Whatever a child left in a pipe we hold the read end of */
+static ssize_t drain(int fd, void *buf, size_t size)
+{
+    size_t got = 0;
+    for (;;) {
+        ssize_t n = read(fd, (char *)buf + got, size - got);
+        if (n <= 0) return got ? (ssize_t)got : n;
+        got += (size_t)n;
+        if (got == size) return (ssize_t)got;
+    }
+}
+
+static int make_pipe(int p[2])
+{
+    if (pipe(p) != 0) return -1;
+    fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Relocation counts
+ * ════════════════════════════════════════════════════════════════ */
+
+static void count_file_relocs(Result *r)
+{
+    ElfFile f;
+    if (elf_open(&f, r->path) != 0) return;
+    for (uint32_t i = 1; i < f.n_sh; i++) {
+        ElfRelocs rel;
+        if (elf_relocs(&f, elf_section(&f, i), &rel) != 0) continue;
+        r->relocs += rel.count;
+        for (uint64_t k = 0; k < rel.count; k++) {
+            ElfReloc e;
+            elf_reloc(&rel, k, &e);
+            const char *t = elf_reloc_type_name(f.eh->e_machine, e.type);
+            /* Names come without the R_X86_64_ / R_AARCH64_ prefix */
+            r->jump_slots += strcmp(t, "JUMP_SLOT") == 0;
+            r->relative   += strcmp(t, "RELATIVE") == 0 || strcmp(t, "IRELATIVE") == 0;
+        }
+    }
+    elf_close(&f);
+}
+
+/* The number after `label` in ld.so's statistics, or -1 */
+static long find_count(const char *text, const char *label)
+{
+    const char *p = strstr(text, label);
+    return p ? strtol(p + strlen(label), NULL, 10) : -1;
+}
+
+static void ldso_statistics(Result *r)
+{
+    int rep[2], err[2];
+    if (make_pipe(rep) != 0) return;
+    if (make_pipe(err) != 0) {
+        close(rep[0]);
+        close(rep[1]);
+        return;
+    }
+    char    *envp[] = { "LD_DEBUG=statistics", "STARTUP_FD=3", NULL };
+    uint64_t t0, t1;
+    char     text[16384];
+    ssize_t  n = 0;
+    if (run_child(r->path, envp, rep[1], err[1], &t0, &t1) == 0)
+        n = drain(err[0], text, sizeof(text) - 1);
+    text[n > 0 ? n : 0] = '\0';
+    /* "number of relocations:" first appears in the startup block;
+     * "final number of relocations:" is printed at exit */
+    r->ldso_startup = find_count(text, " number of relocations:");
+    r->ldso_final   = find_count(text, "final number of relocations:");
+    close(rep[0]); close(rep[1]); close(err[0]); close(err[1]);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Configuration and report
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    int            runs;
+    const char    *dir;
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--runs N] [--dir DIR] [--format text|csv|json]\n", argv0);
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--runs") == 0) {
+            cfg->runs = atoi(val);
+        } else if (strcmp(opt, "--dir") == 0) {
+            cfg->dir = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->runs >= 1 ? 0 : -1;
+}
+
+/* Median of a copy (bench_percentile() sorts in place) */
+static double pct(const uint64_t *v, int n, double p)
+{
+    uint64_t *c = malloc((size_t)n * sizeof(*c));
+    if (!c) return 0;
+    memcpy(c, v, (size_t)n * sizeof(*c));
+    uint64_t x = bench_percentile(c, (size_t)n, p);
+    free(c);
+    return (double)x;
+}
+
+static void report(const Config *cfg, const Variant *v, const Result *r, int *first)
+{
+    double to_ctor = pct(r->to_ctor, r->n, 50) / 1e3, ctors = pct(r->ctors, r->n, 50) / 1e3;
+    double to_main = pct(r->to_main, r->n, 50) / 1e3, p99 = pct(r->to_main, r->n, 99) / 1e3;
+    double total   = pct(r->total, r->n, 50) / 1e3, faults = pct(r->faults, r->n, 50);
+
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT: {
+        char ldso[32] = "-";
+        if (r->ldso_startup >= 0)
+            snprintf(ldso, sizeof(ldso), "%ld / %ld", r->ldso_startup, r->ldso_final);
+        printf("  %-10s %9.1f %8.1f %9.1f %9.1f %9.1f %7.0f  %7llu %6llu  %-13s\n", v->name, to_ctor,
+               ctors, to_main, p99, total, faults, (unsigned long long)r->relocs,
+               (unsigned long long)r->jump_slots, ldso);
+        break;
+    }
+    case BENCH_FMT_CSV:
+        printf("%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f,%llu,%llu,%llu,%ld,%ld\n", v->name, r->n, to_ctor,
+               ctors, to_main, p99, total, faults, (unsigned long long)r->relocs,
+               (unsigned long long)r->jump_slots, (unsigned long long)r->relative, r->ldso_startup,
+               r->ldso_final);
+        break;
+    case BENCH_FMT_JSON:
+        printf("%s\n    { \"variant\": \"%s\", \"runs\": %d, \"to_ctor_us\": %.2f, \"ctors_us\": %.2f, "
+               "\"to_main_us\": %.2f, \"to_main_p99_us\": %.2f, \"total_us\": %.2f, \"minor_faults\": %.0f, "
+               "\"file_relocs\": %llu, \"jump_slots\": %llu, \"relative\": %llu, "
+               "\"ldso_relocs_startup\": %ld, \"ldso_relocs_final\": %ld }",
+               *first ? "" : ",", v->name, r->n, to_ctor, ctors, to_main, p99, total, faults,
+               (unsigned long long)r->relocs, (unsigned long long)r->jump_slots,
+               (unsigned long long)r->relative, r->ldso_startup, r->ldso_final);
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 2000, NULL, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* The variants live next to this binary unless --dir says otherwise */
+    char        dir[4096];
+    const char *slash = strrchr(argv[0], '/');
+    if (cfg.dir) snprintf(dir, sizeof(dir), "%s", cfg.dir);
+    else if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - argv[0]), argv[0]);
+    else snprintf(dir, sizeof(dir), ".");
+
+    Result res[VARIANT_COUNT];
+    int    any = 0;
+    for (int v = 0; v < VARIANT_COUNT; v++) {
+        Result *r = &res[v];
+        memset(r, 0, sizeof(*r));
+        r->ldso_startup = r->ldso_final = -1;
+        snprintf(r->path, sizeof(r->path), "%s/%s", dir, variants[v].file);
+        r->present = access(r->path, X_OK) == 0;
+        if (!r->present) {
+            fprintf(stderr, "%s: not found (make bench_startup builds it); skipped\n", r->path);
+            continue;
+        }
+        any = 1;
+        count_file_relocs(r);
+        if (variants[v].dynamic) ldso_statistics(r);
+        r->to_ctor = malloc((size_t)cfg.runs * sizeof(uint64_t));
+        r->ctors   = malloc((size_t)cfg.runs * sizeof(uint64_t));
+        r->to_main = malloc((size_t)cfg.runs * sizeof(uint64_t));
+        r->total   = malloc((size_t)cfg.runs * sizeof(uint64_t));
+        r->faults  = malloc((size_t)cfg.runs * sizeof(uint64_t));
+        if (!r->to_ctor || !r->ctors || !r->to_main || !r->total || !r->faults) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    if (!any) return 1;
+
+    int rep[2];
+    if (make_pipe(rep) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    char *envp[] = { "STARTUP_FD=3", NULL };
+    int   failed = 0;
+    for (int run = -WARMUP; run < cfg.runs; run++) {
+        for (int v = 0; v < VARIANT_COUNT; v++) {
+            Result *r = &res[v];
+            if (!r->present) continue;
+            uint64_t      t0, t_end;
+            StartupReport s;
+            if (run_child(r->path, envp, rep[1], -1, &t0, &t_end) != 0 ||
+                drain(rep[0], &s, sizeof(s)) != (ssize_t)sizeof(s)) {
+                failed++;
+                continue;
+            }
+            if (run < 0) continue;
+            r->to_ctor[r->n] = s.t_ctor_first - t0;
+            r->ctors[r->n]   = s.t_ctor_done - s.t_ctor_first;
+            r->to_main[r->n] = s.t_main - t0;
+            r->total[r->n]   = t_end - t0;
+            r->faults[r->n]  = s.minflt;
+            r->n++;
+        }
+    }
+    close(rep[0]);
+    close(rep[1]);
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_startup: %d runs per variant, median us from the parent's posix_spawn()\n\n", cfg.runs);
+        printf("  %-10s %9s %8s %9s %9s %9s %7s  %7s %6s  %-13s\n", "variant", "to ctor", "ctors",
+               "to main", "main p99", "total", "faults", "relocs", "JUMP_", "ld.so relocs");
+        printf("  %-10s %9s %8s %9s %9s %9s %7s  %7s %6s  %-13s\n", "", "us", "us", "us", "us", "us",
+               "minor", "in file", "SLOT", "start / exit");
+        break;
+    case BENCH_FMT_CSV:
+        printf("variant,runs,to_ctor_us,ctors_us,to_main_us,to_main_p99_us,total_us,minor_faults,"
+               "file_relocs,jump_slots,relative,ldso_relocs_startup,ldso_relocs_final\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"startup\",\n  \"results\": [");
+        break;
+    }
+    int first = 1;
+    for (int v = 0; v < VARIANT_COUNT; v++)
+        if (res[v].present && res[v].n > 0) report(&cfg, &variants[v], &res[v], &first);
+
+    if (cfg.format == BENCH_FMT_JSON)
+        printf("\n  ],\n  \"failed_runs\": %d\n}\n", failed);
+    else if (cfg.format == BENCH_FMT_TEXT) {
+        printf("\n");
+        for (int v = 0; v < VARIANT_COUNT; v++)
+            if (res[v].present) printf("  %-10s %s\n", variants[v].name, variants[v].what);
+        if (failed) printf("\n  %d runs FAILED\n", failed);
+    }
+
+    for (int v = 0; v < VARIANT_COUNT; v++) {
+        free(res[v].to_ctor);
+        free(res[v].ctors);
+        free(res[v].to_main);
+        free(res[v].total);
+        free(res[v].faults);
+    }
+    return failed ? 1 : 0;
+}
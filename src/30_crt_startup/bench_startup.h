@@ -0,0 +1,24 @@
+/*
+ * Chapter 30 — What startup_sample reports to bench_startup
+ *
+ * One fixed-size record, written once to the descriptor named by
+ * STARTUP_FD.  Times are CLOCK_MONOTONIC nanoseconds, the clock every
+ * process on the machine shares, so the parent can subtract its own
+ * timestamp from before posix_spawn().
+ */
+
+#ifndef BENCH_STARTUP_H
+#define BENCH_STARTUP_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t t_ctor_first;      /* entering the first constructor (priority 101) */
+    uint64_t t_ctor_done;       /* leaving the last one */
+    uint64_t t_main;            /* entering main() */
+    uint64_t minflt, majflt;    /* getrusage() page faults, at main() */
+    uint32_t check;             /* keeps the constructors' work alive */
+    uint32_t pad;
+} StartupReport;
+
+#endif /* BENCH_STARTUP_H */
@@ -267,6 +267,9 @@ static void demo_examine_crt(void)
     printf("║                                                         ║\n");
     printf("║  Trace startup calls:                                   ║\n");
     printf("║  strace -e trace=write ./crt_startup                    ║\n");
+    printf("║                                                         ║\n");
+    printf("║  Time all of it, four ways of linking:                  ║\n");
+    printf("║  make bench_startup && ./bin/bench_startup              ║\n");
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 }
 
@@ -0,0 +1,130 @@
+/*
+ * Chapter 30 — A short-lived worker, as bench_startup launches it
+ *
+ * Built four ways by the Makefile — dynamic with lazy binding, dynamic
+ * with -z now, -static and -static-pie — and otherwise identical:
+ *
+ *   - three constructors, the first at priority 101 so it runs before
+ *     any other, doing what a library's initialisation typically does
+ *     (fill a table, read the environment, allocate)
+ *   - references to some forty libc functions, of which a normal run
+ *     calls only a handful: with lazy binding the rest are never bound
+ *
+ * With STARTUP_FD set in its environment it writes one StartupReport
+ * (bench_startup.h) to that descriptor from main() and exits;
+ * otherwise it prints the same numbers.
+ *
+ * Build: make bench_startup
+ * Run:   ./bin/startup_lazy
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <ctype.h>
+#include <sys/resource.h>
+
+#include "bench_startup.h"
+
+static StartupReport report;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ── Constructors ─────────────────────────────────────────────── */
+
+static uint32_t crc_table[256];
+static char    *config;
+
+__attribute__((constructor(101)))
+static void first_init(void)
+{
+    report.t_ctor_first = now_ns();
+}
+
+__attribute__((constructor(200)))
+static void table_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+__attribute__((constructor))
+static void config_init(void)
+{
+    const char *home = getenv("HOME");
+    config = malloc(256);
+    if (config) snprintf(config, 256, "%s/.workerrc", home ? home : "/");
+    report.t_ctor_done = now_ns();
+}
+
+/* ── Rarely used code: bound only if called, under lazy binding ─ */
+
+static int rarely(char *argv[])
+{
+    char   buf[64];
+    double d = strtod(argv[1], NULL);
+    long   l = strtol(argv[1], NULL, 10);
+    int    n = 0;
+    n += (int)strlen(argv[1]) + (int)strnlen(argv[1], 8) + strncmp(argv[1], "x", 1);
+    n += (int)sqrt(d) + (int)floor(d) + (int)ceil(d) + (int)fabs(d) + (int)exp(d) + (int)log(d + 1);
+    n += (int)pow(d, 2) + (int)sin(d) + (int)cos(d) + (int)atan2(d, 1) + (int)fmod(d, 3);
+    n += isalpha((unsigned char)argv[1][0]) + isdigit((unsigned char)argv[1][0]) + toupper('a');
+    n += (int)labs(l) + abs((int)l) + atoi(argv[1]) + (int)atol(argv[1]);
+    n += snprintf(buf, sizeof(buf), "%ld", l) + sscanf(argv[1], "%d", &n);
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, argv[1], sizeof(buf) - 1);
+    n += (strchr(buf, 'a') != NULL) + (strrchr(buf, 'b') != NULL) + (strstr(buf, "c") != NULL);
+    n += (memchr(buf, 'd', sizeof(buf)) != NULL) + memcmp(buf, argv[1], 1) + (int)strspn(buf, "0123456789");
+    void *p = calloc(4, 4);
+    p = realloc(p, 64);
+    free(p);
+    fputs(buf, stderr);
+    fflush(stderr);
+    n += (int)time(NULL) % 2 + (int)getpid() % 2 + (int)sysconf(_SC_PAGESIZE) % 2;
+    return n;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  main
+ * ════════════════════════════════════════════════════════════════ */
+
+int main(int argc, char *argv[])
+{
+    report.t_main = now_ns();
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    report.minflt = (uint64_t)ru.ru_minflt;
+    report.majflt = (uint64_t)ru.ru_majflt;
+
+    if (argc > 1) report.check = (uint32_t)rarely(argv);
+    report.check ^= crc_table[255] ^ (uint32_t)(config != NULL);
+
+    const char *fd = getenv("STARTUP_FD");
+    if (fd) {
+        ssize_t w = write(atoi(fd), &report, sizeof(report));
+        free(config);
+        return w == (ssize_t)sizeof(report) ? 0 : 1;
+    }
+
+    printf("first constructor → main: %.1f us (constructors %.1f us)\n",
+           (double)(report.t_main - report.t_ctor_first) / 1e3,
+           (double)(report.t_ctor_done - report.t_ctor_first) / 1e3);
+    printf("page faults before main:  %llu minor, %llu major\n", (unsigned long long)report.minflt,
+           (unsigned long long)report.majflt);
+    free(config);
+    return 0;
+}
@@ -2,11 +2,17 @@
  * ║  Chapter 33 — Debugging Tools & Techniques                      ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: GDB, Valgrind, sanitizers, strace, objdump            ║
+ * ║          in-process hardware counters (perfctr.c)               ║
  * ╚══════════════════════════════════════════════════════════════════╝ */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "perfctr.h"
 
 /* ── Intentional bugs for debugging demos ────────────────────── */
 
@@ -268,6 +274,113 @@ static void demo_warnings(void)
     printf("  └─────────────────────┴──────────────────────────────────┘\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════════
+ *  Section 8 — In-Process Counters (perfctr)
+ * ════════════════════════════════════════════════════════════════════ */
+#define COUNTER_ELEMS (2u << 20)                /* 8 MB of uint32_t */
+
+static uint32_t xorshift32(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static volatile uint64_t counter_sink;
+
+static void *counted_sum(void *arg)
+{
+    const uint32_t *a   = arg;
+    uint64_t        sum = 0;
+    PERF_REGION_BEGIN("sum, 2 threads");
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++) sum += a[i];
+    PERF_REGION_END();
+    counter_sink += sum;
+    return NULL;
+}
+
+static int cmp_u32(const void *x, const void *y)
+{
+    uint32_t a = *(const uint32_t *)x, b = *(const uint32_t *)y;
+    return (a > b) - (a < b);
+}
+
+static void demo_perfctr(void)
+{
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8 — In-Process Counters (perfctr)              ║\n");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+
+    printf("  perf stat counts a whole run; perf_event_open() lets a\n");
+    printf("  program count its own regions:\n\n");
+    printf("    PERF_REGION_BEGIN(\"parse\");\n");
+    printf("    ... code ...\n");
+    printf("    PERF_REGION_END();\n");
+    printf("    perfctr_report(stdout);\n\n");
+
+    uint32_t *a    = malloc(COUNTER_ELEMS * sizeof(*a));
+    uint32_t *next = malloc(COUNTER_ELEMS * sizeof(*next));
+    if (!a || !next) {
+        free(a);
+        free(next);
+        return;
+    }
+
+    /* First touch of fresh heap pages: one fault per page             */
+    PERF_REGION_BEGIN("first touch");
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++) a[i] = i;
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++) next[i] = i;
+    PERF_REGION_END();
+
+    /* One random cycle through every element (Sattolo's shuffle)    */
+    uint32_t rng = 0x2545f491u;
+    for (uint32_t i = COUNTER_ELEMS - 1; i > 0; i--) {
+        uint32_t j = xorshift32(&rng) % i, t = next[i];
+        next[i] = next[j];
+        next[j] = t;
+    }
+
+    uint64_t sum = 0;
+    PERF_REGION_BEGIN("sequential walk");
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++) sum += next[i];
+    PERF_REGION_END();
+
+    PERF_REGION_BEGIN("random walk");
+    for (uint32_t i = 0, p = 0; i < COUNTER_ELEMS; i++) sum += p = next[p];
+    PERF_REGION_END();
+
+    /* The same test on random, then sorted, bytes; the empty asm keeps
+     * it a branch (-O2 would otherwise turn it into a cmov)          */
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++) a[i] = xorshift32(&rng) & 255;
+    PERF_REGION_BEGIN("unpredictable if");
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++)
+        if (a[i] < 128) { sum += a[i]; __asm__ volatile(""); }
+    PERF_REGION_END();
+    qsort(a, COUNTER_ELEMS, sizeof(*a), cmp_u32);
+    PERF_REGION_BEGIN("predictable if");
+    for (uint32_t i = 0; i < COUNTER_ELEMS; i++)
+        if (a[i] < 128) { sum += a[i]; __asm__ volatile(""); }
+    PERF_REGION_END();
+    counter_sink += sum;
+
+    /* Passes from different threads add up in the same region        */
+    pthread_t t[2];
+    int       started = 0;
+    for (; started < 2; started++)
+        if (pthread_create(&t[started], NULL, counted_sum, a) != 0) break;
+    for (int i = 0; i < started; i++) pthread_join(t[i], NULL);
+
+    perfctr_report(stdout);
+    printf("\n  Expect the random walk to miss the cache and the dTLB\n");
+    printf("  where the sequential one does not, and the if on random\n");
+    printf("  bytes to mispredict about once per two elements.\n\n");
+
+    free(a);
+    free(next);
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════════ */
@@ -285,6 +398,7 @@ int main(void)
     demo_strace();
     demo_binary_tools();
     demo_warnings();
+    demo_perfctr();
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 33 — Debugging Tools & Techniques\n");
@@ -0,0 +1,412 @@
+/*
+ * Chapter 33 — In-process hardware counters (perf_event_open)
+ *
+ * See perfctr.h.  Per thread: the hardware counters that opened form
+ * one group, led by the first of them, read in a single read() of
+ * PERF_FORMAT_GROUP — or, when every member's mmap page allows it, by
+ * rdpmc under the page's seqlock.  page-faults is a software event the
+ * PMU cannot host, so it has an fd of its own (or getrusage()).
+ */
+
+#define _GNU_SOURCE         /* syscall(), RUSAGE_THREAD */
+
+#include "perfctr.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ALL_COUNTERS ((1u << PERF_COUNTERS) - 1)
+
+static const struct {
+    const char *name;
+    uint32_t    type;
+    uint64_t    config;
+} events[PERF_COUNTERS] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "dTLB-load-misses", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+          PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+    { "page-faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+typedef struct {
+    int      opened;
+    int      fd[PERF_COUNTERS];             /* -1: not counted by perf */
+    int      group[PERF_COUNTERS];          /* hardware members, in read order */
+    int      n_group;
+    struct perf_event_mmap_page *page[PERF_COUNTERS];
+    int      rdpmc;                         /* every member has a usable page */
+    int      rusage_faults;                 /* page-faults from getrusage() */
+    unsigned valid;
+} PerfThread;
+
+static __thread PerfThread me;
+
+static pthread_once_t  key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   thread_key;
+
+/* Process-wide: the first thread to open sets the status */
+static pthread_mutex_t status_lock = PTHREAD_MUTEX_INITIALIZER;
+static char            status[256];
+static int             status_set;
+
+static pthread_mutex_t regions_lock = PTHREAD_MUTEX_INITIALIZER;
+static PerfRegion     *regions, **regions_tail = &regions;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Opening a thread's counters
+ * ════════════════════════════════════════════════════════════════ */
+
+static int open_event(int c, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = events[c].type;
+    attr.config         = events[c].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    if (events[c].type != PERF_TYPE_SOFTWARE)
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static const char *why(int err)
+{
+    switch (err) {
+    case EACCES:
+    case EPERM:     return "not permitted";
+    case ENOENT:
+    case EOPNOTSUPP:
+    case ENODEV:    return "no such event on this CPU (no PMU exposed, e.g. in a VM?)";
+    case ENOSYS:    return "perf_event_open() not supported";
+    default:        return strerror(err);
+    }
+}
+
+static size_t append(size_t len, const char *fmt, const char *arg)
+{
+    if (len >= sizeof(status)) return len;
+    int n = snprintf(status + len, sizeof(status) - len, fmt, arg);
+    return n < 0 ? len : len + (size_t)n;
+}
+
+static void set_status(unsigned missing, int err, int rusage_faults)
+{
+    pthread_mutex_lock(&status_lock);
+    if (!status_set) {
+        size_t len = 0;
+        for (int c = 0; c < PERF_COUNTERS; c++)
+            if (missing & 1u << c) len = append(len, len ? ", %s" : "%s", events[c].name);
+        if (missing) len = append(len, ": %s", why(err));
+        if (missing && (err == EACCES || err == EPERM)) {
+            FILE *f = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+            char  level[16];
+            if (f && fscanf(f, "%15s", level) == 1) len = append(len, " (perf_event_paranoid = %s)", level);
+            if (f) fclose(f);
+        }
+        if (rusage_faults) append(len, len ? "; %s" : "%s", "page-faults from getrusage()");
+        status_set = 1;
+    }
+    pthread_mutex_unlock(&status_lock);
+}
+
+static void close_thread(void *arg)
+{
+    PerfThread *t = arg;
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (t->page[c]) munmap(t->page[c], (size_t)sysconf(_SC_PAGESIZE));
+        if (t->fd[c] >= 0) close(t->fd[c]);
+        t->page[c] = NULL;
+        t->fd[c]   = -1;
+    }
+    t->valid = 0;
+}
+
+static void make_key(void)
+{
+    pthread_key_create(&thread_key, close_thread);
+}
+
+static void open_thread(PerfThread *t)
+{
+    int      leader  = -1, err = 0;
+    unsigned missing = 0;
+
+    t->opened  = 1;
+    t->n_group = 0;
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        t->fd[c]   = -1;
+        t->page[c] = NULL;
+        if (events[c].type == PERF_TYPE_SOFTWARE) continue;
+        int fd = open_event(c, leader);
+        if (fd < 0) {
+            if (!err) err = errno;
+            missing |= 1u << c;
+            continue;
+        }
+        if (leader < 0) leader = fd;
+        t->fd[c]                = fd;
+        t->group[t->n_group++]  = c;
+    }
+
+    t->fd[PERF_PAGE_FAULTS] = open_event(PERF_PAGE_FAULTS, -1);
+    t->rusage_faults        = t->fd[PERF_PAGE_FAULTS] < 0;
+
+    /* rdpmc only if every member can be read that way */
+    long pagesize = sysconf(_SC_PAGESIZE);
+    t->rdpmc      = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    t->rdpmc = t->n_group > 0;
+    for (int i = 0; i < t->n_group && t->rdpmc; i++) {
+        int   c = t->group[i];
+        void *p = mmap(NULL, (size_t)pagesize, PROT_READ, MAP_SHARED, t->fd[c], 0);
+        if (p == MAP_FAILED) {
+            t->rdpmc = 0;
+            break;
+        }
+        t->page[c] = p;
+        t->rdpmc   = t->page[c]->cap_user_rdpmc;
+    }
+#endif
+    t->valid = ALL_COUNTERS & ~missing;
+
+    pthread_once(&key_once, make_key);
+    pthread_setspecific(thread_key, t);
+    set_status(missing, err, t->rusage_faults);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Reading
+ * ════════════════════════════════════════════════════════════════ */
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return (uint64_t)hi << 32 | lo;
+}
+
+/* The event's count from user space; -1 if it is not on the PMU right now */
+static int read_rdpmc(const volatile struct perf_event_mmap_page *pc, uint64_t *out)
+{
+    uint32_t seq;
+    uint64_t count;
+    do {
+        seq = pc->lock;
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+        uint32_t index = pc->index;
+        if (!pc->cap_user_rdpmc || index == 0) return -1;
+        unsigned width = pc->pmc_width;
+        int64_t  pmc   = (int64_t)(rdpmc(index - 1) << (64 - width)) >> (64 - width);
+        count          = (uint64_t)((int64_t)pc->offset + pmc);
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+    } while (pc->lock != seq);
+    *out = count;
+    return 0;
+}
+#endif
+
+static int read_group(const PerfThread *t, PerfSample *s)
+{
+    uint64_t buf[3 + PERF_COUNTERS];
+    int      leader = t->fd[t->group[0]];
+    ssize_t  want   = (ssize_t)((3 + (size_t)t->n_group) * sizeof(uint64_t));
+    if (read(leader, buf, sizeof(buf)) < want || buf[0] != (uint64_t)t->n_group) return -1;
+
+    /* Scale up if the group was multiplexed off the PMU part of the time */
+    uint64_t enabled = buf[1], running = buf[2];
+    for (int i = 0; i < t->n_group; i++) {
+        uint64_t v = buf[3 + i];
+        if (running && running < enabled) v = (uint64_t)((double)v * (double)enabled / (double)running);
+        s->value[t->group[i]] = v;
+    }
+    return 0;
+}
+
+void perfctr_read(PerfSample *s)
+{
+    PerfThread *t = &me;
+    if (!t->opened) open_thread(t);
+
+    memset(s->value, 0, sizeof(s->value));
+    s->valid = t->valid;
+
+    if (t->n_group > 0) {
+        int done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if (t->rdpmc) {
+            done = 1;
+            for (int i = 0; i < t->n_group && done; i++)
+                done = read_rdpmc(t->page[t->group[i]], &s->value[t->group[i]]) == 0;
+        }
+#endif
+        if (!done && read_group(t, s) != 0) s->valid &= 1u << PERF_PAGE_FAULTS;
+    }
+
+    if (!t->rusage_faults) {
+        uint64_t v;
+        if (read(t->fd[PERF_PAGE_FAULTS], &v, sizeof(v)) == (ssize_t)sizeof(v))
+            s->value[PERF_PAGE_FAULTS] = v;
+        else
+            s->valid &= ~(1u << PERF_PAGE_FAULTS);
+    } else {
+        struct rusage ru;
+        getrusage(RUSAGE_THREAD, &ru);
+        s->value[PERF_PAGE_FAULTS] = (uint64_t)ru.ru_minflt + (uint64_t)ru.ru_majflt;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    s->ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void perfctr_diff(const PerfSample *start, const PerfSample *end, PerfSample *d)
+{
+    for (int c = 0; c < PERF_COUNTERS; c++) d->value[c] = end->value[c] - start->value[c];
+    d->ns    = end->ns - start->ns;
+    d->valid = start->valid & end->valid;
+}
+
+unsigned perfctr_available(void)
+{
+    if (!me.opened) open_thread(&me);
+    return me.valid;
+}
+
+const char *perfctr_status(void)
+{
+    if (!me.opened) open_thread(&me);
+    return status;
+}
+
+const char *perfctr_name(PerfCounter c)
+{
+    return c >= 0 && c < PERF_COUNTERS ? events[c].name : "?";
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Derived metrics
+ * ════════════════════════════════════════════════════════════════ */
+
+static int has(const PerfSample *d, PerfCounter c)
+{
+    return (d->valid >> c) & 1;
+}
+
+double perfctr_ipc(const PerfSample *d)
+{
+    if (!has(d, PERF_CYCLES) || !has(d, PERF_INSTRUCTIONS) || d->value[PERF_CYCLES] == 0) return -1;
+    return (double)d->value[PERF_INSTRUCTIONS] / (double)d->value[PERF_CYCLES];
+}
+
+double perfctr_per_kinstr(const PerfSample *d, PerfCounter c)
+{
+    if (!has(d, c) || !has(d, PERF_INSTRUCTIONS) || d->value[PERF_INSTRUCTIONS] == 0) return -1;
+    return 1000.0 * (double)d->value[c] / (double)d->value[PERF_INSTRUCTIONS];
+}
+
+static void rate_text(char *buf, size_t size, double v)
+{
+    if (v < 0) snprintf(buf, size, "-");
+    else       snprintf(buf, size, "%.2f", v);
+}
+
+int perfctr_format(const PerfSample *d, char *buf, size_t size)
+{
+    char ipc[32], cache[32], branch[32], tlb[32];
+    rate_text(ipc, sizeof(ipc), perfctr_ipc(d));
+    rate_text(cache, sizeof(cache), perfctr_per_kinstr(d, PERF_CACHE_MISSES));
+    rate_text(branch, sizeof(branch), perfctr_per_kinstr(d, PERF_BRANCH_MISSES));
+    rate_text(tlb, sizeof(tlb), perfctr_per_kinstr(d, PERF_DTLB_MISSES));
+    if (!has(d, PERF_PAGE_FAULTS))
+        return snprintf(buf, size, "IPC %s  cache-miss %s  branch-miss %s  dTLB-miss %s /kinstr", ipc,
+                        cache, branch, tlb);
+    return snprintf(buf, size, "IPC %s  cache-miss %s  branch-miss %s  dTLB-miss %s /kinstr, %llu faults",
+                    ipc, cache, branch, tlb, (unsigned long long)d->value[PERF_PAGE_FAULTS]);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Regions
+ * ════════════════════════════════════════════════════════════════ */
+
+void perfctr_begin(PerfRegion *r, PerfSample *start)
+{
+    (void)r;
+    perfctr_read(start);
+}
+
+void perfctr_end(PerfRegion *r, const PerfSample *start)
+{
+    PerfSample end, d;
+    perfctr_read(&end);
+    perfctr_diff(start, &end, &d);
+
+    if (!__atomic_load_n(&r->registered, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&regions_lock);
+        if (!r->registered) {
+            r->next       = NULL;
+            *regions_tail = r;
+            regions_tail  = &r->next;
+            __atomic_store_n(&r->registered, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&regions_lock);
+    }
+
+    __atomic_add_fetch(&r->calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&r->ns, d.ns, __ATOMIC_RELAXED);
+    for (int c = 0; c < PERF_COUNTERS; c++)
+        if (has(&d, c)) __atomic_add_fetch(&r->value[c], d.value[c], __ATOMIC_RELAXED);
+    if (d.valid != ALL_COUNTERS) __atomic_or_fetch(&r->missing, ALL_COUNTERS & ~d.valid, __ATOMIC_RELAXED);
+}
+
+uint64_t perfctr_region_read(const PerfRegion *r, PerfSample *total)
+{
+    for (int c = 0; c < PERF_COUNTERS; c++) total->value[c] = __atomic_load_n(&r->value[c], __ATOMIC_RELAXED);
+    total->ns    = __atomic_load_n(&r->ns, __ATOMIC_RELAXED);
+    total->valid = ALL_COUNTERS & ~__atomic_load_n(&r->missing, __ATOMIC_RELAXED);
+    return __atomic_load_n(&r->calls, __ATOMIC_RELAXED);
+}
+
+static void print_rate(FILE *out, double v, int width)
+{
+    if (v < 0) fprintf(out, " %*s", width, "-");
+    else       fprintf(out, " %*.2f", width, v);
+}
+
+void perfctr_report(FILE *out)
+{
+    fprintf(out, "  %-20s %8s %10s %6s %11s %11s %11s %8s\n", "region", "calls", "ms", "IPC",
+            "cache-miss", "branch-miss", "dTLB-miss", "faults");
+    fprintf(out, "  %-20s %8s %10s %6s %11s %11s %11s\n", "", "", "", "", "/kinstr", "/kinstr",
+            "/kinstr");
+
+    pthread_mutex_lock(&regions_lock);
+    for (const PerfRegion *r = regions; r; r = r->next) {
+        PerfSample t;
+        uint64_t   calls = perfctr_region_read(r, &t);
+        fprintf(out, "  %-20.20s %8llu %10.3f", r->name, (unsigned long long)calls, (double)t.ns / 1e6);
+        print_rate(out, perfctr_ipc(&t), 6);
+        print_rate(out, perfctr_per_kinstr(&t, PERF_CACHE_MISSES), 11);
+        print_rate(out, perfctr_per_kinstr(&t, PERF_BRANCH_MISSES), 11);
+        print_rate(out, perfctr_per_kinstr(&t, PERF_DTLB_MISSES), 11);
+        if (has(&t, PERF_PAGE_FAULTS)) fprintf(out, " %8llu\n", (unsigned long long)t.value[PERF_PAGE_FAULTS]);
+        else                           fprintf(out, " %8s\n", "-");
+    }
+    pthread_mutex_unlock(&regions_lock);
+
+    const char *why_missing = perfctr_status();
+    if (why_missing[0]) fprintf(out, "  (%s)\n", why_missing);
+}
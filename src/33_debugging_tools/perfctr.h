@@ -0,0 +1,97 @@
+/*
+ * Chapter 33 — In-process hardware counters (perf_event_open)
+ *
+ * `perf stat` measures a whole program; this measures a region of it:
+ *
+ *   PERF_REGION_BEGIN("parse");
+ *   ... code ...
+ *   PERF_REGION_END();
+ *   ...
+ *   perfctr_report(stdout);
+ *
+ * Each thread opens its own counters the first time it reads them —
+ * cycles, instructions, cache-misses, branch-misses and dTLB-load-misses
+ * as one perf_event group (scheduled onto the PMU together, so ratios
+ * between them are meaningful), page-faults beside it.  Only user-space
+ * events of the calling thread are counted, which perf_event_paranoid
+ * up to 2 allows an unprivileged process.  Where the kernel lets user
+ * space read the PMU directly (x86, the event's mmap page advertising
+ * cap_user_rdpmc) a read is a few rdpmc instructions instead of a
+ * read() system call.
+ *
+ * A region adds each pass's counts, from whichever thread ran it, into
+ * its static PerfRegion; regions nest.  Nothing fails hard: a counter
+ * the kernel refuses (paranoid setting, no PMU in a virtual machine,
+ * seccomp) is left out of PerfSample.valid and reported as "-", with
+ * the reason in perfctr_status(); page faults fall back to getrusage().
+ * Wall time and call counts are always there.
+ */
+
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+} PerfCounter;
+
+typedef struct {
+    uint64_t value[PERF_COUNTERS];
+    uint64_t ns;                /* CLOCK_MONOTONIC */
+    unsigned valid;             /* bit 1u << c: value[c] was counted */
+} PerfSample;
+
+typedef struct PerfRegion {
+    const char        *name;
+    uint64_t           calls, ns, value[PERF_COUNTERS];
+    unsigned           missing;     /* counters some pass could not count */
+    int                registered;
+    struct PerfRegion *next;
+} PerfRegion;
+
+#define PERF_REGION_INIT(name) { (name), 0, 0, { 0 }, 0, 0, NULL }
+
+/* A region around a block; BEGIN and END must be in the same scope */
+#define PERF_REGION_BEGIN(name)                                     \
+    do {                                                            \
+        static PerfRegion perf_region_ = PERF_REGION_INIT(name);    \
+        PerfSample        perf_start_;                              \
+        perfctr_begin(&perf_region_, &perf_start_)
+#define PERF_REGION_END()                                           \
+        perfctr_end(&perf_region_, &perf_start_);                   \
+    } while (0)
+
+/* The calling thread's current counts (opening its counters if needed) */
+void        perfctr_read(PerfSample *s);
+void        perfctr_diff(const PerfSample *start, const PerfSample *end, PerfSample *d);
+
+/* Counters the calling thread can count, as PerfSample.valid bits */
+unsigned    perfctr_available(void);
+/* Why counters are missing (or the fallback used); "" if none are */
+const char *perfctr_status(void);
+const char *perfctr_name(PerfCounter c);
+
+/* Instructions per cycle, and events per 1000 instructions; -1 if not counted */
+double      perfctr_ipc(const PerfSample *d);
+double      perfctr_per_kinstr(const PerfSample *d, PerfCounter c);
+/* "IPC 1.52  cache-miss 0.31  branch-miss 2.10  dTLB-miss 0.01 /kinstr, 3 faults" */
+int         perfctr_format(const PerfSample *d, char *buf, size_t size);
+
+/* Explicit regions, for a PerfRegion the caller keeps (e.g. file scope) */
+void        perfctr_begin(PerfRegion *r, PerfSample *start);
+void        perfctr_end(PerfRegion *r, const PerfSample *start);
+/* A region's totals so far; returns its call count */
+uint64_t    perfctr_region_read(const PerfRegion *r, PerfSample *total);
+
+/* One line per region that has run, in the order they first ran */
+void        perfctr_report(FILE *out);
+
+#endif /* PERFCTR_H */
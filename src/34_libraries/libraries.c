@@ -225,6 +225,42 @@ static void demo_live(void)
     printf("╚══════════════════════════════════════════════════════════╝\n\n");
 }
 
+/* ════════════════════════════════════════════════════════════════════
+ *  Section 8 — Interposition: a library that replaces malloc
+ * ════════════════════════════════════════════════════════════════════ */
+/* noinline: so the profiler's report names this function, not main */
+__attribute__((noinline))
+static void demo_interposition(void)
+{
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║  Section 8 — Interposition with LD_PRELOAD              ║\n");
+    printf("╚══════════════════════════════════════════════════════════╝\n\n");
+
+    printf("  A preloaded library is searched before libc, so its malloc\n");
+    printf("  is the one every call binds to.  bin/libmemprof.so\n");
+    printf("  (memprof.c) forwards to libc's through dlsym(RTLD_NEXT)\n");
+    printf("  and records each call site; a destructor prints the report.\n");
+    printf("  It is built with -fvisibility=hidden: only malloc, calloc,\n");
+    printf("  realloc and free are exported (Section 5).\n\n");
+
+    /* Allocations for the profiler to find, from two call sites */
+    char *blocks[8];
+    for (int i = 0; i < 8; i++) blocks[i] = malloc((size_t)16 << i);
+    char *grown = realloc(NULL, 100);
+    grown = realloc(grown, 10000);
+    for (int i = 0; i < 8; i++) free(blocks[i]);
+    free(grown);
+
+    const char *preload = getenv("LD_PRELOAD");
+    if (preload && strstr(preload, "libmemprof"))
+        printf("  Profiled now: demo_interposition's allocations, by call\n"
+               "  site, appear in the report after the end of the chapter.\n\n");
+    else
+        printf("  Try it:\n"
+               "    LD_PRELOAD=./bin/libmemprof.so ./bin/34_libraries\n"
+               "    MEMPROF_SAMPLE=64 LD_PRELOAD=./bin/libmemprof.so ./your_program\n\n");
+}
+
 /* ════════════════════════════════════════════════════════════════════
  *  Main
  * ════════════════════════════════════════════════════════════════════ */
@@ -242,6 +278,7 @@ int main(void)
     demo_visibility();
     demo_pkgconfig();
     demo_live();
+    demo_interposition();
 
     printf("════════════════════════════════════════════════════════════════\n");
     printf("  End of Chapter 34 — Static & Dynamic Libraries\n");
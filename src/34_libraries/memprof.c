@@ -0,0 +1,628 @@
+/*
+ * Chapter 34 — libmemprof.so: an allocation profiler loaded with LD_PRELOAD
+ *
+ * Defines malloc, calloc, realloc and free.  Preloaded, these come
+ * first in the dynamic linker's search order, so every call a program
+ * makes lands here; each forwards to the next definition, glibc's,
+ * found with dlsym(RTLD_NEXT, ...) (chapter 28: symbol interposition).
+ *
+ * For one call in MEMPROF_SAMPLE (default 1: every call) it records,
+ * per call site — the return address, symbolised at exit:
+ *
+ *   calls and bytes, by function        a size-class histogram
+ *   the time the real allocator took    lifetime, measured at free()
+ *
+ * Everything a thread records goes to its own buffer (mmap()ed, found
+ * through an initial-exec TLS pointer), so the hot path takes no lock
+ * and touches no shared cache line.  Lifetimes need the allocation
+ * time at free(), possibly on another thread: sampled pointers go into
+ * one open-addressed table claimed slot by slot with compare-and-swap.
+ * No header is put in front of blocks, so pointers from functions not
+ * interposed (posix_memalign, strdup inside libc) pass through free().
+ *
+ * The report is written by a destructor (chapter 28, Section 5) to
+ * stderr, or to the file named by MEMPROF_OUT; MEMPROF_TOP sets how
+ * many sites it lists (default 15).
+ *
+ * Build: make bin/libmemprof.so
+ * Run:   LD_PRELOAD=./bin/libmemprof.so ./bin/09_memory
+ *        MEMPROF_SAMPLE=64 MEMPROF_OUT=prof.txt LD_PRELOAD=./bin/libmemprof.so ./a.out
+ */
+
+#define _GNU_SOURCE     /* RTLD_NEXT, dladdr() */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../24_assembler_elf/elf_reader.h"
+
+#define EXPORT      __attribute__((visibility("default")))
+#define TLS         __thread __attribute__((tls_model("initial-exec")))
+
+#define HIST        16          /* buckets per histogram */
+#define SITE_SLOTS  2048        /* per thread; power of two */
+#define LIVE_SLOTS  (1u << 16)  /* sampled live blocks; power of two */
+#define LIVE_PROBES 32
+#define LIVE_EMPTY  ((uintptr_t)0)
+#define LIVE_TOMB   ((uintptr_t)1)
+
+enum { FN_MALLOC, FN_CALLOC, FN_REALLOC, FN_FREE, FN_COUNT };
+
+/* ════════════════════════════════════════════════════════════════
+ *  State
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uintptr_t site;                 /* return address; 0: empty slot */
+    uint64_t  calls[FN_REALLOC + 1];
+    uint64_t  bytes;
+    uint64_t  lat_ns;               /* sum, over calls */
+    uint64_t  freed, life_ns;       /* blocks whose free() we saw, their lifetimes */
+    uint32_t  size_hist[HIST];      /* ≤8, ≤16, ... ≤128K, more */
+    uint32_t  lat_hist[HIST];       /* log2 nanoseconds */
+    uint32_t  life_hist[HIST];      /* log4 nanoseconds */
+} Site;
+
+typedef struct ThreadBuf {
+    struct ThreadBuf *next;         /* every thread's, pushed with CAS */
+    uint64_t          calls[FN_COUNT];  /* all calls, sampled or not */
+    uint64_t          sampled, site_overflow;
+    Site              sites[SITE_SLOTS];
+} ThreadBuf;
+
+typedef struct {
+    uintptr_t ptr;                  /* LIVE_EMPTY, LIVE_TOMB or the block */
+    uintptr_t site;
+    uint64_t  t_ns;
+} Live;
+
+typedef void *(*malloc_fn)(size_t);
+typedef void *(*calloc_fn)(size_t, size_t);
+typedef void *(*realloc_fn)(void *, size_t);
+typedef void  (*free_fn)(void *);
+
+static malloc_fn  real_malloc;
+static calloc_fn  real_calloc;
+static realloc_fn real_realloc;
+static free_fn    real_free;
+
+static int        ready;            /* real_* resolved */
+static int        resolving;        /* inside dlsym(): serve from boot[] */
+static int        finished;         /* the report is written */
+static uint32_t   sample = 1;
+static ThreadBuf *threads;
+static Live      *live;
+static uint16_t  *live_homes;       /* entries per home slot: most free()s stop here */
+static uint64_t   live_dropped;     /* sampled blocks the table had no room for */
+
+static TLS ThreadBuf *tbuf;
+static TLS int        in_hook;      /* our own allocations pass straight through */
+static TLS uint32_t   countdown;
+
+/* dlsym() may itself calloc(); until it returns, a bump buffer serves */
+static char              boot[16384] __attribute__((aligned(16)));
+static size_t            boot_used;
+
+/* ════════════════════════════════════════════════════════════════
+ *  Setup
+ * ════════════════════════════════════════════════════════════════ */
+
+static void *boot_alloc(size_t size)
+{
+    size = (size + 15) & ~(size_t)15;
+    size_t at = __atomic_fetch_add(&boot_used, size, __ATOMIC_RELAXED);
+    return at + size <= sizeof(boot) ? boot + at : NULL;
+}
+
+static int is_boot(const void *p)
+{
+    return (const char *)p >= boot && (const char *)p < boot + sizeof(boot);
+}
+
+static void resolve(void)
+{
+    __atomic_store_n(&resolving, 1, __ATOMIC_RELAXED);
+    real_malloc  = (malloc_fn)dlsym(RTLD_NEXT, "malloc");
+    real_calloc  = (calloc_fn)dlsym(RTLD_NEXT, "calloc");
+    real_realloc = (realloc_fn)dlsym(RTLD_NEXT, "realloc");
+    real_free    = (free_fn)dlsym(RTLD_NEXT, "free");
+    if (!real_malloc || !real_calloc || !real_realloc || !real_free) {
+        static const char msg[] = "memprof: dlsym(RTLD_NEXT) found no allocator\n";
+        ssize_t w = write(2, msg, sizeof(msg) - 1);
+        (void)w;
+        _exit(127);
+    }
+
+    const char *s = getenv("MEMPROF_SAMPLE");
+    if (s && atoi(s) > 0) sample = (uint32_t)atoi(s);
+    size_t size = LIVE_SLOTS * (sizeof(Live) + sizeof(uint16_t));
+    void  *m    = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m != MAP_FAILED) {
+        live       = m;
+        live_homes = (uint16_t *)(void *)(live + LIVE_SLOTS);
+    }
+
+    __atomic_store_n(&ready, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&resolving, 0, __ATOMIC_RELAXED);
+}
+
+/* This thread's buffer, created on its first call; NULL if mmap failed */
+static ThreadBuf *thread_buf(void)
+{
+    if (tbuf) return tbuf;
+    void *m = mmap(NULL, sizeof(ThreadBuf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) return NULL;
+    ThreadBuf *t = m;
+    t->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&threads, &t->next, t, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    countdown = 0;
+    return tbuf = t;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Recording
+ * ════════════════════════════════════════════════════════════════ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned log2_bucket(uint64_t v)
+{
+    unsigned b = v ? 64 - (unsigned)__builtin_clzll(v) : 0;
+    return b < HIST ? b : HIST - 1;
+}
+
+/* Lifetimes span nanoseconds to the whole run: four per bucket */
+static unsigned log4_bucket(uint64_t v)
+{
+    unsigned b = ((v ? 64 - (unsigned)__builtin_clzll(v) : 0) + 1) / 2;
+    return b < HIST ? b : HIST - 1;
+}
+
+static unsigned size_class(size_t size)
+{
+    unsigned c = 0;
+    while (c < HIST - 1 && size > (size_t)8 << c) c++;
+    return c;
+}
+
+static uint64_t mix(uintptr_t v)
+{
+    return (uint64_t)v * 0x9e3779b97f4a7c15ull;
+}
+
+static Site *site_slot(ThreadBuf *t, uintptr_t site)
+{
+    uint32_t i = (uint32_t)(mix(site) >> 53) & (SITE_SLOTS - 1);
+    for (uint32_t n = 0; n < SITE_SLOTS; n++, i = (i + 1) & (SITE_SLOTS - 1)) {
+        if (t->sites[i].site == site) return &t->sites[i];
+        if (t->sites[i].site == 0) {
+            t->sites[i].site = site;
+            return &t->sites[i];
+        }
+    }
+    t->site_overflow++;
+    return NULL;
+}
+
+/* One call in `sample`, counting down per thread */
+static int sampled(ThreadBuf *t)
+{
+    if (countdown > 0) {
+        countdown--;
+        return 0;
+    }
+    countdown = sample - 1;
+    t->sampled++;
+    return 1;
+}
+
+static void live_insert(void *p, uintptr_t site, uint64_t t_ns)
+{
+    if (!live || !p) return;
+    uintptr_t key  = (uintptr_t)p;
+    uint32_t  home = (uint32_t)(mix(key >> 4) >> 48) & (LIVE_SLOTS - 1), i = home;
+    for (int n = 0; n < LIVE_PROBES; n++, i = (i + 1) & (LIVE_SLOTS - 1)) {
+        uintptr_t cur = __atomic_load_n(&live[i].ptr, __ATOMIC_RELAXED);
+        if ((cur == LIVE_EMPTY || cur == LIVE_TOMB) &&
+            __atomic_compare_exchange_n(&live[i].ptr, &cur, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            live[i].site = site;
+            live[i].t_ns = t_ns;
+            __atomic_fetch_add(&live_homes[home], 1, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+    __atomic_fetch_add(&live_dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* If p was sampled, end its lifetime in this thread's record of its site */
+static void live_remove(ThreadBuf *t, void *p)
+{
+    if (!live || !p) return;
+    uintptr_t key  = (uintptr_t)p;
+    uint32_t  home = (uint32_t)(mix(key >> 4) >> 48) & (LIVE_SLOTS - 1), i = home;
+    /* Unsampled blocks, nearly all of them when sampling, end here
+     * without touching the (much larger) table */
+    if (__atomic_load_n(&live_homes[home], __ATOMIC_ACQUIRE) == 0) return;
+    for (int n = 0; n < LIVE_PROBES; n++, i = (i + 1) & (LIVE_SLOTS - 1)) {
+        uintptr_t cur = __atomic_load_n(&live[i].ptr, __ATOMIC_ACQUIRE);
+        if (cur == LIVE_EMPTY) return;
+        if (cur != key) continue;
+        uintptr_t site = live[i].site;
+        uint64_t  life = now_ns() - live[i].t_ns;
+        __atomic_store_n(&live[i].ptr, LIVE_TOMB, __ATOMIC_RELEASE);
+        __atomic_fetch_sub(&live_homes[home], 1, __ATOMIC_RELAXED);
+        Site *s = site_slot(t, site);
+        if (s) {
+            s->freed++;
+            s->life_ns += life;
+            s->life_hist[log4_bucket(life)]++;
+        }
+        return;
+    }
+}
+
+static void record(ThreadBuf *t, int fn, uintptr_t site, size_t size, void *p, uint64_t t0,
+                   uint64_t t1)
+{
+    Site *s = site_slot(t, site);
+    if (s) {
+        s->calls[fn]++;
+        s->bytes += size;
+        s->lat_ns += t1 - t0;
+        s->size_hist[size_class(size)]++;
+        s->lat_hist[log2_bucket(t1 - t0)]++;
+    }
+    live_insert(p, site, t1);
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The interposed functions
+ * ════════════════════════════════════════════════════════════════ */
+
+#define SITE() ((uintptr_t)__builtin_return_address(0))
+
+EXPORT void *malloc(size_t size)
+{
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE)) {
+        if (__atomic_load_n(&resolving, __ATOMIC_RELAXED)) return boot_alloc(size);
+        resolve();
+    }
+    if (in_hook) return real_malloc(size);
+    in_hook = 1;
+    ThreadBuf *t = thread_buf();
+    void      *p;
+    if (t) t->calls[FN_MALLOC]++;
+    if (t && sampled(t)) {
+        uint64_t t0 = now_ns();
+        p = real_malloc(size);
+        record(t, FN_MALLOC, SITE(), size, p, t0, now_ns());
+    } else {
+        p = real_malloc(size);
+    }
+    in_hook = 0;
+    return p;
+}
+
+EXPORT void *calloc(size_t n, size_t size)
+{
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE)) {
+        /* boot[] is static, so already zero */
+        if (__atomic_load_n(&resolving, __ATOMIC_RELAXED))
+            return size && n > sizeof(boot) / size ? NULL : boot_alloc(n * size);
+        resolve();
+    }
+    if (in_hook) return real_calloc(n, size);
+    in_hook = 1;
+    ThreadBuf *t = thread_buf();
+    void      *p;
+    if (t) t->calls[FN_CALLOC]++;
+    if (t && sampled(t)) {
+        uint64_t t0 = now_ns();
+        p = real_calloc(n, size);
+        record(t, FN_CALLOC, SITE(), n * size, p, t0, now_ns());
+    } else {
+        p = real_calloc(n, size);
+    }
+    in_hook = 0;
+    return p;
+}
+
+EXPORT void *realloc(void *old, size_t size)
+{
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE)) {
+        if (__atomic_load_n(&resolving, __ATOMIC_RELAXED)) return NULL;
+        resolve();
+    }
+    if (is_boot(old)) {
+        /* Rare: a block from dlsym()'s time; copy what it can have held */
+        void  *p = real_malloc(size);
+        size_t n = (size_t)(boot + sizeof(boot) - (char *)old);
+        if (p) memcpy(p, old, n < size ? n : size);
+        return p;
+    }
+    if (in_hook) return real_realloc(old, size);
+    in_hook = 1;
+    ThreadBuf *t = thread_buf();
+    void      *p;
+    if (t) t->calls[FN_REALLOC]++;
+    /* The old block's life ends here, whether or not this call is sampled */
+    if (t && old) live_remove(t, old);
+    if (t && sampled(t)) {
+        uint64_t t0 = now_ns();
+        p = real_realloc(old, size);
+        record(t, FN_REALLOC, SITE(), size, size ? p : NULL, t0, now_ns());
+    } else {
+        p = real_realloc(old, size);
+    }
+    in_hook = 0;
+    return p;
+}
+
+EXPORT void free(void *p)
+{
+    if (!p || is_boot(p)) return;
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE)) {
+        if (__atomic_load_n(&resolving, __ATOMIC_RELAXED)) return;    /* leaked, once */
+        resolve();
+    }
+    if (in_hook) {
+        real_free(p);
+        return;
+    }
+    in_hook = 1;
+    ThreadBuf *t = thread_buf();
+    if (t) {
+        t->calls[FN_FREE]++;
+        live_remove(t, p);
+    }
+    real_free(p);
+    in_hook = 0;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Report
+ * ════════════════════════════════════════════════════════════════ */
+
+static int out_fd = 2;
+
+__attribute__((format(printf, 1, 2)))
+static void out(const char *fmt, ...)
+{
+    char    buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(buf)) n = sizeof(buf) - 1;
+    for (char *p = buf; n > 0;) {
+        ssize_t w = write(out_fd, p, (size_t)n);
+        if (w <= 0) return;
+        p += w;
+        n -= (int)w;
+    }
+}
+
+/* The report's own symbol lookups: one ElfFile per object, by path */
+typedef struct {
+    const char *path;
+    ElfFile     elf;
+    int         ok;
+} ObjCache;
+
+static ObjCache objs[32];
+static int      n_objs;
+
+static ElfFile *obj_elf(const char *path)
+{
+    for (int i = 0; i < n_objs; i++)
+        if (strcmp(objs[i].path, path) == 0) return objs[i].ok ? &objs[i].elf : NULL;
+    if (n_objs == (int)(sizeof(objs) / sizeof(objs[0]))) return NULL;
+    ObjCache *c = &objs[n_objs++];
+    c->path = path;
+    c->ok   = elf_open(&c->elf, path) == 0;
+    return c->ok ? &c->elf : NULL;
+}
+
+/* "function+0xoff (object)" — dladdr() knows exported symbols only, so
+ * static functions come from the object's .symtab (chapter 24's reader) */
+static void site_name(uintptr_t site, char *buf, size_t size)
+{
+    Dl_info info;
+    if (!dladdr((void *)(site - 1), &info) || !info.dli_fname) {
+        snprintf(buf, size, "%#lx", (unsigned long)site);
+        return;
+    }
+    const char *obj   = strrchr(info.dli_fname, '/');
+    obj               = obj ? obj + 1 : info.dli_fname;
+    uintptr_t   base  = (uintptr_t)info.dli_fbase;
+    const char *name  = NULL;
+    uintptr_t   start = 0;
+
+    ElfFile *f = info.dli_fname[0] ? obj_elf(info.dli_fname) : NULL;
+    if (!f) f = obj_elf("/proc/self/exe");
+    if (f) {
+        uintptr_t        bias = f->eh->e_type == ET_DYN ? base : 0;
+        ElfSymKind       kind;
+        const Elf64_Sym *s = elf_symbol_at(f, site - 1 - bias, &kind);
+        if (s) {
+            name  = elf_sym_name(elf_symtab(f, kind), s);
+            start = (uintptr_t)s->st_value + bias;
+        }
+    }
+    if ((!name || !*name) && info.dli_sname) {
+        name  = info.dli_sname;
+        start = (uintptr_t)info.dli_saddr;
+    }
+    if (name && *name)
+        snprintf(buf, size, "%s+%#lx (%s)", name, (unsigned long)(site - start), obj);
+    else
+        snprintf(buf, size, "%s+%#lx", obj, (unsigned long)(site - base));
+}
+
+static const char *bucket_label(char *buf, size_t size, int kind, unsigned b)
+{
+    static const char *units[] = { "ns", "us", "ms", "s" };
+    int      last = b == HIST - 1;
+    unsigned e    = last ? b - 1 : b;       /* the last bucket holds everything above */
+    uint64_t v    = kind == 0 ? (uint64_t)8 << b : (uint64_t)1 << (kind == 1 ? e : 2 * e);
+    if (kind == 0) {
+        if (b == HIST - 1) snprintf(buf, size, ">%luK", (unsigned long)((8ul << (HIST - 2)) >> 10));
+        else if (v >= 1024) snprintf(buf, size, "≤%luK", (unsigned long)(v >> 10));
+        else snprintf(buf, size, "≤%lu", (unsigned long)v);
+        return buf;
+    }
+    int u = 0;
+    while (u < 3 && v >= 1000) {
+        v /= 1000;
+        u++;
+    }
+    snprintf(buf, size, "%s%lu%s", last ? "≥" : "<", (unsigned long)v, units[u]);
+    return buf;
+}
+
+static void print_hist(const char *title, const uint32_t *h, int kind)
+{
+    char line[512];
+    int  n = snprintf(line, sizeof(line), "      %-9s", title);
+    for (unsigned b = 0; b < HIST; b++) {
+        if (!h[b] || n >= (int)sizeof(line) - 32) continue;
+        char label[16];
+        n += snprintf(line + n, sizeof(line) - (size_t)n, " %s:%u", bucket_label(label, sizeof(label), kind, b),
+                      h[b]);
+    }
+    out("%s\n", line);
+}
+
+static void merge_site(Site *dst, const Site *src)
+{
+    for (int f = 0; f <= FN_REALLOC; f++) dst->calls[f] += src->calls[f];
+    dst->bytes   += src->bytes;
+    dst->lat_ns  += src->lat_ns;
+    dst->freed   += src->freed;
+    dst->life_ns += src->life_ns;
+    for (int b = 0; b < HIST; b++) {
+        dst->size_hist[b] += src->size_hist[b];
+        dst->lat_hist[b]  += src->lat_hist[b];
+        dst->life_hist[b] += src->life_hist[b];
+    }
+}
+
+static uint64_t site_calls(const Site *s)
+{
+    return s->calls[FN_MALLOC] + s->calls[FN_CALLOC] + s->calls[FN_REALLOC];
+}
+
+static int by_bytes(const void *a, const void *b)
+{
+    const Site *x = *(const Site *const *)a, *y = *(const Site *const *)b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+__attribute__((destructor))
+static void memprof_report(void)
+{
+    if (!ready || finished) return;
+    in_hook  = 1;
+    finished = 1;
+
+    /* The program's buffered output is flushed after destructors run;
+     * flush it now so the report comes after it */
+    fflush(stdout);
+
+    const char *path = getenv("MEMPROF_OUT");
+    if (path && *path) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) out_fd = fd;
+    }
+    const char *top_env = getenv("MEMPROF_TOP");
+    int         top     = top_env && atoi(top_env) > 0 ? atoi(top_env) : 15;
+
+    /* Merge every thread's sites; other threads may still be running,
+     * so these are a snapshot, not a barrier */
+    uint64_t calls[FN_COUNT] = { 0 }, nsampled = 0, overflow = 0;
+    int      nthreads = 0;
+    Site    *merged   = mmap(NULL, SITE_SLOTS * 4 * sizeof(Site), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (merged == MAP_FAILED) return;
+    size_t n_merged = 0;
+    for (ThreadBuf *t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        nthreads++;
+        for (int f = 0; f < FN_COUNT; f++) calls[f] += t->calls[f];
+        nsampled += t->sampled;
+        overflow += t->site_overflow;
+        for (int i = 0; i < SITE_SLOTS; i++) {
+            const Site *s = &t->sites[i];
+            if (!s->site) continue;
+            size_t k = 0;
+            while (k < n_merged && merged[k].site != s->site) k++;
+            if (k == n_merged) {
+                if (n_merged == SITE_SLOTS * 4) continue;
+                merged[n_merged++].site = s->site;
+            }
+            merge_site(&merged[k], s);
+        }
+    }
+
+    Site **order = real_malloc(n_merged * sizeof(*order) + 1);
+    if (!order) return;
+    for (size_t i = 0; i < n_merged; i++) order[i] = &merged[i];
+    qsort(order, n_merged, sizeof(*order), by_bytes);
+
+    out("\n══ memprof: pid %ld, %d thread%s, sampling 1 in %u ══\n", (long)getpid(), nthreads,
+        nthreads == 1 ? "" : "s", sample);
+    out("  calls:  malloc %lu  calloc %lu  realloc %lu  free %lu  (%lu sampled)\n",
+        (unsigned long)calls[FN_MALLOC], (unsigned long)calls[FN_CALLOC],
+        (unsigned long)calls[FN_REALLOC], (unsigned long)calls[FN_FREE], (unsigned long)nsampled);
+    if (sample > 1) out("  per-site numbers below are samples: multiply counts and bytes by %u\n", sample);
+    if (overflow || live_dropped)
+        out("  not attributed: %lu (site tables full), lifetimes not tracked: %lu\n",
+            (unsigned long)overflow, (unsigned long)live_dropped);
+
+    out("\n  %-44s %9s %11s %8s %8s %8s %10s\n", "call site", "calls", "bytes", "avg B", "lat ns",
+        "freed", "life us");
+    for (size_t i = 0; i < n_merged && (int)i < top; i++) {
+        const Site *s = order[i];
+        uint64_t    c = site_calls(s);
+        char        name[256];
+        site_name(s->site, name, sizeof(name));
+        if (strlen(name) > 44) memcpy(name + 41, "...", 4);
+        out("  %-44s %9lu %11lu %8lu %8lu %8lu %10.1f\n", name, (unsigned long)c,
+            (unsigned long)s->bytes, (unsigned long)(c ? s->bytes / c : 0),
+            (unsigned long)(c ? s->lat_ns / c : 0), (unsigned long)s->freed,
+            s->freed ? (double)s->life_ns / (double)s->freed / 1e3 : 0.0);
+    }
+    if (n_merged > (size_t)top) out("  ... %lu more sites (MEMPROF_TOP)\n", (unsigned long)(n_merged - top));
+
+    /* Histograms for the heaviest three */
+    for (size_t i = 0; i < n_merged && i < 3; i++) {
+        char name[256];
+        site_name(order[i]->site, name, sizeof(name));
+        out("\n    %s\n", name);
+        print_hist("size", order[i]->size_hist, 0);
+        print_hist("latency", order[i]->lat_hist, 1);
+        if (order[i]->freed) print_hist("lifetime", order[i]->life_hist, 2);
+    }
+    out("\n");
+
+    real_free(order);
+    munmap(merged, SITE_SLOTS * 4 * sizeof(Site));
+    for (int i = 0; i < n_objs; i++)
+        if (objs[i].ok) elf_close(&objs[i].elf);
+    if (out_fd != 2) close(out_fd);
+}
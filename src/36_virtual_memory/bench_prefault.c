@@ -0,0 +1,473 @@
+/*
+ * Prefault policy benchmark — how a mapping's pages get faulted in
+ *
+ * Maps an anonymous region, or a file, of each --sizes-mb size and
+ * touches every page (a write for anonymous memory, a read for the
+ * file) after one of these policies:
+ *
+ *   lazy         nothing: every first touch of a page is a fault
+ *   populate     mmap(MAP_POPULATE): the kernel faults it all in first
+ *   willneed     madvise(MADV_WILLNEED): file readahead starts at once
+ *   sequential   madvise(MADV_SEQUENTIAL): aggressive readahead
+ *   random       madvise(MADV_RANDOM): readahead off
+ *   mlock        mlock(): faulted in and pinned (needs RLIMIT_MEMLOCK
+ *                or CAP_IPC_LOCK; n/a otherwise)
+ *   parallel     a --threads work-stealing pool (chapter 14) touches
+ *                the pages first, parallel_for() over 1 MB pieces; the
+ *                timed touch then runs over pages already present
+ *
+ * Every run happens in a forked child, so it starts with nothing
+ * mapped.  For the file the parent evicts it from the page cache first
+ * (fdatasync + POSIX_FADV_DONTNEED) and reports how much was still
+ * cached (mincore) — on tmpfs, or when the pages are mapped elsewhere,
+ * eviction does not happen and there are no major faults to see.
+ *
+ * Reported: setup (mmap plus the policy's own work), time to first
+ * access (from the mmap call until the first byte is read), total fill
+ * time (until every page has been touched), the fill rate, and minor
+ * and major faults from getrusage() — all threads included.  Each page
+ * starts with its index; a read back that disagrees exits 1.  Anonymous
+ * sizes over 3/4 of MemAvailable are skipped (n/a).
+ *
+ * Build: make bench_prefault
+ * Run:   ./bin/bench_prefault [--sizes-mb 64,512] [--backing anon|file|all]
+ *                             [--policy NAME|all] [--threads N]
+ *                             [--file PATH | --dir DIR] [--format text|csv|json]
+ *        --file uses an existing file (its first bytes, read-only, no
+ *        index check); otherwise a file of the largest size is written
+ *        in --dir and removed at exit.
+ */
+
+#define _GNU_SOURCE         /* MAP_POPULATE, posix_fadvise(), mincore() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../../include/bench.h"
+#include "../14_concurrency/tpool.h"
+
+typedef enum {
+    POL_LAZY,
+    POL_POPULATE,
+    POL_WILLNEED,
+    POL_SEQUENTIAL,
+    POL_RANDOM,
+    POL_MLOCK,
+    POL_PARALLEL,
+    POLICY_COUNT
+} Policy;
+
+static const char *policies[POLICY_COUNT] = {
+    "lazy", "populate", "willneed", "sequential", "random", "mlock", "parallel",
+};
+
+static const char *backings[] = { "anon", "file" };
+#define BACKING_COUNT 2
+
+#define MAX_SIZES 16
+
+typedef struct {
+    size_t         sizes[MAX_SIZES];
+    int            n_sizes;
+    int            backing;         /* -1 = all */
+    int            policy;          /* -1 = all */
+    int            threads;
+    const char    *file;            /* existing file to map */
+    const char    *dir;             /* where to write the generated one */
+    bench_format_t format;
+} Config;
+
+typedef struct {
+    int      ok;                    /* 0: see err */
+    int      err;
+    int      bad;                   /* pages whose index read back wrong */
+    uint64_t setup_ns, first_ns, fill_ns;
+    uint64_t minflt, majflt;
+} Result;
+
+static size_t page_size;
+
+/* ════════════════════════════════════════════════════════════════
+ *  One run, in a child process
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    volatile char *base;
+    int            write;
+} Touch;
+
+static _Atomic uint64_t sink;
+
+static void touch_pages(size_t from, size_t to, void *ctx)
+{
+    Touch   *t   = ctx;
+    uint64_t sum = 0;
+    for (size_t p = from; p < to; p++) {
+        if (t->write) t->base[p * page_size] = 1;
+        else          sum += t->base[p * page_size];
+    }
+    sink += sum;
+}
+
+static void parallel_prefault(volatile char *base, size_t pages, int threads, int write)
+{
+    Touch  t     = { base, write };
+    size_t grain = ((size_t)1 << 20) / page_size;
+    TPool *pool  = tpool_create(threads, 0);
+    if (!pool) {                        /* no threads: do it inline */
+        touch_pages(0, pages, &t);
+        return;
+    }
+    parallel_for(pool, 0, pages, grain, touch_pages, &t);
+    tpool_destroy(pool);
+}
+
+static uint64_t faults(long *maj)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    *maj = ru.ru_majflt;
+    return (uint64_t)ru.ru_minflt;
+}
+
+static void run(int backing, Policy pol, size_t size, int fd, int check, int threads, Result *r)
+{
+    int    anon  = backing == 0;
+    int    prot  = anon ? PROT_READ | PROT_WRITE : PROT_READ;
+    int    flags = MAP_PRIVATE | (anon ? MAP_ANONYMOUS : 0) | (pol == POL_POPULATE ? MAP_POPULATE : 0);
+    size_t pages = size / page_size;
+
+    long     maj0, maj1;
+    uint64_t min0 = faults(&maj0);
+    uint64_t t0   = bench_now_ns();
+
+    volatile char *m = mmap(NULL, size, prot, flags, anon ? -1 : fd, 0);
+    if (m == MAP_FAILED) {
+        r->err = errno;
+        return;
+    }
+    int rc = 0;
+    switch (pol) {
+    case POL_WILLNEED:   rc = madvise((void *)m, size, MADV_WILLNEED); break;
+    case POL_SEQUENTIAL: rc = madvise((void *)m, size, MADV_SEQUENTIAL); break;
+    case POL_RANDOM:     rc = madvise((void *)m, size, MADV_RANDOM); break;
+    case POL_MLOCK:      rc = mlock((void *)m, size); break;
+    case POL_PARALLEL:   parallel_prefault(m, pages, threads, anon); break;
+    default:             break;
+    }
+    if (rc != 0) {
+        r->err = errno;
+        return;
+    }
+    uint64_t t_setup = bench_now_ns();
+
+    /* The first access, then the rest of the pages in order */
+    uint64_t sum = 0;
+    if (anon) m[0] = 1;
+    else      sum += (unsigned char)m[0];
+    uint64_t t_first = bench_now_ns();
+    for (size_t p = 1; p < pages; p++) {
+        if (anon) m[p * page_size] = 1;
+        else      sum += (unsigned char)m[p * page_size];
+    }
+    uint64_t t_fill = bench_now_ns();
+    sink += sum;
+
+    r->minflt = faults(&maj1) - min0;
+    r->majflt = (uint64_t)(maj1 - maj0);
+    if (check)
+        for (size_t p = 0; p < pages; p++)
+            if (*(const volatile uint64_t *)(m + p * page_size) != (uint64_t)p) r->bad++;
+
+    r->ok       = 1;
+    r->setup_ns = t_setup - t0;
+    r->first_ns = t_first - t0;
+    r->fill_ns  = t_fill - t0;
+    munmap((void *)m, size);
+}
+
+static int run_child(int backing, Policy pol, size_t size, int fd, int check, int threads, Result *out)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        Result r;
+        memset(&r, 0, sizeof(r));
+        run(backing, pol, size, fd, check, threads, &r);
+        ssize_t w = write(fds[1], &r, sizeof(r));
+        _exit(w == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], out, sizeof(*out));
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return got == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  The file, and keeping it out of the page cache
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Every page starts with its index; the rest is filler */
+static int write_file(int fd, size_t size)
+{
+    size_t chunk = (size_t)1 << 20;
+    char  *buf   = malloc(chunk);
+    if (!buf) return -1;
+    memset(buf, 0xa5, chunk);
+    for (size_t off = 0; off < size; off += chunk) {
+        size_t n = size - off < chunk ? size - off : chunk;
+        for (size_t p = 0; p < n; p += page_size) {
+            uint64_t index = (off + p) / page_size;
+            memcpy(buf + p, &index, sizeof(index));
+        }
+        if (pwrite(fd, buf, n, (off_t)off) != (ssize_t)n) {
+            free(buf);
+            return -1;
+        }
+    }
+    free(buf);
+    return fdatasync(fd);
+}
+
+/* Drop the file's pages; return the fraction of size still resident */
+static double evict(int fd, size_t size)
+{
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    void *m = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) return -1;
+    size_t         pages = size / page_size, resident = 0;
+    unsigned char *vec   = malloc(pages);
+    if (vec && mincore(m, size, vec) == 0)
+        for (size_t p = 0; p < pages; p++) resident += vec[p] & 1;
+    free(vec);
+    munmap(m, size);
+    return (double)resident / (double)pages;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--sizes-mb 64,512] [--backing anon|file|all] [--policy NAME|all]\n"
+            "       %*s [--threads N] [--file PATH | --dir DIR] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_sizes(const char *val, Config *cfg)
+{
+    char list[256];
+    snprintf(list, sizeof(list), "%s", val);
+    cfg->n_sizes = 0;
+    for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        size_t mb = (size_t)strtoull(tok, NULL, 10);
+        if (mb == 0 || cfg->n_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->n_sizes++] = mb << 20;
+    }
+    return cfg->n_sizes ? 0 : -1;
+}
+
+static int parse_name(const char *val, const char *const *names, int n, int *out)
+{
+    if (strcmp(val, "all") == 0) {
+        *out = -1;
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+        if (strcmp(val, names[i]) == 0) {
+            *out = i;
+            return 0;
+        }
+    return -1;
+}
+
+static size_t mem_available(void)
+{
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return SIZE_MAX;
+    char   line[128];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "MemAvailable: %zu kB", &kb) == 1) break;
+    fclose(f);
+    return kb ? kb << 10 : SIZE_MAX;
+}
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--sizes-mb") == 0) {
+            if (parse_sizes(val, cfg) != 0) return -1;
+        } else if (strcmp(opt, "--backing") == 0) {
+            if (parse_name(val, backings, BACKING_COUNT, &cfg->backing) != 0) return -1;
+        } else if (strcmp(opt, "--policy") == 0) {
+            if (parse_name(val, policies, POLICY_COUNT, &cfg->policy) != 0) return -1;
+        } else if (strcmp(opt, "--threads") == 0) {
+            cfg->threads = atoi(val);
+        } else if (strcmp(opt, "--file") == 0) {
+            cfg->file = val;
+        } else if (strcmp(opt, "--dir") == 0) {
+            cfg->dir = val;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return cfg->threads >= 1 && cfg->threads <= 64 ? 0 : -1;
+}
+
+static void report(const Config *cfg, int b, Policy pol, size_t size, double cached, const Result *r,
+                   int *first)
+{
+    double fill_s = (double)r->fill_ns / 1e9;
+    double gbs    = fill_s > 0 ? (double)size / fill_s / 1e9 : 0;
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-4s %7zu  %-10s", backings[b], size >> 20, policies[pol]);
+        if (!r->ok) {
+            printf("  n/a (%s)\n", strerror(r->err));
+            break;
+        }
+        printf(" %9.2f %10.1f %9.2f %6.2f %9llu %7llu", (double)r->setup_ns / 1e6, (double)r->first_ns / 1e3,
+               (double)r->fill_ns / 1e6, gbs, (unsigned long long)r->minflt, (unsigned long long)r->majflt);
+        if (cached >= 0) printf(" %5.0f%%", 100 * cached);
+        else             printf(" %6s", "");
+        printf("%s\n", r->bad ? "  CONTENTS DIFFER" : "");
+        break;
+    case BENCH_FMT_CSV:
+        if (!r->ok) break;
+        printf("%s,%zu,%s,%.3f,%.3f,%.3f,%.3f,%llu,%llu,", backings[b], size, policies[pol],
+               (double)r->setup_ns / 1e6, (double)r->first_ns / 1e3, (double)r->fill_ns / 1e6, gbs,
+               (unsigned long long)r->minflt, (unsigned long long)r->majflt);
+        if (cached >= 0) printf("%.3f", cached);
+        printf("\n");
+        break;
+    case BENCH_FMT_JSON:
+        if (!r->ok) break;
+        printf("%s\n    { \"backing\": \"%s\", \"bytes\": %zu, \"policy\": \"%s\", \"setup_ms\": %.3f, "
+               "\"first_access_us\": %.3f, \"fill_ms\": %.3f, \"gb_s\": %.3f, \"minor_faults\": %llu, "
+               "\"major_faults\": %llu, \"cached_before\": ",
+               *first ? "" : ",", backings[b], size, policies[pol], (double)r->setup_ns / 1e6,
+               (double)r->first_ns / 1e3, (double)r->fill_ns / 1e6, gbs, (unsigned long long)r->minflt,
+               (unsigned long long)r->majflt);
+        if (cached >= 0) printf("%.3f }", cached);
+        else             printf("null }");
+        *first = 0;
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { { (size_t)64 << 20, (size_t)512 << 20 }, 2, -1, -1, 4, NULL, "/var/tmp", BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    size_t largest = 0;
+    for (int i = 0; i < cfg.n_sizes; i++) {
+        cfg.sizes[i] = cfg.sizes[i] / page_size * page_size;
+        if (cfg.sizes[i] > largest) largest = cfg.sizes[i];
+    }
+
+    /* The file: an existing one, or written once at the largest size */
+    int  fd = -1, check = 0;
+    char path[4096] = "";
+    if (cfg.backing != 0) {
+        if (cfg.file) {
+            struct stat st;
+            fd = open(cfg.file, O_RDONLY | O_CLOEXEC);
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                fprintf(stderr, "%s: %s\n", cfg.file, strerror(errno));
+                return 1;
+            }
+            if ((size_t)st.st_size < largest) {
+                fprintf(stderr, "%s: %lld bytes, smaller than the largest size\n", cfg.file,
+                        (long long)st.st_size);
+                return 1;
+            }
+        } else {
+            snprintf(path, sizeof(path), "%s/bench_prefault_XXXXXX", cfg.dir);
+            fd = mkstemp(path);
+            if (fd < 0 || write_file(fd, largest) != 0) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                if (fd >= 0) unlink(path);
+                return 1;
+            }
+            check = 1;
+        }
+    }
+
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_prefault: every page touched once; %d threads for parallel; file %s\n\n", cfg.threads,
+               cfg.backing == 0 ? "-" : cfg.file ? cfg.file : path);
+        printf("  %-4s %7s  %-10s %9s %10s %9s %6s %9s %7s %6s\n", "", "MB", "policy", "setup ms",
+               "first us", "fill ms", "GB/s", "minflt", "majflt", "cached");
+        break;
+    case BENCH_FMT_CSV:
+        printf("backing,bytes,policy,setup_ms,first_access_us,fill_ms,gb_s,minor_faults,major_faults,"
+               "cached_before\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"prefault\",\n  \"results\": [");
+        break;
+    }
+
+    size_t limit  = mem_available() / 4 * 3;
+    int    failed = 0, first = 1;
+    for (int b = 0; b < BACKING_COUNT; b++) {
+        if (cfg.backing >= 0 && cfg.backing != b) continue;
+        for (int s = 0; s < cfg.n_sizes; s++) {
+            for (int p = 0; p < POLICY_COUNT; p++) {
+                if (cfg.policy >= 0 && cfg.policy != p) continue;
+                double cached = b == 1 ? evict(fd, cfg.sizes[s]) : -1;
+                Result r;
+                memset(&r, 0, sizeof(r));
+                if (b == 0 && cfg.sizes[s] > limit) {   /* would only measure swapping, or the OOM killer */
+                    r.err = ENOMEM;
+                    report(&cfg, b, (Policy)p, cfg.sizes[s], cached, &r, &first);
+                    continue;
+                }
+                if (run_child(b, (Policy)p, cfg.sizes[s], fd, check && b == 1, cfg.threads, &r) != 0) {
+                    fprintf(stderr, "%s/%s: child failed\n", backings[b], policies[p]);
+                    failed = 1;
+                    continue;
+                }
+                report(&cfg, b, (Policy)p, cfg.sizes[s], cached, &r, &first);
+                failed |= r.bad != 0;
+            }
+            if (cfg.format == BENCH_FMT_TEXT) printf("\n");
+        }
+    }
+    if (cfg.format == BENCH_FMT_JSON) printf("\n  ]\n}\n");
+
+    if (fd >= 0) close(fd);
+    if (path[0]) unlink(path);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * TLB reach benchmark — 4 KB pages vs transparent and hugetlbfs huge pages
+ *
+ * For working sets from --min-kb to --max-mb (powers of two), under
+ * each page kind of hugepage.h, two access patterns:
+ *
+ *   chase    a random cycle through every 64-byte line: each load's
+ *            address is the previous load's result, so this is pure
+ *            latency — cache misses plus, once the working set
+ *            outgrows the TLB's reach, a page walk per load
+ *   stride   independent loads one page plus one line apart, wrapping
+ *            around the working set: every load lands on a new page,
+ *            but the CPU may overlap as many as it has fill buffers
+ *
+ * The cycle is a full-period LCG over the line indices (x → a·x + c
+ * mod 2^k), so it needs no shuffle buffer and costs one pass to build,
+ * even at 16 GB.  Each measurement is one warm-up pass of --accesses
+ * loads, then --accesses loads timed and counted with perfctr.c
+ * (chapter 33): ns per access and dTLB-load-misses per access ("-"
+ * where the PMU is not available).  For THP the "huge" column is how
+ * much of the buffer the kernel actually put on 2 MB pages.
+ *
+ * A page kind the system cannot provide is shown as n/a — hugetlbfs
+ * needs a reserved pool (echo 512 > /proc/sys/vm/nr_hugepages for
+ * 1 GB of 2 MB pages).  Working sets beyond 3/4 of MemAvailable are
+ * skipped.  CSV output (--format csv) has one row per size, pattern and
+ * kind, ready for plotting ns/access against working set.
+ *
+ * Build: make bench_tlb
+ * Run:   ./bin/bench_tlb [--min-kb K] [--max-mb M] [--accesses N]
+ *                        [--pages 4k,thp,2m,1g] [--pattern chase|stride|all]
+ *                        [--format text|csv|json]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "../../include/bench.h"
+#include "../33_debugging_tools/perfctr.h"
+#include "hugepage.h"
+
+#define LINE      64
+#define STRIDE    (4096 + LINE)
+
+static const char *patterns[] = { "chase", "stride" };
+#define PATTERN_COUNT 2
+
+/* ════════════════════════════════════════════════════════════════
+ *  Access patterns
+ * ════════════════════════════════════════════════════════════════ */
+
+/* Line i holds the index of the line after it on the cycle */
+static void build_chase(uint64_t *buf, size_t lines)
+{
+    const uint64_t a = 6364136223846793005ull, c = 1442695040888963407ull;
+    for (size_t i = 0; i < lines; i++) buf[i * (LINE / 8)] = (a * i + c) & (lines - 1);
+}
+
+static uint64_t run_chase(const uint64_t *buf, uint64_t steps, uint64_t start)
+{
+    uint64_t p = start;
+    for (uint64_t k = 0; k < steps; k++) p = buf[p * (LINE / 8)];
+    return p;
+}
+
+static uint64_t run_stride(const uint64_t *buf, size_t bytes, uint64_t steps)
+{
+    uint64_t sum = 0, off = 0;
+    for (uint64_t k = 0; k < steps; k++) {
+        sum += buf[off / 8];
+        off = (off + STRIDE) & (bytes - 1);
+    }
+    return sum;
+}
+
+typedef struct {
+    int      ok;            /* 0: this kind is not available */
+    double   ns;            /* per access */
+    double   tlb;           /* dTLB-load-misses per access; -1 if not counted */
+    double   huge;          /* fraction on huge pages */
+} Cell;
+
+static volatile uint64_t sink;
+
+/* b->size is the working set here, not the rounded-up mapping */
+static void measure(const HugeBuf *b, int pattern, uint64_t accesses, Cell *out)
+{
+    uint64_t  *buf = b->addr;
+    PerfSample s0, s1, d;
+
+    if (pattern == 0) {
+        uint64_t p = run_chase(buf, accesses, 0);
+        perfctr_read(&s0);
+        p = run_chase(buf, accesses, p);
+        perfctr_read(&s1);
+        sink += p;
+    } else {
+        sink += run_stride(buf, b->size, accesses);
+        perfctr_read(&s0);
+        sink += run_stride(buf, b->size, accesses);
+        perfctr_read(&s1);
+    }
+    perfctr_diff(&s0, &s1, &d);
+    out->ok  = 1;
+    out->ns  = (double)d.ns / (double)accesses;
+    out->tlb = d.valid & 1u << PERF_DTLB_MISSES ? (double)d.value[PERF_DTLB_MISSES] / (double)accesses : -1;
+}
+
+/* ════════════════════════════════════════════════════════════════
+ *  Driver
+ * ════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    size_t         min_bytes, max_bytes;
+    uint64_t       accesses;
+    unsigned       kinds;           /* bit per HugeKind */
+    int            pattern;         /* -1 = all */
+    bench_format_t format;
+} Config;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--min-kb K] [--max-mb M] [--accesses N] [--pages 4k,thp,2m,1g]\n"
+            "       %*s [--pattern chase|stride|all] [--format text|csv|json]\n",
+            argv0, (int)strlen(argv0), "");
+}
+
+static int parse_kinds(const char *val, unsigned *kinds)
+{
+    char list[64];
+    snprintf(list, sizeof(list), "%s", val);
+    *kinds = 0;
+    for (char *save = NULL, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        HugeKind k;
+        if (huge_parse_kind(tok, &k) != 0) return -1;
+        *kinds |= 1u << k;
+    }
+    return *kinds ? 0 : -1;
+}
+
+static int is_pow2(size_t n) { return n && !(n & (n - 1)); }
+
+static int parse_args(int argc, char *argv[], Config *cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) return -1;
+        const char *val = argv[++i];
+        if (strcmp(opt, "--min-kb") == 0) {
+            cfg->min_bytes = (size_t)strtoull(val, NULL, 10) << 10;
+        } else if (strcmp(opt, "--max-mb") == 0) {
+            cfg->max_bytes = (size_t)strtoull(val, NULL, 10) << 20;
+        } else if (strcmp(opt, "--accesses") == 0) {
+            cfg->accesses = strtoull(val, NULL, 10);
+        } else if (strcmp(opt, "--pages") == 0) {
+            if (parse_kinds(val, &cfg->kinds) != 0) return -1;
+        } else if (strcmp(opt, "--pattern") == 0) {
+            cfg->pattern = -2;
+            if (strcmp(val, "all") == 0) cfg->pattern = -1;
+            for (int p = 0; p < PATTERN_COUNT; p++)
+                if (strcmp(val, patterns[p]) == 0) cfg->pattern = p;
+            if (cfg->pattern == -2) return -1;
+        } else if (strcmp(opt, "--format") == 0) {
+            if (bench_parse_format(val, &cfg->format) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return is_pow2(cfg->min_bytes) && is_pow2(cfg->max_bytes) && cfg->min_bytes >= 4096 &&
+                   cfg->min_bytes <= cfg->max_bytes && cfg->accesses > 0
+               ? 0
+               : -1;
+}
+
+static size_t mem_available(void)
+{
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return SIZE_MAX;
+    char   line[128];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "MemAvailable: %zu kB", &kb) == 1) break;
+    fclose(f);
+    return kb ? kb << 10 : SIZE_MAX;
+}
+
+static void size_label(size_t bytes, char *buf, size_t n)
+{
+    if (bytes >= (size_t)1 << 30)      snprintf(buf, n, "%zu GB", bytes >> 30);
+    else if (bytes >= (size_t)1 << 20) snprintf(buf, n, "%zu MB", bytes >> 20);
+    else                               snprintf(buf, n, "%zu KB", bytes >> 10);
+}
+
+static void report(const Config *cfg, size_t bytes, int pattern, const Cell *cells, int *first)
+{
+    char label[16];
+    size_label(bytes, label, sizeof(label));
+    switch (cfg->format) {
+    case BENCH_FMT_TEXT:
+        printf("  %-6s %-7s", patterns[pattern], label);
+        for (int k = 0; k < HUGE_KINDS; k++) {
+            if (!(cfg->kinds & 1u << k)) continue;
+            const Cell *c = &cells[k];
+            if (!c->ok) {
+                printf("  %8s %6s", "n/a", "");
+            } else {
+                printf("  %8.2f", c->ns);
+                if (c->tlb < 0) printf(" %6s", "-");
+                else            printf(" %6.3f", c->tlb);
+            }
+            if (k == HUGE_THP) {
+                if (c->ok) printf(" %4.0f%%", 100.0 * c->huge);
+                else       printf(" %5s", "");
+            }
+        }
+        printf("\n");
+        break;
+    case BENCH_FMT_CSV:
+        for (int k = 0; k < HUGE_KINDS; k++) {
+            const Cell *c = &cells[k];
+            if (!(cfg->kinds & 1u << k) || !c->ok) continue;
+            printf("%s,%zu,%s,%.3f,", patterns[pattern], bytes, huge_kind_name((HugeKind)k), c->ns);
+            if (c->tlb >= 0) printf("%.4f", c->tlb);
+            printf(",%.3f\n", c->huge);
+        }
+        break;
+    case BENCH_FMT_JSON:
+        for (int k = 0; k < HUGE_KINDS; k++) {
+            const Cell *c = &cells[k];
+            if (!(cfg->kinds & 1u << k) || !c->ok) continue;
+            printf("%s\n    { \"pattern\": \"%s\", \"bytes\": %zu, \"pages\": \"%s\", \"ns_per_access\": %.3f, ",
+                   *first ? "" : ",", patterns[pattern], bytes, huge_kind_name((HugeKind)k), c->ns);
+            if (c->tlb >= 0) printf("\"dtlb_misses_per_access\": %.4f, ", c->tlb);
+            else             printf("\"dtlb_misses_per_access\": null, ");
+            printf("\"huge_fraction\": %.3f }", c->huge);
+            *first = 0;
+        }
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg = { 4u << 10, (size_t)1 << 30, 1u << 20, (1u << HUGE_KINDS) - 1, -1, BENCH_FMT_TEXT };
+    if (parse_args(argc, argv, &cfg) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t limit = mem_available() / 4 * 3;
+    switch (cfg.format) {
+    case BENCH_FMT_TEXT:
+        printf("bench_tlb: %llu accesses per measurement; ns/access and dTLB misses/access\n\n",
+               (unsigned long long)cfg.accesses);
+        printf("  %-6s %-7s", "", "working");
+        for (int k = 0; k < HUGE_KINDS; k++)
+            if (cfg.kinds & 1u << k) printf("  %-15s%s", huge_kind_name((HugeKind)k), k == HUGE_THP ? "      " : "");
+        printf("\n  %-6s %-7s", "", "set");
+        for (int k = 0; k < HUGE_KINDS; k++)
+            if (cfg.kinds & 1u << k) printf("  %8s %6s%s", "ns", "dTLB", k == HUGE_THP ? "  huge" : "");
+        printf("\n");
+        break;
+    case BENCH_FMT_CSV:
+        printf("pattern,bytes,pages,ns_per_access,dtlb_misses_per_access,huge_fraction\n");
+        break;
+    case BENCH_FMT_JSON:
+        printf("{\n  \"benchmark\": \"tlb\",\n  \"results\": [");
+        break;
+    }
+
+    /* Why each unavailable kind failed, the first time it did */
+    int    failed_errno[HUGE_KINDS] = { 0 };
+    int    first = 1;
+    size_t skipped = 0;
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+        if (cfg.pattern >= 0 && cfg.pattern != p) continue;
+        for (size_t bytes = cfg.min_bytes; bytes <= cfg.max_bytes && bytes; bytes <<= 1) {
+            if (bytes > limit) {
+                skipped = bytes;
+                break;
+            }
+            Cell cells[HUGE_KINDS];
+            memset(cells, 0, sizeof(cells));
+            for (int k = 0; k < HUGE_KINDS; k++) {
+                if (!(cfg.kinds & 1u << k)) continue;
+                HugeBuf b;
+                if (huge_alloc(&b, bytes, (HugeKind)k, 0) != 0) {
+                    if (!failed_errno[k]) failed_errno[k] = errno;
+                    continue;
+                }
+                size_t size = b.size;
+                b.size      = bytes;        /* the working set, not the rounded mapping */
+                if (p == 0) build_chase(b.addr, bytes / LINE);
+                else        memset(b.addr, 1, bytes);
+                cells[k].huge = (double)huge_backed(&b) / (double)bytes;
+                measure(&b, p, cfg.accesses, &cells[k]);
+                b.size = size;
+                huge_free(&b);
+            }
+            report(&cfg, bytes, p, cells, &first);
+        }
+        if (cfg.format == BENCH_FMT_TEXT && cfg.pattern < 0) printf("\n");
+    }
+
+    if (cfg.format == BENCH_FMT_JSON) {
+        printf("\n  ]\n}\n");
+    } else if (cfg.format == BENCH_FMT_TEXT) {
+        for (int k = 0; k < HUGE_KINDS; k++)
+            if (failed_errno[k])
+                printf("  %s: n/a (%s)%s\n", huge_kind_name((HugeKind)k), strerror(failed_errno[k]),
+                       k >= HUGE_2MB ? " — reserve pages in /proc/sys/vm/nr_hugepages" : "");
+        if (skipped) {
+            char label[16];
+            size_label(skipped, label, sizeof(label));
+            printf("  Working sets from %s up skipped: more than 3/4 of MemAvailable.\n", label);
+        }
+        if (perfctr_status()[0]) printf("  Counters: %s\n", perfctr_status());
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Chapter 36 — Huge-page backed buffers
+ *
+ * See hugepage.h.
+ */
+
+#define _GNU_SOURCE         /* MAP_HUGETLB, MADV_HUGEPAGE */
+
+#include "hugepage.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB   (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB   (30 << MAP_HUGE_SHIFT)
+#endif
+
+#define SMALL_PAGE ((size_t)4 << 10)
+#define HUGE_2M    ((size_t)2 << 20)
+#define HUGE_1G    ((size_t)1 << 30)
+
+static const char *names[HUGE_KINDS] = { "4k", "thp", "2m", "1g" };
+
+size_t huge_page_size(HugeKind k)
+{
+    switch (k) {
+    case HUGE_THP:
+    case HUGE_2MB: return HUGE_2M;
+    case HUGE_1GB: return HUGE_1G;
+    default:       return SMALL_PAGE;
+    }
+}
+
+const char *huge_kind_name(HugeKind k)
+{
+    return k >= 0 && k < HUGE_KINDS ? names[k] : "?";
+}
+
+int huge_parse_kind(const char *s, HugeKind *out)
+{
+    for (int k = 0; k < HUGE_KINDS; k++)
+        if (strcmp(s, names[k]) == 0) {
+            *out = (HugeKind)k;
+            return 0;
+        }
+    return -1;
+}
+
+static size_t round_up(size_t n, size_t to)
+{
+    return (n + to - 1) & ~(to - 1);
+}
+
+static int map_hugetlb(HugeBuf *b, size_t size, HugeKind k)
+{
+    size_t len   = round_up(size, huge_page_size(k));
+    int    flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (k == HUGE_1GB ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+    void  *p     = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED) return -1;
+    b->addr = b->map_addr = p;
+    b->size = b->map_size = len;
+    b->kind = k;
+    return 0;
+}
+
+/* Over-map by 2 MB and trim, so the buffer starts on a 2 MB boundary:
+ * only whole, aligned 2 MB extents can become huge pages */
+static int map_thp(HugeBuf *b, size_t size)
+{
+    size_t len = round_up(size, HUGE_2M);
+    char  *p   = mmap(NULL, len + HUGE_2M, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return -1;
+    char  *start = (char *)round_up((size_t)(uintptr_t)p, HUGE_2M);
+    size_t head  = (size_t)(start - p);
+    if (head) munmap(p, head);
+    if (HUGE_2M - head) munmap(start + len, HUGE_2M - head);
+    if (madvise(start, len, MADV_HUGEPAGE) != 0) {
+        int err = errno;
+        munmap(start, len);
+        errno = err;
+        return -1;
+    }
+    b->addr = b->map_addr = start;
+    b->size = b->map_size = len;
+    b->kind = HUGE_THP;
+    return 0;
+}
+
+static int map_small(HugeBuf *b, size_t size)
+{
+    size_t len = round_up(size, SMALL_PAGE);
+    void  *p   = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return -1;
+    /* With THP "always" the kernel would promote it anyway */
+    madvise(p, len, MADV_NOHUGEPAGE);
+    b->addr = b->map_addr = p;
+    b->size = b->map_size = len;
+    b->kind = HUGE_NONE;
+    return 0;
+}
+
+int huge_alloc(HugeBuf *b, size_t size, HugeKind want, int fallback)
+{
+    memset(b, 0, sizeof(*b));
+    if (size == 0 || want < 0 || want >= HUGE_KINDS) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int k = (int)want; k >= 0; k--) {
+        int rc;
+        switch ((HugeKind)k) {
+        case HUGE_1GB:
+        case HUGE_2MB: rc = map_hugetlb(b, size, (HugeKind)k); break;
+        case HUGE_THP: rc = map_thp(b, size); break;
+        default:       rc = map_small(b, size); break;
+        }
+        if (rc == 0) return 0;
+        if (!fallback) return -1;
+    }
+    return -1;
+}
+
+void huge_free(HugeBuf *b)
+{
+    if (b->map_addr) munmap(b->map_addr, b->map_size);
+    memset(b, 0, sizeof(*b));
+}
+
+/* AnonHugePages of the smaps entry holding b; a neighbouring THP region
+ * merged into the same VMA would be counted too, hence the clamp */
+static size_t thp_backed(const HugeBuf *b)
+{
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    char      line[256];
+    uintptr_t want = (uintptr_t)b->addr;
+    int       in   = 0;
+    size_t    kb   = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long lo, hi;
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {          /* a mapping's first line */
+            if (in) break;
+            in = want >= lo && want < hi;
+        } else if (in && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return kb * 1024 < b->size ? kb * 1024 : b->size;
+}
+
+size_t huge_backed(const HugeBuf *b)
+{
+    switch (b->kind) {
+    case HUGE_THP:  return thp_backed(b);
+    case HUGE_2MB:
+    case HUGE_1GB:  return b->size;
+    default:        return 0;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Chapter 36 — Huge-page backed buffers
+ *
+ * One TLB entry maps one page: 4 KB, 2 MB or 1 GB.  A buffer on huge
+ * pages needs 512 (or 262144) times fewer entries, so a TLB that
+ * covers a few MB of 4 KB pages covers GBs.  Linux offers two routes:
+ *
+ *   HUGE_THP    transparent huge pages: an ordinary anonymous mapping,
+ *               2 MB aligned and madvise(MADV_HUGEPAGE)d, which the
+ *               kernel backs with 2 MB pages when it can find them
+ *               (whole 2 MB extents only; the rest stays 4 KB)
+ *   HUGE_2MB    hugetlbfs pages, mmap(MAP_HUGETLB): guaranteed at mmap
+ *   HUGE_1GB    time, but only from the pool an administrator reserved
+ *               (/proc/sys/vm/nr_hugepages, or hugepages= at boot)
+ *
+ * and HUGE_NONE, 4 KB pages with THP explicitly refused, as the
+ * baseline.  huge_alloc() with fallback set walks down 1GB → 2MB →
+ * THP → NONE until one works; b->kind says which it got, and
+ * huge_backed() how much of it the kernel really put on huge pages.
+ */
+
+#ifndef HUGEPAGE_H
+#define HUGEPAGE_H
+
+#include <stddef.h>
+
+typedef enum {
+    HUGE_NONE,
+    HUGE_THP,
+    HUGE_2MB,
+    HUGE_1GB,
+    HUGE_KINDS
+} HugeKind;
+
+typedef struct {
+    void    *addr;
+    size_t   size;          /* requested size rounded up to the page size */
+    HugeKind kind;          /* how the mapping was made */
+    void    *map_addr;      /* what huge_free() unmaps */
+    size_t   map_size;
+} HugeBuf;
+
+/* 0 on success; -1 with errno (ENOMEM: no such pages, pool empty) */
+int         huge_alloc(HugeBuf *b, size_t size, HugeKind want, int fallback);
+void        huge_free(HugeBuf *b);
+
+/* Bytes of b on huge pages: all of it for hugetlbfs, what
+ * /proc/self/smaps reports as AnonHugePages for THP, 0 for NONE */
+size_t      huge_backed(const HugeBuf *b);
+
+size_t      huge_page_size(HugeKind k);
+const char *huge_kind_name(HugeKind k);    /* "4k", "thp", "2m", "1g" */
+int         huge_parse_kind(const char *s, HugeKind *out);
+
+#endif /* HUGEPAGE_H */
@@ -2,6 +2,8 @@
  * ║  Chapter 36 — Virtual Memory Deep Dive                          ║
  * ║  Modular-C-Demos                                                ║
  * ║  Topics: paging, TLB, page faults, COW, mmap, mprotect         ║
+ * ║          huge pages (hugepage.c), TLB misses measured           ║
+ * ║          page faults counted, prefault policies                 ║
  * ╚══════════════════════════════════════════════════════════════════╝ */
 
 #define _GNU_SOURCE
@@ -16,8 +18,13 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <setjmp.h>
+#include <time.h>
+#include <sys/resource.h>
 #endif
 
+#include "../33_debugging_tools/perfctr.h"
+#include "hugepage.h"
+
 /* ════════════════════════════════════════════════════════════════════
  *  Section 1 — Virtual vs Physical Addresses
  * ════════════════════════════════════════════════════════════════════ */
@@ -96,6 +103,19 @@ static void demo_pages(void)
     long page_size = sysconf(_SC_PAGESIZE);
     printf("  This system's page size: %ld bytes (%ld KB)\n\n",
            page_size, page_size / 1024);
+
+    /* Ask for each kind of huge page for 8 MB, falling back as needed */
+    printf("  huge_alloc(8 MB) (hugepage.c), falling back when refused:\n");
+    for (int k = HUGE_KINDS - 1; k >= 0; k--) {
+        HugeBuf b;
+        if (huge_alloc(&b, (size_t)8 << 20, (HugeKind)k, 1) != 0) continue;
+        memset(b.addr, 1, b.size);
+        printf("    want %-3s → got %-3s at %p, %zu of %zu KB on huge pages\n",
+               huge_kind_name((HugeKind)k), huge_kind_name(b.kind), b.addr,
+               huge_backed(&b) >> 10, b.size >> 10);
+        huge_free(&b);
+    }
+    printf("\n");
 #endif
 }
 
@@ -134,6 +154,63 @@ static void demo_tlb(void)
     printf("    When a page table entry changes, all CPUs must\n");
     printf("    invalidate their TLB entries for that address.\n");
     printf("    This IPI (Inter-Processor Interrupt) is expensive.\n\n");
+
+#ifdef __linux__
+    /* Same number of loads: one per 4 KB page over 64 MB, or spread
+     * over 16 pages the TLB easily holds                            */
+    enum { PAGES = 16384, PASSES = 8 };
+    size_t         len = (size_t)PAGES * 4096;
+    volatile char *m   = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) return;
+
+    PerfSample t0, t1, d;
+    char       line[160];
+    perfctr_read(&t0);
+    for (size_t p = 0; p < PAGES; p++) m[p * 4096] = 1;
+    perfctr_read(&t1);
+    perfctr_diff(&t0, &t1, &d);
+    perfctr_format(&d, line, sizeof(line));
+    printf("  Measured (perfctr.c, chapter 33), %d loads per pass:\n", PAGES);
+    printf("    first touch, 1 per page:  %s\n", line);
+
+    unsigned sum = 0;
+    perfctr_read(&t0);
+    for (int pass = 0; pass < PASSES; pass++)
+        for (size_t p = 0; p < PAGES; p++) sum += m[p * 4096];
+    perfctr_read(&t1);
+    perfctr_diff(&t0, &t1, &d);
+    perfctr_format(&d, line, sizeof(line));
+    printf("    1 per page, %d pages:  %s (%.1f ns/load)\n", PAGES, line,
+           (double)d.ns / (PASSES * PAGES));
+
+    perfctr_read(&t0);
+    for (int pass = 0; pass < PASSES; pass++)
+        for (size_t p = 0; p < PAGES; p++) sum += m[(p % 16) * 4096 + (p / 16) % 4096];
+    perfctr_read(&t1);
+    perfctr_diff(&t0, &t1, &d);
+    perfctr_format(&d, line, sizeof(line));
+    printf("    same loads in 16 pages:   %s (%.1f ns/load)\n", line, (double)d.ns / (PASSES * PAGES));
+
+    /* The first pattern again, with 32 TLB entries covering all of it */
+    HugeBuf hb;
+    if (huge_alloc(&hb, len, HUGE_2MB, 1) == 0) {
+        volatile char *h = hb.addr;
+        for (size_t p = 0; p < PAGES; p++) h[p * 4096] = 1;
+        perfctr_read(&t0);
+        for (int pass = 0; pass < PASSES; pass++)
+            for (size_t p = 0; p < PAGES; p++) sum += h[p * 4096];
+        perfctr_read(&t1);
+        perfctr_diff(&t0, &t1, &d);
+        perfctr_format(&d, line, sizeof(line));
+        printf("    1 per 4 KB, %-3s pages:    %s (%.1f ns/load, %zu%% huge)\n", huge_kind_name(hb.kind), line,
+               (double)d.ns / (PASSES * PAGES), 100 * huge_backed(&hb) / hb.size);
+        huge_free(&hb);
+    }
+    if (perfctr_status()[0]) printf("    (%s)\n", perfctr_status());
+    printf("\n");
+    munmap((void *)m, len);
+    (void)sum;
+#endif
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -172,6 +249,34 @@ static void demo_page_faults(void)
     printf("    → Major page faults: 0\n\n");
 
     printf("  perf stat -e page-faults ./program\n\n");
+
+#ifdef __linux__
+    /* Count them: 16 MB touched lazily, then prefaulted by MAP_POPULATE */
+    size_t len = (size_t)16 << 20;
+    for (int populate = 0; populate <= 1; populate++) {
+        struct rusage r0, r1;
+        getrusage(RUSAGE_SELF, &r0);
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        volatile char *m = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | (populate ? MAP_POPULATE : 0), -1, 0);
+        if (m == MAP_FAILED) break;
+        m[0] = 1;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (size_t off = 4096; off < len; off += 4096) m[off] = 1;
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        getrusage(RUSAGE_SELF, &r1);
+        printf("  16 MB, %-12s first access after %7.1f us, all pages after %6.1f ms, %ld minor faults\n",
+               populate ? "MAP_POPULATE:" : "lazy:",
+               (double)(t1.tv_sec - t0.tv_sec) * 1e6 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e3,
+               (double)(t2.tv_sec - t0.tv_sec) * 1e3 + (double)(t2.tv_nsec - t0.tv_nsec) / 1e6,
+               r1.ru_minflt - r0.ru_minflt);
+        munmap((void *)m, len);
+    }
+    printf("  Lazy is fast to start and pays per page; prefaulting pays up\n");
+    printf("  front.  ./bin/bench_prefault compares every policy, anonymous\n");
+    printf("  and file-backed.\n\n");
+#endif
 }
 
 /* ════════════════════════════════════════════════════════════════════
@@ -1,37 +1,326 @@
 /**
  * @file main.c
- * @brief Master demo runner - runs all C concept demos
+ * @brief Master demo runner - runs the chapter demos, several at a time
+ *
+ * With no arguments it prints the banner. With --all or --part N it
+ * posix_spawn()s the chapter binaries (found next to itself), up to
+ * --jobs at once, collects each one's stdout and stderr through a pipe,
+ * prints the captured output in chapter order and finishes with a table
+ * of wall time, user/sys CPU and max RSS from wait4().
  */
+#define _DEFAULT_SOURCE     /* wait4() needs this with -std=c99 */
+
 #include "../include/common.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 
-void print_menu(void) {
-    printf("\n");
-    printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║           COMPREHENSIVE C PROGRAMMING DEMOS                  ║\n");
-    printf("║                    Version %s                              ║\n", VERSION_STRING);
-    printf("╚══════════════════════════════════════════════════════════════╝\n");
-    printf("\nAvailable Demos:\n");
-    printf("  1. Data Types      - int, float, char, fixed-width, qualifiers\n");
-    printf("  2. Operators       - arithmetic, logical, bitwise, assignment\n");
-    printf("  3. Control Flow    - if, switch, for, while, goto\n");
-    printf("  4. Functions       - recursion, variadic, callbacks\n");
-    printf("  5. Arrays          - 1D, 2D, VLA, pointers\n");
-    printf("  6. Pointers        - basics, arithmetic, double pointers\n");
-    printf("  7. Strings         - string.h, manipulation, tokenization\n");
-    printf("  8. Structures      - struct, union, enum, bit fields\n");
-    printf("  9. Memory          - malloc, calloc, realloc, patterns\n");
-    printf(" 10. File I/O        - text, binary, seeking\n");
-    printf(" 11. Preprocessor    - macros, conditionals, pragmas\n");
-    printf(" 12. Bitwise         - AND, OR, XOR, shifts, tricks\n");
-    printf(" 13. Advanced        - generics, compound literals, C11\n");
-    printf(" 14. Concurrency     - pthreads, mutex, condition vars\n");
-    printf(" 15. System          - signals, environment, fork\n");
-    printf("  0. Exit\n");
-    printf("\nEnter choice (1-15, 0 to exit): ");
+extern char **environ;
+
+typedef struct {
+    int         part;
+    const char *bin;
+    const char *topic;
+} Chapter;
+
+static const Chapter chapters[] = {
+    { 1, "01_data_types",           "Data Types" },
+    { 1, "02_operators",            "Operators" },
+    { 1, "03_control_flow",         "Control Flow" },
+    { 1, "04_functions",            "Functions" },
+    { 1, "05_arrays",               "Arrays" },
+    { 1, "06_pointers",             "Pointers" },
+    { 1, "07_strings",              "Strings" },
+    { 1, "08_structures",           "Structures" },
+    { 1, "09_memory",               "Memory" },
+    { 1, "10_file_io",              "File I/O" },
+    { 1, "11_preprocessor",         "Preprocessor" },
+    { 1, "12_bitwise",              "Bitwise" },
+    { 1, "13_advanced",             "Advanced" },
+    { 1, "14_concurrency",          "Concurrency" },
+    { 1, "15_system",               "System" },
+    { 2, "16_compilation_overview", "Compilation Pipeline" },
+    { 2, "17_preprocessor_deep",    "Preprocessor Deep" },
+    { 2, "18_lexical_analysis",     "Lexical Analysis" },
+    { 2, "19_parsing_ast",          "Parsing & AST" },
+    { 2, "20_semantic_analysis",    "Semantic Analysis" },
+    { 2, "21_intermediate_repr",    "Intermediate Repr." },
+    { 2, "22_optimisation",         "Optimisation" },
+    { 2, "23_code_generation",      "Code Generation" },
+    { 2, "24_assembler_elf",        "Assembler & ELF" },
+    { 2, "25_linker",               "Linker" },
+    { 3, "26_elf_executable",       "ELF Executable" },
+    { 3, "27_kernel_exec",          "Kernel Execution" },
+    { 3, "28_dynamic_linker",       "Dynamic Linker" },
+    { 3, "29_memory_layout",        "Memory Layout" },
+    { 3, "30_crt_startup",          "CRT Startup" },
+    { 3, "31_calling_conventions",  "Calling Conventions" },
+    { 3, "32_termination",          "Termination" },
+    { 4, "33_debugging_tools",      "Debugging Tools" },
+    { 4, "34_libraries",            "Libraries" },
+    { 4, "35_cross_compilation",    "Cross-Compilation" },
+    { 4, "36_virtual_memory",       "Virtual Memory" },
+};
+
+typedef enum { JOB_WAITING, JOB_RUNNING, JOB_DONE, JOB_NOT_STARTED } JobState;
+
+typedef struct {
+    const Chapter *ch;
+    JobState       state;
+    pid_t          pid;
+    int            fd;          /* read end of the child's stdout+stderr; -1: closed */
+    char          *out;
+    size_t         len, cap;
+    u64            start_ns, end_ns;
+    int            status;
+    int            timed_out;
+    struct rusage  ru;
+} Job;
+
+typedef struct {
+    int         part;           /* 0: all */
+    int         jobs;
+    int         lines;          /* per chapter; -1: all, 0: table only */
+    int         timeout_s;
+    const char *dir;
+} Options;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
 }
 
-int main(int argc, char *argv[]) {
+static double tv_ms(struct timeval tv) {
+    return (double)tv.tv_sec * 1e3 + (double)tv.tv_usec / 1e3;
+}
+
+/* ── Spawning ──────────────────────────────────────────────────── */
+
+/* Start job j: stdin from /dev/null, stdout and stderr into one pipe
+ * (so the capture interleaves like `2>&1`). -1 if it could not start */
+static int start_job(Job *j, const Options *o) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", o->dir, j->ch->bin);
+
+    int p[2];
+    if (pipe(p) != 0) return -1;
+    /* Only this child may hold the write end, or the others would keep
+     * our read end from ever seeing EOF */
+    fcntl(p[0], F_SETFD, FD_CLOEXEC);
+    fcntl(p[1], F_SETFD, FD_CLOEXEC);
+    fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL) | O_NONBLOCK);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, p[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, p[1], STDERR_FILENO);
+
+    char *argv[] = { path, NULL };
+    j->start_ns = now_ns();
+    int rc = posix_spawn(&j->pid, path, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    close(p[1]);
+    if (rc != 0) {
+        close(p[0]);
+        errno = rc;
+        return -1;
+    }
+    j->fd = p[0];
+    j->state = JOB_RUNNING;
+    return 0;
+}
+
+/* Read what is there; close the pipe on EOF */
+static void drain_job(Job *j) {
+    while (j->fd >= 0) {
+        if (j->cap - j->len < 4096) {
+            size_t cap = j->cap ? j->cap * 2 : 16384;
+            char *out = realloc(j->out, cap);
+            if (!out) { close(j->fd); j->fd = -1; return; }
+            j->out = out;
+            j->cap = cap;
+        }
+        ssize_t n = read(j->fd, j->out + j->len, j->cap - j->len);
+        if (n > 0) {
+            j->len += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) { close(j->fd); j->fd = -1; }
+            return;
+        }
+    }
+}
+
+/* Reap j if it has exited (blocking if `wait`); 1 once it is done */
+static int reap_job(Job *j, int wait) {
+    pid_t r;
+    do r = wait4(j->pid, &j->status, wait ? 0 : WNOHANG, &j->ru);
+    while (r < 0 && errno == EINTR);
+    if (r != j->pid) return 0;
+    j->end_ns = now_ns();
+    /* A grandchild may still hold the pipe open: take what is there */
+    drain_job(j);
+    if (j->fd >= 0) { close(j->fd); j->fd = -1; }
+    j->state = JOB_DONE;
+    return 1;
+}
+
+/* ── Output ────────────────────────────────────────────────────── */
+
+static void print_job(const Job *j, const Options *o) {
+    printf("\n━━━ %s — %s ━━━\n", j->ch->bin, j->ch->topic);
+    if (j->state == JOB_NOT_STARTED) {
+        printf("  (could not start: no %s/%s?)\n", o->dir, j->ch->bin);
+        return;
+    }
+    size_t end = j->len;
+    int lines = 0;
+    if (o->lines >= 0) {
+        for (end = 0; end < j->len && lines < o->lines; end++)
+            if (j->out[end] == '\n') lines++;
+    }
+    fwrite(j->out, 1, end, stdout);
+    if (end > 0 && j->out[end - 1] != '\n') putchar('\n');
+    if (end < j->len) {
+        int rest = 0;
+        for (size_t i = end; i < j->len; i++) rest += j->out[i] == '\n';
+        printf("  ... (%d more lines)\n", rest);
+    }
+    fflush(stdout);
+}
+
+static void status_text(const Job *j, char *buf, size_t size) {
+    if (j->state == JOB_NOT_STARTED) snprintf(buf, size, "missing");
+    else if (j->timed_out) snprintf(buf, size, "timeout");
+    else if (WIFSIGNALED(j->status)) snprintf(buf, size, "signal %d", WTERMSIG(j->status));
+    else if (WEXITSTATUS(j->status) != 0) snprintf(buf, size, "exit %d", WEXITSTATUS(j->status));
+    else snprintf(buf, size, "ok");
+}
+
+static int job_failed(const Job *j) {
+    return j->state == JOB_NOT_STARTED || j->timed_out || !WIFEXITED(j->status) ||
+           WEXITSTATUS(j->status) != 0;
+}
+
+static void print_table(const Job *jobs, int n, const Options *o, double elapsed_ms) {
+    double wall = 0, user = 0, sys = 0;
+    long rss = 0;
+    int failed = 0;
+
+    printf("\n╔═══════════════════════════════════════════════════════════════════════════╗\n");
+    printf("║  Chapter                   Status       Wall ms   User ms    Sys ms  RSS KB ║\n");
+    printf("╠═══════════════════════════════════════════════════════════════════════════╣\n");
+    for (int i = 0; i < n; i++) {
+        const Job *j = &jobs[i];
+        char st[16];
+        status_text(j, st, sizeof(st));
+        failed += job_failed(j);
+        if (j->state == JOB_NOT_STARTED) {
+            printf("║  %-24s  %-9s %9s %9s %9s %7s ║\n", j->ch->bin, st, "-", "-", "-", "-");
+            continue;
+        }
+        double w = (double)(j->end_ns - j->start_ns) / 1e6;
+        double u = tv_ms(j->ru.ru_utime), s = tv_ms(j->ru.ru_stime);
+        wall += w;
+        user += u;
+        sys += s;
+        if (j->ru.ru_maxrss > rss) rss = j->ru.ru_maxrss;
+        printf("║  %-24s  %-9s %9.1f %9.1f %9.1f %7ld ║\n", j->ch->bin, st, w, u, s, j->ru.ru_maxrss);
+    }
+    printf("╠═══════════════════════════════════════════════════════════════════════════╣\n");
+    printf("║  %-24s  %-9s %9.1f %9.1f %9.1f %7ld ║\n", "sum (max RSS)", failed ? "FAILED" : "ok",
+           wall, user, sys, rss);
+    printf("╚═══════════════════════════════════════════════════════════════════════════╝\n");
+    printf("  %d chapters, %d at a time: %.1f ms elapsed, wall times overlapping %.1fx\n",
+           n, o->jobs, elapsed_ms, elapsed_ms > 0 ? wall / elapsed_ms : 0.0);
+    if (failed) printf("  %d chapter%s FAILED\n", failed, failed == 1 ? "" : "s");
+}
+
+/* ── Runner ────────────────────────────────────────────────────── */
+
+static int run_chapters(const Options *o) {
+    Job jobs[ARRAY_SIZE(chapters)];
+    int n = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(chapters); i++) {
+        if (o->part && chapters[i].part != o->part) continue;
+        memset(&jobs[n], 0, sizeof(jobs[n]));
+        jobs[n].ch = &chapters[i];
+        jobs[n].fd = -1;
+        n++;
+    }
+
+    u64 t0 = now_ns();
+    int next = 0, running = 0, printed = 0;
+    while (printed < n) {
+        while (running < o->jobs && next < n) {
+            Job *j = &jobs[next++];
+            if (start_job(j, o) == 0) running++;
+            else j->state = JOB_NOT_STARTED;
+        }
+
+        struct pollfd pfd[ARRAY_SIZE(chapters)];
+        Job *owner[ARRAY_SIZE(chapters)];
+        int np = 0;
+        for (int i = 0; i < n; i++) {
+            if (jobs[i].state != JOB_RUNNING || jobs[i].fd < 0) continue;
+            pfd[np].fd = jobs[i].fd;
+            pfd[np].events = POLLIN;
+            pfd[np].revents = 0;
+            owner[np++] = &jobs[i];
+        }
+        /* The timeout also catches exits whose pipe is held elsewhere */
+        if (poll(pfd, (nfds_t)np, 50) < 0 && errno != EINTR) {
+            perror("poll");
+            return 1;
+        }
+        for (int k = 0; k < np; k++)
+            if (pfd[k].revents) drain_job(owner[k]);
+
+        u64 t = now_ns();
+        for (int i = 0; i < n; i++) {
+            Job *j = &jobs[i];
+            if (j->state != JOB_RUNNING) continue;
+            if (!j->timed_out && t - j->start_ns > (u64)o->timeout_s * 1000000000ull) {
+                kill(j->pid, SIGKILL);
+                j->timed_out = 1;
+            }
+            /* EOF: the child has closed its output and is about to exit */
+            if (reap_job(j, j->fd < 0)) running--;
+        }
+
+        /* Print in chapter order, as soon as the prefix is complete */
+        while (printed < n && jobs[printed].state >= JOB_DONE) {
+            if (o->lines != 0) print_job(&jobs[printed], o);
+            free(jobs[printed].out);
+            jobs[printed].out = NULL;
+            printed++;
+        }
+    }
+
+    print_table(jobs, n, o, (double)(now_ns() - t0) / 1e6);
+    for (int i = 0; i < n; i++)
+        if (job_failed(&jobs[i])) return 1;
+    return 0;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--all | --part N] [--jobs N] [--lines N] [--timeout S]\n", argv0);
+    fprintf(stderr, "  --all        run every chapter (1-36)\n");
+    fprintf(stderr, "  --part N     run Part N only (1-4)\n");
+    fprintf(stderr, "  --jobs N     chapters at a time (default: online CPUs, at least 4)\n");
+    fprintf(stderr, "  --lines N    print the first N lines of each chapter (0: table only)\n");
+    fprintf(stderr, "  --timeout S  kill a chapter after S seconds (default 60)\n");
+}
+
+static void print_banner(void) {
     printf("\n");
     printf("████████████████████████████████████████████████████████████████\n");
     printf("██                                                            ██\n");
@@ -45,12 +334,63 @@ int main(int argc, char *argv[]) {
     printf("  ./bin/02_operators\n");
     printf("  ./bin/03_control_flow\n");
     printf("  ... etc.\n");
-    printf("\nOr run: make test  (to execute all demos)\n");
+    printf("\nOr run them all, in parallel, with a timing table:\n");
+    printf("  ./bin/c_demos --all [--jobs N]   (or --part 1..4; make test does this)\n");
     printf("\nDemo Topics Covered:\n");
     printf("  - Basic: Data types, Operators, Control flow, Functions\n");
     printf("  - Intermediate: Arrays, Pointers, Strings, Structures\n");
     printf("  - Advanced: Memory, File I/O, Preprocessor, Bitwise\n");
     printf("  - Expert: C11 features, Concurrency, System programming\n");
-    
-    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options o = { 0, 0, -1, 60, "." };
+    int run = 0;
+
+    /* Several chapters spend most of their time asleep (ch14's usleep()
+     * calls), so run at least four at once even on a small machine */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    o.jobs = cpus > 4 ? (int)cpus : 4;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--all") == 0) {
+            run = 1;
+        } else if (strcmp(a, "--part") == 0 && val) {
+            o.part = atoi(val);
+            run = 1;
+            i++;
+        } else if (strcmp(a, "--jobs") == 0 && val) {
+            o.jobs = atoi(val);
+            i++;
+        } else if (strcmp(a, "--lines") == 0 && val) {
+            o.lines = atoi(val);
+            i++;
+        } else if (strcmp(a, "--timeout") == 0 && val) {
+            o.timeout_s = atoi(val);
+            i++;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (o.part < 0 || o.part > 4 || o.jobs < 1 || o.timeout_s < 1 || o.lines < -1) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    if (!run) {
+        print_banner();
+        return 0;
+    }
+
+    /* The chapter binaries live next to this one */
+    static char dir[4096];
+    const char *slash = strrchr(argv[0], '/');
+    if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - argv[0]), argv[0]);
+        o.dir = dir;
+    }
+    return run_chapters(&o);
 }